@@ -33,6 +33,7 @@ int main(int argc, char** argv)
 		int numRays = 1;
 		float tofWidth_ps = 0.0;
 		int tofNumStd = 0;
+		int tofLUTSamplesPerStd = 0;
 
 		Plugin::OptionsResult pluginOptionsResults;  // For plugins' options
 
@@ -57,6 +58,7 @@ int main(int argc, char** argv)
 		". The default projector is Siddon", cxxopts::value<std::string>(projector_name))
 		("tof_width_ps", "TOF Width in Picoseconds", cxxopts::value<float>(tofWidth_ps))
 		("tof_n_std", "Number of standard deviations to consider for TOF's Gaussian curve", cxxopts::value<int>(tofNumStd))
+		("tof_lut", "Use a tabulated TOF kernel with the given number of samples per standard deviation (max. 128)", cxxopts::value<int>(tofLUTSamplesPerStd))
 		("num_rays", "Number of rays to use in the Siddon projector", cxxopts::value<int>(numRays))
 		("num_threads", "Number of threads to use", cxxopts::value<int>(numThreads))
 		("num_subsets", "Number of subsets to use (Default: 1)", cxxopts::value<int>(numSubsets))
@@ -113,7 +115,7 @@ int main(int argc, char** argv)
 		auto binIter = dataInput->getBinIter(numSubsets, subsetId);
 		OperatorProjectorParams projParams(binIter.get(), *scanner, tofWidth_ps,
 		                                   tofNumStd, projSpacePsf_fname,
-		                                   numRays);
+		                                   numRays, tofLUTSamplesPerStd);
 
 		auto projectorType = IO::getProjector(projector_name);
 
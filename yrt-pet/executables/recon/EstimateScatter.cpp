@@ -39,6 +39,13 @@ int main(int argc, char** argv)
 		float acfThreshold = Scatter::ScatterEstimator::DefaultACFThreshold;
 		bool useGPU = false;
 		int seed = Scatter::ScatterEstimator::DefaultSeed;
+		int imageDownsampling =
+		    Scatter::ScatterEstimator::DefaultImageDownsampling;
+		bool smoothInterpolation = false;
+		size_t numTOFBins = 0;
+		float tofBinWidth_ps = 0.0f;
+		float tofWidth_ps = 0.0f;
+		int tofNumStd = -1;
 
 		// Parse command line arguments
 		cxxopts::Options options(argv[0], "Scatter estimation executable");
@@ -71,6 +78,26 @@ int main(int argc, char** argv)
 		         cxxopts::value(nR));
 		sssGroup("crystal_mat", "Crystal material name (default: LYSO)",
 		         cxxopts::value(crystalMaterial_name));
+		sssGroup("downsampling",
+		         "Downsampling factor of the attenuation and source images "
+		         "for SSS (default: 1, no downsampling)",
+		         cxxopts::value(imageDownsampling));
+		sssGroup("smooth",
+		         "Fill the non-simulated bins by monotone cubic "
+		         "interpolation instead of linear interpolation",
+		         cxxopts::value(smoothInterpolation));
+		sssGroup("tof_bins",
+		         "Number of TOF bins of the output scatter estimate (default: "
+		         "0, no TOF)",
+		         cxxopts::value(numTOFBins));
+		sssGroup("tof_bin_width", "Width of the TOF bins (in ps)",
+		         cxxopts::value(tofBinWidth_ps));
+		sssGroup("tof_width", "TOF resolution (FWHM, in ps)",
+		         cxxopts::value(tofWidth_ps));
+		sssGroup("tof_n_std",
+		         "Number of standard deviations where to truncate the TOF "
+		         "kernel",
+		         cxxopts::value(tofNumStd));
 
 		auto tailFittingGroup = options.add_options("2. Tail fitting");
 		tailFittingGroup("prompts", "Prompts histogram file",
@@ -128,6 +155,14 @@ int main(int argc, char** argv)
 			return -1;
 		}
 
+		if (numTOFBins > 0 && (tofBinWidth_ps <= 0.0f || tofWidth_ps <= 0.0f))
+		{
+			std::cerr << "A TOF scatter estimate needs a positive "
+			             "\'tof_bin_width\' and \'tof_width\'."
+			          << std::endl;
+			return -1;
+		}
+
 		if (useGPU)
 		{
 #if not BUILD_CUDA
@@ -223,12 +258,25 @@ int main(int argc, char** argv)
 		                                           seed,
 		                                           maskWidth,
 		                                           acfThreshold,
-		                                           saveIntermediary_dir};
+		                                           saveIntermediary_dir,
+		                                           imageDownsampling,
+		                                           smoothInterpolation};
 
-		auto scatterEstimate =
-		    scatterEstimator.computeTailFittedScatterEstimate(nZ, nPhi, nR);
-
-		scatterEstimate->writeToFile(scatterOut_fname);
+		if (numTOFBins > 0)
+		{
+			auto scatterEstimate =
+			    scatterEstimator.computeTailFittedTOFScatterEstimate(
+			        nZ, nPhi, nR, numTOFBins, tofBinWidth_ps, tofWidth_ps,
+			        tofNumStd);
+			scatterEstimate->writeToFile(scatterOut_fname);
+		}
+		else
+		{
+			auto scatterEstimate =
+			    scatterEstimator.computeTailFittedScatterEstimate(nZ, nPhi,
+			                                                      nR);
+			scatterEstimate->writeToFile(scatterOut_fname);
+		}
 	}
 	catch (const cxxopts::exceptions::exception& e)
 	{
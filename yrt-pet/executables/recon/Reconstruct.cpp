@@ -5,10 +5,11 @@
 
 #include "../PluginOptionsHelper.hpp"
 #include "datastruct/IO.hpp"
+#include "datastruct/projection/Histogram3D.hpp"
 #include "datastruct/scanner/Scanner.hpp"
+#include "scatter/ScatterEstimator.hpp"
 #include "utils/Assert.hpp"
 #include "utils/Globals.hpp"
-#include "utils/ProgressDisplay.hpp"
 #include "utils/ReconstructionUtils.hpp"
 #include "utils/Utilities.hpp"
 
@@ -35,6 +36,7 @@ int main(int argc, char** argv)
 		std::string hardwareAcf_fname;
 		std::string hardwareAcf_format;
 		std::string imageSpacePsf_fname;
+		std::string imageSpaceVarPsf_fname;
 		std::string projSpacePsf_fname;
 		std::string randoms_fname;
 		std::string randoms_format;
@@ -53,11 +55,23 @@ int main(int argc, char** argv)
 		float tofWidth_ps = 0.0f;
 		float globalScalingFactor = 1.0f;
 		int tofNumStd = 0;
+		int tofLUTSamplesPerStd = 0;
 		int saveIterStep = 0;
 		std::string saveIterRanges;
 		bool sensOnly = false;
 		bool mustMoveSens = false;
 		bool invertSensitivity = false;
+		int numScatterRounds = 0;
+		size_t scatterNZ = 0;
+		size_t scatterNPhi = 0;
+		size_t scatterNR = 0;
+		std::string crystalMaterial_name = "LYSO";
+		int scatterMaskWidth = -1;
+		float scatterACFThreshold =
+		    Scatter::ScatterEstimator::DefaultACFThreshold;
+		int scatterImageDownsampling =
+		    Scatter::ScatterEstimator::DefaultImageDownsampling;
+		std::string scatterOut_fname;
 
 		Plugin::OptionsResult pluginOptionsResults;  // For plugins' options
 
@@ -143,6 +157,10 @@ int main(int argc, char** argv)
 		    cxxopts::value<std::string>(scatter_format));
 		reconGroup("psf", "Image-space PSF kernel file",
 		           cxxopts::value<std::string>(imageSpacePsf_fname));
+		reconGroup("var_psf",
+		           "Spatially-variant image-space PSF kernels file (radial and "
+		           "axial positions of the kernels followed by the kernels)",
+		           cxxopts::value<std::string>(imageSpaceVarPsf_fname));
 		reconGroup("hard_threshold", "Hard Threshold",
 		           cxxopts::value<float>(hardThreshold));
 		reconGroup("save_iter_step",
@@ -194,6 +212,40 @@ int main(int argc, char** argv)
 		        IO::possibleFormats(Plugin::InputFormatsChoice::ONLYHISTOGRAMS),
 		    cxxopts::value<std::string>(hardwareAcf_format));
 
+		auto scatterGroup = options.add_options("3.2 Scatter estimation");
+		scatterGroup("scatter_rounds",
+		             "Number of scatter estimations, each one from the "
+		             "image of the previous reconstruction, before the final "
+		             "reconstruction (Default: 0, no scatter estimation). "
+		             "The input must be in the Histogram3D format",
+		             cxxopts::value<int>(numScatterRounds));
+		scatterGroup("scatter_nZ", "Number of Z planes to consider for SSS",
+		             cxxopts::value<size_t>(scatterNZ));
+		scatterGroup("scatter_nPhi",
+		             "Number of Phi angles to consider for SSS",
+		             cxxopts::value<size_t>(scatterNPhi));
+		scatterGroup("scatter_nR", "Number of R distances to consider for SSS",
+		             cxxopts::value<size_t>(scatterNR));
+		scatterGroup("crystal_mat", "Crystal material name (default: LYSO)",
+		             cxxopts::value<std::string>(crystalMaterial_name));
+		scatterGroup("mask_width",
+		             "Tail fitting mask width. By default, uses 1/10th of "
+		             "the histogram \'r\' dimension",
+		             cxxopts::value<int>(scatterMaskWidth));
+		scatterGroup("acf_threshold",
+		             "Tail fitting ACF threshold for the scatter tails mask "
+		             "(Default: " +
+		                 std::to_string(scatterACFThreshold) + ")",
+		             cxxopts::value<float>(scatterACFThreshold));
+		scatterGroup("scatter_downsampling",
+		             "Downsampling factor of the attenuation and source "
+		             "images for SSS (default: 1, no downsampling)",
+		             cxxopts::value<int>(scatterImageDownsampling));
+		scatterGroup("out_scatter",
+		             "Filename for the final scatter estimate histogram. "
+		             "Leave blank to not save it",
+		             cxxopts::value<std::string>(scatterOut_fname));
+
 		auto projectorGroup = options.add_options("4. Projector");
 		projectorGroup(
 		    "projector",
@@ -214,6 +266,11 @@ int main(int argc, char** argv)
 		               "Number of standard deviations to consider for TOF's "
 		               "Gaussian curve",
 		               cxxopts::value<int>(tofNumStd));
+		projectorGroup("tof_lut",
+		               "Use a tabulated TOF kernel integrated over each voxel "
+		               "segment, with the given number of samples per "
+		               "standard deviation (max. 128)",
+		               cxxopts::value<int>(tofLUTSamplesPerStd));
 
 		options.add_options()("h,help", "Print help");
 
@@ -255,6 +312,18 @@ int main(int argc, char** argv)
 		pluginOptionsResults =
 		    PluginOptionsHelper::convertPluginResultsToMap(result);
 
+		if (numScatterRounds > 0)
+		{
+			ASSERT_MSG(scatter_fname.empty(),
+			           "A scatter estimate cannot be given when the scatter "
+			           "is estimated");
+			ASSERT_MSG(!attImg_fname.empty(),
+			           "The scatter estimation needs the attenuation image");
+			ASSERT_MSG(scatterNZ > 0 && scatterNPhi > 0 && scatterNR > 0,
+			           "The scatter estimation needs \'scatter_nZ\', "
+			           "\'scatter_nPhi\' and \'scatter_nR\'");
+		}
+
 		if (sensOnly && !mustMoveSens)
 		{
 			ASSERT_MSG(
@@ -340,6 +409,10 @@ int main(int argc, char** argv)
 		{
 			osem->addImagePSF(imageSpacePsf_fname);
 		}
+		else if (!imageSpaceVarPsf_fname.empty())
+		{
+			osem->addImageVarPSF(imageSpaceVarPsf_fname);
+		}
 
 		// Projection-space PSF
 		if (!projSpacePsf_fname.empty())
@@ -434,21 +507,8 @@ int main(int argc, char** argv)
 			movedSensImage =
 			    std::make_unique<ImageOwned>(unmovedSensImage->getParams());
 			movedSensImage->allocate();
-
-			std::cout << "Moving sensitivity image..." << std::endl;
-			int64_t numFrames = dataInput->getNumFrames();
-			Util::ProgressDisplay progress{numFrames};
-			const auto scanDuration =
-			    static_cast<float>(dataInput->getScanDuration());
-			for (frame_t frame = 0; frame < numFrames; frame++)
-			{
-				progress.progress(frame);
-				transform_t transform = dataInput->getTransformOfFrame(frame);
-				const float weight =
-				    dataInput->getDurationOfFrame(frame) / scanDuration;
-				unmovedSensImage->transformImage(transform, *movedSensImage,
-				                                 weight);
-			}
+			Util::timeAverageMoveSensitivityImage(*dataInput, *unmovedSensImage,
+			                                      *movedSensImage);
 
 			if (!out_sensImg_fname.empty())
 			{
@@ -474,7 +534,7 @@ int main(int argc, char** argv)
 
 		if (tofWidth_ps > 0.f)
 		{
-			osem->addTOF(tofWidth_ps, tofNumStd);
+			osem->addTOF(tofWidth_ps, tofNumStd, tofLUTSamplesPerStd);
 		}
 
 		// Additive histograms
@@ -580,8 +640,108 @@ int main(int argc, char** argv)
 			osem->initialEstimate = initialEstimate.get();
 		}
 
-		std::cout << "Launching reconstruction..." << std::endl;
-		osem->reconstruct(out_fname);
+		if (numScatterRounds == 0)
+		{
+			std::cout << "Launching reconstruction..." << std::endl;
+			osem->reconstruct(out_fname);
+			std::cout << "Done." << std::endl;
+			return 0;
+		}
+
+		// The tail fitting is done on uncompressed histograms without TOF
+		const auto* promptsHis =
+		    dynamic_cast<const Histogram3D*>(dataInput.get());
+		ASSERT_MSG(promptsHis != nullptr,
+		           "The scatter estimation needs the input in the "
+		           "Histogram3D format");
+		const Histogram3D* randomsHis = nullptr;
+		if (randomsProjData != nullptr)
+		{
+			randomsHis = dynamic_cast<const Histogram3D*>(randomsProjData.get());
+			ASSERT_MSG(randomsHis != nullptr,
+			           "The scatter estimation needs the randoms in the "
+			           "Histogram3D format");
+		}
+		const Histogram3D* sensitivityHis = nullptr;
+		std::unique_ptr<Histogram3DOwned> invertedSensitivityHis = nullptr;
+		if (sensitivityProjData != nullptr)
+		{
+			sensitivityHis =
+			    dynamic_cast<const Histogram3D*>(sensitivityProjData.get());
+			ASSERT_MSG(sensitivityHis != nullptr,
+			           "The scatter estimation needs the sensitivity in the "
+			           "Histogram3D format");
+			if (invertSensitivity)
+			{
+				invertedSensitivityHis =
+				    std::make_unique<Histogram3DOwned>(*scanner);
+				invertedSensitivityHis->allocate();
+				invertedSensitivityHis->operationOnEachBinParallel(
+				    [sensitivityHis](bin_t bin)
+				    {
+					    const float sensitivity =
+					        sensitivityHis->getProjectionValue(bin);
+					    if (sensitivity > 1e-8)
+					    {
+						    return 1.0f / sensitivity;
+					    }
+					    return 0.0f;
+				    });
+				sensitivityHis = invertedSensitivityHis.get();
+			}
+		}
+		if (attImg == nullptr)
+		{
+			attImg = std::make_unique<ImageOwned>(attImg_fname);
+		}
+		const Histogram3D* acfHis = nullptr;
+		std::unique_ptr<Histogram3DOwned> computedAcfHis = nullptr;
+		if (acfHisProjData != nullptr)
+		{
+			acfHis = dynamic_cast<const Histogram3D*>(acfHisProjData.get());
+		}
+		if (acfHis == nullptr)
+		{
+			std::cout << "Forward projecting attenuation image for the "
+			             "scatter tails mask..."
+			          << std::endl;
+			computedAcfHis = std::make_unique<Histogram3DOwned>(*scanner);
+			computedAcfHis->allocate();
+			Util::forwProject(*scanner, *attImg, *computedAcfHis,
+			                  OperatorProjector::SIDDON);
+			Util::convertProjectionValuesToACF(*computedAcfHis);
+			acfHis = computedAcfHis.get();
+		}
+
+		// The source image is replaced by the reconstructed image before
+		// every estimation
+		Scatter::ScatterEstimator scatterEstimator{
+		    *scanner,
+		    *attImg,
+		    *attImg,
+		    promptsHis,
+		    randomsHis,
+		    acfHis,
+		    sensitivityHis,
+		    Scatter::getCrystalMaterialFromName(crystalMaterial_name),
+		    Scatter::ScatterEstimator::DefaultSeed,
+		    scatterMaskWidth,
+		    scatterACFThreshold,
+		    "",
+		    scatterImageDownsampling};
+		auto scatterHis = std::make_unique<Histogram3DOwned>(*scanner);
+		scatterHis->allocate();
+		scatterHis->clearProjections(0.0f);
+
+		std::cout << "Launching reconstruction with scatter estimation..."
+		          << std::endl;
+		Util::reconstructWithScatterEstimation(
+		    *osem, scatterEstimator, *scatterHis, numScatterRounds, scatterNZ,
+		    scatterNPhi, scatterNR, out_fname);
+		if (!scatterOut_fname.empty())
+		{
+			scatterHis->writeToFile(scatterOut_fname);
+		}
 
 		std::cout << "Done." << std::endl;
 		return 0;
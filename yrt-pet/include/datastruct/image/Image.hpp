@@ -38,9 +38,14 @@ public:
 	void updateEMThreshold(ImageBase* updateImg, const ImageBase* normImg,
 	                       float threshold) override;
 	void writeToFile(const std::string& fname) const override;
+	void writeToFileChunked(
+	    const std::string& fname,
+	    Util::ChunkCompression compression = Util::ChunkCompression::ZLIB) const;
 
 	Array3DAlias<float> getArray() const;
 
+	// Adds to dest the image moved by the transform, weighted (see
+	// ImageResampler)
 	void transformImage(const Vector3D& rotation, const Vector3D& translation,
 	                    Image& dest, float weight) const;
 	std::unique_ptr<Image> transformImage(const Vector3D& rotation,
@@ -48,6 +53,11 @@ public:
 	void transformImage(const transform_t& t, Image& dest, float weight) const;
 	std::unique_ptr<Image> transformImage(const transform_t& t) const;
 
+	// Image with the same field of view and (about) factor times fewer voxels
+	// in each dimension. Every voxel is the average of the voxels whose center
+	// it contains
+	std::unique_ptr<Image> downsample(int factor) const;
+
 	float dotProduct(const Image& y) const;
 	float nearestNeighbor(const Vector3D& pt) const;
 	float nearestNeighbor(const Vector3D& pt, int* pi, int* pj, int* pk) const;
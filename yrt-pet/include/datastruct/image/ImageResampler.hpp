@@ -0,0 +1,45 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#pragma once
+
+#include "datastruct/image/Image.hpp"
+#include "geometry/Vector3D.hpp"
+#include "utils/Types.hpp"
+
+/*
+ * Gather-based (pull) resampling of an image through an affine transform.
+ * Every voxel of the destination image fetches the source image at the
+ * position given by the inverse transform, so the destination voxels are
+ * independent: the slices are processed in parallel and the rows are
+ * vectorized. The mapping from destination to source voxel indices is
+ * precomputed once and stepped incrementally along each row.
+ * Points outside the source image give zero. Inside, the neighbours that fall
+ * outside the image are clamped to the border voxels.
+ */
+class ImageResampler
+{
+public:
+	enum InterpolationMethod
+	{
+		TRILINEAR = 0,
+		CUBIC
+	};
+
+	// dest(p) += weight * src(t^-1(p)) for every voxel p of dest. The
+	// transform maps the positions (in mm) of the source image onto the
+	// positions of the destination image. Both images can have different
+	// dimensions
+	static void resample(const Image& src, Image& dest, const transform_t& t,
+	                     float weight = 1.0f,
+	                     InterpolationMethod method = TRILINEAR);
+
+	static transform_t identity();
+	static transform_t inverse(const transform_t& t);
+	// Rotation angles (in radians) around the x, y and z axes, applied in
+	// the order x, y then z, followed by the translation
+	static transform_t fromRotationAndTranslation(const Vector3D& rotation,
+	                                              const Vector3D& translation);
+};
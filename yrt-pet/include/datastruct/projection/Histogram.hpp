@@ -15,4 +15,9 @@ public:
 	    getProjectionValueFromHistogramBin(histo_bin_t histoBinId) const = 0;
 protected:
 	explicit Histogram(const Scanner& pr_scanner);
+
+	// Detector pair of a histogram bin given as a detector pair, with or
+	// without a TOF bin. Histograms without TOF bins give the value of the
+	// whole LOR for a TOF bin
+	static det_pair_t getDetPairFromHistogramBin(histo_bin_t histoBinId);
 };
@@ -11,6 +11,8 @@
 #include "utils/Array.hpp"
 
 #include <array>
+#include <functional>
+#include <memory>
 #include <vector>
 
 struct HashDetPair
@@ -37,9 +39,15 @@ typedef std::array<coord_t, 2> DetRingCoordinates;  // r, phi
 class Histogram3D : public Histogram
 {
 public:
-	Array3DBase<float>& getData() { return *mp_data; }
-	const Array3DBase<float>& getData() const { return *mp_data; }
+	// Raw float array of the histogram. Only valid if isMemoryValid(), the
+	// storage variants that hold no float array throw instead
+	virtual Array3DBase<float>& getData();
+	virtual const Array3DBase<float>& getData() const;
 	virtual void writeToFile(const std::string& filename) const;
+	// One chunk per z_bin (see ChunkedFile.hpp)
+	void writeToFileChunked(
+	    const std::string& filename,
+	    Util::ChunkCompression compression = Util::ChunkCompression::ZLIB) const;
 	~Histogram3D() override = 0;
 
 	// binId
@@ -64,6 +72,8 @@ public:
 	det_id_t getDetector1(bin_t id) const override;
 	det_id_t getDetector2(bin_t id) const override;
 	det_pair_t getDetectorPair(bin_t id) const override;
+	void getDetectorPairs(const bin_t* bins, size_t numBins,
+	                      det_pair_t* detPairs) const override;
 	void clearProjections();
 	void clearProjections(float value) override;
 	std::unique_ptr<BinIterator> getBinIter(int numSubsets,
@@ -85,6 +95,15 @@ protected:
 	                              coord_t& r_ring, coord_t& phi) const;
 	// Sets up the LUT for reverse compute
 	void setupHistogram();
+	// Stream a histogram file one z_bin slice at a time. Used by the
+	// storage variants that do not hold a full float array in memory
+	void readFromFileBySlice(
+	    const std::string& filename,
+	    const std::function<void(coord_t z_bin, const float* slice)>& func)
+	    const;
+	void writeToFileBySlice(
+	    const std::string& filename,
+	    const std::function<void(coord_t z_bin, float* slice)>& func) const;
 
 public:
 	size_t numR, numPhi, numZBin;
@@ -131,3 +150,15 @@ public:
 	           const Plugin::OptionsResult& pluginOptions);
 	static Plugin::OptionsListPerPlugin getOptions();
 };
+
+// Histogram3D used in place from an uncompressed chunked file (see
+// ChunkedFile.hpp), which is memory-mapped instead of being read. The mapping
+// is copy-on-write: bins can be modified in memory, never in the file
+class Histogram3DMapped : public Histogram3D
+{
+public:
+	Histogram3DMapped(const Scanner& pr_scanner, const std::string& filename);
+
+private:
+	std::unique_ptr<Util::ChunkedFileMapping> mp_mapping;
+};
@@ -0,0 +1,65 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#pragma once
+
+#include "datastruct/projection/Histogram3D.hpp"
+
+#include <cstdint>
+
+/*
+ * Histogram3D stored in 16-bit floating point (half the memory of
+ * Histogram3DOwned). Values are converted to and from float on access, so
+ * this class can be used anywhere a Histogram3D is read or written bin-wise.
+ * Since no float array is held, getData() throws and isMemoryValid() is
+ * false on this object.
+ * Files are read and written in the usual (float) histogram format.
+ */
+class Histogram3DHalf : public Histogram3D
+{
+public:
+	enum class Encoding
+	{
+		FP16,  // IEEE binary16, more precision, max value 65504
+		BF16   // bfloat16, same dynamic range as float, less precision
+	};
+
+	explicit Histogram3DHalf(const Scanner& pr_scanner,
+	                         Encoding p_encoding = Encoding::FP16);
+	Histogram3DHalf(const Scanner& pr_scanner, const std::string& filename,
+	                Encoding p_encoding = Encoding::FP16);
+	// Converts an existing histogram
+	Histogram3DHalf(const Histogram3D& pr_source,
+	                Encoding p_encoding = Encoding::FP16);
+
+	void allocate();
+	void readFromFile(const std::string& filename);
+	void writeToFile(const std::string& filename) const override;
+	// No float array is held, use getEncodedData instead
+	Array3DBase<float>& getData() override;
+	const Array3DBase<float>& getData() const override;
+
+	float getProjectionValue(bin_t binId) const override;
+	void setProjectionValue(bin_t binId, float val) override;
+	void incrementProjection(bin_t binId, float val) override;
+	void clearProjections(float value) override;
+
+	Encoding getEncoding() const;
+	Array3DBase<uint16_t>& getEncodedData();
+	const Array3DBase<uint16_t>& getEncodedData() const;
+
+	// For registering the plugin
+	static std::unique_ptr<ProjectionData>
+	    create(const Scanner& scanner, const std::string& filename,
+	           const Plugin::OptionsResult& pluginOptions);
+	static Plugin::OptionsListPerPlugin getOptions();
+
+private:
+	uint16_t encode(float val) const;
+	float decode(uint16_t val) const;
+
+	Encoding m_encoding;
+	Array3D<uint16_t> m_encodedData;
+};
@@ -0,0 +1,68 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#pragma once
+
+#include "datastruct/projection/Histogram3D.hpp"
+
+#include <memory>
+#include <vector>
+
+/*
+ * Histogram3D where most bins share a common default value (ex: an ACF
+ * histogram where all LORs outside the patient are 1). The bins are grouped
+ * in fixed-size blocks and a block is only allocated when one of its bins
+ * takes a value other than the default. Since no float array is held,
+ * getData() throws and isMemoryValid() is false on this object.
+ * Note: setProjectionValue is not thread-safe for two bins of the same block,
+ * use operationOnEachBinParallel for parallel filling.
+ */
+class Histogram3DSparseDefault : public Histogram3D
+{
+public:
+	static constexpr size_t BlockSize = 256;
+
+	explicit Histogram3DSparseDefault(const Scanner& pr_scanner,
+	                                  float p_defaultValue = 1.0f);
+	Histogram3DSparseDefault(const Scanner& pr_scanner,
+	                         const std::string& filename,
+	                         float p_defaultValue = 1.0f);
+	// Converts an existing histogram
+	Histogram3DSparseDefault(const Histogram3D& pr_source,
+	                         float p_defaultValue = 1.0f);
+
+	void readFromFile(const std::string& filename);
+	void writeToFile(const std::string& filename) const override;
+	// No float array is held, these throw
+	Array3DBase<float>& getData() override;
+	const Array3DBase<float>& getData() const override;
+
+	float getProjectionValue(bin_t binId) const override;
+	void setProjectionValue(bin_t binId, float val) override;
+	void incrementProjection(bin_t binId, float val) override;
+	void clearProjections(float value) override;
+	void operationOnEachBinParallel(
+	    const std::function<float(bin_t)>& func) override;
+
+	// Release the blocks in which all the bins are back to the default value
+	void compact();
+
+	float getDefaultValue() const;
+	size_t getNumBlocks() const;
+	size_t getNumAllocatedBlocks() const;
+
+	// For registering the plugin
+	static std::unique_ptr<ProjectionData>
+	    create(const Scanner& scanner, const std::string& filename,
+	           const Plugin::OptionsResult& pluginOptions);
+	static Plugin::OptionsListPerPlugin getOptions();
+
+private:
+	float* allocateBlock(size_t blockId);
+	void fillBlock(size_t blockId, const float* values);
+
+	float m_defaultValue;
+	std::vector<std::unique_ptr<float[]>> m_blocks;
+};
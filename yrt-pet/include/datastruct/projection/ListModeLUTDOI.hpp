@@ -24,6 +24,14 @@ public:
 	bool hasArbitraryLORs() const override;
 	Line3D getArbitraryLOR(bin_t id) const override;
 	void writeToFile(const std::string& listMode_fname) const override;
+	// Without TOF nor motion, events between the same detectors and in the
+	// same crystal layers share their LOR
+	bool hasDuplicateLORs() const override;
+	uint64_t getLORKey(bin_t id) const override;
+
+	int getNumLayers() const;
+	// Crystal layer of a DOI value
+	int getLayer(unsigned char doi) const;
 
 protected:
 	explicit ListModeLUTDOI(const Scanner& pr_scanner, bool p_flagTOF = false,
@@ -32,6 +40,14 @@ protected:
 	std::unique_ptr<Array1DBase<unsigned char>> mp_doi2;
 
 	int m_numLayers;
+
+private:
+	static constexpr int NumDOIValues = 1 << 8;
+	// Per DOI value, its crystal layer and the signed distance from the
+	// center of the crystal to the front edge of the layer (the edge with
+	// the lowest depth) along the detector orientation
+	unsigned char m_layerOfDOI[NumDOIValues];
+	float m_depthOfDOI[NumDOIValues];
 };
 
 class ListModeLUTDOIAlias : public ListModeLUTDOI
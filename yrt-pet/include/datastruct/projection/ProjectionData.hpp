@@ -11,8 +11,10 @@
 #include "utils/Types.hpp"
 #include "geometry/Line3D.hpp"
 
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <vector>
 
 struct ProjectionProperties
 {
@@ -20,6 +22,36 @@ struct ProjectionProperties
 	float tofValue;
 	Vector3D det1Orient;
 	Vector3D det2Orient;
+	// Projection-space PSF kernel of the LOR if already looked up (see
+	// ProjectionPsfManager::getKernels)
+	const float* psfKernel = nullptr;
+};
+
+// Properties of a block of bins in structure-of-arrays layout (see
+// ProjectionData::getProjectionProperties). Meant to be reused from one block
+// to the next to avoid reallocations
+struct ProjectionPropertiesBatch
+{
+	void resize(size_t size);
+	size_t size() const { return tofValue.size(); }
+	ProjectionProperties get(size_t i) const
+	{
+		return {Line3D{{x1[i], y1[i], z1[i]}, {x2[i], y2[i], z2[i]}},
+		        tofValue[i],
+		        {orient1x[i], orient1y[i], orient1z[i]},
+		        {orient2x[i], orient2y[i], orient2z[i]},
+		        psfKernel.empty() ? nullptr : psfKernel[i]};
+	}
+
+	std::vector<float> x1, y1, z1, x2, y2, z2;
+	std::vector<float> tofValue;
+	std::vector<float> orient1x, orient1y, orient1z;
+	std::vector<float> orient2x, orient2y, orient2z;
+	// Left empty unless filled by ProjectionPsfManager::getKernels
+	std::vector<const float*> psfKernel;
+	// Scratch space for ProjectionData::getProjectionProperties
+	std::vector<det_pair_t> detPairs;
+	std::vector<frame_t> frames;
 };
 
 class ProjectionData : public Variable
@@ -47,6 +79,12 @@ public:
 	// Time-of-flight
 	virtual bool hasTOF() const;
 	virtual float getTOFValue(bin_t id) const;
+	// For data binned in TOF (ex: TOF histograms). The TOF bins are centered
+	// on zero and given in increasing order of TOF. The bins of a LOR have
+	// consecutive ids and the bin iterators give them consecutively
+	virtual bool hasTOFBins() const;
+	virtual size_t getNumTOFBins() const;
+	virtual float getTOFBinWidth() const;  // In picoseconds
 	// For motion correction
 	virtual bool hasMotion() const;
 	virtual size_t getNumFrames() const;
@@ -56,9 +94,39 @@ public:
 	// Special case when the LOR is not defined directly from the scanner's LUT
 	virtual bool hasArbitraryLORs() const;
 	virtual Line3D getArbitraryLOR(bin_t id) const;
+	// For bins that group several LORs (ex: axially-compressed histograms).
+	// The value of such a bin is modeled as the weighted sum over its LORs
+	virtual bool hasLORBundles() const;
+	virtual size_t getNumLORsInBin(bin_t bin) const;
+	virtual det_pair_t getDetectorPairInBin(bin_t bin, size_t lorIdx) const;
+	virtual float getWeightOfLORInBin(bin_t bin, size_t lorIdx) const;
+	// True when every LOR lies in a transaxial plane (ex: rebinned 2D
+	// sinograms), so that the image can be projected slice by slice
+	virtual bool hasTransaxialLORs() const;
+	// True when several bins can have the same LOR (ex: list-mode events
+	// between the same detectors). Bins with the same LOR key have the same
+	// projection properties, so their LOR only needs to be projected once
+	virtual bool hasDuplicateLORs() const;
+	virtual uint64_t getLORKey(bin_t bin) const;
+	// Block versions of getDetectorPair, getTOFValue and getFrame, so that a
+	// block of bins costs one virtual call. Default to the per-bin functions
+	virtual void getDetectorPairs(const bin_t* bins, size_t numBins,
+	                              det_pair_t* detPairs) const;
+	virtual void getTOFValues(const bin_t* bins, size_t numBins,
+	                          float* tofValues) const;
+	virtual void getFrames(const bin_t* bins, size_t numBins,
+	                       frame_t* frames) const;
 
 	// Helper functions
 	virtual ProjectionProperties getProjectionProperties(bin_t bin) const;
+	// Properties of a block of bins. The detector positions come from the
+	// scanner's detector table and the motion transforms are only computed
+	// once per frame, so it is cheaper than a call per bin
+	virtual void
+	    getProjectionProperties(const bin_t* bins, size_t numBins,
+	                            ProjectionPropertiesBatch& properties) const;
+	ProjectionProperties getProjectionPropertiesInBin(bin_t bin,
+	                                                  size_t lorIdx) const;
 	Line3D getLOR(bin_t bin) const;
 	virtual void clearProjections(float value);
 	virtual void divideMeasurements(const ProjectionData* measurements,
@@ -74,6 +142,7 @@ public:
 
 protected:
 	explicit ProjectionData(const Scanner& pr_scanner);
+	void applyMotionToLOR(bin_t bin, Line3D& lor) const;
 
 	const Scanner& mr_scanner;
 };
@@ -38,10 +38,24 @@ public:
 	float getRandomsEstimate(bin_t id) const override;
 	bool hasTOF() const override;
 	float getTOFValue(bin_t id) const override;
+	bool hasTOFBins() const override;
+	size_t getNumTOFBins() const override;
+	float getTOFBinWidth() const override;
 	bool hasMotion() const override;
 	transform_t getTransformOfFrame(frame_t frame) const override;
 	bool hasArbitraryLORs() const override;
 	Line3D getArbitraryLOR(bin_t id) const override;
+	bool hasLORBundles() const override;
+	size_t getNumLORsInBin(bin_t bin) const override;
+	det_pair_t getDetectorPairInBin(bin_t bin, size_t lorIdx) const override;
+	float getWeightOfLORInBin(bin_t bin, size_t lorIdx) const override;
+	bool hasTransaxialLORs() const override;
+	bool hasDuplicateLORs() const override;
+	uint64_t getLORKey(bin_t bin) const override;
+	ProjectionProperties getProjectionProperties(bin_t bin) const override;
+	void getProjectionProperties(
+	    const bin_t* bins, size_t numBins,
+	    ProjectionPropertiesBatch& properties) const override;
 
 	const ProjectionData* getReference() const;
 	float* getRawPointer() const;
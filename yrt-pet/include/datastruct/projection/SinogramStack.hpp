@@ -0,0 +1,134 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#pragma once
+
+#include "datastruct/PluginFramework.hpp"
+#include "datastruct/projection/Histogram.hpp"
+#include "datastruct/projection/Histogram3D.hpp"
+#include "utils/Array.hpp"
+
+#include <memory>
+#include <vector>
+
+/*
+ * Stack of 2D sinograms obtained by rebinning 3D data. There is one sinogram
+ * per direct plane (ring pair z, z) and per cross plane (ring pair z, z+1),
+ * ordered by axial position, so 2*numRings-1 slices spaced by half a ring.
+ * The r and phi dimensions are the same as in Histogram3D.
+ * The LORs of a sinogram lie in the transaxial plane of its slice, which lets
+ * the projectors process the image slice by slice (see
+ * ProjectionData::hasTransaxialLORs).
+ *
+ * Rebinning methods:
+ * - Single-slice rebinning (SSRB): every oblique LOR is assigned to the slice
+ *   of its axial midpoint. Works from any projection data (histogram or
+ *   list-mode). The slices are then divided by the number of ring pairs
+ *   that can be rebinned in them, so that a value approximates the line
+ *   integral of a single LOR.
+ * - Fourier rebinning (FORE): oblique sinograms are rebinned in the 2D
+ *   Fourier domain using the frequency-distance relation, which moves
+ *   off-center activity to the right slice. The sinograms are interpolated
+ *   on a uniform (s, theta) grid for the transforms and back.
+ */
+class SinogramStack : public Histogram
+{
+public:
+	~SinogramStack() override = 0;
+
+	Array3DBase<float>& getData() { return *mp_data; }
+	const Array3DBase<float>& getData() const { return *mp_data; }
+	void writeToFile(const std::string& filename) const;
+
+	int getMaxRingDiff() const;
+	float getSlicePosition(coord_t slice) const;
+	// Number of ring pairs (z1, z2) with z1+z2 = slice within the maximum
+	// ring difference
+	size_t getNumRingPairsInSlice(coord_t slice) const;
+
+	bin_t getBinIdFromCoords(coord_t r, coord_t phi, coord_t slice) const;
+	void getCoordsFromBinId(bin_t binId, coord_t& r, coord_t& phi,
+	                        coord_t& slice) const;
+	// Bin in which the LOR of the detector pair is rebinned (SSRB)
+	bin_t getBinIdFromDetPair(det_id_t d1, det_id_t d2) const;
+	bool isDetPairInRingDiffRange(det_id_t d1, det_id_t d2) const;
+
+	// Mandatory functions
+	size_t count() const override;
+	float getProjectionValue(bin_t binId) const override;
+	void setProjectionValue(bin_t binId, float val) override;
+	void incrementProjection(bin_t binId, float val);
+	// The detectors of a direct plane are in the same ring, those of a cross
+	// plane in adjacent rings
+	det_id_t getDetector1(bin_t id) const override;
+	det_id_t getDetector2(bin_t id) const override;
+	det_pair_t getDetectorPair(bin_t id) const override;
+	std::unique_ptr<BinIterator> getBinIter(int numSubsets,
+	                                        int idxSubset) const override;
+	void clearProjections(float value) override;
+	float getProjectionValueFromHistogramBin(
+	    histo_bin_t histoBinId) const override;
+
+	// LORs in the transaxial plane of each slice
+	bool hasArbitraryLORs() const override;
+	Line3D getArbitraryLOR(bin_t id) const override;
+	bool hasTransaxialLORs() const override;
+
+	// Rebinning
+	void rebinSSRB(const ProjectionData& projData,
+	               const BinIterator* binIter = nullptr);
+	// Frequencies below the limits (in number of samples) are rebinned with
+	// SSRB, where the frequency-distance relation is not accurate
+	void rebinFORE(const Histogram3D& histo3d, int kLimit = 2,
+	               int omegaLimit = 2);
+
+	bool isMemoryValid() const;
+
+protected:
+	SinogramStack(const Scanner& pr_scanner, int p_maxRingDiff);
+
+private:
+	void rebinSSRBHistogram3D(const Histogram3D& histo3d);
+	void normalizeSSRB();
+
+public:
+	size_t numR, numPhi, numSlices;
+	size_t histoSize;
+
+protected:
+	std::unique_ptr<Array3DBase<float>> mp_data;
+	// Never bound, only used for the (r, phi) and ring pair mappings
+	std::unique_ptr<Histogram3DAlias> mp_histo3d;
+	int m_maxRingDiff;
+	std::vector<float> m_slicePositions;
+	std::vector<size_t> m_numRingPairsInSlice;
+};
+
+class SinogramStackAlias : public SinogramStack
+{
+public:
+	// A negative maximum ring difference uses the scanner's
+	explicit SinogramStackAlias(const Scanner& pr_scanner,
+	                            int p_maxRingDiff = -1);
+	void bind(Array3DBase<float>& pr_data);
+};
+
+class SinogramStackOwned : public SinogramStack
+{
+public:
+	// A negative maximum ring difference uses the scanner's
+	explicit SinogramStackOwned(const Scanner& pr_scanner,
+	                            int p_maxRingDiff = -1);
+	SinogramStackOwned(const Scanner& pr_scanner, const std::string& filename,
+	                   int p_maxRingDiff = -1);
+	void allocate();
+	void readFromFile(const std::string& filename);
+
+	// For registering the plugin
+	static std::unique_ptr<ProjectionData>
+	    create(const Scanner& scanner, const std::string& filename,
+	           const Plugin::OptionsResult& pluginOptions);
+	static Plugin::OptionsListPerPlugin getOptions();
+};
@@ -0,0 +1,125 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#pragma once
+
+#include "datastruct/PluginFramework.hpp"
+#include "datastruct/projection/Histogram.hpp"
+#include "datastruct/projection/Histogram3D.hpp"
+#include "utils/Array.hpp"
+
+#include <memory>
+#include <vector>
+
+/*
+ * Axially-compressed ("mashed") histogram. The oblique planes of a
+ * Histogram3D are grouped into segments of "span" consecutive ring
+ * differences, and the ring pairs of a segment that share the same axial
+ * position (z1 + z2) are summed into the same z_bin. The r and phi
+ * dimensions are the same as in Histogram3D.
+ * Segments are ordered 0, +1, -1, +2, -2, ... and, within a segment, by axial
+ * position. A span of 1 keeps every ring pair separate.
+ * Each bin is a bundle of LORs, one per ring pair summed in it.
+ */
+class SpanHistogram : public Histogram
+{
+public:
+	~SpanHistogram() override = 0;
+
+	Array3DBase<float>& getData() { return *mp_data; }
+	const Array3DBase<float>& getData() const { return *mp_data; }
+	void writeToFile(const std::string& filename) const;
+
+	int getSpan() const;
+	int getNumSegments() const;  // Including the negative segments
+	int getSegmentOfZBin(coord_t z_bin) const;
+	// Number of ring pairs summed in the z_bin
+	size_t getNumRingPairsInZBin(coord_t z_bin) const;
+	void getZ1Z2(coord_t z_bin, size_t ringPairIdx, coord_t& z1,
+	             coord_t& z2) const;
+
+	bin_t getBinIdFromCoords(coord_t r, coord_t phi, coord_t z_bin) const;
+	void getCoordsFromBinId(bin_t binId, coord_t& r, coord_t& phi,
+	                        coord_t& z_bin) const;
+	bin_t getBinIdFromDetPair(det_id_t d1, det_id_t d2) const;
+	// Bin of the compressed histogram in which a Histogram3D bin is summed
+	bin_t getBinIdFromHistogram3DBinId(bin_t histo3dBinId) const;
+
+	// Mandatory functions
+	size_t count() const override;
+	float getProjectionValue(bin_t binId) const override;
+	void setProjectionValue(bin_t binId, float val) override;
+	void incrementProjection(bin_t binId, float val);
+	// The detectors of a bin are those of its first LOR
+	det_id_t getDetector1(bin_t id) const override;
+	det_id_t getDetector2(bin_t id) const override;
+	det_pair_t getDetectorPair(bin_t id) const override;
+	std::unique_ptr<BinIterator> getBinIter(int numSubsets,
+	                                        int idxSubset) const override;
+	void clearProjections(float value) override;
+	// Detector pairs and Histogram3D bins are single LORs, which get the
+	// value of their bin divided by its number of LORs. This is exact for a
+	// mashed ACF or sensitivity histogram if it is uniform in the bundle,
+	// and distributes mashed randoms or scatter evenly between the LORs
+	float getProjectionValueFromHistogramBin(
+	    histo_bin_t histoBinId) const override;
+
+	// LOR bundles
+	bool hasLORBundles() const override;
+	size_t getNumLORsInBin(bin_t bin) const override;
+	det_pair_t getDetectorPairInBin(bin_t bin, size_t lorIdx) const override;
+
+	// Mashing of uncompressed data
+	void mashHistogram3D(const Histogram3D& histo3d);
+	void accumulate(const ProjectionData& projData,
+	                const BinIterator* binIter = nullptr);
+
+	bool isMemoryValid() const;
+
+protected:
+	SpanHistogram(const Scanner& pr_scanner, int p_span);
+
+public:
+	size_t numR, numPhi, numZBin;
+	size_t histoSize;
+
+protected:
+	std::unique_ptr<Array3DBase<float>> mp_data;
+	// Never bound, only used for the (r, phi) and ring pair mappings
+	std::unique_ptr<Histogram3DAlias> mp_histo3d;
+	int m_span;
+	int m_numSegments;
+	std::vector<int> m_segmentOfZBin;
+	// z_bin of the compressed histogram for every z_bin of the Histogram3D
+	std::vector<coord_t> m_zBinFromHisto3DZBin;
+	// Histogram3D z_bins summed in each z_bin (compressed row storage)
+	std::vector<size_t> m_histo3DZBinsOffsets;
+	std::vector<coord_t> m_histo3DZBins;
+};
+
+class SpanHistogramAlias : public SpanHistogram
+{
+public:
+	SpanHistogramAlias(const Scanner& pr_scanner, int p_span);
+	void bind(Array3DBase<float>& pr_data);
+};
+
+class SpanHistogramOwned : public SpanHistogram
+{
+public:
+	SpanHistogramOwned(const Scanner& pr_scanner, int p_span);
+	SpanHistogramOwned(const Scanner& pr_scanner, const std::string& filename,
+	                   int p_span);
+	// Mashes the given histogram
+	SpanHistogramOwned(const Histogram3D& pr_histo3d, int p_span);
+	void allocate();
+	void readFromFile(const std::string& filename);
+
+	// For registering the plugin
+	static std::unique_ptr<ProjectionData>
+	    create(const Scanner& scanner, const std::string& filename,
+	           const Plugin::OptionsResult& pluginOptions);
+	static Plugin::OptionsListPerPlugin getOptions();
+};
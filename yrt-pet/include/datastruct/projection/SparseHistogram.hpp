@@ -8,6 +8,7 @@
 #include "datastruct/PluginFramework.hpp"
 #include "datastruct/projection/Histogram.hpp"
 #include "datastruct/scanner/Scanner.hpp"
+#include "utils/ChunkedFile.hpp"
 
 #include <unordered_map>
 
@@ -44,6 +45,11 @@ public:
 	    histo_bin_t histoBinId) const override;
 
 	void writeToFile(const std::string& filename) const;
+	// Chunked (and optionally compressed) format, see ChunkedFile.hpp. Each
+	// slab is an event (d1, d2, value). Detected by readFromFile
+	void writeToFileChunked(
+	    const std::string& filename,
+	    Util::ChunkCompression compression = Util::ChunkCompression::ZLIB) const;
 	void readFromFile(const std::string& filename);
 
 	float* getProjectionValuesBuffer();
@@ -57,6 +63,11 @@ public:
 	static Plugin::OptionsListPerPlugin getOptions();
 
 private:
+	static constexpr size_t EventsPerChunk = 1 << 16;
+	static constexpr int NumFieldsPerEvent = 3;
+
+	void readFromChunkedFile(const std::string& filename);
+
 	// Comparator for std::unordered_map
 	struct det_pair_hash
 	{
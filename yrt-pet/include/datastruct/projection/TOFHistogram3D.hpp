@@ -0,0 +1,122 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#pragma once
+
+#include "datastruct/PluginFramework.hpp"
+#include "datastruct/projection/Histogram.hpp"
+#include "datastruct/projection/Histogram3D.hpp"
+#include "utils/Array.hpp"
+
+#include <memory>
+
+/*
+ * Histogram3D with an extra time-of-flight dimension. Every LOR of the
+ * Histogram3D is split into numTOFBins bins of tofBinWidth picoseconds,
+ * centered on zero and ordered by increasing TOF (the TOF value is positive
+ * when the annihilation is closer to the second detector of the LOR).
+ * The data is stored as [Histogram3D bin][TOF bin], so the TOF bins of a LOR
+ * are contiguous and the bin iterators give them consecutively. This lets
+ * the projectors serve all the TOF bins of a LOR with a single traversal.
+ */
+class TOFHistogram3D : public Histogram
+{
+public:
+	~TOFHistogram3D() override = 0;
+
+	Array2DBase<float>& getData() { return *mp_data; }
+	const Array2DBase<float>& getData() const { return *mp_data; }
+	void writeToFile(const std::string& filename) const;
+
+	// TOF bins
+	float getTOFBinCenter(coord_t tofBin) const;  // In picoseconds
+	// TOF bin in which the given TOF value falls, -1 if out of range
+	int getTOFBinFromValue(float tofValue_ps) const;
+	const Histogram3D& getHistogram3D() const;
+
+	bin_t getBinIdFromCoords(coord_t r, coord_t phi, coord_t z_bin,
+	                         coord_t tofBin) const;
+	void getCoordsFromBinId(bin_t binId, coord_t& r, coord_t& phi,
+	                        coord_t& z_bin, coord_t& tofBin) const;
+	bin_t getBinIdFromHistogram3DBinId(bin_t histo3dBinId,
+	                                   coord_t tofBin) const;
+	bin_t getHistogram3DBinId(bin_t binId) const;
+	// Bin of an event between the given detectors. The TOF value is flipped
+	// if the detectors are in the opposite order of the histogram's LOR.
+	// Returns false if the TOF value is out of the range of the histogram
+	bool getBinIdFromEvent(det_id_t d1, det_id_t d2, float tofValue_ps,
+	                       bin_t& binId) const;
+
+	// Mandatory functions
+	size_t count() const override;
+	float getProjectionValue(bin_t binId) const override;
+	void setProjectionValue(bin_t binId, float val) override;
+	void incrementProjection(bin_t binId, float val);
+	det_id_t getDetector1(bin_t id) const override;
+	det_id_t getDetector2(bin_t id) const override;
+	det_pair_t getDetectorPair(bin_t id) const override;
+	// The detector pair with the TOF bin, so that the corrections are looked
+	// up per TOF bin
+	histo_bin_t getHistogramBin(bin_t bin) const override;
+	std::unique_ptr<BinIterator> getBinIter(int numSubsets,
+	                                        int idxSubset) const override;
+	void clearProjections(float value) override;
+	// Detector pairs and Histogram3D bins (as given by the non-TOF
+	// measurements) give the sum over the TOF bins of their LOR. Detector
+	// pairs with a TOF bin give the value of that TOF bin
+	float getProjectionValueFromHistogramBin(
+	    histo_bin_t histoBinId) const override;
+
+	// Time-of-flight
+	bool hasTOF() const override;
+	float getTOFValue(bin_t id) const override;
+	bool hasTOFBins() const override;
+	size_t getNumTOFBins() const override;
+	float getTOFBinWidth() const override;
+
+	// Sum over the TOF bins
+	void collapseToHistogram3D(Histogram3D& histo3d) const;
+
+	bool isMemoryValid() const;
+
+protected:
+	TOFHistogram3D(const Scanner& pr_scanner, size_t p_numTOFBins,
+	               float p_tofBinWidth_ps);
+
+public:
+	size_t numR, numPhi, numZBin, numTOFBins;
+	size_t histoSize;
+
+protected:
+	std::unique_ptr<Array2DBase<float>> mp_data;
+	// Never bound, only used for the (r, phi, z_bin) mappings
+	std::unique_ptr<Histogram3DAlias> mp_histo3d;
+	float m_tofBinWidth_ps;
+};
+
+class TOFHistogram3DAlias : public TOFHistogram3D
+{
+public:
+	TOFHistogram3DAlias(const Scanner& pr_scanner, size_t p_numTOFBins,
+	                    float p_tofBinWidth_ps);
+	void bind(Array2DBase<float>& pr_data);
+};
+
+class TOFHistogram3DOwned : public TOFHistogram3D
+{
+public:
+	TOFHistogram3DOwned(const Scanner& pr_scanner, size_t p_numTOFBins,
+	                    float p_tofBinWidth_ps);
+	TOFHistogram3DOwned(const Scanner& pr_scanner, const std::string& filename,
+	                    size_t p_numTOFBins, float p_tofBinWidth_ps);
+	void allocate();
+	void readFromFile(const std::string& filename);
+
+	// For registering the plugin
+	static std::unique_ptr<ProjectionData>
+	    create(const Scanner& scanner, const std::string& filename,
+	           const Plugin::OptionsResult& pluginOptions);
+	static Plugin::OptionsListPerPlugin getOptions();
+};
@@ -0,0 +1,65 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#pragma once
+
+#include "geometry/Vector3D.hpp"
+#include "utils/Types.hpp"
+
+#include <memory>
+#include <new>
+
+class DetectorSetup;
+
+/*
+ * Flattened copy of the positions and orientations of the detectors, in
+ * structure-of-arrays layout. The lookups are not virtual (unlike
+ * DetectorSetup), so that they can be done for whole blocks of LORs in tight
+ * loops. Every array starts on a 64-byte boundary.
+ * The table is a snapshot: it has to be rebuilt if the detector setup it was
+ * built from is modified (see Scanner::updateDetectorTable).
+ */
+class DetectorTable
+{
+public:
+	static constexpr size_t Alignment = 64;
+
+	explicit DetectorTable(const DetectorSetup& pr_detectors);
+
+	size_t getNumDets() const { return m_numDets; }
+
+	const float* getXpos() const { return mp_data.get(); }
+	const float* getYpos() const { return mp_data.get() + m_stride; }
+	const float* getZpos() const { return mp_data.get() + 2 * m_stride; }
+	const float* getXorient() const { return mp_data.get() + 3 * m_stride; }
+	const float* getYorient() const { return mp_data.get() + 4 * m_stride; }
+	const float* getZorient() const { return mp_data.get() + 5 * m_stride; }
+
+	Vector3D getPos(det_id_t id) const
+	{
+		const float* data = mp_data.get();
+		return {data[id], data[m_stride + id], data[2 * m_stride + id]};
+	}
+	Vector3D getOrient(det_id_t id) const
+	{
+		const float* data = mp_data.get();
+		return {data[3 * m_stride + id], data[4 * m_stride + id],
+		        data[5 * m_stride + id]};
+	}
+
+private:
+	struct AlignedDeleter
+	{
+		void operator()(float* ptr) const
+		{
+			::operator delete[](ptr, std::align_val_t{Alignment});
+		}
+	};
+
+	size_t m_numDets;
+	// Number of floats between two arrays, padded to keep the alignment
+	size_t m_stride;
+	std::unique_ptr<float[], AlignedDeleter> mp_data;
+};
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "datastruct/scanner/DetCoord.hpp"
+#include "datastruct/scanner/DetectorTable.hpp"
 #include "geometry/Vector3D.hpp"
 
 #include <filesystem>
@@ -32,6 +33,10 @@ public:
 	Vector3D getDetectorPos(det_id_t id) const;
 	Vector3D getDetectorOrient(det_id_t id) const;
 	std::shared_ptr<DetectorSetup> getDetectorSetup() const;
+	// Non-virtual copy of the detector setup, for the batched LOR lookups
+	const DetectorTable& getDetectorTable() const;
+	// To call if the detector setup is modified after being set
+	void updateDetectorTable();
 	bool isValid() const;
 
 	// Allocate and fill array with detector positions
@@ -55,4 +60,5 @@ public:
 protected:
 	fs::path m_scannerPath;
 	std::shared_ptr<DetectorSetup> mp_detectors;
+	std::shared_ptr<const DetectorTable> mp_detectorTable;
 };
@@ -7,25 +7,50 @@
 
 #include "geometry/Line3D.hpp"
 
+#include <vector>
+
 class Scanner;
 
 class MultiRayGenerator
 {
 public:
+	// Rays between points of the crystals' volumes: thickness_z and
+	// thickness_trans are the dimensions of the crystals' faces, depth is
+	// their length along the detector orientation (0 to sample the faces
+	// only)
 	MultiRayGenerator(float thickness_z_i, float thickness_trans_i,
-	                  bool isParallel_i = false);
+	                  bool isParallel_i = false, float depth_i = 0.0f);
 	Line3D getRandomLine(unsigned int& seed) const;
 	void setupGenerator(const Line3D& lor, const Vector3D& n1,
 	                    const Vector3D& n2);
 
+	// Deterministic rays, stratified over the volume of both crystals. The
+	// offsets of every ray within the crystals come from a (centered) Sobol
+	// sequence and are computed once, so all the LORs use the same ones
+	void setupStratifiedOffsets(int numRays);
+	int getNumStratifiedRays() const;
+	Line3D getStratifiedLine(int rayIdx) const;
+
+	// Point of the Sobol sequence in [0, 1)^numDims, for at most MaxSobolDims
+	// dimensions
+	static constexpr int MaxSobolDims = 6;
+	static void getSobolPoint(unsigned int index, int numDims, float* point);
+
 protected:
-	float thickness_z, thickness_trans;
+	float thickness_z, thickness_trans, depth;
 	bool isSingleRay;
 	bool isParallel;
 
 private:
+	Line3D getLineFromOffsets(const float* offsets1,
+	                          const float* offsets2) const;
+
 	Vector3D vect_parrallel_to_z;
 	Vector3D vect_parrallel_to_trans1;
 	Vector3D vect_parrallel_to_trans2;
+	Vector3D vect_depth1;
+	Vector3D vect_depth2;
 	const Line3D* currentLor;
+	// Per ray: (z, trans, depth) offsets for both crystals, in [-0.5, 0.5)
+	std::vector<float> m_stratifiedOffsets;
 };
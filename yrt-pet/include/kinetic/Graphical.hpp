@@ -0,0 +1,29 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#pragma once
+
+#include "kinetic/InputFunction.hpp"
+
+#include <cstddef>
+
+// Graphical analyses, for every pixel, of time-activity curves sampled at the
+// times of the input function. The linear regressions only use the frames
+// from start_frame onwards, weighted by W (uniform weights if W is null)
+
+// Patlak plot of irreversible tracers. kin_out has shape [2, X]: the influx
+// rate constant Ki (slope) and the intercept V
+template <typename T>
+void solvePatlak(const T* tac_all, T* kin_out, const InputFunction<T>& input,
+                 const T* W, const int start_frame, const size_t num_pix,
+                 const int num_threads);
+
+// Logan plot of reversible tracers. kin_out has shape [2, X]: the total
+// distribution volume VT (slope) and the intercept. With a reference region
+// TAC as input function, the slope is the distribution volume ratio instead
+template <typename T>
+void solveLogan(const T* tac_all, T* kin_out, const InputFunction<T>& input,
+                const T* W, const int start_frame, const size_t num_pix,
+                const int num_threads);
@@ -0,0 +1,33 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#pragma once
+
+#include <vector>
+
+// Input function (plasma or reference region) sampled at the frame times,
+// typically the frame mid-times, with its integrals precomputed once so that
+// all the voxels share them. The input function is zero at the injection
+// (time zero) and linear between its samples
+template <typename T>
+class InputFunction
+{
+public:
+	InputFunction(const T* frame_times, const T* values, int num_frames);
+
+	int getNumFrames() const;
+	const T* getTimes() const;
+	const T* getValues() const;
+	// Integral of the input function from time zero to every frame time
+	const T* getCumulativeIntegrals() const;
+	// Convolution of the input function with exp(-theta * t) at every frame
+	// time. The convolution is exact for a piecewise-linear input function
+	void convolveExponential(double theta, T* out) const;
+
+private:
+	std::vector<T> m_times;
+	std::vector<T> m_values;
+	std::vector<T> m_cumulativeIntegrals;
+};
@@ -8,6 +8,9 @@
 #include <cmath>
 #include <cstddef>
 
+// Basis-function fits of the SRTM, for every pixel, with an optional prior
+// on the kinetic parameters. The pixels are fitted by blocks: each basis is
+// applied to all the pixels of a block at once
 template <typename T>
 void solveSRTMBasis(const T* tac_all, T* kin_out, const T* kin_p,
                     const T* A_all, const T* B_all, const T* Rinv_Qt_all,
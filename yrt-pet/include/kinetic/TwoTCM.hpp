@@ -0,0 +1,28 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#pragma once
+
+#include "kinetic/InputFunction.hpp"
+
+#include <cstddef>
+
+// Basis-function fits of the two-tissue compartment model, for every pixel.
+// The impulse response of the model is a sum of two exponentials, whose
+// decay rates are taken from theta_list: every pair of distinct rates is a
+// basis, fitted by weighted non-negative least squares (a coefficient at
+// zero leaves its column out of the fit), optionally with a blood volume
+// term (the input function standing for the whole-blood activity). The basis
+// with the lowest cost is kept, and a pixel that no basis fits better than
+// all-zero coefficients gives zeros. The time-activity curves are
+// sampled at the times of the input function and tac_all has shape [T, X].
+// kin_out has shape [5, X]: K1, k2, k3, k4 and the blood volume. Setting a
+// decay rate of zero in theta_list allows irreversible fits (k4 = 0)
+template <typename T>
+void solve2TCMBasis(const T* tac_all, T* kin_out,
+                    const InputFunction<T>& input, const T* theta_list,
+                    const int num_theta, const T* W,
+                    const bool fit_blood_volume, const size_t num_pix,
+                    const int num_threads);
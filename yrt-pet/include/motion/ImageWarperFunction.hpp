@@ -39,6 +39,8 @@ private:
 	void setFrameWarpParameters(int motionFrameId,
 	                            const std::vector<double>& warpParam) override;
 	// Specific methods used in this class.
+	void pullWarp(const Image* source, Image* dest, int frameId,
+	              bool inverse) const;
 	double getVoxelPhysPos(int voxelId, int voxelDim) const;
 	std::vector<double> getVoxelPhysPos(std::vector<int> voxelId);
 	void applyTransformation(const std::vector<double>& pos, Vector3D& result,
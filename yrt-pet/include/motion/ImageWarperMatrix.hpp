@@ -46,6 +46,4 @@ private:
                              int frameId) const;
     void applyInvTransformation(const std::vector<double>& pos, Vector3D& result,
                                 int frameId) const;
-    bool invInterpolComponent(const Vector3D& pt, std::vector<std::vector<int>>& voxIndex,
-                              std::vector<double>& voxValue) const;
 };
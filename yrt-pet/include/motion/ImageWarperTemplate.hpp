@@ -260,6 +260,12 @@ protected:
 	 */
 	std::vector<double>
 	    convertQuaternionToRotationMatrix(std::vector<double> quaternion);
+	/*
+	 * Def.: Evaluate the physical position of the voxel centers along the
+	 *       specified dimension, once for all the voxels of that dimension.
+	 * @voxelDim: The dimension of interest.
+	 */
+	std::vector<double> getVoxelPhysPositions(int voxelDim) const;
 
 	// The methods to be defined in the child class.
 	virtual void initWarpModeSpecificParameters() = 0;
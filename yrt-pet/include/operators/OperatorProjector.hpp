@@ -12,11 +12,17 @@
 #include "operators/TimeOfFlight.hpp"
 #include "utils/Types.hpp"
 
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
 class BinIterator;
 class Image;
 class Scanner;
 class ProjectionData;
 class Histogram;
+class ImageParams;
 
 
 class OperatorProjector : public OperatorProjectorBase
@@ -29,6 +35,10 @@ public:
 		DD_GPU
 	};
 
+	// Number of bins whose properties are gathered at once (see
+	// ProjectionData::getProjectionProperties)
+	static constexpr size_t BinBlockSize = 256;
+
 	explicit OperatorProjector(const OperatorProjectorParams& p_projParams);
 
 	// Virtual functions
@@ -40,19 +50,104 @@ public:
 	                   const ProjectionProperties& projectionProperties,
 	                   float projValue) const = 0;
 
+	// Projections of a block of bins (see
+	// ProjectionData::getProjectionProperties), read from the batch directly
+	// with one virtual call per block. The backprojection skips the bins
+	// with a null value. Default to the per-bin projections
+	virtual void forwardProjectionBatch(
+	    const Image* image, const ProjectionPropertiesBatch& properties,
+	    float* projValues) const;
+	virtual void
+	    backProjectionBatch(Image* image,
+	                        const ProjectionPropertiesBatch& properties,
+	                        const float* projValues) const;
+
+	// Projections of a bin that can group several LORs (see
+	// ProjectionData::hasLORBundles)
+	float forwardProjectionBundle(const Image* image,
+	                              const ProjectionData* dat, bin_t bin) const;
+	void backProjectionBundle(Image* image, const ProjectionData* dat,
+	                          bin_t bin, float projValue) const;
+
+	// Projections of a LOR lying in a transaxial plane (see
+	// ProjectionData::hasTransaxialLORs). Only the given image slice is read
+	// or written, so that different slices can be processed concurrently
+	// without atomic operations. Defaults to the 3D projection
+	virtual float
+	    forwardProjection2D(const Image* image,
+	                        const ProjectionProperties& projectionProperties,
+	                        int slice) const;
+	virtual void
+	    backProjection2D(Image* image,
+	                     const ProjectionProperties& projectionProperties,
+	                     int slice, float projValue) const;
+	virtual void forwardProjection2DBatch(
+	    const Image* image, const ProjectionPropertiesBatch& properties,
+	    int slice, float* projValues) const;
+	virtual void
+	    backProjection2DBatch(Image* image,
+	                          const ProjectionPropertiesBatch& properties,
+	                          int slice, const float* projValues) const;
+	// Projections of all the TOF bins of a LOR (see
+	// ProjectionData::hasTOFBins) at once. The bins are centered on zero and
+	// have the given width in picoseconds. Not supported by default
+	virtual void forwardProjectionTOFBins(
+	    const Image* image, const ProjectionProperties& projectionProperties,
+	    int numTOFBins, float tofBinWidth_ps, float* projValues) const;
+	virtual void
+	    backProjectionTOFBins(Image* image,
+	                          const ProjectionProperties& projectionProperties,
+	                          int numTOFBins, float tofBinWidth_ps,
+	                          const float* projValues) const;
+	// Bins of the bin iterator grouped by the image slice in which their
+	// (transaxial) LOR lies. The bins outside of the image are left out
+	std::vector<std::vector<bin_t>>
+	    getBinsPerSlice(const ProjectionData* dat,
+	                    const ImageParams& imgParams) const;
+
 	void applyA(const Variable* in, Variable* out) override;
 	void applyAH(const Variable* in, Variable* out) override;
 
-	void setupTOFHelper(float tofWidth_ps, int tofNumStd = -1);
+	void setupTOFHelper(float tofWidth_ps, int tofNumStd = -1,
+	                    int tofLUTSamplesPerStd = 0);
 	void setupProjPsfManager(const std::string& psfFilename);
 
+	// Also clears the LOR groups (see getLORGroups)
+	void setBinIter(const BinIterator* p_binIter) override;
+
 	const TimeOfFlightHelper* getTOFHelper() const;
 	const ProjectionPsfManager* getProjectionPsfManager() const;
 
+	// Bins of the bin iterator grouped by LOR (see
+	// ProjectionData::hasDuplicateLORs). The bins of group g are
+	// bins[groupStarts[g]] to bins[groupStarts[g + 1] - 1]
+	struct LORGroups
+	{
+		bin_t numGroups() const { return groupStarts.size() - 1; }
+		bin_t getFirstBin(bin_t group) const
+		{
+			return bins[groupStarts[group]];
+		}
+
+		std::vector<bin_t> bins;
+		std::vector<size_t> groupStarts;
+	};
+	// The groups are computed once per data and bin iterator, and kept
+	// until the bin iterator is replaced, so the LORs of the bins must not
+	// change in between. A ProjectionList shares the groups of its
+	// reference (ex: the measurements and their ratio). Not thread-safe
+	const LORGroups& getLORGroups(const ProjectionData* dat) const;
+	void clearLORGroups();
+
 protected:
 	// Time of flight
 	std::unique_ptr<TimeOfFlightHelper> mp_tofHelper;
 
 	// Projection-domain PSF
 	std::unique_ptr<ProjectionPsfManager> mp_projPsfManager;
+
+private:
+	mutable std::map<std::pair<const ProjectionData*, const BinIterator*>,
+	                 LORGroups>
+	    m_lorGroups;
 };
@@ -22,7 +22,8 @@ public:
 	                        const Scanner& pr_scanner,
 	                        float p_tofWidth_ps = 0.f, int p_tofNumStd = 0,
 	                        std::string p_psfProjFilename = "",
-	                        int p_num_rays = 1);
+	                        int p_num_rays = 1,
+	                        int p_tofLUTSamplesPerStd = 0);
 
 	const BinIterator* binIter;
 	const Scanner& scanner;
@@ -30,6 +31,10 @@ public:
 	// Time of Flight
 	float tofWidth_ps;
 	int tofNumStd;
+	// Samples per standard deviation of the tabulated TOF kernel. The kernel
+	// is evaluated analytically if zero. More samples are more accurate but
+	// make the table larger
+	int tofLUTSamplesPerStd;
 
 	// Projection-domain PSF
 	std::string psfProjFilename;
@@ -47,7 +52,7 @@ public:
 	const Scanner& getScanner() const;
 	const BinIterator* getBinIter() const;
 
-	void setBinIter(const BinIterator* p_binIter);
+	virtual void setBinIter(const BinIterator* p_binIter);
 
 protected:
 	// To take scanner properties into account
@@ -23,14 +23,16 @@ public:
 	    const Image* in_image, const Line3D& lor, const Vector3D& n1,
 	    const Vector3D& n2, const TimeOfFlightHelper* tofHelper = nullptr,
 	    float tofValue = 0.0f,
-	    const ProjectionPsfManager* psfManager = nullptr) const;
+	    const ProjectionPsfManager* psfManager = nullptr,
+	    const float* psfKernel = nullptr) const;
 
 	void backProjection(Image* in_image, const Line3D& lor,
 	                    const Vector3D& n1, const Vector3D& n2,
 	                    float proj_value,
 	                    const TimeOfFlightHelper* tofHelper = nullptr,
 	                    float tofValue = 0.0f,
-	                    const ProjectionPsfManager* psfManager = nullptr) const;
+	                    const ProjectionPsfManager* psfManager = nullptr,
+	                    const float* psfKernel = nullptr) const;
 
 	float forwardProjection(
 	    const Image* img,
@@ -40,6 +42,39 @@ public:
 	                    const ProjectionProperties& projectionProperties,
 	                    float projValue) const override;
 
+	void forwardProjectionBatch(const Image* img,
+	                            const ProjectionPropertiesBatch& properties,
+	                            float* projValues) const override;
+	void backProjectionBatch(Image* img,
+	                         const ProjectionPropertiesBatch& properties,
+	                         const float* projValues) const override;
+
+	// All the TOF bins of a LOR with a single traversal
+	void forwardProjectionTOFBins(
+	    const Image* img, const ProjectionProperties& projectionProperties,
+	    int numTOFBins, float tofBinWidth_ps,
+	    float* projValues) const override;
+	void backProjectionTOFBins(Image* img,
+	                           const ProjectionProperties& projectionProperties,
+	                           int numTOFBins, float tofBinWidth_ps,
+	                           const float* projValues) const override;
+
+	// Slice-by-slice projections of transaxial LORs. The axial footprint
+	// of the detectors is ignored, the LOR covers its whole slice
+	float forwardProjection2D(const Image* img,
+	                          const ProjectionProperties& projectionProperties,
+	                          int slice) const override;
+	void backProjection2D(Image* img,
+	                      const ProjectionProperties& projectionProperties,
+	                      int slice, float projValue) const override;
+	void forwardProjection2DBatch(const Image* img,
+	                              const ProjectionPropertiesBatch& properties,
+	                              int slice, float* projValues) const override;
+	void backProjection2DBatch(Image* img,
+	                           const ProjectionPropertiesBatch& properties,
+	                           int slice,
+	                           const float* projValues) const override;
+
 	static float get_overlap_safe(float p0, float p1, float d0, float d1);
 	static float get_overlap_safe(float p0, float p1, float d0, float d1,
 	                              const ProjectionPsfManager* psfManager,
@@ -50,11 +85,25 @@ public:
 
 
 private:
-	template <bool IS_FWD, bool FLAG_TOF>
+	template <bool IS_FWD>
+	void project2D(Image* img, const Line3D& lor, const Vector3D& n1,
+	               const Vector3D& n2, float tofValue, int slice,
+	               float& projValue) const;
+
+	// FLAG_2D restricts the projection to the given slice, without atomic
+	// operations. FLAG_TOF_BINS projects the numTOFBins TOF bins of the LOR
+	// from/into tofBinValues instead of proj_value. The PSF kernel is looked
+	// up from psfManager unless given
+	template <bool IS_FWD, bool FLAG_TOF, bool FLAG_2D = false,
+	          bool FLAG_TOF_BINS = false>
 	void dd_project_ref(Image* in_image, const Line3D& lor,
 	                    const Vector3D& n1, const Vector3D& n2,
 	                    float& proj_value,
 	                    const TimeOfFlightHelper* tofHelper = nullptr,
 	                    float tofValue = 0.f,
-	                    const ProjectionPsfManager* psfManager = nullptr) const;
+	                    const ProjectionPsfManager* psfManager = nullptr,
+	                    int slice = 0, int numTOFBins = 0,
+	                    float tofBinWidth_ps = 0.f,
+	                    float* tofBinValues = nullptr,
+	                    const float* psfKernel = nullptr) const;
 };
@@ -29,7 +29,8 @@ public:
 	bool isSynchronized() const;
 
 	bool requiresIntermediaryProjData() const;
-	void setupTOFHelper(float tofWidth_ps, int tofNumStd = -1);
+	void setupTOFHelper(float tofWidth_ps, int tofNumStd = -1,
+	                    int tofLUTSamplesPerStd = 0);
 
 protected:
 	explicit
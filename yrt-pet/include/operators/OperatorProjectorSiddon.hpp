@@ -25,16 +25,52 @@ public:
 			    const ProjectionProperties& projectionProperties,
 			    float projValue) const override;
 
-	// Projection
+	void forwardProjectionBatch(const Image* img,
+	                            const ProjectionPropertiesBatch& properties,
+	                            float* projValues) const override;
+	void backProjectionBatch(Image* img,
+	                         const ProjectionPropertiesBatch& properties,
+	                         const float* projValues) const override;
+
+	// Slice-by-slice projections of transaxial LORs (single ray)
+	float forwardProjection2D(const Image* img,
+	                          const ProjectionProperties& projectionProperties,
+	                          int slice) const override;
+	void backProjection2D(Image* img,
+	                      const ProjectionProperties& projectionProperties,
+	                      int slice, float projValue) const override;
+	void forwardProjection2DBatch(const Image* img,
+	                              const ProjectionPropertiesBatch& properties,
+	                              int slice, float* projValues) const override;
+	void backProjection2DBatch(Image* img,
+	                           const ProjectionPropertiesBatch& properties,
+	                           int slice,
+	                           const float* projValues) const override;
+
+	// All the TOF bins of a LOR with a single traversal per ray
+	void forwardProjectionTOFBins(
+	    const Image* img, const ProjectionProperties& projectionProperties,
+	    int numTOFBins, float tofBinWidth_ps,
+	    float* projValues) const override;
+	void backProjectionTOFBins(Image* img,
+	                           const ProjectionProperties& projectionProperties,
+	                           int numTOFBins, float tofBinWidth_ps,
+	                           const float* projValues) const override;
+
+	// Projection. If the projector has a projection-space PSF, the kernel of
+	// the LOR can be given (see ProjectionPsfManager::getKernel, flipped for
+	// the backprojection), otherwise it is looked up
 	float forwardProjection(const Image* img, const Line3D& lor,
 	                         const Vector3D& n1, const Vector3D& n2,
 	                         const TimeOfFlightHelper* tofHelper = nullptr,
-	                         float tofValue = 0.f) const;
+	                         float tofValue = 0.f,
+	                         const float* psfKernel = nullptr) const;
 	void backProjection(Image* img, const Line3D& lor,
 	                    const Vector3D& n1, const Vector3D& n2,
 	                    float projValue,
 	                    const TimeOfFlightHelper* tofHelper = nullptr,
-	                    float tofValue = 0.f) const;
+	                    float tofValue = 0.f,
+	                    const float* psfKernel = nullptr) const;
 
 	// Without Multi-ray siddon
 	static float singleForwardProjection(
@@ -51,10 +87,46 @@ public:
 	                           const TimeOfFlightHelper* tofHelper = nullptr,
 	                           float tofValue = 0.f);
 
+	// Projection of the TOF bins (centered on zero, of the given width in
+	// picoseconds) of a LOR. The TOF kernel is evaluated once per voxel
+	// crossed and shared by all the bins
+	template <bool IS_FWD, bool FLAG_INCR>
+	static void project_helper_TOFBins(Image* img, const Line3D& lor,
+	                                   float* values, int numTOFBins,
+	                                   float tofBinWidth_ps,
+	                                   const TimeOfFlightHelper* tofHelper);
+
+	// Two-dimensional Siddon in one slice of the image, for a LOR parallel
+	// to the slice. Does not use atomic operations
+	template <bool IS_FWD>
+	static void project_helper_2D(Image* img, const Line3D& lor, int slice,
+	                              float& value);
+
+	// With more than one ray, the rays are stratified over the volumes of
+	// both crystals (see MultiRayGenerator::getStratifiedLine)
 	int getNumRays() const;
 	void setNumRays(int n);
 
 private:
+	void setupLineGenerators();
+
+	float forwardProjection2D(const Image* img, const Line3D& lor,
+	                          const float* psfKernel, int slice) const;
+	void backProjection2D(Image* img, const Line3D& lor,
+	                      const float* psfKernel, int slice,
+	                      float projValue) const;
+
+	// Kernel of the LOR (without the image offset) if the projector has a
+	// projection-space PSF and it was not already looked up
+	const float* getPsfKernel(const Line3D& lor, const Vector3D& offsetVec,
+	                          const float* psfKernel, bool flagFlipped) const;
+	// Calls func(ray, weight) for the rays modeling the projection-space PSF
+	// around the given ray: one per kernel sample, shifted transaxially. Only
+	// the given ray, with a weight of 1, if there is no PSF kernel
+	template <typename RayFunc>
+	void forEachPsfRay(const Line3D& ray, const float* psfKernel,
+	                   bool flagFlipped, RayFunc&& func) const;
+
 	int m_numRays;
 	std::unique_ptr<std::vector<MultiRayGenerator>> mp_lineGen;
 };
@@ -10,9 +10,23 @@
 
 #include <vector>
 
+/*
+ * Image-space PSF as a shift-invariant separable kernel, with periodic
+ * boundaries. Each axis is convolved in parallel over the image lines,
+ * either directly (vectorized along the contiguous x dimension) or through
+ * the FFT for kernels that are wide compared to the image dimension.
+ */
 class OperatorPsf : public Operator
 {
 public:
+	// AUTO picks, for each axis, the cheapest method (see isFFTFaster)
+	enum ConvolutionMethod
+	{
+		AUTO = 0,
+		DIRECT,
+		FFT
+	};
+
 	OperatorPsf();
 	explicit OperatorPsf(const std::string& imageSpacePsf_fname);
 	~OperatorPsf() override = default;
@@ -27,6 +41,11 @@ public:
 	                      const std::vector<float>& kernelY,
 	                      const std::vector<float>& kernelZ) const;
 
+	void setConvolutionMethod(ConvolutionMethod p_method);
+	ConvolutionMethod getConvolutionMethod() const;
+	// Estimate based on the number of floating point operations per voxel
+	static bool isFFTFaster(size_t kernelSize, size_t n);
+
 protected:
 	std::vector<float> m_kernelX;
 	std::vector<float> m_kernelY;
@@ -37,5 +56,7 @@ protected:
 
 private:
 	void readFromFileInternal(const std::string& imageSpacePsf_fname);
-	mutable std::vector<float> m_buffer_tmp;
+	bool useFFT(size_t kernelSize, size_t n) const;
+
+	ConvolutionMethod m_convolutionMethod;
 };
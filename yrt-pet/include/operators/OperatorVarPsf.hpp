@@ -0,0 +1,61 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#pragma once
+
+#include "operators/OperatorPsf.hpp"
+
+#include <vector>
+
+/*
+ * Spatially-variant image-space PSF. Separable kernels are measured at the
+ * nodes of a grid of radial (distance to the scanner axis) and axial
+ * positions, and the PSF of a voxel is the bilinear interpolation of the
+ * kernels of the four nodes around it. The operator is applied as a sum of
+ * shift-invariant convolutions weighted voxel-wise:
+ *   A x = sum_n W_n (H_n x), A^T y = sum_n H_n^T (W_n y)
+ * where W_n holds the interpolation weights of node n. Since the weights of a
+ * node are non-zero only between its neighbouring axial nodes, each
+ * convolution is done on that slab of slices (and the kernel margin) only.
+ */
+class OperatorVarPsf : public OperatorPsf
+{
+public:
+	OperatorVarPsf();
+	explicit OperatorVarPsf(const std::string& imageSpaceVarPsf_fname);
+	~OperatorVarPsf() override = default;
+
+	void readFromFile(const std::string& imageSpaceVarPsf_fname) override;
+
+	void applyA(const Variable* in, Variable* out) override;
+	void applyAH(const Variable* in, Variable* out) override;
+
+	size_t getNumKernels() const;
+	const std::vector<float>& getRadialPositions() const;
+	const std::vector<float>& getAxialPositions() const;
+
+	// Piecewise-linear interpolation weight of each node (sorted positions)
+	// for each of the given positions, clamped outside the nodes.
+	// Returns weights[node][position]
+	static std::vector<std::vector<float>>
+	    computeInterpolationWeights(const std::vector<float>& nodes,
+	                                const std::vector<float>& positions);
+
+private:
+	struct Kernel
+	{
+		std::vector<float> x, y, z;
+		std::vector<float> x_flipped, y_flipped, z_flipped;
+	};
+
+	void readFromFileInternal(const std::string& imageSpaceVarPsf_fname);
+	void apply(const Image* in, Image* out, bool transpose) const;
+
+	std::vector<float> m_radialPositions;
+	std::vector<float> m_axialPositions;
+	// Axial-major: kernel of the radial node r and axial node z is at
+	// z * numRadialPositions + r
+	std::vector<Kernel> m_kernels;
+};
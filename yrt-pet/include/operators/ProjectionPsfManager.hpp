@@ -8,6 +8,8 @@
 #include "geometry/Line3D.hpp"
 #include "utils/Array.hpp"
 
+struct ProjectionPropertiesBatch;
+
 class ProjectionPsfManager
 {
 public:
@@ -16,18 +18,35 @@ public:
 	virtual void readFromFile(const std::string& psfFilename);
 	float getHalfWidth_mm() const;
 	int getKernelSize() const;
+	float getKernelSpacing() const;
 
+	// Integral of the kernel between x0 and x1 (in mm, relative to the LOR).
+	// The kernel must come from getKernel, which gives its cumulative table,
+	// so that the integral is two lookups instead of a sum over the samples
 	float getWeight(const float* kernel, float x0, float x1) const;
 	const float* getKernel(const Line3D& lor, bool flagFlipped = false) const;
+	// Kernels of all the LORs of a batch, moved by -offset, stored in the
+	// batch so that the projectors do not have to look them up again
+	void getKernels(ProjectionPropertiesBatch& properties,
+	                const Vector3D& offset, bool flagFlipped = false) const;
 
 protected:
 	ProjectionPsfManager();
+	size_t getKernelIndex(float p1x, float p1y, float p2x, float p2y) const;
+	float getCumulativeValue(const float* kernel, float x) const;
+
 	Array2D<float> m_kernelDataRaw;
 	Array2DAlias<float> m_kernels;
 	Array2D<float> m_kernelsFlipped;
+	// Per kernel, the running integral of the (zero-padded) kernel at its
+	// kernelSize + 2 samples followed by the zero-padded samples themselves
+	Array2D<float> m_kernelsCumul;
+	Array2D<float> m_kernelsFlippedCumul;
 	float m_sStep;
 	float m_kSpacing;
 
 private:
 	void readFromFileInternal(const std::string& psfFilename);
+	void computeCumulativeKernels(const Array2DBase<float>& kernels,
+	                              Array2D<float>& kernelsCumul) const;
 };
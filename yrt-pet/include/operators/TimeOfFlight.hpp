@@ -14,7 +14,20 @@
 class TimeOfFlightHelper
 {
 public:
-	explicit TimeOfFlightHelper(float tof_width_ps, int tof_n_std = -1);
+	// Range, in standard deviations, covered by the tabulated kernel and
+	// maximum number of samples per standard deviation
+	static constexpr int LUTRangeStd = 6;
+	static constexpr int MaxLUTSamplesPerStd = 128;
+	static constexpr int MaxLUTSize = 2 * LUTRangeStd * MaxLUTSamplesPerStd + 1;
+	// Maximum number of TOF bins of a LOR in TOF-binned projection data
+	static constexpr int MaxNumTOFBins = 128;
+
+	// If tof_lut_samples_per_std is positive, the weights are the Gaussian
+	// integrated over each segment, computed from a tabulated CDF with the
+	// given number of samples per standard deviation. Otherwise, the weights
+	// are the Gaussian evaluated at the middle of the segment
+	explicit TimeOfFlightHelper(float tof_width_ps, int tof_n_std = -1,
+	                            int tof_lut_samples_per_std = 0);
 
 	HOST_DEVICE_CALLABLE inline void getAlphaRange(float& alpha_min,
 	                                               float& alpha_max,
@@ -45,17 +58,93 @@ public:
 		const float tof_value_mm = tofValue_ps * SPEED_OF_LIGHT_MM_PS * 0.5;
 		const float pc = 0.5 * lorNorm + tof_value_mm;
 
+		if (m_lutSize > 0)
+		{
+			// Mean of the Gaussian over the segment. Segments shorter than a
+			// table step are widened to one step around their middle
+			float lo_mm = offLo_mm - pc;
+			float hi_mm = offHi_mm - pc;
+			if (hi_mm - lo_mm < m_lutStep_mm)
+			{
+				const float mid_mm = 0.5f * (lo_mm + hi_mm);
+				lo_mm = mid_mm - 0.5f * m_lutStep_mm;
+				hi_mm = mid_mm + 0.5f * m_lutStep_mm;
+			}
+			return (getCDF(hi_mm) - getCDF(lo_mm)) / (hi_mm - lo_mm);
+		}
+
 		const float x_cent_norm = (0.5f * (offLo_mm + offHi_mm) - pc) / m_sigma;
 		return exp(-0.5f * x_cent_norm * x_cent_norm) * m_norm;
 	}
 
+	// Probability of every TOF bin for an annihilation at the given position
+	// (in mm from the first end of the LOR). The bins, of the given width in
+	// picoseconds, are centered on zero. The kernel is truncated like in
+	// getAlphaRange
+	HOST_DEVICE_CALLABLE inline void getTOFBinWeights(float lorNorm,
+	                                                  float pos_mm,
+	                                                  int numTOFBins,
+	                                                  float tofBinWidth_ps,
+	                                                  float* weights) const
+	{
+		const float binWidth_mm = tofBinWidth_ps * SPEED_OF_LIGHT_MM_PS * 0.5f;
+		const float offset_mm = pos_mm - 0.5f * lorNorm;
+		float edge_mm = -0.5f * numTOFBins * binWidth_mm - offset_mm;
+		float cdfPrev = getTruncatedCDF(edge_mm);
+		for (int t = 0; t < numTOFBins; t++)
+		{
+			edge_mm += binWidth_mm;
+			const float cdf = getTruncatedCDF(edge_mm);
+			weights[t] = cdf - cdfPrev;
+			cdfPrev = cdf;
+		}
+	}
+
+	// Cumulative distribution of the kernel at the given distance (in mm) from
+	// its center, linearly interpolated in the table if there is one
+	HOST_DEVICE_CALLABLE inline float getCDF(float x_mm) const
+	{
+		if (m_lutSize == 0)
+		{
+			return 0.5f * erfcf(-x_mm / (m_sigma * sqrtf(2.0f)));
+		}
+		float u = (x_mm + m_lutHalfRange_mm) / m_lutStep_mm;
+		u = u < 0.0f ? 0.0f : u;
+		u = u > static_cast<float>(m_lutSize - 1) ?
+		        static_cast<float>(m_lutSize - 1) :
+		        u;
+		int i = static_cast<int>(u);
+		i = i > m_lutSize - 2 ? m_lutSize - 2 : i;
+		const float t = u - static_cast<float>(i);
+		return m_lutCDF[i] + t * (m_lutCDF[i + 1] - m_lutCDF[i]);
+	}
+
+	HOST_DEVICE_CALLABLE inline float getTruncatedCDF(float x_mm) const
+	{
+		if (m_truncWidth_mm > 0.f)
+		{
+			x_mm = x_mm < -m_truncWidth_mm ? -m_truncWidth_mm : x_mm;
+			x_mm = x_mm > m_truncWidth_mm ? m_truncWidth_mm : x_mm;
+		}
+		return getCDF(x_mm);
+	}
+
 	float getSigma() const;
 	float getTruncWidth() const;
 	float getNorm() const;
+	int getLUTSamplesPerStd() const;
 
 private:
 	// FWHM
 	float m_sigma;
 	float m_truncWidth_mm;
 	float m_norm;
+
+	// Tabulated CDF, stored in place so that the object can be copied as is
+	// to the device. m_lutSize is zero when the table is not used
+	int m_lutSamplesPerStd;
+	int m_lutSize;
+	float m_lutStep_mm;
+	float m_lutHalfRange_mm;
+	float m_lutCDF[MaxLUTSize];
 };
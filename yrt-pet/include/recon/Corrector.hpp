@@ -36,6 +36,7 @@ public:
 	void addTOF(float p_tofWidth_ps, int p_tofNumStd);
 
 	const Histogram* getSensitivityHistogram() const;
+	const Histogram* getScatterHistogram() const;
 	float getGlobalScalingFactor() const;
 	bool hasGlobalScalingFactor() const;
 
@@ -12,7 +12,8 @@ class Corrector_CPU : public Corrector
 public:
 	explicit Corrector_CPU(const Scanner& pr_scanner);
 
-	// Return sensitivity*attenuation
+	// Return sensitivity*attenuation. For a bin bundling several LORs, the
+	//  mean over its LORs
 	float getMultiplicativeCorrectionFactor(const ProjectionData& measurements,
 	                                        bin_t binId) const;
 
@@ -30,17 +31,22 @@ public:
 	    getCachedMeasurementsForInVivoAttenuationFactors() const;
 private:
 	// Functions used for precomputation only:
-	// Return (randoms+scatter)/(sensitivity*attenuation)
+	// Return (randoms+scatter)/(sensitivity*attenuation). For a bin bundling
+	//  several LORs, the sum of their randoms and scatter over the mean of
+	//  their sensitivity*attenuation
 	float getAdditiveCorrectionFactor(const ProjectionData& measurements,
 	                                  bin_t binId) const;
-	// Return a^(i)_i
+	// Return a^(i)_i, averaged over the LORs of the bin
 	float getInVivoAttenuationFactor(const ProjectionData& measurements,
 	                                 bin_t binId) const;
 	// Helper functions:
-	// Given measurements, a bin, and an attenuation image, compute the
-	//  appropriate attenuation factor
+	// Histogram bin of the given LOR of a bin, to look up the corrections
+	static histo_bin_t getHistogramBinOfLOR(const ProjectionData& measurements,
+	                                        bin_t binId, size_t lorIdx);
+	// Given measurements, a LOR of a bin, and an attenuation image, compute
+	//  the appropriate attenuation factor
 	float getAttenuationFactorFromAttenuationImage(
-	    const ProjectionData& measurements, bin_t binId,
+	    const ProjectionData& measurements, bin_t binId, size_t lorIdx,
 	    const Image& attenuationImage) const;
 
 	// Pre-computed caches
@@ -59,19 +59,25 @@ public:
 	const Histogram* getSensitivityHistogram() const;
 	const ProjectionData* getDataInput() const;
 	void setDataInput(const ProjectionData* pp_dataInput);
-	void addTOF(float p_tofWidth_ps, int p_tofNumStd);
+	void addTOF(float p_tofWidth_ps, int p_tofNumStd,
+	            int p_tofLUTSamplesPerStd = 0);
 	void addProjPSF(const std::string& p_projSpacePsf_fname);
 	virtual void addImagePSF(const std::string& p_imageSpacePsf_fname);
+	virtual void
+	    addImageVarPSF(const std::string& p_imageSpaceVarPsf_fname);
 	void setSaveIterRanges(Util::RangeList p_saveIterList,
 	                       const std::string& p_saveIterPath);
 	void setListModeEnabled(bool enabled);
 	void setProjector(const std::string& projectorName);  // Helper
 	bool isListModeEnabled() const;
 	void enableNeedToMakeCopyOfSensImage();
+	void setNeedToMakeCopyOfSensImage(bool needCopy);
+	bool isNeedToMakeCopyOfSensImage() const;
 	ImageParams getImageParams() const;
 	void setImageParams(const ImageParams& params);
 	void setRandomsHistogram(const Histogram* pp_randoms);
 	void setScatterHistogram(const Histogram* pp_scatter);
+	const Histogram* getScatterHistogram() const;
 	void setAttenuationImage(const Image* pp_attenuationImage);
 	void setACFHistogram(const Histogram* pp_acf);
 	void setHardwareAttenuationImage(const Image* pp_hardwareAttenuationImage);
@@ -113,6 +119,7 @@ protected:
 	bool flagProjTOF;
 	float tofWidth_ps;
 	int tofNumStd;
+	int tofLUTSamplesPerStd;
 	Util::RangeList saveIterRanges;
 	std::string saveIterPath;
 	bool usingListModeInput;  // true => ListMode, false => Histogram
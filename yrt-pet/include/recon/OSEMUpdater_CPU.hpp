@@ -33,5 +33,13 @@ public:
 	void computeEMUpdateImage(const Image& inputImage, Image& destImage) const;
 
 private:
+	// Slice-by-slice version, for measurements with transaxial LORs
+	void computeEMUpdateImage2D(const Image& inputImage,
+	                            Image& destImage) const;
+	// Version for measurements binned in TOF (see
+	// ProjectionData::hasTOFBins)
+	void computeEMUpdateImageTOFBins(const Image& inputImage,
+	                                 Image& destImage) const;
+
 	OSEM_CPU* mp_osem;
 };
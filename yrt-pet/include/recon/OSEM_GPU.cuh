@@ -66,6 +66,8 @@ public:
 	void loadBatch(int batchId, bool forRecon) override;
 	void loadSubset(int subsetId, bool forRecon) override;
 	void addImagePSF(const std::string& p_imageSpacePsf_fname) override;
+	void addImageVarPSF(
+	    const std::string& p_imageSpaceVarPsf_fname) override;
 
 private:
 
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "datastruct/projection/Histogram3D.hpp"
+#include "datastruct/projection/TOFHistogram3D.hpp"
 #include "scatter/Crystal.hpp"
 #include "scatter/SingleScatterSimulator.hpp"
 
@@ -20,6 +21,7 @@ namespace Scatter
 		static constexpr float DefaultACFThreshold = 0.9523809f;  // 1/1.05
 		static constexpr int DefaultSeed = 13;
 		static constexpr auto DefaultCrystal = CrystalMaterial::LYSO;
+		static constexpr int DefaultImageDownsampling = 1;
 
 		ScatterEstimator(const Scanner& pr_scanner, const Image& pr_lambda,
 		                 const Image& pr_mu, const Histogram3D* pp_promptsHis,
@@ -29,21 +31,68 @@ namespace Scatter
 		                 CrystalMaterial p_crystalMaterial = DefaultCrystal,
 		                 int seedi = DefaultSeed, int maskWidth = -1,
 		                 float maskThreshold = DefaultACFThreshold,
-		                 const std::string& saveIntermediary_dir = "");
+		                 const std::string& saveIntermediary_dir = "",
+		                 int imageDownsampling = DefaultImageDownsampling,
+		                 bool smoothInterpolation = false);
 
 		std::unique_ptr<Histogram3DOwned>
 		    computeTailFittedScatterEstimate(size_t numberZ, size_t numberPhi,
 		                                     size_t numberR);
 
+		// Same, in an existing histogram, for example the one used by a
+		// reconstruction's corrector
+		void updateTailFittedScatterEstimate(Histogram3D& scatterEstimate,
+		                                     size_t numberZ, size_t numberPhi,
+		                                     size_t numberR);
+
 		std::unique_ptr<Histogram3DOwned>
 		    computeScatterEstimate(size_t numberZ, size_t numberPhi,
 		                           size_t numberR);
 
+		// TOF-binned scatter estimates, for the given TOF resolution (FWHM).
+		// The tail fitting is done on the sum over the TOF bins
+		std::unique_ptr<TOFHistogram3DOwned>
+		    computeTailFittedTOFScatterEstimate(size_t numberZ,
+		                                        size_t numberPhi,
+		                                        size_t numberR,
+		                                        size_t numTOFBins,
+		                                        float tofBinWidth_ps,
+		                                        float tofWidth_ps,
+		                                        int tofNumStd = -1);
+
+		// Same, in an existing TOF histogram, whose TOF bins are given to the
+		// corrector one by one when reconstructing TOF-binned data
+		void updateTailFittedTOFScatterEstimate(TOFHistogram3D& scatterEstimate,
+		                                        size_t numberZ,
+		                                        size_t numberPhi,
+		                                        size_t numberR,
+		                                        float tofWidth_ps,
+		                                        int tofNumStd = -1);
+
+		std::unique_ptr<TOFHistogram3DOwned>
+		    computeTOFScatterEstimate(size_t numberZ, size_t numberPhi,
+		                              size_t numberR, size_t numTOFBins,
+		                              float tofBinWidth_ps, float tofWidth_ps,
+		                              int tofNumStd = -1);
+
 		std::unique_ptr<Histogram3DOwned> generateScatterTailsMask() const;
 
+		// Replaces the source image of the simulation, for example with the
+		// latest reconstruction. It is downsampled like the initial one
+		void setSourceImage(const Image& pr_lambda);
+		// Source image last given, before downsampling
+		const Image& getSourceImage() const;
+		// Keeps the attenuation tables of the simulation between estimates
+		void setCacheDetectorTables(bool cacheTables);
+		bool isCacheDetectorTables() const;
+
 		float
 		    computeTailFittingFactor(const Histogram3D* scatterHistogram,
 		                             const Histogram3D* scatterTailsMask) const;
+		// Same, with the scatter tails mask evaluated during the sweep
+		// instead of generated beforehand
+		float computeTailFittingFactor(
+		    const Histogram3D* scatterHistogram) const;
 
 	protected:
 		static void fillScatterTailsMask(const Histogram3D& acfHis,
@@ -51,12 +100,29 @@ namespace Scatter
 		                                 float maskThreshold);
 
 	private:
+		// Sums the prompts (minus randoms, over sensitivity) and the scatter
+		// in the tails, one sinogram row per task, and adds the rows in
+		// order so that the result does not depend on the number of threads.
+		// The mask is evaluated from the ACFs if scatterTailsMask is null
+		float fitScatterTails(const Histogram3D& scatterHistogram,
+		                      const Histogram3D* scatterTailsMask) const;
+		// Saves the mask in the intermediary directory, if given. The mask
+		// only depends on the ACFs, so it is only saved once
+		void saveScatterTailsMask();
+
 		// TODO: Eventually, this class should not depend on the fully-sampled
 		//  histograms. It should instead use the List-Mode instead of the
 		//  prompts and return an under-sampled sinogram instead of a
 		//  fully-sampled histogram.
 		const Scanner& mr_scanner;
+		const Image* mp_lambda;
+		// Source and attenuation images downsampled for the simulation (null
+		// if not downsampled). Declared before m_sss, which refers to them
+		std::unique_ptr<Image> mp_lambdaDownsampled;
+		std::unique_ptr<Image> mp_muDownsampled;
 		SingleScatterSimulator m_sss;
+		int m_imageDownsampling;
+		bool m_smoothInterpolation;
 		const Histogram3D* mp_promptsHis;
 		const Histogram3D* mp_randomsHis;
 		const Histogram3D* mp_acfHis;
@@ -67,5 +133,6 @@ namespace Scatter
 		    m_saveIntermediary_dir;  // save the scatter tails mask used
 		float m_maskThreshold;
 		size_t m_scatterTailsMaskWidth;
+		bool m_isScatterTailsMaskSaved;
 	};
 }  // namespace Scatter
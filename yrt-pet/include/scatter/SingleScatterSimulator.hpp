@@ -12,6 +12,8 @@
 #include <vector>
 
 class Histogram3D;
+class TOFHistogram3D;
+class TimeOfFlightHelper;
 class Scanner;
 class Image;
 
@@ -24,17 +26,112 @@ namespace Scatter
 		                       const Image& pr_lambda,
 		                       CrystalMaterial p_crystalMaterial, int seedi);
 
+		// Simulates a (numberZ, numberPhi, numberR) grid of LORs and fills the
+		// other bins by trilinear interpolation, or by monotone cubic
+		// interpolation if smoothInterpolation is set
 		void runSSS(size_t numberZ, size_t numberPhi, size_t numberR,
-		            Histogram3D& scatterHisto);
+		            Histogram3D& scatterHisto,
+		            bool smoothInterpolation = false);
+		// Same with TOF bins, for the given TOF resolution (FWHM)
+		void runSSS(size_t numberZ, size_t numberPhi, size_t numberR,
+		            TOFHistogram3D& scatterHisto, float tofWidth_ps,
+		            int tofNumStd = -1, bool smoothInterpolation = false);
 
 		float computeSingleScatterInLOR(const Line3D& lor, const Vector3D& n1,
 		                                const Vector3D& n2) const;
+		// Scatter of the LOR in each of the TOF bins (of the given width,
+		// centered on zero)
+		std::vector<float> computeSingleScatterInLOR(
+		    const Line3D& lor, const Vector3D& n1, const Vector3D& n2,
+		    const TimeOfFlightHelper& tofHelper, int numTOFBins,
+		    float tofBinWidth_ps) const;
+
+		// Replaces the source image (for example, with the image of the
+		// latest reconstruction). The scatter points, which only depend on
+		// the attenuation image, are kept
+		void setSourceImage(const Image& pr_lambda);
+		// Keeps the attenuation tables of the sampled LORs between calls to
+		// runSSS, so that only the emission integrals are recomputed when
+		// the source image changes. This uses one set of tables per z sample
+		void setCacheDetectorTables(bool cacheTables);
+		bool isCacheDetectorTables() const;
 
 		Vector3D getSamplePoint(int i) const;
 		int getNumSamples() const;
 		bool passCollimator(const Line3D& lor) const;
 
 	private:
+		// Attenuation (at 511 keV) and emission line integrals, crystal path
+		// lengths, detection efficiencies at 511 keV and collimator masks
+		// between a set of detectors and every scatter point. Indexed by
+		// detIdx * m_numSamples + sampleIdx
+		struct DetectorScatterTables
+		{
+			std::vector<float> att511;
+			std::vector<float> lambda;
+			std::vector<float> crystalLength;
+			std::vector<float> efficiency511;
+			// 1 if the ray passes the end plates collimator, 0 otherwise
+			std::vector<float> collimatorMask;
+			// For TOF, emission integrals over NumTOFSegments equal segments
+			// of the ray, from the detector. Indexed by
+			// (detIdx * m_numSamples + sampleIdx) * NumTOFSegments + segment
+			std::vector<float> lambdaSegments;
+		};
+		static constexpr int NumTOFSegments = 8;
+
+		void computeEnergyTables();
+
+		void computeDetectorScatterTables(
+		    const std::vector<Vector3D>& detPositions,
+		    DetectorScatterTables& tables, bool withTOF = false) const;
+		// Tables depending on the attenuation image only
+		void computeAttenuationTables(
+		    const std::vector<Vector3D>& detPositions,
+		    DetectorScatterTables& tables) const;
+		// Tables depending on the source image
+		void computeEmissionTables(const std::vector<Vector3D>& detPositions,
+		                           DetectorScatterTables& tables,
+		                           bool withTOF) const;
+		float computeSingleScatterInLOR(const Line3D& lor, const Vector3D& n1,
+		                                const Vector3D& n2,
+		                                const DetectorScatterTables& tables,
+		                                size_t detIdx1, size_t detIdx2) const;
+		void computeSingleScatterInLOR(const Line3D& lor, const Vector3D& n1,
+		                               const Vector3D& n2,
+		                               const DetectorScatterTables& tables,
+		                               size_t detIdx1, size_t detIdx2,
+		                               const TimeOfFlightHelper& tofHelper,
+		                               int numTOFBins, float tofBinWidth_ps,
+		                               float* scatterTOF) const;
+		// Sum over the scatter points. If StoreTerms, also stores, for every
+		// scatter point, the factors of the emission integrals towards
+		// detector 1 (termA) and detector 2 (termB)
+		template <bool StoreTerms>
+		float sumScatterPoints(const Line3D& lor, const Vector3D& n1,
+		                       const Vector3D& n2,
+		                       const DetectorScatterTables& tables,
+		                       size_t detIdx1, size_t detIdx2, float* termA,
+		                       float* termB) const;
+		// Scatter of a LOR relative to its trues
+		float getTruesNormalization(const Line3D& lor, const Vector3D& n1,
+		                            const Vector3D& n2) const;
+
+		// Sampled LORs of the histogram
+		void setupLORSamples(size_t numberZ, size_t numberPhi, size_t numberR,
+		                     const Histogram3D& scatterHisto);
+		// Simulates the sampled LORs, ordered as (z, phi, r), with one value
+		// per LOR, or one per TOF bin if tofHelper is given
+		void simulateSampledLORs(const Histogram3D& scatterHisto,
+		                         std::vector<float>& values,
+		                         const TimeOfFlightHelper* tofHelper = nullptr,
+		                         int numTOFBins = 1,
+		                         float tofBinWidth_ps = 0.0f);
+		// Sets the sampled LORs (every stride-th value) and fills the others
+		void fillScatterHistogram(const float* values, size_t stride,
+		                          Histogram3D& scatterHisto,
+		                          bool smoothInterpolation) const;
+
 		static float ran1(int* idum);
 		static float getKleinNishina(float cosa);
 		static float getMuScalingFactor(float energy);
@@ -44,14 +141,31 @@ namespace Scatter
 		// Attenuation image samples
 		int m_numSamples;
 		std::vector<float> m_xSamples, m_ySamples, m_zSamples;
+		// Attenuation coefficient at every scatter point
+		std::vector<float> m_muSamples;
 		// Histogram samples
 		std::vector<size_t> m_zBinSamples, m_phiSamples, m_rSamples;
+		// Attenuation tables of the sampled LORs, one per z sample, if cached
+		bool m_cacheTables;
+		std::vector<DetectorScatterTables> m_cachedTables;
+
+		// Tables of the Klein-Nishina cross-section, attenuation scaling
+		// factor and energy window efficiency of the scattered photon,
+		// sampled on the cosine of the scattering angle in [-1, 1]
+		static constexpr int NumCosSamples = 4096;
+		std::vector<float> m_kleinNishinaTable;
+		std::vector<float> m_muScalingTable;
+		std::vector<float> m_energyEfficiencyTable;
+		// Crystal attenuation coefficient, per keV
+		std::vector<float> m_muDetTable;
+		// Energy window efficiency at 511 keV
+		float m_efficiency511;
 
 		float m_energyLLD, m_sigmaEnergy;
 		float m_scannerRadius, m_crystalDepth, m_axialFOV, m_collimatorRadius;
 		const Scanner& mr_scanner;
 		const Image& mr_mu;      // Attenuation image
-		const Image& mr_lambda;  // Image from 2 MLEM iterations
+		const Image* mp_lambda;  // Image from 2 MLEM iterations
 		CrystalMaterial m_crystalMaterial;
 		Cylinder m_cyl1, m_cyl2;
 		Plane m_endPlate1, m_endPlate2;
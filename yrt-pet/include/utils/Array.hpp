@@ -5,12 +5,16 @@
 
 #pragma once
 
+#include "utils/ArrayOps.hpp"
+#include "utils/ChunkedFile.hpp"
+
 #include <array>
 #include <cmath>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <type_traits>
 
 #if BUILD_PYBIND11
 #include <pybind11/pybind11.h>
@@ -155,7 +159,17 @@ public:
 		return strides;
 	}
 
-	void fill(T val) { std::fill(_data, _data + getSizeTotal(), val); }
+	void fill(T val)
+	{
+		if constexpr (std::is_same_v<T, float>)
+		{
+			Util::ArrayOps::fill(_data, val, getSizeTotal());
+		}
+		else
+		{
+			std::fill(_data, _data + getSizeTotal(), val);
+		}
+	}
 
 	void writeToFile(const std::string& fname) const
 	{
@@ -175,6 +189,18 @@ public:
 		file.write((char*)_data, getSizeTotal() * sizeof(T));
 	}
 
+	// Chunked (and optionally compressed) format, see ChunkedFile.hpp. The
+	// chunks are cut along the first dimension
+	void writeToFileChunked(
+	    const std::string& fname,
+	    Util::ChunkCompression compression = Util::ChunkCompression::ZLIB,
+	    size_t slabsPerChunk = 1) const
+	{
+		const std::vector<size_t> shape(_shape.get(), _shape.get() + ndim);
+		Util::writeChunkedFile(fname, _data, shape, sizeof(T), compression,
+		                       slabsPerChunk);
+	}
+
 	void readFromFile(const std::string& fname)
 	{
 		std::array<size_t, ndim> expected_dims;
@@ -202,6 +228,12 @@ public:
 		file.seekg(0, std::ios::beg);
 
 		file.read((char*)&magic, sizeof(int));
+		if (magic == CHUNKED_MAGIC_NUMBER)
+		{
+			file.close();
+			readFromChunkedFile(fname, expected_dims);
+			return;
+		}
 		if (magic != MAGIC_NUMBER)
 		{
 			throw std::runtime_error("The file given \"" + fname +
@@ -266,77 +298,198 @@ public:
 		file.read((char*)_data, totalSize * sizeof(T));
 	}
 
+	// Read only the slabs [firstSlab, firstSlab + numSlabs) along the first
+	// dimension. Works for both the flat and the chunked formats
+	void readSlabsFromFile(const std::string& fname, size_t firstSlab,
+	                       size_t numSlabs)
+	{
+		std::array<size_t, ndim> dims;
+		if (Util::isChunkedFile(fname))
+		{
+			const Util::ChunkedFileHeader header =
+			    Util::readChunkedFileHeader(fname);
+			checkChunkedHeader(fname, header);
+			std::copy(header.shape.begin(), header.shape.end(), dims.begin());
+			checkSlabRange(fname, dims[0], firstSlab, numSlabs);
+			dims[0] = numSlabs;
+			setShape(dims.data());
+			allocateFlat(getSizeTotal());
+			Util::readChunkedFile(fname, header, _data, firstSlab, numSlabs);
+			return;
+		}
+
+		std::ifstream file;
+		file.open(fname.c_str(), std::ios::binary | std::ios::in);
+		if (!file.is_open())
+		{
+			throw std::filesystem::filesystem_error(
+			    "The file given \"" + fname + "\" could not be opened",
+			    std::make_error_code(std::errc::no_such_file_or_directory));
+		}
+		int magic = 0;
+		int num_dims = 0;
+		file.read((char*)&magic, sizeof(int));
+		file.read((char*)&num_dims, sizeof(int));
+		if (magic != MAGIC_NUMBER || num_dims != ndim)
+		{
+			throw std::runtime_error("The file given \"" + fname +
+			                         "\" is not a valid " +
+			                         std::to_string(ndim) + "D array file");
+		}
+		file.read((char*)dims.data(), ndim * sizeof(size_t));
+		checkSlabRange(fname, dims[0], firstSlab, numSlabs);
+		size_t slabSize = 1;
+		for (int dim = 1; dim < ndim; dim++)
+		{
+			slabSize *= dims[dim];
+		}
+		dims[0] = numSlabs;
+		setShape(dims.data());
+		allocateFlat(getSizeTotal());
+		file.seekg(firstSlab * slabSize * sizeof(T), std::ios::cur);
+		file.read((char*)_data, getSizeTotal() * sizeof(T));
+		if (!file.good())
+		{
+			throw std::runtime_error("The file given \"" + fname +
+			                         "\" is truncated");
+		}
+	}
+
 	T* getRawPointer() { return _data; }
 	const T* getRawPointer() const { return _data; }
 
 	Array<ndim, T>& operator+=(const Array<ndim, T>& other)
 	{
-		for (size_t i = 0; i < getSizeTotal(); i++)
+		const size_t size = getSizeTotal();
+		if constexpr (std::is_same_v<T, float>)
 		{
-			_data[i] += other._data[i];
+			Util::ArrayOps::add(_data, other._data, size);
+		}
+		else
+		{
+			for (size_t i = 0; i < size; i++)
+			{
+				_data[i] += other._data[i];
+			}
 		}
 		return *this;
 	}
 
 	Array<ndim, T>& operator+=(T other)
 	{
-		for (size_t i = 0; i < getSizeTotal(); i++)
+		const size_t size = getSizeTotal();
+		if constexpr (std::is_same_v<T, float>)
 		{
-			_data[i] += other;
+			Util::ArrayOps::add(_data, other, size);
+		}
+		else
+		{
+			for (size_t i = 0; i < size; i++)
+			{
+				_data[i] += other;
+			}
 		}
 		return *this;
 	}
 
 	Array<ndim, T>& operator*=(const Array<ndim, T>& other)
 	{
-		for (size_t i = 0; i < getSizeTotal(); i++)
+		const size_t size = getSizeTotal();
+		if constexpr (std::is_same_v<T, float>)
 		{
-			_data[i] *= other._data[i];
+			Util::ArrayOps::multiply(_data, other._data, size);
+		}
+		else
+		{
+			for (size_t i = 0; i < size; i++)
+			{
+				_data[i] *= other._data[i];
+			}
 		}
 		return *this;
 	}
 
 	Array<ndim, T>& operator/=(const Array<ndim, T>& other)
 	{
-		for (size_t i = 0; i < getSizeTotal(); i++)
+		const size_t size = getSizeTotal();
+		if constexpr (std::is_same_v<T, float>)
+		{
+			Util::ArrayOps::divide(_data, other._data, size);
+		}
+		else
 		{
-			_data[i] /= other._data[i];
+			for (size_t i = 0; i < size; i++)
+			{
+				_data[i] /= other._data[i];
+			}
 		}
 		return *this;
 	}
 
 	Array<ndim, T>& operator*=(T other)
 	{
-		for (size_t i = 0; i < getSizeTotal(); i++)
+		const size_t size = getSizeTotal();
+		if constexpr (std::is_same_v<T, float>)
 		{
-			_data[i] *= other;
+			Util::ArrayOps::multiply(_data, other, size);
+		}
+		else
+		{
+			for (size_t i = 0; i < size; i++)
+			{
+				_data[i] *= other;
+			}
 		}
 		return *this;
 	}
 
 	Array<ndim, T>& operator/=(T other)
 	{
-		for (size_t i = 0; i < getSizeTotal(); i++)
+		const size_t size = getSizeTotal();
+		if constexpr (std::is_same_v<T, float>)
 		{
-			_data[i] /= other;
+			Util::ArrayOps::divide(_data, other, size);
+		}
+		else
+		{
+			for (size_t i = 0; i < size; i++)
+			{
+				_data[i] /= other;
+			}
 		}
 		return *this;
 	}
 
 	Array<ndim, T>& operator-=(const Array<ndim, T>& other)
 	{
-		for (size_t i = 0; i < getSizeTotal(); i++)
+		const size_t size = getSizeTotal();
+		if constexpr (std::is_same_v<T, float>)
+		{
+			Util::ArrayOps::subtract(_data, other._data, size);
+		}
+		else
 		{
-			_data[i] -= other._data[i];
+			for (size_t i = 0; i < size; i++)
+			{
+				_data[i] -= other._data[i];
+			}
 		}
 		return *this;
 	}
 
 	Array<ndim, T>& operator-=(T other)
 	{
-		for (size_t i = 0; i < getSizeTotal(); i++)
+		const size_t size = getSizeTotal();
+		if constexpr (std::is_same_v<T, float>)
 		{
-			_data[i] -= other;
+			Util::ArrayOps::add(_data, -other, size);
+		}
+		else
+		{
+			for (size_t i = 0; i < size; i++)
+			{
+				_data[i] -= other;
+			}
 		}
 		return *this;
 	}
@@ -414,6 +567,59 @@ protected:
 
 	virtual void allocateFlat(size_t size) = 0;
 
+	void readFromChunkedFile(const std::string& fname,
+	                         const std::array<size_t, ndim>& expected_dims)
+	{
+		const Util::ChunkedFileHeader header =
+		    Util::readChunkedFileHeader(fname);
+		checkChunkedHeader(fname, header);
+		std::array<size_t, ndim> dims;
+		std::copy(header.shape.begin(), header.shape.end(), dims.begin());
+		for (int i = 0; i < ndim; i++)
+		{
+			if (expected_dims[i] != 0 && expected_dims[i] != dims[i])
+			{
+				throw std::runtime_error("The file given \"" + fname +
+				                         "\" has dimension sizes that do not "
+				                         "match the expected sizes");
+			}
+		}
+		setShape(dims.data());
+		allocateFlat(getSizeTotal());
+		Util::readChunkedFile(fname, header, _data, 0, dims[0]);
+	}
+
+	static void checkChunkedHeader(const std::string& fname,
+	                               const Util::ChunkedFileHeader& header)
+	{
+		if (header.shape.size() != static_cast<size_t>(ndim))
+		{
+			throw std::runtime_error(
+			    "The file given \"" + fname +
+			    "\" does not have the correct number of dimensions. Namely, "
+			    "the file has " +
+			    std::to_string(header.shape.size()) +
+			    " dimensions instead of the expected " + std::to_string(ndim) +
+			    " dimensions");
+		}
+		if (header.elementSize != sizeof(T))
+		{
+			throw std::runtime_error("The file given \"" + fname +
+			                         "\" does not store elements of the "
+			                         "expected type");
+		}
+	}
+
+	static void checkSlabRange(const std::string& fname, size_t totalNumSlabs,
+	                           size_t firstSlab, size_t numSlabs)
+	{
+		if (firstSlab + numSlabs > totalNumSlabs)
+		{
+			throw std::range_error("The slabs requested are outside the array "
+			                       "stored in \"" + fname + "\"");
+		}
+	}
+
 	std::unique_ptr<T[]> allocateFlatPointer(size_t size)
 	{
 		std::unique_ptr<T[]> data_ptr = nullptr;
@@ -0,0 +1,54 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace Util::ArrayOps
+{
+	/*
+	 * Element-wise operations on contiguous float arrays, parallelized over
+	 * threads and vectorized. Arrays smaller than ParallelThreshold are
+	 * processed by the calling thread only.
+	 * The reductions accumulate in double precision over fixed-size blocks
+	 * whose partial sums are then added with a compensated (Kahan) sum, so
+	 * the result does not depend on the number of threads.
+	 */
+	constexpr size_t ParallelThreshold = 1 << 15;
+	constexpr size_t ReductionBlockSize = 1 << 12;
+
+	void fill(float* dst, float value, size_t n);
+	// dst += src
+	void add(float* dst, const float* src, size_t n);
+	// dst += value
+	void add(float* dst, float value, size_t n);
+	// dst -= src
+	void subtract(float* dst, const float* src, size_t n);
+	// dst *= src
+	void multiply(float* dst, const float* src, size_t n);
+	// dst *= value
+	void multiply(float* dst, float value, size_t n);
+	// dst /= src
+	void divide(float* dst, const float* src, size_t n);
+	// dst /= value
+	void divide(float* dst, float value, size_t n);
+	// dst += alpha * src
+	void addScaled(float* dst, float alpha, const float* src, size_t n);
+	// dst = alpha * src
+	void copyScaled(float* dst, float alpha, const float* src, size_t n);
+
+	// dst = dst * le_scale + le_off where mask <= threshold,
+	// dst = dst * gt_scale + gt_off elsewhere
+	void applyThreshold(float* dst, const float* mask, float threshold,
+	                    float val_le_scale, float val_le_off,
+	                    float val_gt_scale, float val_gt_off, size_t n);
+	// dst *= update / norm where norm > threshold
+	void updateEMThreshold(float* dst, const float* update, const float* norm,
+	                       float threshold, size_t n);
+
+	double sum(const float* x, size_t n);
+	double dotProduct(const float* x, const float* y, size_t n);
+}  // namespace Util::ArrayOps
@@ -0,0 +1,102 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Version tag for chunked array files (first int in file)
+#define CHUNKED_MAGIC_NUMBER 732174001
+
+/** Chunked array files
+ *
+ * Alternative to the flat array file format (see Array.hpp). The array is cut
+ * along its first dimension into chunks of "slabs" (ex: for a 3D array, a slab
+ * is a 2D slice) that are stored independently, optionally compressed, and
+ * indexed by an offset table in the header. This allows:
+ *
+ * - Reading only a range of slabs without reading the full file
+ * - Decompressing the chunks in parallel on load
+ * - Memory-mapping the file when the chunks are uncompressed (the chunks are
+ *   then contiguous, so the whole array can be used in-place)
+ *
+ * Layout:
+ *   int32 magic, int32 ndim, uint64 shape[ndim], uint64 element size,
+ *   int32 compression, int32 (reserved), uint64 slabs per chunk,
+ *   uint64 number of chunks, {uint64 offset, uint64 stored size}[chunks],
+ *   (padding to 64 bytes), chunks data
+ */
+
+namespace Util
+{
+	enum class ChunkCompression : int32_t
+	{
+		NONE = 0,
+		ZLIB = 1
+	};
+
+	struct ChunkedFileHeader
+	{
+		std::vector<size_t> shape;
+		size_t elementSize;
+		ChunkCompression compression;
+		size_t slabsPerChunk;
+		std::vector<uint64_t> chunkOffsets;  // In bytes from the file start
+		std::vector<uint64_t> chunkSizes;    // Stored (compressed) sizes
+
+		size_t getNumSlabs() const;
+		size_t getSlabSizeBytes() const;
+		size_t getNumChunks() const;
+		size_t getTotalSizeBytes() const;
+	};
+
+	bool isChunkedFile(const std::string& fname);
+	ChunkedFileHeader readChunkedFileHeader(const std::string& fname);
+
+	// The callback is called (possibly in parallel) to fill the given buffer
+	// with the slabs [firstSlab, firstSlab + numSlabs)
+	using ChunkedFileSlabFiller =
+	    std::function<void(size_t firstSlab, size_t numSlabs, void* dst)>;
+
+	void writeChunkedFile(const std::string& fname,
+	                      const std::vector<size_t>& shape, size_t elementSize,
+	                      const ChunkedFileSlabFiller& fillSlabs,
+	                      ChunkCompression compression = ChunkCompression::ZLIB,
+	                      size_t slabsPerChunk = 1);
+	void writeChunkedFile(const std::string& fname, const void* data,
+	                      const std::vector<size_t>& shape, size_t elementSize,
+	                      ChunkCompression compression = ChunkCompression::ZLIB,
+	                      size_t slabsPerChunk = 1);
+
+	// Reads the slabs [firstSlab, firstSlab + numSlabs) into dst. The chunks
+	// are read and decompressed in parallel
+	void readChunkedFile(const std::string& fname,
+	                     const ChunkedFileHeader& header, void* dst,
+	                     size_t firstSlab, size_t numSlabs);
+
+	// Read-only (copy-on-write) memory mapping of an uncompressed chunked
+	// file. The returned pointer is valid as long as the object lives
+	class ChunkedFileMapping
+	{
+	public:
+		explicit ChunkedFileMapping(const std::string& fname);
+		~ChunkedFileMapping();
+		ChunkedFileMapping(const ChunkedFileMapping&) = delete;
+		ChunkedFileMapping& operator=(const ChunkedFileMapping&) = delete;
+
+		const ChunkedFileHeader& getHeader() const;
+		void* getData() const;
+
+	private:
+		ChunkedFileHeader m_header;
+		void* mp_mapping;
+		size_t m_mappingSize;
+	};
+
+}  // namespace Util
@@ -0,0 +1,50 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace Util
+{
+	/*
+	 * One-dimensional complex discrete Fourier transform of a fixed length.
+	 * Power-of-two lengths use an iterative radix-2 transform, other lengths
+	 * use Bluestein's algorithm (chirp-z) on top of it. The twiddle factors
+	 * are computed once at construction, so a single object can be shared by
+	 * several threads.
+	 * The forward transform uses the e^(-2i*pi*k*n/N) convention and is
+	 * unnormalized, the inverse transform is normalized by 1/N.
+	 */
+	class FFT1D
+	{
+	public:
+		explicit FFT1D(size_t n);
+
+		size_t getSize() const;
+		void forward(std::complex<float>* data) const;
+		void inverse(std::complex<float>* data) const;
+
+		static bool isPowerOfTwo(size_t n);
+		static size_t nextPowerOfTwo(size_t n);
+
+	private:
+		void transform(std::complex<float>* data, bool inverse) const;
+		void transformRadix2(std::complex<float>* data, bool inverse) const;
+		void transformBluestein(std::complex<float>* data, bool inverse) const;
+
+		size_t m_size;
+		// Length of the radix-2 transform (m_size, or the padded convolution
+		// length for Bluestein)
+		size_t m_sizeRadix2;
+		std::vector<size_t> m_bitReversal;
+		std::vector<std::complex<float>> m_twiddles;
+		// Bluestein only: chirp and Fourier transform of the chirp filter
+		std::vector<std::complex<float>> m_chirp;
+		std::vector<std::complex<float>> m_chirpFilterFT;
+	};
+}  // namespace Util
@@ -0,0 +1,132 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace Util
+{
+	// ----------------- Reduced-precision floating point -----------------
+
+	// IEEE 754 binary16 (1 sign bit, 5 exponent bits, 10 mantissa bits).
+	// Rounds to nearest even, saturates to infinity on overflow and keeps
+	// subnormals.
+	inline uint16_t floatToHalf(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(float));
+
+		const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+		const uint32_t absBits = bits & 0x7FFFFFFFu;
+
+		if (absBits >= 0x7F800000u)
+		{
+			// Inf or NaN (keep NaNs quiet)
+			const uint16_t nanBit = (absBits > 0x7F800000u) ? 0x0200u : 0u;
+			return sign | 0x7C00u | nanBit;
+		}
+		if (absBits >= 0x477FF000u)
+		{
+			// Too large, overflows to infinity
+			return sign | 0x7C00u;
+		}
+		if (absBits < 0x38800000u)
+		{
+			// Subnormal in half precision (or zero)
+			if (absBits < 0x33000000u)
+			{
+				return sign;
+			}
+			const uint32_t exponent = absBits >> 23;
+			const uint32_t mantissa = (absBits & 0x007FFFFFu) | 0x00800000u;
+			const uint32_t shift = 126u - exponent;
+			uint32_t halfMantissa = mantissa >> shift;
+			const uint32_t remainder = mantissa & ((1u << shift) - 1u);
+			const uint32_t halfway = 1u << (shift - 1u);
+			if (remainder > halfway ||
+			    (remainder == halfway && (halfMantissa & 1u)))
+			{
+				halfMantissa++;
+			}
+			return sign | static_cast<uint16_t>(halfMantissa);
+		}
+
+		// Normal number: rebias the exponent and round the mantissa
+		uint32_t halfBits = (absBits - 0x38000000u) >> 13;
+		const uint32_t remainder = absBits & 0x1FFFu;
+		if (remainder > 0x1000u || (remainder == 0x1000u && (halfBits & 1u)))
+		{
+			halfBits++;
+		}
+		return sign | static_cast<uint16_t>(halfBits);
+	}
+
+	inline float halfToFloat(uint16_t half)
+	{
+		const uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+		uint32_t exponent = (half >> 10) & 0x1Fu;
+		uint32_t mantissa = half & 0x03FFu;
+
+		uint32_t bits;
+		if (exponent == 0x1Fu)
+		{
+			// Inf or NaN
+			bits = sign | 0x7F800000u | (mantissa << 13);
+		}
+		else if (exponent == 0u)
+		{
+			if (mantissa == 0u)
+			{
+				bits = sign;
+			}
+			else
+			{
+				// Subnormal, normalize it
+				exponent = 113u;
+				while ((mantissa & 0x0400u) == 0u)
+				{
+					mantissa <<= 1;
+					exponent--;
+				}
+				mantissa &= 0x03FFu;
+				bits = sign | (exponent << 23) | (mantissa << 13);
+			}
+		}
+		else
+		{
+			bits = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+		}
+
+		float value;
+		std::memcpy(&value, &bits, sizeof(float));
+		return value;
+	}
+
+	// bfloat16 (1 sign bit, 8 exponent bits, 7 mantissa bits). Same dynamic
+	// range as float, rounds to nearest even.
+	inline uint16_t floatToBFloat16(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(float));
+		if ((bits & 0x7FFFFFFFu) > 0x7F800000u)
+		{
+			// Keep NaNs quiet
+			return static_cast<uint16_t>((bits >> 16) | 0x0040u);
+		}
+		const uint32_t roundingBias = 0x7FFFu + ((bits >> 16) & 1u);
+		return static_cast<uint16_t>((bits + roundingBias) >> 16);
+	}
+
+	inline float bfloat16ToFloat(uint16_t bfloat)
+	{
+		const uint32_t bits = static_cast<uint32_t>(bfloat) << 16;
+		float value;
+		std::memcpy(&value, &bits, sizeof(float));
+		return value;
+	}
+
+}  // namespace Util
@@ -12,7 +12,12 @@
 
 class ListModeLUTOwned;
 class Histogram3D;
+class TOFHistogram3D;
 class ListMode;
+namespace Scatter
+{
+	class ScatterEstimator;
+}
 
 namespace Util
 {
@@ -22,6 +27,10 @@ namespace Util
 
 	template <bool RequiresAtomic>
 	void convertToHistogram3D(const ProjectionData& dat, Histogram3D& histoOut);
+	// Bins the TOF events of the given data. The events out of the TOF range
+	// of the histogram are left out
+	void convertToTOFHistogram3D(const ProjectionData& dat,
+	                             TOFHistogram3D& histoOut);
 
 	Line3D getNativeLOR(const Scanner& scanner, const ProjectionData& dat,
 	                    bin_t binId);
@@ -32,6 +41,38 @@ namespace Util
 	std::unique_ptr<OSEM> createOSEM(const Scanner& scanner,
 	                                 bool useGPU = false);
 
+	// Alternates OSEM reconstructions and tail-fitted single scatter
+	// simulations in memory, for the given number of scatter rounds, then
+	// reconstructs with the final scatter estimate. The scatter histogram is
+	// set in the OSEM's corrector and updated in place after every
+	// reconstruction. Its content is the scatter estimate of the first
+	// reconstruction (typically zero). Every reconstruction resumes from the
+	// previous image. The OSEM and the estimator get back their previous
+	// settings (initial estimate, scatter histogram, source image, ...)
+	// once done, even if an exception is thrown
+	std::unique_ptr<ImageOwned> reconstructWithScatterEstimation(
+	    OSEM& osem, Scatter::ScatterEstimator& scatterEstimator,
+	    Histogram3D& scatterHis, int numScatterRounds, size_t numberZ,
+	    size_t numberPhi, size_t numberR, const std::string& out_fname = "");
+
+	// Sensitivity image of a moving subject: average of the static
+	// sensitivity image moved by the transform of every frame of the data
+	// input, weighted by the durations of the frames. The frames with the
+	// same transform are moved together. The moved image is overwritten
+	void timeAverageMoveSensitivityImage(const ProjectionData& dataInput,
+	                                     const Image& unmovedSensImage,
+	                                     Image& movedSensImage);
+	// Exact counterpart of timeAverageMoveSensitivityImage: backprojects the
+	// given sensitivity data (typically the LOR sensitivities times the
+	// hardware attenuation factors) with its LORs moved by the transform of
+	// every frame. It avoids the interpolation of the resampling, at the cost
+	// of one backprojection per distinct transform
+	void timeAverageMoveSensitivityImageExact(
+	    const ProjectionData& dataInput, const ProjectionData& sensData,
+	    Image& movedSensImage,
+	    OperatorProjector::ProjectorType projectorType =
+	        OperatorProjector::SIDDON);
+
 	std::tuple<Line3D, Vector3D, Vector3D>
 	    generateTORRandomDOI(const Scanner& scanner, det_id_t d1, det_id_t d2,
 	                         int vmax = 256);
@@ -54,6 +54,18 @@ namespace Util
 	void fillBox(Array3DBase<T>& arr, size_t z1, size_t z2, size_t y1,
 	             size_t y2, size_t x1, size_t x2);
 
+	/**
+	 * Fills the grid spanned by the given knots (sorted, without duplicates)
+	 * by separable monotone cubic (Fritsch-Carlson) interpolation of the
+	 * values at the knots. Smoother than fillBox, without overshoot: the
+	 * filled values stay within the range of their neighbouring knots
+	 **/
+	template <typename T>
+	void fillGridMonotoneCubic(Array3DBase<T>& arr,
+	                           const std::vector<size_t>& zKnots,
+	                           const std::vector<size_t>& yKnots,
+	                           const std::vector<size_t>& xKnots);
+
 	/**
 	 * @brief Return a string version of an iterable STL container.
 	 * @param container Iterable container.
@@ -20,8 +20,15 @@ struct det_pair_t
 	det_id_t d1, d2;
 };
 
+// Defining a TOF bin of a pair of detectors, out of numTOFBins
+struct det_pair_tof_t
+{
+	det_id_t d1, d2;
+	uint32_t tofBin, numTOFBins;
+};
+
 // Defining an LOR
-using histo_bin_t = std::variant<det_pair_t, bin_t>;
+using histo_bin_t = std::variant<det_pair_t, bin_t, det_pair_tof_t>;
 
 // For defining a rotation & translation
 struct transform_t
@@ -6,12 +6,15 @@
 #include "datastruct/image/Image.hpp"
 
 #include "datastruct/image/ImageBase.hpp"
+#include "datastruct/image/ImageResampler.hpp"
 #include "geometry/Constants.hpp"
+#include "utils/ArrayOps.hpp"
 #include "utils/Assert.hpp"
 #include "utils/Tools.hpp"
 #include "utils/Types.hpp"
 #include "utils/Utilities.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <fstream>
@@ -45,6 +48,7 @@ void py_setup_image(py::module& m)
 	      py::arg("val_gt_scale"), py::arg("val_gt_off"));
 	c.def("updateEMThreshold", &Image::updateEMThreshold, py::arg("updateImg"),
 	      py::arg("normImage"), py::arg("threshold"));
+	c.def("voxelSum", &Image::voxelSum);
 	c.def("dotProduct", &Image::dotProduct, py::arg("y"));
 	c.def("getRadius", &Image::getRadius);
 	c.def("getParams", &Image::getParams);
@@ -84,6 +88,7 @@ void py_setup_image(py::module& m)
 	      static_cast<std::unique_ptr<Image> (Image::*)(const transform_t& t)
 	                      const>(&Image::transformImage),
 	      py::arg("transform"));
+	c.def("downsample", &Image::downsample, py::arg("factor"));
 	c.def("updateImageNearestNeighbor", &Image::updateImageNearestNeighbor,
 	      py::arg("pt"), py::arg("value"), py::arg("doMultiplication"));
 	c.def("assignImageNearestNeighbor", &Image::assignImageNearestNeighbor,
@@ -93,6 +98,9 @@ void py_setup_image(py::module& m)
 	c.def("assignImageInterpolate", &Image::assignImageInterpolate,
 	      py::arg("pt"), py::arg("value"));
 	c.def("writeToFile", &Image::writeToFile, py::arg("filename"));
+	c.def("writeToFileChunked", &Image::writeToFileChunked,
+	      py::arg("filename"),
+	      py::arg("compression") = Util::ChunkCompression::ZLIB);
 
 	auto c_alias = py::class_<ImageAlias, Image>(m, "ImageAlias");
 	c_alias.def(py::init<const ImageParams&>(), py::arg("img_params"));
@@ -195,20 +203,9 @@ void Image::addFirstImageToSecond(ImageBase* secondImage) const
 
 float Image::voxelSum() const
 {
-	// Use double to avoid precision loss
-	double sum = 0.0;
-
-	const ImageParams& params = getParams();
-	const size_t numVoxels = params.nx * params.ny * params.nz;
-	const float* rawPtr = mp_array->getRawPointer();
-
-#pragma omp parallel for reduction(+ : sum)
-	for (size_t i = 0; i < numVoxels; i++)
-	{
-		sum += rawPtr[i];
-	}
-
-	return static_cast<float>(sum);
+	// Accumulated in double to avoid precision loss
+	return static_cast<float>(Util::ArrayOps::sum(mp_array->getRawPointer(),
+	                                              mp_array->getSizeTotal()));
 }
 
 void Image::multWithScalar(float scalar)
@@ -859,19 +856,10 @@ void Image::applyThreshold(const ImageBase* maskImg, float threshold,
 	const Image* maskImg_Image = dynamic_cast<const Image*>(maskImg);
 	ASSERT_MSG(maskImg_Image != nullptr, "Input image has the wrong type");
 
-	float* ptr = mp_array->getRawPointer();
-	const float* mask_ptr = maskImg_Image->getRawPointer();
-	for (size_t k = 0; k < mp_array->getSizeTotal(); k++, ptr++, mask_ptr++)
-	{
-		if (*mask_ptr <= threshold)
-		{
-			*ptr = *ptr * val_le_scale + val_le_off;
-		}
-		else
-		{
-			*ptr = *ptr * val_gt_scale + val_gt_off;
-		}
-	}
+	Util::ArrayOps::applyThreshold(
+	    mp_array->getRawPointer(), maskImg_Image->getRawPointer(), threshold,
+	    val_le_scale, val_le_off, val_gt_scale, val_gt_off,
+	    mp_array->getSizeTotal());
 }
 
 void Image::updateEMThreshold(ImageBase* updateImg, const ImageBase* normImg,
@@ -887,30 +875,18 @@ void Image::updateEMThreshold(ImageBase* updateImg, const ImageBase* normImg,
 	ASSERT_MSG(updateImg_Image->getParams().isSameAs(getParams()),
 	           "Image dimensions mismatch");
 
-	float* ptr = mp_array->getRawPointer();
-	float* up_ptr = updateImg_Image->getRawPointer();
-	const float* norm_ptr = normImg_Image->getRawPointer();
-
-	for (size_t k = 0; k < mp_array->getSizeTotal();
-	     k++, ptr++, up_ptr++, norm_ptr++)
-	{
-		if (*norm_ptr > threshold)
-		{
-			*ptr *= *up_ptr / *norm_ptr;
-		}
-	}
+	Util::ArrayOps::updateEMThreshold(
+	    mp_array->getRawPointer(), updateImg_Image->getRawPointer(),
+	    normImg_Image->getRawPointer(), threshold, mp_array->getSizeTotal());
 }
 
 float Image::dotProduct(const Image& y) const
 {
-	float out = 0.0;
-	const float* x_ptr = getRawPointer();
-	const float* y_ptr = y.getRawPointer();
-	for (size_t k = 0; k < mp_array->getSizeTotal(); k++, x_ptr++, y_ptr++)
-	{
-		out += (*x_ptr) * (*y_ptr);
-	}
-	return out;
+	ASSERT_MSG(y.getParams().isSameDimensionsAs(getParams()),
+	           "Image dimensions mismatch");
+	// Accumulated in double to avoid precision loss
+	return static_cast<float>(Util::ArrayOps::dotProduct(
+	    getRawPointer(), y.getRawPointer(), mp_array->getSizeTotal()));
 }
 
 Array3DAlias<float> Image::getArray() const
@@ -922,48 +898,9 @@ void Image::transformImage(const Vector3D& rotation,
                            const Vector3D& translation, Image& dest,
                            float weight) const
 {
-	ImageParams params = getParams();
-	const float* rawPtr = getRawPointer();
-	const int num_xy = params.nx * params.ny;
-	const float alpha = rotation.z;
-	const float beta = rotation.y;
-	const float gamma = rotation.x;
-
-	for (int i = 0; i < params.nz; i++)
-	{
-		const float z = indexToPositionInDimension<0>(i);
-
-		for (int j = 0; j < params.ny; j++)
-		{
-			const float y = indexToPositionInDimension<1>(j);
-
-			for (int k = 0; k < params.nx; k++)
-			{
-				const float x = indexToPositionInDimension<2>(k);
-
-				float newX = x * cos(alpha) * cos(beta) +
-				             y * (-sin(alpha) * cos(gamma) +
-				                  sin(beta) * sin(gamma) * cos(alpha)) +
-				             z * (sin(alpha) * sin(gamma) +
-				                  sin(beta) * cos(alpha) * cos(gamma));
-				newX += translation.x;
-				float newY = x * sin(alpha) * cos(beta) +
-				             y * (sin(alpha) * sin(beta) * sin(gamma) +
-				                  cos(alpha) * cos(gamma)) +
-				             z * (sin(alpha) * sin(beta) * cos(gamma) -
-				                  sin(gamma) * cos(alpha));
-				newY += translation.y;
-				float newZ = -x * sin(beta) + y * sin(gamma) * cos(beta) +
-				             z * cos(beta) * cos(gamma);
-				newZ += translation.z;
-
-				const float currentValue =
-				    rawPtr[i * num_xy + j * params.nx + k];
-				dest.updateImageInterpolate({newX, newY, newZ},
-				                            weight * currentValue, false);
-			}
-		}
-	}
+	transformImage(
+	    ImageResampler::fromRotationAndTranslation(rotation, translation),
+	    dest, weight);
 }
 
 std::unique_ptr<Image> Image::transformImage(const Vector3D& rotation,
@@ -979,35 +916,7 @@ std::unique_ptr<Image> Image::transformImage(const Vector3D& rotation,
 void Image::transformImage(const transform_t& t, Image& dest,
                            float weight) const
 {
-	const ImageParams params = getParams();
-	const float* rawPtr = getRawPointer();
-	const int num_xy = params.nx * params.ny;
-	for (int i = 0; i < params.nz; i++)
-	{
-		const float z = indexToPositionInDimension<0>(i);
-
-		for (int j = 0; j < params.ny; j++)
-		{
-			const float y = indexToPositionInDimension<1>(j);
-
-			for (int k = 0; k < params.nx; k++)
-			{
-				const float x = indexToPositionInDimension<2>(k);
-
-				float newX = x * t.r00 + y * t.r01 + z * t.r02;
-				newX += t.tx;
-				float newY = x * t.r10 + y * t.r11 + z * t.r12;
-				newY += t.ty;
-				float newZ = x * t.r20 + y * t.r21 + z * t.r22;
-				newZ += t.tz;
-
-				const float currentValue =
-				    rawPtr[i * num_xy + j * params.nx + k];
-				dest.updateImageInterpolate({newX, newY, newZ},
-				                            weight * currentValue, false);
-			}
-		}
-	}
+	ImageResampler::resample(*this, dest, t, weight);
 }
 
 std::unique_ptr<Image> Image::transformImage(const transform_t& t) const
@@ -1019,6 +928,89 @@ std::unique_ptr<Image> Image::transformImage(const transform_t& t) const
 	return newImg;
 }
 
+std::unique_ptr<Image> Image::downsample(int factor) const
+{
+	ASSERT_MSG(factor >= 1, "The downsampling factor has to be at least 1");
+	const ImageParams& params = getParams();
+	const int nx = std::max(params.nx / factor, 1);
+	const int ny = std::max(params.ny / factor, 1);
+	const int nz = std::max(params.nz / factor, 1);
+	const ImageParams newParams{nx,
+	                            ny,
+	                            nz,
+	                            params.length_x,
+	                            params.length_y,
+	                            params.length_z,
+	                            params.off_x,
+	                            params.off_y,
+	                            params.off_z};
+	auto newImg = std::make_unique<ImageOwned>(newParams);
+	newImg->allocate();
+	newImg->setValue(0.0f);
+
+	// Downsampled voxel containing the center of every voxel, per dimension
+	const auto getCoarseIndices = [](int n, int newN)
+	{
+		std::vector<int> indices(n);
+		for (int i = 0; i < n; i++)
+		{
+			indices[i] = std::min(static_cast<int>((i + 0.5) * newN / n),
+			                      newN - 1);
+		}
+		return indices;
+	};
+	const std::vector<int> coarse_i = getCoarseIndices(params.nx, nx);
+	const std::vector<int> coarse_j = getCoarseIndices(params.ny, ny);
+	const std::vector<int> coarse_k = getCoarseIndices(params.nz, nz);
+
+	const Array3DBase<float>& data = getData();
+	Array3DBase<float>& newData = newImg->getData();
+	const int numNewVoxels = nx * ny * nz;
+	std::vector<int> counts(numNewVoxels, 0);
+
+	// One downsampled slice per thread
+#pragma omp parallel for default(none)                                    \
+    shared(params, data, newData, coarse_i, coarse_j, coarse_k, counts) \
+    firstprivate(nx, ny, nz)
+	for (int kc = 0; kc < nz; kc++)
+	{
+		for (int k = 0; k < params.nz; k++)
+		{
+			if (coarse_k[k] != kc)
+			{
+				continue;
+			}
+			for (int j = 0; j < params.ny; j++)
+			{
+				for (int i = 0; i < params.nx; i++)
+				{
+					newData[kc][coarse_j[j]][coarse_i[i]] += data[k][j][i];
+					counts[(kc * ny + coarse_j[j]) * nx + coarse_i[i]]++;
+				}
+			}
+		}
+	}
+
+	float* newPtr = newImg->getRawPointer();
+	for (int idx = 0; idx < numNewVoxels; idx++)
+	{
+		if (counts[idx] > 0)
+		{
+			newPtr[idx] /= static_cast<float>(counts[idx]);
+		}
+	}
+	return newImg;
+}
+
+// Writes the voxels only (no image parameters), one chunk per slice
+void Image::writeToFileChunked(const std::string& fname,
+                               Util::ChunkCompression compression) const
+{
+	ASSERT(!fname.empty());
+	ASSERT(mp_array != nullptr);
+	mp_array->writeToFileChunked(fname, compression);
+}
+
 ImageOwned::ImageOwned(const ImageParams& imgParams) : Image{imgParams}
 {
 	mp_array = std::make_unique<Array3D<float>>();
@@ -1076,6 +1068,18 @@ mat44 ImageOwned::adjustAffineMatrix(mat44 matrix)
 
 void ImageOwned::readFromFile(const std::string& fname)
 {
+	if (Util::isChunkedFile(fname))
+	{
+		// Chunked files do not hold the image parameters
+		const ImageParams& params = getParams();
+		ASSERT_MSG(params.isValid(), "Image parameters are required to read "
+		                             "a chunked image file");
+		mp_array->readFromFile(fname, {static_cast<size_t>(params.nz),
+		                               static_cast<size_t>(params.ny),
+		                               static_cast<size_t>(params.nx)});
+		return;
+	}
+
 	nifti_image* niftiImage = nifti_image_read(fname.c_str(), 1);
 
 	if (niftiImage == nullptr)
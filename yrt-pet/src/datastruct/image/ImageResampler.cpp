@@ -0,0 +1,320 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "datastruct/image/ImageResampler.hpp"
+
+#include "utils/Assert.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if BUILD_PYBIND11
+#include <pybind11/pybind11.h>
+namespace py = pybind11;
+
+void py_setup_imageresampler(py::module& m)
+{
+	auto c = py::class_<ImageResampler>(m, "ImageResampler");
+	c.def_static("resample", &ImageResampler::resample, py::arg("src"),
+	             py::arg("dest"), py::arg("transform"),
+	             py::arg("weight") = 1.0f,
+	             py::arg("method") = ImageResampler::TRILINEAR);
+	c.def_static("identity", &ImageResampler::identity);
+	c.def_static("inverse", &ImageResampler::inverse, py::arg("transform"));
+	c.def_static("fromRotationAndTranslation",
+	             &ImageResampler::fromRotationAndTranslation,
+	             py::arg("rotation"), py::arg("translation"));
+
+	py::enum_<ImageResampler::InterpolationMethod>(c, "InterpolationMethod")
+	    .value("TRILINEAR", ImageResampler::InterpolationMethod::TRILINEAR)
+	    .value("CUBIC", ImageResampler::InterpolationMethod::CUBIC)
+	    .export_values();
+}
+#endif
+
+namespace
+{
+	// Affine mapping from the destination voxel indices (i, j, k) to the
+	// continuous source voxel indices (u, v, w), where integer values are
+	// the voxel centers
+	struct IndexMapping
+	{
+		double origin[3];
+		double stepX[3];
+		double stepY[3];
+		double stepZ[3];
+	};
+
+	IndexMapping computeIndexMapping(const ImageParams& srcParams,
+	                                 const ImageParams& destParams,
+	                                 const transform_t& t)
+	{
+		const transform_t inv = ImageResampler::inverse(t);
+		const double rot[3][3] = {{inv.r00, inv.r01, inv.r02},
+		                          {inv.r10, inv.r11, inv.r12},
+		                          {inv.r20, inv.r21, inv.r22}};
+		const double trans[3] = {inv.tx, inv.ty, inv.tz};
+
+		// Position (mm) of the first destination voxel and voxel sizes
+		const double destVoxelSize[3] = {destParams.vx, destParams.vy,
+		                                 destParams.vz};
+		const double destFirst[3] = {
+		    0.5 * (destParams.vx - destParams.length_x) + destParams.off_x,
+		    0.5 * (destParams.vy - destParams.length_y) + destParams.off_y,
+		    0.5 * (destParams.vz - destParams.length_z) + destParams.off_z};
+		// Source index = position * scale + shift
+		const double srcScale[3] = {srcParams.nx / srcParams.length_x,
+		                            srcParams.ny / srcParams.length_y,
+		                            srcParams.nz / srcParams.length_z};
+		const double srcShift[3] = {
+		    (0.5 * srcParams.length_x - srcParams.off_x) * srcScale[0] - 0.5,
+		    (0.5 * srcParams.length_y - srcParams.off_y) * srcScale[1] - 0.5,
+		    (0.5 * srcParams.length_z - srcParams.off_z) * srcScale[2] - 0.5};
+
+		IndexMapping mapping{};
+		for (int d = 0; d < 3; d++)
+		{
+			double pos = trans[d];
+			for (int e = 0; e < 3; e++)
+			{
+				pos += rot[d][e] * destFirst[e];
+			}
+			mapping.origin[d] = pos * srcScale[d] + srcShift[d];
+			mapping.stepX[d] = rot[d][0] * destVoxelSize[0] * srcScale[d];
+			mapping.stepY[d] = rot[d][1] * destVoxelSize[1] * srcScale[d];
+			mapping.stepZ[d] = rot[d][2] * destVoxelSize[2] * srcScale[d];
+		}
+		return mapping;
+	}
+
+	inline int clampIndex(int i, int n)
+	{
+		return std::min(std::max(i, 0), n - 1);
+	}
+
+	// Keys cubic convolution weights (a = -0.5) for the samples at
+	// floor(u) - 1, floor(u), floor(u) + 1 and floor(u) + 2
+	inline void cubicWeights(float t, float w[4])
+	{
+		w[0] = ((-0.5f * t + 1.0f) * t - 0.5f) * t;
+		w[1] = (1.5f * t - 2.5f) * t * t + 1.0f;
+		w[2] = ((-1.5f * t + 2.0f) * t + 0.5f) * t;
+		w[3] = (0.5f * t - 0.5f) * t * t;
+	}
+
+	template <ImageResampler::InterpolationMethod Method>
+	void resampleInternal(const float* src, int snx, int sny, int snz,
+	                      float* dest, int nx, int ny, int nz,
+	                      const IndexMapping& mapping, float weight)
+	{
+		const size_t srcSliceSize = static_cast<size_t>(snx) * sny;
+		const float upperX = static_cast<float>(snx) - 0.5f;
+		const float upperY = static_cast<float>(sny) - 0.5f;
+		const float upperZ = static_cast<float>(snz) - 0.5f;
+		const float duX = static_cast<float>(mapping.stepX[0]);
+		const float duY = static_cast<float>(mapping.stepX[1]);
+		const float duZ = static_cast<float>(mapping.stepX[2]);
+		const IndexMapping* mappingPtr = &mapping;
+
+#pragma omp parallel for collapse(2) default(none)                          \
+    firstprivate(src, snx, sny, snz, dest, nx, ny, nz, mappingPtr, weight, \
+                     srcSliceSize, upperX, upperY, upperZ, duX, duY, duZ)
+		for (int k = 0; k < nz; k++)
+		{
+			for (int j = 0; j < ny; j++)
+			{
+				// Source indices of the first voxel of the row
+				float rowStart[3];
+				for (int d = 0; d < 3; d++)
+				{
+					rowStart[d] = static_cast<float>(
+					    mappingPtr->origin[d] + j * mappingPtr->stepY[d] +
+					    k * mappingPtr->stepZ[d]);
+				}
+				const float u0 = rowStart[0];
+				const float v0 = rowStart[1];
+				const float w0 = rowStart[2];
+				float* destRow = dest + (static_cast<size_t>(k) * ny + j) * nx;
+
+#pragma omp simd
+				for (int i = 0; i < nx; i++)
+				{
+					float u = u0 + i * duX;
+					float v = v0 + i * duY;
+					float w = w0 + i * duZ;
+					// Without short-circuit, to avoid branches
+					const bool isInside = (u >= -0.5f) & (u < upperX) &
+					                      (v >= -0.5f) & (v < upperY) &
+					                      (w >= -0.5f) & (w < upperZ);
+					// Keeps the indices representable, the value is
+					// discarded anyway outside the image
+					u = std::min(std::max(u, -1.0f), upperX);
+					v = std::min(std::max(v, -1.0f), upperY);
+					w = std::min(std::max(w, -1.0f), upperZ);
+					// Floor through a truncation of positive values, which
+					// vectorizes without SSE4.1
+					const int iu = static_cast<int>(u + 1.0f) - 1;
+					const int iv = static_cast<int>(v + 1.0f) - 1;
+					const int iw = static_cast<int>(w + 1.0f) - 1;
+					const float tu = u - static_cast<float>(iu);
+					const float tv = v - static_cast<float>(iv);
+					const float tw = w - static_cast<float>(iw);
+
+					float value = 0.0f;
+					if constexpr (Method == ImageResampler::TRILINEAR)
+					{
+						const int x0 = clampIndex(iu, snx);
+						const int x1 = clampIndex(iu + 1, snx);
+						const size_t y0 = clampIndex(iv, sny) * snx;
+						const size_t y1 = clampIndex(iv + 1, sny) * snx;
+						const size_t z0 = clampIndex(iw, snz) * srcSliceSize;
+						const size_t z1 =
+						    clampIndex(iw + 1, snz) * srcSliceSize;
+
+						const float c00 = src[z0 + y0 + x0] * (1.0f - tu) +
+						                  src[z0 + y0 + x1] * tu;
+						const float c01 = src[z0 + y1 + x0] * (1.0f - tu) +
+						                  src[z0 + y1 + x1] * tu;
+						const float c10 = src[z1 + y0 + x0] * (1.0f - tu) +
+						                  src[z1 + y0 + x1] * tu;
+						const float c11 = src[z1 + y1 + x0] * (1.0f - tu) +
+						                  src[z1 + y1 + x1] * tu;
+						const float c0 = c00 * (1.0f - tv) + c01 * tv;
+						const float c1 = c10 * (1.0f - tv) + c11 * tv;
+						value = c0 * (1.0f - tw) + c1 * tw;
+					}
+					else
+					{
+						float weightsX[4], weightsY[4], weightsZ[4];
+						cubicWeights(tu, weightsX);
+						cubicWeights(tv, weightsY);
+						cubicWeights(tw, weightsZ);
+						for (int c = 0; c < 4; c++)
+						{
+							const size_t zOffset =
+							    clampIndex(iw - 1 + c, snz) * srcSliceSize;
+							float valueY = 0.0f;
+							for (int b = 0; b < 4; b++)
+							{
+								const float* srcRow =
+								    src + zOffset +
+								    clampIndex(iv - 1 + b, sny) * snx;
+								float valueX = 0.0f;
+								for (int a = 0; a < 4; a++)
+								{
+									valueX += weightsX[a] *
+									          srcRow[clampIndex(iu - 1 + a, snx)];
+								}
+								valueY += weightsY[b] * valueX;
+							}
+							value += weightsZ[c] * valueY;
+						}
+					}
+					destRow[i] += isInside ? weight * value : 0.0f;
+				}
+			}
+		}
+	}
+}  // namespace
+
+void ImageResampler::resample(const Image& src, Image& dest,
+                              const transform_t& t, float weight,
+                              InterpolationMethod method)
+{
+	ASSERT_MSG(src.isMemoryValid(), "Source image not allocated");
+	ASSERT_MSG(dest.isMemoryValid(), "Destination image not allocated");
+	ASSERT_MSG(src.getRawPointer() != dest.getRawPointer(),
+	           "The source and destination images must be different");
+
+	const ImageParams& srcParams = src.getParams();
+	const ImageParams& destParams = dest.getParams();
+	const IndexMapping mapping =
+	    computeIndexMapping(srcParams, destParams, t);
+
+	if (method == CUBIC)
+	{
+		resampleInternal<CUBIC>(src.getRawPointer(), srcParams.nx,
+		                        srcParams.ny, srcParams.nz,
+		                        dest.getRawPointer(), destParams.nx,
+		                        destParams.ny, destParams.nz, mapping, weight);
+	}
+	else
+	{
+		resampleInternal<TRILINEAR>(
+		    src.getRawPointer(), srcParams.nx, srcParams.ny, srcParams.nz,
+		    dest.getRawPointer(), destParams.nx, destParams.ny, destParams.nz,
+		    mapping, weight);
+	}
+}
+
+transform_t ImageResampler::identity()
+{
+	return {1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+	        0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f};
+}
+
+transform_t ImageResampler::inverse(const transform_t& t)
+{
+	// Inverse of the 3x3 matrix through its adjugate
+	const double a[3][3] = {
+	    {t.r00, t.r01, t.r02}, {t.r10, t.r11, t.r12}, {t.r20, t.r21, t.r22}};
+	const double det = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+	                   a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+	                   a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+	ASSERT_MSG(std::abs(det) > 1e-12, "The transform is not invertible");
+	double inv[3][3];
+	for (int row = 0; row < 3; row++)
+	{
+		for (int col = 0; col < 3; col++)
+		{
+			// Cofactor of a[col][row]
+			const int r0 = (col + 1) % 3;
+			const int r1 = (col + 2) % 3;
+			const int c0 = (row + 1) % 3;
+			const int c1 = (row + 2) % 3;
+			inv[row][col] =
+			    (a[r0][c0] * a[r1][c1] - a[r0][c1] * a[r1][c0]) / det;
+		}
+	}
+	const double trans[3] = {t.tx, t.ty, t.tz};
+	double invTrans[3];
+	for (int row = 0; row < 3; row++)
+	{
+		invTrans[row] = -(inv[row][0] * trans[0] + inv[row][1] * trans[1] +
+		                  inv[row][2] * trans[2]);
+	}
+	return {static_cast<float>(inv[0][0]),  static_cast<float>(inv[0][1]),
+	        static_cast<float>(inv[0][2]),  static_cast<float>(inv[1][0]),
+	        static_cast<float>(inv[1][1]),  static_cast<float>(inv[1][2]),
+	        static_cast<float>(inv[2][0]),  static_cast<float>(inv[2][1]),
+	        static_cast<float>(inv[2][2]),  static_cast<float>(invTrans[0]),
+	        static_cast<float>(invTrans[1]), static_cast<float>(invTrans[2])};
+}
+
+transform_t ImageResampler::fromRotationAndTranslation(
+    const Vector3D& rotation, const Vector3D& translation)
+{
+	const double cosA = std::cos(rotation.z);
+	const double sinA = std::sin(rotation.z);
+	const double cosB = std::cos(rotation.y);
+	const double sinB = std::sin(rotation.y);
+	const double cosG = std::cos(rotation.x);
+	const double sinG = std::sin(rotation.x);
+
+	transform_t t;
+	t.r00 = static_cast<float>(cosA * cosB);
+	t.r01 = static_cast<float>(-sinA * cosG + sinB * sinG * cosA);
+	t.r02 = static_cast<float>(sinA * sinG + sinB * cosA * cosG);
+	t.r10 = static_cast<float>(sinA * cosB);
+	t.r11 = static_cast<float>(sinA * sinB * sinG + cosA * cosG);
+	t.r12 = static_cast<float>(sinA * sinB * cosG - sinG * cosA);
+	t.r20 = static_cast<float>(-sinB);
+	t.r21 = static_cast<float>(sinG * cosB);
+	t.r22 = static_cast<float>(cosB * cosG);
+	t.tx = translation.x;
+	t.ty = translation.y;
+	t.tz = translation.z;
+	return t;
+}
@@ -15,3 +15,13 @@ void py_setup_histogram(py::module& m)
 #endif
 
 Histogram::Histogram(const Scanner& pr_scanner) : ProjectionData{pr_scanner} {}
+
+det_pair_t Histogram::getDetPairFromHistogramBin(histo_bin_t histoBinId)
+{
+	if (std::holds_alternative<det_pair_tof_t>(histoBinId))
+	{
+		const det_pair_tof_t detPairTOF = std::get<det_pair_tof_t>(histoBinId);
+		return {detPairTOF.d1, detPairTOF.d2};
+	}
+	return std::get<det_pair_t>(histoBinId);
+}
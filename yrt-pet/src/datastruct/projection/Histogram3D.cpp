@@ -27,6 +27,9 @@ void py_setup_histogram3d(pybind11::module& m)
 		                           d.getDims(), d.getStrides());
 	    });
 	c.def("writeToFile", &Histogram3D::writeToFile, py::arg("fname"));
+	c.def("writeToFileChunked", &Histogram3D::writeToFileChunked,
+	      py::arg("fname"),
+	      py::arg("compression") = Util::ChunkCompression::ZLIB);
 	c.def("getShape", [](const Histogram3D& self)
 	      { return py::make_tuple(self.numZBin, self.numPhi, self.numR); });
 	c.def("getBinIdFromCoords", &Histogram3D::getBinIdFromCoords, py::arg("r"),
@@ -116,6 +119,11 @@ void py_setup_histogram3d(pybind11::module& m)
 	            py::arg("fname"));
 	c_owned.def("allocate", &Histogram3DOwned::allocate);
 
+	auto c_mapped =
+	    py::class_<Histogram3DMapped, Histogram3D>(m, "Histogram3DMapped");
+	c_mapped.def(py::init<const Scanner&, std::string>(), py::arg("scanner"),
+	             py::arg("fname"));
+
 	auto c_alias =
 	    py::class_<Histogram3DAlias, Histogram3D>(m, "Histogram3DAlias");
 	c_alias.def(py::init<const Scanner&>(), py::arg("scanner"));
@@ -196,6 +204,31 @@ Histogram3DAlias::Histogram3DAlias(const Scanner& pr_scanner)
 	mp_data = std::make_unique<Array3DAlias<float>>();
 }
 
+Histogram3DMapped::Histogram3DMapped(const Scanner& pr_scanner,
+                                     const std::string& filename)
+    : Histogram3D(pr_scanner)
+{
+	if (!Util::isChunkedFile(filename))
+	{
+		throw std::invalid_argument("The file \"" + filename +
+		                            "\" is not a chunked file and cannot be "
+		                            "memory-mapped");
+	}
+	mp_mapping = std::make_unique<Util::ChunkedFileMapping>(filename);
+	const Util::ChunkedFileHeader& header = mp_mapping->getHeader();
+	const std::vector<size_t> dims{numZBin, numPhi, numR};
+	if (header.shape != dims || header.elementSize != sizeof(float))
+	{
+		throw std::runtime_error(
+		    "Error during Histogram initialization: the scanner\'s attributes "
+		    "do not match the histogram given");
+	}
+	auto data = std::make_unique<Array3DAlias<float>>();
+	data->bind(static_cast<float*>(mp_mapping->getData()), numZBin, numPhi,
+	           numR);
+	mp_data = std::move(data);
+}
+
 void Histogram3DOwned::readFromFile(const std::string& filename)
 {
 	std::array<size_t, 3> dims{numZBin, numPhi, numR};
@@ -228,11 +261,148 @@ void Histogram3DOwned::allocate()
 	    ->allocate(numZBin, numPhi, numR);
 }
 
+Array3DBase<float>& Histogram3D::getData()
+{
+	if (mp_data == nullptr)
+	{
+		throw std::runtime_error("This histogram holds no float array");
+	}
+	return *mp_data;
+}
+
+const Array3DBase<float>& Histogram3D::getData() const
+{
+	if (mp_data == nullptr)
+	{
+		throw std::runtime_error("This histogram holds no float array");
+	}
+	return *mp_data;
+}
+
 void Histogram3D::writeToFile(const std::string& filename) const
 {
 	mp_data->writeToFile(filename);
 }
 
+void Histogram3D::writeToFileChunked(const std::string& filename,
+                                     Util::ChunkCompression compression) const
+{
+	// One chunk per z_bin, filled through getProjectionValue so that every
+	// storage variant can be written
+	const size_t sliceSize = numPhi * numR;
+	Util::writeChunkedFile(
+	    filename, {numZBin, numPhi, numR}, sizeof(float),
+	    [this, sliceSize](size_t firstSlab, size_t numSlabs, void* dst)
+	    {
+		    auto* dst_float = static_cast<float*>(dst);
+		    const bin_t start = firstSlab * sliceSize;
+		    const size_t numBins = numSlabs * sliceSize;
+		    for (size_t i = 0; i < numBins; i++)
+		    {
+			    dst_float[i] = getProjectionValue(start + i);
+		    }
+	    },
+	    compression);
+}
+
+void Histogram3D::readFromFileBySlice(
+    const std::string& filename,
+    const std::function<void(coord_t z_bin, const float* slice)>& func) const
+{
+	const size_t sliceSize = numPhi * numR;
+	auto slice = std::make_unique<float[]>(sliceSize);
+
+	if (Util::isChunkedFile(filename))
+	{
+		const Util::ChunkedFileHeader header =
+		    Util::readChunkedFileHeader(filename);
+		if (header.shape != std::vector<size_t>{numZBin, numPhi, numR} ||
+		    header.elementSize != sizeof(float))
+		{
+			throw std::runtime_error(
+			    "The file given \"" + filename +
+			    "\" has dimension sizes that do not match the scanner");
+		}
+		for (coord_t z_bin = 0; z_bin < numZBin; z_bin++)
+		{
+			Util::readChunkedFile(filename, header, slice.get(), z_bin, 1);
+			func(z_bin, slice.get());
+		}
+		return;
+	}
+
+	std::ifstream file;
+	file.open(filename.c_str(), std::ios::binary | std::ios::in);
+	if (!file.is_open())
+	{
+		throw std::filesystem::filesystem_error(
+		    "The file given \"" + filename + "\" could not be opened",
+		    std::make_error_code(std::errc::no_such_file_or_directory));
+	}
+
+	file.seekg(0, std::ios::end);
+	const size_t fileSize = file.tellg();
+	file.seekg(0, std::ios::beg);
+
+	int magic = 0;
+	int num_dims = 0;
+	size_t dims[3];
+	file.read((char*)&magic, sizeof(int));
+	file.read((char*)&num_dims, sizeof(int));
+	if (magic != MAGIC_NUMBER || num_dims != 3)
+	{
+		throw std::runtime_error("The file given \"" + filename +
+		                         "\" is not a valid histogram file");
+	}
+	file.read((char*)dims, 3 * sizeof(size_t));
+	if (dims[0] != numZBin || dims[1] != numPhi || dims[2] != numR)
+	{
+		throw std::runtime_error(
+		    "The file given \"" + filename +
+		    "\" has dimension sizes that do not match the scanner");
+	}
+	constexpr size_t headerSize = 2 * sizeof(int) + 3 * sizeof(size_t);
+	if (fileSize != headerSize + histoSize * sizeof(float))
+	{
+		throw std::runtime_error("The file given \"" + filename +
+		                         "\" is of the wrong size");
+	}
+
+	for (coord_t z_bin = 0; z_bin < numZBin; z_bin++)
+	{
+		file.read((char*)slice.get(), sliceSize * sizeof(float));
+		func(z_bin, slice.get());
+	}
+}
+
+void Histogram3D::writeToFileBySlice(
+    const std::string& filename,
+    const std::function<void(coord_t z_bin, float* slice)>& func) const
+{
+	std::ofstream file;
+	file.open(filename.c_str(), std::ios::binary | std::ios::out);
+	if (!file.is_open())
+	{
+		throw std::filesystem::filesystem_error(
+		    "The file given \"" + filename + "\" could not be opened",
+		    std::make_error_code(std::errc::io_error));
+	}
+	int magic = MAGIC_NUMBER;
+	int num_dims = 3;
+	const size_t shape[3]{numZBin, numPhi, numR};
+	file.write((char*)&magic, sizeof(int));
+	file.write((char*)&num_dims, sizeof(int));
+	file.write((char*)shape, 3 * sizeof(size_t));
+
+	const size_t sliceSize = numPhi * numR;
+	auto slice = std::make_unique<float[]>(sliceSize);
+	for (coord_t z_bin = 0; z_bin < numZBin; z_bin++)
+	{
+		func(z_bin, slice.get());
+		file.write((char*)slice.get(), sliceSize * sizeof(float));
+	}
+}
+
 bin_t Histogram3D::getBinIdFromCoords(coord_t r, coord_t phi,
                                       coord_t z_bin) const
 {
@@ -484,6 +654,15 @@ det_pair_t Histogram3D::getDetectorPair(bin_t id) const
 	return getDetPairFromBinId(id);
 }
 
+void Histogram3D::getDetectorPairs(const bin_t* bins, size_t numBins,
+                                   det_pair_t* detPairs) const
+{
+	for (size_t i = 0; i < numBins; i++)
+	{
+		detPairs[i] = getDetPairFromBinId(bins[i]);
+	}
+}
+
 void Histogram3D::getZ1Z2(coord_t z_bin, coord_t& z1, coord_t& z2) const
 {
 	if (z_bin < mr_scanner.numRings)
@@ -553,7 +732,7 @@ float Histogram3D::getProjectionValueFromHistogramBin(
 	}
 
 	// use the detector pair
-	const auto [d1, d2] = std::get<det_pair_t>(histoBinId);
+	const auto [d1, d2] = getDetPairFromHistogramBin(histoBinId);
 	const bin_t binId = getBinIdFromDetPair(d1, d2);
 	return getProjectionValue(binId);
 }
@@ -563,14 +742,19 @@ std::unique_ptr<ProjectionData>
                              const std::string& filename,
                              const Plugin::OptionsResult& pluginOptions)
 {
-	(void)pluginOptions;  // No use for extra options
+	if (pluginOptions.count("mmap"))
+	{
+		return std::make_unique<Histogram3DMapped>(scanner, filename);
+	}
 	return std::make_unique<Histogram3DOwned>(scanner, filename);
 }
 
 Plugin::OptionsListPerPlugin Histogram3DOwned::getOptions()
 {
-	// No extra options
-	return {};
+	return {{"mmap",
+	         {"Memory-map the histogram instead of reading it (uncompressed "
+	          "chunked files only)",
+	          true}}};
 }
 
 REGISTER_PROJDATA_PLUGIN("H", Histogram3DOwned, Histogram3DOwned::create,
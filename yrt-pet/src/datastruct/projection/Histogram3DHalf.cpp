@@ -0,0 +1,198 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "datastruct/projection/Histogram3DHalf.hpp"
+
+#include "utils/HalfPrecision.hpp"
+
+#if BUILD_PYBIND11
+#include <pybind11/pybind11.h>
+namespace py = pybind11;
+
+void py_setup_histogram3dhalf(py::module& m)
+{
+	auto c = py::class_<Histogram3DHalf, Histogram3D>(m, "Histogram3DHalf");
+	py::enum_<Histogram3DHalf::Encoding>(c, "Encoding")
+	    .value("FP16", Histogram3DHalf::Encoding::FP16)
+	    .value("BF16", Histogram3DHalf::Encoding::BF16)
+	    .export_values();
+	c.def(py::init<const Scanner&, Histogram3DHalf::Encoding>(),
+	      py::arg("scanner"),
+	      py::arg("encoding") = Histogram3DHalf::Encoding::FP16);
+	c.def(py::init<const Scanner&, const std::string&,
+	               Histogram3DHalf::Encoding>(),
+	      py::arg("scanner"), py::arg("fname"),
+	      py::arg("encoding") = Histogram3DHalf::Encoding::FP16);
+	c.def(py::init<const Histogram3D&, Histogram3DHalf::Encoding>(),
+	      py::arg("histogram"),
+	      py::arg("encoding") = Histogram3DHalf::Encoding::FP16);
+	c.def("allocate", &Histogram3DHalf::allocate);
+	c.def("readFromFile", &Histogram3DHalf::readFromFile, py::arg("fname"));
+	c.def("getEncoding", &Histogram3DHalf::getEncoding);
+}
+#endif
+
+Histogram3DHalf::Histogram3DHalf(const Scanner& pr_scanner,
+                                 Encoding p_encoding)
+    : Histogram3D(pr_scanner), m_encoding(p_encoding)
+{
+}
+
+Histogram3DHalf::Histogram3DHalf(const Scanner& pr_scanner,
+                                 const std::string& filename,
+                                 Encoding p_encoding)
+    : Histogram3DHalf(pr_scanner, p_encoding)
+{
+	readFromFile(filename);
+}
+
+Histogram3DHalf::Histogram3DHalf(const Histogram3D& pr_source,
+                                 Encoding p_encoding)
+    : Histogram3DHalf(pr_source.getScanner(), p_encoding)
+{
+	allocate();
+	uint16_t* encodedPtr = m_encodedData.getRawPointer();
+	const Histogram3D* source = &pr_source;
+	const bin_t numBins = histoSize;
+#pragma omp parallel for default(none) \
+    firstprivate(encodedPtr, source, numBins)
+	for (bin_t binId = 0; binId < numBins; binId++)
+	{
+		encodedPtr[binId] = encode(source->getProjectionValue(binId));
+	}
+}
+
+void Histogram3DHalf::allocate()
+{
+	m_encodedData.allocate(numZBin, numPhi, numR);
+}
+
+void Histogram3DHalf::readFromFile(const std::string& filename)
+{
+	allocate();
+	const size_t sliceSize = numPhi * numR;
+	try
+	{
+		readFromFileBySlice(
+		    filename,
+		    [this, sliceSize](coord_t z_bin, const float* slice)
+		    {
+			    uint16_t* encodedSlice = m_encodedData.getSlicePtr(z_bin);
+			    for (size_t i = 0; i < sliceSize; i++)
+			    {
+				    encodedSlice[i] = encode(slice[i]);
+			    }
+		    });
+	}
+	catch (const std::exception& e)
+	{
+		throw std::runtime_error(
+		    "Error during Histogram initialization either the scanner\'s "
+		    "attributes do not match the histogram given, the file given is "
+		    "inexistant or the file given is not a valid histogram file");
+	}
+}
+
+void Histogram3DHalf::writeToFile(const std::string& filename) const
+{
+	const size_t sliceSize = numPhi * numR;
+	writeToFileBySlice(filename,
+	                   [this, sliceSize](coord_t z_bin, float* slice)
+	                   {
+		                   const uint16_t* encodedSlice =
+		                       m_encodedData.getSlicePtr(z_bin);
+		                   for (size_t i = 0; i < sliceSize; i++)
+		                   {
+			                   slice[i] = decode(encodedSlice[i]);
+		                   }
+	                   });
+}
+
+Array3DBase<float>& Histogram3DHalf::getData()
+{
+	throw std::runtime_error("Histogram3DHalf holds no float array, use "
+	                         "getProjectionValue or getEncodedData instead");
+}
+
+const Array3DBase<float>& Histogram3DHalf::getData() const
+{
+	throw std::runtime_error("Histogram3DHalf holds no float array, use "
+	                         "getProjectionValue or getEncodedData instead");
+}
+
+float Histogram3DHalf::getProjectionValue(bin_t binId) const
+{
+	return decode(m_encodedData.getFlat(binId));
+}
+
+void Histogram3DHalf::setProjectionValue(bin_t binId, float val)
+{
+	m_encodedData.setFlat(binId, encode(val));
+}
+
+void Histogram3DHalf::incrementProjection(bin_t binId, float val)
+{
+	uint16_t& encodedVal = m_encodedData.getFlat(binId);
+	encodedVal = encode(decode(encodedVal) + val);
+}
+
+void Histogram3DHalf::clearProjections(float value)
+{
+	m_encodedData.fill(encode(value));
+}
+
+Histogram3DHalf::Encoding Histogram3DHalf::getEncoding() const
+{
+	return m_encoding;
+}
+
+Array3DBase<uint16_t>& Histogram3DHalf::getEncodedData()
+{
+	return m_encodedData;
+}
+
+const Array3DBase<uint16_t>& Histogram3DHalf::getEncodedData() const
+{
+	return m_encodedData;
+}
+
+uint16_t Histogram3DHalf::encode(float val) const
+{
+	if (m_encoding == Encoding::BF16)
+	{
+		return Util::floatToBFloat16(val);
+	}
+	return Util::floatToHalf(val);
+}
+
+float Histogram3DHalf::decode(uint16_t val) const
+{
+	if (m_encoding == Encoding::BF16)
+	{
+		return Util::bfloat16ToFloat(val);
+	}
+	return Util::halfToFloat(val);
+}
+
+std::unique_ptr<ProjectionData>
+    Histogram3DHalf::create(const Scanner& scanner, const std::string& filename,
+                            const Plugin::OptionsResult& pluginOptions)
+{
+	const auto bf16_it = pluginOptions.find("bf16");
+	const bool useBF16 =
+	    bf16_it != pluginOptions.end() && bf16_it->second != "0";
+	return std::make_unique<Histogram3DHalf>(
+	    scanner, filename, useBF16 ? Encoding::BF16 : Encoding::FP16);
+}
+
+Plugin::OptionsListPerPlugin Histogram3DHalf::getOptions()
+{
+	return {{"bf16",
+	         {"Store the histogram in bfloat16 instead of IEEE half-precision",
+	          true}}};
+}
+
+REGISTER_PROJDATA_PLUGIN("H16", Histogram3DHalf, Histogram3DHalf::create,
+                         Histogram3DHalf::getOptions)
@@ -0,0 +1,255 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "datastruct/projection/Histogram3DSparseDefault.hpp"
+
+#include <algorithm>
+
+#if BUILD_PYBIND11
+#include <pybind11/pybind11.h>
+namespace py = pybind11;
+
+void py_setup_histogram3dsparsedefault(py::module& m)
+{
+	auto c = py::class_<Histogram3DSparseDefault, Histogram3D>(
+	    m, "Histogram3DSparseDefault");
+	c.def(py::init<const Scanner&, float>(), py::arg("scanner"),
+	      py::arg("defaultValue") = 1.0f);
+	c.def(py::init<const Scanner&, const std::string&, float>(),
+	      py::arg("scanner"), py::arg("fname"), py::arg("defaultValue") = 1.0f);
+	c.def(py::init<const Histogram3D&, float>(), py::arg("histogram"),
+	      py::arg("defaultValue") = 1.0f);
+	c.def("readFromFile", &Histogram3DSparseDefault::readFromFile,
+	      py::arg("fname"));
+	c.def("compact", &Histogram3DSparseDefault::compact);
+	c.def("getDefaultValue", &Histogram3DSparseDefault::getDefaultValue);
+	c.def("getNumBlocks", &Histogram3DSparseDefault::getNumBlocks);
+	c.def("getNumAllocatedBlocks",
+	      &Histogram3DSparseDefault::getNumAllocatedBlocks);
+}
+#endif
+
+Histogram3DSparseDefault::Histogram3DSparseDefault(const Scanner& pr_scanner,
+                                                   float p_defaultValue)
+    : Histogram3D(pr_scanner), m_defaultValue(p_defaultValue)
+{
+	m_blocks.resize((histoSize + BlockSize - 1) / BlockSize);
+}
+
+Histogram3DSparseDefault::Histogram3DSparseDefault(const Scanner& pr_scanner,
+                                                   const std::string& filename,
+                                                   float p_defaultValue)
+    : Histogram3DSparseDefault(pr_scanner, p_defaultValue)
+{
+	readFromFile(filename);
+}
+
+Histogram3DSparseDefault::Histogram3DSparseDefault(const Histogram3D& pr_source,
+                                                   float p_defaultValue)
+    : Histogram3DSparseDefault(pr_source.getScanner(), p_defaultValue)
+{
+	operationOnEachBinParallel([&pr_source](bin_t binId) -> float
+	                           { return pr_source.getProjectionValue(binId); });
+}
+
+void Histogram3DSparseDefault::readFromFile(const std::string& filename)
+{
+	clearProjections(m_defaultValue);
+	const size_t sliceSize = numPhi * numR;
+	try
+	{
+		readFromFileBySlice(
+		    filename,
+		    [this, sliceSize](coord_t z_bin, const float* slice)
+		    {
+			    const bin_t sliceStart = z_bin * sliceSize;
+			    for (size_t i = 0; i < sliceSize; i++)
+			    {
+				    if (slice[i] != m_defaultValue)
+				    {
+					    setProjectionValue(sliceStart + i, slice[i]);
+				    }
+			    }
+		    });
+	}
+	catch (const std::exception& e)
+	{
+		throw std::runtime_error(
+		    "Error during Histogram initialization either the scanner\'s "
+		    "attributes do not match the histogram given, the file given is "
+		    "inexistant or the file given is not a valid histogram file");
+	}
+}
+
+void Histogram3DSparseDefault::writeToFile(const std::string& filename) const
+{
+	const size_t sliceSize = numPhi * numR;
+	writeToFileBySlice(filename,
+	                   [this, sliceSize](coord_t z_bin, float* slice)
+	                   {
+		                   const bin_t sliceStart = z_bin * sliceSize;
+		                   for (size_t i = 0; i < sliceSize; i++)
+		                   {
+			                   slice[i] = getProjectionValue(sliceStart + i);
+		                   }
+	                   });
+}
+
+Array3DBase<float>& Histogram3DSparseDefault::getData()
+{
+	throw std::runtime_error("Histogram3DSparseDefault holds no float array, "
+	                         "use getProjectionValue instead");
+}
+
+const Array3DBase<float>& Histogram3DSparseDefault::getData() const
+{
+	throw std::runtime_error("Histogram3DSparseDefault holds no float array, "
+	                         "use getProjectionValue instead");
+}
+
+float Histogram3DSparseDefault::getProjectionValue(bin_t binId) const
+{
+	const float* block = m_blocks[binId / BlockSize].get();
+	if (block == nullptr)
+	{
+		return m_defaultValue;
+	}
+	return block[binId % BlockSize];
+}
+
+void Histogram3DSparseDefault::setProjectionValue(bin_t binId, float val)
+{
+	const size_t blockId = binId / BlockSize;
+	float* block = m_blocks[blockId].get();
+	if (block == nullptr)
+	{
+		if (val == m_defaultValue)
+		{
+			return;
+		}
+		block = allocateBlock(blockId);
+	}
+	block[binId % BlockSize] = val;
+}
+
+void Histogram3DSparseDefault::incrementProjection(bin_t binId, float val)
+{
+	setProjectionValue(binId, getProjectionValue(binId) + val);
+}
+
+void Histogram3DSparseDefault::clearProjections(float value)
+{
+	m_defaultValue = value;
+	for (auto& block : m_blocks)
+	{
+		block.reset();
+	}
+}
+
+void Histogram3DSparseDefault::operationOnEachBinParallel(
+    const std::function<float(bin_t)>& func)
+{
+	// Each thread handles whole blocks so that the allocations never collide
+	const size_t numBlocks = m_blocks.size();
+	const bin_t numBins = histoSize;
+#pragma omp parallel for default(none) firstprivate(numBlocks, numBins, func)
+	for (size_t blockId = 0; blockId < numBlocks; blockId++)
+	{
+		float values[BlockSize];
+		const bin_t blockStart = blockId * BlockSize;
+		const size_t blockLength =
+		    std::min<bin_t>(BlockSize, numBins - blockStart);
+		std::fill(values, values + BlockSize, m_defaultValue);
+		for (size_t i = 0; i < blockLength; i++)
+		{
+			values[i] = func(blockStart + i);
+		}
+		fillBlock(blockId, values);
+	}
+}
+
+void Histogram3DSparseDefault::compact()
+{
+	const size_t numBlocks = m_blocks.size();
+#pragma omp parallel for default(none) firstprivate(numBlocks)
+	for (size_t blockId = 0; blockId < numBlocks; blockId++)
+	{
+		const float* block = m_blocks[blockId].get();
+		if (block != nullptr)
+		{
+			float values[BlockSize];
+			std::copy(block, block + BlockSize, values);
+			fillBlock(blockId, values);
+		}
+	}
+}
+
+float Histogram3DSparseDefault::getDefaultValue() const
+{
+	return m_defaultValue;
+}
+
+size_t Histogram3DSparseDefault::getNumBlocks() const
+{
+	return m_blocks.size();
+}
+
+size_t Histogram3DSparseDefault::getNumAllocatedBlocks() const
+{
+	return std::count_if(m_blocks.begin(), m_blocks.end(),
+	                     [](const std::unique_ptr<float[]>& block)
+	                     { return block != nullptr; });
+}
+
+float* Histogram3DSparseDefault::allocateBlock(size_t blockId)
+{
+	m_blocks[blockId] = std::make_unique<float[]>(BlockSize);
+	float* block = m_blocks[blockId].get();
+	std::fill(block, block + BlockSize, m_defaultValue);
+	return block;
+}
+
+void Histogram3DSparseDefault::fillBlock(size_t blockId, const float* values)
+{
+	const bool isDefault =
+	    std::all_of(values, values + BlockSize,
+	                [this](float val) { return val == m_defaultValue; });
+	if (isDefault)
+	{
+		m_blocks[blockId].reset();
+		return;
+	}
+	float* block = m_blocks[blockId].get();
+	if (block == nullptr)
+	{
+		block = allocateBlock(blockId);
+	}
+	std::copy(values, values + BlockSize, block);
+}
+
+std::unique_ptr<ProjectionData> Histogram3DSparseDefault::create(
+    const Scanner& scanner, const std::string& filename,
+    const Plugin::OptionsResult& pluginOptions)
+{
+	const auto defaultValue_it = pluginOptions.find("default_value");
+	if (defaultValue_it == pluginOptions.end())
+	{
+		return std::make_unique<Histogram3DSparseDefault>(scanner, filename);
+	}
+	const float defaultValue = std::stof(defaultValue_it->second);
+	return std::make_unique<Histogram3DSparseDefault>(scanner, filename,
+	                                                  defaultValue);
+}
+
+Plugin::OptionsListPerPlugin Histogram3DSparseDefault::getOptions()
+{
+	return {{"default_value",
+	         {"Value shared by most bins of the histogram (Default: 1)",
+	          false}}};
+}
+
+REGISTER_PROJDATA_PLUGIN("H-SPARSE", Histogram3DSparseDefault,
+                         Histogram3DSparseDefault::create,
+                         Histogram3DSparseDefault::getOptions)
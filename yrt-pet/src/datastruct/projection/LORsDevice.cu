@@ -41,6 +41,8 @@ void LORsDevice::loadEventLORs(const BinIterator& binIter,
 {
 	m_areLORsGathered = false;
 	const bool hasTOF = reference.hasTOF();
+	ASSERT_MSG(!reference.hasLORBundles(),
+	           "Bins grouping several LORs are not supported on GPU");
 
 	const size_t batchSize = batchSetup.getBatchSize(batchId);
 
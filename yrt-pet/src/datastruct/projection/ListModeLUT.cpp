@@ -11,6 +11,7 @@
 #include "utils/Globals.hpp"
 #include "utils/ReconstructionUtils.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <fstream>
@@ -19,6 +20,7 @@
 #if BUILD_PYBIND11
 #include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 
 namespace py = pybind11;
 
@@ -72,6 +74,11 @@ void py_setup_listmodelut(py::module& m)
 		      return py::array_t<float>(buf_info);
 	      });
 	c.def("addLORMotion", &ListModeLUT::addLORMotion);
+	c.def("getEventRangeOfFrame", &ListModeLUT::getEventRangeOfFrame,
+	      py::arg("frame"));
+	c.def("precomputeMotionCorrectedLORs",
+	      &ListModeLUT::precomputeMotionCorrectedLORs);
+	c.def("hasMotionCorrectedLORs", &ListModeLUT::hasMotionCorrectedLORs);
 
 	c.def("writeToFile", &ListModeLUT::writeToFile);
 	c.def("getNativeLORFromId", &ListModeLUT::getNativeLORFromId);
@@ -263,40 +270,208 @@ void ListModeLUT::writeToFile(const std::string& listMode_fname) const
 void ListModeLUT::addLORMotion(const std::string& lorMotion_fname)
 {
 	mp_lorMotion = std::make_unique<LORMotion>(lorMotion_fname);
-	mp_frames = std::make_unique<Array1D<frame_t>>();
-	const size_t numEvents = count();
-	mp_frames->allocate(numEvents);
+	mp_motionCorrectedLORs = nullptr;
 
-	// Populate the frames
 	const frame_t numFrames =
 	    static_cast<frame_t>(mp_lorMotion->getNumFrames());
-	bin_t evId = 0;
-
-	// Skip the events that are before the first frame
-	const timestamp_t firstTimestamp = mp_lorMotion->getStartingTimestamp(0);
-	while (getTimestamp(evId) < firstTimestamp)
+	for (frame_t frame = 1; frame < numFrames; frame++)
 	{
-		mp_frames->setFlat(evId, -1);
-		evId++;
+		ASSERT_MSG(mp_lorMotion->getStartingTimestamp(frame - 1) <=
+		               mp_lorMotion->getStartingTimestamp(frame),
+		           "The frames of the LOR motion must be sorted in time");
 	}
 
-	// Fill the events in the middle
-	frame_t currentFrame;
-	for (currentFrame = 0; currentFrame < numFrames - 1; currentFrame++)
+	// Since the events are sorted, the frames are contiguous ranges of
+	// events, found by binary search on their starting timestamps
+	const size_t numEvents = count();
+	m_firstEventOfFrame.resize(numFrames + 1);
+	m_firstEventOfFrame[numFrames] = numEvents;
+	bin_t* firstEventOfFrame = m_firstEventOfFrame.data();
+	const LORMotion* lorMotion = mp_lorMotion.get();
+	const ListModeLUT* self = this;
+
+#pragma omp parallel for default(none) \
+    firstprivate(numFrames, numEvents, firstEventOfFrame, lorMotion, self)
+	for (frame_t frame = 0; frame < numFrames; frame++)
 	{
-		const timestamp_t endingTimestamp =
-		    mp_lorMotion->getStartingTimestamp(currentFrame + 1);
-		while (evId < numEvents && getTimestamp(evId) < endingTimestamp)
+		// First event at or after the beginning of the frame
+		const timestamp_t startingTimestamp =
+		    lorMotion->getStartingTimestamp(frame);
+		bin_t first = 0;
+		bin_t last = numEvents;
+		while (first < last)
 		{
-			mp_frames->setFlat(evId, currentFrame);
-			evId++;
+			const bin_t middle = first + (last - first) / 2;
+			if (self->getTimestamp(middle) < startingTimestamp)
+			{
+				first = middle + 1;
+			}
+			else
+			{
+				last = middle;
+			}
 		}
+		firstEventOfFrame[frame] = first;
+	}
+}
+
+std::pair<bin_t, bin_t> ListModeLUT::getEventRangeOfFrame(frame_t frame) const
+{
+	ASSERT_MSG(hasMotion(), "The list-mode has no motion");
+	ASSERT_MSG(frame >= 0 && frame < static_cast<frame_t>(getNumFrames()),
+	           "Frame out of range");
+	// The last frame also has the events after its beginning
+	return {m_firstEventOfFrame[frame], m_firstEventOfFrame[frame + 1]};
+}
+
+void ListModeLUT::precomputeMotionCorrectedLORs()
+{
+	ASSERT_MSG(hasMotion(), "The list-mode has no motion to correct for");
+	// The LORs are computed from the events, not from the previous ones
+	mp_motionCorrectedLORs = nullptr;
+
+	const size_t numEvents = count();
+	auto lors = std::make_unique<Array2D<float>>();
+	lors->allocate(6, numEvents);
+	float* x1 = lors->getRawPointer();
+	float* y1 = x1 + numEvents;
+	float* z1 = y1 + numEvents;
+	float* x2 = z1 + numEvents;
+	float* y2 = x2 + numEvents;
+	float* z2 = y2 + numEvents;
+	const ListModeLUT* self = this;
+
+#pragma omp parallel for default(none) \
+    firstprivate(numEvents, self, x1, y1, z1, x2, y2, z2)
+	for (bin_t evId = 0; evId < numEvents; evId++)
+	{
+		const Line3D lor = self->getLOR(evId);
+		x1[evId] = lor.point1.x;
+		y1[evId] = lor.point1.y;
+		z1[evId] = lor.point1.z;
+		x2[evId] = lor.point2.x;
+		y2[evId] = lor.point2.y;
+		z2[evId] = lor.point2.z;
+	}
+
+	mp_motionCorrectedLORs = std::move(lors);
+}
+
+bool ListModeLUT::hasMotionCorrectedLORs() const
+{
+	return mp_motionCorrectedLORs != nullptr;
+}
+
+void ListModeLUT::getDetectorPairs(const bin_t* bins, size_t numBins,
+                                   det_pair_t* detPairs) const
+{
+	const det_id_t* d1 = mp_detectorId1->getRawPointer();
+	const det_id_t* d2 = mp_detectorId2->getRawPointer();
+	for (size_t i = 0; i < numBins; i++)
+	{
+		detPairs[i] = {d1[bins[i]], d2[bins[i]]};
 	}
+}
 
-	// Fill the events at the end
-	for (; evId < numEvents; evId++)
+void ListModeLUT::getTOFValues(const bin_t* bins, size_t numBins,
+                               float* tofValues) const
+{
+	if (!m_flagTOF)
+	{
+		ProjectionData::getTOFValues(bins, numBins, tofValues);
+		return;
+	}
+	const float* tof_ps = mp_tof_ps->getRawPointer();
+	for (size_t i = 0; i < numBins; i++)
 	{
-		mp_frames->setFlat(evId, currentFrame);
+		tofValues[i] = tof_ps[bins[i]];
+	}
+}
+
+void ListModeLUT::getFrames(const bin_t* bins, size_t numBins,
+                            frame_t* frames) const
+{
+	for (size_t i = 0; i < numBins; i++)
+	{
+		frames[i] = ListModeLUT::getFrame(bins[i]);
+	}
+}
+
+ProjectionProperties ListModeLUT::getProjectionProperties(bin_t bin) const
+{
+	if (mp_motionCorrectedLORs == nullptr)
+	{
+		return ProjectionData::getProjectionProperties(bin);
+	}
+
+	const size_t numEvents = count();
+	const float* lors = mp_motionCorrectedLORs->getRawPointer();
+	const Line3D lor{{lors[bin], lors[numEvents + bin],
+	                  lors[2 * numEvents + bin]},
+	                 {lors[3 * numEvents + bin], lors[4 * numEvents + bin],
+	                  lors[5 * numEvents + bin]}};
+
+	const float tofValue = hasTOF() ? getTOFValue(bin) : 0.0f;
+
+	const auto [d1, d2] = getDetectorPair(bin);
+	const DetectorTable& detTable = mr_scanner.getDetectorTable();
+	return ProjectionProperties{lor, tofValue, detTable.getOrient(d1),
+	                            detTable.getOrient(d2)};
+}
+
+void ListModeLUT::getProjectionProperties(
+    const bin_t* bins, size_t numBins,
+    ProjectionPropertiesBatch& properties) const
+{
+	if (mp_motionCorrectedLORs == nullptr)
+	{
+		ProjectionData::getProjectionProperties(bins, numBins, properties);
+		return;
+	}
+
+	properties.resize(numBins);
+
+	const size_t numEvents = count();
+	const float* x1 = mp_motionCorrectedLORs->getRawPointer();
+	const float* y1 = x1 + numEvents;
+	const float* z1 = y1 + numEvents;
+	const float* x2 = z1 + numEvents;
+	const float* y2 = x2 + numEvents;
+	const float* z2 = y2 + numEvents;
+
+	const DetectorTable& detTable = mr_scanner.getDetectorTable();
+	const float* xOrient = detTable.getXorient();
+	const float* yOrient = detTable.getYorient();
+	const float* zOrient = detTable.getZorient();
+
+	const det_pair_t* detPairs = properties.detPairs.data();
+	getDetectorPairs(bins, numBins, properties.detPairs.data());
+	if (hasTOF())
+	{
+		getTOFValues(bins, numBins, properties.tofValue.data());
+	}
+	else
+	{
+		std::fill_n(properties.tofValue.begin(), numBins, 0.0f);
+	}
+
+	for (size_t i = 0; i < numBins; i++)
+	{
+		const bin_t bin = bins[i];
+		const auto [d1, d2] = detPairs[i];
+
+		properties.x1[i] = x1[bin];
+		properties.y1[i] = y1[bin];
+		properties.z1[i] = z1[bin];
+		properties.x2[i] = x2[bin];
+		properties.y2[i] = y2[bin];
+		properties.z2[i] = z2[bin];
+		properties.orient1x[i] = xOrient[d1];
+		properties.orient1y[i] = yOrient[d1];
+		properties.orient1z[i] = zOrient[d1];
+		properties.orient2x[i] = xOrient[d2];
+		properties.orient2y[i] = yOrient[d2];
+		properties.orient2z[i] = zOrient[d2];
 	}
 }
 
@@ -324,7 +499,13 @@ frame_t ListModeLUT::getFrame(bin_t id) const
 {
 	if (mp_lorMotion != nullptr)
 	{
-		return mp_frames->getFlat(id);
+		// Last frame beginning at or before the event. Empty frames share
+		// their first event with the next frame, which is the one returned
+		const auto frameEnd = std::upper_bound(m_firstEventOfFrame.begin(),
+		                                       m_firstEventOfFrame.end() - 1,
+		                                       id);
+		return static_cast<frame_t>(frameEnd - m_firstEventOfFrame.begin()) -
+		       1;
 	}
 	return ProjectionData::getFrame(id);
 }
@@ -549,6 +730,11 @@ std::unique_ptr<ProjectionData>
 	{
 		std::cout << "Reading LOR motion file" << std::endl;
 		lm->addLORMotion(pluginOptions.at("lor_motion"));
+		if (pluginOptions.count("precompute_motion"))
+		{
+			std::cout << "Precomputing motion-corrected LORs" << std::endl;
+			lm->precomputeMotionCorrectedLORs();
+		}
 	}
 	return lm;
 }
@@ -556,7 +742,10 @@ std::unique_ptr<ProjectionData>
 Plugin::OptionsListPerPlugin ListModeLUTOwned::getOptions()
 {
 	return {{"flag_tof", {"Flag for reading TOF column", true}},
-	        {"lor_motion", {"LOR motion file for motion correction", false}}};
+	        {"lor_motion", {"LOR motion file for motion correction", false}},
+	        {"precompute_motion",
+	         {"Precompute the motion-corrected LORs (24 bytes per event)",
+	          true}}};
 }
 
 REGISTER_PROJDATA_PLUGIN("LM", ListModeLUTOwned, ListModeLUTOwned::create,
@@ -22,6 +22,8 @@ void py_setup_listmodelutdoi(py::module& m)
 	auto c = py::class_<ListModeLUTDOI, ListModeLUT>(m, "ListModeLUTDOI");
 
 	c.def("writeToFile", &ListModeLUTDOI::writeToFile);
+	c.def("getNumLayers", &ListModeLUTDOI::getNumLayers);
+	c.def("getLayer", &ListModeLUTDOI::getLayer, py::arg("doi"));
 
 	auto c_alias = py::class_<ListModeLUTDOIAlias, ListModeLUTDOI>(
 	    m, "ListModeLUTDOIAlias");
@@ -71,6 +73,17 @@ ListModeLUTDOI::ListModeLUTDOI(const Scanner& pr_scanner, bool p_flagTOF,
                                int numLayers)
     : ListModeLUT(pr_scanner, p_flagTOF), m_numLayers(numLayers)
 {
+	ASSERT_MSG(m_numLayers > 0 && m_numLayers <= NumDOIValues,
+	           "The number of layers must be between 1 and 256");
+	const float layerSize = NumDOIValues / static_cast<float>(m_numLayers);
+	for (int doi = 0; doi < NumDOIValues; doi++)
+	{
+		const float layer = std::floor(doi / layerSize);
+		const float doi_t = layer * mr_scanner.crystalDepth /
+		                    static_cast<float>(m_numLayers);
+		m_layerOfDOI[doi] = static_cast<unsigned char>(layer);
+		m_depthOfDOI[doi] = doi_t - 0.5f * mr_scanner.crystalDepth;
+	}
 }
 
 ListModeLUTDOIOwned::ListModeLUTDOIOwned(const Scanner& pr_scanner,
@@ -197,27 +210,37 @@ Line3D ListModeLUTDOI::getArbitraryLOR(bin_t id) const
 {
 	const det_id_t detId1 = getDetector1(id);
 	const det_id_t detId2 = getDetector2(id);
-	const Vector3D p1 = mr_scanner.getDetectorPos(detId1);
-	const Vector3D p2 = mr_scanner.getDetectorPos(detId2);
-	const Vector3D n1 = mr_scanner.getDetectorOrient(detId1);
-	const Vector3D n2 = mr_scanner.getDetectorOrient(detId2);
-	const float layerSize = (1 << 8) / static_cast<float>(m_numLayers);
-	const float doi1_t = std::floor((*mp_doi1)[id] / layerSize) *
-	                     mr_scanner.crystalDepth /
-	                     static_cast<float>(m_numLayers);
-	const float doi2_t = std::floor((*mp_doi2)[id] / layerSize) *
-	                     mr_scanner.crystalDepth /
-	                     static_cast<float>(m_numLayers);
-	const Vector3D p1_doi{
-	    p1.x + (doi1_t - 0.5f * mr_scanner.crystalDepth) * n1.x,
-	    p1.y + (doi1_t - 0.5f * mr_scanner.crystalDepth) * n1.y,
-	    p1.z + (doi1_t - 0.5f * mr_scanner.crystalDepth) * n1.z};
-	const Vector3D p2_doi{
-	    p2.x + (doi2_t - 0.5f * mr_scanner.crystalDepth) * n2.x,
-	    p2.y + (doi2_t - 0.5f * mr_scanner.crystalDepth) * n2.y,
-	    p2.z + (doi2_t - 0.5f * mr_scanner.crystalDepth) * n2.z};
-	return Line3D{{p1_doi.x, p1_doi.y, p1_doi.z},
-	              {p2_doi.x, p2_doi.y, p2_doi.z}};
+	const DetectorTable& detTable = mr_scanner.getDetectorTable();
+	// Moved from the center of the crystal to the center of the layer
+	const float depth1 = m_depthOfDOI[(*mp_doi1)[id]];
+	const float depth2 = m_depthOfDOI[(*mp_doi2)[id]];
+	return Line3D{
+	    detTable.getPos(detId1) + detTable.getOrient(detId1) * depth1,
+	    detTable.getPos(detId2) + detTable.getOrient(detId2) * depth2};
+}
+
+bool ListModeLUTDOI::hasDuplicateLORs() const
+{
+	return !hasTOF() && !hasMotion();
+}
+
+uint64_t ListModeLUTDOI::getLORKey(bin_t id) const
+{
+	const uint64_t numDets = mr_scanner.getNumDets();
+	const uint64_t detPair = getDetector1(id) * numDets + getDetector2(id);
+	const uint64_t layers = m_layerOfDOI[(*mp_doi1)[id]] * NumDOIValues +
+	                        m_layerOfDOI[(*mp_doi2)[id]];
+	return detPair * NumDOIValues * NumDOIValues + layers;
+}
+
+int ListModeLUTDOI::getNumLayers() const
+{
+	return m_numLayers;
+}
+
+int ListModeLUTDOI::getLayer(unsigned char doi) const
+{
+	return m_layerOfDOI[doi];
 }
 
 void ListModeLUTDOI::writeToFile(const std::string& listMode_fname) const
@@ -418,6 +441,10 @@ std::unique_ptr<ProjectionData>
 	if (pluginOptions.count("lor_motion"))
 	{
 		lm->addLORMotion(pluginOptions.at("lor_motion"));
+		if (pluginOptions.count("precompute_motion"))
+		{
+			lm->precomputeMotionCorrectedLORs();
+		}
 	}
 	return lm;
 }
@@ -426,7 +453,10 @@ Plugin::OptionsListPerPlugin ListModeLUTDOIOwned::getOptions()
 {
 	return {{"flag_tof", {"Flag for reading TOF column", true}},
 	        {"num_layers", {"Number of layers", false}},
-	        {"lor_motion", {"LOR motion file for motion correction", false}}};
+	        {"lor_motion", {"LOR motion file for motion correction", false}},
+	        {"precompute_motion",
+	         {"Precompute the motion-corrected LORs (24 bytes per event)",
+	          true}}};
 }
 
 REGISTER_PROJDATA_PLUGIN("LM-DOI", ListModeLUTDOIOwned,
@@ -5,9 +5,9 @@
 
 #include "datastruct/projection/ProjectionData.hpp"
 
-#include "geometry/Matrix.hpp"
 #include "utils/Globals.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 
 #if BUILD_PYBIND11
@@ -47,11 +47,29 @@ void py_setup_projectiondata(py::module& m)
 	c.def("getScanDuration", &ProjectionData::getScanDuration);
 	c.def("hasTOF", &ProjectionData::hasTOF);
 	c.def("getTOFValue", &ProjectionData::getTOFValue, py::arg("id"));
+	c.def("hasTOFBins", &ProjectionData::hasTOFBins);
+	c.def("getNumTOFBins", &ProjectionData::getNumTOFBins);
+	c.def("getTOFBinWidth", &ProjectionData::getTOFBinWidth);
 	c.def("getRandomsEstimate", &ProjectionData::getRandomsEstimate,
 	      py::arg("id"));
 	c.def("clearProjections", &ProjectionData::clearProjections,
 	      py::arg("value"));
 	c.def("hasArbitraryLORs", &ProjectionData::hasArbitraryLORs);
+	c.def("hasLORBundles", &ProjectionData::hasLORBundles);
+	c.def("getNumLORsInBin", &ProjectionData::getNumLORsInBin, py::arg("bin"));
+	c.def(
+	    "getDetectorPairInBin",
+	    [](const ProjectionData& self, bin_t bin, size_t lorIdx)
+	    {
+		    auto [d1, d2] = self.getDetectorPairInBin(bin, lorIdx);
+		    return py::make_tuple(d1, d2);
+	    },
+	    py::arg("bin"), py::arg("lorIdx"));
+	c.def("getWeightOfLORInBin", &ProjectionData::getWeightOfLORInBin,
+	      py::arg("bin"), py::arg("lorIdx"));
+	c.def("hasTransaxialLORs", &ProjectionData::hasTransaxialLORs);
+	c.def("hasDuplicateLORs", &ProjectionData::hasDuplicateLORs);
+	c.def("getLORKey", &ProjectionData::getLORKey, py::arg("bin"));
 	c.def("getArbitraryLOR",
 	      [](const ProjectionData& self, bin_t bin)
 	      {
@@ -66,6 +84,24 @@ void py_setup_projectiondata(py::module& m)
 
 #endif  // if BUILD_PYBIND11
 
+namespace
+{
+	// Rotation followed by the translation
+	void transformPoint(const transform_t& transfo, float& x, float& y,
+	                    float& z)
+	{
+		const float xPrim = transfo.r00 * x + transfo.r01 * y +
+		                    transfo.r02 * z + transfo.tx;
+		const float yPrim = transfo.r10 * x + transfo.r11 * y +
+		                    transfo.r12 * z + transfo.ty;
+		const float zPrim = transfo.r20 * x + transfo.r21 * y +
+		                    transfo.r22 * z + transfo.tz;
+		x = xPrim;
+		y = yPrim;
+		z = zPrim;
+	}
+}  // namespace
+
 ProjectionData::ProjectionData(const Scanner& pr_scanner)
     : mr_scanner(pr_scanner)
 {
@@ -141,6 +177,21 @@ bool ProjectionData::hasTOF() const
 	return false;
 }
 
+bool ProjectionData::hasTOFBins() const
+{
+	return false;
+}
+
+size_t ProjectionData::getNumTOFBins() const
+{
+	return 1ull;
+}
+
+float ProjectionData::getTOFBinWidth() const
+{
+	throw std::logic_error("getTOFBinWidth unimplemented");
+}
+
 bool ProjectionData::hasArbitraryLORs() const
 {
 	return false;
@@ -152,6 +203,87 @@ Line3D ProjectionData::getArbitraryLOR(bin_t id) const
 	throw std::logic_error("getArbitraryLOR Unimplemented");
 }
 
+bool ProjectionData::hasLORBundles() const
+{
+	return false;
+}
+
+size_t ProjectionData::getNumLORsInBin(bin_t bin) const
+{
+	(void)bin;
+	return 1ull;
+}
+
+det_pair_t ProjectionData::getDetectorPairInBin(bin_t bin, size_t lorIdx) const
+{
+	(void)lorIdx;
+	return getDetectorPair(bin);
+}
+
+float ProjectionData::getWeightOfLORInBin(bin_t bin, size_t lorIdx) const
+{
+	(void)bin;
+	(void)lorIdx;
+	return 1.0f;
+}
+
+bool ProjectionData::hasTransaxialLORs() const
+{
+	return false;
+}
+
+bool ProjectionData::hasDuplicateLORs() const
+{
+	return false;
+}
+
+uint64_t ProjectionData::getLORKey(bin_t bin) const
+{
+	(void)bin;
+	throw std::logic_error("getLORKey unimplemented");
+}
+
+void ProjectionPropertiesBatch::resize(size_t size)
+{
+	for (std::vector<float>* array :
+	     {&x1, &y1, &z1, &x2, &y2, &z2, &tofValue, &orient1x, &orient1y,
+	      &orient1z, &orient2x, &orient2y, &orient2z})
+	{
+		array->resize(size);
+	}
+	// Kernels of the previous content are not valid anymore
+	psfKernel.clear();
+	detPairs.resize(size);
+	frames.resize(size);
+}
+
+void ProjectionData::getDetectorPairs(const bin_t* bins, size_t numBins,
+                                      det_pair_t* detPairs) const
+{
+	for (size_t i = 0; i < numBins; i++)
+	{
+		detPairs[i] = getDetectorPair(bins[i]);
+	}
+}
+
+void ProjectionData::getTOFValues(const bin_t* bins, size_t numBins,
+                                  float* tofValues) const
+{
+	for (size_t i = 0; i < numBins; i++)
+	{
+		tofValues[i] = getTOFValue(bins[i]);
+	}
+}
+
+void ProjectionData::getFrames(const bin_t* bins, size_t numBins,
+                               frame_t* frames) const
+{
+	for (size_t i = 0; i < numBins; i++)
+	{
+		frames[i] = getFrame(bins[i]);
+	}
+}
+
 ProjectionProperties ProjectionData::getProjectionProperties(bin_t bin) const
 {
 	auto [d1, d2] = getDetectorPair(bin);
@@ -164,8 +296,115 @@ ProjectionProperties ProjectionData::getProjectionProperties(bin_t bin) const
 		tofValue = getTOFValue(bin);
 	}
 
-	const Vector3D det1Orient = mr_scanner.getDetectorOrient(d1);
-	const Vector3D det2Orient = mr_scanner.getDetectorOrient(d2);
+	const DetectorTable& detTable = mr_scanner.getDetectorTable();
+	const Vector3D det1Orient = detTable.getOrient(d1);
+	const Vector3D det2Orient = detTable.getOrient(d2);
+	return ProjectionProperties{lor, tofValue, det1Orient, det2Orient};
+}
+
+void ProjectionData::getProjectionProperties(
+    const bin_t* bins, size_t numBins,
+    ProjectionPropertiesBatch& properties) const
+{
+	properties.resize(numBins);
+
+	const DetectorTable& detTable = mr_scanner.getDetectorTable();
+	const float* xPos = detTable.getXpos();
+	const float* yPos = detTable.getYpos();
+	const float* zPos = detTable.getZpos();
+	const float* xOrient = detTable.getXorient();
+	const float* yOrient = detTable.getYorient();
+	const float* zOrient = detTable.getZorient();
+
+	const bool isArbitrary = hasArbitraryLORs();
+	const det_pair_t* detPairs = properties.detPairs.data();
+	getDetectorPairs(bins, numBins, properties.detPairs.data());
+	if (hasTOF())
+	{
+		getTOFValues(bins, numBins, properties.tofValue.data());
+	}
+	else
+	{
+		std::fill_n(properties.tofValue.begin(), numBins, 0.0f);
+	}
+
+	for (size_t i = 0; i < numBins; i++)
+	{
+		const auto [d1, d2] = detPairs[i];
+
+		if (isArbitrary)
+		{
+			const Line3D lor = getArbitraryLOR(bins[i]);
+			properties.x1[i] = lor.point1.x;
+			properties.y1[i] = lor.point1.y;
+			properties.z1[i] = lor.point1.z;
+			properties.x2[i] = lor.point2.x;
+			properties.y2[i] = lor.point2.y;
+			properties.z2[i] = lor.point2.z;
+		}
+		else
+		{
+			properties.x1[i] = xPos[d1];
+			properties.y1[i] = yPos[d1];
+			properties.z1[i] = zPos[d1];
+			properties.x2[i] = xPos[d2];
+			properties.y2[i] = yPos[d2];
+			properties.z2[i] = zPos[d2];
+		}
+		properties.orient1x[i] = xOrient[d1];
+		properties.orient1y[i] = yOrient[d1];
+		properties.orient1z[i] = zOrient[d1];
+		properties.orient2x[i] = xOrient[d2];
+		properties.orient2y[i] = yOrient[d2];
+		properties.orient2z[i] = zOrient[d2];
+	}
+
+	if (hasMotion() && numBins > 0)
+	{
+		// Consecutive bins are usually in the same frame
+		const frame_t* frames = properties.frames.data();
+		getFrames(bins, numBins, properties.frames.data());
+		frame_t currentFrame = frames[0];
+		transform_t transfo = getTransformOfFrame(currentFrame);
+		for (size_t i = 0; i < numBins; i++)
+		{
+			const frame_t frame = frames[i];
+			if (frame != currentFrame)
+			{
+				currentFrame = frame;
+				transfo = getTransformOfFrame(frame);
+			}
+			transformPoint(transfo, properties.x1[i], properties.y1[i],
+			               properties.z1[i]);
+			transformPoint(transfo, properties.x2[i], properties.y2[i],
+			               properties.z2[i]);
+		}
+	}
+}
+
+ProjectionProperties
+    ProjectionData::getProjectionPropertiesInBin(bin_t bin,
+                                                 size_t lorIdx) const
+{
+	if (!hasLORBundles())
+	{
+		return getProjectionProperties(bin);
+	}
+
+	auto [d1, d2] = getDetectorPairInBin(bin, lorIdx);
+
+	const DetectorTable& detTable = mr_scanner.getDetectorTable();
+	Line3D lor{detTable.getPos(d1), detTable.getPos(d2)};
+	applyMotionToLOR(bin, lor);
+
+	float tofValue = 0.0f;
+	if (hasTOF())
+	{
+		tofValue = getTOFValue(bin);
+	}
+
+	const Vector3D det1Orient = detTable.getOrient(d1);
+	const Vector3D det2Orient = detTable.getOrient(d2);
 	return ProjectionProperties{lor, tofValue, det1Orient, det2Orient};
 }
 
@@ -180,30 +419,24 @@ Line3D ProjectionData::getLOR(bin_t bin) const
 	else
 	{
 		auto [d1, d2] = getDetectorPair(bin);
-		const Vector3D p1 = mr_scanner.getDetectorPos(d1);
-		const Vector3D p2 = mr_scanner.getDetectorPos(d2);
-		lor = Line3D{p1, p2};
+		const DetectorTable& detTable = mr_scanner.getDetectorTable();
+		lor = Line3D{detTable.getPos(d1), detTable.getPos(d2)};
 	}
 
+	applyMotionToLOR(bin, lor);
+	return lor;
+}
+
+void ProjectionData::applyMotionToLOR(bin_t bin, Line3D& lor) const
+{
 	if (hasMotion())
 	{
 		const frame_t frame = getFrame(bin);
 		const transform_t transfo = getTransformOfFrame(frame);
 
-		const Matrix MRot{transfo.r00, transfo.r01, transfo.r02,
-		                  transfo.r10, transfo.r11, transfo.r12,
-		                  transfo.r20, transfo.r21, transfo.r22};
-		const Vector3D VTrans{transfo.tx, transfo.ty, transfo.tz};
-
-		Vector3D point1Prim = MRot * lor.point1;
-		point1Prim = point1Prim + VTrans;
-
-		Vector3D point2Prim = MRot * lor.point2;
-		point2Prim = point2Prim + VTrans;
-
-		lor.update(point1Prim, point2Prim);
+		transformPoint(transfo, lor.point1.x, lor.point1.y, lor.point1.z);
+		transformPoint(transfo, lor.point2.x, lor.point2.y, lor.point2.z);
 	}
-	return lor;
 }
 
 timestamp_t ProjectionData::getTimestamp(bin_t id) const
@@ -136,6 +136,21 @@ float ProjectionList::getTOFValue(bin_t id) const
 	return mp_reference->getTOFValue(id);
 }
 
+bool ProjectionList::hasTOFBins() const
+{
+	return mp_reference->hasTOFBins();
+}
+
+size_t ProjectionList::getNumTOFBins() const
+{
+	return mp_reference->getNumTOFBins();
+}
+
+float ProjectionList::getTOFBinWidth() const
+{
+	return mp_reference->getTOFBinWidth();
+}
+
 bool ProjectionList::hasMotion() const
 {
 	return mp_reference->hasMotion();
@@ -156,6 +171,53 @@ Line3D ProjectionList::getArbitraryLOR(bin_t id) const
 	return mp_reference->getArbitraryLOR(id);
 }
 
+bool ProjectionList::hasLORBundles() const
+{
+	return mp_reference->hasLORBundles();
+}
+
+size_t ProjectionList::getNumLORsInBin(bin_t bin) const
+{
+	return mp_reference->getNumLORsInBin(bin);
+}
+
+det_pair_t ProjectionList::getDetectorPairInBin(bin_t bin, size_t lorIdx) const
+{
+	return mp_reference->getDetectorPairInBin(bin, lorIdx);
+}
+
+float ProjectionList::getWeightOfLORInBin(bin_t bin, size_t lorIdx) const
+{
+	return mp_reference->getWeightOfLORInBin(bin, lorIdx);
+}
+
+bool ProjectionList::hasTransaxialLORs() const
+{
+	return mp_reference->hasTransaxialLORs();
+}
+
+bool ProjectionList::hasDuplicateLORs() const
+{
+	return mp_reference->hasDuplicateLORs();
+}
+
+uint64_t ProjectionList::getLORKey(bin_t bin) const
+{
+	return mp_reference->getLORKey(bin);
+}
+
+ProjectionProperties ProjectionList::getProjectionProperties(bin_t bin) const
+{
+	return mp_reference->getProjectionProperties(bin);
+}
+
+void ProjectionList::getProjectionProperties(
+    const bin_t* bins, size_t numBins,
+    ProjectionPropertiesBatch& properties) const
+{
+	mp_reference->getProjectionProperties(bins, numBins, properties);
+}
+
 const ProjectionData* ProjectionList::getReference() const
 {
 	return mp_reference;
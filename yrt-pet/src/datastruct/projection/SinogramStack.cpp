@@ -0,0 +1,901 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "datastruct/projection/SinogramStack.hpp"
+
+#include "geometry/Constants.hpp"
+#include "utils/Assert.hpp"
+#include "utils/FFT.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+#if BUILD_PYBIND11
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+namespace py = pybind11;
+
+void py_setup_sinogramstack(py::module& m)
+{
+	auto c = py::class_<SinogramStack, Histogram>(m, "SinogramStack",
+	                                              py::buffer_protocol());
+	c.def_readonly("numSlices", &SinogramStack::numSlices);
+	c.def_readonly("numPhi", &SinogramStack::numPhi);
+	c.def_readonly("numR", &SinogramStack::numR);
+	c.def_readonly("histoSize", &SinogramStack::histoSize);
+	c.def_buffer(
+	    [](SinogramStack& self) -> py::buffer_info
+	    {
+		    Array3DBase<float>& d = self.getData();
+		    return py::buffer_info(d.getRawPointer(), sizeof(float),
+		                           py::format_descriptor<float>::format(), 3,
+		                           d.getDims(), d.getStrides());
+	    });
+	c.def("writeToFile", &SinogramStack::writeToFile, py::arg("fname"));
+	c.def("getMaxRingDiff", &SinogramStack::getMaxRingDiff);
+	c.def("getSlicePosition", &SinogramStack::getSlicePosition,
+	      py::arg("slice"));
+	c.def("getNumRingPairsInSlice", &SinogramStack::getNumRingPairsInSlice,
+	      py::arg("slice"));
+	c.def("getBinIdFromCoords", &SinogramStack::getBinIdFromCoords,
+	      py::arg("r"), py::arg("phi"), py::arg("slice"));
+	c.def(
+	    "getCoordsFromBinId",
+	    [](const SinogramStack& self, bin_t binId)
+	    {
+		    coord_t r, phi, slice;
+		    self.getCoordsFromBinId(binId, r, phi, slice);
+		    return py::make_tuple(r, phi, slice);
+	    },
+	    py::arg("binId"));
+	c.def("getBinIdFromDetPair", &SinogramStack::getBinIdFromDetPair,
+	      py::arg("d1"), py::arg("d2"));
+	c.def("incrementProjection", &SinogramStack::incrementProjection,
+	      py::arg("binId"), py::arg("val"));
+	c.def("rebinSSRB", &SinogramStack::rebinSSRB, py::arg("projData"),
+	      py::arg("binIter") = nullptr);
+	c.def("rebinFORE", &SinogramStack::rebinFORE, py::arg("histo3d"),
+	      py::arg("kLimit") = 2, py::arg("omegaLimit") = 2);
+
+	auto c_alias =
+	    py::class_<SinogramStackAlias, SinogramStack>(m, "SinogramStackAlias");
+	c_alias.def(py::init<const Scanner&, int>(), py::arg("scanner"),
+	            py::arg("maxRingDiff") = -1);
+	c_alias.def("bind", &SinogramStackAlias::bind, py::arg("array3dfloat"));
+
+	auto c_owned =
+	    py::class_<SinogramStackOwned, SinogramStack>(m, "SinogramStackOwned");
+	c_owned.def(py::init<const Scanner&, int>(), py::arg("scanner"),
+	            py::arg("maxRingDiff") = -1);
+	c_owned.def(py::init<const Scanner&, const std::string&, int>(),
+	            py::arg("scanner"), py::arg("fname"),
+	            py::arg("maxRingDiff") = -1);
+	c_owned.def("readFromFile", &SinogramStackOwned::readFromFile,
+	            py::arg("fname"));
+	c_owned.def("allocate", &SinogramStackOwned::allocate);
+}
+#endif
+
+SinogramStack::SinogramStack(const Scanner& pr_scanner, int p_maxRingDiff)
+    : Histogram{pr_scanner}, mp_data(nullptr)
+{
+	ASSERT_MSG(mr_scanner.maxRingDiff >= 1,
+	           "Sinogram stacks require a maximum ring difference of at least "
+	           "1 for the cross planes");
+
+	const int scannerMaxRingDiff = static_cast<int>(mr_scanner.maxRingDiff);
+	m_maxRingDiff = (p_maxRingDiff < 0) ?
+	                    scannerMaxRingDiff :
+	                    std::min(p_maxRingDiff, scannerMaxRingDiff);
+
+	mp_histo3d = std::make_unique<Histogram3DAlias>(mr_scanner);
+	numR = mp_histo3d->numR;
+	numPhi = mp_histo3d->numPhi;
+
+	const int numRings = mr_scanner.numRings;
+	numSlices = 2 * numRings - 1;
+	histoSize = numSlices * numPhi * numR;
+
+	std::vector<float> ringPositions(numRings);
+	for (int ring = 0; ring < numRings; ring++)
+	{
+		ringPositions[ring] =
+		    mr_scanner.getDetectorPos(ring * mr_scanner.detsPerRing).z;
+	}
+	m_slicePositions.resize(numSlices);
+	m_numRingPairsInSlice.assign(numSlices, 0);
+	for (int slice = 0; slice < static_cast<int>(numSlices); slice++)
+	{
+		const int z1 = slice / 2;
+		const int z2 = slice - z1;
+		m_slicePositions[slice] =
+		    0.5f * (ringPositions[z1] + ringPositions[z2]);
+	}
+	for (int z1 = 0; z1 < numRings; z1++)
+	{
+		for (int z2 = 0; z2 < numRings; z2++)
+		{
+			if (std::abs(z2 - z1) <= m_maxRingDiff)
+			{
+				m_numRingPairsInSlice[z1 + z2]++;
+			}
+		}
+	}
+}
+
+SinogramStack::~SinogramStack() {}
+
+SinogramStackOwned::SinogramStackOwned(const Scanner& pr_scanner,
+                                       int p_maxRingDiff)
+    : SinogramStack(pr_scanner, p_maxRingDiff)
+{
+	mp_data = std::make_unique<Array3D<float>>();
+}
+
+SinogramStackOwned::SinogramStackOwned(const Scanner& pr_scanner,
+                                       const std::string& filename,
+                                       int p_maxRingDiff)
+    : SinogramStackOwned(pr_scanner, p_maxRingDiff)
+{
+	readFromFile(filename);
+}
+
+void SinogramStackOwned::allocate()
+{
+	static_cast<Array3D<float>*>(mp_data.get())
+	    ->allocate(numSlices, numPhi, numR);
+}
+
+void SinogramStackOwned::readFromFile(const std::string& filename)
+{
+	std::array<size_t, 3> dims{numSlices, numPhi, numR};
+	try
+	{
+		mp_data->readFromFile(filename, dims);
+	}
+	catch (const std::exception& e)
+	{
+		throw std::runtime_error(
+		    "Error during Histogram initialization either the scanner\'s "
+		    "attributes do not match the sinogram stack given, the file "
+		    "given is inexistant or the file given is not a valid histogram "
+		    "file");
+	}
+}
+
+SinogramStackAlias::SinogramStackAlias(const Scanner& pr_scanner,
+                                       int p_maxRingDiff)
+    : SinogramStack(pr_scanner, p_maxRingDiff)
+{
+	mp_data = std::make_unique<Array3DAlias<float>>();
+}
+
+void SinogramStackAlias::bind(Array3DBase<float>& pr_data)
+{
+	static_cast<Array3DAlias<float>*>(mp_data.get())->bind(pr_data);
+	if (mp_data->getRawPointer() != pr_data.getRawPointer())
+	{
+		throw std::runtime_error(
+		    "Error occured in the binding of the given array");
+	}
+}
+
+void SinogramStack::writeToFile(const std::string& filename) const
+{
+	mp_data->writeToFile(filename);
+}
+
+int SinogramStack::getMaxRingDiff() const
+{
+	return m_maxRingDiff;
+}
+
+float SinogramStack::getSlicePosition(coord_t slice) const
+{
+	return m_slicePositions[slice];
+}
+
+size_t SinogramStack::getNumRingPairsInSlice(coord_t slice) const
+{
+	return m_numRingPairsInSlice[slice];
+}
+
+bin_t SinogramStack::getBinIdFromCoords(coord_t r, coord_t phi,
+                                        coord_t slice) const
+{
+	return slice * numPhi * numR + phi * numR + r;
+}
+
+void SinogramStack::getCoordsFromBinId(bin_t binId, coord_t& r, coord_t& phi,
+                                       coord_t& slice) const
+{
+	slice = binId / (numPhi * numR);
+	phi = (binId % (numPhi * numR)) / numR;
+	r = (binId % (numPhi * numR)) % numR;
+}
+
+bin_t SinogramStack::getBinIdFromDetPair(det_id_t d1, det_id_t d2) const
+{
+	coord_t r, phi, z3;
+	mp_histo3d->getCoordsFromDetPair(d1, d2, r, phi, z3);
+	const coord_t z1 = (d1 / mr_scanner.detsPerRing) % mr_scanner.numRings;
+	const coord_t z2 = (d2 / mr_scanner.detsPerRing) % mr_scanner.numRings;
+	return getBinIdFromCoords(r, phi, z1 + z2);
+}
+
+bool SinogramStack::isDetPairInRingDiffRange(det_id_t d1, det_id_t d2) const
+{
+	const int z1 = (d1 / mr_scanner.detsPerRing) % mr_scanner.numRings;
+	const int z2 = (d2 / mr_scanner.detsPerRing) % mr_scanner.numRings;
+	return std::abs(z2 - z1) <= m_maxRingDiff;
+}
+
+size_t SinogramStack::count() const
+{
+	return histoSize;
+}
+
+float SinogramStack::getProjectionValue(bin_t binId) const
+{
+	return mp_data->getFlat(binId);
+}
+
+void SinogramStack::setProjectionValue(bin_t binId, float val)
+{
+	mp_data->setFlat(binId, val);
+}
+
+void SinogramStack::incrementProjection(bin_t binId, float val)
+{
+	mp_data->incrementFlat(binId, val);
+}
+
+det_id_t SinogramStack::getDetector1(bin_t id) const
+{
+	return getDetectorPair(id).d1;
+}
+
+det_id_t SinogramStack::getDetector2(bin_t id) const
+{
+	return getDetectorPair(id).d2;
+}
+
+det_pair_t SinogramStack::getDetectorPair(bin_t id) const
+{
+	coord_t r, phi, slice;
+	getCoordsFromBinId(id, r, phi, slice);
+	const coord_t z1 = slice / 2;
+	const coord_t z2 = slice - z1;
+	// In Histogram3D, the z_bins of ring difference 1 follow the direct
+	// planes
+	const coord_t z3 = (z1 == z2) ? z1 : mr_scanner.numRings + z1;
+	det_id_t d1, d2;
+	mp_histo3d->getDetPairFromCoords(r, phi, z3, d1, d2);
+	return {d1, d2};
+}
+
+std::unique_ptr<BinIterator> SinogramStack::getBinIter(int numSubsets,
+                                                       int idxSubset) const
+{
+	if (idxSubset < 0 || numSubsets <= 0)
+		throw std::invalid_argument(
+		    "The subset index cannot be negative, the number of subsets cannot "
+		    "be less or equal than zero");
+	if (idxSubset >= numSubsets)
+		throw std::invalid_argument(
+		    "The subset index has to be smaller than the number of subsets");
+	return std::make_unique<BinIteratorRangeHistogram3D>(
+	    numSlices, numPhi, numR, numSubsets, idxSubset);
+}
+
+void SinogramStack::clearProjections(float value)
+{
+	mp_data->fill(value);
+}
+
+float SinogramStack::getProjectionValueFromHistogramBin(
+    histo_bin_t histoBinId) const
+{
+	if (std::holds_alternative<bin_t>(histoBinId))
+	{
+		// Use bin itself
+		return getProjectionValue(std::get<bin_t>(histoBinId));
+	}
+
+	// use the detector pair
+	const auto [d1, d2] = getDetPairFromHistogramBin(histoBinId);
+	return getProjectionValue(getBinIdFromDetPair(d1, d2));
+}
+
+bool SinogramStack::hasArbitraryLORs() const
+{
+	return true;
+}
+
+Line3D SinogramStack::getArbitraryLOR(bin_t id) const
+{
+	const auto [d1, d2] = getDetectorPair(id);
+	const float z = m_slicePositions[id / (numPhi * numR)];
+	Vector3D p1 = mr_scanner.getDetectorPos(d1);
+	Vector3D p2 = mr_scanner.getDetectorPos(d2);
+	p1.z = z;
+	p2.z = z;
+	return Line3D{p1, p2};
+}
+
+bool SinogramStack::hasTransaxialLORs() const
+{
+	return true;
+}
+
+void SinogramStack::rebinSSRB(const ProjectionData& projData,
+                              const BinIterator* binIter)
+{
+	ASSERT(isMemoryValid());
+
+	const auto* histo3d = dynamic_cast<const Histogram3D*>(&projData);
+	if (histo3d != nullptr && binIter == nullptr)
+	{
+		rebinSSRBHistogram3D(*histo3d);
+	}
+	else
+	{
+		clearProjections(0.0f);
+
+		size_t numBins;
+		if (binIter == nullptr)
+		{
+			numBins = projData.count();
+		}
+		else
+		{
+			numBins = binIter->size();
+		}
+
+		for (bin_t bin = 0; bin < numBins; bin++)
+		{
+			bin_t binId = bin;
+			if (binIter != nullptr)
+			{
+				binId = binIter->get(bin);
+			}
+
+			const float projValue = projData.getProjectionValue(binId);
+			if (projValue == 0.0f)
+			{
+				continue;
+			}
+			const auto [d1, d2] = projData.getDetectorPair(binId);
+			if (!isDetPairInRingDiffRange(d1, d2))
+			{
+				continue;
+			}
+			incrementProjection(getBinIdFromDetPair(d1, d2), projValue);
+		}
+	}
+
+	normalizeSSRB();
+}
+
+void SinogramStack::rebinSSRBHistogram3D(const Histogram3D& histo3d)
+{
+	ASSERT_MSG(histo3d.numZBin == mp_histo3d->numZBin &&
+	               histo3d.numPhi == numPhi && histo3d.numR == numR,
+	           "The histogram given does not match the scanner");
+
+	// Histogram3D z_bins rebinned in each slice
+	std::vector<std::vector<coord_t>> histo3DZBinsOfSlice(numSlices);
+	for (coord_t z3 = 0; z3 < histo3d.numZBin; z3++)
+	{
+		coord_t z1, z2;
+		histo3d.getZ1Z2(z3, z1, z2);
+		if (std::abs(static_cast<int>(z2) - static_cast<int>(z1)) <=
+		    m_maxRingDiff)
+		{
+			histo3DZBinsOfSlice[z1 + z2].push_back(z3);
+		}
+	}
+
+	float* dataPtr = mp_data->getRawPointer();
+	const Histogram3D* histo3dPtr = &histo3d;
+	const std::vector<coord_t>* histo3DZBinsOfSlicePtr =
+	    histo3DZBinsOfSlice.data();
+	const size_t sliceSize = numPhi * numR;
+	const size_t numBins = histoSize;
+
+	// Each bin of the stack gathers its ring pairs, so no two threads write
+	// the same bin
+#pragma omp parallel for default(none)                                    \
+    firstprivate(dataPtr, histo3dPtr, histo3DZBinsOfSlicePtr, sliceSize, \
+                     numBins)
+	for (bin_t binId = 0; binId < numBins; binId++)
+	{
+		const coord_t slice = binId / sliceSize;
+		const bin_t binInSlice = binId % sliceSize;
+		float sum = 0.0f;
+		for (const coord_t z3 : histo3DZBinsOfSlicePtr[slice])
+		{
+			sum += histo3dPtr->getProjectionValue(z3 * sliceSize + binInSlice);
+		}
+		dataPtr[binId] = sum;
+	}
+}
+
+void SinogramStack::normalizeSSRB()
+{
+	float* dataPtr = mp_data->getRawPointer();
+	const size_t* numRingPairsPtr = m_numRingPairsInSlice.data();
+	const size_t sliceSize = numPhi * numR;
+	const size_t numBins = histoSize;
+
+#pragma omp parallel for default(none) \
+    firstprivate(dataPtr, numRingPairsPtr, sliceSize, numBins)
+	for (bin_t binId = 0; binId < numBins; binId++)
+	{
+		const size_t numRingPairs = numRingPairsPtr[binId / sliceSize];
+		if (numRingPairs > 0)
+		{
+			dataPtr[binId] /= static_cast<float>(numRingPairs);
+		}
+	}
+}
+
+void SinogramStack::rebinFORE(const Histogram3D& histo3d, int kLimit,
+                              int omegaLimit)
+{
+	ASSERT_MSG(histo3d.numZBin == mp_histo3d->numZBin &&
+	               histo3d.numPhi == numPhi && histo3d.numR == numR,
+	           "The histogram given does not match the scanner");
+	ASSERT(isMemoryValid());
+
+	const int numRings = mr_scanner.numRings;
+	const size_t sliceSize = numPhi * numR;
+
+	// 1. Transaxial geometry of every (r, phi) bin, from the in-ring LORs.
+	// Each phi row gets the angle theta of its normal in [0, pi) and the s
+	// coordinates of its bins are measured along that normal. "sign" tells
+	// if d1 -> d2 goes along the LOR direction (normal rotated by +pi/2).
+	// The rows are not necessarily on a uniform angular grid (e.g. with flat
+	// detector blocks), so they are interpolated in theta as well as in s
+	const size_t numTheta = numPhi;
+	const size_t numThetaExt = 2 * numTheta;  // Extension to [0, 2pi)
+	const size_t numDOIPoss = mr_scanner.numDOI * mr_scanner.numDOI;
+	const float dTheta = PI / static_cast<float>(numTheta);
+	std::vector<float> thetaOfPhi(numPhi);
+	std::vector<float> sOfBin(sliceSize);
+	std::vector<int> signOfBin(sliceSize);
+	float sMax = 0.0f;
+	for (coord_t phi = 0; phi < numPhi; phi++)
+	{
+		// Reference normal of the row, from its central bin with both
+		// detectors in the first DOI layer
+		det_id_t d1, d2;
+		mp_histo3d->getDetPairFromCoords(numR / numDOIPoss / 2 * numDOIPoss,
+		                                 phi, 0, d1, d2);
+		const Vector3D p1_ref = mr_scanner.getDetectorPos(d1);
+		const Vector3D p2_ref = mr_scanner.getDetectorPos(d2);
+		float theta = std::atan2(p2_ref.y - p1_ref.y, p2_ref.x - p1_ref.x) -
+		              static_cast<float>(PIHALF);
+		theta = std::fmod(theta + static_cast<float>(TWOPI),
+		                  static_cast<float>(PI));
+		thetaOfPhi[phi] = theta;
+
+		const float nx = std::cos(theta);
+		const float ny = std::sin(theta);
+		for (coord_t r = 0; r < numR; r++)
+		{
+			mp_histo3d->getDetPairFromCoords(r, phi, 0, d1, d2);
+			const Vector3D p1 = mr_scanner.getDetectorPos(d1);
+			const Vector3D p2 = mr_scanner.getDetectorPos(d2);
+			const float ux = p2.x - p1.x;
+			const float uy = p2.y - p1.y;
+			const float uNorm = std::sqrt(ux * ux + uy * uy);
+			// Normal of the LOR oriented like the row's normal
+			float lx = -uy / uNorm;
+			float ly = ux / uNorm;
+			if (lx * nx + ly * ny < 0.0f)
+			{
+				lx = -lx;
+				ly = -ly;
+			}
+			const float s = p1.x * lx + p1.y * ly;
+			sOfBin[phi * numR + r] = s;
+			signOfBin[phi * numR + r] = (-ny * ux + nx * uy) >= 0.0f ? 1 : -1;
+			sMax = std::max(sMax, std::abs(s));
+		}
+	}
+
+	// Rows of the sinogram extended to [0, 2pi): row e < numPhi is the phi
+	// row, row e >= numPhi is the phi row seen from the opposite direction
+	// (p(s, theta+pi, delta) = p(-s, theta, -delta)). Every column of the
+	// uniform angular grid interpolates the two closest rows
+	std::vector<size_t> extRowOrder(2 * numPhi);
+	std::vector<float> extRowTheta(2 * numPhi);
+	for (size_t e = 0; e < 2 * numPhi; e++)
+	{
+		extRowOrder[e] = e;
+		extRowTheta[e] = thetaOfPhi[e % numPhi] + ((e < numPhi) ? 0.0f : PI);
+	}
+	std::sort(extRowOrder.begin(), extRowOrder.end(),
+	          [&extRowTheta](size_t e1, size_t e2)
+	          { return extRowTheta[e1] < extRowTheta[e2]; });
+	// The grid starts at the first row so that uniform rows fall on it
+	const float theta0 = std::fmod(thetaOfPhi[0], dTheta);
+	std::vector<size_t> columnRow0(numThetaExt), columnRow1(numThetaExt);
+	std::vector<float> columnWeight1(numThetaExt);
+	for (size_t j = 0; j < numThetaExt; j++)
+	{
+		const float theta = theta0 + j * dTheta;
+		size_t next = 0;
+		while (next < extRowOrder.size() &&
+		       extRowTheta[extRowOrder[next]] <= theta)
+		{
+			next++;
+		}
+		const size_t e0 =
+		    extRowOrder[(next + extRowOrder.size() - 1) % extRowOrder.size()];
+		const size_t e1 = extRowOrder[next % extRowOrder.size()];
+		float gap = extRowTheta[e1] - extRowTheta[e0];
+		float offset = theta - extRowTheta[e0];
+		gap += (gap <= 0.0f) ? static_cast<float>(TWOPI) : 0.0f;
+		offset += (offset < 0.0f) ? static_cast<float>(TWOPI) : 0.0f;
+		columnRow0[j] = e0;
+		columnRow1[j] = e1;
+		columnWeight1[j] = std::clamp(offset / gap, 0.0f, 1.0f);
+	}
+
+	// Uniform s grid over [-sMax, sMax]
+	const size_t numS = std::max<size_t>(2 * numR, 4);
+	const float ds = 2.0f * sMax / static_cast<float>(numS - 1);
+	const size_t numOmega = numS / 2 + 1;  // Hermitian symmetry
+	const Util::FFT1D fftS{numS};
+	const Util::FFT1D fftTheta{numThetaExt};
+
+	// Histogram3D z_bin of every ordered ring pair
+	std::vector<long> z3OfRingPair(numRings * numRings, -1);
+	for (coord_t z3 = 0; z3 < histo3d.numZBin; z3++)
+	{
+		coord_t z1, z2;
+		histo3d.getZ1Z2(z3, z1, z2);
+		z3OfRingPair[z1 * numRings + z2] = z3;
+	}
+	// Unordered ring pairs (za <= zb) within the maximum ring difference
+	std::vector<std::pair<int, int>> ringPairs;
+	for (int za = 0; za < numRings; za++)
+	{
+		for (int zb = za; zb < numRings && zb - za <= m_maxRingDiff; zb++)
+		{
+			if (z3OfRingPair[za * numRings + zb] >= 0 &&
+			    z3OfRingPair[zb * numRings + za] >= 0)
+			{
+				ringPairs.emplace_back(za, zb);
+			}
+		}
+	}
+
+	std::vector<float> ringPositions(numRings);
+	for (int ring = 0; ring < numRings; ring++)
+	{
+		ringPositions[ring] =
+		    mr_scanner.getDetectorPos(ring * mr_scanner.detsPerRing).z;
+	}
+	const float halfRingSpacing =
+	    (numRings > 1) ? (ringPositions[numRings - 1] - ringPositions[0]) /
+	                         static_cast<float>(2 * (numRings - 1)) :
+	                     1.0f;
+	const float lorLength = 2.0f * mr_scanner.scannerRadius;
+
+	// Rebinned spectra (real and imaginary parts) and their weights
+	const size_t spectrumSize = numThetaExt * numOmega;
+	std::vector<float> rebinnedSpectra(numSlices * spectrumSize * 2, 0.0f);
+	std::vector<float> rebinnedWeights(numSlices * spectrumSize, 0.0f);
+
+	// 2. Rebinning of the oblique sinograms, one ring pair at a time
+	const size_t numRingPairs = ringPairs.size();
+	const std::pair<int, int>* ringPairsPtr = ringPairs.data();
+	const long* z3OfRingPairPtr = z3OfRingPair.data();
+	const float* ringPositionsPtr = ringPositions.data();
+	const size_t* columnRow0Ptr = columnRow0.data();
+	const size_t* columnRow1Ptr = columnRow1.data();
+	const float* columnWeight1Ptr = columnWeight1.data();
+	const float* thetaOfPhiPtr = thetaOfPhi.data();
+	const float* sOfBinPtr = sOfBin.data();
+	const int* signOfBinPtr = signOfBin.data();
+	const Histogram3D* histo3dPtr = &histo3d;
+	const Util::FFT1D* fftSPtr = &fftS;
+	const Util::FFT1D* fftThetaPtr = &fftTheta;
+	float* rebinnedSpectraPtr = rebinnedSpectra.data();
+	float* rebinnedWeightsPtr = rebinnedWeights.data();
+	const size_t numSlicesOut = numSlices;
+	const size_t numRLocal = numR;
+	const size_t numPhiLocal = numPhi;
+
+#pragma omp parallel for schedule(dynamic) default(none)                    \
+    firstprivate(numRingPairs, ringPairsPtr, z3OfRingPairPtr, numRings,     \
+                     ringPositionsPtr, columnRow0Ptr, columnRow1Ptr,        \
+                     columnWeight1Ptr, sOfBinPtr,                           \
+                     signOfBinPtr, histo3dPtr, fftSPtr, fftThetaPtr,        \
+                     rebinnedSpectraPtr, rebinnedWeightsPtr, numSlicesOut,  \
+                     numRLocal, numPhiLocal, numTheta, numThetaExt, numS,   \
+                     numOmega, ds, sMax, sliceSize, spectrumSize, kLimit,   \
+                     omegaLimit, halfRingSpacing, lorLength)
+	for (size_t pairIdx = 0; pairIdx < numRingPairs; pairIdx++)
+	{
+		const int za = ringPairsPtr[pairIdx].first;
+		const int zb = ringPairsPtr[pairIdx].second;
+		// d1 is in ring za for z3_ab and in ring zb for z3_ba
+		const size_t z3_ab = z3OfRingPairPtr[za * numRings + zb];
+		const size_t z3_ba = z3OfRingPairPtr[zb * numRings + za];
+
+		// Rows of the extended sinogram on the uniform s grid. The rows
+		// [0, numPhi) hold the LORs where the axial coordinate increases
+		// along the LOR direction, the rows [numPhi, 2*numPhi) the others
+		std::vector<float> rows(2 * numPhiLocal * numS);
+		std::vector<std::pair<float, float>> samples;
+		for (size_t e = 0; e < 2 * numPhiLocal; e++)
+		{
+			const size_t phi = e % numPhiLocal;
+			const bool opposite = e >= numPhiLocal;
+			const int wantedSign = opposite ? -1 : 1;
+			samples.clear();
+			for (coord_t r = 0; r < numRLocal; r++)
+			{
+				const size_t binInSlice = phi * numRLocal + r;
+				const size_t z3 =
+				    (za == zb || signOfBinPtr[binInSlice] == wantedSign) ?
+				        z3_ab :
+				        z3_ba;
+				samples.emplace_back(
+				    sOfBinPtr[binInSlice],
+				    histo3dPtr->getProjectionValue(z3 * sliceSize + binInSlice));
+			}
+			std::sort(samples.begin(), samples.end());
+
+			// Linear interpolation on the uniform s grid
+			float* row = rows.data() + e * numS;
+			for (size_t i = 0; i < numS; i++)
+			{
+				const float s_i = -sMax + i * ds;
+				const float s = opposite ? -s_i : s_i;
+				const auto next = std::upper_bound(
+				    samples.begin(), samples.end(), s,
+				    [](float v, const std::pair<float, float>& sample)
+				    { return v < sample.first; });
+				// Nearest sample beyond the ends of the row
+				if (next == samples.begin())
+				{
+					row[i] = samples.front().second;
+				}
+				else if (next == samples.end())
+				{
+					row[i] = samples.back().second;
+				}
+				else
+				{
+					const auto& [s0, v0] = *(next - 1);
+					const auto& [s1, v1] = *next;
+					const float t = (s1 > s0) ? (s - s0) / (s1 - s0) : 0.0f;
+					row[i] = (1.0f - t) * v0 + t * v1;
+				}
+			}
+		}
+
+		// Interpolation on the uniform angular grid
+		std::vector<std::complex<float>> sino(numThetaExt * numS);
+		for (size_t j = 0; j < numThetaExt; j++)
+		{
+			const float* row0 = rows.data() + columnRow0Ptr[j] * numS;
+			const float* row1 = rows.data() + columnRow1Ptr[j] * numS;
+			const float t = columnWeight1Ptr[j];
+			for (size_t i = 0; i < numS; i++)
+			{
+				sino[j * numS + i] = (1.0f - t) * row0[i] + t * row1[i];
+			}
+		}
+
+		// 2D Fourier transform (s, then theta)
+		for (size_t j = 0; j < numThetaExt; j++)
+		{
+			fftSPtr->forward(sino.data() + j * numS);
+		}
+		std::vector<std::complex<float>> column(numThetaExt);
+		for (size_t i = 0; i < numOmega; i++)
+		{
+			for (size_t j = 0; j < numThetaExt; j++)
+			{
+				column[j] = sino[j * numS + i];
+			}
+			fftThetaPtr->forward(column.data());
+			for (size_t j = 0; j < numThetaExt; j++)
+			{
+				sino[j * numS + i] = column[j];
+			}
+		}
+
+		// Frequency-distance relation: the activity seen at frequency
+		// (omega, k) lies at a distance -k/omega from the LOR center, so
+		// its slice is z - k*delta/omega
+		const int slice = za + zb;
+		const float delta =
+		    (ringPositionsPtr[zb] - ringPositionsPtr[za]) / lorLength;
+		for (size_t j = 0; j < numThetaExt; j++)
+		{
+			const int k = (j <= numTheta) ? static_cast<int>(j) :
+			                                static_cast<int>(j) -
+			                                    static_cast<int>(numThetaExt);
+			for (size_t i = 0; i < numOmega; i++)
+			{
+				const float omega = TWOPI * i / (numS * ds);
+				float sliceOut = static_cast<float>(slice);
+				if (std::abs(k) > kLimit && static_cast<int>(i) > omegaLimit)
+				{
+					if (std::abs(k) > omega * sMax)
+					{
+						// Outside of the support of the data
+						continue;
+					}
+					sliceOut -= k * delta / omega / halfRingSpacing;
+				}
+				if (sliceOut < 0.0f ||
+				    sliceOut > static_cast<float>(numSlicesOut - 1))
+				{
+					continue;
+				}
+				const int slice0 = static_cast<int>(sliceOut);
+				const int slice1 =
+				    std::min(slice0 + 1, static_cast<int>(numSlicesOut) - 1);
+				const float t = sliceOut - slice0;
+				const std::complex<float> value = sino[j * numS + i];
+				const size_t cell = j * numOmega + i;
+				for (int n = 0; n < 2; n++)
+				{
+					const int sliceN = (n == 0) ? slice0 : slice1;
+					const float weight = (n == 0) ? 1.0f - t : t;
+					if (weight <= 0.0f)
+					{
+						continue;
+					}
+					const size_t idx = sliceN * spectrumSize + cell;
+					float* ptr = rebinnedSpectraPtr + 2 * idx;
+#pragma omp atomic
+					ptr[0] += weight * value.real();
+#pragma omp atomic
+					ptr[1] += weight * value.imag();
+#pragma omp atomic
+					rebinnedWeightsPtr[idx] += weight;
+				}
+			}
+		}
+	}
+
+	// 3. Normalization, inverse transform and resampling in every slice
+	float* dataPtr = mp_data->getRawPointer();
+
+#pragma omp parallel for default(none)                                   \
+    firstprivate(dataPtr, rebinnedSpectraPtr, rebinnedWeightsPtr,        \
+                     fftSPtr, fftThetaPtr, thetaOfPhiPtr, sOfBinPtr,     \
+                     numSlicesOut, numRLocal, numPhiLocal, numThetaExt, \
+                     numS, numOmega, theta0, dTheta, ds, sMax,          \
+                     sliceSize,                                         \
+                     spectrumSize)
+	for (size_t slice = 0; slice < numSlicesOut; slice++)
+	{
+		std::vector<std::complex<float>> sino(numThetaExt * numS);
+		for (size_t j = 0; j < numThetaExt; j++)
+		{
+			for (size_t i = 0; i < numOmega; i++)
+			{
+				const size_t idx = slice * spectrumSize + j * numOmega + i;
+				const float weight = rebinnedWeightsPtr[idx];
+				std::complex<float> value{0.0f};
+				if (weight > 0.0f)
+				{
+					value = std::complex<float>(rebinnedSpectraPtr[2 * idx],
+					                            rebinnedSpectraPtr[2 * idx + 1]) /
+					        weight;
+				}
+				sino[j * numS + i] = value;
+			}
+		}
+		// Negative frequencies of omega from the Hermitian symmetry
+		for (size_t j = 0; j < numThetaExt; j++)
+		{
+			const size_t jSym = (numThetaExt - j) % numThetaExt;
+			for (size_t i = numOmega; i < numS; i++)
+			{
+				sino[j * numS + i] = std::conj(sino[jSym * numS + numS - i]);
+			}
+		}
+
+		std::vector<std::complex<float>> column(numThetaExt);
+		for (size_t i = 0; i < numS; i++)
+		{
+			for (size_t j = 0; j < numThetaExt; j++)
+			{
+				column[j] = sino[j * numS + i];
+			}
+			fftThetaPtr->inverse(column.data());
+			for (size_t j = 0; j < numThetaExt; j++)
+			{
+				sino[j * numS + i] = column[j];
+			}
+		}
+		for (size_t j = 0; j < numThetaExt; j++)
+		{
+			fftSPtr->inverse(sino.data() + j * numS);
+		}
+
+		// Back to the histogram sampling, averaging the two directions of
+		// every bin since each holds one of its two LORs
+		const auto interpolate = [&sino, numS, numThetaExt, theta0, dTheta,
+		                          ds, sMax](float theta, float s)
+		{
+			const float posTheta =
+			    std::fmod(theta - theta0 + static_cast<float>(TWOPI),
+			              static_cast<float>(TWOPI)) /
+			    dTheta;
+			const size_t j0 = static_cast<size_t>(posTheta) % numThetaExt;
+			const size_t j1 = (j0 + 1) % numThetaExt;
+			const float tTheta =
+			    std::clamp(posTheta - std::floor(posTheta), 0.0f, 1.0f);
+			const float posS = (s + sMax) / ds;
+			const int i0 = std::clamp(static_cast<int>(posS), 0,
+			                          static_cast<int>(numS) - 2);
+			const float tS = std::clamp(posS - i0, 0.0f, 1.0f);
+			const auto valueInColumn = [&](size_t j)
+			{
+				return (1.0f - tS) * sino[j * numS + i0].real() +
+				       tS * sino[j * numS + i0 + 1].real();
+			};
+			return (1.0f - tTheta) * valueInColumn(j0) +
+			       tTheta * valueInColumn(j1);
+		};
+		for (coord_t phi = 0; phi < numPhiLocal; phi++)
+		{
+			const float theta = thetaOfPhiPtr[phi];
+			for (coord_t r = 0; r < numRLocal; r++)
+			{
+				const size_t binInSlice = phi * numRLocal + r;
+				const float s = sOfBinPtr[binInSlice];
+				dataPtr[slice * sliceSize + binInSlice] =
+				    0.5f * (interpolate(theta, s) +
+				            interpolate(theta + static_cast<float>(PI), -s));
+			}
+		}
+	}
+}
+
+bool SinogramStack::isMemoryValid() const
+{
+	return mp_data != nullptr && mp_data->getRawPointer() != nullptr;
+}
+
+std::unique_ptr<ProjectionData>
+    SinogramStackOwned::create(const Scanner& scanner,
+                               const std::string& filename,
+                               const Plugin::OptionsResult& pluginOptions)
+{
+	int maxRingDiff = -1;
+	const auto maxRingDiff_it = pluginOptions.find("max_ring_diff");
+	if (maxRingDiff_it != pluginOptions.end())
+	{
+		maxRingDiff = std::stoi(maxRingDiff_it->second);
+	}
+	return std::make_unique<SinogramStackOwned>(scanner, filename,
+	                                            maxRingDiff);
+}
+
+Plugin::OptionsListPerPlugin SinogramStackOwned::getOptions()
+{
+	return {{"max_ring_diff",
+	         {"Maximum ring difference used in the rebinning (Default: the "
+	          "scanner's)",
+	          false}}};
+}
+
+REGISTER_PROJDATA_PLUGIN("H-2D", SinogramStackOwned,
+                         SinogramStackOwned::create,
+                         SinogramStackOwned::getOptions)
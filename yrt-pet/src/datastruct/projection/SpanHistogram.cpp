@@ -0,0 +1,468 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "datastruct/projection/SpanHistogram.hpp"
+
+#include "utils/Assert.hpp"
+
+#include <algorithm>
+
+#if BUILD_PYBIND11
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+namespace py = pybind11;
+
+void py_setup_spanhistogram(py::module& m)
+{
+	auto c = py::class_<SpanHistogram, Histogram>(m, "SpanHistogram",
+	                                              py::buffer_protocol());
+	c.def_readonly("numZBin", &SpanHistogram::numZBin);
+	c.def_readonly("numPhi", &SpanHistogram::numPhi);
+	c.def_readonly("numR", &SpanHistogram::numR);
+	c.def_readonly("histoSize", &SpanHistogram::histoSize);
+	c.def_buffer(
+	    [](SpanHistogram& self) -> py::buffer_info
+	    {
+		    Array3DBase<float>& d = self.getData();
+		    return py::buffer_info(d.getRawPointer(), sizeof(float),
+		                           py::format_descriptor<float>::format(), 3,
+		                           d.getDims(), d.getStrides());
+	    });
+	c.def("writeToFile", &SpanHistogram::writeToFile, py::arg("fname"));
+	c.def("getSpan", &SpanHistogram::getSpan);
+	c.def("getNumSegments", &SpanHistogram::getNumSegments);
+	c.def("getSegmentOfZBin", &SpanHistogram::getSegmentOfZBin,
+	      py::arg("z_bin"));
+	c.def("getNumRingPairsInZBin", &SpanHistogram::getNumRingPairsInZBin,
+	      py::arg("z_bin"));
+	c.def(
+	    "getZ1Z2",
+	    [](const SpanHistogram& self, coord_t z_bin, size_t ringPairIdx)
+	    {
+		    coord_t z1, z2;
+		    self.getZ1Z2(z_bin, ringPairIdx, z1, z2);
+		    return py::make_tuple(z1, z2);
+	    },
+	    py::arg("z_bin"), py::arg("ringPairIdx"));
+	c.def("getBinIdFromCoords", &SpanHistogram::getBinIdFromCoords,
+	      py::arg("r"), py::arg("phi"), py::arg("z_bin"));
+	c.def(
+	    "getCoordsFromBinId",
+	    [](const SpanHistogram& self, bin_t binId)
+	    {
+		    coord_t r, phi, z_bin;
+		    self.getCoordsFromBinId(binId, r, phi, z_bin);
+		    return py::make_tuple(r, phi, z_bin);
+	    },
+	    py::arg("binId"));
+	c.def("getBinIdFromDetPair", &SpanHistogram::getBinIdFromDetPair,
+	      py::arg("d1"), py::arg("d2"));
+	c.def("getBinIdFromHistogram3DBinId",
+	      &SpanHistogram::getBinIdFromHistogram3DBinId,
+	      py::arg("histo3dBinId"));
+	c.def("incrementProjection", &SpanHistogram::incrementProjection,
+	      py::arg("binId"), py::arg("val"));
+	c.def("mashHistogram3D", &SpanHistogram::mashHistogram3D,
+	      py::arg("histo3d"));
+	c.def("accumulate", &SpanHistogram::accumulate, py::arg("projData"),
+	      py::arg("binIter") = nullptr);
+
+	auto c_alias =
+	    py::class_<SpanHistogramAlias, SpanHistogram>(m, "SpanHistogramAlias");
+	c_alias.def(py::init<const Scanner&, int>(), py::arg("scanner"),
+	            py::arg("span"));
+	c_alias.def("bind", &SpanHistogramAlias::bind, py::arg("array3dfloat"));
+
+	auto c_owned =
+	    py::class_<SpanHistogramOwned, SpanHistogram>(m, "SpanHistogramOwned");
+	c_owned.def(py::init<const Scanner&, int>(), py::arg("scanner"),
+	            py::arg("span"));
+	c_owned.def(py::init<const Scanner&, const std::string&, int>(),
+	            py::arg("scanner"), py::arg("fname"), py::arg("span"));
+	c_owned.def(py::init<const Histogram3D&, int>(), py::arg("histo3d"),
+	            py::arg("span"));
+	c_owned.def("readFromFile", &SpanHistogramOwned::readFromFile,
+	            py::arg("fname"));
+	c_owned.def("allocate", &SpanHistogramOwned::allocate);
+}
+#endif
+
+SpanHistogram::SpanHistogram(const Scanner& pr_scanner, int p_span)
+    : Histogram{pr_scanner}, mp_data(nullptr), m_span(p_span)
+{
+	ASSERT_MSG(m_span > 0 && m_span % 2 == 1, "The span has to be odd");
+
+	mp_histo3d = std::make_unique<Histogram3DAlias>(mr_scanner);
+	numR = mp_histo3d->numR;
+	numPhi = mp_histo3d->numPhi;
+
+	const int numRings = mr_scanner.numRings;
+	const int halfSpan = (m_span - 1) / 2;
+	const int maxSegment =
+	    (static_cast<int>(mr_scanner.maxRingDiff) + halfSpan) / m_span;
+	m_numSegments = 2 * maxSegment + 1;
+
+	// Sort key of every Histogram3D z_bin: segment first (0, +1, -1, ...),
+	// then axial position
+	const size_t numHisto3DZBins = mp_histo3d->numZBin;
+	const int numAxialPositions = 2 * numRings - 1;
+	std::vector<int> keys(numHisto3DZBins);
+	std::vector<int> segments(numHisto3DZBins);
+	for (coord_t z3 = 0; z3 < numHisto3DZBins; z3++)
+	{
+		coord_t z1, z2;
+		mp_histo3d->getZ1Z2(z3, z1, z2);
+		const int delta = static_cast<int>(z2) - static_cast<int>(z1);
+		const int segmentAbs = (std::abs(delta) + halfSpan) / m_span;
+		const int segment = delta < 0 ? -segmentAbs : segmentAbs;
+		const int segmentOrder =
+		    segment > 0 ? 2 * segment - 1 : -2 * segment;
+		segments[z3] = segment;
+		keys[z3] = segmentOrder * numAxialPositions + z1 + z2;
+	}
+
+	// Only the (segment, axial position) pairs that contain ring pairs are
+	// kept as z_bins
+	std::vector<int> sortedKeys = keys;
+	std::sort(sortedKeys.begin(), sortedKeys.end());
+	sortedKeys.erase(std::unique(sortedKeys.begin(), sortedKeys.end()),
+	                 sortedKeys.end());
+	numZBin = sortedKeys.size();
+	histoSize = numZBin * numPhi * numR;
+
+	m_segmentOfZBin.resize(numZBin);
+	m_zBinFromHisto3DZBin.resize(numHisto3DZBins);
+	m_histo3DZBinsOffsets.assign(numZBin + 1, 0);
+	for (coord_t z3 = 0; z3 < numHisto3DZBins; z3++)
+	{
+		const coord_t z_bin =
+		    std::lower_bound(sortedKeys.begin(), sortedKeys.end(), keys[z3]) -
+		    sortedKeys.begin();
+		m_zBinFromHisto3DZBin[z3] = z_bin;
+		m_segmentOfZBin[z_bin] = segments[z3];
+		m_histo3DZBinsOffsets[z_bin + 1]++;
+	}
+	for (size_t z_bin = 0; z_bin < numZBin; z_bin++)
+	{
+		m_histo3DZBinsOffsets[z_bin + 1] += m_histo3DZBinsOffsets[z_bin];
+	}
+	m_histo3DZBins.resize(numHisto3DZBins);
+	std::vector<size_t> fillPositions(m_histo3DZBinsOffsets.begin(),
+	                                  m_histo3DZBinsOffsets.end() - 1);
+	for (coord_t z3 = 0; z3 < numHisto3DZBins; z3++)
+	{
+		m_histo3DZBins[fillPositions[m_zBinFromHisto3DZBin[z3]]++] = z3;
+	}
+}
+
+SpanHistogram::~SpanHistogram() {}
+
+SpanHistogramOwned::SpanHistogramOwned(const Scanner& pr_scanner, int p_span)
+    : SpanHistogram(pr_scanner, p_span)
+{
+	mp_data = std::make_unique<Array3D<float>>();
+}
+
+SpanHistogramOwned::SpanHistogramOwned(const Scanner& pr_scanner,
+                                       const std::string& filename,
+                                       int p_span)
+    : SpanHistogramOwned(pr_scanner, p_span)
+{
+	readFromFile(filename);
+}
+
+SpanHistogramOwned::SpanHistogramOwned(const Histogram3D& pr_histo3d,
+                                       int p_span)
+    : SpanHistogramOwned(pr_histo3d.getScanner(), p_span)
+{
+	allocate();
+	mashHistogram3D(pr_histo3d);
+}
+
+void SpanHistogramOwned::allocate()
+{
+	static_cast<Array3D<float>*>(mp_data.get())
+	    ->allocate(numZBin, numPhi, numR);
+}
+
+void SpanHistogramOwned::readFromFile(const std::string& filename)
+{
+	std::array<size_t, 3> dims{numZBin, numPhi, numR};
+	try
+	{
+		mp_data->readFromFile(filename, dims);
+	}
+	catch (const std::exception& e)
+	{
+		throw std::runtime_error(
+		    "Error during Histogram initialization either the scanner\'s "
+		    "attributes or the span do not match the histogram given, the file "
+		    "given is inexistant or the file given is not a valid histogram "
+		    "file");
+	}
+}
+
+SpanHistogramAlias::SpanHistogramAlias(const Scanner& pr_scanner, int p_span)
+    : SpanHistogram(pr_scanner, p_span)
+{
+	mp_data = std::make_unique<Array3DAlias<float>>();
+}
+
+void SpanHistogramAlias::bind(Array3DBase<float>& pr_data)
+{
+	static_cast<Array3DAlias<float>*>(mp_data.get())->bind(pr_data);
+	if (mp_data->getRawPointer() != pr_data.getRawPointer())
+	{
+		throw std::runtime_error(
+		    "Error occured in the binding of the given array");
+	}
+}
+
+void SpanHistogram::writeToFile(const std::string& filename) const
+{
+	mp_data->writeToFile(filename);
+}
+
+int SpanHistogram::getSpan() const
+{
+	return m_span;
+}
+
+int SpanHistogram::getNumSegments() const
+{
+	return m_numSegments;
+}
+
+int SpanHistogram::getSegmentOfZBin(coord_t z_bin) const
+{
+	return m_segmentOfZBin[z_bin];
+}
+
+size_t SpanHistogram::getNumRingPairsInZBin(coord_t z_bin) const
+{
+	return m_histo3DZBinsOffsets[z_bin + 1] - m_histo3DZBinsOffsets[z_bin];
+}
+
+void SpanHistogram::getZ1Z2(coord_t z_bin, size_t ringPairIdx, coord_t& z1,
+                            coord_t& z2) const
+{
+	ASSERT(ringPairIdx < getNumRingPairsInZBin(z_bin));
+	mp_histo3d->getZ1Z2(
+	    m_histo3DZBins[m_histo3DZBinsOffsets[z_bin] + ringPairIdx], z1, z2);
+}
+
+bin_t SpanHistogram::getBinIdFromCoords(coord_t r, coord_t phi,
+                                        coord_t z_bin) const
+{
+	return z_bin * numPhi * numR + phi * numR + r;
+}
+
+void SpanHistogram::getCoordsFromBinId(bin_t binId, coord_t& r, coord_t& phi,
+                                       coord_t& z_bin) const
+{
+	z_bin = binId / (numPhi * numR);
+	phi = (binId % (numPhi * numR)) / numR;
+	r = (binId % (numPhi * numR)) % numR;
+}
+
+bin_t SpanHistogram::getBinIdFromDetPair(det_id_t d1, det_id_t d2) const
+{
+	coord_t r, phi, z3;
+	mp_histo3d->getCoordsFromDetPair(d1, d2, r, phi, z3);
+	return getBinIdFromCoords(r, phi, m_zBinFromHisto3DZBin[z3]);
+}
+
+bin_t SpanHistogram::getBinIdFromHistogram3DBinId(bin_t histo3dBinId) const
+{
+	coord_t r, phi, z3;
+	mp_histo3d->getCoordsFromBinId(histo3dBinId, r, phi, z3);
+	return getBinIdFromCoords(r, phi, m_zBinFromHisto3DZBin[z3]);
+}
+
+size_t SpanHistogram::count() const
+{
+	return histoSize;
+}
+
+float SpanHistogram::getProjectionValue(bin_t binId) const
+{
+	return mp_data->getFlat(binId);
+}
+
+void SpanHistogram::setProjectionValue(bin_t binId, float val)
+{
+	mp_data->setFlat(binId, val);
+}
+
+void SpanHistogram::incrementProjection(bin_t binId, float val)
+{
+	mp_data->incrementFlat(binId, val);
+}
+
+det_id_t SpanHistogram::getDetector1(bin_t id) const
+{
+	return getDetectorPairInBin(id, 0).d1;
+}
+
+det_id_t SpanHistogram::getDetector2(bin_t id) const
+{
+	return getDetectorPairInBin(id, 0).d2;
+}
+
+det_pair_t SpanHistogram::getDetectorPair(bin_t id) const
+{
+	return getDetectorPairInBin(id, 0);
+}
+
+std::unique_ptr<BinIterator> SpanHistogram::getBinIter(int numSubsets,
+                                                       int idxSubset) const
+{
+	if (idxSubset < 0 || numSubsets <= 0)
+		throw std::invalid_argument(
+		    "The subset index cannot be negative, the number of subsets cannot "
+		    "be less or equal than zero");
+	if (idxSubset >= numSubsets)
+		throw std::invalid_argument(
+		    "The subset index has to be smaller than the number of subsets");
+	return std::make_unique<BinIteratorRangeHistogram3D>(numZBin, numPhi, numR,
+	                                                     numSubsets, idxSubset);
+}
+
+void SpanHistogram::clearProjections(float value)
+{
+	mp_data->fill(value);
+}
+
+float SpanHistogram::getProjectionValueFromHistogramBin(
+    histo_bin_t histoBinId) const
+{
+	bin_t binId;
+	if (std::holds_alternative<bin_t>(histoBinId))
+	{
+		// Only the Histogram3D gives its bins, which are single LORs
+		binId = getBinIdFromHistogram3DBinId(std::get<bin_t>(histoBinId));
+	}
+	else
+	{
+		// Use the detector pair
+		const auto [d1, d2] = getDetPairFromHistogramBin(histoBinId);
+		binId = getBinIdFromDetPair(d1, d2);
+	}
+	// Share of a single LOR of the bundle
+	return getProjectionValue(binId) / getNumLORsInBin(binId);
+}
+
+bool SpanHistogram::hasLORBundles() const
+{
+	return true;
+}
+
+size_t SpanHistogram::getNumLORsInBin(bin_t bin) const
+{
+	return getNumRingPairsInZBin(bin / (numPhi * numR));
+}
+
+det_pair_t SpanHistogram::getDetectorPairInBin(bin_t bin, size_t lorIdx) const
+{
+	coord_t r, phi, z_bin;
+	getCoordsFromBinId(bin, r, phi, z_bin);
+	const coord_t z3 = m_histo3DZBins[m_histo3DZBinsOffsets[z_bin] + lorIdx];
+	det_id_t d1, d2;
+	mp_histo3d->getDetPairFromCoords(r, phi, z3, d1, d2);
+	return {d1, d2};
+}
+
+void SpanHistogram::mashHistogram3D(const Histogram3D& histo3d)
+{
+	ASSERT_MSG(histo3d.numZBin == mp_histo3d->numZBin &&
+	               histo3d.numPhi == numPhi && histo3d.numR == numR,
+	           "The histogram given does not match the scanner");
+	ASSERT(isMemoryValid());
+
+	float* dataPtr = mp_data->getRawPointer();
+	const Histogram3D* histo3dPtr = &histo3d;
+	const size_t* offsetsPtr = m_histo3DZBinsOffsets.data();
+	const coord_t* histo3DZBinsPtr = m_histo3DZBins.data();
+	const size_t sliceSize = numPhi * numR;
+	const size_t numBins = histoSize;
+
+	// Each compressed bin gathers its ring pairs, so no two threads write
+	// the same bin
+#pragma omp parallel for default(none)                               \
+    firstprivate(dataPtr, histo3dPtr, offsetsPtr, histo3DZBinsPtr, \
+                     sliceSize, numBins)
+	for (bin_t binId = 0; binId < numBins; binId++)
+	{
+		const coord_t z_bin = binId / sliceSize;
+		const bin_t binInSlice = binId % sliceSize;
+		float sum = 0.0f;
+		for (size_t i = offsetsPtr[z_bin]; i < offsetsPtr[z_bin + 1]; i++)
+		{
+			sum += histo3dPtr->getProjectionValue(histo3DZBinsPtr[i] *
+			                                          sliceSize +
+			                                      binInSlice);
+		}
+		dataPtr[binId] = sum;
+	}
+}
+
+void SpanHistogram::accumulate(const ProjectionData& projData,
+                               const BinIterator* binIter)
+{
+	size_t numBins;
+	if (binIter == nullptr)
+	{
+		numBins = projData.count();
+	}
+	else
+	{
+		numBins = binIter->size();
+	}
+
+	for (bin_t bin = 0; bin < numBins; bin++)
+	{
+		bin_t binId = bin;
+		if (binIter != nullptr)
+		{
+			binId = binIter->get(bin);
+		}
+
+		const float projValue = projData.getProjectionValue(binId);
+		if (projValue == 0.0f)
+		{
+			continue;
+		}
+		const auto [d1, d2] = projData.getDetectorPair(binId);
+		incrementProjection(getBinIdFromDetPair(d1, d2), projValue);
+	}
+}
+
+bool SpanHistogram::isMemoryValid() const
+{
+	return mp_data != nullptr && mp_data->getRawPointer() != nullptr;
+}
+
+std::unique_ptr<ProjectionData>
+    SpanHistogramOwned::create(const Scanner& scanner,
+                               const std::string& filename,
+                               const Plugin::OptionsResult& pluginOptions)
+{
+	int span = 3;
+	const auto span_it = pluginOptions.find("span");
+	if (span_it != pluginOptions.end())
+	{
+		span = std::stoi(span_it->second);
+	}
+	return std::make_unique<SpanHistogramOwned>(scanner, filename, span);
+}
+
+Plugin::OptionsListPerPlugin SpanHistogramOwned::getOptions()
+{
+	return {{"span", {"Axial compression of the histogram (Default: 3)", false}}};
+}
+
+REGISTER_PROJDATA_PLUGIN("H-SPAN", SpanHistogramOwned,
+                         SpanHistogramOwned::create,
+                         SpanHistogramOwned::getOptions)
@@ -6,7 +6,9 @@
 #include "datastruct/projection/SparseHistogram.hpp"
 #include "utils/Assert.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <vector>
 
 #if BUILD_PYBIND11
 #include <pybind11/numpy.h>
@@ -48,6 +50,8 @@ void py_setup_sparsehistogram(py::module& m)
 	      &SparseHistogram::getProjectionValueFromDetPair, "detPair"_a);
 	c.def("readFromFile", &SparseHistogram::readFromFile, "filename"_a);
 	c.def("writeToFile", &SparseHistogram::writeToFile, "filename"_a);
+	c.def("writeToFileChunked", &SparseHistogram::writeToFileChunked,
+	      "filename"_a, "compression"_a = Util::ChunkCompression::ZLIB);
 	c.def("getProjValuesArray",
 	      [](SparseHistogram& self) -> pybind11::array_t<float>
 	      {
@@ -211,8 +215,8 @@ void SparseHistogram::setProjectionValue(bin_t id, float val)
 float SparseHistogram::getProjectionValueFromHistogramBin(
     histo_bin_t histoBinId) const
 {
-	ASSERT(std::holds_alternative<det_pair_t>(histoBinId));
-	const auto detPair = std::get<det_pair_t>(histoBinId);
+	ASSERT(!std::holds_alternative<bin_t>(histoBinId));
+	const det_pair_t detPair = getDetPairFromHistogramBin(histoBinId);
 	return getProjectionValueFromDetPair(detPair);
 }
 
@@ -262,8 +266,72 @@ void SparseHistogram::writeToFile(const std::string& filename) const
 	ofs.close();
 }
 
+void SparseHistogram::writeToFileChunked(
+    const std::string& filename, Util::ChunkCompression compression) const
+{
+	static_assert(sizeof(det_id_t) == sizeof(float));
+	Util::writeChunkedFile(
+	    filename, {count(), NumFieldsPerEvent}, sizeof(float),
+	    [this](size_t firstEvent, size_t numEvents, void* dst)
+	    {
+		    auto* dst_float = static_cast<float*>(dst);
+		    for (size_t i = 0; i < numEvents; i++)
+		    {
+			    const bin_t bin = firstEvent + i;
+			    std::memcpy(&dst_float[NumFieldsPerEvent * i + 0],
+			                &m_detPairs[bin].d1, sizeof(det_id_t));
+			    std::memcpy(&dst_float[NumFieldsPerEvent * i + 1],
+			                &m_detPairs[bin].d2, sizeof(det_id_t));
+			    dst_float[NumFieldsPerEvent * i + 2] = m_projValues[bin];
+		    }
+	    },
+	    compression, EventsPerChunk);
+}
+
+void SparseHistogram::readFromChunkedFile(const std::string& filename)
+{
+	const Util::ChunkedFileHeader header =
+	    Util::readChunkedFileHeader(filename);
+	if (header.shape.size() != 2 || header.shape[1] != NumFieldsPerEvent ||
+	    header.elementSize != sizeof(float))
+	{
+		throw std::runtime_error("Error: The chunked file " + filename +
+		                         " is not a sparse histogram");
+	}
+	const size_t numEvents = header.shape[0];
+	allocate(numEvents);
+
+	// Read a few chunks at a time, decompressed in parallel
+	const size_t eventsPerRead = 64 * header.slabsPerChunk;
+	std::vector<float> buff(
+	    NumFieldsPerEvent * std::min(eventsPerRead, numEvents));
+	for (size_t firstEvent = 0; firstEvent < numEvents;
+	     firstEvent += eventsPerRead)
+	{
+		const size_t readSize_events =
+		    std::min(eventsPerRead, numEvents - firstEvent);
+		Util::readChunkedFile(filename, header, buff.data(), firstEvent,
+		                      readSize_events);
+		for (size_t i = 0; i < readSize_events; i++)
+		{
+			det_id_t d1, d2;
+			std::memcpy(&d1, &buff[NumFieldsPerEvent * i + 0],
+			            sizeof(det_id_t));
+			std::memcpy(&d2, &buff[NumFieldsPerEvent * i + 1],
+			            sizeof(det_id_t));
+			accumulate({d1, d2}, buff[NumFieldsPerEvent * i + 2]);
+		}
+	}
+}
+
 void SparseHistogram::readFromFile(const std::string& filename)
 {
+	if (Util::isChunkedFile(filename))
+	{
+		readFromChunkedFile(filename);
+		return;
+	}
+
 	std::ifstream ifs{filename, std::ios::in | std::ios::binary};
 
 	if (!ifs.good())
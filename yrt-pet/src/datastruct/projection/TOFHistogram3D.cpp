@@ -0,0 +1,423 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "datastruct/projection/TOFHistogram3D.hpp"
+
+#include "operators/TimeOfFlight.hpp"
+#include "utils/Assert.hpp"
+
+#include <cmath>
+
+#if BUILD_PYBIND11
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+namespace py = pybind11;
+
+void py_setup_tofhistogram3d(py::module& m)
+{
+	auto c = py::class_<TOFHistogram3D, Histogram>(m, "TOFHistogram3D",
+	                                               py::buffer_protocol());
+	c.def_readonly("numZBin", &TOFHistogram3D::numZBin);
+	c.def_readonly("numPhi", &TOFHistogram3D::numPhi);
+	c.def_readonly("numR", &TOFHistogram3D::numR);
+	c.def_readonly("numTOFBins", &TOFHistogram3D::numTOFBins);
+	c.def_readonly("histoSize", &TOFHistogram3D::histoSize);
+	c.def_buffer(
+	    [](TOFHistogram3D& self) -> py::buffer_info
+	    {
+		    Array2DBase<float>& d = self.getData();
+		    return py::buffer_info(d.getRawPointer(), sizeof(float),
+		                           py::format_descriptor<float>::format(), 2,
+		                           d.getDims(), d.getStrides());
+	    });
+	c.def("writeToFile", &TOFHistogram3D::writeToFile, py::arg("fname"));
+	c.def("getTOFBinCenter", &TOFHistogram3D::getTOFBinCenter,
+	      py::arg("tofBin"));
+	c.def("getTOFBinFromValue", &TOFHistogram3D::getTOFBinFromValue,
+	      py::arg("tofValue_ps"));
+	c.def("getHistogram3D", &TOFHistogram3D::getHistogram3D,
+	      py::return_value_policy::reference_internal);
+	c.def("getBinIdFromCoords", &TOFHistogram3D::getBinIdFromCoords,
+	      py::arg("r"), py::arg("phi"), py::arg("z_bin"), py::arg("tofBin"));
+	c.def(
+	    "getCoordsFromBinId",
+	    [](const TOFHistogram3D& self, bin_t binId)
+	    {
+		    coord_t r, phi, z_bin, tofBin;
+		    self.getCoordsFromBinId(binId, r, phi, z_bin, tofBin);
+		    return py::make_tuple(r, phi, z_bin, tofBin);
+	    },
+	    py::arg("binId"));
+	c.def("getBinIdFromHistogram3DBinId",
+	      &TOFHistogram3D::getBinIdFromHistogram3DBinId,
+	      py::arg("histo3dBinId"), py::arg("tofBin"));
+	c.def("getHistogram3DBinId", &TOFHistogram3D::getHistogram3DBinId,
+	      py::arg("binId"));
+	c.def(
+	    "getBinIdFromEvent",
+	    [](const TOFHistogram3D& self, det_id_t d1, det_id_t d2,
+	       float tofValue_ps) -> py::object
+	    {
+		    bin_t binId;
+		    if (!self.getBinIdFromEvent(d1, d2, tofValue_ps, binId))
+		    {
+			    return py::none();
+		    }
+		    return py::cast(binId);
+	    },
+	    py::arg("d1"), py::arg("d2"), py::arg("tofValue_ps"));
+	c.def("incrementProjection", &TOFHistogram3D::incrementProjection,
+	      py::arg("binId"), py::arg("val"));
+	c.def("collapseToHistogram3D", &TOFHistogram3D::collapseToHistogram3D,
+	      py::arg("histo3d"));
+
+	auto c_alias = py::class_<TOFHistogram3DAlias, TOFHistogram3D>(
+	    m, "TOFHistogram3DAlias");
+	c_alias.def(py::init<const Scanner&, size_t, float>(), py::arg("scanner"),
+	            py::arg("numTOFBins"), py::arg("tofBinWidth_ps"));
+	c_alias.def("bind", &TOFHistogram3DAlias::bind, py::arg("array2dfloat"));
+
+	auto c_owned = py::class_<TOFHistogram3DOwned, TOFHistogram3D>(
+	    m, "TOFHistogram3DOwned");
+	c_owned.def(py::init<const Scanner&, size_t, float>(), py::arg("scanner"),
+	            py::arg("numTOFBins"), py::arg("tofBinWidth_ps"));
+	c_owned.def(py::init<const Scanner&, const std::string&, size_t, float>(),
+	            py::arg("scanner"), py::arg("fname"), py::arg("numTOFBins"),
+	            py::arg("tofBinWidth_ps"));
+	c_owned.def("readFromFile", &TOFHistogram3DOwned::readFromFile,
+	            py::arg("fname"));
+	c_owned.def("allocate", &TOFHistogram3DOwned::allocate);
+}
+#endif
+
+TOFHistogram3D::TOFHistogram3D(const Scanner& pr_scanner, size_t p_numTOFBins,
+                               float p_tofBinWidth_ps)
+    : Histogram{pr_scanner},
+      numTOFBins(p_numTOFBins),
+      mp_data(nullptr),
+      m_tofBinWidth_ps(p_tofBinWidth_ps)
+{
+	ASSERT_MSG(numTOFBins > 0 &&
+	               numTOFBins <= TimeOfFlightHelper::MaxNumTOFBins,
+	           "Invalid number of TOF bins");
+	ASSERT_MSG(m_tofBinWidth_ps > 0.f, "The TOF bin width has to be positive");
+
+	mp_histo3d = std::make_unique<Histogram3DAlias>(mr_scanner);
+	numR = mp_histo3d->numR;
+	numPhi = mp_histo3d->numPhi;
+	numZBin = mp_histo3d->numZBin;
+	histoSize = mp_histo3d->count() * numTOFBins;
+}
+
+TOFHistogram3D::~TOFHistogram3D() {}
+
+TOFHistogram3DOwned::TOFHistogram3DOwned(const Scanner& pr_scanner,
+                                         size_t p_numTOFBins,
+                                         float p_tofBinWidth_ps)
+    : TOFHistogram3D(pr_scanner, p_numTOFBins, p_tofBinWidth_ps)
+{
+	mp_data = std::make_unique<Array2D<float>>();
+}
+
+TOFHistogram3DOwned::TOFHistogram3DOwned(const Scanner& pr_scanner,
+                                         const std::string& filename,
+                                         size_t p_numTOFBins,
+                                         float p_tofBinWidth_ps)
+    : TOFHistogram3DOwned(pr_scanner, p_numTOFBins, p_tofBinWidth_ps)
+{
+	readFromFile(filename);
+}
+
+void TOFHistogram3DOwned::allocate()
+{
+	static_cast<Array2D<float>*>(mp_data.get())
+	    ->allocate(mp_histo3d->count(), numTOFBins);
+}
+
+void TOFHistogram3DOwned::readFromFile(const std::string& filename)
+{
+	std::array<size_t, 2> dims{mp_histo3d->count(), numTOFBins};
+	try
+	{
+		mp_data->readFromFile(filename, dims);
+	}
+	catch (const std::exception& e)
+	{
+		throw std::runtime_error(
+		    "Error during Histogram initialization either the scanner\'s "
+		    "attributes or the number of TOF bins do not match the histogram "
+		    "given, the file given is inexistant or the file given is not a "
+		    "valid histogram file");
+	}
+}
+
+TOFHistogram3DAlias::TOFHistogram3DAlias(const Scanner& pr_scanner,
+                                         size_t p_numTOFBins,
+                                         float p_tofBinWidth_ps)
+    : TOFHistogram3D(pr_scanner, p_numTOFBins, p_tofBinWidth_ps)
+{
+	mp_data = std::make_unique<Array2DAlias<float>>();
+}
+
+void TOFHistogram3DAlias::bind(Array2DBase<float>& pr_data)
+{
+	static_cast<Array2DAlias<float>*>(mp_data.get())->bind(pr_data);
+	if (mp_data->getRawPointer() != pr_data.getRawPointer())
+	{
+		throw std::runtime_error(
+		    "Error occured in the binding of the given array");
+	}
+}
+
+void TOFHistogram3D::writeToFile(const std::string& filename) const
+{
+	mp_data->writeToFile(filename);
+}
+
+float TOFHistogram3D::getTOFBinCenter(coord_t tofBin) const
+{
+	return (static_cast<float>(tofBin) -
+	        0.5f * static_cast<float>(numTOFBins - 1)) *
+	       m_tofBinWidth_ps;
+}
+
+int TOFHistogram3D::getTOFBinFromValue(float tofValue_ps) const
+{
+	const float tofBin_f = std::floor(tofValue_ps / m_tofBinWidth_ps +
+	                                  0.5f * static_cast<float>(numTOFBins));
+	if (tofBin_f < 0.0f || tofBin_f >= static_cast<float>(numTOFBins))
+	{
+		return -1;
+	}
+	return static_cast<int>(tofBin_f);
+}
+
+const Histogram3D& TOFHistogram3D::getHistogram3D() const
+{
+	return *mp_histo3d;
+}
+
+bin_t TOFHistogram3D::getBinIdFromCoords(coord_t r, coord_t phi,
+                                         coord_t z_bin, coord_t tofBin) const
+{
+	return getBinIdFromHistogram3DBinId(
+	    mp_histo3d->getBinIdFromCoords(r, phi, z_bin), tofBin);
+}
+
+void TOFHistogram3D::getCoordsFromBinId(bin_t binId, coord_t& r, coord_t& phi,
+                                        coord_t& z_bin, coord_t& tofBin) const
+{
+	mp_histo3d->getCoordsFromBinId(getHistogram3DBinId(binId), r, phi, z_bin);
+	tofBin = binId % numTOFBins;
+}
+
+bin_t TOFHistogram3D::getBinIdFromHistogram3DBinId(bin_t histo3dBinId,
+                                                   coord_t tofBin) const
+{
+	return histo3dBinId * numTOFBins + tofBin;
+}
+
+bin_t TOFHistogram3D::getHistogram3DBinId(bin_t binId) const
+{
+	return binId / numTOFBins;
+}
+
+bool TOFHistogram3D::getBinIdFromEvent(det_id_t d1, det_id_t d2,
+                                       float tofValue_ps, bin_t& binId) const
+{
+	const bin_t histo3dBinId = mp_histo3d->getBinIdFromDetPair(d1, d2);
+	if (mp_histo3d->getDetPairFromBinId(histo3dBinId).d1 != d1)
+	{
+		tofValue_ps = -tofValue_ps;
+	}
+	const int tofBin = getTOFBinFromValue(tofValue_ps);
+	if (tofBin < 0)
+	{
+		return false;
+	}
+	binId = getBinIdFromHistogram3DBinId(histo3dBinId, tofBin);
+	return true;
+}
+
+size_t TOFHistogram3D::count() const
+{
+	return histoSize;
+}
+
+float TOFHistogram3D::getProjectionValue(bin_t binId) const
+{
+	return mp_data->getFlat(binId);
+}
+
+void TOFHistogram3D::setProjectionValue(bin_t binId, float val)
+{
+	mp_data->setFlat(binId, val);
+}
+
+void TOFHistogram3D::incrementProjection(bin_t binId, float val)
+{
+	mp_data->incrementFlat(binId, val);
+}
+
+det_id_t TOFHistogram3D::getDetector1(bin_t id) const
+{
+	return getDetectorPair(id).d1;
+}
+
+det_id_t TOFHistogram3D::getDetector2(bin_t id) const
+{
+	return getDetectorPair(id).d2;
+}
+
+det_pair_t TOFHistogram3D::getDetectorPair(bin_t id) const
+{
+	return mp_histo3d->getDetPairFromBinId(getHistogram3DBinId(id));
+}
+
+histo_bin_t TOFHistogram3D::getHistogramBin(bin_t bin) const
+{
+	const auto [d1, d2] = getDetectorPair(bin);
+	return det_pair_tof_t{d1, d2, static_cast<uint32_t>(bin % numTOFBins),
+	                      static_cast<uint32_t>(numTOFBins)};
+}
+
+std::unique_ptr<BinIterator> TOFHistogram3D::getBinIter(int numSubsets,
+                                                        int idxSubset) const
+{
+	if (idxSubset < 0 || numSubsets <= 0)
+		throw std::invalid_argument(
+		    "The subset index cannot be negative, the number of subsets cannot "
+		    "be less or equal than zero");
+	if (idxSubset >= numSubsets)
+		throw std::invalid_argument(
+		    "The subset index has to be smaller than the number of subsets");
+	// The TOF bins extend the r dimension, so that they stay consecutive and
+	// in the same subset
+	return std::make_unique<BinIteratorRangeHistogram3D>(
+	    numZBin, numPhi, numR * numTOFBins, numSubsets, idxSubset);
+}
+
+void TOFHistogram3D::clearProjections(float value)
+{
+	mp_data->fill(value);
+}
+
+float TOFHistogram3D::getProjectionValueFromHistogramBin(
+    histo_bin_t histoBinId) const
+{
+	bin_t histo3dBinId;
+	if (std::holds_alternative<bin_t>(histoBinId))
+	{
+		// Only the Histogram3D gives its bins, which share our LORs
+		histo3dBinId = std::get<bin_t>(histoBinId);
+	}
+	else
+	{
+		// Use the detector pair
+		const auto [d1, d2] = getDetPairFromHistogramBin(histoBinId);
+		histo3dBinId = mp_histo3d->getBinIdFromDetPair(d1, d2);
+	}
+	const bin_t firstBin = getBinIdFromHistogram3DBinId(histo3dBinId, 0);
+	if (std::holds_alternative<det_pair_tof_t>(histoBinId))
+	{
+		const det_pair_tof_t detPairTOF = std::get<det_pair_tof_t>(histoBinId);
+		ASSERT_MSG(detPairTOF.numTOFBins == numTOFBins,
+		           "Mismatch in the number of TOF bins");
+		// The TOF bins are flipped if the detectors are in the opposite
+		// order of the histogram's LOR
+		coord_t tofBin = detPairTOF.tofBin;
+		if (mp_histo3d->getDetPairFromBinId(histo3dBinId).d1 !=
+		    detPairTOF.d1)
+		{
+			tofBin = numTOFBins - 1 - tofBin;
+		}
+		return getProjectionValue(firstBin + tofBin);
+	}
+	float sum = 0.0f;
+	for (coord_t tofBin = 0; tofBin < numTOFBins; tofBin++)
+	{
+		sum += getProjectionValue(firstBin + tofBin);
+	}
+	return sum;
+}
+
+bool TOFHistogram3D::hasTOF() const
+{
+	return true;
+}
+
+float TOFHistogram3D::getTOFValue(bin_t id) const
+{
+	return getTOFBinCenter(id % numTOFBins);
+}
+
+bool TOFHistogram3D::hasTOFBins() const
+{
+	return true;
+}
+
+size_t TOFHistogram3D::getNumTOFBins() const
+{
+	return numTOFBins;
+}
+
+float TOFHistogram3D::getTOFBinWidth() const
+{
+	return m_tofBinWidth_ps;
+}
+
+void TOFHistogram3D::collapseToHistogram3D(Histogram3D& histo3d) const
+{
+	ASSERT_MSG(histo3d.count() == mp_histo3d->count(),
+	           "The histogram given does not match the scanner");
+	ASSERT(isMemoryValid());
+
+	const float* dataPtr = mp_data->getRawPointer();
+	Histogram3D* histo3dPtr = &histo3d;
+	const size_t numLORBins = mp_histo3d->count();
+	const size_t numTOFBins_l = numTOFBins;
+#pragma omp parallel for default(none) \
+    firstprivate(dataPtr, histo3dPtr, numLORBins, numTOFBins_l)
+	for (bin_t histo3dBinId = 0; histo3dBinId < numLORBins; histo3dBinId++)
+	{
+		const float* lorPtr = dataPtr + histo3dBinId * numTOFBins_l;
+		float sum = 0.0f;
+		for (size_t tofBin = 0; tofBin < numTOFBins_l; tofBin++)
+		{
+			sum += lorPtr[tofBin];
+		}
+		histo3dPtr->setProjectionValue(histo3dBinId, sum);
+	}
+}
+
+bool TOFHistogram3D::isMemoryValid() const
+{
+	return mp_data != nullptr && mp_data->getRawPointer() != nullptr;
+}
+
+std::unique_ptr<ProjectionData>
+    TOFHistogram3DOwned::create(const Scanner& scanner,
+                                const std::string& filename,
+                                const Plugin::OptionsResult& pluginOptions)
+{
+	const auto numTOFBins_it = pluginOptions.find("num_tof_bins");
+	const auto tofBinWidth_it = pluginOptions.find("tof_bin_width");
+	ASSERT_MSG(numTOFBins_it != pluginOptions.end() &&
+	               tofBinWidth_it != pluginOptions.end(),
+	           "The number of TOF bins and their width have to be specified");
+	return std::make_unique<TOFHistogram3DOwned>(
+	    scanner, filename, std::stoul(numTOFBins_it->second),
+	    std::stof(tofBinWidth_it->second));
+}
+
+Plugin::OptionsListPerPlugin TOFHistogram3DOwned::getOptions()
+{
+	return {{"num_tof_bins", {"Number of TOF bins per LOR", false}},
+	        {"tof_bin_width", {"Width of the TOF bins (in ps)", false}}};
+}
+
+REGISTER_PROJDATA_PLUGIN("H-TOF", TOFHistogram3DOwned,
+                         TOFHistogram3DOwned::create,
+                         TOFHistogram3DOwned::getOptions)
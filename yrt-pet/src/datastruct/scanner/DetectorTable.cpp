@@ -0,0 +1,38 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "datastruct/scanner/DetectorTable.hpp"
+
+#include "datastruct/scanner/DetectorSetup.hpp"
+
+#include <algorithm>
+
+DetectorTable::DetectorTable(const DetectorSetup& pr_detectors)
+    : m_numDets(pr_detectors.getNumDets())
+{
+	constexpr size_t FloatsPerLine = Alignment / sizeof(float);
+	m_stride = (m_numDets + FloatsPerLine - 1) / FloatsPerLine * FloatsPerLine;
+	m_stride = std::max(m_stride, FloatsPerLine);
+
+	mp_data.reset(new (std::align_val_t{Alignment}) float[6 * m_stride]());
+
+	float* xPos = mp_data.get();
+	float* yPos = xPos + m_stride;
+	float* zPos = xPos + 2 * m_stride;
+	float* xOrient = xPos + 3 * m_stride;
+	float* yOrient = xPos + 4 * m_stride;
+	float* zOrient = xPos + 5 * m_stride;
+	for (det_id_t id = 0; id < m_numDets; id++)
+	{
+		const Vector3D pos = pr_detectors.getPos(id);
+		const Vector3D orient = pr_detectors.getOrient(id);
+		xPos[id] = pos.x;
+		yPos[id] = pos.y;
+		zPos[id] = pos.z;
+		xOrient[id] = orient.x;
+		yOrient[id] = orient.y;
+		zOrient[id] = orient.z;
+	}
+}
@@ -75,6 +75,7 @@ void py_setup_scanner(pybind11::module& m)
 	c.def("setDetectorSetup",
 	      [](Scanner& s, const std::shared_ptr<DetectorSetup>& detCoords)
 	      { s.setDetectorSetup(detCoords); });
+	c.def("updateDetectorTable", &Scanner::updateDetectorTable);
 }
 #endif
 
@@ -132,6 +133,19 @@ std::shared_ptr<DetectorSetup> Scanner::getDetectorSetup() const
 	return mp_detectors;
 }
 
+const DetectorTable& Scanner::getDetectorTable() const
+{
+	ASSERT_MSG(mp_detectorTable != nullptr,
+	           "The scanner has no detector setup");
+	return *mp_detectorTable;
+}
+
+void Scanner::updateDetectorTable()
+{
+	ASSERT_MSG(mp_detectors != nullptr, "The scanner has no detector setup");
+	mp_detectorTable = std::make_shared<const DetectorTable>(*mp_detectors);
+}
+
 bool Scanner::isValid() const
 {
 	return mp_detectors != nullptr;
@@ -157,6 +171,7 @@ void Scanner::setDetectorSetup(
     const std::shared_ptr<DetectorSetup>& pp_detectors)
 {
 	mp_detectors = pp_detectors;
+	updateDetectorTable();
 }
 
 void Scanner::readFromString(const std::string& fileContents)
@@ -240,6 +255,7 @@ void Scanner::readFromString(const std::string& fileContents)
 		mp_detectors = std::make_shared<DetRegular>(this);
 		reinterpret_cast<DetRegular*>(mp_detectors.get())->generateLUT();
 	}
+	updateDetectorTable();
 
 	ASSERT_MSG(
 	    maxRingDiff < numRings,
@@ -7,22 +7,74 @@
 
 #include "datastruct/scanner/Scanner.hpp"
 #include "geometry/Constants.hpp"
+#include "utils/Assert.hpp"
 
 #include <cmath>
+#include <cstdint>
 #include <utility>
 #include <vector>
 
+namespace
+{
+	constexpr int SobolNumBits = 32;
+
+	// Primitive polynomials (degree s, coefficients a) and initial direction
+	// numbers m of the dimensions after the first one (Joe and Kuo, 2008)
+	struct SobolDimParams
+	{
+		int s;
+		uint32_t a;
+		uint32_t m[4];
+	};
+	constexpr SobolDimParams SobolParams[MultiRayGenerator::MaxSobolDims - 1] =
+	    {{1, 0, {1, 0, 0, 0}},
+	     {2, 1, {1, 3, 0, 0}},
+	     {3, 1, {1, 3, 1, 0}},
+	     {3, 2, {1, 1, 1, 0}},
+	     {4, 1, {1, 1, 3, 3}}};
+
+	void getSobolDirections(int dim, uint32_t* v)
+	{
+		if (dim == 0)
+		{
+			for (int k = 0; k < SobolNumBits; k++)
+			{
+				v[k] = 1u << (SobolNumBits - 1 - k);
+			}
+			return;
+		}
+		const SobolDimParams& params = SobolParams[dim - 1];
+		const int s = params.s;
+		for (int k = 0; k < s; k++)
+		{
+			v[k] = params.m[k] << (SobolNumBits - 1 - k);
+		}
+		for (int k = s; k < SobolNumBits; k++)
+		{
+			v[k] = v[k - s] ^ (v[k - s] >> s);
+			for (int l = 1; l < s; l++)
+			{
+				v[k] ^= ((params.a >> (s - 1 - l)) & 1u) * v[k - l];
+			}
+		}
+	}
+}  // namespace
+
 MultiRayGenerator::MultiRayGenerator(float thickness_z_i,
-                                     float thickness_trans_i, bool isParallel_i)
+                                     float thickness_trans_i, bool isParallel_i,
+                                     float depth_i)
     : thickness_z(thickness_z_i),
       thickness_trans(thickness_trans_i),
+      depth(depth_i),
       isParallel(isParallel_i),
       vect_parrallel_to_z{0, 0, 1},
       vect_parrallel_to_trans1{},
       vect_parrallel_to_trans2{},
+      vect_depth1{},
+      vect_depth2{},
       currentLor(nullptr)
 {
-	isSingleRay = (thickness_trans <= 0 && thickness_z <= 0);
+	isSingleRay = (thickness_trans <= 0 && thickness_z <= 0 && depth <= 0);
 }
 
 void MultiRayGenerator::setupGenerator(const Line3D& lor, const Vector3D& n1,
@@ -35,6 +87,10 @@ void MultiRayGenerator::setupGenerator(const Line3D& lor, const Vector3D& n1,
 		    n1.crossProduct(vect_parrallel_to_z).normalize();
 		vect_parrallel_to_trans2 =
 		    n2.crossProduct(vect_parrallel_to_z).normalize();
+		vect_depth1 = n1;
+		vect_depth1.normalize();
+		vect_depth2 = n2;
+		vect_depth2.normalize();
 	}
 }
 
@@ -60,12 +116,94 @@ Line3D MultiRayGenerator::getRandomLine(unsigned int& seed) const
 	        (static_cast<float>(rand_r(&seed)) / static_cast<float>(RAND_MAX) -
 	         0.5f);
 
-	const Vector3D pt1 =
-	    currentLor->point1 + vect_parrallel_to_z * (rand_i_1 * thickness_z) +
-	    vect_parrallel_to_trans1 * (rand_j_1 * thickness_trans);
-	const Vector3D pt2 =
-	    currentLor->point2 + vect_parrallel_to_z * (rand_i_2 * thickness_z) +
-	    vect_parrallel_to_trans2 * (rand_j_2 * thickness_trans);
+	// The depth is drawn last to keep the sequence of the face-only case
+	float rand_k_1 = 0.0f;
+	float rand_k_2 = 0.0f;
+	if (depth > 0)
+	{
+		rand_k_1 = static_cast<float>(rand_r(&seed)) /
+		               static_cast<float>(RAND_MAX) -
+		           0.5f;
+		rand_k_2 = (isParallel) ? rand_k_1 :
+		                          (static_cast<float>(rand_r(&seed)) /
+		                               static_cast<float>(RAND_MAX) -
+		                           0.5f);
+	}
 
+	const float offsets1[3] = {rand_i_1, rand_j_1, rand_k_1};
+	const float offsets2[3] = {rand_i_2, rand_j_2, rand_k_2};
+	return getLineFromOffsets(offsets1, offsets2);
+}
+
+void MultiRayGenerator::getSobolPoint(unsigned int index, int numDims,
+                                      float* point)
+{
+	ASSERT_MSG(numDims <= MaxSobolDims, "Too many Sobol dimensions");
+	uint32_t v[SobolNumBits];
+	for (int dim = 0; dim < numDims; dim++)
+	{
+		getSobolDirections(dim, v);
+		uint32_t x = 0;
+		for (int k = 0; k < SobolNumBits && (index >> k) != 0; k++)
+		{
+			if ((index >> k) & 1u)
+			{
+				x ^= v[k];
+			}
+		}
+		point[dim] = static_cast<float>(std::ldexp(static_cast<double>(x),
+		                                           -SobolNumBits));
+	}
+}
+
+void MultiRayGenerator::setupStratifiedOffsets(int numRays)
+{
+	ASSERT_MSG(numRays > 0, "The number of rays must be positive");
+	m_stratifiedOffsets.resize(numRays * MaxSobolDims);
+	// The points are shifted by half a stratum so that they sit in the middle
+	// of the strata (a single ray is the LOR itself)
+	const float shift = 0.5f / static_cast<float>(numRays);
+	for (int rayIdx = 0; rayIdx < numRays; rayIdx++)
+	{
+		float* offsets = m_stratifiedOffsets.data() + rayIdx * MaxSobolDims;
+		getSobolPoint(rayIdx, MaxSobolDims, offsets);
+		for (int dim = 0; dim < MaxSobolDims; dim++)
+		{
+			float u = offsets[dim] + shift;
+			u -= std::floor(u);
+			offsets[dim] = u - 0.5f;
+		}
+	}
+}
+
+int MultiRayGenerator::getNumStratifiedRays() const
+{
+	return static_cast<int>(m_stratifiedOffsets.size() / MaxSobolDims);
+}
+
+Line3D MultiRayGenerator::getStratifiedLine(int rayIdx) const
+{
+	ASSERT(rayIdx < getNumStratifiedRays());
+	if (isSingleRay)
+	{
+		return *currentLor;
+	}
+	const float* offsets = m_stratifiedOffsets.data() + rayIdx * MaxSobolDims;
+	return getLineFromOffsets(offsets, isParallel ? offsets : offsets + 3);
+}
+
+Line3D MultiRayGenerator::getLineFromOffsets(const float* offsets1,
+                                             const float* offsets2) const
+{
+	const Vector3D pt1 = currentLor->point1 +
+	                     vect_parrallel_to_z * (offsets1[0] * thickness_z) +
+	                     vect_parrallel_to_trans1 *
+	                         (offsets1[1] * thickness_trans) +
+	                     vect_depth1 * (offsets1[2] * depth);
+	const Vector3D pt2 = currentLor->point2 +
+	                     vect_parrallel_to_z * (offsets2[0] * thickness_z) +
+	                     vect_parrallel_to_trans2 *
+	                         (offsets2[1] * thickness_trans) +
+	                     vect_depth2 * (offsets2[2] * depth);
 	return Line3D{pt1, pt2};
-}
\ No newline at end of file
+}
@@ -0,0 +1,309 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "kinetic/Graphical.hpp"
+
+#include "utils/Assert.hpp"
+
+#include "omp.h"
+
+#include <algorithm>
+#include <vector>
+
+#if BUILD_PYBIND11
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <sstream>
+
+namespace
+{
+	using GraphicalSolver = void (*)(const double*, double*,
+	                                 const InputFunction<double>&,
+	                                 const double*, int, size_t, int);
+
+	pybind11::array_t<double> fit_graphical(
+	    GraphicalSolver solver, pybind11::array_t<double> frame_times,
+	    pybind11::array_t<double> input, pybind11::array_t<double> tac_all,
+	    pybind11::array_t<double> W, int start_frame, int num_threads)
+	{
+		pybind11::buffer_info buf_frame_times = frame_times.request();
+		pybind11::buffer_info buf_input = input.request();
+		pybind11::buffer_info buf_tac_all = tac_all.request();
+		pybind11::buffer_info buf_W = W.request();
+
+		if (buf_tac_all.ndim != 2)
+		{
+			throw std::runtime_error("TAC matrix should have shape [T, X]");
+		}
+		size_t num_pix = buf_tac_all.shape[1];
+		int num_frames = buf_tac_all.shape[0];
+
+		if (buf_frame_times.size != num_frames || buf_input.size != num_frames)
+		{
+			std::stringstream err;
+			err << "Frame times and input function should have shape [T] "
+			    << "([" << num_frames << "])";
+			throw std::runtime_error(err.str());
+		}
+		if (buf_W.size != 0 && buf_W.size != num_frames)
+		{
+			throw std::runtime_error("W matrix should have shape [T] or be "
+			                         "empty");
+		}
+		if (start_frame < 0 || start_frame >= num_frames)
+		{
+			throw std::runtime_error("Start frame out of range");
+		}
+
+		/* No pointer is passed, so NumPy will allocate the buffer */
+		auto kin_out = pybind11::array_t<double>(
+		    std::vector<ptrdiff_t>{2, static_cast<long>(num_pix)});
+		pybind11::buffer_info buf_kin_out = kin_out.request();
+		double* ptr_kin_out = static_cast<double*>(buf_kin_out.ptr);
+
+		const InputFunction<double> inputFunction(
+		    static_cast<double*>(buf_frame_times.ptr),
+		    static_cast<double*>(buf_input.ptr), num_frames);
+		double* ptr_W = nullptr;
+		if (buf_W.size != 0)
+		{
+			ptr_W = static_cast<double*>(buf_W.ptr);
+		}
+
+		solver(static_cast<double*>(buf_tac_all.ptr), ptr_kin_out,
+		       inputFunction, ptr_W, start_frame, num_pix, num_threads);
+
+		return kin_out;
+	}
+}  // namespace
+
+pybind11::array_t<double> fit_patlak(pybind11::array_t<double> frame_times,
+                                     pybind11::array_t<double> input,
+                                     pybind11::array_t<double> tac_all,
+                                     pybind11::array_t<double> W,
+                                     int start_frame, int num_threads)
+{
+	return fit_graphical(&solvePatlak<double>, frame_times, input, tac_all, W,
+	                     start_frame, num_threads);
+}
+
+pybind11::array_t<double> fit_logan(pybind11::array_t<double> frame_times,
+                                    pybind11::array_t<double> input,
+                                    pybind11::array_t<double> tac_all,
+                                    pybind11::array_t<double> W,
+                                    int start_frame, int num_threads)
+{
+	return fit_graphical(&solveLogan<double>, frame_times, input, tac_all, W,
+	                     start_frame, num_threads);
+}
+
+void py_setup_graphical(pybind11::module& m)
+{
+	m.def("fit_patlak", &fit_patlak, "Fit Patlak plot");
+	m.def("fit_logan", &fit_logan, "Fit Logan plot");
+}
+
+#endif  // if BUILD_PYBIND11
+
+namespace
+{
+	// Number of pixels fitted together, as for the SRTM
+	constexpr size_t PixelBlockSize = 64;
+
+	template <typename T>
+	T getWeight(const T* W, int ti)
+	{
+		return W != nullptr ? W[ti] : static_cast<T>(1);
+	}
+}  // namespace
+
+template <typename T>
+void solvePatlak(const T* tac_all, T* kin_out, const InputFunction<T>& input,
+                 const T* W, const int start_frame, const size_t num_pix,
+                 const int num_threads)
+{
+	const int num_frames = input.getNumFrames();
+	ASSERT_MSG(start_frame >= 0 && start_frame < num_frames,
+	           "Start frame out of range");
+	const T* cp = input.getValues();
+	const T* cp_int = input.getCumulativeIntegrals();
+
+	// The abscissa of the plot is the same for all the pixels, so both the
+	// slope and the intercept are weighted sums of the TACs, with
+	// coefficients computed once
+	double sum_w = 0.0;
+	double sum_wx = 0.0;
+	for (int ti = start_frame; ti < num_frames; ti++)
+	{
+		ASSERT_MSG(cp[ti] > 0, "The input function must be positive in the "
+		                       "frames fitted by the Patlak plot");
+		const double w = getWeight(W, ti);
+		sum_w += w;
+		sum_wx += w * cp_int[ti] / cp[ti];
+	}
+	ASSERT_MSG(sum_w > 0.0, "The weights of the fitted frames are all zero");
+	const double x_mean = sum_wx / sum_w;
+	double sxx = 0.0;
+	for (int ti = start_frame; ti < num_frames; ti++)
+	{
+		const double dx = cp_int[ti] / cp[ti] - x_mean;
+		sxx += getWeight(W, ti) * dx * dx;
+	}
+	ASSERT_MSG(sxx > 0.0, "The Patlak plot needs at least two distinct "
+	                      "abscissae");
+	std::vector<T> slope_coeffs(num_frames, 0);
+	std::vector<T> intercept_coeffs(num_frames, 0);
+	for (int ti = start_frame; ti < num_frames; ti++)
+	{
+		const double w = getWeight(W, ti);
+		slope_coeffs[ti] =
+		    static_cast<T>(w * (cp_int[ti] / cp[ti] - x_mean) / (sxx * cp[ti]));
+		intercept_coeffs[ti] = static_cast<T>(w / (sum_w * cp[ti]));
+	}
+
+	const T x_mean_t = static_cast<T>(x_mean);
+	const size_t num_blocks = (num_pix + PixelBlockSize - 1) / PixelBlockSize;
+
+#pragma omp parallel for num_threads(num_threads) schedule(static)
+	for (size_t bi = 0; bi < num_blocks; bi++)
+	{
+		const size_t p0 = bi * PixelBlockSize;
+		const size_t np = std::min(PixelBlockSize, num_pix - p0);
+		T* ki_out = kin_out + 0 * num_pix + p0;
+		T* v_out = kin_out + 1 * num_pix + p0;
+
+		T y_mean[PixelBlockSize];
+		for (size_t p = 0; p < np; p++)
+		{
+			ki_out[p] = 0;
+			y_mean[p] = 0;
+		}
+		for (int ti = start_frame; ti < num_frames; ti++)
+		{
+			const T a = slope_coeffs[ti];
+			const T b = intercept_coeffs[ti];
+			const T* tac = tac_all + ti * num_pix + p0;
+#pragma omp simd
+			for (size_t p = 0; p < np; p++)
+			{
+				ki_out[p] += a * tac[p];
+				y_mean[p] += b * tac[p];
+			}
+		}
+#pragma omp simd
+		for (size_t p = 0; p < np; p++)
+		{
+			v_out[p] = y_mean[p] - x_mean_t * ki_out[p];
+		}
+	}
+}
+
+template void solvePatlak(const float* tac_all, float* kin_out,
+                          const InputFunction<float>& input, const float* W,
+                          const int start_frame, const size_t num_pix,
+                          const int num_threads);
+template void solvePatlak(const double* tac_all, double* kin_out,
+                          const InputFunction<double>& input, const double* W,
+                          const int start_frame, const size_t num_pix,
+                          const int num_threads);
+
+template <typename T>
+void solveLogan(const T* tac_all, T* kin_out, const InputFunction<T>& input,
+                const T* W, const int start_frame, const size_t num_pix,
+                const int num_threads)
+{
+	const int num_frames = input.getNumFrames();
+	ASSERT_MSG(start_frame >= 0 && start_frame < num_frames,
+	           "Start frame out of range");
+	const T* times = input.getTimes();
+	const T* cp_int = input.getCumulativeIntegrals();
+	const size_t num_blocks = (num_pix + PixelBlockSize - 1) / PixelBlockSize;
+
+#pragma omp parallel for num_threads(num_threads) schedule(static)
+	for (size_t bi = 0; bi < num_blocks; bi++)
+	{
+		const size_t p0 = bi * PixelBlockSize;
+		const size_t np = std::min(PixelBlockSize, num_pix - p0);
+
+		// Running integral of the TACs and weighted sums of the regression,
+		// in double as for the Patlak plot, since the denominator of the
+		// slope is a difference of large sums. Frames where the TAC is not
+		// positive are left out of the plot
+		double tac_int[PixelBlockSize];
+		T tac_prev[PixelBlockSize];
+		double sw[PixelBlockSize];
+		double sx[PixelBlockSize];
+		double sy[PixelBlockSize];
+		double sxx[PixelBlockSize];
+		double sxy[PixelBlockSize];
+		for (size_t p = 0; p < np; p++)
+		{
+			tac_int[p] = 0;
+			tac_prev[p] = 0;
+			sw[p] = 0;
+			sx[p] = 0;
+			sy[p] = 0;
+			sxx[p] = 0;
+			sxy[p] = 0;
+		}
+		T time_prev = 0;
+		for (int ti = 0; ti < num_frames; ti++)
+		{
+			const double half_dt = 0.5 * (times[ti] - time_prev);
+			const T* tac = tac_all + ti * num_pix + p0;
+#pragma omp simd
+			for (size_t p = 0; p < np; p++)
+			{
+				tac_int[p] += half_dt * (tac[p] + tac_prev[p]);
+				tac_prev[p] = tac[p];
+			}
+			time_prev = times[ti];
+			if (ti < start_frame)
+			{
+				continue;
+			}
+			const double w_t = getWeight(W, ti);
+			const double cp_int_t = cp_int[ti];
+#pragma omp simd
+			for (size_t p = 0; p < np; p++)
+			{
+				const bool valid = tac[p] > 0;
+				const double inv = valid ? 1.0 / tac[p] : 0.0;
+				const double w = valid ? w_t : 0.0;
+				const double x = cp_int_t * inv;
+				const double y = tac_int[p] * inv;
+				sw[p] += w;
+				sx[p] += w * x;
+				sy[p] += w * y;
+				sxx[p] += w * x * x;
+				sxy[p] += w * x * y;
+			}
+		}
+
+		T* slope_out = kin_out + 0 * num_pix + p0;
+		T* intercept_out = kin_out + 1 * num_pix + p0;
+#pragma omp simd
+		for (size_t p = 0; p < np; p++)
+		{
+			const double denom = sw[p] * sxx[p] - sx[p] * sx[p];
+			const bool valid = denom > 0;
+			const double slope =
+			    valid ? (sw[p] * sxy[p] - sx[p] * sy[p]) / denom : 0.0;
+			slope_out[p] = static_cast<T>(slope);
+			intercept_out[p] =
+			    static_cast<T>(valid ? (sy[p] - slope * sx[p]) / sw[p] : 0.0);
+		}
+	}
+}
+
+template void solveLogan(const float* tac_all, float* kin_out,
+                         const InputFunction<float>& input, const float* W,
+                         const int start_frame, const size_t num_pix,
+                         const int num_threads);
+template void solveLogan(const double* tac_all, double* kin_out,
+                         const InputFunction<double>& input, const double* W,
+                         const int start_frame, const size_t num_pix,
+                         const int num_threads);
@@ -0,0 +1,96 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "kinetic/InputFunction.hpp"
+
+#include "utils/Assert.hpp"
+
+#include <cmath>
+
+template <typename T>
+InputFunction<T>::InputFunction(const T* frame_times, const T* values,
+                                int num_frames)
+    : m_times(frame_times, frame_times + num_frames),
+      m_values(values, values + num_frames),
+      m_cumulativeIntegrals(num_frames)
+{
+	ASSERT_MSG(num_frames > 0, "The input function needs at least one frame");
+	double integral = 0.0;
+	double prevTime = 0.0;
+	double prevValue = 0.0;
+	for (int ti = 0; ti < num_frames; ti++)
+	{
+		ASSERT_MSG(m_times[ti] >= prevTime,
+		           "The frame times must be positive and increasing");
+		// Trapezoidal rule, exact for a piecewise-linear function
+		integral +=
+		    0.5 * (m_times[ti] - prevTime) * (m_values[ti] + prevValue);
+		m_cumulativeIntegrals[ti] = static_cast<T>(integral);
+		prevTime = m_times[ti];
+		prevValue = m_values[ti];
+	}
+}
+
+template <typename T>
+int InputFunction<T>::getNumFrames() const
+{
+	return static_cast<int>(m_times.size());
+}
+
+template <typename T>
+const T* InputFunction<T>::getTimes() const
+{
+	return m_times.data();
+}
+
+template <typename T>
+const T* InputFunction<T>::getValues() const
+{
+	return m_values.data();
+}
+
+template <typename T>
+const T* InputFunction<T>::getCumulativeIntegrals() const
+{
+	return m_cumulativeIntegrals.data();
+}
+
+template <typename T>
+void InputFunction<T>::convolveExponential(double theta, T* out) const
+{
+	// Recursively from one sample to the next: the convolution decays by
+	// exp(-theta * dt) and gains the integral of the linear segment
+	double conv = 0.0;
+	double prevTime = 0.0;
+	double prevValue = 0.0;
+	for (int ti = 0; ti < getNumFrames(); ti++)
+	{
+		const double dt = m_times[ti] - prevTime;
+		const double x = theta * dt;
+		// Integrals over the segment of exp(-theta * (dt - u)) and of
+		// u * exp(-theta * (dt - u)), with series for small exponents
+		double int0;
+		double int1;
+		if (std::abs(x) < 1e-3)
+		{
+			int0 = dt * (1.0 - x / 2.0 + x * x / 6.0);
+			int1 = dt * dt * (0.5 - x / 6.0 + x * x / 24.0);
+		}
+		else
+		{
+			const double oneMinusDecay = -std::expm1(-x);
+			int0 = oneMinusDecay / theta;
+			int1 = (dt - int0) / theta;
+		}
+		const double slope = dt > 0.0 ? (m_values[ti] - prevValue) / dt : 0.0;
+		conv = std::exp(-x) * conv + prevValue * int0 + slope * int1;
+		out[ti] = static_cast<T>(conv);
+		prevTime = m_times[ti];
+		prevValue = m_values[ti];
+	}
+}
+
+template class InputFunction<float>;
+template class InputFunction<double>;
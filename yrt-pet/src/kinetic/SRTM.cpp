@@ -7,6 +7,7 @@
 
 #include "omp.h"
 
+#include <algorithm>
 #include <limits>
 #include <memory>
 
@@ -200,6 +201,15 @@ void py_setup_srtm(pybind11::module& m)
 
 #endif  // if BUILD_PYBIND11
 
+namespace
+{
+	// Number of pixels fitted together. The time-activity curves of a block
+	// are contiguous in every frame, so each basis is applied to the whole
+	// block with loops over the pixels that vectorize, while the block stays
+	// in cache from one basis to the next
+	constexpr size_t PixelBlockSize = 64;
+}  // namespace
+
 template <typename T>
 void solveSRTMBasis(const T* tac_all, T* kin_out, const T* kin_p,
                     const T* A_all, const T* B_all, const T* Rinv_Qt_all,
@@ -208,22 +218,33 @@ void solveSRTMBasis(const T* tac_all, T* kin_out, const T* kin_p,
                     const size_t num_pix, const int num_frames,
                     const int num_threads)
 {
-	auto tac_buff = std::make_unique<T[]>(num_frames * num_threads);
+	const bool withPrior = alpha > 0.f && kin_p != nullptr;
+	const size_t num_blocks = (num_pix + PixelBlockSize - 1) / PixelBlockSize;
 
-#pragma omp parallel for num_threads(num_threads)
-	for (size_t pi = 0; pi < num_pix; pi++)
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+	for (size_t bi = 0; bi < num_blocks; bi++)
 	{
-		int tid = omp_get_thread_num();
-		// Fill buffer
-		T* tac_buff_t = tac_buff.get() + tid * num_frames;
-		for (int ti = 0; ti < num_frames; ti++)
+		const size_t p0 = bi * PixelBlockSize;
+		const size_t np = std::min(PixelBlockSize, num_pix - p0);
+
+		T y0[PixelBlockSize];
+		T y1[PixelBlockSize];
+		T cost[PixelBlockSize];
+		T cost_min[PixelBlockSize];
+		T opt_bp[PixelBlockSize];
+		T opt_k2[PixelBlockSize];
+		T opt_r1[PixelBlockSize];
+		for (size_t p = 0; p < np; p++)
 		{
-			tac_buff_t[ti] = tac_all[ti * num_pix + pi];
+			cost_min[p] = std::numeric_limits<T>::max();
+			opt_bp[p] = -1.f;
+			opt_k2[p] = -1.f;
+			opt_r1[p] = -1.f;
 		}
-		T cost_min = std::numeric_limits<T>::max();
-		T opt_bp = -1.f;
-		T opt_k2 = -1.f;
-		T opt_r1 = -1.f;
+		const T* kin_p0 = withPrior ? kin_p + 0 * num_pix + p0 : nullptr;
+		const T* kin_p1 = withPrior ? kin_p + 1 * num_pix + p0 : nullptr;
+		const T* kin_p2 = withPrior ? kin_p + 2 * num_pix + p0 : nullptr;
+
 		for (int ki = 0; ki < num_kappa; ki++)
 		{
 			// Get precomputed matrices for current basis
@@ -233,64 +254,101 @@ void solveSRTMBasis(const T* tac_all, T* kin_out, const T* kin_p,
 			const T kappa = kappa_list[ki];
 
 			// Right-hand side
-			T y0 = 0.f;
-			T y1 = 0.f;
+			for (size_t p = 0; p < np; p++)
+			{
+				y0[p] = 0.f;
+				y1[p] = 0.f;
+			}
 			for (int ti = 0; ti < num_frames; ti++)
 			{
-				y0 += A[ti * 2] * W[ti] * tac_buff_t[ti];
-				y1 += A[ti * 2 + 1] * W[ti] * tac_buff_t[ti];
+				const T aw0 = A[ti * 2] * W[ti];
+				const T aw1 = A[ti * 2 + 1] * W[ti];
+				const T* tac = tac_all + ti * num_pix + p0;
+#pragma omp simd
+				for (size_t p = 0; p < np; p++)
+				{
+					y0[p] += aw0 * tac[p];
+					y1[p] += aw1 * tac[p];
+				}
 			}
-			if (alpha > 0.f && kin_p != nullptr)
+			if (withPrior)
 			{
-				y0 +=
-				    alpha * (B[0] * Lambda[0] * (kin_p[0 * num_pix + pi] + 1) +
-				             B[2] * Lambda[1] * kin_p[1 * num_pix + pi] +
-				             B[4] * Lambda[2] * kin_p[2 * num_pix + pi]);
-				y1 +=
-				    alpha * (B[1] * Lambda[0] * (kin_p[0 * num_pix + pi] + 1) +
-				             B[3] * Lambda[1] * kin_p[1 * num_pix + pi] +
-				             B[5] * Lambda[2] * kin_p[2 * num_pix + pi]);
+#pragma omp simd
+				for (size_t p = 0; p < np; p++)
+				{
+					y0[p] += alpha * (B[0] * Lambda[0] * (kin_p0[p] + 1) +
+					                  B[2] * Lambda[1] * kin_p1[p] +
+					                  B[4] * Lambda[2] * kin_p2[p]);
+					y1[p] += alpha * (B[1] * Lambda[0] * (kin_p0[p] + 1) +
+					                  B[3] * Lambda[1] * kin_p1[p] +
+					                  B[5] * Lambda[2] * kin_p2[p]);
+				}
 			}
 
-			// Calculate inverse
-			T theta_0 = Rinv_Qt[0] * y0 + Rinv_Qt[1] * y1;
-			T theta_1 = Rinv_Qt[2] * y0 + Rinv_Qt[3] * y1;
+			// Calculate inverse (in place of the right-hand side)
+#pragma omp simd
+			for (size_t p = 0; p < np; p++)
+			{
+				const T theta_0 = Rinv_Qt[0] * y0[p] + Rinv_Qt[1] * y1[p];
+				const T theta_1 = Rinv_Qt[2] * y0[p] + Rinv_Qt[3] * y1[p];
+				y0[p] = theta_0;
+				y1[p] = theta_1;
+				cost[p] = 0.f;
+			}
+			const T* theta_0 = y0;
+			const T* theta_1 = y1;
 
 			// Compute cost
-			T cost = 0.f;
 			for (int ti = 0; ti < num_frames; ti++)
 			{
-				T res = tac_buff_t[ti] -
-				        (A[ti * 2] * theta_0 + A[ti * 2 + 1] * theta_1);
-				cost += W[ti] * res * res;
+				const T a0 = A[ti * 2];
+				const T a1 = A[ti * 2 + 1];
+				const T w = W[ti];
+				const T* tac = tac_all + ti * num_pix + p0;
+#pragma omp simd
+				for (size_t p = 0; p < np; p++)
+				{
+					const T res = tac[p] - (a0 * theta_0[p] + a1 * theta_1[p]);
+					cost[p] += w * res * res;
+				}
 			}
-			if (alpha > 0.f && kin_p != nullptr)
+			if (withPrior)
 			{
-				T k_diff_0 = kin_p[0 * num_pix + pi] -
-				             ((theta_0 * kappa + theta_1) / kappa - 1);
-				T k_diff_1 =
-				    kin_p[1 * num_pix + pi] - (theta_0 * kappa + theta_1);
-				T k_diff_2 = kin_p[2 * num_pix + pi] - theta_0;
-				cost += alpha * (Lambda[0] * k_diff_0 * k_diff_0 +
-				                 Lambda[1] * k_diff_1 * k_diff_1 +
-				                 Lambda[2] * k_diff_2 * k_diff_2);
+#pragma omp simd
+				for (size_t p = 0; p < np; p++)
+				{
+					const T k2 = theta_0[p] * kappa + theta_1[p];
+					const T k_diff_0 = kin_p0[p] - (k2 / kappa - 1);
+					const T k_diff_1 = kin_p1[p] - k2;
+					const T k_diff_2 = kin_p2[p] - theta_0[p];
+					cost[p] += alpha * (Lambda[0] * k_diff_0 * k_diff_0 +
+					                    Lambda[1] * k_diff_1 * k_diff_1 +
+					                    Lambda[2] * k_diff_2 * k_diff_2);
+				}
 			}
-			cost *= 0.5f;
 
 			// Track minimum cost
-			if (cost < cost_min)
+#pragma omp simd
+			for (size_t p = 0; p < np; p++)
 			{
-				cost_min = cost;
-				opt_bp = (theta_0 * kappa + theta_1) / kappa - 1;
-				opt_k2 = theta_0 * kappa + theta_1;
-				opt_r1 = theta_0;
+				const T c = cost[p] * 0.5f;
+				if (c < cost_min[p])
+				{
+					cost_min[p] = c;
+					opt_bp[p] = (theta_0[p] * kappa + theta_1[p]) / kappa - 1;
+					opt_k2[p] = theta_0[p] * kappa + theta_1[p];
+					opt_r1[p] = theta_0[p];
+				}
 			}
 		}
 
 		// Store output
-		kin_out[0 * num_pix + pi] = opt_bp;
-		kin_out[1 * num_pix + pi] = opt_k2;
-		kin_out[2 * num_pix + pi] = opt_r1;
+		for (size_t p = 0; p < np; p++)
+		{
+			kin_out[0 * num_pix + p0 + p] = opt_bp[p];
+			kin_out[1 * num_pix + p0 + p] = opt_k2[p];
+			kin_out[2 * num_pix + p0 + p] = opt_r1[p];
+		}
 	}
 }
 
@@ -317,30 +375,46 @@ void solveSRTMBasisJoint(const T* tac_all, T* kin_out, const T* kin_p,
                          const size_t num_pix, const int num_frames,
                          const int num_threads)
 {
-	auto tac_buff = std::make_unique<T[]>(2 * num_frames * num_threads);
-
-#pragma omp parallel for num_threads(num_threads)
-	for (size_t pi = 0; pi < num_pix; pi++)
+	constexpr int num_k = 6;
+	const bool withPrior = alpha > 0.f && kin_p != nullptr;
+	const size_t num_blocks = (num_pix + PixelBlockSize - 1) / PixelBlockSize;
+	const T* W0 = W;
+	const T* W1 = W + num_frames;
+	const T* tac_all_0 = tac_all;
+	const T* tac_all_1 = tac_all + num_pix * num_frames;
+
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+	for (size_t bi = 0; bi < num_blocks; bi++)
 	{
-		int tid = omp_get_thread_num();
-		// Fill buffer
-		T* tac_buff_t0 = tac_buff.get() + tid * 2 * num_frames;
-		T* tac_buff_t1 = tac_buff_t0 + num_frames;
-		for (int ti = 0; ti < num_frames; ti++)
+		const size_t p0 = bi * PixelBlockSize;
+		const size_t np = std::min(PixelBlockSize, num_pix - p0);
+
+		T theta[4][PixelBlockSize];
+		T cost[PixelBlockSize];
+		T cost_min[PixelBlockSize];
+		T opt[num_k][PixelBlockSize];
+		for (size_t p = 0; p < np; p++)
+		{
+			cost_min[p] = std::numeric_limits<T>::max();
+			for (int k = 0; k < num_k; k++)
+			{
+				opt[k][p] = -1.f;
+			}
+		}
+		// Prior, with the binding potentials offset by one
+		T prior[num_k][PixelBlockSize];
+		if (withPrior)
 		{
-			tac_buff_t0[ti] = tac_all[ti * num_pix + pi];
-			tac_buff_t1[ti] = tac_all[num_pix * num_frames + ti * num_pix + pi];
+			for (int k = 0; k < num_k; k++)
+			{
+				const T offset = (k == 0 || k == 3) ? 1 : 0;
+				for (size_t p = 0; p < np; p++)
+				{
+					prior[k][p] = kin_p[k * num_pix + p0 + p] + offset;
+				}
+			}
 		}
-		T cost_min = std::numeric_limits<T>::max();
-		T opt_bp_b = -1.f;
-		T opt_k2_b = -1.f;
-		T opt_r1_b = -1.f;
-		T opt_bp_d = -1.f;
-		T opt_k2_d = -1.f;
-		T opt_r1_d = -1.f;
-		T opt_ro = -1.f;
-		const T* W0 = W;
-		const T* W1 = W + num_frames;
+
 		for (int ki = 0; ki < num_kappa; ki++)
 		{
 			// Get precomputed matrices for current basis
@@ -352,112 +426,145 @@ void solveSRTMBasisJoint(const T* tac_all, T* kin_out, const T* kin_p,
 			const T kappa_1 = kappa_list[ki + num_kappa];
 
 			// Right-hand side
-			T y0 = 0.f;
-			T y1 = 0.f;
-			T y2 = 0.f;
-			T y3 = 0.f;
+			T y[4][PixelBlockSize];
+			for (int j = 0; j < 4; j++)
+			{
+				for (size_t p = 0; p < np; p++)
+				{
+					y[j][p] = 0.f;
+				}
+			}
 			for (int ti = 0; ti < num_frames; ti++)
 			{
-				y0 += A0[ti * 4] * W0[ti] * tac_buff_t0[ti];
-				y1 += A0[ti * 4 + 1] * W0[ti] * tac_buff_t0[ti];
-				y2 += A1[ti * 4 + 2] * W1[ti] * tac_buff_t1[ti];
-				y3 += A1[ti * 4 + 3] * W1[ti] * tac_buff_t1[ti];
+				const T aw0 = A0[ti * 4] * W0[ti];
+				const T aw1 = A0[ti * 4 + 1] * W0[ti];
+				const T aw2 = A1[ti * 4 + 2] * W1[ti];
+				const T aw3 = A1[ti * 4 + 3] * W1[ti];
+				const T* tac0 = tac_all_0 + ti * num_pix + p0;
+				const T* tac1 = tac_all_1 + ti * num_pix + p0;
+#pragma omp simd
+				for (size_t p = 0; p < np; p++)
+				{
+					y[0][p] += aw0 * tac0[p];
+					y[1][p] += aw1 * tac0[p];
+					y[2][p] += aw2 * tac1[p];
+					y[3][p] += aw3 * tac1[p];
+				}
 			}
-			if (alpha > 0.f && kin_p != nullptr)
+			if (withPrior)
 			{
-				y0 +=
-				    alpha * (B[0] * Lambda[0] * (kin_p[0 * num_pix + pi] + 1) +
-				             B[4] * Lambda[1] * kin_p[1 * num_pix + pi] +
-				             B[8] * Lambda[2] * kin_p[2 * num_pix + pi] +
-				             B[12] * Lambda[3] * (kin_p[3 * num_pix + pi] + 1) +
-				             B[16] * Lambda[4] * kin_p[4 * num_pix + pi] +
-				             B[20] * Lambda[5] * kin_p[5 * num_pix + pi]);
-				y1 +=
-				    alpha * (B[1] * Lambda[0] * (kin_p[0 * num_pix + pi] + 1) +
-				             B[5] * Lambda[1] * kin_p[1 * num_pix + pi] +
-				             B[9] * Lambda[2] * kin_p[2 * num_pix + pi] +
-				             B[13] * Lambda[3] * (kin_p[3 * num_pix + pi] + 1) +
-				             B[17] * Lambda[4] * kin_p[4 * num_pix + pi] +
-				             B[21] * Lambda[5] * kin_p[5 * num_pix + pi]);
-				y2 +=
-				    alpha * (B[2] * Lambda[0] * (kin_p[0 * num_pix + pi] + 1) +
-				             B[6] * Lambda[1] * kin_p[1 * num_pix + pi] +
-				             B[10] * Lambda[2] * kin_p[2 * num_pix + pi] +
-				             B[14] * Lambda[3] * (kin_p[3 * num_pix + pi] + 1) +
-				             B[18] * Lambda[4] * kin_p[4 * num_pix + pi] +
-				             B[22] * Lambda[5] * kin_p[5 * num_pix + pi]);
-				y3 +=
-				    alpha * (B[3] * Lambda[0] * (kin_p[0 * num_pix + pi] + 1) +
-				             B[7] * Lambda[1] * kin_p[1 * num_pix + pi] +
-				             B[11] * Lambda[2] * kin_p[2 * num_pix + pi] +
-				             B[15] * Lambda[3] * (kin_p[3 * num_pix + pi] + 1) +
-				             B[19] * Lambda[4] * kin_p[4 * num_pix + pi] +
-				             B[23] * Lambda[5] * kin_p[5 * num_pix + pi]);
+				for (int j = 0; j < 4; j++)
+				{
+					// Column j of B weighted by Lambda
+					T bl[num_k];
+					for (int k = 0; k < num_k; k++)
+					{
+						bl[k] = B[k * 4 + j] * Lambda[k];
+					}
+#pragma omp simd
+					for (size_t p = 0; p < np; p++)
+					{
+						y[j][p] += alpha * (bl[0] * prior[0][p] +
+						                    bl[1] * prior[1][p] +
+						                    bl[2] * prior[2][p] +
+						                    bl[3] * prior[3][p] +
+						                    bl[4] * prior[4][p] +
+						                    bl[5] * prior[5][p]);
+					}
+				}
 			}
 
 			// Calculate inverse
-			T theta_0 = Rinv_Qt[0] * y0 + Rinv_Qt[1] * y1 + Rinv_Qt[2] * y2 +
-			            Rinv_Qt[3] * y3;
-			T theta_1 = Rinv_Qt[4] * y0 + Rinv_Qt[5] * y1 + Rinv_Qt[6] * y2 +
-			            Rinv_Qt[7] * y3;
-			T theta_2 = Rinv_Qt[8] * y0 + Rinv_Qt[9] * y1 + Rinv_Qt[10] * y2 +
-			            Rinv_Qt[11] * y3;
-			T theta_3 = Rinv_Qt[12] * y0 + Rinv_Qt[13] * y1 + Rinv_Qt[14] * y2 +
-			            Rinv_Qt[15] * y3;
+			for (int j = 0; j < 4; j++)
+			{
+				const T* r = Rinv_Qt + j * 4;
+#pragma omp simd
+				for (size_t p = 0; p < np; p++)
+				{
+					theta[j][p] = r[0] * y[0][p] + r[1] * y[1][p] +
+					              r[2] * y[2][p] + r[3] * y[3][p];
+				}
+			}
 
 			// Compute cost
-			T cost = 0.f;
+			for (size_t p = 0; p < np; p++)
+			{
+				cost[p] = 0.f;
+			}
 			for (int ti = 0; ti < num_frames; ti++)
 			{
-				T res0 = tac_buff_t0[ti] -
-				         (A0[ti * 4] * theta_0 + A0[ti * 4 + 1] * theta_1);
-				T res1 = tac_buff_t1[ti] -
-				         (A1[ti * 4 + 2] * theta_2 + A1[ti * 4 + 3] * theta_3);
-				cost += W0[ti] * res0 * res0 + W1[ti] * res1 * res1;
+				const T a0 = A0[ti * 4];
+				const T a1 = A0[ti * 4 + 1];
+				const T a2 = A1[ti * 4 + 2];
+				const T a3 = A1[ti * 4 + 3];
+				const T w0 = W0[ti];
+				const T w1 = W1[ti];
+				const T* tac0 = tac_all_0 + ti * num_pix + p0;
+				const T* tac1 = tac_all_1 + ti * num_pix + p0;
+#pragma omp simd
+				for (size_t p = 0; p < np; p++)
+				{
+					const T res0 =
+					    tac0[p] - (a0 * theta[0][p] + a1 * theta[1][p]);
+					const T res1 =
+					    tac1[p] - (a2 * theta[2][p] + a3 * theta[3][p]);
+					cost[p] += w0 * res0 * res0 + w1 * res1 * res1;
+				}
 			}
-			if (alpha > 0.f && kin_p != nullptr)
+			if (withPrior)
 			{
-				T k_diff_0 = kin_p[0 * num_pix + pi] - (theta_0 / kappa_0 - 1);
-				T k_diff_1 = kin_p[1 * num_pix + pi] - theta_0;
-				T k_diff_2 = kin_p[2 * num_pix + pi] - theta_1;
-				T k_diff_3 = kin_p[3 * num_pix + pi] - (theta_2 / kappa_1 - 1);
-				T k_diff_4 = kin_p[4 * num_pix + pi] - theta_2;
-				T k_diff_5 = kin_p[5 * num_pix + pi] - theta_3;
-				cost += alpha * (Lambda[0] * k_diff_0 * k_diff_0 +
-				                 Lambda[1] * k_diff_1 * k_diff_1 +
-				                 Lambda[2] * k_diff_2 * k_diff_2 +
-				                 Lambda[3] * k_diff_3 * k_diff_3 +
-				                 Lambda[4] * k_diff_4 * k_diff_4 +
-				                 Lambda[5] * k_diff_5 * k_diff_5);
+#pragma omp simd
+				for (size_t p = 0; p < np; p++)
+				{
+					// The prior of the binding potentials is offset by one
+					const T k_diff_0 = prior[0][p] - theta[0][p] / kappa_0;
+					const T k_diff_1 = prior[1][p] - theta[0][p];
+					const T k_diff_2 = prior[2][p] - theta[1][p];
+					const T k_diff_3 = prior[3][p] - theta[2][p] / kappa_1;
+					const T k_diff_4 = prior[4][p] - theta[2][p];
+					const T k_diff_5 = prior[5][p] - theta[3][p];
+					cost[p] += alpha * (Lambda[0] * k_diff_0 * k_diff_0 +
+					                    Lambda[1] * k_diff_1 * k_diff_1 +
+					                    Lambda[2] * k_diff_2 * k_diff_2 +
+					                    Lambda[3] * k_diff_3 * k_diff_3 +
+					                    Lambda[4] * k_diff_4 * k_diff_4 +
+					                    Lambda[5] * k_diff_5 * k_diff_5);
+				}
 			}
-			cost *= 0.5f;
 
 			// Track minimum cost
-			if (cost < cost_min)
+			for (size_t p = 0; p < np; p++)
 			{
-				cost_min = cost;
-				opt_bp_b = theta_0 / kappa_0 - 1;
-				opt_bp_d = theta_2 / kappa_1 - 1;
-				opt_k2_b = theta_0;
-				opt_k2_d = theta_2;
-				opt_r1_b = theta_1;
-				opt_r1_d = theta_3;
-				T opt_bp_b_div = opt_bp_b;
-				if (std::abs(opt_bp_b) < 1e-8)
+				const T c = cost[p] * 0.5f;
+				if (c < cost_min[p])
 				{
-					opt_bp_b_div = ((opt_bp_b >= 0) - (opt_bp_b < 0)) * 1e-8;
+					cost_min[p] = c;
+					const T opt_bp_b = theta[0][p] / kappa_0 - 1;
+					const T opt_bp_d = theta[2][p] / kappa_1 - 1;
+					T opt_bp_b_div = opt_bp_b;
+					if (std::abs(opt_bp_b) < 1e-8)
+					{
+						opt_bp_b_div =
+						    ((opt_bp_b >= 0) - (opt_bp_b < 0)) * 1e-8;
+					}
+					opt[0][p] = opt_bp_b;
+					opt[1][p] = theta[0][p];
+					opt[2][p] = theta[1][p];
+					opt[3][p] = 1 - opt_bp_d / opt_bp_b_div;
+					opt[4][p] = theta[2][p];
+					opt[5][p] = theta[3][p];
 				}
-				opt_ro = 1 - opt_bp_d / opt_bp_b_div;
 			}
 		}
 
 		// Store output
-		kin_out[0 * num_pix + pi] = opt_bp_b;
-		kin_out[1 * num_pix + pi] = opt_k2_b;
-		kin_out[2 * num_pix + pi] = opt_r1_b;
-		kin_out[3 * num_pix + pi] = opt_ro;
-		kin_out[4 * num_pix + pi] = opt_k2_d;
-		kin_out[5 * num_pix + pi] = opt_r1_d;
+		for (int k = 0; k < num_k; k++)
+		{
+			for (size_t p = 0; p < np; p++)
+			{
+				kin_out[k * num_pix + p0 + p] = opt[k][p];
+			}
+		}
 	}
 }
 
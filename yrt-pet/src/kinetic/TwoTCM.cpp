@@ -0,0 +1,406 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "kinetic/TwoTCM.hpp"
+
+#include "utils/Assert.hpp"
+
+#include "omp.h"
+
+#include <algorithm>
+#include <vector>
+
+#if BUILD_PYBIND11
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <sstream>
+
+pybind11::array_t<double> fit_2tcm_basis(
+    pybind11::array_t<double> frame_times, pybind11::array_t<double> input,
+    pybind11::array_t<double> tac_all, pybind11::array_t<double> theta_list,
+    pybind11::array_t<double> W, bool fit_blood_volume, int num_threads)
+{
+	pybind11::buffer_info buf_frame_times = frame_times.request();
+	pybind11::buffer_info buf_input = input.request();
+	pybind11::buffer_info buf_tac_all = tac_all.request();
+	pybind11::buffer_info buf_theta_list = theta_list.request();
+	pybind11::buffer_info buf_W = W.request();
+
+	if (buf_tac_all.ndim != 2)
+	{
+		throw std::runtime_error("TAC matrix should have shape [T, X]");
+	}
+	size_t num_pix = buf_tac_all.shape[1];
+	int num_frames = buf_tac_all.shape[0];
+	int num_theta = buf_theta_list.size;
+
+	if (buf_frame_times.size != num_frames || buf_input.size != num_frames)
+	{
+		std::stringstream err;
+		err << "Frame times and input function should have shape [T] " << "(["
+		    << num_frames << "])";
+		throw std::runtime_error(err.str());
+	}
+	if (buf_W.size != 0 && buf_W.size != num_frames)
+	{
+		throw std::runtime_error("W matrix should have shape [T] or be empty");
+	}
+	if (num_theta < 2)
+	{
+		throw std::runtime_error("At least two decay rates are needed");
+	}
+
+	/* No pointer is passed, so NumPy will allocate the buffer */
+	auto kin_out = pybind11::array_t<double>(
+	    std::vector<ptrdiff_t>{5, static_cast<long>(num_pix)});
+	pybind11::buffer_info buf_kin_out = kin_out.request();
+	double* ptr_kin_out = static_cast<double*>(buf_kin_out.ptr);
+
+	const InputFunction<double> inputFunction(
+	    static_cast<double*>(buf_frame_times.ptr),
+	    static_cast<double*>(buf_input.ptr), num_frames);
+	double* ptr_W = nullptr;
+	if (buf_W.size != 0)
+	{
+		ptr_W = static_cast<double*>(buf_W.ptr);
+	}
+
+	solve2TCMBasis(static_cast<double*>(buf_tac_all.ptr), ptr_kin_out,
+	               inputFunction, static_cast<double*>(buf_theta_list.ptr),
+	               num_theta, ptr_W, fit_blood_volume, num_pix, num_threads);
+
+	return kin_out;
+}
+
+void py_setup_twotcm(pybind11::module& m)
+{
+	m.def("fit_2tcm_basis", &fit_2tcm_basis,
+	      "Fit two-tissue compartment model using bases");
+}
+
+#endif  // if BUILD_PYBIND11
+
+namespace
+{
+	// Number of pixels fitted together, as for the SRTM
+	constexpr size_t PixelBlockSize = 64;
+	// Columns of a basis: the input function convolved with both
+	// exponentials and the blood volume term, left to zero when it is not
+	// fitted
+	constexpr int NumColumns = 3;
+	// Non-empty subsets of the columns (bit c for column c)
+	constexpr int NumSubsets = (1 << NumColumns) - 1;
+
+	// Inverse of the leading n x n block of a symmetric NumColumns x
+	// NumColumns matrix, the rest of the inverse being zero. Returns false
+	// if the block is singular
+	bool invertGram(double* m, int n)
+	{
+		double inv[NumColumns * NumColumns] = {};
+		for (int i = 0; i < n; i++)
+		{
+			inv[i * NumColumns + i] = 1.0;
+		}
+		double scale = 0.0;
+		for (int i = 0; i < n; i++)
+		{
+			scale = std::max(scale, m[i * NumColumns + i]);
+		}
+		for (int col = 0; col < n; col++)
+		{
+			const double pivot = m[col * NumColumns + col];
+			if (!(pivot > 1e-12 * scale))
+			{
+				return false;
+			}
+			for (int j = 0; j < n; j++)
+			{
+				m[col * NumColumns + j] /= pivot;
+				inv[col * NumColumns + j] /= pivot;
+			}
+			for (int row = 0; row < n; row++)
+			{
+				if (row == col)
+				{
+					continue;
+				}
+				const double factor = m[row * NumColumns + col];
+				for (int j = 0; j < n; j++)
+				{
+					m[row * NumColumns + j] -= factor * m[col * NumColumns + j];
+					inv[row * NumColumns + j] -=
+					    factor * inv[col * NumColumns + j];
+				}
+			}
+		}
+		std::copy(inv, inv + NumColumns * NumColumns, m);
+		return true;
+	}
+
+	// Inverse of the block of a symmetric NumColumns x NumColumns matrix on
+	// the columns of the given subset, the rest of the inverse being zero.
+	// The inverse is left to zero if the block is singular
+	void invertGramSubset(const double* m, int subset, double* inv)
+	{
+		int cols[NumColumns];
+		int n = 0;
+		for (int c = 0; c < NumColumns; c++)
+		{
+			if ((subset >> c) & 1)
+			{
+				cols[n++] = c;
+			}
+		}
+		double block[NumColumns * NumColumns] = {};
+		for (int i = 0; i < n; i++)
+		{
+			for (int j = 0; j < n; j++)
+			{
+				block[i * NumColumns + j] = m[cols[i] * NumColumns + cols[j]];
+			}
+		}
+		std::fill(inv, inv + NumColumns * NumColumns, 0.0);
+		if (!invertGram(block, n))
+		{
+			return;
+		}
+		for (int i = 0; i < n; i++)
+		{
+			for (int j = 0; j < n; j++)
+			{
+				inv[cols[i] * NumColumns + cols[j]] = block[i * NumColumns + j];
+			}
+		}
+	}
+}  // namespace
+
+template <typename T>
+void solve2TCMBasis(const T* tac_all, T* kin_out,
+                    const InputFunction<T>& input, const T* theta_list,
+                    const int num_theta, const T* W,
+                    const bool fit_blood_volume, const size_t num_pix,
+                    const int num_threads)
+{
+	const int num_frames = input.getNumFrames();
+	const int num_cols = fit_blood_volume ? 3 : 2;
+	const int num_subsets = (1 << num_cols) - 1;
+
+	// The convolutions of the input function only depend on the decay rate,
+	// so they are computed once for every rate and shared by all the bases
+	std::vector<T> conv_all(num_theta * num_frames);
+	for (int i = 0; i < num_theta; i++)
+	{
+		input.convolveExponential(theta_list[i], &conv_all[i * num_frames]);
+	}
+
+	// Design matrix and inverses of its Gram matrix restricted to every
+	// subset of the columns, for every basis
+	std::vector<T> A_all;
+	std::vector<T> Ginv_all;
+	std::vector<int> theta_index;
+	for (int i = 0; i < num_theta; i++)
+	{
+		for (int j = i + 1; j < num_theta; j++)
+		{
+			if (theta_list[i] == theta_list[j])
+			{
+				continue;
+			}
+			std::vector<T> A(num_frames * NumColumns, 0);
+			for (int ti = 0; ti < num_frames; ti++)
+			{
+				A[ti * NumColumns + 0] = conv_all[i * num_frames + ti];
+				A[ti * NumColumns + 1] = conv_all[j * num_frames + ti];
+				if (fit_blood_volume)
+				{
+					A[ti * NumColumns + 2] = input.getValues()[ti];
+				}
+			}
+			double G[NumColumns * NumColumns] = {};
+			for (int ti = 0; ti < num_frames; ti++)
+			{
+				const double w = W != nullptr ? W[ti] : 1.0;
+				for (int c0 = 0; c0 < num_cols; c0++)
+				{
+					for (int c1 = 0; c1 < num_cols; c1++)
+					{
+						G[c0 * NumColumns + c1] += A[ti * NumColumns + c0] *
+						                           w * A[ti * NumColumns + c1];
+					}
+				}
+			}
+			double Ginv[NumSubsets][NumColumns * NumColumns];
+			for (int s = 0; s < NumSubsets; s++)
+			{
+				invertGramSubset(G, s + 1, Ginv[s]);
+			}
+			// Bases whose columns are not independent are left out
+			if (!invertGram(G, num_cols))
+			{
+				continue;
+			}
+			A_all.insert(A_all.end(), A.begin(), A.end());
+			for (int s = 0; s < NumSubsets; s++)
+			{
+				Ginv_all.insert(Ginv_all.end(), Ginv[s],
+				                Ginv[s] + NumColumns * NumColumns);
+			}
+			theta_index.push_back(i);
+			theta_index.push_back(j);
+		}
+	}
+	const int num_bases = static_cast<int>(theta_index.size()) / 2;
+	ASSERT_MSG(num_bases > 0, "No usable pair of decay rates for the 2TCM");
+
+	const size_t num_blocks = (num_pix + PixelBlockSize - 1) / PixelBlockSize;
+
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+	for (size_t bi = 0; bi < num_blocks; bi++)
+	{
+		const size_t p0 = bi * PixelBlockSize;
+		const size_t np = std::min(PixelBlockSize, num_pix - p0);
+
+		T y[NumColumns][PixelBlockSize];
+		T tac_norm[PixelBlockSize];
+		T cost_min[PixelBlockSize];
+		T opt_phi[NumColumns][PixelBlockSize];
+		int opt_basis[PixelBlockSize];
+		for (size_t p = 0; p < np; p++)
+		{
+			tac_norm[p] = 0;
+			opt_basis[p] = -1;
+			for (int c = 0; c < NumColumns; c++)
+			{
+				opt_phi[c][p] = 0;
+			}
+		}
+		// Weighted squared norm of the TACs, which is the cost of the fit
+		// with all the coefficients at zero
+		for (int ti = 0; ti < num_frames; ti++)
+		{
+			const T w = W != nullptr ? W[ti] : 1;
+			const T* tac = tac_all + ti * num_pix + p0;
+#pragma omp simd
+			for (size_t p = 0; p < np; p++)
+			{
+				tac_norm[p] += w * tac[p] * tac[p];
+			}
+		}
+		for (size_t p = 0; p < np; p++)
+		{
+			cost_min[p] = tac_norm[p];
+		}
+
+		for (int b = 0; b < num_bases; b++)
+		{
+			const T* A = &A_all[b * num_frames * NumColumns];
+
+			// Right-hand side
+			for (int c = 0; c < NumColumns; c++)
+			{
+				for (size_t p = 0; p < np; p++)
+				{
+					y[c][p] = 0;
+				}
+			}
+			for (int ti = 0; ti < num_frames; ti++)
+			{
+				const T w = W != nullptr ? W[ti] : 1;
+				const T aw0 = A[ti * NumColumns + 0] * w;
+				const T aw1 = A[ti * NumColumns + 1] * w;
+				const T aw2 = A[ti * NumColumns + 2] * w;
+				const T* tac = tac_all + ti * num_pix + p0;
+#pragma omp simd
+				for (size_t p = 0; p < np; p++)
+				{
+					y[0][p] += aw0 * tac[p];
+					y[1][p] += aw1 * tac[p];
+					y[2][p] += aw2 * tac[p];
+				}
+			}
+
+			// Non-negative least squares: the solution is the least squares
+			// solution on the subset of the columns where it is positive, so
+			// the least squares solution on every subset is evaluated and
+			// the best one with non-negative coefficients is kept. By the
+			// normal equations, the cost of the least squares solution on a
+			// subset is the norm of the TAC minus phi.y, which avoids a pass
+			// over the frames per subset
+			for (int s = 0; s < num_subsets; s++)
+			{
+				const T* Ginv =
+				    &Ginv_all[(b * NumSubsets + s) * NumColumns * NumColumns];
+#pragma omp simd
+				for (size_t p = 0; p < np; p++)
+				{
+					T phi[NumColumns];
+					for (int c = 0; c < NumColumns; c++)
+					{
+						phi[c] = Ginv[c * NumColumns + 0] * y[0][p] +
+						         Ginv[c * NumColumns + 1] * y[1][p] +
+						         Ginv[c * NumColumns + 2] * y[2][p];
+					}
+					const T cost = tac_norm[p] - (phi[0] * y[0][p] +
+					                              phi[1] * y[1][p] +
+					                              phi[2] * y[2][p]);
+					const bool valid = phi[0] >= 0 && phi[1] >= 0 &&
+					                   phi[2] >= 0 && phi[2] < 1;
+					if (valid && cost < cost_min[p])
+					{
+						cost_min[p] = cost;
+						opt_basis[p] = b;
+						opt_phi[0][p] = phi[0];
+						opt_phi[1][p] = phi[1];
+						opt_phi[2][p] = phi[2];
+					}
+				}
+			}
+		}
+
+		// Micro-parameters from the decay rates and the coefficients of the
+		// optimal basis
+		for (size_t p = 0; p < np; p++)
+		{
+			T K1 = 0;
+			T k2 = 0;
+			T k3 = 0;
+			T k4 = 0;
+			const T vB = opt_phi[2][p];
+			if (opt_basis[p] >= 0)
+			{
+				const T theta_0 = theta_list[theta_index[2 * opt_basis[p]]];
+				const T theta_1 = theta_list[theta_index[2 * opt_basis[p] + 1]];
+				const T phi_0 = opt_phi[0][p] / (1 - vB);
+				const T phi_1 = opt_phi[1][p] / (1 - vB);
+				K1 = phi_0 + phi_1;
+				if (K1 > 0)
+				{
+					// k3 + k4
+					const T s = (phi_0 * theta_1 + phi_1 * theta_0) / K1;
+					k2 = theta_0 + theta_1 - s;
+					k4 = k2 > 0 ? theta_0 * theta_1 / k2 : 0;
+					k3 = s - k4;
+				}
+			}
+			kin_out[0 * num_pix + p0 + p] = K1;
+			kin_out[1 * num_pix + p0 + p] = k2;
+			kin_out[2 * num_pix + p0 + p] = k3;
+			kin_out[3 * num_pix + p0 + p] = k4;
+			kin_out[4 * num_pix + p0 + p] = vB;
+		}
+	}
+}
+
+template void solve2TCMBasis(const float* tac_all, float* kin_out,
+                             const InputFunction<float>& input,
+                             const float* theta_list, const int num_theta,
+                             const float* W, const bool fit_blood_volume,
+                             const size_t num_pix, const int num_threads);
+template void solve2TCMBasis(const double* tac_all, double* kin_out,
+                             const InputFunction<double>& input,
+                             const double* theta_list, const int num_theta,
+                             const double* W, const bool fit_blood_volume,
+                             const size_t num_pix, const int num_threads);
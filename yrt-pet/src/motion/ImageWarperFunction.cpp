@@ -5,6 +5,9 @@
 
 #include "motion/ImageWarperFunction.hpp"
 
+#include "datastruct/image/ImageResampler.hpp"
+#include "utils/Tools.hpp"
+
 #if BUILD_PYBIND11
 #include <pybind11/pybind11.h>
 namespace py = pybind11;
@@ -78,28 +81,7 @@ void ImageWarperFunction::setFrameWarpParameters(
  * *************************************************************************************/
 void ImageWarperFunction::warp(Image* image, int frameId) const
 {
-	std::vector<double> voxPos;
-	voxPos.resize(3);
-	Vector3D movVoxPos{0.0, 0.0, 0.0};
-	Array3DAlias<float> data = image->getArray();
-	Array2DAlias<float> slice;
-
-	for (int k = 0; k < m_imNbVoxel[2]; k++)
-	{
-		slice.bind(data.getSlicePtr(k), m_imNbVoxel[1], m_imNbVoxel[0]);
-		voxPos[2] = getVoxelPhysPos(k, 2);
-		for (int j = 0; j < m_imNbVoxel[1]; j++)
-		{
-			voxPos[1] = getVoxelPhysPos(j, 1);
-			float* ptr = slice[j];
-			for (int i = 0; i < m_imNbVoxel[0]; i++)
-			{
-				voxPos[0] = getVoxelPhysPos(i, 0);
-				applyTransformation(voxPos, movVoxPos, frameId);
-				ptr[i] = mp_refImage->interpolateImage(movVoxPos);
-			}
-		}
-	}
+	pullWarp(mp_refImage, image, frameId, false);
 }
 
 
@@ -116,29 +98,38 @@ void ImageWarperFunction::inverseWarp(Image* image, int frameId) const
 	auto tmpCopy = std::make_unique<ImageOwned>(image->getParams());
 	tmpCopy->allocate();
 	tmpCopy->copyFromImage(image);
-	image->setValue(0.0);
-	std::vector<double> voxPos;
-	voxPos.resize(3);
-	auto movVoxPos = Vector3D{0.0, 0.0, 0.0};
-	Array3DAlias<float> data = image->getArray();
-	Array2DAlias<float> slice;
+	pullWarp(tmpCopy.get(), image, frameId, true);
+}
 
-	for (int k = 0; k < m_imNbVoxel[2]; k++)
-	{
-		slice.bind(data.getSlicePtr(k), m_imNbVoxel[1], m_imNbVoxel[0]);
-		voxPos[2] = getVoxelPhysPos(k, 2);
-		for (int j = 0; j < m_imNbVoxel[1]; j++)
-		{
-			voxPos[1] = getVoxelPhysPos(j, 1);
-			float* ptr = slice[j];
-			for (int i = 0; i < m_imNbVoxel[0]; i++)
-			{
-				voxPos[0] = getVoxelPhysPos(i, 0);
-				applyInvTransformation(voxPos, movVoxPos, frameId);
-				ptr[i] = tmpCopy->interpolateImage(movVoxPos);
-			}
-		}
-	}
+
+/* **************************************************************************************
+ * Def.: Fill every voxel of the destination image by interpolating the source
+ *       image at the transformed voxel position, with the gather-based
+ *       ImageResampler.
+ * @source: Image that is interpolated.
+ * @dest: Image where the result is written.
+ * @frameId: The frame of interest.
+ * @inverse: Use the inverse transformation of the frame.
+ * *************************************************************************************/
+void ImageWarperFunction::pullWarp(const Image* source, Image* dest,
+                                   int frameId, bool inverse) const
+{
+	// The stored transformation maps the destination positions onto the
+	// source ones, while the resampler expects the opposite
+	const std::vector<double>& rot = m_rotMatrix[frameId];
+	const std::vector<double>& trans = m_translation[frameId];
+	const transform_t frameTransform{
+	    static_cast<float>(rot[0]),   static_cast<float>(rot[1]),
+	    static_cast<float>(rot[2]),   static_cast<float>(rot[3]),
+	    static_cast<float>(rot[4]),   static_cast<float>(rot[5]),
+	    static_cast<float>(rot[6]),   static_cast<float>(rot[7]),
+	    static_cast<float>(rot[8]),   static_cast<float>(trans[0]),
+	    static_cast<float>(trans[1]), static_cast<float>(trans[2])};
+
+	dest->setValue(0.0f);
+	ImageResampler::resample(*source, *dest,
+	                         inverse ? frameTransform :
+	                                   ImageResampler::inverse(frameTransform));
 }
 
 
@@ -4,8 +4,12 @@
  */
 
 #include "motion/ImageWarperMatrix.hpp"
+#include "utils/Tools.hpp"
 #include "utils/Types.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 #if BUILD_PYBIND11
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
@@ -22,6 +26,55 @@ void py_setup_imagewarpermatrix(py::module& m)
 }
 #endif
 
+namespace
+{
+	/*
+	 * Def.: Weight given to the voxel Id q, along one dimension, by the linear
+	 *       interpolation of the point pt. It is zero if the voxel is not one
+	 *       of the two neighbours of the point. At the border of the image, the
+	 *       missing neighbour is replaced by the border voxel.
+	 * @pt: Coordinate of the point in the dimension of interest.
+	 * @imSize: Size of the image in the dimension of interest.
+	 * @numVox: Number of voxels in the dimension of interest.
+	 * @q: The voxel Id.
+	 */
+	double invInterpolWeight(float pt, float imSize, int numVox, int q)
+	{
+		// if point outside of the image, no contribution:
+		if (std::abs(pt) >= (imSize / 2))
+		{
+			return 0.0;
+		}
+		const double d = (pt + imSize / 2) / imSize * ((double)numVox);
+		const int id = (int)d;
+		const double delta = d - (double)id;
+
+		int id2;
+		double d1;
+		if (delta < 0.5)
+		{
+			d1 = 0.5 - delta;
+			id2 = (id != 0) ? id - 1 : id;
+		}
+		else
+		{
+			d1 = delta - 0.5;
+			id2 = (id != numVox - 1) ? id + 1 : id;
+		}
+
+		double weight = 0.0;
+		if (id == q)
+		{
+			weight += 1.0 - d1;
+		}
+		if (id2 == q)
+		{
+			weight += d1;
+		}
+		return weight;
+	}
+}  // namespace
+
 ImageWarperMatrix::ImageWarperMatrix()
 {
 	m_warpMode = "Matrix";
@@ -79,31 +132,48 @@ void ImageWarperMatrix::setFrameWarpParameters(
 
 /* **************************************************************************************
  * Def.: Deform the image in the reference frame toward the selected frame id.
+ *       Each voxel only reads the reference image, so the slices and rows are
+ *       processed in parallel.
  * @_image : Pointer to where we want to save the warped image.
  * @_frameId : Id of the frame to which we want to deform toward.
  * *************************************************************************************/
 void ImageWarperMatrix::warp(Image* _image, int _frameId) const
 {
-	std::vector<double> voxPos;
-	voxPos.resize(3);
-	Vector3D movVoxPos{0.0, 0.0, 0.0};
-	Array3DAlias<float> data = _image->getArray();
-	Array2DAlias<float> slice;
-
-	for (int k = 0; k < m_imNbVoxel[2]; k++)
+	const std::vector<double> posX = getVoxelPhysPositions(0);
+	const std::vector<double> posY = getVoxelPhysPositions(1);
+	const std::vector<double> posZ = getVoxelPhysPositions(2);
+	const double* posXPtr = posX.data();
+	const double* posYPtr = posY.data();
+	const double* posZPtr = posZ.data();
+	const int nx = m_imNbVoxel[0];
+	const int ny = m_imNbVoxel[1];
+	const int nz = m_imNbVoxel[2];
+	float* destPtr = _image->getRawPointer();
+	const Image* refImage = mp_refImage;
+	const ImageWarperMatrix* warper = this;
+
+#pragma omp parallel default(none) firstprivate(                               \
+        nx, ny, nz, posXPtr, posYPtr, posZPtr, destPtr, refImage, warper,     \
+            _frameId)
 	{
-		slice.bind(data.getSlicePtr(k), m_imNbVoxel[1], m_imNbVoxel[0]);
-		voxPos[2] = getVoxelPhysPos(k, 2);
-		for (int j = 0; j < m_imNbVoxel[1]; j++)
+		// Thread-private scratch
+		std::vector<double> voxPos(3);
+		Vector3D movVoxPos{0.0, 0.0, 0.0};
+
+#pragma omp for collapse(2)
+		for (int k = 0; k < nz; k++)
 		{
-			voxPos[1] = getVoxelPhysPos(j, 1);
-			float* ptr = slice[j];
-			for (int i = 0; i < m_imNbVoxel[0]; i++)
+			for (int j = 0; j < ny; j++)
 			{
-				voxPos[0] = getVoxelPhysPos(i, 0);
-
-				applyTransformation(voxPos, movVoxPos, _frameId);
-				ptr[i] = mp_refImage->interpolateImage(movVoxPos);
+				voxPos[1] = posYPtr[j];
+				voxPos[2] = posZPtr[k];
+				float* rowPtr = destPtr + IDX3(0, j, k, nx, ny);
+				for (int i = 0; i < nx; i++)
+				{
+					voxPos[0] = posXPtr[i];
+					warper->applyTransformation(voxPos, movVoxPos, _frameId);
+					rowPtr[i] = refImage->interpolateImage(movVoxPos);
+				}
 			}
 		}
 	}
@@ -113,6 +183,12 @@ void ImageWarperMatrix::warp(Image* _image, int _frameId) const
 /* **************************************************************************************
  * Def.: Warp the provided image with the transpose of the warping matrix of the
  *       reference frame to the selected frame Id.
+ * Note: The transpose is evaluated by gathering instead of scattering: each
+ *       voxel of the result sums, over the voxels of the input whose warped
+ *       position falls in its interpolation support, the interpolation weight
+ *       it received. The candidate input voxels lie in a box around the
+ *       inverse warped position of the voxel, so every voxel of the result is
+ *       computed independently of the others and without write conflicts.
  * @_image : Pointer to the image to warp and where the result of the warp will
  * be saved.
  * @_frameId : Id of the frame to which we want to deform from.
@@ -123,59 +199,99 @@ void ImageWarperMatrix::inverseWarp(Image* _image, int _frameId) const
 	auto tmpCopy = std::make_unique<ImageOwned>(img_params);
 	tmpCopy->allocate();
 	tmpCopy->copyFromImage(_image);
-	_image->setValue(0.0);
 
-	std::vector<double> voxPos;
-	voxPos.resize(3);
-	Vector3D movVoxPos{0.0, 0.0, 0.0};
-
-	std::vector<std::vector<int>> voxCompIndex;
-	voxCompIndex.resize(8);
-	for (size_t i = 0; i < voxCompIndex.size(); i++)
+	const std::vector<double> posX = getVoxelPhysPositions(0);
+	const std::vector<double> posY = getVoxelPhysPositions(1);
+	const std::vector<double> posZ = getVoxelPhysPositions(2);
+	const double* posPtr[3] = {posX.data(), posY.data(), posZ.data()};
+	const int numVox[3] = {m_imNbVoxel[0], m_imNbVoxel[1], m_imNbVoxel[2]};
+	const float imSize[3] = {m_imSize[0], m_imSize[1], m_imSize[2]};
+	double voxSize[3];
+	for (int d = 0; d < 3; d++)
 	{
-		voxCompIndex[i].resize(3);
+		voxSize[d] = imSize[d] / (double)numVox[d];
 	}
-	std::vector<double> voxCompInterpWeight;
-	voxCompInterpWeight.resize(8);
 
-	double currVoxelVal;
-	bool pointValid;
+	// The forward transform of the frame maps the input voxel positions into
+	// the result. Its inverse, R^T (x - t), brings the result voxels back into
+	// the input image
+	const double* rot = m_rotMatrix[_frameId].data();
+	const double* trans = m_translation[_frameId].data();
+	// Half-extent, in input voxels, of the box containing every input voxel
+	// that can contribute to a given voxel of the result. The interpolation
+	// support of a voxel spans one voxel on each side of its center
+	int halfExtent[3];
+	for (int b = 0; b < 3; b++)
+	{
+		double extent = 0.0;
+		for (int a = 0; a < 3; a++)
+		{
+			extent += std::abs(rot[a * 3 + b]) * voxSize[a];
+		}
+		halfExtent[b] = static_cast<int>(std::ceil(extent / voxSize[b])) + 1;
+	}
 
-	Array3DAlias<float> data_copy = tmpCopy->getArray();
-	Array2DAlias<float> slice_copy;
-	Array3DAlias<float> data = _image->getArray();
-	float* raw_img_ptr = &data.getFlat(0);
-	size_t num_x = img_params.nx;
-	size_t num_xy = img_params.nx * img_params.ny;
+	const float* srcPtr = tmpCopy->getRawPointer();
+	float* destPtr = _image->getRawPointer();
+	const int nx = numVox[0];
+	const int ny = numVox[1];
+	const int nz = numVox[2];
 
-	for (int k = 0; k < m_imNbVoxel[2]; k++)
+#pragma omp parallel for collapse(2) default(none)                            \
+    firstprivate(nx, ny, nz, posPtr, numVox, imSize, voxSize, rot, trans,     \
+                     halfExtent, srcPtr, destPtr)
+	for (int qz = 0; qz < nz; qz++)
 	{
-		slice_copy.bind(data_copy.getSlicePtr(k), m_imNbVoxel[1],
-		                m_imNbVoxel[0]);
-		voxPos[2] = getVoxelPhysPos(k, 2);
-		for (int j = 0; j < m_imNbVoxel[1]; j++)
+		for (int qy = 0; qy < ny; qy++)
 		{
-			voxPos[1] = getVoxelPhysPos(j, 1);
-			float* row_ptr = slice_copy[j];
-			for (int i = 0; i < m_imNbVoxel[0]; i++)
+			for (int qx = 0; qx < nx; qx++)
 			{
-				voxPos[0] = getVoxelPhysPos(i, 0);
-
-				applyTransformation(voxPos, movVoxPos, _frameId);
-				pointValid = invInterpolComponent(movVoxPos, voxCompIndex,
-				                                  voxCompInterpWeight);
-				currVoxelVal = row_ptr[i];
+				const int q[3] = {qx, qy, qz};
+				const double qPos[3] = {posPtr[0][qx] - trans[0],
+				                        posPtr[1][qy] - trans[1],
+				                        posPtr[2][qz] - trans[2]};
+
+				// Range of the candidate input voxels
+				int pMin[3], pMax[3];
+				for (int b = 0; b < 3; b++)
+				{
+					const double center =
+					    rot[b] * qPos[0] + rot[3 + b] * qPos[1] +
+					    rot[6 + b] * qPos[2];
+					const int centerIdx = static_cast<int>(std::floor(
+					    (center + 0.5 * imSize[b]) / voxSize[b]));
+					pMin[b] = std::max(centerIdx - halfExtent[b], 0);
+					pMax[b] = std::min(centerIdx + halfExtent[b], numVox[b] - 1);
+				}
 
-				if (pointValid == true)
+				double value = 0.0;
+				for (int pz = pMin[2]; pz <= pMax[2]; pz++)
 				{
-					for (size_t l = 0; l < voxCompIndex.size(); l++)
+					for (int py = pMin[1]; py <= pMax[1]; py++)
 					{
-						float* cur_img_ptr =
-						    raw_img_ptr + voxCompIndex[l][2] * num_xy +
-						    voxCompIndex[l][1] * num_x + voxCompIndex[l][0];
-						*cur_img_ptr += currVoxelVal * voxCompInterpWeight[l];
+						const float* srcRow = srcPtr + IDX3(0, py, pz, nx, ny);
+						for (int px = pMin[0]; px <= pMax[0]; px++)
+						{
+							const double pPos[3] = {posPtr[0][px],
+							                        posPtr[1][py],
+							                        posPtr[2][pz]};
+							double weight = 1.0;
+							for (int a = 0; a < 3 && weight > 0.0; a++)
+							{
+								// Same arithmetic as the forward warp
+								float pt = static_cast<float>(
+								    rot[a * 3] * pPos[0] +
+								    rot[a * 3 + 1] * pPos[1] +
+								    rot[a * 3 + 2] * pPos[2]);
+								pt = static_cast<float>(pt + trans[a]);
+								weight *= invInterpolWeight(pt, imSize[a],
+								                            numVox[a], q[a]);
+							}
+							value += weight * srcRow[px];
+						}
 					}
 				}
+				destPtr[IDX3(qx, qy, qz, nx, ny)] = static_cast<float>(value);
 			}
 		}
 	}
@@ -292,126 +408,6 @@ void ImageWarperMatrix::applyInvTransformation(const std::vector<double>& pos,
 }
 
 
-/* **************************************************************************************
- * Def.: Find the Id-s and values of the voxel that were used to interpolate the
- *value
- *       of the warped voxel with the given position.
- * @pt: The warped position from which we want to extract the interplation
- *componnent.
- * @voxIndex: The Id of the voxels used in the interpolation for the given
- *position.
- * @voxValue: Interpolation weight of the voxels used in the interpolation for
- *the given
- *		position.
- * Note:
- *		- voxIndex and voxValue are filled with the same order.
- * *************************************************************************************/
-bool ImageWarperMatrix::invInterpolComponent(
-    const Vector3D& pt, std::vector<std::vector<int>>& voxIndex,
-    std::vector<double>& voxValue) const
-{
-	int ix, iy, iz, ix1, ix2, iy1, iy2, iz1, iz2;
-	double dx, dy, dz, dx1, dy1, dz1, delta_x, delta_y, delta_z;
-
-	// if point outside of the image, return 0:
-	if ((std::abs(pt.x) >= (m_imSize[0] / 2)) ||
-	    (std::abs(pt.y) >= (m_imSize[1] / 2)) ||
-	    (std::abs(pt.z) >= (m_imSize[2] / 2)))
-	{
-		return false;
-	}
-	dx = (pt.x + m_imSize[0] / 2) / m_imSize[0] * ((double)m_imNbVoxel[0]);
-	dy = (pt.y + m_imSize[1] / 2) / m_imSize[1] * ((double)m_imNbVoxel[1]);
-	dz = (pt.z + m_imSize[2] / 2) / m_imSize[2] * ((double)m_imNbVoxel[2]);
-
-	ix = (int)dx;
-	iy = (int)dy;
-	iz = (int)dz;
-
-	delta_x = dx - (double)ix;
-	delta_y = dy - (double)iy;
-	delta_z = dz - (double)iz;
-
-	// parameters of the x interpolation:
-	if (delta_x < 0.5)
-	{
-		ix1 = ix;
-		dx1 = 0.5 - delta_x;
-		if (ix != 0)
-			ix2 = ix - 1;
-		else
-			ix2 = ix1;
-	}
-	else
-	{
-		ix1 = ix;
-		dx1 = delta_x - 0.5;
-		if (ix != (m_imNbVoxel[0] - 1))
-			ix2 = ix + 1;
-		else
-			ix2 = ix1;
-	}
-	// parameters of the y interpolation:
-	if (delta_y < 0.5)
-	{
-		iy1 = iy;
-		dy1 = 0.5 - delta_y;
-		if (iy != 0)
-			iy2 = iy - 1;
-		else
-			iy2 = iy1;
-	}
-	else
-	{
-		iy1 = iy;
-		dy1 = delta_y - 0.5;
-		if (iy != (m_imNbVoxel[1] - 1))
-			iy2 = iy + 1;
-		else
-			iy2 = iy1;
-	}
-	// parameters of the z interpolation:
-	if (delta_z < 0.5)
-	{
-		iz1 = iz;
-		dz1 = 0.5 - delta_z;
-		if (iz != 0)
-			iz2 = iz - 1;
-		else
-			iz2 = iz1;
-	}
-	else
-	{
-		iz1 = iz;
-		dz1 = delta_z - 0.5;
-		if (iz != (m_imNbVoxel[2] - 1))
-			iz2 = iz + 1;
-		else
-			iz2 = iz1;
-	}
-
-	// Extract the contributing voxels Id-s and weights.
-	voxIndex[0] = {ix1, iy1, iz1};
-	voxIndex[1] = {ix2, iy1, iz1};
-	voxIndex[2] = {ix1, iy2, iz1};
-	voxIndex[3] = {ix2, iy2, iz1};
-	voxIndex[4] = {ix1, iy1, iz2};
-	voxIndex[5] = {ix2, iy1, iz2};
-	voxIndex[6] = {ix1, iy2, iz2};
-	voxIndex[7] = {ix2, iy2, iz2};
-
-	voxValue[0] = (1 - dz1) * (1 - dy1) * (1 - dx1);
-	voxValue[1] = (1 - dz1) * (1 - dy1) * dx1;
-	voxValue[2] = (1 - dz1) * dy1 * (1 - dx1);
-	voxValue[3] = (1 - dz1) * dy1 * dx1;
-	voxValue[4] = dz1 * (1 - dy1) * (1 - dx1);
-	voxValue[5] = dz1 * (1 - dy1) * dx1;
-	voxValue[6] = dz1 * dy1 * (1 - dx1);
-	voxValue[7] = dz1 * dy1 * dx1;
-
-	return true;
-}
-
 transform_t ImageWarperMatrix::getTransformation(int frameId) const
 {
 	return transform_t{static_cast<float>(m_rotMatrix[frameId][0]),
@@ -630,6 +630,19 @@ std::vector<double> ImageWarperTemplate::convertQuaternionToRotationMatrix(
 }
 
 
+std::vector<double> ImageWarperTemplate::getVoxelPhysPositions(int voxelDim) const
+{
+	const int numVoxels = m_imNbVoxel[voxelDim];
+	const double voxelSize = m_imSize[voxelDim] / (double)numVoxels;
+	std::vector<double> positions(numVoxels);
+	for (int i = 0; i < numVoxels; i++)
+	{
+		positions[i] = ((double)i + 0.5) * voxelSize - 0.5 * m_imSize[voxelDim];
+	}
+	return positions;
+}
+
+
 bool ImageWarperTemplate::isFrameUsed(int frameId)
 {
 	return m_motionFrameUsed[frameId];
@@ -8,6 +8,7 @@
 #include "datastruct/image/Image.hpp"
 #include "datastruct/projection/BinIterator.hpp"
 #include "datastruct/projection/Histogram3D.hpp"
+#include "datastruct/projection/ProjectionList.hpp"
 #include "geometry/Constants.hpp"
 #include "utils/Assert.hpp"
 #include "utils/Globals.hpp"
@@ -16,6 +17,9 @@
 
 #include "omp.h"
 
+#include <algorithm>
+#include <utility>
+
 
 #if BUILD_PYBIND11
 #include <pybind11/pybind11.h>
@@ -58,7 +62,8 @@ OperatorProjector::OperatorProjector(
 {
 	if (p_projParams.tofWidth_ps > 0.f)
 	{
-		setupTOFHelper(p_projParams.tofWidth_ps, p_projParams.tofNumStd);
+		setupTOFHelper(p_projParams.tofWidth_ps, p_projParams.tofNumStd,
+		               p_projParams.tofLUTSamplesPerStd);
 	}
 	if (!p_projParams.psfProjFilename.empty())
 	{
@@ -74,17 +79,139 @@ void OperatorProjector::applyA(const Variable* in, Variable* out)
 	ASSERT_MSG(dat != nullptr, "Output variable has to be Projection data");
 	ASSERT_MSG(img != nullptr, "Input variable has to be an Image");
 
-#pragma omp parallel for default(none) firstprivate(binIter, img, dat)
-	for (bin_t binIdx = 0; binIdx < binIter->size(); binIdx++)
+	if (dat->hasTransaxialLORs())
+	{
+		// Each slice is projected by a single thread
+		const std::vector<std::vector<bin_t>> binsPerSlice =
+		    getBinsPerSlice(dat, img->getParams());
+		const int numSlices = static_cast<int>(binsPerSlice.size());
+		const std::vector<bin_t>* binsPerSlicePtr = binsPerSlice.data();
+#pragma omp parallel default(none) \
+    firstprivate(binsPerSlicePtr, numSlices, img, dat)
+		{
+			ProjectionPropertiesBatch properties;
+			float projValues[BinBlockSize];
+#pragma omp for schedule(dynamic)
+			for (int slice = 0; slice < numSlices; slice++)
+			{
+				const std::vector<bin_t>& bins = binsPerSlicePtr[slice];
+				for (size_t first = 0; first < bins.size();
+				     first += BinBlockSize)
+				{
+					const size_t blockSize =
+					    std::min(BinBlockSize, bins.size() - first);
+					dat->getProjectionProperties(bins.data() + first,
+					                             blockSize, properties);
+					forwardProjection2DBatch(img, properties, slice,
+					                         projValues);
+					for (size_t i = 0; i < blockSize; i++)
+					{
+						dat->setProjectionValue(bins[first + i],
+						                        projValues[i]);
+					}
+				}
+			}
+		}
+		return;
+	}
+
+	if (dat->hasTOFBins())
 	{
-		const bin_t bin = binIter->get(binIdx);
+		ASSERT_MSG(mp_tofHelper != nullptr,
+		           "TOF-binned data requires the TOF to be set up in the "
+		           "projector");
+		// Each thread projects all the TOF bins of a LOR at once
+		const int numTOFBins = static_cast<int>(dat->getNumTOFBins());
+		const float tofBinWidth_ps = dat->getTOFBinWidth();
+		const bin_t numLORs = binIter->size() / numTOFBins;
+#pragma omp parallel default(none) \
+    firstprivate(binIter, img, dat, numTOFBins, tofBinWidth_ps, numLORs)
+		{
+			float projValues[TimeOfFlightHelper::MaxNumTOFBins];
+#pragma omp for
+			for (bin_t lorIdx = 0; lorIdx < numLORs; lorIdx++)
+			{
+				const bin_t first = lorIdx * numTOFBins;
+				forwardProjectionTOFBins(
+				    img, dat->getProjectionProperties(binIter->get(first)),
+				    numTOFBins, tofBinWidth_ps, projValues);
+				for (int t = 0; t < numTOFBins; t++)
+				{
+					dat->setProjectionValue(binIter->get(first + t),
+					                        projValues[t]);
+				}
+			}
+		}
+		return;
+	}
 
-		ProjectionProperties projectionProperties =
-		    dat->getProjectionProperties(bin);
+	if (dat->hasLORBundles())
+	{
+#pragma omp parallel for default(none) firstprivate(binIter, img, dat)
+		for (bin_t binIdx = 0; binIdx < binIter->size(); binIdx++)
+		{
+			const bin_t bin = binIter->get(binIdx);
 
-		const float imProj = forwardProjection(img, projectionProperties);
+			const float imProj = forwardProjectionBundle(img, dat, bin);
 
-		dat->setProjectionValue(bin, imProj);
+			dat->setProjectionValue(bin, imProj);
+		}
+		return;
+	}
+
+	// The LORs are computed by blocks of bins. If bins can share their LOR,
+	// each distinct LOR is projected once and its value given to all its bins
+	const LORGroups* lorGroups =
+	    dat->hasDuplicateLORs() ? &getLORGroups(dat) : nullptr;
+	const bin_t numBins =
+	    (lorGroups != nullptr) ? lorGroups->numGroups() : binIter->size();
+	const bin_t numBlocks = (numBins + BinBlockSize - 1) / BinBlockSize;
+	const ProjectionPsfManager* psfManager = mp_projPsfManager.get();
+	const ImageParams& imgParams = img->getParams();
+	const Vector3D offset{imgParams.off_x, imgParams.off_y, imgParams.off_z};
+#pragma omp parallel default(none)                                        \
+    firstprivate(binIter, img, dat, numBins, numBlocks, psfManager, offset, \
+                     lorGroups)
+	{
+		std::vector<bin_t> bins(BinBlockSize);
+		float projValues[BinBlockSize];
+		ProjectionPropertiesBatch properties;
+#pragma omp for
+		for (bin_t blockIdx = 0; blockIdx < numBlocks; blockIdx++)
+		{
+			const bin_t first = blockIdx * BinBlockSize;
+			const size_t blockSize = std::min<bin_t>(BinBlockSize,
+			                                         numBins - first);
+			for (size_t i = 0; i < blockSize; i++)
+			{
+				bins[i] = (lorGroups != nullptr) ?
+				              lorGroups->getFirstBin(first + i) :
+				              binIter->get(first + i);
+			}
+			dat->getProjectionProperties(bins.data(), blockSize, properties);
+			if (psfManager != nullptr)
+			{
+				psfManager->getKernels(properties, offset, false);
+			}
+			forwardProjectionBatch(img, properties, projValues);
+			for (size_t i = 0; i < blockSize; i++)
+			{
+				const float imProj = projValues[i];
+				if (lorGroups != nullptr)
+				{
+					const bin_t groupIdx = first + i;
+					for (size_t j = lorGroups->groupStarts[groupIdx];
+					     j < lorGroups->groupStarts[groupIdx + 1]; j++)
+					{
+						dat->setProjectionValue(lorGroups->bins[j], imProj);
+					}
+				}
+				else
+				{
+					dat->setProjectionValue(bins[i], imProj);
+				}
+			}
+		}
 	}
 }
 
@@ -96,27 +223,409 @@ void OperatorProjector::applyAH(const Variable* in, Variable* out)
 	ASSERT_MSG(dat != nullptr, "Input variable has to be Projection data");
 	ASSERT_MSG(img != nullptr, "Output variable has to be an Image");
 
+	if (dat->hasTransaxialLORs())
+	{
+		// Each slice is backprojected by a single thread
+		const std::vector<std::vector<bin_t>> binsPerSlice =
+		    getBinsPerSlice(dat, img->getParams());
+		const int numSlices = static_cast<int>(binsPerSlice.size());
+		const std::vector<bin_t>* binsPerSlicePtr = binsPerSlice.data();
+#pragma omp parallel default(none) \
+    firstprivate(binsPerSlicePtr, numSlices, img, dat)
+		{
+			bin_t blockBins[BinBlockSize];
+			float projValues[BinBlockSize];
+			ProjectionPropertiesBatch properties;
+#pragma omp for schedule(dynamic)
+			for (int slice = 0; slice < numSlices; slice++)
+			{
+				const std::vector<bin_t>& bins = binsPerSlicePtr[slice];
+				for (size_t first = 0; first < bins.size();
+				     first += BinBlockSize)
+				{
+					const size_t last =
+					    std::min(first + BinBlockSize, bins.size());
+					size_t blockSize = 0;
+					for (size_t binIdx = first; binIdx < last; binIdx++)
+					{
+						const float projValue =
+						    dat->getProjectionValue(bins[binIdx]);
+						if (std::abs(projValue) >= SMALL)
+						{
+							blockBins[blockSize] = bins[binIdx];
+							projValues[blockSize] = projValue;
+							blockSize++;
+						}
+					}
+					if (blockSize == 0)
+					{
+						continue;
+					}
+					dat->getProjectionProperties(blockBins, blockSize,
+					                             properties);
+					backProjection2DBatch(img, properties, slice, projValues);
+				}
+			}
+		}
+		return;
+	}
+
+	if (dat->hasTOFBins())
+	{
+		ASSERT_MSG(mp_tofHelper != nullptr,
+		           "TOF-binned data requires the TOF to be set up in the "
+		           "projector");
+		// Each thread backprojects all the TOF bins of a LOR at once,
+		// leaving out the LORs where they are all null
+		const int numTOFBins = static_cast<int>(dat->getNumTOFBins());
+		const float tofBinWidth_ps = dat->getTOFBinWidth();
+		const bin_t numLORs = binIter->size() / numTOFBins;
+#pragma omp parallel default(none) \
+    firstprivate(binIter, img, dat, numTOFBins, tofBinWidth_ps, numLORs)
+		{
+			float projValues[TimeOfFlightHelper::MaxNumTOFBins];
+#pragma omp for
+			for (bin_t lorIdx = 0; lorIdx < numLORs; lorIdx++)
+			{
+				const bin_t first = lorIdx * numTOFBins;
+				bool isNull = true;
+				for (int t = 0; t < numTOFBins; t++)
+				{
+					projValues[t] =
+					    dat->getProjectionValue(binIter->get(first + t));
+					isNull = isNull && std::abs(projValues[t]) < SMALL;
+				}
+				if (isNull)
+				{
+					continue;
+				}
+				backProjectionTOFBins(
+				    img, dat->getProjectionProperties(binIter->get(first)),
+				    numTOFBins, tofBinWidth_ps, projValues);
+			}
+		}
+		return;
+	}
+
+	if (dat->hasLORBundles())
+	{
 #pragma omp parallel for default(none) firstprivate(binIter, img, dat)
-	for (bin_t binIdx = 0; binIdx < binIter->size(); binIdx++)
+		for (bin_t binIdx = 0; binIdx < binIter->size(); binIdx++)
+		{
+			const bin_t bin = binIter->get(binIdx);
+
+			float projValue = dat->getProjectionValue(bin);
+			if (std::abs(projValue) < SMALL)
+			{
+				continue;
+			}
+
+			backProjectionBundle(img, dat, bin, projValue);
+		}
+		return;
+	}
+
+	// The LORs are computed by blocks of bins, leaving out the null bins. If
+	// bins can share their LOR, each distinct LOR is backprojected once with
+	// the sum of the values of its bins
+	const LORGroups* lorGroups =
+	    dat->hasDuplicateLORs() ? &getLORGroups(dat) : nullptr;
+	const bin_t numBins =
+	    (lorGroups != nullptr) ? lorGroups->numGroups() : binIter->size();
+	const bin_t numBlocks = (numBins + BinBlockSize - 1) / BinBlockSize;
+	const ProjectionPsfManager* psfManager = mp_projPsfManager.get();
+	const ImageParams& imgParams = img->getParams();
+	const Vector3D offset{imgParams.off_x, imgParams.off_y, imgParams.off_z};
+#pragma omp parallel default(none)                                        \
+    firstprivate(binIter, img, dat, numBins, numBlocks, psfManager, offset, \
+                     lorGroups)
+	{
+		std::vector<bin_t> bins(BinBlockSize);
+		std::vector<float> projValues(BinBlockSize);
+		ProjectionPropertiesBatch properties;
+#pragma omp for
+		for (bin_t blockIdx = 0; blockIdx < numBlocks; blockIdx++)
+		{
+			const bin_t first = blockIdx * BinBlockSize;
+			const bin_t last = std::min<bin_t>(first + BinBlockSize, numBins);
+			size_t blockSize = 0;
+			for (bin_t binIdx = first; binIdx < last; binIdx++)
+			{
+				bin_t bin;
+				float projValue;
+				if (lorGroups != nullptr)
+				{
+					bin = lorGroups->getFirstBin(binIdx);
+					projValue = 0.0f;
+					for (size_t j = lorGroups->groupStarts[binIdx];
+					     j < lorGroups->groupStarts[binIdx + 1]; j++)
+					{
+						projValue +=
+						    dat->getProjectionValue(lorGroups->bins[j]);
+					}
+				}
+				else
+				{
+					bin = binIter->get(binIdx);
+					projValue = dat->getProjectionValue(bin);
+				}
+				if (std::abs(projValue) >= SMALL)
+				{
+					bins[blockSize] = bin;
+					projValues[blockSize] = projValue;
+					blockSize++;
+				}
+			}
+			if (blockSize == 0)
+			{
+				continue;
+			}
+			dat->getProjectionProperties(bins.data(), blockSize, properties);
+			if (psfManager != nullptr)
+			{
+				psfManager->getKernels(properties, offset, true);
+			}
+			backProjectionBatch(img, properties, projValues.data());
+		}
+	}
+}
+
+const OperatorProjector::LORGroups&
+    OperatorProjector::getLORGroups(const ProjectionData* dat) const
+{
+	ASSERT(binIter != nullptr);
+	// A ProjectionList has the LORs of its reference
+	const ProjectionData* lorData = dat;
+	if (const auto* projList = dynamic_cast<const ProjectionList*>(dat))
+	{
+		lorData = projList->getReference();
+	}
+	const auto key = std::make_pair(lorData, binIter);
+	const bin_t numBins = binIter->size();
+	const auto cached = m_lorGroups.find(key);
+	if (cached != m_lorGroups.end())
+	{
+		return cached->second;
+	}
+
+	std::vector<uint64_t> keys(numBins);
+	uint64_t* keysPtr = keys.data();
+	const BinIterator* binIterPtr = binIter;
+#pragma omp parallel for default(none) firstprivate(binIterPtr, dat, keysPtr)
+	for (bin_t binIdx = 0; binIdx < binIterPtr->size(); binIdx++)
+	{
+		keysPtr[binIdx] = dat->getLORKey(binIterPtr->get(binIdx));
+	}
+
+	std::vector<bin_t> order(numBins);
+	for (bin_t binIdx = 0; binIdx < numBins; binIdx++)
+	{
+		order[binIdx] = binIdx;
+	}
+	std::stable_sort(order.begin(), order.end(),
+	                 [keysPtr](bin_t a, bin_t b)
+	                 { return keysPtr[a] < keysPtr[b]; });
+
+	LORGroups& lorGroups = m_lorGroups[key];
+	lorGroups.bins.resize(numBins);
+	lorGroups.groupStarts.clear();
+	for (bin_t i = 0; i < numBins; i++)
+	{
+		if (i == 0 || keys[order[i]] != keys[order[i - 1]])
+		{
+			lorGroups.groupStarts.push_back(i);
+		}
+		lorGroups.bins[i] = binIter->get(order[i]);
+	}
+	lorGroups.groupStarts.push_back(numBins);
+	return lorGroups;
+}
+
+void OperatorProjector::clearLORGroups()
+{
+	m_lorGroups.clear();
+}
+
+void OperatorProjector::setBinIter(const BinIterator* p_binIter)
+{
+	if (p_binIter != binIter)
+	{
+		clearLORGroups();
+	}
+	OperatorProjectorBase::setBinIter(p_binIter);
+}
+
+void OperatorProjector::forwardProjectionBatch(
+    const Image* image, const ProjectionPropertiesBatch& properties,
+    float* projValues) const
+{
+	for (size_t i = 0; i < properties.size(); i++)
+	{
+		projValues[i] = forwardProjection(image, properties.get(i));
+	}
+}
+
+void OperatorProjector::backProjectionBatch(
+    Image* image, const ProjectionPropertiesBatch& properties,
+    const float* projValues) const
+{
+	for (size_t i = 0; i < properties.size(); i++)
+	{
+		if (projValues[i] != 0.0f)
+		{
+			backProjection(image, properties.get(i), projValues[i]);
+		}
+	}
+}
+
+float OperatorProjector::forwardProjectionBundle(const Image* image,
+                                                 const ProjectionData* dat,
+                                                 bin_t bin) const
+{
+	if (!dat->hasLORBundles())
+	{
+		return forwardProjection(image, dat->getProjectionProperties(bin));
+	}
+
+	const size_t numLORs = dat->getNumLORsInBin(bin);
+	float imProj = 0.0f;
+	for (size_t lorIdx = 0; lorIdx < numLORs; lorIdx++)
+	{
+		const ProjectionProperties projectionProperties =
+		    dat->getProjectionPropertiesInBin(bin, lorIdx);
+		imProj += dat->getWeightOfLORInBin(bin, lorIdx) *
+		          forwardProjection(image, projectionProperties);
+	}
+	return imProj;
+}
+
+void OperatorProjector::backProjectionBundle(Image* image,
+                                             const ProjectionData* dat,
+                                             bin_t bin, float projValue) const
+{
+	if (!dat->hasLORBundles())
+	{
+		backProjection(image, dat->getProjectionProperties(bin), projValue);
+		return;
+	}
+
+	const size_t numLORs = dat->getNumLORsInBin(bin);
+	for (size_t lorIdx = 0; lorIdx < numLORs; lorIdx++)
 	{
-		const bin_t bin = binIter->get(binIdx);
+		const ProjectionProperties projectionProperties =
+		    dat->getProjectionPropertiesInBin(bin, lorIdx);
+		backProjection(image, projectionProperties,
+		               dat->getWeightOfLORInBin(bin, lorIdx) * projValue);
+	}
+}
+
+void OperatorProjector::forwardProjectionTOFBins(
+    const Image* image, const ProjectionProperties& projectionProperties,
+    int numTOFBins, float tofBinWidth_ps, float* projValues) const
+{
+	(void)image;
+	(void)projectionProperties;
+	(void)numTOFBins;
+	(void)tofBinWidth_ps;
+	(void)projValues;
+	throw std::logic_error(
+	    "TOF-binned projections are not supported by this projector");
+}
+
+void OperatorProjector::backProjectionTOFBins(
+    Image* image, const ProjectionProperties& projectionProperties,
+    int numTOFBins, float tofBinWidth_ps, const float* projValues) const
+{
+	(void)image;
+	(void)projectionProperties;
+	(void)numTOFBins;
+	(void)tofBinWidth_ps;
+	(void)projValues;
+	throw std::logic_error(
+	    "TOF-binned projections are not supported by this projector");
+}
 
-		ProjectionProperties projectionProperties =
-		    dat->getProjectionProperties(bin);
+float OperatorProjector::forwardProjection2D(
+    const Image* image, const ProjectionProperties& projectionProperties,
+    int slice) const
+{
+	(void)slice;
+	return forwardProjection(image, projectionProperties);
+}
+
+void OperatorProjector::backProjection2D(
+    Image* image, const ProjectionProperties& projectionProperties, int slice,
+    float projValue) const
+{
+	(void)slice;
+	backProjection(image, projectionProperties, projValue);
+}
 
-		float projValue = dat->getProjectionValue(bin);
-		if (std::abs(projValue) < SMALL)
+void OperatorProjector::forwardProjection2DBatch(
+    const Image* image, const ProjectionPropertiesBatch& properties,
+    int slice, float* projValues) const
+{
+	for (size_t i = 0; i < properties.size(); i++)
+	{
+		projValues[i] = forwardProjection2D(image, properties.get(i), slice);
+	}
+}
+
+void OperatorProjector::backProjection2DBatch(
+    Image* image, const ProjectionPropertiesBatch& properties, int slice,
+    const float* projValues) const
+{
+	for (size_t i = 0; i < properties.size(); i++)
+	{
+		if (projValues[i] != 0.0f)
 		{
-			continue;
+			backProjection2D(image, properties.get(i), slice, projValues[i]);
 		}
+	}
+}
+
+std::vector<std::vector<bin_t>>
+    OperatorProjector::getBinsPerSlice(const ProjectionData* dat,
+                                       const ImageParams& imgParams) const
+{
+	ASSERT_MSG(dat->hasTransaxialLORs(),
+	           "The projection data has to have transaxial LORs");
+	ASSERT_MSG(!dat->hasLORBundles(),
+	           "LOR bundles are not supported in slice-by-slice projections");
 
-		backProjection(img, projectionProperties, projValue);
+	const bin_t numBins = binIter->size();
+	std::vector<int> sliceOfBin(numBins);
+	int* sliceOfBinPtr = sliceOfBin.data();
+	const float z0 = imgParams.off_z - 0.5f * imgParams.length_z;
+	const float inv_dz = 1.0f / imgParams.vz;
+	const int nz = imgParams.nz;
+
+#pragma omp parallel for default(none) \
+    firstprivate(sliceOfBinPtr, numBins, binIter, dat, z0, inv_dz, nz)
+	for (bin_t binIdx = 0; binIdx < numBins; binIdx++)
+	{
+		const Line3D lor = dat->getLOR(binIter->get(binIdx));
+		const int slice =
+		    static_cast<int>(std::floor((lor.point1.z - z0) * inv_dz));
+		sliceOfBinPtr[binIdx] = (slice >= 0 && slice < nz) ? slice : -1;
+	}
+
+	std::vector<std::vector<bin_t>> binsPerSlice(nz);
+	for (bin_t binIdx = 0; binIdx < numBins; binIdx++)
+	{
+		if (sliceOfBin[binIdx] >= 0)
+		{
+			binsPerSlice[sliceOfBin[binIdx]].push_back(binIter->get(binIdx));
+		}
 	}
+	return binsPerSlice;
 }
 
-void OperatorProjector::setupTOFHelper(float tofWidth_ps, int tofNumStd)
+void OperatorProjector::setupTOFHelper(float tofWidth_ps, int tofNumStd,
+                                       int tofLUTSamplesPerStd)
 {
-	mp_tofHelper = std::make_unique<TimeOfFlightHelper>(tofWidth_ps, tofNumStd);
+	mp_tofHelper = std::make_unique<TimeOfFlightHelper>(tofWidth_ps, tofNumStd,
+	                                                    tofLUTSamplesPerStd);
 	ASSERT_MSG(mp_tofHelper != nullptr,
 	           "Error occured during the setup of TimeOfFlightHelper");
 }
@@ -14,12 +14,15 @@ void py_setup_operatorprojectorparams(py::module& m)
 {
 	auto c = py::class_<OperatorProjectorParams>(m, "OperatorProjectorParams");
 	c.def(
-	    py::init<BinIterator*, Scanner&, float, int, const std::string&, int>(),
+	    py::init<BinIterator*, Scanner&, float, int, const std::string&, int,
+	             int>(),
 	    py::arg("binIter"), py::arg("scanner"), py::arg("tofWidth_ps") = 0.f,
 	    py::arg("tofNumStd") = 0, py::arg("psfProjFilename") = "",
-	    py::arg("num_rays") = 1);
+	    py::arg("num_rays") = 1, py::arg("tofLUTSamplesPerStd") = 0);
 	c.def_readwrite("tofWidth_ps", &OperatorProjectorParams::tofWidth_ps);
 	c.def_readwrite("tofNumStd", &OperatorProjectorParams::tofNumStd);
+	c.def_readwrite("tofLUTSamplesPerStd",
+	                &OperatorProjectorParams::tofLUTSamplesPerStd);
 	c.def_readwrite("psfProjFilename",
 	                &OperatorProjectorParams::psfProjFilename);
 	c.def_readwrite("num_rays", &OperatorProjectorParams::numRays);
@@ -41,11 +44,13 @@ OperatorProjectorParams::OperatorProjectorParams(const BinIterator* pp_binIter,
                                                  float p_tofWidth_ps,
                                                  int p_tofNumStd,
                                                  std::string p_psfProjFilename,
-                                                 int p_num_rays)
+                                                 int p_num_rays,
+                                                 int p_tofLUTSamplesPerStd)
     : binIter(pp_binIter),
       scanner(pr_scanner),
       tofWidth_ps(p_tofWidth_ps),
       tofNumStd(p_tofNumStd),
+      tofLUTSamplesPerStd(p_tofLUTSamplesPerStd),
       psfProjFilename(std::move(p_psfProjFilename)),
       numRays(p_num_rays)
 {
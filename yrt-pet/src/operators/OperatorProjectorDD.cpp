@@ -9,6 +9,7 @@
 #include "datastruct/projection/ProjectionData.hpp"
 #include "datastruct/scanner/Scanner.hpp"
 #include "geometry/ProjectorUtils.hpp"
+#include "utils/Assert.hpp"
 #include "utils/ReconstructionUtils.hpp"
 
 #include <algorithm>
@@ -63,7 +64,8 @@ float OperatorProjectorDD::forwardProjection(
 	return forwardProjection(
 	    img, projectionProperties.lor, projectionProperties.det1Orient,
 	    projectionProperties.det2Orient, mp_tofHelper.get(),
-	    projectionProperties.tofValue, mp_projPsfManager.get());
+	    projectionProperties.tofValue, mp_projPsfManager.get(),
+	    projectionProperties.psfKernel);
 }
 
 void OperatorProjectorDD::backProjection(
@@ -73,24 +75,74 @@ void OperatorProjectorDD::backProjection(
 	backProjection(
 	    img, projectionProperties.lor, projectionProperties.det1Orient,
 	    projectionProperties.det2Orient, projValue, mp_tofHelper.get(),
-	    projectionProperties.tofValue, mp_projPsfManager.get());
+	    projectionProperties.tofValue, mp_projPsfManager.get(),
+	    projectionProperties.psfKernel);
+}
+
+void OperatorProjectorDD::forwardProjectionBatch(
+    const Image* img, const ProjectionPropertiesBatch& properties,
+    float* projValues) const
+{
+	const TimeOfFlightHelper* tofHelper = mp_tofHelper.get();
+	const ProjectionPsfManager* psfManager = mp_projPsfManager.get();
+	const bool hasKernels = !properties.psfKernel.empty();
+	for (size_t i = 0; i < properties.size(); i++)
+	{
+		const Line3D lor{{properties.x1[i], properties.y1[i], properties.z1[i]},
+		                 {properties.x2[i], properties.y2[i], properties.z2[i]}};
+		const Vector3D n1{properties.orient1x[i], properties.orient1y[i],
+		                  properties.orient1z[i]};
+		const Vector3D n2{properties.orient2x[i], properties.orient2y[i],
+		                  properties.orient2z[i]};
+		projValues[i] =
+		    forwardProjection(img, lor, n1, n2, tofHelper,
+		                      properties.tofValue[i], psfManager,
+		                      hasKernels ? properties.psfKernel[i] : nullptr);
+	}
+}
+
+void OperatorProjectorDD::backProjectionBatch(
+    Image* img, const ProjectionPropertiesBatch& properties,
+    const float* projValues) const
+{
+	const TimeOfFlightHelper* tofHelper = mp_tofHelper.get();
+	const ProjectionPsfManager* psfManager = mp_projPsfManager.get();
+	const bool hasKernels = !properties.psfKernel.empty();
+	for (size_t i = 0; i < properties.size(); i++)
+	{
+		if (projValues[i] == 0.0f)
+		{
+			continue;
+		}
+		const Line3D lor{{properties.x1[i], properties.y1[i], properties.z1[i]},
+		                 {properties.x2[i], properties.y2[i], properties.z2[i]}};
+		const Vector3D n1{properties.orient1x[i], properties.orient1y[i],
+		                  properties.orient1z[i]};
+		const Vector3D n2{properties.orient2x[i], properties.orient2y[i],
+		                  properties.orient2z[i]};
+		backProjection(img, lor, n1, n2, projValues[i], tofHelper,
+		               properties.tofValue[i], psfManager,
+		               hasKernels ? properties.psfKernel[i] : nullptr);
+	}
 }
 
 float OperatorProjectorDD::forwardProjection(
     const Image* in_image, const Line3D& lor, const Vector3D& n1,
     const Vector3D& n2, const TimeOfFlightHelper* tofHelper, float tofValue,
-    const ProjectionPsfManager* psfManager) const
+    const ProjectionPsfManager* psfManager, const float* psfKernel) const
 {
 	float v = 0;
 	if (tofHelper != nullptr)
 	{
 		dd_project_ref<true, true>(const_cast<Image*>(in_image), lor, n1, n2, v,
-		                           tofHelper, tofValue, psfManager);
+		                           tofHelper, tofValue, psfManager, 0, 0, 0.f,
+		                           nullptr, psfKernel);
 	}
 	else
 	{
 		dd_project_ref<true, false>(const_cast<Image*>(in_image), lor, n1, n2,
-		                            v, nullptr, tofValue, psfManager);
+		                            v, nullptr, tofValue, psfManager, 0, 0, 0.f,
+		                            nullptr, psfKernel);
 	}
 	return v;
 }
@@ -98,17 +150,127 @@ float OperatorProjectorDD::forwardProjection(
 void OperatorProjectorDD::backProjection(
     Image* in_image, const Line3D& lor, const Vector3D& n1, const Vector3D& n2,
     float proj_value, const TimeOfFlightHelper* tofHelper, float tofValue,
-    const ProjectionPsfManager* psfManager) const
+    const ProjectionPsfManager* psfManager, const float* psfKernel) const
 {
 	if (tofHelper != nullptr)
 	{
 		dd_project_ref<false, true>(in_image, lor, n1, n2, proj_value,
-		                            tofHelper, tofValue, psfManager);
+		                            tofHelper, tofValue, psfManager, 0, 0, 0.f,
+		                            nullptr, psfKernel);
 	}
 	else
 	{
 		dd_project_ref<false, false>(in_image, lor, n1, n2, proj_value,
-		                             tofHelper, tofValue, psfManager);
+		                             tofHelper, tofValue, psfManager, 0, 0,
+		                             0.f, nullptr, psfKernel);
+	}
+}
+
+void OperatorProjectorDD::forwardProjectionTOFBins(
+    const Image* img, const ProjectionProperties& projectionProperties,
+    int numTOFBins, float tofBinWidth_ps, float* projValues) const
+{
+	ASSERT(mp_tofHelper != nullptr);
+	float v;
+	dd_project_ref<true, false, false, true>(
+	    const_cast<Image*>(img), projectionProperties.lor,
+	    projectionProperties.det1Orient, projectionProperties.det2Orient, v,
+	    mp_tofHelper.get(), 0.0f, mp_projPsfManager.get(), 0, numTOFBins,
+	    tofBinWidth_ps, projValues);
+}
+
+void OperatorProjectorDD::backProjectionTOFBins(
+    Image* img, const ProjectionProperties& projectionProperties,
+    int numTOFBins, float tofBinWidth_ps, const float* projValues) const
+{
+	ASSERT(mp_tofHelper != nullptr);
+	float v = 0.0f;
+	dd_project_ref<false, false, false, true>(
+	    img, projectionProperties.lor, projectionProperties.det1Orient,
+	    projectionProperties.det2Orient, v, mp_tofHelper.get(), 0.0f,
+	    mp_projPsfManager.get(), 0, numTOFBins, tofBinWidth_ps,
+	    const_cast<float*>(projValues));
+}
+
+float OperatorProjectorDD::forwardProjection2D(
+    const Image* img, const ProjectionProperties& projectionProperties,
+    int slice) const
+{
+	float v = 0;
+	project2D<true>(const_cast<Image*>(img), projectionProperties.lor,
+	                projectionProperties.det1Orient,
+	                projectionProperties.det2Orient,
+	                projectionProperties.tofValue, slice, v);
+	return v;
+}
+
+void OperatorProjectorDD::backProjection2D(
+    Image* img, const ProjectionProperties& projectionProperties, int slice,
+    float projValue) const
+{
+	project2D<false>(img, projectionProperties.lor,
+	                 projectionProperties.det1Orient,
+	                 projectionProperties.det2Orient,
+	                 projectionProperties.tofValue, slice, projValue);
+}
+
+void OperatorProjectorDD::forwardProjection2DBatch(
+    const Image* img, const ProjectionPropertiesBatch& properties, int slice,
+    float* projValues) const
+{
+	for (size_t i = 0; i < properties.size(); i++)
+	{
+		const Line3D lor{{properties.x1[i], properties.y1[i], properties.z1[i]},
+		                 {properties.x2[i], properties.y2[i], properties.z2[i]}};
+		const Vector3D n1{properties.orient1x[i], properties.orient1y[i],
+		                  properties.orient1z[i]};
+		const Vector3D n2{properties.orient2x[i], properties.orient2y[i],
+		                  properties.orient2z[i]};
+		projValues[i] = 0.0f;
+		project2D<true>(const_cast<Image*>(img), lor, n1, n2,
+		                properties.tofValue[i], slice, projValues[i]);
+	}
+}
+
+void OperatorProjectorDD::backProjection2DBatch(
+    Image* img, const ProjectionPropertiesBatch& properties, int slice,
+    const float* projValues) const
+{
+	for (size_t i = 0; i < properties.size(); i++)
+	{
+		if (projValues[i] == 0.0f)
+		{
+			continue;
+		}
+		const Line3D lor{{properties.x1[i], properties.y1[i], properties.z1[i]},
+		                 {properties.x2[i], properties.y2[i], properties.z2[i]}};
+		const Vector3D n1{properties.orient1x[i], properties.orient1y[i],
+		                  properties.orient1z[i]};
+		const Vector3D n2{properties.orient2x[i], properties.orient2y[i],
+		                  properties.orient2z[i]};
+		float projValue = projValues[i];
+		project2D<false>(img, lor, n1, n2, properties.tofValue[i], slice,
+		                 projValue);
+	}
+}
+
+template <bool IS_FWD>
+void OperatorProjectorDD::project2D(Image* img, const Line3D& lor,
+                                    const Vector3D& n1, const Vector3D& n2,
+                                    float tofValue, int slice,
+                                    float& projValue) const
+{
+	if (mp_tofHelper != nullptr)
+	{
+		dd_project_ref<IS_FWD, true, true>(img, lor, n1, n2, projValue,
+		                                   mp_tofHelper.get(), tofValue,
+		                                   mp_projPsfManager.get(), slice);
+	}
+	else
+	{
+		dd_project_ref<IS_FWD, false, true>(img, lor, n1, n2, projValue,
+		                                    nullptr, 0.0f,
+		                                    mp_projPsfManager.get(), slice);
 	}
 }
 
@@ -138,15 +300,20 @@ float OperatorProjectorDD::get_overlap(const float p0, const float p1,
 	                get_overlap_safe(p0, p1, d0, d1, psfManager, psfKernel));
 }
 
-template <bool IS_FWD, bool FLAG_TOF>
+template <bool IS_FWD, bool FLAG_TOF, bool FLAG_2D, bool FLAG_TOF_BINS>
 void OperatorProjectorDD::dd_project_ref(
     Image* in_image, const Line3D& lor, const Vector3D& n1, const Vector3D& n2,
     float& proj_value, const TimeOfFlightHelper* tofHelper, float tofValue,
-    const ProjectionPsfManager* psfManager) const
+    const ProjectionPsfManager* psfManager, int slice, int numTOFBins,
+    float tofBinWidth_ps, float* tofBinValues, const float* psfKernel) const
 {
 	if constexpr (IS_FWD)
 	{
 		proj_value = 0.0f;
+		if constexpr (FLAG_TOF_BINS)
+		{
+			std::fill(tofBinValues, tofBinValues + numTOFBins, 0.0f);
+		}
 	}
 	const ImageParams& params = in_image->getParams();
 	const Vector3D offsetVec = {params.off_x, params.off_y, params.off_z};
@@ -164,12 +331,14 @@ void OperatorProjectorDD::dd_project_ref(
 	const float thickness_z = scanner.crystalSize_z;
 	const float thickness_trans = scanner.crystalSize_trans;
 
-	// PSF
-	const float* psfKernel = nullptr;
+	// PSF (the kernel may have been looked up beforehand)
 	float detFootprintExt = 0.f;
 	if (psfManager != nullptr)
 	{
-		psfKernel = psfManager->getKernel(lorWithoffset, !IS_FWD);
+		if (psfKernel == nullptr)
+		{
+			psfKernel = psfManager->getKernel(lorWithoffset, !IS_FWD);
+		}
 		detFootprintExt = psfManager->getHalfWidth_mm();
 	}
 	// Pixel limits (ignore detector width)
@@ -193,6 +362,12 @@ void OperatorProjectorDD::dd_project_ref(
 	Util::get_alpha(-0.5f * (params.length_z - dz),
 	                0.5f * (params.length_z - dz), d1.z, d2.z, inv_d12_z,
 	                az_min, az_max);
+	if constexpr (FLAG_2D)
+	{
+		// The slice is given, the axial extent of the image does not apply
+		az_min = 0.0f;
+		az_max = 1.0f;
+	}
 	float amin = std::max({0.0f, ax_min, ay_min, az_min});
 	float amax = std::min({1.0f, ax_max, ay_max, az_max});
 	if constexpr (FLAG_TOF)
@@ -321,9 +496,30 @@ void OperatorProjectorDD::dd_project_ref(
 		dxy_cos_theta = dxy;
 	}
 
+	float tofBinWeights[TimeOfFlightHelper::MaxNumTOFBins];
 	for (int xyi = xy_i_0; xyi <= xy_i_1; xyi++)
 	{
 		const float pix_xy = -0.5f * lxy + (xyi + 0.5f) * dxy;
+		// With TOF bins, the TOF weights only depend on the position along
+		// the main axis. The voxels of the plane are summed (forward) or
+		// given the TOF-weighted sum of the bins (backward)
+		float xy_proj_value = 0.0f;
+		float& acc_value = FLAG_TOF_BINS ? xy_proj_value : proj_value;
+		float bwd_value = proj_value;
+		if constexpr (FLAG_TOF_BINS)
+		{
+			tofHelper->getTOFBinWeights(
+			    d_norm, (pix_xy - d1_i) / (d2_i - d1_i) * d_norm, numTOFBins,
+			    tofBinWidth_ps, tofBinWeights);
+			if constexpr (!IS_FWD)
+			{
+				bwd_value = 0.0f;
+				for (int t = 0; t < numTOFBins; t++)
+				{
+					bwd_value += tofBinWeights[t] * tofBinValues[t];
+				}
+			}
+		}
 		const float a_xy_lo = (pix_xy - d1_xy_lo) / (d2_xy_hi - d1_xy_lo);
 		const float a_xy_hi = (pix_xy - d1_xy_hi) / (d2_xy_lo - d1_xy_hi);
 		const float a_z_lo = (pix_xy - d1_z_lo_i) / (d2_z_lo_i - d1_z_lo_i);
@@ -369,12 +565,22 @@ void OperatorProjectorDD::dd_project_ref(
 				const float weight_xy_s = weight_xy / widthFrac_yx;
 				const float dd_z_i_offset = (params.nz - 1) * 0.5f;
 				const float inv_dz = 1.0f / dz;
-				const int dd_z_i_0 =
-				    std::max(0, static_cast<int>(std::rintf(dd_z_r_0 * inv_dz +
-				                                            dd_z_i_offset)));
-				const int dd_z_i_1 = std::min(
-				    params.nz - 1, static_cast<int>(std::rintf(
-				                       dd_z_r_1 * inv_dz + dd_z_i_offset)));
+				int dd_z_i_0, dd_z_i_1;
+				if constexpr (FLAG_2D)
+				{
+					// The LOR is in the plane of the slice
+					dd_z_i_0 = dd_z_i_1 = slice;
+				}
+				else
+				{
+					dd_z_i_0 = std::max(
+					    0, static_cast<int>(
+					           std::rintf(dd_z_r_0 * inv_dz + dd_z_i_offset)));
+					dd_z_i_1 = std::min(
+					    params.nz - 1,
+					    static_cast<int>(
+					        std::rintf(dd_z_r_1 * inv_dz + dd_z_i_offset)));
+				}
 				for (int zi = dd_z_i_0; zi <= dd_z_i_1; zi++)
 				{
 					const float pix_z =
@@ -392,11 +598,16 @@ void OperatorProjectorDD::dd_project_ref(
 
 					const float dd_z_p_0 = pix_z - params.vz * 0.5f;
 					const float dd_z_p_1 = pix_z + params.vz * 0.5f;
-					if (dd_z_r_1 >= dd_z_p_0 && dd_z_r_0 < dd_z_p_1)
+					if (FLAG_2D ||
+					    (dd_z_r_1 >= dd_z_p_0 && dd_z_r_0 < dd_z_p_1))
 					{
-						const float weight_z = get_overlap_safe(
-						    dd_z_p_0, dd_z_p_1, dd_z_r_0, dd_z_r_1);
-						const float weight_z_s = weight_z / widthFrac_z;
+						float weight_z_s = 1.0f;
+						if constexpr (!FLAG_2D)
+						{
+							const float weight_z = get_overlap_safe(
+							    dd_z_p_0, dd_z_p_1, dd_z_r_0, dd_z_r_1);
+							weight_z_s = weight_z / widthFrac_z;
+						}
 						size_t idx = zi * num_xy;
 						if (flag_y)
 						{
@@ -415,29 +626,69 @@ void OperatorProjectorDD::dd_project_ref(
 						float* ptr = raw_img_ptr + idx;
 						if constexpr (IS_FWD)
 						{
-							proj_value += (*ptr) * weight;
+							acc_value += (*ptr) * weight;
+						}
+						else if constexpr (FLAG_2D)
+						{
+							// Only one thread writes in the slice
+							*ptr += bwd_value * weight;
 						}
 						else
 						{
 #pragma omp atomic
-							*ptr += proj_value * weight;
+							*ptr += bwd_value * weight;
 						}
 					}
 				}
 			}
 		}
+		if constexpr (IS_FWD && FLAG_TOF_BINS)
+		{
+			for (int t = 0; t < numTOFBins; t++)
+			{
+				tofBinValues[t] += tofBinWeights[t] * xy_proj_value;
+			}
+		}
 	}
 }
 
-template void OperatorProjectorDD::dd_project_ref<true, false>(
+template void OperatorProjectorDD::dd_project_ref<true, false, false>(
+    Image*, const Line3D&, const Vector3D&, const Vector3D&, float&,
+    const TimeOfFlightHelper*, float, const ProjectionPsfManager*, int, int,
+    float, float*, const float*) const;
+template void OperatorProjectorDD::dd_project_ref<false, false, false>(
+    Image*, const Line3D&, const Vector3D&, const Vector3D&, float&,
+    const TimeOfFlightHelper*, float, const ProjectionPsfManager*, int, int,
+    float, float*, const float*) const;
+template void OperatorProjectorDD::dd_project_ref<true, true, false>(
+    Image*, const Line3D&, const Vector3D&, const Vector3D&, float&,
+    const TimeOfFlightHelper*, float, const ProjectionPsfManager*, int, int,
+    float, float*, const float*) const;
+template void OperatorProjectorDD::dd_project_ref<false, true, false>(
+    Image*, const Line3D&, const Vector3D&, const Vector3D&, float&,
+    const TimeOfFlightHelper*, float, const ProjectionPsfManager*, int, int,
+    float, float*, const float*) const;
+template void OperatorProjectorDD::dd_project_ref<true, false, true>(
+    Image*, const Line3D&, const Vector3D&, const Vector3D&, float&,
+    const TimeOfFlightHelper*, float, const ProjectionPsfManager*, int, int,
+    float, float*, const float*) const;
+template void OperatorProjectorDD::dd_project_ref<false, false, true>(
+    Image*, const Line3D&, const Vector3D&, const Vector3D&, float&,
+    const TimeOfFlightHelper*, float, const ProjectionPsfManager*, int, int,
+    float, float*, const float*) const;
+template void OperatorProjectorDD::dd_project_ref<true, true, true>(
     Image*, const Line3D&, const Vector3D&, const Vector3D&, float&,
-    const TimeOfFlightHelper*, float, const ProjectionPsfManager*) const;
-template void OperatorProjectorDD::dd_project_ref<false, false>(
+    const TimeOfFlightHelper*, float, const ProjectionPsfManager*, int, int,
+    float, float*, const float*) const;
+template void OperatorProjectorDD::dd_project_ref<false, true, true>(
     Image*, const Line3D&, const Vector3D&, const Vector3D&, float&,
-    const TimeOfFlightHelper*, float, const ProjectionPsfManager*) const;
-template void OperatorProjectorDD::dd_project_ref<true, true>(
+    const TimeOfFlightHelper*, float, const ProjectionPsfManager*, int, int,
+    float, float*, const float*) const;
+template void OperatorProjectorDD::dd_project_ref<true, false, false, true>(
     Image*, const Line3D&, const Vector3D&, const Vector3D&, float&,
-    const TimeOfFlightHelper*, float, const ProjectionPsfManager*) const;
-template void OperatorProjectorDD::dd_project_ref<false, true>(
+    const TimeOfFlightHelper*, float, const ProjectionPsfManager*, int, int,
+    float, float*, const float*) const;
+template void OperatorProjectorDD::dd_project_ref<false, false, false, true>(
     Image*, const Line3D&, const Vector3D&, const Vector3D&, float&,
-    const TimeOfFlightHelper*, float, const ProjectionPsfManager*) const;
+    const TimeOfFlightHelper*, float, const ProjectionPsfManager*, int, int,
+    float, float*, const float*) const;
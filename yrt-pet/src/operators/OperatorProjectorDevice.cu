@@ -28,7 +28,8 @@ OperatorProjectorDevice::OperatorProjectorDevice(
 {
 	if (p_projParams.tofWidth_ps > 0.f)
 	{
-		setupTOFHelper(p_projParams.tofWidth_ps, p_projParams.tofNumStd);
+		setupTOFHelper(p_projParams.tofWidth_ps, p_projParams.tofNumStd,
+		               p_projParams.tofLUTSamplesPerStd);
 	}
 	if (!p_projParams.psfProjFilename.empty())
 	{
@@ -73,10 +74,11 @@ void OperatorProjectorDevice::setupProjPsfManager(
 	           "Error occured during the setup of ProjectionPsfManagerDevice");
 }
 
-void OperatorProjectorDevice::setupTOFHelper(float tofWidth_ps, int tofNumStd)
+void OperatorProjectorDevice::setupTOFHelper(float tofWidth_ps, int tofNumStd,
+                                             int tofLUTSamplesPerStd)
 {
 	mp_tofHelper = std::make_unique<DeviceObject<TimeOfFlightHelper>>(
-	    tofWidth_ps, tofNumStd);
+	    tofWidth_ps, tofNumStd, tofLUTSamplesPerStd);
 }
 
 const TimeOfFlightHelper*
@@ -74,17 +74,27 @@ void py_setup_operatorprojectorsiddon(py::module& m)
 OperatorProjectorSiddon::OperatorProjectorSiddon(
     const OperatorProjectorParams& p_projParams)
     : OperatorProjector(p_projParams), m_numRays(p_projParams.numRays)
+{
+	setupLineGenerators();
+}
+
+void OperatorProjectorSiddon::setupLineGenerators()
 {
 	if (m_numRays > 1)
 	{
+		// The sub-rays are the same for all the LORs, in the frame of their
+		// detectors, so they are computed once and shared by the threads
+		MultiRayGenerator lineGen{scanner.crystalSize_z,
+		                          scanner.crystalSize_trans, false,
+		                          scanner.crystalDepth};
+		lineGen.setupStratifiedOffsets(m_numRays);
 		mp_lineGen = std::make_unique<std::vector<MultiRayGenerator>>(
-		    Globals::get_num_threads(),
-		    MultiRayGenerator{scanner.crystalSize_z,
-		                      scanner.crystalSize_trans});
+		    Globals::get_num_threads(), lineGen);
+	}
+	else
+	{
+		mp_lineGen = nullptr;
 	}
-	ASSERT_MSG_WARNING(
-	    mp_projPsfManager == nullptr,
-	    "Siddon does not support Projection space PSF. It will be ignored.");
 }
 
 int OperatorProjectorSiddon::getNumRays() const
@@ -95,15 +105,87 @@ int OperatorProjectorSiddon::getNumRays() const
 void OperatorProjectorSiddon::setNumRays(int n)
 {
 	m_numRays = n;
+	setupLineGenerators();
+}
+
+const float* OperatorProjectorSiddon::getPsfKernel(const Line3D& lor,
+                                                   const Vector3D& offsetVec,
+                                                   const float* psfKernel,
+                                                   bool flagFlipped) const
+{
+	if (mp_projPsfManager == nullptr || psfKernel != nullptr)
+	{
+		return psfKernel;
+	}
+	const Line3D lorWithOffset{lor.point1 - offsetVec, lor.point2 - offsetVec};
+	return mp_projPsfManager->getKernel(lorWithOffset, flagFlipped);
+}
+
+template <typename RayFunc>
+void OperatorProjectorSiddon::forEachPsfRay(const Line3D& ray,
+                                            const float* psfKernel,
+                                            bool flagFlipped,
+                                            RayFunc&& func) const
+{
+	if (psfKernel == nullptr)
+	{
+		func(ray, 1.0f);
+		return;
+	}
+
+	// Transaxial direction orthogonal to the ray, along which the kernel is
+	// defined
+	const Vector3D& p1 = ray.point1;
+	const Vector3D& p2 = ray.point2;
+	Vector3D n_plane{p2.y - p1.y, p1.x - p2.x, 0.0f};
+	const float n_plane_norm = n_plane.getNorm();
+	if (n_plane_norm == 0.0f)
+	{
+		func(ray, 1.0f);
+		return;
+	}
+	n_plane = n_plane / n_plane_norm;
+
+	// One ray per kernel sample, weighted by the integral of the kernel over
+	// the sample's cell. The weights are normalized so that the rays sum to
+	// the original one. The flipped kernel (backprojection) is applied with
+	// mirrored shifts so that the backprojection is the exact adjoint
+	const int kernelSize = mp_projPsfManager->getKernelSize();
+	const int halfSize = (kernelSize - 1) / 2;
+	const float kSpacing = mp_projPsfManager->getKernelSpacing();
+	const float shiftSign = flagFlipped ? -1.0f : 1.0f;
+	float weightSum = 0.0f;
+	for (int k = 0; k < kernelSize; k++)
+	{
+		const float shift = static_cast<float>(k - halfSize) * kSpacing;
+		weightSum += mp_projPsfManager->getWeight(
+		    psfKernel, shift - 0.5f * kSpacing, shift + 0.5f * kSpacing);
+	}
+	if (weightSum <= 0.0f)
+	{
+		return;
+	}
+	for (int k = 0; k < kernelSize; k++)
+	{
+		const float shift = static_cast<float>(k - halfSize) * kSpacing;
+		const float weight = mp_projPsfManager->getWeight(
+		    psfKernel, shift - 0.5f * kSpacing, shift + 0.5f * kSpacing);
+		if (weight <= 0.0f)
+		{
+			continue;
+		}
+		const Vector3D shiftVec = n_plane * (shiftSign * shift);
+		func(Line3D{p1 + shiftVec, p2 + shiftVec}, weight / weightSum);
+	}
 }
 
 float OperatorProjectorSiddon::forwardProjection(
     const Image* img, const ProjectionProperties& projectionProperties) const
 {
-	return forwardProjection(img, projectionProperties.lor,
-	                         projectionProperties.det1Orient,
-	                         projectionProperties.det2Orient,
-	                         mp_tofHelper.get(), projectionProperties.tofValue);
+	return forwardProjection(
+	    img, projectionProperties.lor, projectionProperties.det1Orient,
+	    projectionProperties.det2Orient, mp_tofHelper.get(),
+	    projectionProperties.tofValue, projectionProperties.psfKernel);
 }
 
 void OperatorProjectorSiddon::backProjection(
@@ -113,15 +195,63 @@ void OperatorProjectorSiddon::backProjection(
 	backProjection(img, projectionProperties.lor,
 	               projectionProperties.det1Orient,
 	               projectionProperties.det2Orient, projValue,
-	               mp_tofHelper.get(), projectionProperties.tofValue);
+	               mp_tofHelper.get(), projectionProperties.tofValue,
+	               projectionProperties.psfKernel);
+}
+
+void OperatorProjectorSiddon::forwardProjectionBatch(
+    const Image* img, const ProjectionPropertiesBatch& properties,
+    float* projValues) const
+{
+	const TimeOfFlightHelper* tofHelper = mp_tofHelper.get();
+	const bool hasKernels = !properties.psfKernel.empty();
+	for (size_t i = 0; i < properties.size(); i++)
+	{
+		const Line3D lor{{properties.x1[i], properties.y1[i], properties.z1[i]},
+		                 {properties.x2[i], properties.y2[i], properties.z2[i]}};
+		const Vector3D n1{properties.orient1x[i], properties.orient1y[i],
+		                  properties.orient1z[i]};
+		const Vector3D n2{properties.orient2x[i], properties.orient2y[i],
+		                  properties.orient2z[i]};
+		projValues[i] =
+		    forwardProjection(img, lor, n1, n2, tofHelper,
+		                      properties.tofValue[i],
+		                      hasKernels ? properties.psfKernel[i] : nullptr);
+	}
+}
+
+void OperatorProjectorSiddon::backProjectionBatch(
+    Image* img, const ProjectionPropertiesBatch& properties,
+    const float* projValues) const
+{
+	const TimeOfFlightHelper* tofHelper = mp_tofHelper.get();
+	const bool hasKernels = !properties.psfKernel.empty();
+	for (size_t i = 0; i < properties.size(); i++)
+	{
+		if (projValues[i] == 0.0f)
+		{
+			continue;
+		}
+		const Line3D lor{{properties.x1[i], properties.y1[i], properties.z1[i]},
+		                 {properties.x2[i], properties.y2[i], properties.z2[i]}};
+		const Vector3D n1{properties.orient1x[i], properties.orient1y[i],
+		                  properties.orient1z[i]};
+		const Vector3D n2{properties.orient2x[i], properties.orient2y[i],
+		                  properties.orient2z[i]};
+		backProjection(img, lor, n1, n2, projValues[i], tofHelper,
+		               properties.tofValue[i],
+		               hasKernels ? properties.psfKernel[i] : nullptr);
+	}
 }
 
 float OperatorProjectorSiddon::forwardProjection(
     const Image* img, const Line3D& lor, const Vector3D& n1, const Vector3D& n2,
-    const TimeOfFlightHelper* tofHelper, float tofValue) const
+    const TimeOfFlightHelper* tofHelper, float tofValue,
+    const float* psfKernel) const
 {
 	const ImageParams& params = img->getParams();
 	const Vector3D offsetVec = {params.off_x, params.off_y, params.off_z};
+	psfKernel = getPsfKernel(lor, offsetVec, psfKernel, false);
 
 	float imProj = 0.;
 
@@ -135,26 +265,32 @@ float OperatorProjectorSiddon::forwardProjection(
 
 	for (int i_line = 0; i_line < m_numRays; i_line++)
 	{
-		unsigned int seed = 13;
-		Line3D randLine = (i_line == 0) ?
-		                      lor :
-		                      mp_lineGen->at(currThread).getRandomLine(seed);
+		Line3D randLine =
+		    (m_numRays > 1) ?
+		        mp_lineGen->at(currThread).getStratifiedLine(i_line) :
+		        lor;
 		randLine.point1 = randLine.point1 - offsetVec;
 		randLine.point2 = randLine.point2 - offsetVec;
 
-		float currentProjValue = 0.0;
-		if (tofHelper != nullptr)
-		{
-			project_helper<true, true, true>(const_cast<Image*>(img), randLine,
-			                                 currentProjValue, tofHelper,
-			                                 tofValue);
-		}
-		else
-		{
-			project_helper<true, true, false>(const_cast<Image*>(img), randLine,
-			                                  currentProjValue, nullptr, 0);
-		}
-		imProj += currentProjValue;
+		forEachPsfRay(
+		    randLine, psfKernel, false,
+		    [&](const Line3D& ray, float weight)
+		    {
+			    float currentProjValue = 0.0;
+			    if (tofHelper != nullptr)
+			    {
+				    project_helper<true, true, true>(const_cast<Image*>(img),
+				                                     ray, currentProjValue,
+				                                     tofHelper, tofValue);
+			    }
+			    else
+			    {
+				    project_helper<true, true, false>(const_cast<Image*>(img),
+				                                      ray, currentProjValue,
+				                                      nullptr, 0);
+			    }
+			    imProj += weight * currentProjValue;
+		    });
 	}
 
 	if (m_numRays > 1)
@@ -167,11 +303,12 @@ float OperatorProjectorSiddon::forwardProjection(
 
 void OperatorProjectorSiddon::backProjection(
     Image* img, const Line3D& lor, const Vector3D& n1, const Vector3D& n2,
-    float projValue, const TimeOfFlightHelper* tofHelper, float tofValue) const
+    float projValue, const TimeOfFlightHelper* tofHelper, float tofValue,
+    const float* psfKernel) const
 {
 	const ImageParams& params = img->getParams();
 	const Vector3D offsetVec = {params.off_x, params.off_y, params.off_z};
-
+	psfKernel = getPsfKernel(lor, offsetVec, psfKernel, true);
 
 	int currThread = 0;
 	float projValuePerLor = projValue;
@@ -185,23 +322,230 @@ void OperatorProjectorSiddon::backProjection(
 
 	for (int i_line = 0; i_line < m_numRays; i_line++)
 	{
-		unsigned int seed = 13;
-		Line3D randLine = (i_line == 0) ?
-		                      lor :
-		                      mp_lineGen->at(currThread).getRandomLine(seed);
+		Line3D randLine =
+		    (m_numRays > 1) ?
+		        mp_lineGen->at(currThread).getStratifiedLine(i_line) :
+		        lor;
+		randLine.point1 = randLine.point1 - offsetVec;
+		randLine.point2 = randLine.point2 - offsetVec;
+		forEachPsfRay(
+		    randLine, psfKernel, true,
+		    [&](const Line3D& ray, float weight)
+		    {
+			    float projValuePerRay = weight * projValuePerLor;
+			    if (tofHelper != nullptr)
+			    {
+				    project_helper<false, true, true>(
+				        img, ray, projValuePerRay, tofHelper, tofValue);
+			    }
+			    else
+			    {
+				    project_helper<false, true, false>(img, ray,
+				                                       projValuePerRay, nullptr,
+				                                       0);
+			    }
+		    });
+	}
+}
+
+void OperatorProjectorSiddon::forwardProjectionTOFBins(
+    const Image* img, const ProjectionProperties& projectionProperties,
+    int numTOFBins, float tofBinWidth_ps, float* projValues) const
+{
+	ASSERT(mp_tofHelper != nullptr);
+	const ImageParams& params = img->getParams();
+	const Vector3D offsetVec = {params.off_x, params.off_y, params.off_z};
+	const Line3D& lor = projectionProperties.lor;
+	const float* psfKernel =
+	    getPsfKernel(lor, offsetVec, projectionProperties.psfKernel, false);
+
+	int currThread = 0;
+	if (m_numRays > 1)
+	{
+		currThread = omp_get_thread_num();
+		ASSERT(mp_lineGen != nullptr);
+		mp_lineGen->at(currThread).setupGenerator(
+		    lor, projectionProperties.det1Orient,
+		    projectionProperties.det2Orient);
+	}
+
+	std::fill(projValues, projValues + numTOFBins, 0.0f);
+	float rayValues[TimeOfFlightHelper::MaxNumTOFBins];
+	for (int i_line = 0; i_line < m_numRays; i_line++)
+	{
+		Line3D randLine =
+		    (m_numRays > 1) ?
+		        mp_lineGen->at(currThread).getStratifiedLine(i_line) :
+		        lor;
 		randLine.point1 = randLine.point1 - offsetVec;
 		randLine.point2 = randLine.point2 - offsetVec;
-		if (tofHelper != nullptr)
+		forEachPsfRay(
+		    randLine, psfKernel, false,
+		    [&](const Line3D& ray, float weight)
+		    {
+			    project_helper_TOFBins<true, true>(
+			        const_cast<Image*>(img), ray, rayValues, numTOFBins,
+			        tofBinWidth_ps, mp_tofHelper.get());
+			    for (int t = 0; t < numTOFBins; t++)
+			    {
+				    projValues[t] += weight * rayValues[t];
+			    }
+		    });
+	}
+
+	if (m_numRays > 1)
+	{
+		for (int t = 0; t < numTOFBins; t++)
 		{
-			project_helper<false, true, true>(img, randLine, projValuePerLor,
-			                                  tofHelper, tofValue);
+			projValues[t] /= static_cast<float>(m_numRays);
 		}
-		else
+	}
+}
+
+void OperatorProjectorSiddon::backProjectionTOFBins(
+    Image* img, const ProjectionProperties& projectionProperties,
+    int numTOFBins, float tofBinWidth_ps, const float* projValues) const
+{
+	ASSERT(mp_tofHelper != nullptr);
+	const ImageParams& params = img->getParams();
+	const Vector3D offsetVec = {params.off_x, params.off_y, params.off_z};
+	const Line3D& lor = projectionProperties.lor;
+	const float* psfKernel =
+	    getPsfKernel(lor, offsetVec, projectionProperties.psfKernel, true);
+
+	int currThread = 0;
+	float projValuesPerLor[TimeOfFlightHelper::MaxNumTOFBins];
+	std::copy(projValues, projValues + numTOFBins, projValuesPerLor);
+	if (m_numRays > 1)
+	{
+		ASSERT(mp_lineGen != nullptr);
+		currThread = omp_get_thread_num();
+		mp_lineGen->at(currThread).setupGenerator(
+		    lor, projectionProperties.det1Orient,
+		    projectionProperties.det2Orient);
+		for (int t = 0; t < numTOFBins; t++)
 		{
-			project_helper<false, true, false>(img, randLine, projValuePerLor,
-			                                   nullptr, 0);
+			projValuesPerLor[t] /= static_cast<float>(m_numRays);
 		}
 	}
+
+	for (int i_line = 0; i_line < m_numRays; i_line++)
+	{
+		Line3D randLine =
+		    (m_numRays > 1) ?
+		        mp_lineGen->at(currThread).getStratifiedLine(i_line) :
+		        lor;
+		randLine.point1 = randLine.point1 - offsetVec;
+		randLine.point2 = randLine.point2 - offsetVec;
+		forEachPsfRay(
+		    randLine, psfKernel, true,
+		    [&](const Line3D& ray, float weight)
+		    {
+			    float projValuesPerRay[TimeOfFlightHelper::MaxNumTOFBins];
+			    for (int t = 0; t < numTOFBins; t++)
+			    {
+				    projValuesPerRay[t] = weight * projValuesPerLor[t];
+			    }
+			    project_helper_TOFBins<false, true>(
+			        img, ray, projValuesPerRay, numTOFBins, tofBinWidth_ps,
+			        mp_tofHelper.get());
+		    });
+	}
+}
+
+float OperatorProjectorSiddon::forwardProjection2D(
+    const Image* img, const ProjectionProperties& projectionProperties,
+    int slice) const
+{
+	return forwardProjection2D(img, projectionProperties.lor,
+	                           projectionProperties.psfKernel, slice);
+}
+
+void OperatorProjectorSiddon::backProjection2D(
+    Image* img, const ProjectionProperties& projectionProperties, int slice,
+    float projValue) const
+{
+	backProjection2D(img, projectionProperties.lor,
+	                 projectionProperties.psfKernel, slice, projValue);
+}
+
+void OperatorProjectorSiddon::forwardProjection2DBatch(
+    const Image* img, const ProjectionPropertiesBatch& properties, int slice,
+    float* projValues) const
+{
+	const bool hasKernels = !properties.psfKernel.empty();
+	for (size_t i = 0; i < properties.size(); i++)
+	{
+		const Line3D lor{{properties.x1[i], properties.y1[i], properties.z1[i]},
+		                 {properties.x2[i], properties.y2[i], properties.z2[i]}};
+		projValues[i] = forwardProjection2D(
+		    img, lor, hasKernels ? properties.psfKernel[i] : nullptr, slice);
+	}
+}
+
+void OperatorProjectorSiddon::backProjection2DBatch(
+    Image* img, const ProjectionPropertiesBatch& properties, int slice,
+    const float* projValues) const
+{
+	const bool hasKernels = !properties.psfKernel.empty();
+	for (size_t i = 0; i < properties.size(); i++)
+	{
+		if (projValues[i] == 0.0f)
+		{
+			continue;
+		}
+		const Line3D lor{{properties.x1[i], properties.y1[i], properties.z1[i]},
+		                 {properties.x2[i], properties.y2[i], properties.z2[i]}};
+		backProjection2D(img, lor,
+		                 hasKernels ? properties.psfKernel[i] : nullptr, slice,
+		                 projValues[i]);
+	}
+}
+
+float OperatorProjectorSiddon::forwardProjection2D(const Image* img,
+                                                   const Line3D& lor,
+                                                   const float* psfKernel,
+                                                   int slice) const
+{
+	const ImageParams& params = img->getParams();
+	const Vector3D offsetVec = {params.off_x, params.off_y, params.off_z};
+	Line3D ray = lor;
+	ray.point1 = ray.point1 - offsetVec;
+	ray.point2 = ray.point2 - offsetVec;
+	psfKernel = getPsfKernel(lor, offsetVec, psfKernel, false);
+
+	float imProj = 0.0f;
+	// The PSF rays are shifted transaxially, so they stay in the slice
+	forEachPsfRay(ray, psfKernel, false,
+	              [&](const Line3D& psfRay, float weight)
+	              {
+		              float rayProj;
+		              project_helper_2D<true>(const_cast<Image*>(img), psfRay,
+		                                      slice, rayProj);
+		              imProj += weight * rayProj;
+	              });
+	return imProj;
+}
+
+void OperatorProjectorSiddon::backProjection2D(Image* img, const Line3D& lor,
+                                               const float* psfKernel,
+                                               int slice,
+                                               float projValue) const
+{
+	const ImageParams& params = img->getParams();
+	const Vector3D offsetVec = {params.off_x, params.off_y, params.off_z};
+	Line3D ray = lor;
+	ray.point1 = ray.point1 - offsetVec;
+	ray.point2 = ray.point2 - offsetVec;
+	psfKernel = getPsfKernel(lor, offsetVec, psfKernel, true);
+
+	forEachPsfRay(ray, psfKernel, true,
+	              [&](const Line3D& psfRay, float weight)
+	              {
+		              float projValuePerRay = weight * projValue;
+		              project_helper_2D<false>(img, psfRay, slice,
+		                                       projValuePerRay);
+	              });
 }
 
 float OperatorProjectorSiddon::singleForwardProjection(
@@ -236,271 +580,343 @@ enum SIDDON_DIR
 // care.  Speedups around 20% were measured with FLAG_INCR=true.  Both versions
 // are compared in tests, the "faster" version (FLAG_INCR=true) is used by
 // default.
-template <bool IS_FWD, bool FLAG_INCR, bool FLAG_TOF>
-void OperatorProjectorSiddon::project_helper(
-    Image* img, const Line3D& lor, float& value,
-    const TimeOfFlightHelper* tofHelper, float tofValue)
+namespace
 {
-	if (IS_FWD)
+	// Traversal of the voxels crossed by the LOR. For every segment of the
+	// LOR in a voxel, calls func(voxelPtr, a_cur, a_next, d_norm) where a_cur
+	// and a_next are the ray parameters at the ends of the segment. If a TOF
+	// helper is given, the traversal is restricted to the TOF kernel's range
+	template <bool FLAG_INCR, typename SegmentFunc>
+	void siddonTraversal(const ImageParams& params, float* raw_img_ptr,
+	                     const Line3D& lor,
+	                     const TimeOfFlightHelper* tofRangeHelper,
+	                     float tofValue, SegmentFunc&& func)
 	{
-		value = 0.0;
-	}
-
-	ImageParams params = img->getParams();
-
-	const Vector3D& p1 = lor.point1;
-	const Vector3D& p2 = lor.point2;
-	// 1. Intersection with FOV
-	float t0;
-	float t1;
-	// Intersection with (centered) FOV cylinder
-	float A = (p2.x - p1.x) * (p2.x - p1.x) + (p2.y - p1.y) * (p2.y - p1.y);
-	float B = 2.0 * ((p2.x - p1.x) * p1.x + (p2.y - p1.y) * p1.y);
-	float C = p1.x * p1.x + p1.y * p1.y - params.fovRadius * params.fovRadius;
-	float Delta = B * B - 4 * A * C;
-	if (A != 0.0)
-	{
-		if (Delta <= 0.0)
+		const Vector3D& p1 = lor.point1;
+		const Vector3D& p2 = lor.point2;
+		// 1. Intersection with FOV
+		float t0;
+		float t1;
+		// Intersection with (centered) FOV cylinder
+		float A = (p2.x - p1.x) * (p2.x - p1.x) + (p2.y - p1.y) * (p2.y - p1.y);
+		float B = 2.0 * ((p2.x - p1.x) * p1.x + (p2.y - p1.y) * p1.y);
+		float C =
+		    p1.x * p1.x + p1.y * p1.y - params.fovRadius * params.fovRadius;
+		float Delta = B * B - 4 * A * C;
+		if (A != 0.0)
 		{
-			t0 = 1.0;
-			t1 = 0.0;
-			return;
+			if (Delta <= 0.0)
+			{
+				t0 = 1.0;
+				t1 = 0.0;
+				return;
+			}
+			t0 = (-B - sqrt(Delta)) / (2 * A);
+			t1 = (-B + sqrt(Delta)) / (2 * A);
 		}
-		t0 = (-B - sqrt(Delta)) / (2 * A);
-		t1 = (-B + sqrt(Delta)) / (2 * A);
-	}
-	else
-	{
-		t0 = 0.0;
-		t1 = 1.0;
-	}
-
-	float d_norm = (p1 - p2).getNorm();
-	bool flat_x = (p1.x == p2.x);
-	bool flat_y = (p1.y == p2.y);
-	bool flat_z = (p1.z == p2.z);
-	float inv_p12_x = flat_x ? 0.0 : 1 / (p2.x - p1.x);
-	float inv_p12_y = flat_y ? 0.0 : 1 / (p2.y - p1.y);
-	float inv_p12_z = flat_z ? 0.0 : 1 / (p2.z - p1.z);
-	int dir_x = (inv_p12_x >= 0.0) ? 1 : -1;
-	int dir_y = (inv_p12_y >= 0.0) ? 1 : -1;
-	int dir_z = (inv_p12_z >= 0.0) ? 1 : -1;
-
-	// 2. Intersection with volume
-	float dx = params.vx;
-	float dy = params.vy;
-	float dz = params.vz;
-	float inv_dx = 1.0 / dx;
-	float inv_dy = 1.0 / dy;
-	float inv_dz = 1.0 / dz;
-
-	float x0 = -params.length_x * 0.5f;
-	float x1 = params.length_x * 0.5f;
-	float y0 = -params.length_y * 0.5f;
-	float y1 = params.length_y * 0.5f;
-	float z0 = -params.length_z * 0.5f;
-	float z1 = params.length_z * 0.5f;
-	float ax_min, ax_max, ay_min, ay_max, az_min, az_max;
-	Util::get_alpha(-0.5f * params.length_x, 0.5f * params.length_x, p1.x, p2.x,
-	                inv_p12_x, ax_min, ax_max);
-	Util::get_alpha(-0.5f * params.length_y, 0.5f * params.length_y, p1.y, p2.y,
-	                inv_p12_y, ay_min, ay_max);
-	Util::get_alpha(-0.5f * params.length_z, 0.5f * params.length_z, p1.z, p2.z,
-	                inv_p12_z, az_min, az_max);
-	float amin = std::max({0.0f, t0, ax_min, ay_min, az_min});
-	float amax = std::min({1.0f, t1, ax_max, ay_max, az_max});
-	if (FLAG_TOF)
-	{
-		float amin_tof, amax_tof;
-		tofHelper->getAlphaRange(amin_tof, amax_tof, d_norm, tofValue);
-		amin = std::max(amin, amin_tof);
-		amax = std::min(amax, amax_tof);
-	}
-
-	float a_cur = amin;
-	float a_next = -1.0f;
-	float x_cur = (inv_p12_x > 0.0f) ? x0 : x1;
-	float y_cur = (inv_p12_y > 0.0f) ? y0 : y1;
-	float z_cur = (inv_p12_z > 0.0f) ? z0 : z1;
-	if ((inv_p12_x >= 0.0f && p1.x > x1) || (inv_p12_x < 0.0f && p1.x < x0) ||
-	    (inv_p12_y >= 0.0f && p1.y > y1) || (inv_p12_y < 0.0f && p1.y < y0) ||
-	    (inv_p12_z >= 0.0f && p1.z > z1) || (inv_p12_z < 0.0f && p1.z < z0))
-	{
-		return;
-	}
-	// Move starting point inside FOV
-	float ax_next = flat_x ? std::numeric_limits<float>::max() : ax_min;
-	if (!flat_x)
-	{
-		int kx = (int)ceil(dir_x * (a_cur * (p2.x - p1.x) - x_cur + p1.x) / dx);
-		x_cur += kx * dir_x * dx;
-		ax_next = (x_cur - p1.x) * inv_p12_x;
-	}
-	float ay_next = flat_y ? std::numeric_limits<float>::max() : ay_min;
-	if (!flat_y)
-	{
-		int ky = (int)ceil(dir_y * (a_cur * (p2.y - p1.y) - y_cur + p1.y) / dy);
-		y_cur += ky * dir_y * dy;
-		ay_next = (y_cur - p1.y) * inv_p12_y;
-	}
-	float az_next = flat_z ? std::numeric_limits<float>::max() : az_min;
-	if (!flat_z)
-	{
-		int kz = (int)ceil(dir_z * (a_cur * (p2.z - p1.z) - z_cur + p1.z) / dz);
-		z_cur += kz * dir_z * dz;
-		az_next = (z_cur - p1.z) * inv_p12_z;
-	}
-	// Pixel location (move pixel to pixel instead of calculating position for
-	// each intersection)
-	bool flag_first = true;
-	int vx = -1;
-	int vy = -1;
-	int vz = -1;
-	// The dir variables operate as binary bit-flags to determine in which
-	// direction the current pixel should move: format 0bzyx (where z, y and x
-	// are bits set to 1 when the pixel should move in the corresponding
-	// direction, e.g. 0b101 moves in the z and x directions)
-	short dir_prev = -1;
-	short dir_next = -1;
-
-	// Prepare data pointer (this assumes that the data is stored as a
-	// contiguous array)
-	float* raw_img_ptr = img->getRawPointer();
-	float* cur_img_ptr = nullptr;
-	int num_x = params.nx;
-	int num_xy = params.nx * params.ny;
-
-	float ax_next_prev = ax_next;
-	float ay_next_prev = ay_next;
-	float az_next_prev = az_next;
-
-	// 3. Integrate along ray
-	bool flag_done = false;
-	while (a_cur < amax && !flag_done)
-	{
-		// Find next intersection (along x, y or z)
-		dir_next = 0b000;
-		if (ax_next_prev <= ay_next_prev && ax_next_prev <= az_next_prev)
+		else
 		{
-			a_next = ax_next;
-			x_cur += dir_x * dx;
-			ax_next = (x_cur - p1.x) * inv_p12_x;
-			dir_next |= SIDDON_DIR::DIR_X;
+			t0 = 0.0;
+			t1 = 1.0;
 		}
-		if (ay_next_prev <= ax_next_prev && ay_next_prev <= az_next_prev)
+
+		float d_norm = (p1 - p2).getNorm();
+		bool flat_x = (p1.x == p2.x);
+		bool flat_y = (p1.y == p2.y);
+		bool flat_z = (p1.z == p2.z);
+		float inv_p12_x = flat_x ? 0.0 : 1 / (p2.x - p1.x);
+		float inv_p12_y = flat_y ? 0.0 : 1 / (p2.y - p1.y);
+		float inv_p12_z = flat_z ? 0.0 : 1 / (p2.z - p1.z);
+		int dir_x = (inv_p12_x >= 0.0) ? 1 : -1;
+		int dir_y = (inv_p12_y >= 0.0) ? 1 : -1;
+		int dir_z = (inv_p12_z >= 0.0) ? 1 : -1;
+
+		// 2. Intersection with volume
+		float dx = params.vx;
+		float dy = params.vy;
+		float dz = params.vz;
+		float inv_dx = 1.0 / dx;
+		float inv_dy = 1.0 / dy;
+		float inv_dz = 1.0 / dz;
+
+		float x0 = -params.length_x * 0.5f;
+		float x1 = params.length_x * 0.5f;
+		float y0 = -params.length_y * 0.5f;
+		float y1 = params.length_y * 0.5f;
+		float z0 = -params.length_z * 0.5f;
+		float z1 = params.length_z * 0.5f;
+		float ax_min, ax_max, ay_min, ay_max, az_min, az_max;
+		Util::get_alpha(-0.5f * params.length_x, 0.5f * params.length_x, p1.x,
+		                p2.x, inv_p12_x, ax_min, ax_max);
+		Util::get_alpha(-0.5f * params.length_y, 0.5f * params.length_y, p1.y,
+		                p2.y, inv_p12_y, ay_min, ay_max);
+		Util::get_alpha(-0.5f * params.length_z, 0.5f * params.length_z, p1.z,
+		                p2.z, inv_p12_z, az_min, az_max);
+		float amin = std::max({0.0f, t0, ax_min, ay_min, az_min});
+		float amax = std::min({1.0f, t1, ax_max, ay_max, az_max});
+		if (tofRangeHelper != nullptr)
 		{
-			a_next = ay_next;
-			y_cur += dir_y * dy;
-			ay_next = (y_cur - p1.y) * inv_p12_y;
-			dir_next |= SIDDON_DIR::DIR_Y;
+			float amin_tof, amax_tof;
+			tofRangeHelper->getAlphaRange(amin_tof, amax_tof, d_norm, tofValue);
+			amin = std::max(amin, amin_tof);
+			amax = std::min(amax, amax_tof);
 		}
-		if (az_next_prev <= ax_next_prev && az_next_prev <= ay_next_prev)
+
+		float a_cur = amin;
+		float a_next = -1.0f;
+		float x_cur = (inv_p12_x > 0.0f) ? x0 : x1;
+		float y_cur = (inv_p12_y > 0.0f) ? y0 : y1;
+		float z_cur = (inv_p12_z > 0.0f) ? z0 : z1;
+		if ((inv_p12_x >= 0.0f && p1.x > x1) ||
+		    (inv_p12_x < 0.0f && p1.x < x0) ||
+		    (inv_p12_y >= 0.0f && p1.y > y1) ||
+		    (inv_p12_y < 0.0f && p1.y < y0) ||
+		    (inv_p12_z >= 0.0f && p1.z > z1) ||
+		    (inv_p12_z < 0.0f && p1.z < z0))
 		{
-			a_next = az_next;
-			z_cur += dir_z * dz;
-			az_next = (z_cur - p1.z) * inv_p12_z;
-			dir_next |= SIDDON_DIR::DIR_Z;
+			return;
 		}
-		// Clip to FOV range
-		if (a_next > amax)
+		// Move starting point inside FOV
+		float ax_next = flat_x ? std::numeric_limits<float>::max() : ax_min;
+		if (!flat_x)
 		{
-			a_next = amax;
+			int kx = (int)ceil(
+			    dir_x * (a_cur * (p2.x - p1.x) - x_cur + p1.x) / dx);
+			x_cur += kx * dir_x * dx;
+			ax_next = (x_cur - p1.x) * inv_p12_x;
 		}
-		if (a_cur >= a_next)
+		float ay_next = flat_y ? std::numeric_limits<float>::max() : ay_min;
+		if (!flat_y)
 		{
-			ax_next_prev = ax_next;
-			ay_next_prev = ay_next;
-			az_next_prev = az_next;
-			continue;
+			int ky = (int)ceil(
+			    dir_y * (a_cur * (p2.y - p1.y) - y_cur + p1.y) / dy);
+			y_cur += ky * dir_y * dy;
+			ay_next = (y_cur - p1.y) * inv_p12_y;
 		}
-		// Determine pixel location
-		float tof_weight = 1.f;
-		float a_mid = 0.5 * (a_cur + a_next);
-		if (FLAG_TOF)
+		float az_next = flat_z ? std::numeric_limits<float>::max() : az_min;
+		if (!flat_z)
 		{
-			tof_weight = tofHelper->getWeight(d_norm, tofValue, a_cur * d_norm,
-			                                  a_next * d_norm);
+			int kz = (int)ceil(
+			    dir_z * (a_cur * (p2.z - p1.z) - z_cur + p1.z) / dz);
+			z_cur += kz * dir_z * dz;
+			az_next = (z_cur - p1.z) * inv_p12_z;
 		}
-		if (!FLAG_INCR || flag_first)
+		// Pixel location (move pixel to pixel instead of calculating position
+		// for each intersection)
+		bool flag_first = true;
+		int vx = -1;
+		int vy = -1;
+		int vz = -1;
+		// The dir variables operate as binary bit-flags to determine in which
+		// direction the current pixel should move: format 0bzyx (where z, y and
+		// x are bits set to 1 when the pixel should move in the corresponding
+		// direction, e.g. 0b101 moves in the z and x directions)
+		short dir_prev = -1;
+		short dir_next = -1;
+
+		// Prepare data pointer (this assumes that the data is stored as a
+		// contiguous array)
+		float* cur_img_ptr = nullptr;
+		int num_x = params.nx;
+		int num_xy = params.nx * params.ny;
+
+		float ax_next_prev = ax_next;
+		float ay_next_prev = ay_next;
+		float az_next_prev = az_next;
+
+		// 3. Integrate along ray
+		bool flag_done = false;
+		while (a_cur < amax && !flag_done)
 		{
-			vx = (int)((p1.x + a_mid * (p2.x - p1.x) + params.length_x / 2) *
-			           inv_dx);
-			vy = (int)((p1.y + a_mid * (p2.y - p1.y) + params.length_y / 2) *
-			           inv_dy);
-			vz = (int)((p1.z + a_mid * (p2.z - p1.z) + params.length_z / 2) *
-			           inv_dz);
-			cur_img_ptr = raw_img_ptr + vz * num_xy + vy * num_x;
-			flag_first = false;
-			if (vx < 0 || vx >= params.nx || vy < 0 || vy >= params.ny ||
-			    vz < 0 || vz >= params.nz)
+			// Find next intersection (along x, y or z)
+			dir_next = 0b000;
+			if (ax_next_prev <= ay_next_prev && ax_next_prev <= az_next_prev)
 			{
-				flag_done = true;
+				a_next = ax_next;
+				x_cur += dir_x * dx;
+				ax_next = (x_cur - p1.x) * inv_p12_x;
+				dir_next |= SIDDON_DIR::DIR_X;
 			}
-		}
-		else
-		{
-			if (dir_prev & SIDDON_DIR::DIR_X)
+			if (ay_next_prev <= ax_next_prev && ay_next_prev <= az_next_prev)
 			{
-				vx += dir_x;
-				if (vx < 0 || vx >= params.nx)
-				{
-					flag_done = true;
-				}
+				a_next = ay_next;
+				y_cur += dir_y * dy;
+				ay_next = (y_cur - p1.y) * inv_p12_y;
+				dir_next |= SIDDON_DIR::DIR_Y;
+			}
+			if (az_next_prev <= ax_next_prev && az_next_prev <= ay_next_prev)
+			{
+				a_next = az_next;
+				z_cur += dir_z * dz;
+				az_next = (z_cur - p1.z) * inv_p12_z;
+				dir_next |= SIDDON_DIR::DIR_Z;
 			}
-			if (dir_prev & SIDDON_DIR::DIR_Y)
+			// Clip to FOV range
+			if (a_next > amax)
 			{
-				vy += dir_y;
-				if (vy < 0 || vy >= params.ny)
+				a_next = amax;
+			}
+			if (a_cur >= a_next)
+			{
+				ax_next_prev = ax_next;
+				ay_next_prev = ay_next;
+				az_next_prev = az_next;
+				continue;
+			}
+			// Determine pixel location
+			float a_mid = 0.5 * (a_cur + a_next);
+			if (!FLAG_INCR || flag_first)
+			{
+				vx = (int)((p1.x + a_mid * (p2.x - p1.x) +
+				            params.length_x / 2) *
+				           inv_dx);
+				vy = (int)((p1.y + a_mid * (p2.y - p1.y) +
+				            params.length_y / 2) *
+				           inv_dy);
+				vz = (int)((p1.z + a_mid * (p2.z - p1.z) +
+				            params.length_z / 2) *
+				           inv_dz);
+				cur_img_ptr = raw_img_ptr + vz * num_xy + vy * num_x;
+				flag_first = false;
+				if (vx < 0 || vx >= params.nx || vy < 0 || vy >= params.ny ||
+				    vz < 0 || vz >= params.nz)
 				{
 					flag_done = true;
 				}
-				else
-				{
-					cur_img_ptr += dir_y * num_x;
-				}
 			}
-			if (dir_prev & SIDDON_DIR::DIR_Z)
+			else
 			{
-				vz += dir_z;
-				if (vz < 0 || vz >= params.nz)
+				if (dir_prev & SIDDON_DIR::DIR_X)
 				{
-					flag_done = true;
+					vx += dir_x;
+					if (vx < 0 || vx >= params.nx)
+					{
+						flag_done = true;
+					}
+				}
+				if (dir_prev & SIDDON_DIR::DIR_Y)
+				{
+					vy += dir_y;
+					if (vy < 0 || vy >= params.ny)
+					{
+						flag_done = true;
+					}
+					else
+					{
+						cur_img_ptr += dir_y * num_x;
+					}
 				}
-				else
+				if (dir_prev & SIDDON_DIR::DIR_Z)
 				{
-					cur_img_ptr += dir_z * num_xy;
+					vz += dir_z;
+					if (vz < 0 || vz >= params.nz)
+					{
+						flag_done = true;
+					}
+					else
+					{
+						cur_img_ptr += dir_z * num_xy;
+					}
 				}
 			}
+			if (flag_done)
+			{
+				continue;
+			}
+			dir_prev = dir_next;
+			func(&cur_img_ptr[vx], a_cur, a_next, d_norm);
+			a_cur = a_next;
+			ax_next_prev = ax_next;
+			ay_next_prev = ay_next;
+			az_next_prev = az_next;
 		}
-		if (flag_done)
-		{
-			continue;
-		}
-		dir_prev = dir_next;
-		float weight = (a_next - a_cur) * d_norm;
-		if (FLAG_TOF)
-		{
-			weight *= tof_weight;
-		}
-		if (IS_FWD)
-		{
-			value += weight * cur_img_ptr[vx];
-		}
-		else
-		{
-			float output = value * weight;
-			float* ptr = &cur_img_ptr[vx];
+	}
+}  // namespace
+
+template <bool IS_FWD, bool FLAG_INCR, bool FLAG_TOF>
+void OperatorProjectorSiddon::project_helper(
+    Image* img, const Line3D& lor, float& value,
+    const TimeOfFlightHelper* tofHelper, float tofValue)
+{
+	if (IS_FWD)
+	{
+		value = 0.0;
+	}
+
+	siddonTraversal<FLAG_INCR>(
+	    img->getParams(), img->getRawPointer(), lor,
+	    FLAG_TOF ? tofHelper : nullptr, tofValue,
+	    [&value, tofHelper, tofValue](float* ptr, float a_cur, float a_next,
+	                                  float d_norm)
+	    {
+		    float weight = (a_next - a_cur) * d_norm;
+		    if (FLAG_TOF)
+		    {
+			    weight *= tofHelper->getWeight(d_norm, tofValue, a_cur * d_norm,
+			                                   a_next * d_norm);
+		    }
+		    if (IS_FWD)
+		    {
+			    value += weight * (*ptr);
+		    }
+		    else
+		    {
+			    float output = value * weight;
 #pragma omp atomic
-			*ptr += output;
-		}
-		a_cur = a_next;
-		ax_next_prev = ax_next;
-		ay_next_prev = ay_next;
-		az_next_prev = az_next;
+			    *ptr += output;
+		    }
+	    });
+}
+
+template <bool IS_FWD, bool FLAG_INCR>
+void OperatorProjectorSiddon::project_helper_TOFBins(
+    Image* img, const Line3D& lor, float* values, int numTOFBins,
+    float tofBinWidth_ps, const TimeOfFlightHelper* tofHelper)
+{
+	if (IS_FWD)
+	{
+		std::fill(values, values + numTOFBins, 0.0f);
 	}
+
+	float tofWeights[TimeOfFlightHelper::MaxNumTOFBins];
+	siddonTraversal<FLAG_INCR>(
+	    img->getParams(), img->getRawPointer(), lor, nullptr, 0.0f,
+	    [values, numTOFBins, tofBinWidth_ps, tofHelper,
+	     &tofWeights](float* ptr, float a_cur, float a_next, float d_norm)
+	    {
+		    // The TOF kernel is evaluated at the middle of the segment
+		    tofHelper->getTOFBinWeights(d_norm,
+		                                0.5f * (a_cur + a_next) * d_norm,
+		                                numTOFBins, tofBinWidth_ps, tofWeights);
+		    const float length = (a_next - a_cur) * d_norm;
+		    if (IS_FWD)
+		    {
+			    const float lengthTimesImg = length * (*ptr);
+			    for (int t = 0; t < numTOFBins; t++)
+			    {
+				    values[t] += tofWeights[t] * lengthTimesImg;
+			    }
+		    }
+		    else
+		    {
+			    float output = 0.0f;
+			    for (int t = 0; t < numTOFBins; t++)
+			    {
+				    output += tofWeights[t] * values[t];
+			    }
+			    output *= length;
+#pragma omp atomic
+			    *ptr += output;
+		    }
+	    });
 }
 
 
+template void OperatorProjectorSiddon::project_helper_TOFBins<true, false>(
+    Image*, const Line3D&, float*, int, float, const TimeOfFlightHelper*);
+template void OperatorProjectorSiddon::project_helper_TOFBins<false, false>(
+    Image*, const Line3D&, float*, int, float, const TimeOfFlightHelper*);
+
 // Explicit instantiation of slow version used in tests
 template void OperatorProjectorSiddon::project_helper<true, false, true>(
     Image* img, const Line3D&, float&, const TimeOfFlightHelper*, float);
@@ -510,3 +926,121 @@ template void OperatorProjectorSiddon::project_helper<true, false, false>(
     Image* img, const Line3D&, float&, const TimeOfFlightHelper*, float);
 template void OperatorProjectorSiddon::project_helper<false, false, false>(
     Image* img, const Line3D&, float&, const TimeOfFlightHelper*, float);
+
+template <bool IS_FWD>
+void OperatorProjectorSiddon::project_helper_2D(Image* img, const Line3D& lor,
+                                                int slice, float& value)
+{
+	if (IS_FWD)
+	{
+		value = 0.0f;
+	}
+
+	const ImageParams& params = img->getParams();
+	const Vector3D& p1 = lor.point1;
+	const Vector3D& p2 = lor.point2;
+	const float p12_x = p2.x - p1.x;
+	const float p12_y = p2.y - p1.y;
+
+	// 1. Intersection with the (centered) FOV cylinder
+	const float A = p12_x * p12_x + p12_y * p12_y;
+	if (A == 0.0f)
+	{
+		return;
+	}
+	const float B = 2.0f * (p12_x * p1.x + p12_y * p1.y);
+	const float C =
+	    p1.x * p1.x + p1.y * p1.y - params.fovRadius * params.fovRadius;
+	const float Delta = B * B - 4 * A * C;
+	if (Delta <= 0.0f)
+	{
+		return;
+	}
+	const float t0 = (-B - std::sqrt(Delta)) / (2 * A);
+	const float t1 = (-B + std::sqrt(Delta)) / (2 * A);
+
+	// 2. Intersection with the slice
+	const float inv_p12_x = (p12_x == 0.0f) ? 0.0f : 1.0f / p12_x;
+	const float inv_p12_y = (p12_y == 0.0f) ? 0.0f : 1.0f / p12_y;
+	const float x0 = -0.5f * params.length_x;
+	const float y0 = -0.5f * params.length_y;
+	float ax_min, ax_max, ay_min, ay_max;
+	Util::get_alpha(x0, -x0, p1.x, p2.x, inv_p12_x, ax_min, ax_max);
+	Util::get_alpha(y0, -y0, p1.y, p2.y, inv_p12_y, ay_min, ay_max);
+	const float amin = std::max({0.0f, t0, ax_min, ay_min});
+	const float amax = std::min({1.0f, t1, ax_max, ay_max});
+	if (amin >= amax)
+	{
+		return;
+	}
+
+	// 3. First pixel, taken slightly after the entry point to avoid
+	// ambiguities on the pixel boundaries
+	const float d_norm = std::sqrt(A);
+	const float a_start = amin + 1e-4f * (amax - amin);
+	int vx = std::clamp(static_cast<int>(std::floor(
+	                        (p1.x + a_start * p12_x - x0) / params.vx)),
+	                    0, params.nx - 1);
+	int vy = std::clamp(static_cast<int>(std::floor(
+	                        (p1.y + a_start * p12_y - y0) / params.vy)),
+	                    0, params.ny - 1);
+	const int dir_x = (p12_x >= 0.0f) ? 1 : -1;
+	const int dir_y = (p12_y >= 0.0f) ? 1 : -1;
+	float ax_next = std::numeric_limits<float>::max();
+	float ax_step = 0.0f;
+	if (p12_x != 0.0f)
+	{
+		ax_next =
+		    (x0 + (vx + (dir_x > 0 ? 1 : 0)) * params.vx - p1.x) * inv_p12_x;
+		ax_step = params.vx * std::abs(inv_p12_x);
+	}
+	float ay_next = std::numeric_limits<float>::max();
+	float ay_step = 0.0f;
+	if (p12_y != 0.0f)
+	{
+		ay_next =
+		    (y0 + (vy + (dir_y > 0 ? 1 : 0)) * params.vy - p1.y) * inv_p12_y;
+		ay_step = params.vy * std::abs(inv_p12_y);
+	}
+
+	// 4. Integrate along the ray, pixel to pixel
+	const size_t num_xy = params.nx * params.ny;
+	float* slicePtr = img->getRawPointer() + slice * num_xy;
+	float a_cur = amin;
+	while (a_cur < amax)
+	{
+		if (vx < 0 || vx >= params.nx || vy < 0 || vy >= params.ny)
+		{
+			break;
+		}
+		const float a_next = std::min({ax_next, ay_next, amax});
+		const float weight = std::max(0.0f, a_next - a_cur) * d_norm;
+		float* ptr = slicePtr + vy * params.nx + vx;
+		if (IS_FWD)
+		{
+			value += weight * (*ptr);
+		}
+		else
+		{
+			*ptr += value * weight;
+		}
+		if (ax_next <= ay_next)
+		{
+			vx += dir_x;
+			ax_next += ax_step;
+		}
+		else
+		{
+			vy += dir_y;
+			ay_next += ay_step;
+		}
+		a_cur = std::max(a_cur, a_next);
+	}
+}
+
+template void OperatorProjectorSiddon::project_helper_2D<true>(Image*,
+                                                               const Line3D&,
+                                                               int, float&);
+template void OperatorProjectorSiddon::project_helper_2D<false>(Image*,
+                                                                const Line3D&,
+                                                                int, float&);
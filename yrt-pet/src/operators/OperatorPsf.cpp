@@ -6,8 +6,13 @@
 #include "operators/OperatorPsf.hpp"
 
 #include "utils/Assert.hpp"
+#include "utils/FFT.hpp"
 #include "utils/Tools.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
 #if BUILD_PYBIND11
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
@@ -20,6 +25,11 @@ void py_setup_operatorpsf(py::module& m)
 	c.def(py::init<const std::string&>());
 	c.def("readFromFile", &OperatorPsf::readFromFile);
 	c.def("convolve", &OperatorPsf::convolve);
+	c.def("setConvolutionMethod", &OperatorPsf::setConvolutionMethod,
+	      py::arg("method"));
+	c.def("getConvolutionMethod", &OperatorPsf::getConvolutionMethod);
+	c.def_static("isFFTFaster", &OperatorPsf::isFFTFaster,
+	             py::arg("kernelSize"), py::arg("n"));
 	c.def(
 	    "applyA", [](OperatorPsf& self, const Image* img_in, Image* img_out)
 	    { self.applyA(img_in, img_out); }, py::arg("img_in"),
@@ -28,10 +38,185 @@ void py_setup_operatorpsf(py::module& m)
 	    "applyAH", [](OperatorPsf& self, const Image* img_in, Image* img_out)
 	    { self.applyAH(img_in, img_out); }, py::arg("img_in"),
 	    py::arg("img_out"));
+
+	py::enum_<OperatorPsf::ConvolutionMethod>(c, "ConvolutionMethod")
+	    .value("AUTO", OperatorPsf::ConvolutionMethod::AUTO)
+	    .value("DIRECT", OperatorPsf::ConvolutionMethod::DIRECT)
+	    .value("FFT", OperatorPsf::ConvolutionMethod::FFT)
+	    .export_values();
 }
 #endif
 
-OperatorPsf::OperatorPsf() : Operator{} {}
+namespace
+{
+	// Index in [0, n) with periodic boundaries
+	inline int wrap(int x, int n)
+	{
+		x %= n;
+		return (x < 0) ? x + n : x;
+	}
+
+	// Convolution of every row of length nx (contiguous). The row is copied
+	// with its periodic padding into a per-thread buffer, so in and out can
+	// be the same
+	void convolveRowsDirect(const float* in, float* out, int nx, int numRows,
+	                        const std::vector<float>& kernel)
+	{
+		const int kerSize = static_cast<int>(kernel.size());
+		const int kerIndexCentered = kerSize / 2;
+		const float* kernelPtr = kernel.data();
+
+#pragma omp parallel default(none) \
+    firstprivate(in, out, nx, numRows, kerSize, kerIndexCentered, kernelPtr)
+		{
+			std::vector<float> line(nx + 2 * kerIndexCentered);
+			float* linePtr = line.data();
+
+#pragma omp for
+			for (int row = 0; row < numRows; row++)
+			{
+				const float* inRow = in + static_cast<size_t>(row) * nx;
+				float* outRow = out + static_cast<size_t>(row) * nx;
+
+				// line[p] = inRow[p - kerIndexCentered]
+				for (int p = 0; p < nx + 2 * kerIndexCentered; p++)
+				{
+					linePtr[p] = inRow[wrap(p - kerIndexCentered, nx)];
+				}
+
+				// outRow[i] = sum_kk kernel[kk + c] * inRow[i - kk]
+				for (int i = 0; i < nx; i++)
+				{
+					outRow[i] = 0.0f;
+				}
+				for (int t = 0; t < kerSize; t++)
+				{
+					const float weight = kernelPtr[t];
+					const float* src = linePtr + 2 * kerIndexCentered - t;
+#pragma omp simd
+					for (int i = 0; i < nx; i++)
+					{
+						outRow[i] += weight * src[i];
+					}
+				}
+			}
+		}
+	}
+
+	// Convolution along the middle dimension of an array of shape
+	// [numOuter][n][stride]. Every output row is accumulated from the input
+	// rows, vectorized along the contiguous dimension, by blocks small
+	// enough to stay in the cache. in and out have to be different
+	void convolvePlanesDirect(const float* in, float* out, int numOuter, int n,
+	                          size_t stride, const std::vector<float>& kernel)
+	{
+		constexpr size_t BlockSize = 1024;
+		const int kerSize = static_cast<int>(kernel.size());
+		const int kerIndexCentered = kerSize / 2;
+		const float* kernelPtr = kernel.data();
+		const int numBlocks =
+		    static_cast<int>((stride + BlockSize - 1) / BlockSize);
+
+#pragma omp parallel for collapse(3) default(none)                          \
+    firstprivate(in, out, numOuter, n, stride, kerSize, kerIndexCentered, \
+                     kernelPtr, numBlocks, BlockSize)
+		for (int o = 0; o < numOuter; o++)
+		{
+			for (int j = 0; j < n; j++)
+			{
+				for (int b = 0; b < numBlocks; b++)
+				{
+					const size_t first = b * BlockSize;
+					const size_t length = std::min(BlockSize, stride - first);
+					float* dst =
+					    out + (static_cast<size_t>(o) * n + j) * stride + first;
+					for (size_t i = 0; i < length; i++)
+					{
+						dst[i] = 0.0f;
+					}
+					for (int t = 0; t < kerSize; t++)
+					{
+						const float weight = kernelPtr[t];
+						const int jSrc = wrap(j + kerIndexCentered - t, n);
+						const float* src =
+						    in + (static_cast<size_t>(o) * n + jSrc) * stride +
+						    first;
+#pragma omp simd
+						for (size_t i = 0; i < length; i++)
+						{
+							dst[i] += weight * src[i];
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Convolution along the middle dimension of an array of shape
+	// [numOuter][n][stride] through the FFT of length n (exact for periodic
+	// boundaries). Two real lines are transformed at once as the real and
+	// imaginary parts of a complex line. in and out can be the same
+	void convolveLinesFFT(const float* in, float* out, int numOuter, int n,
+	                      size_t stride, const std::vector<float>& kernel)
+	{
+		const Util::FFT1D fft{static_cast<size_t>(n)};
+
+		// Spectrum of the kernel wrapped on the line length
+		const int kerIndexCentered = static_cast<int>(kernel.size()) / 2;
+		std::vector<std::complex<float>> kernelFT(n, 0.0f);
+		for (int kk = -kerIndexCentered; kk <= kerIndexCentered; kk++)
+		{
+			kernelFT[wrap(kk, n)] += kernel[kk + kerIndexCentered];
+		}
+		fft.forward(kernelFT.data());
+
+		const size_t numLines = static_cast<size_t>(numOuter) * stride;
+		const long long numPairs = static_cast<long long>((numLines + 1) / 2);
+		const Util::FFT1D* fftPtr = &fft;
+		const std::complex<float>* kernelFTPtr = kernelFT.data();
+
+#pragma omp parallel default(none)                                     \
+    firstprivate(in, out, n, stride, numLines, numPairs, fftPtr, kernelFTPtr)
+		{
+			std::vector<std::complex<float>> line(n);
+			std::complex<float>* linePtr = line.data();
+
+#pragma omp for
+			for (long long pair = 0; pair < numPairs; pair++)
+			{
+				const size_t line0 = 2 * pair;
+				const bool hasSecond = line0 + 1 < numLines;
+				// First element of each line and step between its elements
+				const auto start = [n, stride](size_t lineIdx)
+				{ return (lineIdx / stride) * n * stride + lineIdx % stride; };
+				const size_t start0 = start(line0);
+				const size_t start1 = hasSecond ? start(line0 + 1) : 0;
+
+				for (int j = 0; j < n; j++)
+				{
+					const float im = hasSecond ? in[start1 + j * stride] : 0.0f;
+					linePtr[j] = {in[start0 + j * stride], im};
+				}
+				fftPtr->forward(linePtr);
+				for (int j = 0; j < n; j++)
+				{
+					linePtr[j] *= kernelFTPtr[j];
+				}
+				fftPtr->inverse(linePtr);
+				for (int j = 0; j < n; j++)
+				{
+					out[start0 + j * stride] = linePtr[j].real();
+					if (hasSecond)
+					{
+						out[start1 + j * stride] = linePtr[j].imag();
+					}
+				}
+			}
+		}
+	}
+}  // namespace
+
+OperatorPsf::OperatorPsf() : Operator{}, m_convolutionMethod{AUTO} {}
 
 OperatorPsf::OperatorPsf(const std::string& imageSpacePsf_fname) : OperatorPsf{}
 {
@@ -123,84 +308,82 @@ void OperatorPsf::convolve(const Image* in, Image* out,
 	const int ny = params.ny;
 	const int nz = params.nz;
 
-	const size_t sizeBuffer = std::max(std::max(nx, ny), nz);
-	m_buffer_tmp.resize(sizeBuffer);
+	ASSERT_MSG(kernelX.size() % 2 != 0, "Kernel size must be odd");
+	ASSERT_MSG(kernelY.size() % 2 != 0, "Kernel size must be odd");
+	ASSERT_MSG(kernelZ.size() % 2 != 0, "Kernel size must be odd");
 
-	const std::array<int, 3> kerSize{static_cast<int>(kernelX.size()),
-	                                 static_cast<int>(kernelY.size()),
-	                                 static_cast<int>(kernelZ.size())};
-	ASSERT_MSG(kerSize[0] % 2 != 0, "Kernel size must be odd");
-	ASSERT_MSG(kerSize[1] % 2 != 0, "Kernel size must be odd");
-	ASSERT_MSG(kerSize[2] % 2 != 0, "Kernel size must be odd");
-
-	// kernel size must always be an odd number and must have same size in all 3
-	// dimensions
-	const int kerIndexCenteredX = kerSize[0] / 2;
-	const int kerIndexCenteredY = kerSize[1] / 2;
-	const int kerIndexCenteredZ = kerSize[2] / 2;
 	const float* inPtr = in->getRawPointer();
 	float* outPtr = out->getRawPointer();
+	const size_t sliceSize = static_cast<size_t>(nx) * ny;
 
-	for (int k = 0; k < nz; k++)
+	// X: in -> out
+	if (useFFT(kernelX.size(), nx))
 	{
-		for (int j = 0; j < ny; j++)
-		{
-			for (int i = 0; i < nx; i++)
-			{
-				m_buffer_tmp[i] = inPtr[IDX3(i, j, k, nx, ny)];
-			}
-			for (int i = 0; i < nx; i++)
-			{
-				float sum = 0.0;
-				for (int kk = -kerIndexCenteredX; kk <= kerIndexCenteredX; kk++)
-				{
-					const int r = Util::circular(nx, i - kk);
-					sum += kernelX[kk + kerIndexCenteredX] * m_buffer_tmp[r];
-				}
-				outPtr[IDX3(i, j, k, nx, ny)] = sum;
-			}
-		}
+		convolveLinesFFT(inPtr, outPtr, ny * nz, nx, 1, kernelX);
+	}
+	else
+	{
+		convolveRowsDirect(inPtr, outPtr, nx, ny * nz, kernelX);
 	}
 
-	for (int k = 0; k < nz; k++)
+	// Y: out -> temporary, then Z: temporary -> out
+	std::vector<float> buffer(sliceSize * nz);
+	if (useFFT(kernelY.size(), ny))
 	{
-		for (int i = 0; i < nx; i++)
-		{
-			for (int j = 0; j < ny; j++)
-			{
-				m_buffer_tmp[j] = outPtr[IDX3(i, j, k, nx, ny)];
-			}
-			for (int j = 0; j < ny; j++)
-			{
-				float sum = 0.0;
-				for (int kk = -kerIndexCenteredY; kk <= kerIndexCenteredY; kk++)
-				{
-					const int r = Util::circular(ny, j - kk);
-					sum += kernelY[kk + kerIndexCenteredY] * m_buffer_tmp[r];
-				}
-				outPtr[IDX3(i, j, k, nx, ny)] = sum;
-			}
-		}
+		convolveLinesFFT(outPtr, buffer.data(), nz, ny, nx, kernelY);
+	}
+	else
+	{
+		convolvePlanesDirect(outPtr, buffer.data(), nz, ny, nx, kernelY);
 	}
+	if (useFFT(kernelZ.size(), nz))
+	{
+		convolveLinesFFT(buffer.data(), outPtr, 1, nz, sliceSize, kernelZ);
+	}
+	else
+	{
+		convolvePlanesDirect(buffer.data(), outPtr, 1, nz, sliceSize,
+		                     kernelZ);
+	}
+}
 
-	for (int i = 0; i < nx; i++)
+void OperatorPsf::setConvolutionMethod(ConvolutionMethod p_method)
+{
+	m_convolutionMethod = p_method;
+}
+
+OperatorPsf::ConvolutionMethod OperatorPsf::getConvolutionMethod() const
+{
+	return m_convolutionMethod;
+}
+
+bool OperatorPsf::isFFTFaster(size_t kernelSize, size_t n)
+{
+	// Direct: one multiply-add per tap. FFT: a forward and an inverse
+	// transform for two lines, about 10 operations per radix-2 butterfly, and
+	// three radix-2 transforms per transform for the lengths that are not a
+	// power of two (Bluestein)
+	const bool isPowerOfTwo = Util::FFT1D::isPowerOfTwo(n);
+	const size_t nRadix2 =
+	    isPowerOfTwo ? n : Util::FFT1D::nextPowerOfTwo(2 * n - 1);
+	const double numRadix2Transforms = isPowerOfTwo ? 1.0 : 3.0;
+	const double costDirect = 2.0 * static_cast<double>(kernelSize);
+	const double costFFT = 5.0 * numRadix2Transforms *
+	                       static_cast<double>(nRadix2) *
+	                       std::log2(static_cast<double>(nRadix2)) /
+	                       static_cast<double>(n);
+	return costFFT < costDirect;
+}
+
+bool OperatorPsf::useFFT(size_t kernelSize, size_t n) const
+{
+	if (kernelSize <= 1)
 	{
-		for (int j = 0; j < ny; j++)
-		{
-			for (int k = 0; k < nz; k++)
-			{
-				m_buffer_tmp[k] = outPtr[IDX3(i, j, k, nx, ny)];
-			}
-			for (int k = 0; k < nz; k++)
-			{
-				float sum = 0.0;
-				for (int kk = -kerIndexCenteredZ; kk <= kerIndexCenteredZ; kk++)
-				{
-					const int r = Util::circular(nz, k - kk);
-					sum += kernelZ[kk + kerIndexCenteredZ] * m_buffer_tmp[r];
-				}
-				outPtr[IDX3(i, j, k, nx, ny)] = sum;
-			}
-		}
+		return false;
+	}
+	if (m_convolutionMethod == AUTO)
+	{
+		return isFFTFaster(kernelSize, n);
 	}
+	return m_convolutionMethod == FFT;
 }
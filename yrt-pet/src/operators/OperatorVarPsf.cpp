@@ -0,0 +1,371 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "operators/OperatorVarPsf.hpp"
+
+#include "utils/Assert.hpp"
+#include "utils/Tools.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if BUILD_PYBIND11
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+namespace py = pybind11;
+
+void py_setup_operatorvarpsf(py::module& m)
+{
+	auto c = py::class_<OperatorVarPsf, OperatorPsf>(m, "OperatorVarPsf");
+	c.def(py::init<>());
+	c.def(py::init<const std::string&>());
+	c.def("readFromFile", &OperatorVarPsf::readFromFile);
+	c.def("getNumKernels", &OperatorVarPsf::getNumKernels);
+	c.def("getRadialPositions", &OperatorVarPsf::getRadialPositions);
+	c.def("getAxialPositions", &OperatorVarPsf::getAxialPositions);
+	c.def_static("computeInterpolationWeights",
+	             &OperatorVarPsf::computeInterpolationWeights,
+	             py::arg("nodes"), py::arg("positions"));
+	c.def(
+	    "applyA", [](OperatorVarPsf& self, const Image* img_in, Image* img_out)
+	    { self.applyA(img_in, img_out); }, py::arg("img_in"),
+	    py::arg("img_out"));
+	c.def(
+	    "applyAH", [](OperatorVarPsf& self, const Image* img_in, Image* img_out)
+	    { self.applyAH(img_in, img_out); }, py::arg("img_in"),
+	    py::arg("img_out"));
+}
+#endif
+
+namespace
+{
+	inline int wrap(int x, int n)
+	{
+		x %= n;
+		return (x < 0) ? x + n : x;
+	}
+
+	// Reads a kernel of the given size from a row of the CSV file
+	void readKernel(const Array2D<float>& kernelsArray2D, size_t row, int size,
+	                std::vector<float>& kernel,
+	                std::vector<float>& kernel_flipped)
+	{
+		ASSERT_MSG(size % 2 != 0, "Kernel size must be odd");
+		ASSERT_MSG(static_cast<size_t>(size) <= kernelsArray2D.getSize(1),
+		           "Kernel size larger than the number of values given");
+		kernel.resize(size);
+		kernel_flipped.resize(size);
+		for (int i = 0; i < size; i++)
+		{
+			kernel[i] = kernelsArray2D[row][i];
+			kernel_flipped[i] = kernelsArray2D[row][size - 1 - i];
+		}
+	}
+}  // namespace
+
+OperatorVarPsf::OperatorVarPsf() : OperatorPsf{} {}
+
+OperatorVarPsf::OperatorVarPsf(const std::string& imageSpaceVarPsf_fname)
+    : OperatorVarPsf{}
+{
+	readFromFileInternal(imageSpaceVarPsf_fname);
+}
+
+void OperatorVarPsf::readFromFile(const std::string& imageSpaceVarPsf_fname)
+{
+	readFromFileInternal(imageSpaceVarPsf_fname);
+}
+
+void OperatorVarPsf::readFromFileInternal(
+    const std::string& imageSpaceVarPsf_fname)
+{
+	Array2D<float> kernelsArray2D;
+	std::cout << "Reading spatially-variant image space PSF kernels csv file..."
+	          << std::endl;
+	Util::readCSV<float>(imageSpaceVarPsf_fname, kernelsArray2D);
+
+	ASSERT_MSG(kernelsArray2D.getSize(0) >= 3,
+	           "Missing the positions of the kernels");
+	const int numRadial = static_cast<int>(kernelsArray2D[2][0]);
+	const int numAxial = static_cast<int>(kernelsArray2D[2][1]);
+	ASSERT_MSG(numRadial > 0 && numAxial > 0,
+	           "There must be at least one radial and one axial position");
+	ASSERT_MSG(static_cast<size_t>(std::max(numRadial, numAxial)) <=
+	               kernelsArray2D.getSize(1),
+	           "More positions than the number of values given");
+	const size_t numKernels = static_cast<size_t>(numRadial) * numAxial;
+	ASSERT_MSG(kernelsArray2D.getSize(0) == 3 + 4 * numKernels,
+	           "The file must contain four rows per kernel");
+
+	m_radialPositions.resize(numRadial);
+	for (int i = 0; i < numRadial; i++)
+	{
+		m_radialPositions[i] = kernelsArray2D[0][i];
+		ASSERT_MSG(i == 0 || m_radialPositions[i] > m_radialPositions[i - 1],
+		           "Radial positions must be increasing");
+	}
+	m_axialPositions.resize(numAxial);
+	for (int i = 0; i < numAxial; i++)
+	{
+		m_axialPositions[i] = kernelsArray2D[1][i];
+		ASSERT_MSG(i == 0 || m_axialPositions[i] > m_axialPositions[i - 1],
+		           "Axial positions must be increasing");
+	}
+
+	// Every kernel has the same layout as a shift-invariant PSF file: the
+	// kernels in X, Y and Z followed by their sizes
+	m_kernels.resize(numKernels);
+	for (size_t n = 0; n < numKernels; n++)
+	{
+		const size_t firstRow = 3 + 4 * n;
+		Kernel& kernel = m_kernels[n];
+		readKernel(kernelsArray2D, firstRow, kernelsArray2D[firstRow + 3][0],
+		           kernel.x, kernel.x_flipped);
+		readKernel(kernelsArray2D, firstRow + 1,
+		           kernelsArray2D[firstRow + 3][1], kernel.y, kernel.y_flipped);
+		readKernel(kernelsArray2D, firstRow + 2,
+		           kernelsArray2D[firstRow + 3][2], kernel.z, kernel.z_flipped);
+	}
+}
+
+void OperatorVarPsf::applyA(const Variable* in, Variable* out)
+{
+	const Image* img_in = dynamic_cast<const Image*>(in);
+	Image* img_out = dynamic_cast<Image*>(out);
+	ASSERT_MSG(img_in != nullptr && img_out != nullptr,
+	           "Input parameters must be images");
+
+	apply(img_in, img_out, false);
+}
+
+void OperatorVarPsf::applyAH(const Variable* in, Variable* out)
+{
+	const Image* img_in = dynamic_cast<const Image*>(in);
+	Image* img_out = dynamic_cast<Image*>(out);
+	ASSERT_MSG(img_in != nullptr && img_out != nullptr,
+	           "Input parameters must be images");
+
+	apply(img_in, img_out, true);
+}
+
+void OperatorVarPsf::apply(const Image* in, Image* out, bool transpose) const
+{
+	ASSERT_MSG(!m_kernels.empty(), "No PSF kernels loaded");
+	const ImageParams& params = in->getParams();
+	ASSERT_MSG(params.isSameDimensionsAs(out->getParams()),
+	           "Dimensions mismatch between the two images");
+	const int nx = params.nx;
+	const int ny = params.ny;
+	const int nz = params.nz;
+	const size_t sliceSize = static_cast<size_t>(nx) * ny;
+
+	// The output is accumulated, so the input has to be kept aside when the
+	// operation is done in place
+	std::unique_ptr<ImageOwned> inCopy;
+	if (in->getRawPointer() == out->getRawPointer())
+	{
+		inCopy = std::make_unique<ImageOwned>(params);
+		inCopy->allocate();
+		inCopy->copyFromImage(in);
+		in = inCopy.get();
+	}
+	const float* inPtr = in->getRawPointer();
+	float* outPtr = out->getRawPointer();
+	out->setValue(0.0f);
+
+	// Interpolation weights, separable in the radial and axial directions
+	std::vector<float> radii(sliceSize);
+	for (int j = 0; j < ny; j++)
+	{
+		const float y = (j - (ny - 1) / 2.0f) * params.vy + params.off_y;
+		for (int i = 0; i < nx; i++)
+		{
+			const float x = (i - (nx - 1) / 2.0f) * params.vx + params.off_x;
+			radii[IDX2(i, j, nx)] = std::sqrt(x * x + y * y);
+		}
+	}
+	std::vector<float> axialPositions(nz);
+	for (int k = 0; k < nz; k++)
+	{
+		axialPositions[k] = (k - (nz - 1) / 2.0f) * params.vz + params.off_z;
+	}
+	const auto radialWeights =
+	    computeInterpolationWeights(m_radialPositions, radii);
+	const auto axialWeights =
+	    computeInterpolationWeights(m_axialPositions, axialPositions);
+
+	const int numRadial = static_cast<int>(m_radialPositions.size());
+	const int numAxial = static_cast<int>(m_axialPositions.size());
+	for (int zNode = 0; zNode < numAxial; zNode++)
+	{
+		const float* wz = axialWeights[zNode].data();
+		const auto first = std::find_if(axialWeights[zNode].begin(),
+		                                axialWeights[zNode].end(),
+		                                [](float w) { return w != 0.0f; });
+		if (first == axialWeights[zNode].end())
+		{
+			continue;
+		}
+		const int kMin =
+		    static_cast<int>(first - axialWeights[zNode].begin());
+		const int kMax =
+		    nz - 1 -
+		    static_cast<int>(std::find_if(axialWeights[zNode].rbegin(),
+		                                  axialWeights[zNode].rend(),
+		                                  [](float w) { return w != 0.0f; }) -
+		                     axialWeights[zNode].rbegin());
+
+		for (int rNode = 0; rNode < numRadial; rNode++)
+		{
+			const float* wr = radialWeights[rNode].data();
+			if (std::all_of(radialWeights[rNode].begin(),
+			                radialWeights[rNode].end(),
+			                [](float w) { return w == 0.0f; }))
+			{
+				continue;
+			}
+			const Kernel& kernel = m_kernels[zNode * numRadial + rNode];
+
+			// Slab of slices covering the non-zero weights of the node and
+			// the margin of the axial kernel, or the whole image if the slab
+			// would wrap onto itself
+			const int margin = static_cast<int>(kernel.z.size()) / 2;
+			int slabStart = kMin - margin;
+			int slabSize = kMax - kMin + 1 + 2 * margin;
+			if (slabSize >= nz)
+			{
+				slabStart = 0;
+				slabSize = nz;
+			}
+			const ImageParams slabParams{nx,
+			                             ny,
+			                             slabSize,
+			                             params.length_x,
+			                             params.length_y,
+			                             slabSize * params.vz};
+			ImageOwned slabIn{slabParams};
+			slabIn.allocate();
+			ImageOwned slabOut{slabParams};
+			slabOut.allocate();
+			float* slabInPtr = slabIn.getRawPointer();
+			const float* slabOutPtr = slabOut.getRawPointer();
+
+			if (!transpose)
+			{
+				// out += W_n (H_n in)
+#pragma omp parallel for default(none) \
+    firstprivate(inPtr, slabInPtr, slabStart, slabSize, nz, sliceSize)
+				for (int l = 0; l < slabSize; l++)
+				{
+					const int k = wrap(slabStart + l, nz);
+					std::copy_n(inPtr + k * sliceSize, sliceSize,
+					            slabInPtr + l * sliceSize);
+				}
+				OperatorPsf::convolve(&slabIn, &slabOut, kernel.x, kernel.y,
+				                      kernel.z);
+#pragma omp parallel for default(none)                                 \
+    firstprivate(outPtr, slabOutPtr, wr, wz, slabStart, slabSize, nz, \
+                     sliceSize)
+				for (int l = 0; l < slabSize; l++)
+				{
+					const int k = wrap(slabStart + l, nz);
+					const float weightZ = wz[k];
+					if (weightZ == 0.0f)
+					{
+						continue;
+					}
+					float* dst = outPtr + k * sliceSize;
+					const float* src = slabOutPtr + l * sliceSize;
+#pragma omp simd
+					for (size_t ij = 0; ij < sliceSize; ij++)
+					{
+						dst[ij] += weightZ * wr[ij] * src[ij];
+					}
+				}
+			}
+			else
+			{
+				// out += H_n^T (W_n in)
+#pragma omp parallel for default(none)                                \
+    firstprivate(inPtr, slabInPtr, wr, wz, slabStart, slabSize, nz, \
+                     sliceSize)
+				for (int l = 0; l < slabSize; l++)
+				{
+					const int k = wrap(slabStart + l, nz);
+					const float weightZ = wz[k];
+					const float* src = inPtr + k * sliceSize;
+					float* dst = slabInPtr + l * sliceSize;
+#pragma omp simd
+					for (size_t ij = 0; ij < sliceSize; ij++)
+					{
+						dst[ij] = weightZ * wr[ij] * src[ij];
+					}
+				}
+				OperatorPsf::convolve(&slabIn, &slabOut, kernel.x_flipped,
+				                      kernel.y_flipped, kernel.z_flipped);
+#pragma omp parallel for default(none) \
+    firstprivate(outPtr, slabOutPtr, slabStart, slabSize, nz, sliceSize)
+				for (int l = 0; l < slabSize; l++)
+				{
+					const int k = wrap(slabStart + l, nz);
+					float* dst = outPtr + k * sliceSize;
+					const float* src = slabOutPtr + l * sliceSize;
+#pragma omp simd
+					for (size_t ij = 0; ij < sliceSize; ij++)
+					{
+						dst[ij] += src[ij];
+					}
+				}
+			}
+		}
+	}
+}
+
+size_t OperatorVarPsf::getNumKernels() const
+{
+	return m_kernels.size();
+}
+
+const std::vector<float>& OperatorVarPsf::getRadialPositions() const
+{
+	return m_radialPositions;
+}
+
+const std::vector<float>& OperatorVarPsf::getAxialPositions() const
+{
+	return m_axialPositions;
+}
+
+std::vector<std::vector<float>> OperatorVarPsf::computeInterpolationWeights(
+    const std::vector<float>& nodes, const std::vector<float>& positions)
+{
+	ASSERT_MSG(!nodes.empty(), "No interpolation nodes given");
+	std::vector<std::vector<float>> weights(
+	    nodes.size(), std::vector<float>(positions.size(), 0.0f));
+	for (size_t p = 0; p < positions.size(); p++)
+	{
+		const float pos = positions[p];
+		if (pos <= nodes.front())
+		{
+			weights.front()[p] = 1.0f;
+		}
+		else if (pos >= nodes.back())
+		{
+			weights.back()[p] = 1.0f;
+		}
+		else
+		{
+			const size_t upper =
+			    std::upper_bound(nodes.begin(), nodes.end(), pos) -
+			    nodes.begin();
+			const size_t lower = upper - 1;
+			const float t =
+			    (pos - nodes[lower]) / (nodes[upper] - nodes[lower]);
+			weights[lower][p] = 1.0f - t;
+			weights[upper][p] = t;
+		}
+	}
+	return weights;
+}
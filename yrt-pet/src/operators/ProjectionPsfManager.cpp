@@ -5,9 +5,11 @@
 
 #include "operators/ProjectionPsfManager.hpp"
 
-#include "geometry/ProjectorUtils.hpp"
+#include "datastruct/projection/ProjectionData.hpp"
 #include "utils/Tools.hpp"
 
+#include <cmath>
+
 ProjectionPsfManager::ProjectionPsfManager() : m_sStep(0.f), m_kSpacing(0.f) {}
 
 ProjectionPsfManager::ProjectionPsfManager(const std::string& psfFilename)
@@ -43,6 +45,37 @@ void ProjectionPsfManager::readFromFileInternal(const std::string& psfFilename)
 			m_kernelsFlipped[i][m_kernels.getSize(1) - 1 - j] = m_kernels[i][j];
 		}
 	}
+	computeCumulativeKernels(m_kernels, m_kernelsCumul);
+	computeCumulativeKernels(m_kernelsFlipped, m_kernelsFlippedCumul);
+}
+
+void ProjectionPsfManager::computeCumulativeKernels(
+    const Array2DBase<float>& kernels, Array2D<float>& kernelsCumul) const
+{
+	// The kernel is piecewise linear between its samples and zero one sample
+	// away from its ends, so its running integral is exact at the samples
+	const size_t numKernels = kernels.getSize(0);
+	const size_t kernelSize = kernels.getSize(1);
+	const size_t paddedSize = kernelSize + 2;
+	kernelsCumul.allocate(numKernels, 2 * paddedSize);
+	for (size_t i = 0; i < numKernels; i++)
+	{
+		float* cumul = kernelsCumul[i];
+		float* samples = cumul + paddedSize;
+		samples[0] = 0.f;
+		samples[paddedSize - 1] = 0.f;
+		for (size_t j = 0; j < kernelSize; j++)
+		{
+			samples[j + 1] = kernels[i][j];
+		}
+		double sum = 0.0;
+		cumul[0] = 0.f;
+		for (size_t j = 1; j < paddedSize; j++)
+		{
+			sum += 0.5 * m_kSpacing * (samples[j - 1] + samples[j]);
+			cumul[j] = static_cast<float>(sum);
+		}
+	}
 }
 
 
@@ -57,44 +90,87 @@ int ProjectionPsfManager::getKernelSize() const
 	return m_kernels.getSize(1);
 }
 
+float ProjectionPsfManager::getKernelSpacing() const
+{
+	return m_kSpacing;
+}
+
+size_t ProjectionPsfManager::getKernelIndex(float p1x, float p1y, float p2x,
+                                            float p2y) const
+{
+	const float n_plane_x = p2y - p1y;
+	const float n_plane_y = p1x - p2x;
+	const float n_plane_norm2 = n_plane_x * n_plane_x + n_plane_y * n_plane_y;
+	if (n_plane_norm2 == 0)
+	{
+		return 0;
+	}
+	// Distance from the center: |p1 x n| / |n|
+	const float s = std::abs(p1x * n_plane_x + p1y * n_plane_y) /
+	                std::sqrt(n_plane_norm2);
+	return std::min(static_cast<size_t>(std::floor(s / m_sStep)),
+	                m_kernels.getSize(0) - 1);
+}
+
 const float* ProjectionPsfManager::getKernel(const Line3D& lor,
                                              bool flagFlipped) const
 {
-	const Vector3D p1 = lor.point1;
-	const Vector3D p2 = lor.point2;
-	float n_plane_x = p2.y - p1.y;
-	float n_plane_y = p1.x - p2.x;
-	const float n_plane_norm =
-	    std::sqrt(n_plane_x * n_plane_x + n_plane_y * n_plane_y);
-	size_t s_idx;
-	if (n_plane_norm == 0)
+	const size_t s_idx =
+	    getKernelIndex(lor.point1.x, lor.point1.y, lor.point2.x, lor.point2.y);
+	if (!flagFlipped)
 	{
-		s_idx = 0;
+		return m_kernelsCumul[s_idx];
 	}
-	else
+	return m_kernelsFlippedCumul[s_idx];
+}
+
+void ProjectionPsfManager::getKernels(ProjectionPropertiesBatch& properties,
+                                      const Vector3D& offset,
+                                      bool flagFlipped) const
+{
+	const size_t numLORs = properties.size();
+	properties.psfKernel.resize(numLORs);
+	const Array2D<float>& kernelsCumul =
+	    flagFlipped ? m_kernelsFlippedCumul : m_kernelsCumul;
+	for (size_t i = 0; i < numLORs; i++)
 	{
-		n_plane_x /= n_plane_norm;
-		n_plane_y /= n_plane_norm;
-		float s = std::abs(p1.x * n_plane_x + p1.y * n_plane_y);
-		s_idx = std::min(static_cast<size_t>(std::floor(s / m_sStep)),
-		                 m_kernels.getSize(0) - 1);
+		const size_t s_idx = getKernelIndex(
+		    properties.x1[i] - offset.x, properties.y1[i] - offset.y,
+		    properties.x2[i] - offset.x, properties.y2[i] - offset.y);
+		properties.psfKernel[i] = kernelsCumul[s_idx];
 	}
+}
 
-	if (!flagFlipped)
+float ProjectionPsfManager::getCumulativeValue(const float* kernel,
+                                               float x) const
+{
+	const int paddedSize = m_kernels.getSize(1) + 2;
+	const int halfSize = (m_kernels.getSize(1) - 1) / 2;
+	// Position in samples of the zero-padded kernel
+	const float u = x / m_kSpacing + static_cast<float>(halfSize + 1);
+	if (u <= 0.f)
+	{
+		return 0.f;
+	}
+	if (u >= static_cast<float>(paddedSize - 1))
 	{
-		return m_kernels[s_idx];
+		return kernel[paddedSize - 1];
 	}
-	return m_kernelsFlipped[s_idx];
+	const int j = static_cast<int>(u);
+	const float tau = u - static_cast<float>(j);
+	const float* samples = kernel + paddedSize;
+	return kernel[j] +
+	       m_kSpacing * tau *
+	           (samples[j] + 0.5f * tau * (samples[j + 1] - samples[j]));
 }
 
 float ProjectionPsfManager::getWeight(const float* kernel, const float x0,
                                       const float x1) const
 {
-	const int halfWidth = (m_kernels.getSize(1) + 1) / 2;
-	if (x0 > halfWidth * m_kSpacing || x1 < -halfWidth * m_kSpacing || x0 >= x1)
+	const float halfWidth = getHalfWidth_mm();
+	if (x0 > halfWidth || x1 < -halfWidth || x0 >= x1)
 	{
 		return 0.f;
 	}
-	return Util::calculateIntegral(kernel, m_kernels.getSize(1), m_kSpacing, x0,
-	                               x1);
+	return getCumulativeValue(kernel, x1) - getCumulativeValue(kernel, x0);
 }
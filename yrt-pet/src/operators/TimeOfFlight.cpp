@@ -5,25 +5,46 @@
 
 #include "operators/TimeOfFlight.hpp"
 
+#include "utils/Assert.hpp"
 #include "utils/Tools.hpp"
 
+#include <algorithm>
+#include <vector>
+
 #if BUILD_PYBIND11
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 namespace py = pybind11;
 
 void py_setup_timeofflight(py::module& m)
 {
 	auto c = py::class_<TimeOfFlightHelper>(m, "TimeOfFlightHelper");
-	c.def(py::init<float, int>());
+	c.def(py::init<float, int, int>(), py::arg("tof_width_ps"),
+	      py::arg("tof_n_std") = -1, py::arg("tof_lut_samples_per_std") = 0);
 	c.def("getAlphaRange", &TimeOfFlightHelper::getAlphaRange);
 	c.def("getWeight", &TimeOfFlightHelper::getWeight);
 	c.def("getSigma", &TimeOfFlightHelper::getSigma);
 	c.def("getTruncWidth", &TimeOfFlightHelper::getTruncWidth);
 	c.def("getNorm", &TimeOfFlightHelper::getNorm);
+	c.def("getCDF", &TimeOfFlightHelper::getCDF);
+	c.def("getLUTSamplesPerStd", &TimeOfFlightHelper::getLUTSamplesPerStd);
+	c.def(
+	    "getTOFBinWeights",
+	    [](const TimeOfFlightHelper& self, float lorNorm, float pos_mm,
+	       int numTOFBins, float tofBinWidth_ps)
+	    {
+		    std::vector<float> weights(numTOFBins);
+		    self.getTOFBinWeights(lorNorm, pos_mm, numTOFBins, tofBinWidth_ps,
+		                          weights.data());
+		    return weights;
+	    },
+	    py::arg("lorNorm"), py::arg("pos_mm"), py::arg("numTOFBins"),
+	    py::arg("tofBinWidth_ps"));
 }
 #endif
 
-TimeOfFlightHelper::TimeOfFlightHelper(float tof_width_ps, int tof_n_std)
+TimeOfFlightHelper::TimeOfFlightHelper(float tof_width_ps, int tof_n_std,
+                                       int tof_lut_samples_per_std)
 {
 	const double tof_width_mm = tof_width_ps * SPEED_OF_LIGHT_MM_PS * 0.5;
 	// FWHM = sigma 2 sqrt(2 ln 2)
@@ -37,6 +58,33 @@ TimeOfFlightHelper::TimeOfFlightHelper(float tof_width_ps, int tof_n_std)
 		m_truncWidth_mm = tof_n_std * m_sigma;
 	}
 	m_norm = 1 / (std::sqrt(2 * PI) * m_sigma);
+
+	ASSERT_MSG(tof_lut_samples_per_std <= MaxLUTSamplesPerStd,
+	           "Too many samples per standard deviation for the TOF kernel "
+	           "table");
+	if (tof_lut_samples_per_std <= 0)
+	{
+		m_lutSamplesPerStd = 0;
+		m_lutSize = 0;
+		m_lutStep_mm = 0.f;
+		m_lutHalfRange_mm = 0.f;
+	}
+	else
+	{
+		m_lutSamplesPerStd = tof_lut_samples_per_std;
+		m_lutSize = 2 * LUTRangeStd * m_lutSamplesPerStd + 1;
+		m_lutStep_mm = m_sigma / static_cast<float>(m_lutSamplesPerStd);
+		m_lutHalfRange_mm = LUTRangeStd * m_sigma;
+		for (int i = 0; i < m_lutSize; i++)
+		{
+			const double x_std =
+			    static_cast<double>(i - LUTRangeStd * m_lutSamplesPerStd) /
+			    m_lutSamplesPerStd;
+			m_lutCDF[i] =
+			    static_cast<float>(0.5 * std::erfc(-x_std / std::sqrt(2.0)));
+		}
+	}
+	std::fill(m_lutCDF + m_lutSize, m_lutCDF + MaxLUTSize, 0.f);
 }
 
 float TimeOfFlightHelper::getSigma() const
@@ -53,3 +101,8 @@ float TimeOfFlightHelper::getNorm() const
 {
 	return m_norm;
 }
+
+int TimeOfFlightHelper::getLUTSamplesPerStd() const
+{
+	return m_lutSamplesPerStd;
+}
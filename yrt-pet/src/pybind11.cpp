@@ -23,12 +23,18 @@ void py_setup_variable(py::module& m);
 void py_setup_imagebase(py::module&);
 void py_setup_imageparams(py::module&);
 void py_setup_image(py::module&);
+void py_setup_imageresampler(py::module& m);
 void py_setup_projectiondata(py::module& m);
 void py_setup_biniterator(py::module& m);
 void py_setup_histogram(py::module& m);
 void py_setup_histogram3d(py::module& m);
+void py_setup_histogram3dhalf(py::module& m);
+void py_setup_histogram3dsparsedefault(py::module& m);
 void py_setup_uniformhistogram(py::module& m);
 void py_setup_sparsehistogram(py::module& m);
+void py_setup_spanhistogram(py::module& m);
+void py_setup_tofhistogram3d(py::module& m);
+void py_setup_sinogramstack(py::module& m);
 void py_setup_lormotion(py::module& m);
 void py_setup_listmode(py::module& m);
 void py_setup_listmodelut(py::module& m);
@@ -42,13 +48,16 @@ void py_setup_detcoord(py::module& m);
 void py_setup_detregular(py::module& m);
 void py_setup_io(py::module& m);
 
+void py_setup_graphical(py::module& m);
 void py_setup_srtm(py::module& m);
+void py_setup_twotcm(py::module& m);
 void py_setup_imagewarpertemplate(py::module& m);
 void py_setup_imagewarpermatrix(py::module& m);
 void py_setup_imagewarperfunction(py::module& m);
 
 void py_setup_operator(py::module& m);
 void py_setup_operatorpsf(py::module& m);
+void py_setup_operatorvarpsf(py::module& m);
 void py_setup_operatorprojectorparams(py::module& m);
 void py_setup_operatorprojectorbase(py::module& m);
 void py_setup_operatorprojector(py::module& m);
@@ -82,12 +91,18 @@ PYBIND11_MODULE(pyyrtpet, m)
 	py_setup_imagebase(m);
 	py_setup_imageparams(m);
 	py_setup_image(m);
+	py_setup_imageresampler(m);
 	py_setup_biniterator(m);
 	py_setup_projectiondata(m);
 	py_setup_histogram(m);
 	py_setup_histogram3d(m);
+	py_setup_histogram3dhalf(m);
+	py_setup_histogram3dsparsedefault(m);
 	py_setup_uniformhistogram(m);
 	py_setup_sparsehistogram(m);
+	py_setup_spanhistogram(m);
+	py_setup_tofhistogram3d(m);
+	py_setup_sinogramstack(m);
 	py_setup_lormotion(m);
 	py_setup_listmode(m);
 	py_setup_listmodelut(m);
@@ -99,7 +114,9 @@ PYBIND11_MODULE(pyyrtpet, m)
 	py_setup_detregular(m);
 	py_setup_io(m);
 
+	py_setup_graphical(m);
 	py_setup_srtm(m);
+	py_setup_twotcm(m);
 	py_setup_imagewarpertemplate(m);
 	py_setup_imagewarpermatrix(m);
 	py_setup_imagewarperfunction(m);
@@ -108,6 +125,7 @@ PYBIND11_MODULE(pyyrtpet, m)
 
 	py_setup_operator(m);
 	py_setup_operatorpsf(m);
+	py_setup_operatorvarpsf(m);
 	py_setup_operatorprojectorbase(m);
 	py_setup_operatorprojector(m);
 	py_setup_operatorprojectorparams(m);
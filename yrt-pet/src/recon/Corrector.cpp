@@ -8,6 +8,20 @@
 #include "utils/Assert.hpp"
 #include "utils/Tools.hpp"
 
+namespace
+{
+	// Additive estimates without TOF bins hold the value of the whole LOR,
+	// which is split evenly between its TOF bins
+	float getTOFBinShare(const Histogram& estimate, histo_bin_t histoBin)
+	{
+		if (std::holds_alternative<det_pair_tof_t>(histoBin) &&
+		    !estimate.hasTOFBins())
+		{
+			return 1.0f / std::get<det_pair_tof_t>(histoBin).numTOFBins;
+		}
+		return 1.0f;
+	}
+}  // namespace
 
 Corrector::Corrector(const Scanner& pr_scanner)
     : mr_scanner(pr_scanner),
@@ -102,6 +116,11 @@ const Histogram* Corrector::getSensitivityHistogram() const
 	return mp_sensitivity;
 }
 
+const Histogram* Corrector::getScatterHistogram() const
+{
+	return mp_scatter;
+}
+
 float Corrector::getGlobalScalingFactor() const
 {
 	return m_globalScalingFactor;
@@ -291,7 +310,8 @@ float Corrector::getRandomsEstimate(const ProjectionData& measurements,
 {
 	if (mp_randoms != nullptr)
 	{
-		return mp_randoms->getProjectionValueFromHistogramBin(histoBin);
+		return mp_randoms->getProjectionValueFromHistogramBin(histoBin) *
+		       getTOFBinShare(*mp_randoms, histoBin);
 	}
 	return measurements.getRandomsEstimate(binId);
 }
@@ -301,7 +321,8 @@ float Corrector::getScatterEstimate(histo_bin_t histoBin) const
 	if (mp_scatter != nullptr)
 	{
 		// TODO: Support exception in case of a contiguous sinogram (future)
-		return mp_scatter->getProjectionValueFromHistogramBin(histoBin);
+		return mp_scatter->getProjectionValueFromHistogramBin(histoBin) *
+		       getTOFBinShare(*mp_scatter, histoBin);
 	}
 	return 0.0f;
 }
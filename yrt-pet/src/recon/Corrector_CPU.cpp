@@ -72,27 +72,42 @@ float Corrector_CPU::getMultiplicativeCorrectionFactor(
 {
 	if (hasMultiplicativeCorrection())
 	{
-		const histo_bin_t histoBin = measurements.getHistogramBin(binId);
-
-		const float sensitivity = getSensitivity(histoBin);
-
-		float acf;
-		if (mp_hardwareAcf != nullptr)
+		// Weighted mean over the LORs of the bin
+		const size_t numLORs = measurements.getNumLORsInBin(binId);
+		float acfSensitivitySum = 0.0f;
+		float weightSum = 0.0f;
+		for (size_t lorIdx = 0; lorIdx < numLORs; lorIdx++)
 		{
-			// Hardware ACF
-			acf = mp_hardwareAcf->getProjectionValueFromHistogramBin(histoBin);
-		}
-		else if (mp_hardwareAttenuationImage != nullptr)
-		{
-			acf = getAttenuationFactorFromAttenuationImage(
-			    measurements, binId, *mp_hardwareAttenuationImage);
-		}
-		else
-		{
-			acf = 1.0f;
+			const histo_bin_t histoBin =
+			    getHistogramBinOfLOR(measurements, binId, lorIdx);
+
+			const float sensitivity = getSensitivity(histoBin);
+
+			float acf;
+			if (mp_hardwareAcf != nullptr)
+			{
+				// Hardware ACF
+				acf = mp_hardwareAcf->getProjectionValueFromHistogramBin(
+				    histoBin);
+			}
+			else if (mp_hardwareAttenuationImage != nullptr)
+			{
+				acf = getAttenuationFactorFromAttenuationImage(
+				    measurements, binId, lorIdx,
+				    *mp_hardwareAttenuationImage);
+			}
+			else
+			{
+				acf = 1.0f;
+			}
+
+			const float weight =
+			    measurements.getWeightOfLORInBin(binId, lorIdx);
+			acfSensitivitySum += weight * acf * sensitivity;
+			weightSum += weight;
 		}
 
-		return acf * sensitivity;
+		return acfSensitivitySum / weightSum;
 	}
 	return m_globalScalingFactor;
 }
@@ -100,55 +115,101 @@ float Corrector_CPU::getMultiplicativeCorrectionFactor(
 float Corrector_CPU::getAdditiveCorrectionFactor(
     const ProjectionData& measurements, bin_t binId) const
 {
-	const histo_bin_t histoBin = measurements.getHistogramBin(binId);
+	// The randoms and scatter of the LORs of the bin add up while their
+	//  multiplicative factors are averaged (See
+	//  getMultiplicativeCorrectionFactor)
+	const size_t numLORs = measurements.getNumLORsInBin(binId);
+	float randomsScatterSum = 0.0f;
+	float acfSensitivitySum = 0.0f;
+	float weightSum = 0.0f;
+	bool isAnyLORStable = false;
+
+	if (mp_randoms == nullptr)
+	{
+		// The measurements give the randoms of the whole bin
+		randomsScatterSum += measurements.getRandomsEstimate(binId);
+	}
 
-	const float randomsEstimate =
-	    getRandomsEstimate(measurements, binId, histoBin);
+	for (size_t lorIdx = 0; lorIdx < numLORs; lorIdx++)
+	{
+		const histo_bin_t histoBin =
+		    getHistogramBinOfLOR(measurements, binId, lorIdx);
 
-	const float scatterEstimate = getScatterEstimate(histoBin);
+		if (mp_randoms != nullptr)
+		{
+			randomsScatterSum +=
+			    getRandomsEstimate(measurements, binId, histoBin);
+		}
 
-	const float sensitivity = getSensitivity(histoBin);
+		randomsScatterSum += getScatterEstimate(histoBin);
 
-	float acf;
-	if (doesTotalACFComeFromHistogram())
-	{
-		acf = getTotalACFFromHistogram(histoBin);
-	}
-	else if (mp_attenuationImage != nullptr)
-	{
-		acf = getAttenuationFactorFromAttenuationImage(measurements, binId,
-		                                               *mp_attenuationImage);
-	}
-	else
-	{
-		acf = 1.0f;
+		const float sensitivity = getSensitivity(histoBin);
+
+		float acf;
+		if (doesTotalACFComeFromHistogram())
+		{
+			acf = getTotalACFFromHistogram(histoBin);
+		}
+		else if (mp_attenuationImage != nullptr)
+		{
+			acf = getAttenuationFactorFromAttenuationImage(
+			    measurements, binId, lorIdx, *mp_attenuationImage);
+		}
+		else
+		{
+			acf = 1.0f;
+		}
+
+		const float weight = measurements.getWeightOfLORInBin(binId, lorIdx);
+		weightSum += weight;
+		if (acf < StabilityEpsilon || sensitivity < StabilityEpsilon)
+		{
+			// To avoid numerical instability
+			continue;
+		}
+		isAnyLORStable = true;
+		acfSensitivitySum += weight * acf * sensitivity;
 	}
 
-	if (acf < StabilityEpsilon || sensitivity < StabilityEpsilon)
+	if (!isAnyLORStable)
 	{
-		// To avoid numerical instability
 		return 0.0f;
 	}
 
-	return (randomsEstimate + scatterEstimate) / (acf * sensitivity);
+	return randomsScatterSum * weightSum / acfSensitivitySum;
 }
 
 float Corrector_CPU::getInVivoAttenuationFactor(
     const ProjectionData& measurements, bin_t binId) const
 {
-	const histo_bin_t histoBin = measurements.getHistogramBin(binId);
-
-	if (mp_inVivoAcf != nullptr)
+	if (mp_inVivoAcf == nullptr && mp_inVivoAttenuationImage == nullptr)
 	{
-		return mp_inVivoAcf->getProjectionValueFromHistogramBin(histoBin);
+		return 1.0f;
 	}
-	if (mp_inVivoAttenuationImage != nullptr)
+
+	// Weighted mean over the LORs of the bin
+	const size_t numLORs = measurements.getNumLORsInBin(binId);
+	float acfSum = 0.0f;
+	float weightSum = 0.0f;
+	for (size_t lorIdx = 0; lorIdx < numLORs; lorIdx++)
 	{
-		return getAttenuationFactorFromAttenuationImage(
-		    measurements, binId, *mp_inVivoAttenuationImage);
+		float acf;
+		if (mp_inVivoAcf != nullptr)
+		{
+			acf = mp_inVivoAcf->getProjectionValueFromHistogramBin(
+			    getHistogramBinOfLOR(measurements, binId, lorIdx));
+		}
+		else
+		{
+			acf = getAttenuationFactorFromAttenuationImage(
+			    measurements, binId, lorIdx, *mp_inVivoAttenuationImage);
+		}
+		const float weight = measurements.getWeightOfLORInBin(binId, lorIdx);
+		acfSum += weight * acf;
+		weightSum += weight;
 	}
 
-	return 1.0f;
+	return acfSum / weightSum;
 }
 
 float Corrector_CPU::getAdditiveCorrectionFactor(bin_t binId) const
@@ -187,17 +248,27 @@ const ProjectionData*
 	return nullptr;
 }
 
+histo_bin_t
+    Corrector_CPU::getHistogramBinOfLOR(const ProjectionData& measurements,
+                                        bin_t binId, size_t lorIdx)
+{
+	if (measurements.hasLORBundles())
+	{
+		return measurements.getDetectorPairInBin(binId, lorIdx);
+	}
+	return measurements.getHistogramBin(binId);
+}
+
 float Corrector_CPU::getAttenuationFactorFromAttenuationImage(
-    const ProjectionData& measurements, bin_t binId,
+    const ProjectionData& measurements, bin_t binId, size_t lorIdx,
     const Image& attenuationImage) const
 {
-	const Line3D lor = measurements.getLOR(binId);
-
-	const float tofValue =
-	    measurements.hasTOF() ? measurements.getTOFValue(binId) : 0.0f;
+	const ProjectionProperties projProps =
+	    measurements.getProjectionPropertiesInBin(binId, lorIdx);
 
 	const float att = OperatorProjectorSiddon::singleForwardProjection(
-	    &attenuationImage, lor, mp_tofHelper.get(), tofValue);
+	    &attenuationImage, projProps.lor, mp_tofHelper.get(),
+	    projProps.tofValue);
 
 	return Util::getAttenuationCoefficientFactor(att);
 }
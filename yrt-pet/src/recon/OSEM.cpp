@@ -17,6 +17,7 @@
 #include "operators/OperatorProjectorDD.hpp"
 #include "operators/OperatorProjectorSiddon.hpp"
 #include "operators/OperatorPsf.hpp"
+#include "operators/OperatorVarPsf.hpp"
 #include "utils/Assert.hpp"
 #include "utils/Globals.hpp"
 #include "utils/Tools.hpp"
@@ -75,9 +76,11 @@ void py_setup_osem(pybind11::module& m)
 	      "invert"_a = true);
 	c.def("getDataInput", &OSEM::getDataInput);
 	c.def("setDataInput", &OSEM::setDataInput, "proj_data"_a);
-	c.def("addTOF", &OSEM::addTOF, "tof_width_ps"_a, "tof_num_std"_a);
+	c.def("addTOF", &OSEM::addTOF, "tof_width_ps"_a, "tof_num_std"_a,
+	      "tof_lut_samples_per_std"_a = 0);
 	c.def("addProjPSF", &OSEM::addProjPSF, "proj_psf_fname"_a);
 	c.def("addImagePSF", &OSEM::addImagePSF, "image_psf_fname"_a);
+	c.def("addImageVarPSF", &OSEM::addImageVarPSF, "image_var_psf_fname"_a);
 	c.def("setSaveIterRanges", &OSEM::setSaveIterRanges, "range_list"_a,
 	      "path"_a);
 	c.def("setListModeEnabled", &OSEM::setListModeEnabled, "enabled"_a);
@@ -87,6 +90,7 @@ void py_setup_osem(pybind11::module& m)
 	c.def("isListModeEnabled", &OSEM::isListModeEnabled);
 	c.def("setRandomsHistogram", &OSEM::setRandomsHistogram, "randoms_his"_a);
 	c.def("setScatterHistogram", &OSEM::setScatterHistogram, "scatter_his"_a);
+	c.def("getScatterHistogram", &OSEM::getScatterHistogram);
 	c.def("setAttenuationImage", &OSEM::setAttenuationImage, "att_image"_a);
 	c.def("setACFHistogram", &OSEM::setACFHistogram, "acf_his"_a);
 	c.def("setHardwareAttenuationImage", &OSEM::setHardwareAttenuationImage,
@@ -123,6 +127,7 @@ OSEM::OSEM(const Scanner& pr_scanner)
       flagProjTOF(false),
       tofWidth_ps(0.0f),
       tofNumStd(0),
+      tofLUTSamplesPerStd(0),
       saveIterRanges(),
       usingListModeInput(false),
       needToMakeCopyOfSensImage(false),
@@ -384,10 +389,12 @@ void OSEM::setDataInput(const ProjectionData* pp_dataInput)
 	}
 }
 
-void OSEM::addTOF(float p_tofWidth_ps, int p_tofNumStd)
+void OSEM::addTOF(float p_tofWidth_ps, int p_tofNumStd,
+                  int p_tofLUTSamplesPerStd)
 {
 	tofWidth_ps = p_tofWidth_ps;
 	tofNumStd = p_tofNumStd;
+	tofLUTSamplesPerStd = p_tofLUTSamplesPerStd;
 	flagProjTOF = true;
 }
 
@@ -405,6 +412,14 @@ void OSEM::addImagePSF(const std::string& p_imageSpacePsf_fname)
 	flagImagePSF = true;
 }
 
+void OSEM::addImageVarPSF(const std::string& p_imageSpaceVarPsf_fname)
+{
+	ASSERT_MSG(!p_imageSpaceVarPsf_fname.empty(),
+	           "Empty filename for spatially-variant Image-space PSF");
+	imageSpacePsf = std::make_unique<OperatorVarPsf>(p_imageSpaceVarPsf_fname);
+	flagImagePSF = true;
+}
+
 void OSEM::setSaveIterRanges(Util::RangeList p_saveIterList,
                              const std::string& p_saveIterPath)
 {
@@ -432,6 +447,16 @@ void OSEM::enableNeedToMakeCopyOfSensImage()
 	needToMakeCopyOfSensImage = true;
 }
 
+void OSEM::setNeedToMakeCopyOfSensImage(bool needCopy)
+{
+	needToMakeCopyOfSensImage = needCopy;
+}
+
+bool OSEM::isNeedToMakeCopyOfSensImage() const
+{
+	return needToMakeCopyOfSensImage;
+}
+
 ImageParams OSEM::getImageParams() const
 {
 	return imageParams;
@@ -452,6 +477,11 @@ void OSEM::setScatterHistogram(const Histogram* pp_scatter)
 	getCorrector().setScatterHistogram(pp_scatter);
 }
 
+const Histogram* OSEM::getScatterHistogram() const
+{
+	return getCorrector().getScatterHistogram();
+}
+
 void OSEM::setGlobalScalingFactor(float globalScalingFactor)
 {
 	getCorrector().setGlobalScalingFactor(globalScalingFactor);
@@ -12,6 +12,8 @@
 #include "utils/Globals.hpp"
 #include "utils/ProgressDisplayMultiThread.hpp"
 
+#include <algorithm>
+
 
 OSEMUpdater_CPU::OSEMUpdater_CPU(OSEM_CPU* pp_osem) : mp_osem(pp_osem)
 {
@@ -30,23 +32,109 @@ void OSEMUpdater_CPU::computeSensitivityImage(Image& destImage) const
 	Util::ProgressDisplayMultiThread progressDisplay(Globals::get_num_threads(),
 	                                                 numBins);
 
+	if (sensImgGenProjData->hasTransaxialLORs())
+	{
+		// Slice by slice, each slice is backprojected by a single thread
+		const std::vector<std::vector<bin_t>> binsPerSlice =
+		    projector->getBinsPerSlice(sensImgGenProjData,
+		                               destImage.getParams());
+		const int numSlices = static_cast<int>(binsPerSlice.size());
+		const std::vector<bin_t>* binsPerSlicePtr = binsPerSlice.data();
+
+#pragma omp parallel default(none)                                          \
+    firstprivate(sensImgGenProjData, correctorPtr, projector, destImagePtr, \
+                     binsPerSlicePtr, numSlices) shared(progressDisplay)
+		{
+			ProjectionPropertiesBatch properties;
+			float projValues[OperatorProjector::BinBlockSize];
+#pragma omp for schedule(dynamic)
+			for (int slice = 0; slice < numSlices; slice++)
+			{
+				const std::vector<bin_t>& bins = binsPerSlicePtr[slice];
+				progressDisplay.progress(omp_get_thread_num(), bins.size());
+				for (size_t first = 0; first < bins.size();
+				     first += OperatorProjector::BinBlockSize)
+				{
+					const size_t blockSize = std::min(
+					    OperatorProjector::BinBlockSize, bins.size() - first);
+					sensImgGenProjData->getProjectionProperties(
+					    bins.data() + first, blockSize, properties);
+					for (size_t i = 0; i < blockSize; i++)
+					{
+						projValues[i] =
+						    correctorPtr->getMultiplicativeCorrectionFactor(
+						        *sensImgGenProjData, bins[first + i]);
+					}
+					projector->backProjection2DBatch(destImagePtr, properties,
+					                                 slice, projValues);
+				}
+			}
+		}
+		return;
+	}
+
+	if (sensImgGenProjData->hasLORBundles())
+	{
 #pragma omp parallel for default(none)                                      \
     firstprivate(sensImgGenProjData, correctorPtr, projector, destImagePtr, \
                      binIter, numBins) shared(progressDisplay)
-	for (bin_t binIdx = 0; binIdx < numBins; binIdx++)
-	{
-		progressDisplay.progress(omp_get_thread_num(), 1);
+		for (bin_t binIdx = 0; binIdx < numBins; binIdx++)
+		{
+			progressDisplay.progress(omp_get_thread_num(), 1);
 
-		const bin_t bin = binIter->get(binIdx);
+			const bin_t bin = binIter->get(binIdx);
 
-		const ProjectionProperties projectionProperties =
-		    sensImgGenProjData->getProjectionProperties(bin);
+			const float projValue =
+			    correctorPtr->getMultiplicativeCorrectionFactor(
+			        *sensImgGenProjData, bin);
 
-		const float projValue = correctorPtr->getMultiplicativeCorrectionFactor(
-		    *sensImgGenProjData, bin);
+			projector->backProjectionBundle(destImagePtr, sensImgGenProjData,
+			                                bin, projValue);
+		}
+		return;
+	}
 
-		projector->backProjection(destImagePtr, projectionProperties,
-		                          projValue);
+	// The LORs are computed by blocks of bins
+	const size_t maxBlockSize = OperatorProjector::BinBlockSize;
+	const bin_t numBlocks = (numBins + maxBlockSize - 1) / maxBlockSize;
+	const ProjectionPsfManager* psfManager =
+	    projector->getProjectionPsfManager();
+	const ImageParams& imgParams = destImage.getParams();
+	const Vector3D offset{imgParams.off_x, imgParams.off_y, imgParams.off_z};
+#pragma omp parallel default(none)                                          \
+    firstprivate(sensImgGenProjData, correctorPtr, projector, destImagePtr, \
+                     binIter, numBins, numBlocks, maxBlockSize, psfManager, \
+                     offset) shared(progressDisplay)
+	{
+		std::vector<bin_t> bins(maxBlockSize);
+		std::vector<float> projValues(maxBlockSize);
+		ProjectionPropertiesBatch properties;
+#pragma omp for
+		for (bin_t blockIdx = 0; blockIdx < numBlocks; blockIdx++)
+		{
+			const bin_t first = blockIdx * maxBlockSize;
+			const size_t blockSize =
+			    std::min<bin_t>(maxBlockSize, numBins - first);
+			progressDisplay.progress(omp_get_thread_num(), blockSize);
+
+			for (size_t i = 0; i < blockSize; i++)
+			{
+				bins[i] = binIter->get(first + i);
+			}
+			sensImgGenProjData->getProjectionProperties(bins.data(), blockSize,
+			                                            properties);
+			for (size_t i = 0; i < blockSize; i++)
+			{
+				projValues[i] = correctorPtr->getMultiplicativeCorrectionFactor(
+				    *sensImgGenProjData, bins[i]);
+			}
+			if (psfManager != nullptr)
+			{
+				psfManager->getKernels(properties, offset, true);
+			}
+			projector->backProjectionBatch(destImagePtr, properties,
+			                               projValues.data());
+		}
 	}
 }
 
@@ -64,6 +152,7 @@ void OSEMUpdater_CPU::computeEMUpdateImage(const Image& inputImage,
 
 	const bool hasAdditiveCorrection = corrector.hasAdditiveCorrection();
 	const bool hasInVivoAttenuation = corrector.hasInVivoAttenuation();
+	const bool hasLORBundles = measurements->hasLORBundles();
 
 	ASSERT(projector != nullptr);
 	ASSERT(binIter != nullptr);
@@ -86,37 +175,297 @@ void OSEMUpdater_CPU::computeEMUpdateImage(const Image& inputImage,
 		    "measurements");
 	}
 
-#pragma omp parallel for default(none) firstprivate(                        \
-        hasAdditiveCorrection, hasInVivoAttenuation, binIter, measurements, \
-            projector, correctorPtr, destImagePtr, inputImagePtr, numBins)
-	for (bin_t binIdx = 0; binIdx < numBins; binIdx++)
+	if (measurements->hasTransaxialLORs())
+	{
+		computeEMUpdateImage2D(inputImage, destImage);
+		return;
+	}
+
+	if (measurements->hasTOFBins())
+	{
+		computeEMUpdateImageTOFBins(inputImage, destImage);
+		return;
+	}
+
+	if (hasLORBundles)
 	{
-		const bin_t bin = binIter->get(binIdx);
+		// Bins grouping several LORs recompute their properties in the
+		// backprojection
+#pragma omp parallel for default(none)                                  \
+    firstprivate(hasAdditiveCorrection, hasInVivoAttenuation, binIter, \
+                     measurements, projector, correctorPtr, destImagePtr, \
+                     inputImagePtr, numBins)
+		for (bin_t binIdx = 0; binIdx < numBins; binIdx++)
+		{
+			const bin_t bin = binIter->get(binIdx);
+
+			float update = projector->forwardProjectionBundle(
+			    inputImagePtr, measurements, bin);
+
+			if (hasAdditiveCorrection)
+			{
+				update += correctorPtr->getAdditiveCorrectionFactor(bin);
+			}
 
-		const ProjectionProperties projectionProperties =
-		    measurements->getProjectionProperties(bin);
+			if (hasInVivoAttenuation)
+			{
+				update *= correctorPtr->getInVivoAttenuationFactor(bin);
+			}
 
-		float update =
-		    projector->forwardProjection(inputImagePtr, projectionProperties);
+			if (update > 1e-8)  // to prevent numerical instability
+			{
+				const float measurement = measurements->getProjectionValue(bin);
 
-		if (hasAdditiveCorrection)
+				update = measurement / update;
+
+				projector->backProjectionBundle(destImagePtr, measurements,
+				                                bin, update);
+			}
+		}
+		return;
+	}
+
+	// The LORs are computed by blocks of bins. If bins can share their LOR
+	// (ex: list-mode events), each distinct LOR is projected once: its
+	// forward projection is shared by its bins and the sum of their ratios
+	// is backprojected
+	const OperatorProjector::LORGroups* lorGroups =
+	    measurements->hasDuplicateLORs() ?
+	        &projector->getLORGroups(measurements) :
+	        nullptr;
+	const bin_t numLORs =
+	    (lorGroups != nullptr) ? lorGroups->numGroups() : numBins;
+	const size_t maxBlockSize = OperatorProjector::BinBlockSize;
+	const bin_t numBlocks = (numLORs + maxBlockSize - 1) / maxBlockSize;
+	const ProjectionPsfManager* psfManager =
+	    projector->getProjectionPsfManager();
+	const ImageParams& imgParams = inputImage.getParams();
+	const Vector3D offset{imgParams.off_x, imgParams.off_y, imgParams.off_z};
+#pragma omp parallel default(none)                                         \
+    firstprivate(hasAdditiveCorrection, hasInVivoAttenuation, binIter,    \
+                     measurements, projector, correctorPtr, destImagePtr, \
+                     inputImagePtr, numLORs, numBlocks, maxBlockSize,     \
+                     lorGroups, psfManager, offset)
+	{
+		std::vector<bin_t> bins(maxBlockSize);
+		std::vector<float> updates(maxBlockSize);
+		ProjectionPropertiesBatch properties;
+
+		// Ratio of the measurement of a bin to its forward projection. Left
+		// to zero to prevent numerical instability
+		auto getRatio = [&](float update, bin_t bin) -> float
 		{
-			update += correctorPtr->getAdditiveCorrectionFactor(bin);
+			if (hasAdditiveCorrection)
+			{
+				update += correctorPtr->getAdditiveCorrectionFactor(bin);
+			}
+
+			if (hasInVivoAttenuation)
+			{
+				update *= correctorPtr->getInVivoAttenuationFactor(bin);
+			}
+
+			if (update > 1e-8)
+			{
+				return measurements->getProjectionValue(bin) / update;
+			}
+			return 0.0f;
+		};
+
+#pragma omp for
+		for (bin_t blockIdx = 0; blockIdx < numBlocks; blockIdx++)
+		{
+			const bin_t first = blockIdx * maxBlockSize;
+			const size_t blockSize =
+			    std::min<bin_t>(maxBlockSize, numLORs - first);
+			for (size_t i = 0; i < blockSize; i++)
+			{
+				bins[i] = (lorGroups != nullptr) ?
+				              lorGroups->getFirstBin(first + i) :
+				              binIter->get(first + i);
+			}
+			measurements->getProjectionProperties(bins.data(), blockSize,
+			                                      properties);
+			if (psfManager != nullptr)
+			{
+				psfManager->getKernels(properties, offset, false);
+			}
+
+			projector->forwardProjectionBatch(inputImagePtr, properties,
+			                                  updates.data());
+			for (size_t i = 0; i < blockSize; i++)
+			{
+				if (lorGroups != nullptr)
+				{
+					const bin_t groupIdx = first + i;
+					float ratioSum = 0.0f;
+					for (size_t j = lorGroups->groupStarts[groupIdx];
+					     j < lorGroups->groupStarts[groupIdx + 1]; j++)
+					{
+						ratioSum += getRatio(updates[i], lorGroups->bins[j]);
+					}
+					updates[i] = ratioSum;
+				}
+				else
+				{
+					updates[i] = getRatio(updates[i], bins[i]);
+				}
+			}
+			if (psfManager != nullptr)
+			{
+				// The backprojection uses the flipped kernels
+				psfManager->getKernels(properties, offset, true);
+			}
+			projector->backProjectionBatch(destImagePtr, properties,
+			                               updates.data());
 		}
+	}
+}
+
+void OSEMUpdater_CPU::computeEMUpdateImage2D(const Image& inputImage,
+                                             Image& destImage) const
+{
+	const OperatorProjector* projector = mp_osem->getProjector();
+	const ProjectionData* measurements = mp_osem->getDataInput();
+	const Corrector_CPU& corrector = mp_osem->getCorrector_CPU();
+	const Corrector_CPU* correctorPtr = &corrector;
+	const Image* inputImagePtr = &inputImage;
+	Image* destImagePtr = &destImage;
 
-		if (hasInVivoAttenuation)
+	const bool hasAdditiveCorrection = corrector.hasAdditiveCorrection();
+	const bool hasInVivoAttenuation = corrector.hasInVivoAttenuation();
+
+	// The slices are independent, each one is processed by a single thread
+	const std::vector<std::vector<bin_t>> binsPerSlice =
+	    projector->getBinsPerSlice(measurements, inputImage.getParams());
+	const int numSlices = static_cast<int>(binsPerSlice.size());
+	const std::vector<bin_t>* binsPerSlicePtr = binsPerSlice.data();
+
+#pragma omp parallel default(none)                                       \
+    firstprivate(hasAdditiveCorrection, hasInVivoAttenuation,           \
+                     binsPerSlicePtr, numSlices, measurements, projector, \
+                     correctorPtr, destImagePtr, inputImagePtr)
+	{
+		ProjectionPropertiesBatch properties;
+		float updates[OperatorProjector::BinBlockSize];
+#pragma omp for schedule(dynamic)
+		for (int slice = 0; slice < numSlices; slice++)
 		{
-			update *= correctorPtr->getInVivoAttenuationFactor(bin);
+			const std::vector<bin_t>& bins = binsPerSlicePtr[slice];
+			for (size_t first = 0; first < bins.size();
+			     first += OperatorProjector::BinBlockSize)
+			{
+				const size_t blockSize = std::min(
+				    OperatorProjector::BinBlockSize, bins.size() - first);
+				measurements->getProjectionProperties(bins.data() + first,
+				                                      blockSize, properties);
+				projector->forwardProjection2DBatch(inputImagePtr, properties,
+				                                    slice, updates);
+				for (size_t i = 0; i < blockSize; i++)
+				{
+					const bin_t bin = bins[first + i];
+					float update = updates[i];
+
+					if (hasAdditiveCorrection)
+					{
+						update += correctorPtr->getAdditiveCorrectionFactor(bin);
+					}
+
+					if (hasInVivoAttenuation)
+					{
+						update *= correctorPtr->getInVivoAttenuationFactor(bin);
+					}
+
+					// The ratio is left to zero to prevent numerical
+					// instability
+					updates[i] = 0.0f;
+					if (update > 1e-8)
+					{
+						const float measurement =
+						    measurements->getProjectionValue(bin);
+
+						updates[i] = measurement / update;
+					}
+				}
+				projector->backProjection2DBatch(destImagePtr, properties,
+				                                 slice, updates);
+			}
 		}
+	}
+}
 
-		if (update > 1e-8)  // to prevent numerical instability
+void OSEMUpdater_CPU::computeEMUpdateImageTOFBins(const Image& inputImage,
+                                                  Image& destImage) const
+{
+	const OperatorProjector* projector = mp_osem->getProjector();
+	const BinIterator* binIter = projector->getBinIter();
+	const ProjectionData* measurements = mp_osem->getDataInput();
+	const Corrector_CPU& corrector = mp_osem->getCorrector_CPU();
+	const Corrector_CPU* correctorPtr = &corrector;
+	const Image* inputImagePtr = &inputImage;
+	Image* destImagePtr = &destImage;
+
+	const bool hasAdditiveCorrection = corrector.hasAdditiveCorrection();
+	const bool hasInVivoAttenuation = corrector.hasInVivoAttenuation();
+
+	ASSERT_MSG(projector->getTOFHelper() != nullptr,
+	           "TOF-binned data requires the TOF to be set up in the "
+	           "projector");
+
+	// As in OperatorProjector::applyA, all the TOF bins of a LOR are
+	// projected at once, with the probability integrated over each bin
+	const int numTOFBins = static_cast<int>(measurements->getNumTOFBins());
+	const float tofBinWidth_ps = measurements->getTOFBinWidth();
+	const bin_t numLORs = binIter->size() / numTOFBins;
+
+#pragma omp parallel default(none)                                         \
+    firstprivate(hasAdditiveCorrection, hasInVivoAttenuation, binIter,    \
+                     measurements, projector, correctorPtr, destImagePtr, \
+                     inputImagePtr, numTOFBins, tofBinWidth_ps, numLORs)
+	{
+		float updates[TimeOfFlightHelper::MaxNumTOFBins];
+#pragma omp for
+		for (bin_t lorIdx = 0; lorIdx < numLORs; lorIdx++)
 		{
-			const float measurement = measurements->getProjectionValue(bin);
+			const bin_t first = lorIdx * numTOFBins;
+			const ProjectionProperties projectionProperties =
+			    measurements->getProjectionProperties(binIter->get(first));
+			projector->forwardProjectionTOFBins(inputImagePtr,
+			                                    projectionProperties,
+			                                    numTOFBins, tofBinWidth_ps,
+			                                    updates);
+
+			bool isNull = true;
+			for (int t = 0; t < numTOFBins; t++)
+			{
+				const bin_t bin = binIter->get(first + t);
+				float update = updates[t];
+
+				if (hasAdditiveCorrection)
+				{
+					update += correctorPtr->getAdditiveCorrectionFactor(bin);
+				}
 
-			update = measurement / update;
+				if (hasInVivoAttenuation)
+				{
+					update *= correctorPtr->getInVivoAttenuationFactor(bin);
+				}
 
-			projector->backProjection(destImagePtr, projectionProperties,
-			                          update);
+				// The ratio is left to zero to prevent numerical instability
+				updates[t] = 0.0f;
+				if (update > 1e-8)
+				{
+					updates[t] = measurements->getProjectionValue(bin) / update;
+					isNull = isNull && updates[t] == 0.0f;
+				}
+			}
+			if (!isNull)
+			{
+				projector->backProjectionTOFBins(destImagePtr,
+				                                 projectionProperties,
+				                                 numTOFBins, tofBinWidth_ps,
+				                                 updates);
+			}
 		}
 	}
 }
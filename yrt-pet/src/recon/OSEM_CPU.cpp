@@ -184,7 +184,8 @@ void OSEM_CPU::setupOperatorsForRecon()
 	OperatorProjectorParams projParams(
 	    nullptr /* Will be set later at each subset loading */, scanner,
 	    flagProjTOF ? tofWidth_ps : 0.f, flagProjTOF ? tofNumStd : 0,
-	    flagProjPSF ? projSpacePsf_fname : "", numRays);
+	    flagProjPSF ? projSpacePsf_fname : "", numRays,
+	    flagProjTOF ? tofLUTSamplesPerStd : 0);
 
 	if (projectorType == OperatorProjector::SIDDON)
 	{
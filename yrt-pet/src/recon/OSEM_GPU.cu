@@ -135,7 +135,8 @@ void OSEM_GPU::setupOperatorsForRecon()
 	OperatorProjectorParams projParams(
 	    nullptr /* Will be set later at each subset loading */, scanner,
 	    flagProjTOF ? tofWidth_ps : 0.f, flagProjTOF ? tofNumStd : 0,
-	    flagProjPSF ? projSpacePsf_fname : "", numRays);
+	    flagProjPSF ? projSpacePsf_fname : "", numRays,
+	    flagProjTOF ? tofLUTSamplesPerStd : 0);
 
 	mp_projector = std::make_unique<OperatorProjectorDD_GPU>(
 	    projParams, getMainStream(), getAuxStream());
@@ -377,6 +378,13 @@ void OSEM_GPU::addImagePSF(const std::string& p_imageSpacePsf_fname)
 	flagImagePSF = true;
 }
 
+void OSEM_GPU::addImageVarPSF(const std::string& p_imageSpaceVarPsf_fname)
+{
+	(void)p_imageSpaceVarPsf_fname;
+	throw std::runtime_error(
+	    "The spatially-variant Image-space PSF is not supported on GPU");
+}
+
 void OSEM_GPU::completeMLEMIteration() {}
 
 void OSEM_GPU::computeEMUpdateImage(const ImageBase& inputImage,
@@ -12,6 +12,9 @@
 #include "utils/Assert.hpp"
 #include "utils/ReconstructionUtils.hpp"
 
+#include <tuple>
+#include <vector>
+
 #if BUILD_PYBIND11
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
@@ -24,29 +27,111 @@ void py_setup_scatterestimator(py::module& m)
 	c.def(py::init<const Scanner&, const Image&, const Image&,
 	               const Histogram3D*, const Histogram3D*, const Histogram3D*,
 	               const Histogram3D*, Scatter::CrystalMaterial, int, int,
-	               float, const std::string&>(),
+	               float, const std::string&, int, bool>(),
 	      "scanner"_a, "source_image"_a, "attenuation_image"_a, "prompts_his"_a,
 	      "randoms_his"_a, "acf_his"_a, "sensitivity_his"_a,
 	      "crystal_material"_a = Scatter::ScatterEstimator::DefaultCrystal,
 	      "seed"_a = Scatter::ScatterEstimator::DefaultSeed,
 	      "mask_width"_a = -1,
 	      "mask_threshold"_a = Scatter::ScatterEstimator::DefaultACFThreshold,
-	      "save_intermediary"_a = "");
+	      "save_intermediary"_a = "",
+	      "image_downsampling"_a =
+	          Scatter::ScatterEstimator::DefaultImageDownsampling,
+	      "smooth_interpolation"_a = false);
 
 	c.def("computeTailFittedScatterEstimate",
 	      &Scatter::ScatterEstimator::computeTailFittedScatterEstimate,
 	      "num_z"_a, "num_phi"_a, "num_r"_a);
+	c.def("updateTailFittedScatterEstimate",
+	      &Scatter::ScatterEstimator::updateTailFittedScatterEstimate,
+	      "scatter_estimate"_a, "num_z"_a, "num_phi"_a, "num_r"_a);
 	c.def("computeScatterEstimate",
 	      &Scatter::ScatterEstimator::computeScatterEstimate, "num_z"_a,
 	      "num_phi"_a, "num_r"_a);
+	c.def("computeTailFittedTOFScatterEstimate",
+	      &Scatter::ScatterEstimator::computeTailFittedTOFScatterEstimate,
+	      "num_z"_a, "num_phi"_a, "num_r"_a, "num_tof_bins"_a,
+	      "tof_bin_width_ps"_a, "tof_width_ps"_a, "tof_n_std"_a = -1);
+	c.def("updateTailFittedTOFScatterEstimate",
+	      &Scatter::ScatterEstimator::updateTailFittedTOFScatterEstimate,
+	      "scatter_estimate"_a, "num_z"_a, "num_phi"_a, "num_r"_a,
+	      "tof_width_ps"_a, "tof_n_std"_a = -1);
+	c.def("computeTOFScatterEstimate",
+	      &Scatter::ScatterEstimator::computeTOFScatterEstimate, "num_z"_a,
+	      "num_phi"_a, "num_r"_a, "num_tof_bins"_a, "tof_bin_width_ps"_a,
+	      "tof_width_ps"_a, "tof_n_std"_a = -1);
 	c.def("generateScatterTailsMask",
 	      &Scatter::ScatterEstimator::generateScatterTailsMask);
+	c.def("setSourceImage", &Scatter::ScatterEstimator::setSourceImage,
+	      "source_image"_a);
+	c.def("getSourceImage", &Scatter::ScatterEstimator::getSourceImage,
+	      py::return_value_policy::reference_internal);
+	c.def("setCacheDetectorTables",
+	      &Scatter::ScatterEstimator::setCacheDetectorTables,
+	      "cache_tables"_a);
+	c.def("isCacheDetectorTables",
+	      &Scatter::ScatterEstimator::isCacheDetectorTables);
 	c.def("computeTailFittingFactor",
-	      &Scatter::ScatterEstimator::computeTailFittingFactor,
+	      static_cast<float (Scatter::ScatterEstimator::*)(
+	          const Histogram3D*, const Histogram3D*) const>(
+	          &Scatter::ScatterEstimator::computeTailFittingFactor),
 	      "scatter_histogram"_a, "scatter_tails_mask"_a);
+	c.def("computeTailFittingFactor",
+	      static_cast<float (Scatter::ScatterEstimator::*)(
+	          const Histogram3D*) const>(
+	          &Scatter::ScatterEstimator::computeTailFittingFactor),
+	      "scatter_histogram"_a);
 }
 #endif
 
+namespace
+{
+	bool isAboveACFThreshold(float acfValue, float maskThreshold)
+	{
+		return acfValue == 0.0 /* For invalid acf bins */ ||
+		       acfValue > maskThreshold;
+	}
+
+	// Range [rBegin, rEnd) of a sinogram row in which the scatter tails mask
+	// can be on: the bins above the ACF threshold that are at most maskWidth
+	// bins away from the bins below it. Empty if there are none below it
+	std::pair<size_t, size_t> getScatterTailsRange(const float* acfRow,
+	                                               size_t numR,
+	                                               size_t maskWidth,
+	                                               float maskThreshold)
+	{
+		size_t rFirst = 0;
+		while (rFirst < numR &&
+		       isAboveACFThreshold(acfRow[rFirst], maskThreshold))
+		{
+			rFirst++;
+		}
+		if (rFirst == numR)
+		{
+			return {0, 0};
+		}
+		size_t rLast = numR - 1;
+		while (isAboveACFThreshold(acfRow[rLast], maskThreshold))
+		{
+			rLast--;
+		}
+		const size_t rBegin = (rFirst > maskWidth) ? rFirst - maskWidth : 0;
+		const size_t rEnd = std::min(rLast + maskWidth, numR);
+		return {rBegin, rEnd};
+	}
+
+	// Sinogram row of a histogram, read through getProjectionValue so that
+	// every storage variant of Histogram3D can be used
+	void readRow(const Histogram3D& histo, bin_t rowStart, size_t numR,
+	             float* row)
+	{
+		for (size_t r = 0; r < numR; r++)
+		{
+			row[r] = histo.getProjectionValue(rowStart + r);
+		}
+	}
+}  // namespace
+
 namespace Scatter
 {
 	ScatterEstimator::ScatterEstimator(
@@ -54,9 +139,23 @@ namespace Scatter
 	    const Histogram3D* pp_promptsHis, const Histogram3D* pp_randomsHis,
 	    const Histogram3D* pp_acfHis, const Histogram3D* pp_sensitivityHis,
 	    CrystalMaterial p_crystalMaterial, int seedi, int maskWidth,
-	    float maskThreshold, const std::string& saveIntermediary_dir)
+	    float maskThreshold, const std::string& saveIntermediary_dir,
+	    int imageDownsampling, bool smoothInterpolation)
 	    : mr_scanner(pr_scanner),
-	      m_sss(pr_scanner, pr_mu, pr_lambda, p_crystalMaterial, seedi)
+	      mp_lambda(&pr_lambda),
+	      mp_lambdaDownsampled(imageDownsampling > 1 ?
+	                               pr_lambda.downsample(imageDownsampling) :
+	                               nullptr),
+	      mp_muDownsampled(imageDownsampling > 1 ?
+	                           pr_mu.downsample(imageDownsampling) :
+	                           nullptr),
+	      m_sss(pr_scanner,
+	            (mp_muDownsampled != nullptr) ? *mp_muDownsampled : pr_mu,
+	            (mp_lambdaDownsampled != nullptr) ? *mp_lambdaDownsampled :
+	                                                pr_lambda,
+	            p_crystalMaterial, seedi),
+	      m_imageDownsampling(imageDownsampling),
+	      m_smoothInterpolation(smoothInterpolation)
 	{
 		mp_promptsHis = pp_promptsHis;
 		mp_randomsHis = pp_randomsHis;
@@ -73,6 +172,7 @@ namespace Scatter
 		}
 		m_maskThreshold = maskThreshold;
 		m_saveIntermediary_dir = saveIntermediary_dir;
+		m_isScatterTailsMaskSaved = false;
 	}
 
 	std::unique_ptr<Histogram3DOwned>
@@ -80,21 +180,28 @@ namespace Scatter
 	                                                       size_t numberPhi,
 	                                                       size_t numberR)
 	{
-		auto scatterEstimate =
-		    computeScatterEstimate(numberZ, numberPhi, numberR);
+		auto scatterEstimate = std::make_unique<Histogram3DOwned>(mr_scanner);
+		scatterEstimate->allocate();
+		updateTailFittedScatterEstimate(*scatterEstimate, numberZ, numberPhi,
+		                                numberR);
+		return scatterEstimate;
+	}
 
-		const auto scatterTailsMask = generateScatterTailsMask();
-		if (!m_saveIntermediary_dir.empty())
-		{
-			scatterTailsMask->writeToFile(m_saveIntermediary_dir /
-			                              "intermediary_scatterTailsMask.his");
-		}
+	void ScatterEstimator::updateTailFittedScatterEstimate(
+	    Histogram3D& scatterEstimate, size_t numberZ, size_t numberPhi,
+	    size_t numberR)
+	{
+		ASSERT_MSG(scatterEstimate.isMemoryValid(),
+		           "Scatter histogram is unallocated or unbound");
+		scatterEstimate.clearProjections(0.0f);
+		m_sss.runSSS(numberZ, numberPhi, numberR, scatterEstimate,
+		             m_smoothInterpolation);
 
-		const float fac = computeTailFittingFactor(scatterEstimate.get(),
-		                                           scatterTailsMask.get());
+		saveScatterTailsMask();
+		const float fac = computeTailFittingFactor(&scatterEstimate);
 
 		std::cout << "Applying tail-fit factor..." << std::endl;
-		scatterEstimate->getData() *= fac;
+		scatterEstimate.getData() *= fac;
 
 		if (mp_sensitivityHis != nullptr)
 		{
@@ -103,15 +210,13 @@ namespace Scatter
 			//  multiply it with the sensitivity again before using it in the
 			//  reconstruction
 			std::cout << "Denormalize scatter histogram..." << std::endl;
-			scatterEstimate->operationOnEachBinParallel(
+			scatterEstimate.operationOnEachBinParallel(
 			    [this, &scatterEstimate](bin_t bin) -> float
 			    {
 				    return mp_sensitivityHis->getProjectionValue(bin) *
-				           scatterEstimate->getProjectionValue(bin);
+				           scatterEstimate.getProjectionValue(bin);
 			    });
 		}
-
-		return scatterEstimate;
 	}
 
 	std::unique_ptr<Histogram3DOwned> ScatterEstimator::computeScatterEstimate(
@@ -121,7 +226,75 @@ namespace Scatter
 		scatterHisto->allocate();
 		scatterHisto->clearProjections();
 
-		m_sss.runSSS(numberZ, numberPhi, numberR, *scatterHisto);
+		m_sss.runSSS(numberZ, numberPhi, numberR, *scatterHisto,
+		             m_smoothInterpolation);
+
+		return scatterHisto;
+	}
+
+	std::unique_ptr<TOFHistogram3DOwned>
+	    ScatterEstimator::computeTailFittedTOFScatterEstimate(
+	        size_t numberZ, size_t numberPhi, size_t numberR,
+	        size_t numTOFBins, float tofBinWidth_ps, float tofWidth_ps,
+	        int tofNumStd)
+	{
+		auto scatterEstimate = std::make_unique<TOFHistogram3DOwned>(
+		    mr_scanner, numTOFBins, tofBinWidth_ps);
+		scatterEstimate->allocate();
+		updateTailFittedTOFScatterEstimate(*scatterEstimate, numberZ,
+		                                   numberPhi, numberR, tofWidth_ps,
+		                                   tofNumStd);
+		return scatterEstimate;
+	}
+
+	void ScatterEstimator::updateTailFittedTOFScatterEstimate(
+	    TOFHistogram3D& scatterEstimate, size_t numberZ, size_t numberPhi,
+	    size_t numberR, float tofWidth_ps, int tofNumStd)
+	{
+		ASSERT_MSG(scatterEstimate.isMemoryValid(),
+		           "Scatter histogram is unallocated or unbound");
+		scatterEstimate.clearProjections(0.0f);
+		m_sss.runSSS(numberZ, numberPhi, numberR, scatterEstimate, tofWidth_ps,
+		             tofNumStd, m_smoothInterpolation);
+
+		// The prompts are not TOF-binned
+		auto scatterEstimateSum =
+		    std::make_unique<Histogram3DOwned>(mr_scanner);
+		scatterEstimateSum->allocate();
+		scatterEstimate.collapseToHistogram3D(*scatterEstimateSum);
+		saveScatterTailsMask();
+		const float fac = computeTailFittingFactor(scatterEstimateSum.get());
+
+		std::cout << "Applying tail-fit factor..." << std::endl;
+		scatterEstimate.getData() *= fac;
+
+		if (mp_sensitivityHis != nullptr)
+		{
+			std::cout << "Denormalize scatter histogram..." << std::endl;
+			scatterEstimate.operationOnEachBinParallel(
+			    [this, &scatterEstimate](bin_t bin) -> float
+			    {
+				    const bin_t histo3dBin =
+				        scatterEstimate.getHistogram3DBinId(bin);
+				    return mp_sensitivityHis->getProjectionValue(histo3dBin) *
+				           scatterEstimate.getProjectionValue(bin);
+			    });
+		}
+	}
+
+	std::unique_ptr<TOFHistogram3DOwned>
+	    ScatterEstimator::computeTOFScatterEstimate(
+	        size_t numberZ, size_t numberPhi, size_t numberR,
+	        size_t numTOFBins, float tofBinWidth_ps, float tofWidth_ps,
+	        int tofNumStd)
+	{
+		auto scatterHisto = std::make_unique<TOFHistogram3DOwned>(
+		    mr_scanner, numTOFBins, tofBinWidth_ps);
+		scatterHisto->allocate();
+		scatterHisto->clearProjections(0.0f);
+
+		m_sss.runSSS(numberZ, numberPhi, numberR, *scatterHisto, tofWidth_ps,
+		             tofNumStd, m_smoothInterpolation);
 
 		return scatterHisto;
 	}
@@ -139,46 +312,174 @@ namespace Scatter
 		return scatterTailsMask;
 	}
 
+	void ScatterEstimator::saveScatterTailsMask()
+	{
+		if (!m_saveIntermediary_dir.empty() && !m_isScatterTailsMaskSaved)
+		{
+			const auto scatterTailsMask = generateScatterTailsMask();
+			scatterTailsMask->writeToFile(m_saveIntermediary_dir /
+			                              "intermediary_scatterTailsMask.his");
+			m_isScatterTailsMaskSaved = true;
+		}
+	}
+
+	void ScatterEstimator::setSourceImage(const Image& pr_lambda)
+	{
+		mp_lambda = &pr_lambda;
+		if (m_imageDownsampling > 1)
+		{
+			mp_lambdaDownsampled = pr_lambda.downsample(m_imageDownsampling);
+			m_sss.setSourceImage(*mp_lambdaDownsampled);
+		}
+		else
+		{
+			m_sss.setSourceImage(pr_lambda);
+		}
+	}
+
+	const Image& ScatterEstimator::getSourceImage() const
+	{
+		return *mp_lambda;
+	}
+
+	void ScatterEstimator::setCacheDetectorTables(bool cacheTables)
+	{
+		m_sss.setCacheDetectorTables(cacheTables);
+	}
+
+	bool ScatterEstimator::isCacheDetectorTables() const
+	{
+		return m_sss.isCacheDetectorTables();
+	}
+
 	float ScatterEstimator::computeTailFittingFactor(
 	    const Histogram3D* scatterHistogram,
 	    const Histogram3D* scatterTailsMask) const
 	{
-		std::cout << "Computing Tail-fit factor..." << std::endl;
 		ASSERT_MSG(scatterHistogram->count() == scatterTailsMask->count(),
 		           "Size mismatch between input histograms");
-		double scatterSum = 0.0f;
-		double promptsSum = 0.0f;
+		return fitScatterTails(*scatterHistogram, scatterTailsMask);
+	}
 
-		for (bin_t bin = 0; bin < scatterHistogram->count(); bin++)
+	float ScatterEstimator::computeTailFittingFactor(
+	    const Histogram3D* scatterHistogram) const
+	{
+		return fitScatterTails(*scatterHistogram, nullptr);
+	}
+
+	float ScatterEstimator::fitScatterTails(
+	    const Histogram3D& scatterHistogram,
+	    const Histogram3D* scatterTailsMask) const
+	{
+		std::cout << "Computing Tail-fit factor..." << std::endl;
+		ASSERT_MSG(scatterHistogram.count() == mp_promptsHis->count(),
+		           "Size mismatch between input histograms");
+		const size_t numR = mp_promptsHis->numR;
+		const size_t numRows = mp_promptsHis->count() / numR;
+		const size_t maskWidth = m_scatterTailsMaskWidth;
+		const float maskThreshold = m_maskThreshold;
+
+		const Histogram3D* prompts = mp_promptsHis;
+		const Histogram3D* randoms = mp_randomsHis;
+		const Histogram3D* sensitivity = mp_sensitivityHis;
+		const Histogram3D* scatter = &scatterHistogram;
+		const Histogram3D* mask = scatterTailsMask;
+		const Histogram3D* acf = (mask == nullptr) ? mp_acfHis : nullptr;
+
+		std::vector<double> rowPromptsSums(numRows);
+		std::vector<double> rowScatterSums(numRows);
+		double* rowPromptsSums_ptr = rowPromptsSums.data();
+		double* rowScatterSums_ptr = rowScatterSums.data();
+
+#pragma omp parallel default(none)                                          \
+    firstprivate(numR, numRows, maskWidth, maskThreshold, prompts, randoms, \
+                     sensitivity, scatter, mask, acf, rowPromptsSums_ptr,   \
+                     rowScatterSums_ptr)
 		{
-			// Only fit inside the mask
-			if (scatterTailsMask->getProjectionValue(bin) > 0.0f)
+			// Rows of the histograms used in the fit
+			std::vector<float> promptsRow(numR);
+			std::vector<float> randomsRow(numR);
+			std::vector<float> sensitivityRow(numR);
+			std::vector<float> scatterRow(numR);
+			std::vector<float> maskRow(numR);
+
+#pragma omp for
+			for (size_t row = 0; row < numRows; row++)
 			{
-				float binValue = mp_promptsHis->getProjectionValue(bin);
-				if (mp_randomsHis != nullptr)
+				const bin_t rowStart = row * numR;
+				size_t rBegin = 0;
+				size_t rEnd = numR;
+				// With no mask given, it is evaluated from the ACFs
+				readRow(mask != nullptr ? *mask : *acf, rowStart, numR,
+				        maskRow.data());
+				if (mask == nullptr)
+				{
+					std::tie(rBegin, rEnd) = getScatterTailsRange(
+					    maskRow.data(), numR, maskWidth, maskThreshold);
+				}
+				if (rBegin == rEnd)
+				{
+					rowPromptsSums_ptr[row] = 0.0;
+					rowScatterSums_ptr[row] = 0.0;
+					continue;
+				}
+				readRow(*prompts, rowStart, numR, promptsRow.data());
+				readRow(*scatter, rowStart, numR, scatterRow.data());
+				if (randoms != nullptr)
+				{
+					readRow(*randoms, rowStart, numR, randomsRow.data());
+				}
+				if (sensitivity != nullptr)
 				{
-					binValue -= mp_randomsHis->getProjectionValue(bin);
+					readRow(*sensitivity, rowStart, numR,
+					        sensitivityRow.data());
 				}
-				if (mp_sensitivityHis != nullptr)
+				double promptsSum = 0.0;
+				double scatterSum = 0.0;
+				for (size_t r = rBegin; r < rEnd; r++)
 				{
-					const float sensitivityVal =
-					    mp_sensitivityHis->getProjectionValue(bin);
-					if (sensitivityVal > 1e-8)
+					// Only fit inside the mask
+					const bool inMask =
+					    (mask != nullptr) ?
+					        maskRow[r] > 0.0f :
+					        isAboveACFThreshold(maskRow[r], maskThreshold);
+					if (!inMask)
 					{
-						binValue /= sensitivityVal;
+						continue;
 					}
-					else
+					float binValue = promptsRow[r];
+					if (randoms != nullptr)
 					{
-						// Ignore zero bins altogether to avoid numerical
-						// instability
-						continue;
+						binValue -= randomsRow[r];
 					}
+					if (sensitivity != nullptr)
+					{
+						if (sensitivityRow[r] > 1e-8)
+						{
+							binValue /= sensitivityRow[r];
+						}
+						else
+						{
+							// Ignore zero bins altogether to avoid numerical
+							// instability
+							continue;
+						}
+					}
+					promptsSum += binValue;
+					scatterSum += scatterRow[r];
 				}
-
-				promptsSum += binValue;
-				scatterSum += scatterHistogram->getProjectionValue(bin);
+				rowPromptsSums_ptr[row] = promptsSum;
+				rowScatterSums_ptr[row] = scatterSum;
 			}
 		}
+
+		double promptsSum = 0.0;
+		double scatterSum = 0.0;
+		for (size_t row = 0; row < numRows; row++)
+		{
+			promptsSum += rowPromptsSums[row];
+			scatterSum += rowScatterSums[row];
+		}
 		const float fac = promptsSum / scatterSum;
 		std::cout << "Tail-fitting factor: " << fac << std::endl;
 		return fac;
@@ -189,81 +490,32 @@ namespace Scatter
 	                                            size_t maskWidth,
 	                                            float maskThreshold)
 	{
-		const size_t numBins = acfHis.count();
 		ASSERT(mask.isMemoryValid());
-		mask.clearProjections(0.0f);
+		ASSERT_MSG(mask.count() == acfHis.count(),
+		           "Size mismatch between input histograms");
+		const size_t numR = acfHis.numR;
+		const size_t numRows = acfHis.count() / numR;
+		const Histogram3D* acf = &acfHis;
+		float* maskData = mask.getData().getRawPointer();
 
-		for (bin_t binId = 0; binId < numBins; binId++)
+#pragma omp parallel default(none) \
+    firstprivate(numR, numRows, maskWidth, maskThreshold, acf, maskData)
 		{
-			const float acfValue = acfHis.getProjectionValue(binId);
-			const bool initValueOn =
-			    acfValue == 0.0 /* For invalid acf bins */ ||
-			    acfValue > maskThreshold;
-			mask.setProjectionValue(binId, initValueOn ? 1.0f : 0.0f);
-		}
+			std::vector<float> acfRow(numR);
 
-		for (size_t zBin = 0; zBin < acfHis.numZBin; zBin++)
-		{
-			for (size_t phi = 0; phi < acfHis.numPhi; phi++)
+#pragma omp for
+			for (size_t row = 0; row < numRows; row++)
 			{
-				const size_t initRowBinId =
-				    acfHis.getBinIdFromCoords(0, phi, zBin);
-
-				// Process beginning of the mask
-				size_t r;
-				for (r = 0; r < acfHis.numR; r++)
+				const bin_t rowStart = row * numR;
+				readRow(*acf, rowStart, numR, acfRow.data());
+				const auto [rBegin, rEnd] = getScatterTailsRange(
+				    acfRow.data(), numR, maskWidth, maskThreshold);
+				for (size_t r = 0; r < numR; r++)
 				{
-					const bin_t binId = initRowBinId + r;
-					if (mask.getProjectionValue(binId) < 1.0f)
-					{
-						if (r > maskWidth)
-						{
-							// Put zeros from the beginning of the row to the
-							// current position minus the width of the mask
-							for (bin_t newBinId = initRowBinId;
-							     newBinId < binId - maskWidth; newBinId++)
-							{
-								mask.setProjectionValue(newBinId, 0.0f);
-							}
-						}
-						break;
-					}
-				}
-
-				// For when the line is true everywhere
-				if (r == acfHis.numR)
-				{
-					for (bin_t binId = initRowBinId;
-					     binId < initRowBinId + acfHis.numR; binId++)
-					{
-						mask.setProjectionValue(binId, 0.0f);
-					}
-					continue;
-				}
-
-				// Process end of the mask
-				const long lastRValue = static_cast<long>(acfHis.numR - 1);
-				for (long reverseR = lastRValue; reverseR >= 0; reverseR--)
-				{
-					const bin_t binId = initRowBinId + reverseR;
-					if (mask.getProjectionValue(binId) < 1.0f)
-					{
-						if (reverseR <
-						    static_cast<long>(acfHis.numR - maskWidth))
-						{
-							// Put zeros from the end of the row to the
-							// current position plus the width of the mask
-							for (long newR = lastRValue;
-							     newR >=
-							     static_cast<long>(reverseR + maskWidth);
-							     newR--)
-							{
-								const bin_t newBinId = newR + initRowBinId;
-								mask.setProjectionValue(newBinId, 0.0f);
-							}
-						}
-						break;
-					}
+					const bool inMask =
+					    r >= rBegin && r < rEnd &&
+					    isAboveACFThreshold(acfRow[r], maskThreshold);
+					maskData[rowStart + r] = inMask ? 1.0f : 0.0f;
 				}
 			}
 		}
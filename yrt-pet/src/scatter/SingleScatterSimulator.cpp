@@ -7,9 +7,11 @@
 
 #include "datastruct/image/Image.hpp"
 #include "datastruct/projection/Histogram3D.hpp"
+#include "datastruct/projection/TOFHistogram3D.hpp"
 #include "datastruct/scanner/Scanner.hpp"
 #include "geometry/Constants.hpp"
 #include "operators/OperatorProjectorSiddon.hpp"
+#include "operators/TimeOfFlight.hpp"
 #include "utils/Assert.hpp"
 #include "utils/Globals.hpp"
 #include "utils/ProgressDisplayMultiThread.hpp"
@@ -17,6 +19,8 @@
 #include "utils/Tools.hpp"
 
 #include "omp.h"
+#include <algorithm>
+#include <unordered_map>
 
 
 #if BUILD_PYBIND11
@@ -33,11 +37,38 @@ void py_setup_singlescattersimulator(py::module& m)
 	               Scatter::CrystalMaterial, int>(),
 	      "scanner"_a, "attenuation_image"_a, "source_image"_a,
 	      "crystal_material"_a, "seed"_a);
-	c.def("runSSS", &Scatter::SingleScatterSimulator::runSSS, "num_z"_a,
-	      "num_phi"_a, "num_r"_a, "scatter_histo"_a);
+	c.def("runSSS",
+	      static_cast<void (Scatter::SingleScatterSimulator::*)(
+	          size_t, size_t, size_t, Histogram3D&, bool)>(
+	          &Scatter::SingleScatterSimulator::runSSS),
+	      "num_z"_a, "num_phi"_a, "num_r"_a, "scatter_histo"_a,
+	      "smooth_interpolation"_a = false);
+	c.def("runSSS",
+	      static_cast<void (Scatter::SingleScatterSimulator::*)(
+	          size_t, size_t, size_t, TOFHistogram3D&, float, int, bool)>(
+	          &Scatter::SingleScatterSimulator::runSSS),
+	      "num_z"_a, "num_phi"_a, "num_r"_a, "scatter_histo"_a,
+	      "tof_width_ps"_a, "tof_n_std"_a = -1,
+	      "smooth_interpolation"_a = false);
 	c.def("computeSingleScatterInLOR",
-	      &Scatter::SingleScatterSimulator::computeSingleScatterInLOR, "lor"_a,
-	      "n1"_a, "n2"_a);
+	      static_cast<float (Scatter::SingleScatterSimulator::*)(
+	          const Line3D&, const Vector3D&, const Vector3D&) const>(
+	          &Scatter::SingleScatterSimulator::computeSingleScatterInLOR),
+	      "lor"_a, "n1"_a, "n2"_a);
+	c.def("computeSingleScatterInLOR",
+	      static_cast<std::vector<float> (Scatter::SingleScatterSimulator::*)(
+	          const Line3D&, const Vector3D&, const Vector3D&,
+	          const TimeOfFlightHelper&, int, float) const>(
+	          &Scatter::SingleScatterSimulator::computeSingleScatterInLOR),
+	      "lor"_a, "n1"_a, "n2"_a, "tof_helper"_a, "num_tof_bins"_a,
+	      "tof_bin_width_ps"_a);
+	c.def("setSourceImage", &Scatter::SingleScatterSimulator::setSourceImage,
+	      "source_image"_a);
+	c.def("setCacheDetectorTables",
+	      &Scatter::SingleScatterSimulator::setCacheDetectorTables,
+	      "cache_tables"_a);
+	c.def("isCacheDetectorTables",
+	      &Scatter::SingleScatterSimulator::isCacheDetectorTables);
 	c.def("getSamplePoint", &Scatter::SingleScatterSimulator::getSamplePoint,
 	      "i"_a);
 	c.def("getNumSamples", &Scatter::SingleScatterSimulator::getNumSamples);
@@ -51,9 +82,10 @@ namespace Scatter
 	SingleScatterSimulator::SingleScatterSimulator(
 	    const Scanner& pr_scanner, const Image& pr_mu, const Image& pr_lambda,
 	    CrystalMaterial p_crystalMaterial, int seedi)
-	    : mr_scanner(pr_scanner),
+	    : m_cacheTables(false),
+	      mr_scanner(pr_scanner),
 	      mr_mu(pr_mu),
-	      mr_lambda(pr_lambda),
+	      mp_lambda(&pr_lambda),
 	      m_crystalMaterial(p_crystalMaterial)
 	{
 		const ImageParams& mu_params = mr_mu.getParams();
@@ -68,6 +100,8 @@ namespace Scatter
 		m_axialFOV = mr_scanner.axialFOV;            // YP Axial FOV
 		m_collimatorRadius = mr_scanner.collimatorRadius;  // YP no need?
 
+		computeEnergyTables();
+
 		const Vector3D c{0., 0., 0.};
 		// YP: creates 2 cylinders of axial extent "afov" in millimiters xs
 		m_cyl1 = Cylinder{c, m_axialFOV, m_scannerRadius};
@@ -105,6 +139,7 @@ namespace Scatter
 		m_xSamples.reserve(nzsamp * nysamp * nxsamp);
 		m_ySamples.reserve(nzsamp * nysamp * nxsamp);
 		m_zSamples.reserve(nzsamp * nysamp * nxsamp);
+		m_muSamples.reserve(nzsamp * nysamp * nxsamp);
 		// YP spacing between scatter points
 		const float dxsamp = mu_params.length_x / (static_cast<float>(nxsamp));
 		const float dysamp = mu_params.length_y / (static_cast<float>(nysamp));
@@ -113,6 +148,7 @@ namespace Scatter
 		m_xSamples.clear();
 		m_ySamples.clear();
 		m_zSamples.clear();
+		m_muSamples.clear();
 		for (int k = 0; k < nzsamp; k++)
 		{
 			const float z =
@@ -135,7 +171,8 @@ namespace Scatter
 					const float z2 = ran1(&seed) * dzsamp + z;
 					// YP generate a random scatter poitn within its cell
 					p.update(x2, y2, z2);
-					if (mr_mu.nearestNeighbor(p) > 0.005)
+					const float mu = mr_mu.nearestNeighbor(p);
+					if (mu > 0.005)
 					{
 						// YP rejects the point if the associated att. coeff is
 						// below
@@ -144,6 +181,7 @@ namespace Scatter
 						m_xSamples.push_back(x2);
 						m_ySamples.push_back(y2);
 						m_zSamples.push_back(z2);
+						m_muSamples.push_back(mu);
 					}
 				}
 			}
@@ -161,7 +199,66 @@ namespace Scatter
 
 	void SingleScatterSimulator::runSSS(size_t numberZ, size_t numberPhi,
 	                                    size_t numberR,
-	                                    Histogram3D& scatterHisto)
+	                                    Histogram3D& scatterHisto,
+	                                    bool smoothInterpolation)
+	{
+		ASSERT_MSG(scatterHisto.isMemoryValid(),
+		           "Destination histogram is unallocated or unbound");
+		setupLORSamples(numberZ, numberPhi, numberR, scatterHisto);
+
+		std::vector<float> values;
+		simulateSampledLORs(scatterHisto, values);
+
+		fillScatterHistogram(values.data(), 1, scatterHisto,
+		                     smoothInterpolation);
+	}
+
+	void SingleScatterSimulator::runSSS(size_t numberZ, size_t numberPhi,
+	                                    size_t numberR,
+	                                    TOFHistogram3D& scatterHisto,
+	                                    float tofWidth_ps, int tofNumStd,
+	                                    bool smoothInterpolation)
+	{
+		ASSERT_MSG(scatterHisto.isMemoryValid(),
+		           "Destination histogram is unallocated or unbound");
+		const int numTOFBins = scatterHisto.getNumTOFBins();
+		ASSERT_MSG(numTOFBins <= TimeOfFlightHelper::MaxNumTOFBins,
+		           "Too many TOF bins");
+		const Histogram3D& histo3d = scatterHisto.getHistogram3D();
+		setupLORSamples(numberZ, numberPhi, numberR, histo3d);
+
+		const TimeOfFlightHelper tofHelper{tofWidth_ps, tofNumStd};
+		std::vector<float> values;
+		simulateSampledLORs(histo3d, values, &tofHelper, numTOFBins,
+		                    scatterHisto.getTOFBinWidth());
+
+		// Fill one TOF bin at a time
+		auto tofBinHisto = std::make_unique<Histogram3DOwned>(mr_scanner);
+		tofBinHisto->allocate();
+		const bin_t numBins3d = tofBinHisto->count();
+		for (int tofBin = 0; tofBin < numTOFBins; tofBin++)
+		{
+			std::cout << "Filling TOF bin " << tofBin + 1 << "/" << numTOFBins
+			          << "..." << std::endl;
+			tofBinHisto->clearProjections(0.0f);
+			fillScatterHistogram(values.data() + tofBin, numTOFBins,
+			                     *tofBinHisto, smoothInterpolation);
+
+			const float* tofBinValues = tofBinHisto->getData().getRawPointer();
+			float* scatterValues = scatterHisto.getData().getRawPointer();
+#pragma omp parallel for default(none) \
+    firstprivate(tofBinValues, scatterValues, numBins3d, numTOFBins, tofBin)
+			for (bin_t bin = 0; bin < numBins3d; bin++)
+			{
+				scatterValues[bin * numTOFBins + tofBin] = tofBinValues[bin];
+			}
+		}
+	}
+
+	void SingleScatterSimulator::setupLORSamples(size_t numberZ,
+	                                             size_t numberPhi,
+	                                             size_t numberR,
+	                                             const Histogram3D& scatterHisto)
 	{
 		const size_t num_i_z = numberZ;
 		const size_t num_i_phi = numberPhi;
@@ -176,8 +273,6 @@ namespace Scatter
 		ASSERT_MSG(
 		    &scatterHisto.getScanner() == &mr_scanner,
 		    "The histogram's scanner is not the same as the SSS's scanner");
-		ASSERT_MSG(scatterHisto.isMemoryValid(),
-		           "Destination histogram is unallocated or unbound");
 
 		constexpr size_t min_z = 0;
 		constexpr size_t min_phi = 0;
@@ -194,6 +289,12 @@ namespace Scatter
 		const float d_phi =
 		    (num_phi - min_phi) / static_cast<float>(num_i_phi - 1);
 		const float d_r = (num_r - min_r) / static_cast<float>(num_i_r - 1);
+		const std::vector<size_t> prevZBinSamples = std::move(m_zBinSamples);
+		const std::vector<size_t> prevPhiSamples = std::move(m_phiSamples);
+		const std::vector<size_t> prevRSamples = std::move(m_rSamples);
+		m_zBinSamples.clear();
+		m_phiSamples.clear();
+		m_rSamples.clear();
 		m_zBinSamples.reserve(num_i_z);
 		m_phiSamples.reserve(num_i_phi);
 		m_rSamples.reserve(num_i_r);
@@ -218,252 +319,657 @@ namespace Scatter
 			m_rSamples.push_back(std::min(static_cast<size_t>(r), num_r - 1));
 		}
 
+		// The cached tables are only valid for the same sampled LORs
+		if (m_zBinSamples != prevZBinSamples ||
+		    m_phiSamples != prevPhiSamples || m_rSamples != prevRSamples)
+		{
+			m_cachedTables.clear();
+		}
+	}
+
+	void SingleScatterSimulator::simulateSampledLORs(
+	    const Histogram3D& scatterHisto, std::vector<float>& values,
+	    const TimeOfFlightHelper* tofHelper, int numTOFBins,
+	    float tofBinWidth_ps)
+	{
+		const size_t num_i_z = m_zBinSamples.size();
+		const size_t num_i_phi = m_phiSamples.size();
+		const size_t num_i_r = m_rSamples.size();
+		const size_t numValuesPerLOR = (tofHelper != nullptr) ? numTOFBins : 1;
+		values.assign(num_i_z * num_i_phi * num_i_r * numValuesPerLOR, 0.0f);
+
 		// Only used for printing purposes
 		const int64_t progressMax = num_i_z * num_i_phi * num_i_r;
 		const int numThreads = Globals::get_num_threads();
 		Util::ProgressDisplayMultiThread progressBar{numThreads, progressMax,
 		                                             5};
 
-#pragma omp parallel for schedule(static, 1) collapse(3) shared(progressBar)
+		// The line integrals between a detector and the scatter points do not
+		// depend on the other detector of the LOR. They are computed once per
+		// detector, one z sample at a time to bound the memory used
+		const size_t numLORsPerZ = num_i_phi * num_i_r;
+		std::vector<size_t> detIdx1(numLORsPerZ), detIdx2(numLORsPerZ);
+		std::vector<det_id_t> detIds;
+		std::vector<Vector3D> detPositions;
+		std::unordered_map<det_id_t, size_t> detIdxMap;
+		DetectorScatterTables uncachedTables;
+		if (m_cacheTables)
+		{
+			m_cachedTables.resize(num_i_z);
+		}
+
 		for (size_t z_i = 0; z_i < num_i_z; z_i++)
 		{
+			const size_t z = m_zBinSamples[z_i];
+
+			// Gather the detectors of the LORs of this z sample
+			detIds.clear();
+			detPositions.clear();
+			detIdxMap.clear();
+			const auto getDetIdx = [&](det_id_t d) -> size_t
+			{
+				const auto [it, inserted] =
+				    detIdxMap.try_emplace(d, detIds.size());
+				if (inserted)
+				{
+					detIds.push_back(d);
+					detPositions.push_back(mr_scanner.getDetectorPos(d));
+				}
+				return it->second;
+			};
 			for (size_t phi_i = 0; phi_i < num_i_phi; phi_i++)
 			{
 				for (size_t r_i = 0; r_i < num_i_r; r_i++)
 				{
-					const int threadNum = omp_get_thread_num();
-					progressBar.progress(threadNum, 1);
-
-					const size_t z = m_zBinSamples[z_i];
+					const size_t lorIdx = phi_i * num_i_r + r_i;
 					const size_t phi = m_phiSamples[phi_i];
 					const size_t r = m_rSamples[r_i];
-
-					// Compute current LOR
-					const size_t scatterHistoBinId =
+					const bin_t binId =
 					    scatterHisto.getBinIdFromCoords(r, phi, z);
+					const auto [d1, d2] = scatterHisto.getDetectorPair(binId);
+					detIdx1[lorIdx] = getDetIdx(d1);
+					detIdx2[lorIdx] = getDetIdx(d2);
+				}
+			}
 
-					const auto [d1, d2] =
-					    scatterHisto.getDetectorPair(scatterHistoBinId);
-					const Vector3D p1 = mr_scanner.getDetectorPos(d1);
-					const Vector3D p2 = mr_scanner.getDetectorPos(d2);
-					const Vector3D n1 = mr_scanner.getDetectorOrient(d1);
-					const Vector3D n2 = mr_scanner.getDetectorOrient(d2);
+			DetectorScatterTables& tables =
+			    m_cacheTables ? m_cachedTables[z_i] : uncachedTables;
+			if (!m_cacheTables || tables.att511.empty())
+			{
+				computeAttenuationTables(detPositions, tables);
+			}
+			computeEmissionTables(detPositions, tables, tofHelper != nullptr);
+
+			float* zValues = values.data() + z_i * numLORsPerZ * numValuesPerLOR;
+#pragma omp parallel for schedule(static, 1) shared(progressBar, tables)
+			for (size_t lorIdx = 0; lorIdx < numLORsPerZ; lorIdx++)
+			{
+				const int threadNum = omp_get_thread_num();
+				progressBar.progress(threadNum, 1);
 
-					const Line3D lor{p1, p2};
+				const size_t i1 = detIdx1[lorIdx];
+				const size_t i2 = detIdx2[lorIdx];
+				const Line3D lor{detPositions[i1], detPositions[i2]};
+				const Vector3D n1 = mr_scanner.getDetectorOrient(detIds[i1]);
+				const Vector3D n2 = mr_scanner.getDetectorOrient(detIds[i2]);
 
-					const float scatterResult =
-					    computeSingleScatterInLOR(lor, n1, n2);
+				if (tofHelper == nullptr)
+				{
+					zValues[lorIdx] =
+					    computeSingleScatterInLOR(lor, n1, n2, tables, i1, i2);
+				}
+				else
+				{
+					computeSingleScatterInLOR(
+					    lor, n1, n2, tables, i1, i2, *tofHelper, numTOFBins,
+					    tofBinWidth_ps, zValues + lorIdx * numTOFBins);
+				}
+			}
+		}
+	}
+
+	void SingleScatterSimulator::fillScatterHistogram(
+	    const float* values, size_t stride, Histogram3D& scatterHisto,
+	    bool smoothInterpolation) const
+	{
+		const size_t num_i_z = m_zBinSamples.size();
+		const size_t num_i_phi = m_phiSamples.size();
+		const size_t num_i_r = m_rSamples.size();
+
+		for (size_t z_i = 0; z_i < num_i_z; z_i++)
+		{
+			for (size_t phi_i = 0; phi_i < num_i_phi; phi_i++)
+			{
+				for (size_t r_i = 0; r_i < num_i_r; r_i++)
+				{
+					const size_t lorIdx =
+					    (z_i * num_i_phi + phi_i) * num_i_r + r_i;
+					const float scatterResult = values[lorIdx * stride];
 					if (scatterResult <= 0.0)
 						continue;  // Ignore irrelevant lines?
-					scatterHisto.setProjectionValue(scatterHistoBinId,
-					                                scatterResult);
+					scatterHisto.setProjectionValue(
+					    scatterHisto.getBinIdFromCoords(m_rSamples[r_i],
+					                                    m_phiSamples[phi_i],
+					                                    m_zBinSamples[z_i]),
+					    scatterResult);
 				}
 			}
 		}
 
 		std::cout
-		    << "Scatter simulation completed, running linear interpolation "
+		    << "Scatter simulation completed, running interpolation "
 		       "to fill gaps..."
 		    << std::endl;
 
 		// Run interpolations to fill non-simulated bins
-		const size_t num_i_z_to_take = (num_i_z == 1) ? 1 : (num_i_z - 1);
-		for (size_t z_i = 0; z_i < num_i_z_to_take; z_i++)
+		if (smoothInterpolation)
 		{
-			const size_t z1 = m_zBinSamples[z_i];
-			const size_t z2 =
-			    (num_i_z == 1) ? m_zBinSamples[0] : m_zBinSamples[z_i + 1];
-			for (size_t phi_i = 0; phi_i < num_i_phi - 1; phi_i++)
+			// The knots have to be distinct
+			const auto getKnots = [](std::vector<size_t> samples)
 			{
-				const size_t phi1 = m_phiSamples[phi_i];
-				const size_t phi2 = m_phiSamples[phi_i + 1];
-				for (size_t r_i = 0; r_i < num_i_r - 1; r_i++)
+				samples.erase(std::unique(samples.begin(), samples.end()),
+				              samples.end());
+				return samples;
+			};
+			Util::fillGridMonotoneCubic(scatterHisto.getData(),
+			                            getKnots(m_zBinSamples),
+			                            getKnots(m_phiSamples),
+			                            getKnots(m_rSamples));
+		}
+		else
+		{
+			const size_t num_i_z_to_take = (num_i_z == 1) ? 1 : (num_i_z - 1);
+			const size_t numBoxesPhi = num_i_phi - 1;
+			const size_t numBoxesR = num_i_r - 1;
+			Array3DBase<float>& scatterHistoData = scatterHisto.getData();
+			for (size_t z_i = 0; z_i < num_i_z_to_take; z_i++)
+			{
+				const size_t z1 = m_zBinSamples[z_i];
+				const size_t z2 =
+				    (num_i_z == 1) ? m_zBinSamples[0] : m_zBinSamples[z_i + 1];
+				// Neighbouring boxes share their faces. The boxes are filled
+				// in four passes, by parity of phi and r, so that the boxes
+				// filled concurrently do not touch
+				for (size_t parity = 0; parity < 4; parity++)
 				{
-					const size_t r1 = m_rSamples[r_i];
-					const size_t r2 = m_rSamples[r_i + 1];
-					Util::fillBox(scatterHisto.getData(), z1, z2, phi1, phi2,
-					              r1, r2);
+					const size_t phiParity = parity / 2;
+					const size_t rParity = parity % 2;
+#pragma omp parallel for collapse(2) default(none)                     \
+    firstprivate(z1, z2, numBoxesPhi, numBoxesR, phiParity, rParity) \
+    shared(scatterHistoData)
+					for (size_t phi_i = phiParity; phi_i < numBoxesPhi;
+					     phi_i += 2)
+					{
+						for (size_t r_i = rParity; r_i < numBoxesR; r_i += 2)
+						{
+							Util::fillBox(scatterHistoData, z1, z2,
+							              m_phiSamples[phi_i],
+							              m_phiSamples[phi_i + 1],
+							              m_rSamples[r_i], m_rSamples[r_i + 1]);
+						}
+					}
 				}
 			}
 		}
 		std::cout << "Histogram filled in all the transaxial bins."
 		          << std::endl;
 
+		// The oblique bins only read the direct ones (z_bin < numRings)
 		std::cout << "Filling oblique bins..." << std::endl;
-		for (coord_t z_bin_i = mr_scanner.numRings;
-		     z_bin_i < scatterHisto.numZBin; ++z_bin_i)
+		const size_t sliceSize = scatterHisto.numPhi * scatterHisto.numR;
+		const coord_t numRings = mr_scanner.numRings;
+		const coord_t numZBin = scatterHisto.numZBin;
+		float* scatterHistoPtr = scatterHisto.getData().getRawPointer();
+#pragma omp parallel for default(none) \
+    firstprivate(sliceSize, numRings, numZBin, scatterHistoPtr) \
+    shared(scatterHisto)
+		for (coord_t z_bin_i = numRings; z_bin_i < numZBin; ++z_bin_i)
 		{
 			coord_t z1, z2;
 			scatterHisto.getZ1Z2(z_bin_i, z1, z2);
-			const Array3DBase<float>& scatterHistoData_c =
-			    scatterHisto.getData();
-			Array3DBase<float>& scatterHistoData = scatterHisto.getData();
-			coord_t z_average = z1 + z2;
+			float* slice = scatterHistoPtr + z_bin_i * sliceSize;
+			const coord_t z_average = z1 + z2;
+			const float* slice0 =
+			    scatterHistoPtr + (z_average / 2) * sliceSize;
 			if (z_average % 2 == 0)
 			{
-				z_average = z_average / 2;
-				scatterHistoData[z_bin_i] += scatterHistoData_c[z_average];
+				for (size_t i = 0; i < sliceSize; i++)
+				{
+					slice[i] += slice0[i];
+				}
 			}
 			else
 			{
-				const coord_t z_average_0 = z_average / 2;
-				const coord_t z_average_1 = z_average_0 + 1;
-				scatterHistoData[z_bin_i] += scatterHistoData_c[z_average_0];
-				scatterHistoData[z_bin_i] += scatterHistoData_c[z_average_1];
-				scatterHistoData[z_bin_i] *= 0.5;  // average
+				const float* slice1 = slice0 + sliceSize;
+				for (size_t i = 0; i < sliceSize; i++)
+				{
+					// average
+					slice[i] = (slice[i] + slice0[i] + slice1[i]) * 0.5f;
+				}
 			}
 		}
 	}
 
-	// YP LOR in which to compute the scatter contribution
-	float SingleScatterSimulator::computeSingleScatterInLOR(
-	    const Line3D& lor, const Vector3D& n1, const Vector3D& n2) const
+	void SingleScatterSimulator::computeEnergyTables()
 	{
-		int i;
-		float res = 0., dist1, dist2, energy, cosa, mu_scaling_factor;
-		float vatt, att_s_1_511, att_s_1, att_s_2_511, att_s_2;
-		float dsigcompdomega, lamb_s_1, lamb_s_2, sig_s_1, sig_s_2;
-		float eps_s_1_511, eps_s_1, eps_s_2_511, eps_s_2, fac1, fac2;
-		float tmp, tmp511, delta_1, delta_2, mu_det, mu_det_511;
-		Line3D lor_1_s, lor_2_s;
-		Vector3D ps, p1, p2, u, v;
-
-		p1.update(lor.point1);
-		p2.update(lor.point2);
-
-		tmp511 = (m_energyLLD - 511.0) / (sqrt(2.0) * m_sigmaEnergy);
-		mu_det_511 = getMuDet(511.0, m_crystalMaterial);
-
-		for (i = 0; i < m_numSamples; i++)
+		const double tmp511 =
+		    (m_energyLLD - 511.0) / (sqrt(2.0) * m_sigmaEnergy);
+
+		m_kleinNishinaTable.resize(NumCosSamples + 1);
+		m_muScalingTable.resize(NumCosSamples + 1);
+		m_energyEfficiencyTable.resize(NumCosSamples + 1);
+		for (int i = 0; i <= NumCosSamples; i++)
 		{
-			// for each scatter point in the image volume
+			const double cosa = 2.0 * i / NumCosSamples - 1.0;
+			const double energy = 511.0 / (2.0 - cosa);
+			const double tmp =
+			    (m_energyLLD - energy) / (sqrt(2.0) * m_sigmaEnergy);
+			m_kleinNishinaTable[i] = getKleinNishina(cosa);
+			m_muScalingTable[i] = getMuScalingFactor(energy);
+			m_energyEfficiencyTable[i] = Util::erfc(tmp);
+		}
+		m_efficiency511 = Util::erfc(tmp511);
 
-			ps.update(m_xSamples[i], m_ySamples[i], m_zSamples[i]);
+		// The scattered photon has at least a third of 511 keV
+		m_muDetTable.resize(512);
+		for (int e = 1; e < 512; e++)
+		{
+			m_muDetTable[e] = getMuDet(e, m_crystalMaterial);
+		}
+		m_muDetTable[0] = m_muDetTable[1];
+	}
 
-			// LOR going from scatter point "ps" to detector 1
-			lor_1_s.update(p1, ps);
-			// LOR going from scatter point "ps" to detector 2
-			lor_2_s.update(p2, ps);
+	void SingleScatterSimulator::computeDetectorScatterTables(
+	    const std::vector<Vector3D>& detPositions,
+	    DetectorScatterTables& tables, bool withTOF) const
+	{
+		computeAttenuationTables(detPositions, tables);
+		computeEmissionTables(detPositions, tables, withTOF);
+	}
 
-			// check that the rays S-det1 and S-det2 pass the end plates
-			// collimator before going further:
-			if (std::abs(ps.z) > m_axialFOV / 2 &&
-			    (!passCollimator(lor_1_s) || !passCollimator(lor_2_s)))
-				continue;
+	void SingleScatterSimulator::computeAttenuationTables(
+	    const std::vector<Vector3D>& detPositions,
+	    DetectorScatterTables& tables) const
+	{
+		const size_t numSamples = m_numSamples;
+		const size_t tableSize = detPositions.size() * numSamples;
+		tables.att511.resize(tableSize);
+		tables.crystalLength.resize(tableSize);
+		tables.efficiency511.resize(tableSize);
+		tables.collimatorMask.resize(tableSize);
+		const float muDet511 = getMuDet(511.0, m_crystalMaterial);
 
+#pragma omp parallel for schedule(static) shared(detPositions, tables)
+		for (size_t idx = 0; idx < tableSize; idx++)
+		{
+			const size_t detIdx = idx / numSamples;
+			const size_t i = idx % numSamples;
+			const Vector3D ps{m_xSamples[i], m_ySamples[i], m_zSamples[i]};
+			// LOR going from the detector to the scatter point
+			const Line3D lor_d_s{detPositions[detIdx], ps};
 
-			u.update(ps - p1);
-			dist1 = u.getNorm();
-			u.x /= dist1;
-			u.y /= dist1;
-			u.z /= dist1;
-			v.update(p2 - ps);
-			dist2 = v.getNorm();
-			v.x /= dist2;
-			v.y /= dist2;
-			v.z /= dist2;
+			// Rays from scatter points inside the axial FOV always pass the
+			// end plates
+			const bool passes = std::abs(ps.z) <= m_axialFOV / 2 ||
+			                    passCollimator(lor_d_s);
+			tables.collimatorMask[idx] = passes ? 1.0f : 0.0f;
+			tables.att511[idx] =
+			    OperatorProjectorSiddon::singleForwardProjection(&mr_mu,
+			                                                     lor_d_s) /
+			    10.0;
+			const float delta = getIntersectionLengthLORCrystal(lor_d_s);
+			tables.crystalLength[idx] = delta;
+			tables.efficiency511[idx] =
+			    m_efficiency511 * (1.0f - std::exp(-delta * muDet511));
+		}
+	}
 
-			cosa = u.scalProd(v);
-			// larger angle change -> more energy loss
-			energy = 511.0 / (2.0 - cosa);
-			if (energy <= m_energyLLD)
+	void SingleScatterSimulator::computeEmissionTables(
+	    const std::vector<Vector3D>& detPositions,
+	    DetectorScatterTables& tables, bool withTOF) const
+	{
+		const size_t numSamples = m_numSamples;
+		const size_t tableSize = detPositions.size() * numSamples;
+		tables.lambda.resize(tableSize);
+		tables.lambdaSegments.resize(withTOF ? tableSize * NumTOFSegments : 0);
+		const Image* lambdaImage = mp_lambda;
+
+#pragma omp parallel for schedule(static) shared(detPositions, tables) \
+    firstprivate(withTOF, lambdaImage)
+		for (size_t idx = 0; idx < tableSize; idx++)
+		{
+			const size_t detIdx = idx / numSamples;
+			const size_t i = idx % numSamples;
+			const Vector3D ps{m_xSamples[i], m_ySamples[i], m_zSamples[i]};
+			const Line3D lor_d_s{detPositions[detIdx], ps};
+
+			if (!withTOF)
 			{
+				tables.lambda[idx] =
+				    OperatorProjectorSiddon::singleForwardProjection(
+				        lambdaImage, lor_d_s);
 				continue;
 			}
-			tmp = (m_energyLLD - energy) / (sqrt(2.0) * m_sigmaEnergy);
-			mu_scaling_factor = getMuScalingFactor(energy);
-
-			// get scatter values:
-			vatt = mr_mu.nearestNeighbor(ps);
-			dsigcompdomega = getKleinNishina(cosa);
-
-			// compute I1 and I2:
-			att_s_1_511 = OperatorProjectorSiddon::singleForwardProjection(
-			                  &mr_mu, lor_1_s) /
-			              10.0;
-
-			att_s_1 = att_s_1_511 * mu_scaling_factor;
-			lamb_s_1 = OperatorProjectorSiddon::singleForwardProjection(
-			    &mr_lambda, lor_1_s);
-			delta_1 = getIntersectionLengthLORCrystal(lor_1_s);
-			if (delta_1 > 10 * m_crystalDepth)
+			// The emission integral is the sum over the segments
+			const Vector3D step =
+			    (ps - lor_d_s.point1) * (1.0f / NumTOFSegments);
+			float* lambdaSegments =
+			    tables.lambdaSegments.data() + idx * NumTOFSegments;
+			float lambda = 0.0f;
+			for (int k = 0; k < NumTOFSegments; k++)
 			{
-				std::cerr
-				    << "Error computing propagation distance in detector in "
-				       "SingleScatterSimulation::compute_single_scatter_in_"
-				       "lor() (1).\n"
-				    << std::endl;
-				exit(-1);
+				const Line3D segment{lor_d_s.point1 + step * k,
+				                     lor_d_s.point1 + step * (k + 1)};
+				lambdaSegments[k] =
+				    OperatorProjectorSiddon::singleForwardProjection(
+				        lambdaImage, segment);
+				lambda += lambdaSegments[k];
 			}
+			tables.lambda[idx] = lambda;
+		}
+	}
 
-			att_s_2_511 = OperatorProjectorSiddon::singleForwardProjection(
-			                  &mr_mu, lor_2_s) /
-			              10.0;
+	float SingleScatterSimulator::computeSingleScatterInLOR(
+	    const Line3D& lor, const Vector3D& n1, const Vector3D& n2) const
+	{
+		DetectorScatterTables tables;
+		computeDetectorScatterTables({lor.point1, lor.point2}, tables);
+		return computeSingleScatterInLOR(lor, n1, n2, tables, 0, 1);
+	}
 
-			att_s_2 = att_s_2_511 * mu_scaling_factor;
-			lamb_s_2 = OperatorProjectorSiddon::singleForwardProjection(
-			    &mr_lambda, lor_2_s);
-			delta_2 = getIntersectionLengthLORCrystal(lor_2_s);
+	std::vector<float> SingleScatterSimulator::computeSingleScatterInLOR(
+	    const Line3D& lor, const Vector3D& n1, const Vector3D& n2,
+	    const TimeOfFlightHelper& tofHelper, int numTOFBins,
+	    float tofBinWidth_ps) const
+	{
+		ASSERT_MSG(numTOFBins <= TimeOfFlightHelper::MaxNumTOFBins,
+		           "Too many TOF bins");
+		DetectorScatterTables tables;
+		computeDetectorScatterTables({lor.point1, lor.point2}, tables, true);
+		std::vector<float> scatterTOF(numTOFBins);
+		computeSingleScatterInLOR(lor, n1, n2, tables, 0, 1, tofHelper,
+		                          numTOFBins, tofBinWidth_ps,
+		                          scatterTOF.data());
+		return scatterTOF;
+	}
 
-			// Check that the distance between the two cylinders is not too big
-			if (delta_2 > 10 * m_crystalDepth)
+	// YP LOR in which to compute the scatter contribution
+	float SingleScatterSimulator::computeSingleScatterInLOR(
+	    const Line3D& lor, const Vector3D& n1, const Vector3D& n2,
+	    const DetectorScatterTables& tables, size_t detIdx1,
+	    size_t detIdx2) const
+	{
+		const float res = sumScatterPoints<false>(lor, n1, n2, tables, detIdx1,
+		                                          detIdx2, nullptr, nullptr);
+		return res / getTruesNormalization(lor, n1, n2);
+	}
+
+	void SingleScatterSimulator::computeSingleScatterInLOR(
+	    const Line3D& lor, const Vector3D& n1, const Vector3D& n2,
+	    const DetectorScatterTables& tables, size_t detIdx1, size_t detIdx2,
+	    const TimeOfFlightHelper& tofHelper, int numTOFBins,
+	    float tofBinWidth_ps, float* scatterTOF) const
+	{
+		std::vector<float> termA(m_numSamples), termB(m_numSamples);
+		sumScatterPoints<true>(lor, n1, n2, tables, detIdx1, detIdx2,
+		                       termA.data(), termB.data());
+
+		// The TOF of a scattered coincidence is given by the position of the
+		// annihilation along the broken line detector 1 - scatter point -
+		// detector 2. The emission along each ray is split in segments
+		const Vector3D& p1 = lor.point1;
+		const Vector3D& p2 = lor.point2;
+		const size_t offset1 = detIdx1 * m_numSamples * NumTOFSegments;
+		const size_t offset2 = detIdx2 * m_numSamples * NumTOFSegments;
+		float weights[TimeOfFlightHelper::MaxNumTOFBins];
+		std::fill(scatterTOF, scatterTOF + numTOFBins, 0.0f);
+
+		for (int i = 0; i < m_numSamples; i++)
+		{
+			if (termA[i] == 0.0f && termB[i] == 0.0f)
+			{
+				continue;
+			}
+			const Vector3D ps{m_xSamples[i], m_ySamples[i], m_zSamples[i]};
+			const float dist1 = (ps - p1).getNorm();
+			const float dist2 = (p2 - ps).getNorm();
+			const float pathLength = dist1 + dist2;
+			const float* lamb_1 =
+			    tables.lambdaSegments.data() + offset1 + i * NumTOFSegments;
+			const float* lamb_2 =
+			    tables.lambdaSegments.data() + offset2 + i * NumTOFSegments;
+			for (int k = 0; k < NumTOFSegments; k++)
 			{
-				std::cerr
-				    << "Error computing propagation distance in detector in "
-				    << "SingleScatterSimulation::compute_single_scatter_in_"
-				    << "lor() (2)." << std::endl
-				    << std::endl;
-				exit(-1);
+				const float frac = (k + 0.5f) / NumTOFSegments;
+				// Annihilation between detector 1 and the scatter point
+				const float valueA = termA[i] * lamb_1[k];
+				if (valueA > 0.0f)
+				{
+					tofHelper.getTOFBinWeights(pathLength, frac * dist1,
+					                           numTOFBins, tofBinWidth_ps,
+					                           weights);
+					for (int t = 0; t < numTOFBins; t++)
+					{
+						scatterTOF[t] += valueA * weights[t];
+					}
+				}
+				// Annihilation between the scatter point and detector 2
+				const float valueB = termB[i] * lamb_2[k];
+				if (valueB > 0.0f)
+				{
+					tofHelper.getTOFBinWeights(pathLength,
+					                           pathLength - frac * dist2,
+					                           numTOFBins, tofBinWidth_ps,
+					                           weights);
+					for (int t = 0; t < numTOFBins; t++)
+					{
+						scatterTOF[t] += valueB * weights[t];
+					}
+				}
 			}
+		}
+
+		const float normalization = getTruesNormalization(lor, n1, n2);
+		for (int t = 0; t < numTOFBins; t++)
+		{
+			scatterTOF[t] /= normalization;
+		}
+	}
+
+	template <bool StoreTerms>
+	float SingleScatterSimulator::sumScatterPoints(
+	    const Line3D& lor, const Vector3D& n1, const Vector3D& n2,
+	    const DetectorScatterTables& tables, size_t detIdx1, size_t detIdx2,
+	    float* termA, float* termB) const
+	{
+		const Vector3D& p1 = lor.point1;
+		const Vector3D& p2 = lor.point2;
+
+		// Scatter points
+		const float* xs = m_xSamples.data();
+		const float* ys = m_ySamples.data();
+		const float* zs = m_zSamples.data();
+		const float* muSamples = m_muSamples.data();
+		// Tables of the detectors 1 and 2
+		const size_t offset1 = detIdx1 * m_numSamples;
+		const size_t offset2 = detIdx2 * m_numSamples;
+		const float* att_1_511 = tables.att511.data() + offset1;
+		const float* att_2_511 = tables.att511.data() + offset2;
+		const float* lamb_1 = tables.lambda.data() + offset1;
+		const float* lamb_2 = tables.lambda.data() + offset2;
+		const float* delta_1 = tables.crystalLength.data() + offset1;
+		const float* delta_2 = tables.crystalLength.data() + offset2;
+		const float* eps_1_511 = tables.efficiency511.data() + offset1;
+		const float* eps_2_511 = tables.efficiency511.data() + offset2;
+		const float* mask_1 = tables.collimatorMask.data() + offset1;
+		const float* mask_2 = tables.collimatorMask.data() + offset2;
+		// Energy tables
+		const float* kleinNishinaTable = m_kleinNishinaTable.data();
+		const float* muScalingTable = m_muScalingTable.data();
+		const float* energyEfficiencyTable = m_energyEfficiencyTable.data();
+		const float* muDetTable = m_muDetTable.data();
+
+		const float energyLLD = m_energyLLD;
+		const float maxCrystalLength = 10 * m_crystalDepth;
+		constexpr float CosScale = NumCosSamples / 2.0f;
+
+		float res = 0.0f;
+		int invalidCrystalLength = 0;
+
+		// For each scatter point in the image volume. The points rejected
+		// (collimator or energy window) are masked instead of skipped
+#pragma omp simd reduction(+ : res) reduction(max : invalidCrystalLength)
+		for (int i = 0; i < m_numSamples; i++)
+		{
+			// Unit vectors from detector 1 to the scatter point and from the
+			// scatter point to detector 2
+			float ux = xs[i] - p1.x;
+			float uy = ys[i] - p1.y;
+			float uz = zs[i] - p1.z;
+			const float dist1_2 = ux * ux + uy * uy + uz * uz;
+			const float invDist1 = 1.0f / std::sqrt(dist1_2);
+			ux *= invDist1;
+			uy *= invDist1;
+			uz *= invDist1;
+			float vx = p2.x - xs[i];
+			float vy = p2.y - ys[i];
+			float vz = p2.z - zs[i];
+			const float dist2_2 = vx * vx + vy * vy + vz * vz;
+			const float invDist2 = 1.0f / std::sqrt(dist2_2);
+			vx *= invDist2;
+			vy *= invDist2;
+			vz *= invDist2;
+
+			const float cosa = ux * vx + uy * vy + uz * vz;
+			// larger angle change -> more energy loss
+			const float energy = 511.0f / (2.0f - cosa);
+			const bool valid =
+			    energy > energyLLD && mask_1[i] * mask_2[i] > 0.0f;
+
+			// Linear interpolation in the energy tables
+			const float cosPos = std::min(
+			    std::max((cosa + 1.0f) * CosScale, 0.0f),
+			    static_cast<float>(NumCosSamples) - 0.001f);
+			const int cosIdx = static_cast<int>(cosPos);
+			const float w = cosPos - cosIdx;
+			const float dsigcompdomega =
+			    (1.0f - w) * kleinNishinaTable[cosIdx] +
+			    w * kleinNishinaTable[cosIdx + 1];
+			const float mu_scaling_factor =
+			    (1.0f - w) * muScalingTable[cosIdx] +
+			    w * muScalingTable[cosIdx + 1];
+			const float eps_energy =
+			    (1.0f - w) * energyEfficiencyTable[cosIdx] +
+			    w * energyEfficiencyTable[cosIdx + 1];
+			const float mu_det =
+			    muDetTable[std::min(static_cast<int>(energy), 511)];
+
+			// Detection efficiencies (energy+spatial)
+			const float eps_1 =
+			    eps_energy * (1.0f - std::exp(-delta_1[i] * mu_det));
+			const float eps_2 =
+			    eps_energy * (1.0f - std::exp(-delta_2[i] * mu_det));
+
+			const float att_1 = att_1_511[i] * mu_scaling_factor;
+			const float att_2 = att_2_511[i] * mu_scaling_factor;
+			// I^A and I^B, without their emission integrals
+			const float fac1 =
+			    std::exp(-att_1_511[i] - att_2) * eps_1_511[i] * eps_2;
+			const float fac2 =
+			    std::exp(-att_1 - att_2_511[i]) * eps_2_511[i] * eps_1;
 
 			// geometric efficiencies (n1 and n2 must be normalized unit
 			// vectors):
-			sig_s_1 = std::abs(n1.scalProd(u));
-			sig_s_2 = std::abs(n2.scalProd(v));
-
-			// detection efficiencies (energy+spatial):
-			eps_s_1_511 = eps_s_2_511 = Util::erfc(tmp511);
-			eps_s_1 = eps_s_2 = Util::erfc(tmp);
-			mu_det = getMuDet(energy, m_crystalMaterial);
-			eps_s_1_511 *= 1 - exp(-delta_1 * mu_det_511);
-			eps_s_2_511 *= 1 - exp(-delta_2 * mu_det_511);
-			eps_s_1 *= 1 - exp(-delta_1 * mu_det);
-			eps_s_2 *= 1 - exp(-delta_2 * mu_det);
-
-			fac1 = lamb_s_1 * exp(-att_s_1_511 - att_s_2);
-			fac1 *= eps_s_1_511 * eps_s_2;  // I^A
-			fac2 = lamb_s_2 * exp(-att_s_1 - att_s_2_511);
-			fac2 *= eps_s_2_511 * eps_s_1;  // I^B
-
-			res += vatt * dsigcompdomega * (fac1 + fac2) * sig_s_1 * sig_s_2 /
-			       (dist1 * dist1 * dist2 * dist2 * 4 * PI);
+			const float sig_s_1 =
+			    std::abs(n1.x * ux + n1.y * uy + n1.z * uz);
+			const float sig_s_2 =
+			    std::abs(n2.x * vx + n2.y * vy + n2.z * vz);
+
+			// The terms of the masked points are selected out rather than
+			// multiplied by zero, so that a non-finite value computed for
+			// them (from an invalid crystal length) cannot reach the sum
+			const float common = muSamples[i] * dsigcompdomega * sig_s_1 *
+			                     sig_s_2 / (dist1_2 * dist2_2 * 4 * PI);
+			const float valueA = valid ? common * fac1 : 0.0f;
+			const float valueB = valid ? common * fac2 : 0.0f;
+			res += lamb_1[i] * valueA + lamb_2[i] * valueB;
+			if constexpr (StoreTerms)
+			{
+				termA[i] = valueA;
+				termB[i] = valueB;
+			}
+
+			// Check that the distance between the two cylinders is not too
+			// big
+			const bool invalid =
+			    valid && (delta_1[i] > maxCrystalLength ||
+			              delta_2[i] > maxCrystalLength);
+			invalidCrystalLength = std::max(invalidCrystalLength,
+			                                static_cast<int>(invalid));
 		}
+
+		if (invalidCrystalLength)
+		{
+			std::cerr << "Error computing propagation distance in detector in "
+			             "SingleScatterSimulation::compute_single_scatter_in_"
+			             "lor()."
+			          << std::endl;
+			exit(-1);
+		}
+		return res;
+	}
+
+	float SingleScatterSimulator::getTruesNormalization(
+	    const Line3D& lor, const Vector3D& n1, const Vector3D& n2) const
+	{
+		const Vector3D& p1 = lor.point1;
+		const Vector3D& p2 = lor.point2;
+
 		// divide the result by the sensitivity for trues for that LOR (don't do
 		// this anymore because we use the sensitivity corrected scatter
 		// sinogram in the reconstruction):
-		u.update(p2 - p1);
-		dist1 = u.getNorm();
-		u.x /= dist1;
-		u.y /= dist1;
-		u.z /= dist1;
-		sig_s_1 = std::abs(n1.scalProd(u));
-		sig_s_2 = std::abs(n2.scalProd(u));
-		eps_s_1_511 = eps_s_2_511 = Util::erfc(tmp511);
+		const float mu_det_511 = getMuDet(511.0, m_crystalMaterial);
+		Vector3D u = p2 - p1;
+		const float dist = u.getNorm();
+		u.x /= dist;
+		u.y /= dist;
+		u.z /= dist;
+		const float sig_s_1 = std::abs(n1.scalProd(u));
+		const float sig_s_2 = std::abs(n2.scalProd(u));
 		Vector3D mid{p1.x + p2.x, p1.y + p2.y, p1.z + p2.z};
 		mid.x /= 2;
 		mid.y /= 2;
 		mid.z /= 2;
-		lor_1_s.update(p1, mid);
-		delta_1 = getIntersectionLengthLORCrystal(lor_1_s);
-		lor_2_s.update(p2, mid);
-		delta_2 = getIntersectionLengthLORCrystal(lor_2_s);
-		eps_s_1_511 *= 1 - exp(-delta_1 * mu_det_511);
-		eps_s_2_511 *= 1 - exp(-delta_2 * mu_det_511);
+		const float delta_1_mid =
+		    getIntersectionLengthLORCrystal(Line3D{p1, mid});
+		const float delta_2_mid =
+		    getIntersectionLengthLORCrystal(Line3D{p2, mid});
+		const float eps_s_1_511 =
+		    m_efficiency511 * (1 - exp(-delta_1_mid * mu_det_511));
+		const float eps_s_2_511 =
+		    m_efficiency511 * (1 - exp(-delta_2_mid * mu_det_511));
 		// YN: Changed eps_s_1_511 * eps_s_1_511 to eps_s_1_511 * eps_s_2_511
-		res /= eps_s_1_511 * eps_s_2_511 * sig_s_1 * sig_s_2 /
-		       (dist1 * dist1 * 4 * PI);
+		return eps_s_1_511 * eps_s_2_511 * sig_s_1 * sig_s_2 /
+		       (dist * dist * 4 * PI);
+	}
 
-		return res;
+	void SingleScatterSimulator::setSourceImage(const Image& pr_lambda)
+	{
+		mp_lambda = &pr_lambda;
+	}
+
+	void SingleScatterSimulator::setCacheDetectorTables(bool cacheTables)
+	{
+		m_cacheTables = cacheTables;
+		if (!m_cacheTables)
+		{
+			m_cachedTables.clear();
+		}
+	}
+
+	bool SingleScatterSimulator::isCacheDetectorTables() const
+	{
+		return m_cacheTables;
 	}
 
 	Vector3D SingleScatterSimulator::getSamplePoint(int i) const
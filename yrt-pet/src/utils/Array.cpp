@@ -36,6 +36,11 @@ void declare_array(pybind11::module& m, std::string type_str)
 	                              const std::array<size_t, ndim>&)>(
 	          &T::readFromFile));
 	c.def("writeToFile", &T::writeToFile);
+	c.def("writeToFileChunked", &T::writeToFileChunked, pybind11::arg("fname"),
+	      pybind11::arg("compression") = Util::ChunkCompression::ZLIB,
+	      pybind11::arg("slabsPerChunk") = 1);
+	c.def("readSlabsFromFile", &T::readSlabsFromFile, pybind11::arg("fname"),
+	      pybind11::arg("firstSlab"), pybind11::arg("numSlabs"));
 	c.def("getSize", &T::getSize);
 	c.def("getStrides", &T::getStrides);
 	c.def("getSizeTotal", &T::getSizeTotal);
@@ -56,6 +61,11 @@ void declare_array(pybind11::module& m, std::string type_str)
 
 void py_setup_array(pybind11::module& m)
 {
+	pybind11::enum_<Util::ChunkCompression>(m, "ChunkCompression")
+	    .value("NONE", Util::ChunkCompression::NONE)
+	    .value("ZLIB", Util::ChunkCompression::ZLIB)
+	    .export_values();
+
 	// Add common array types
 	PY_DECLARE_ARRAY(float, 1);
 	PY_DECLARE_ARRAY(float, 2);
@@ -0,0 +1,156 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "utils/ArrayOps.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace Util::ArrayOps
+{
+	namespace
+	{
+		// Applies func(i) for every index, the function has to be inlinable
+		// for the loop to be vectorized
+		template <typename Func>
+		void forEach(size_t n, Func func)
+		{
+#pragma omp parallel for simd if (parallel : n >= ParallelThreshold) \
+    default(none) firstprivate(n, func)
+			for (size_t i = 0; i < n; i++)
+			{
+				func(i);
+			}
+		}
+
+		// Sum of term(i) for every index. Each block is accumulated in double
+		// precision, the partial sums are then added with Kahan's compensated
+		// summation in a fixed order
+		template <typename Term>
+		double reduce(size_t n, Term term)
+		{
+			const size_t numBlocks =
+			    (n + ReductionBlockSize - 1) / ReductionBlockSize;
+			std::vector<double> partialSums(numBlocks);
+			double* partialSumsPtr = partialSums.data();
+
+#pragma omp parallel for if (n >= ParallelThreshold) default(none) \
+    firstprivate(n, numBlocks, term, partialSumsPtr)
+			for (size_t b = 0; b < numBlocks; b++)
+			{
+				const size_t first = b * ReductionBlockSize;
+				const size_t last = std::min(first + ReductionBlockSize, n);
+				double blockSum = 0.0;
+#pragma omp simd reduction(+ : blockSum)
+				for (size_t i = first; i < last; i++)
+				{
+					blockSum += term(i);
+				}
+				partialSumsPtr[b] = blockSum;
+			}
+
+			double sum = 0.0;
+			double compensation = 0.0;
+			for (size_t b = 0; b < numBlocks; b++)
+			{
+				const double y = partialSums[b] - compensation;
+				const double t = sum + y;
+				compensation = (t - sum) - y;
+				sum = t;
+			}
+			return sum;
+		}
+	}  // namespace
+
+	void fill(float* dst, float value, size_t n)
+	{
+		forEach(n, [dst, value](size_t i) { dst[i] = value; });
+	}
+
+	void add(float* dst, const float* src, size_t n)
+	{
+		forEach(n, [dst, src](size_t i) { dst[i] += src[i]; });
+	}
+
+	void add(float* dst, float value, size_t n)
+	{
+		forEach(n, [dst, value](size_t i) { dst[i] += value; });
+	}
+
+	void subtract(float* dst, const float* src, size_t n)
+	{
+		forEach(n, [dst, src](size_t i) { dst[i] -= src[i]; });
+	}
+
+	void multiply(float* dst, const float* src, size_t n)
+	{
+		forEach(n, [dst, src](size_t i) { dst[i] *= src[i]; });
+	}
+
+	void multiply(float* dst, float value, size_t n)
+	{
+		forEach(n, [dst, value](size_t i) { dst[i] *= value; });
+	}
+
+	void divide(float* dst, const float* src, size_t n)
+	{
+		forEach(n, [dst, src](size_t i) { dst[i] /= src[i]; });
+	}
+
+	void divide(float* dst, float value, size_t n)
+	{
+		forEach(n, [dst, value](size_t i) { dst[i] /= value; });
+	}
+
+	void addScaled(float* dst, float alpha, const float* src, size_t n)
+	{
+		forEach(n, [dst, alpha, src](size_t i) { dst[i] += alpha * src[i]; });
+	}
+
+	void copyScaled(float* dst, float alpha, const float* src, size_t n)
+	{
+		forEach(n, [dst, alpha, src](size_t i) { dst[i] = alpha * src[i]; });
+	}
+
+	void applyThreshold(float* dst, const float* mask, float threshold,
+	                    float val_le_scale, float val_le_off,
+	                    float val_gt_scale, float val_gt_off, size_t n)
+	{
+		forEach(n,
+		        [=](size_t i)
+		        {
+			        const bool isLe = mask[i] <= threshold;
+			        const float scale = isLe ? val_le_scale : val_gt_scale;
+			        const float offset = isLe ? val_le_off : val_gt_off;
+			        dst[i] = dst[i] * scale + offset;
+		        });
+	}
+
+	void updateEMThreshold(float* dst, const float* update, const float* norm,
+	                       float threshold, size_t n)
+	{
+		forEach(n,
+		        [=](size_t i)
+		        {
+			        const float factor =
+			            norm[i] > threshold ? update[i] / norm[i] : 1.0f;
+			        dst[i] *= factor;
+		        });
+	}
+
+	double sum(const float* x, size_t n)
+	{
+		return reduce(n, [x](size_t i) { return static_cast<double>(x[i]); });
+	}
+
+	double dotProduct(const float* x, const float* y, size_t n)
+	{
+		return reduce(n,
+		              [x, y](size_t i) {
+			              return static_cast<double>(x[i]) *
+			                     static_cast<double>(y[i]);
+		              });
+	}
+}  // namespace Util::ArrayOps
@@ -0,0 +1,480 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "utils/ChunkedFile.hpp"
+
+#include "utils/Assert.hpp"
+#include "utils/Globals.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace Util
+{
+	namespace
+	{
+		constexpr size_t DataAlignment = 64;
+
+		size_t getHeaderSize(size_t ndim, size_t numChunks)
+		{
+			return 2 * sizeof(int32_t) + ndim * sizeof(uint64_t) +
+			       sizeof(uint64_t) + 2 * sizeof(int32_t) +
+			       2 * sizeof(uint64_t) + 2 * numChunks * sizeof(uint64_t);
+		}
+
+		bool preadAll(int fd, void* dst, size_t size, size_t offset)
+		{
+			auto* dst_char = static_cast<char*>(dst);
+			while (size > 0)
+			{
+				const ssize_t readSize = pread(fd, dst_char, size, offset);
+				if (readSize <= 0)
+				{
+					return false;
+				}
+				dst_char += readSize;
+				offset += readSize;
+				size -= readSize;
+			}
+			return true;
+		}
+	}  // namespace
+
+	size_t ChunkedFileHeader::getNumSlabs() const
+	{
+		return shape.empty() ? 0 : shape[0];
+	}
+
+	size_t ChunkedFileHeader::getSlabSizeBytes() const
+	{
+		size_t slabSize = elementSize;
+		for (size_t dim = 1; dim < shape.size(); dim++)
+		{
+			slabSize *= shape[dim];
+		}
+		return slabSize;
+	}
+
+	size_t ChunkedFileHeader::getNumChunks() const
+	{
+		return chunkOffsets.size();
+	}
+
+	size_t ChunkedFileHeader::getTotalSizeBytes() const
+	{
+		return getNumSlabs() * getSlabSizeBytes();
+	}
+
+	bool isChunkedFile(const std::string& fname)
+	{
+		std::ifstream file{fname, std::ios::binary | std::ios::in};
+		int32_t magic = 0;
+		file.read(reinterpret_cast<char*>(&magic), sizeof(int32_t));
+		return file.good() && magic == CHUNKED_MAGIC_NUMBER;
+	}
+
+	ChunkedFileHeader readChunkedFileHeader(const std::string& fname)
+	{
+		std::ifstream file{fname, std::ios::binary | std::ios::in};
+		if (!file.is_open())
+		{
+			throw std::filesystem::filesystem_error(
+			    "The file given \"" + fname + "\" could not be opened",
+			    std::make_error_code(std::errc::no_such_file_or_directory));
+		}
+		file.seekg(0, std::ios::end);
+		const size_t fileSize = file.tellg();
+		file.seekg(0, std::ios::beg);
+
+		int32_t magic = 0;
+		int32_t ndim = 0;
+		file.read(reinterpret_cast<char*>(&magic), sizeof(int32_t));
+		if (magic != CHUNKED_MAGIC_NUMBER)
+		{
+			throw std::runtime_error("The file given \"" + fname +
+			                         "\" is not a chunked array file");
+		}
+		file.read(reinterpret_cast<char*>(&ndim), sizeof(int32_t));
+		if (ndim <= 0)
+		{
+			throw std::runtime_error("The file given \"" + fname +
+			                         "\" has an invalid number of dimensions");
+		}
+
+		ChunkedFileHeader header;
+		header.shape.resize(ndim);
+		file.read(reinterpret_cast<char*>(header.shape.data()),
+		          ndim * sizeof(uint64_t));
+		uint64_t elementSize;
+		int32_t compression, reserved;
+		uint64_t slabsPerChunk, numChunks;
+		file.read(reinterpret_cast<char*>(&elementSize), sizeof(uint64_t));
+		file.read(reinterpret_cast<char*>(&compression), sizeof(int32_t));
+		file.read(reinterpret_cast<char*>(&reserved), sizeof(int32_t));
+		file.read(reinterpret_cast<char*>(&slabsPerChunk), sizeof(uint64_t));
+		file.read(reinterpret_cast<char*>(&numChunks), sizeof(uint64_t));
+		if (!file.good() ||
+		    getHeaderSize(ndim, numChunks) > fileSize || slabsPerChunk == 0)
+		{
+			throw std::runtime_error("The file given \"" + fname +
+			                         "\" has a corrupted header");
+		}
+		header.elementSize = elementSize;
+		header.compression = static_cast<ChunkCompression>(compression);
+		header.slabsPerChunk = slabsPerChunk;
+
+		header.chunkOffsets.resize(numChunks);
+		header.chunkSizes.resize(numChunks);
+		for (size_t chunk = 0; chunk < numChunks; chunk++)
+		{
+			file.read(reinterpret_cast<char*>(&header.chunkOffsets[chunk]),
+			          sizeof(uint64_t));
+			file.read(reinterpret_cast<char*>(&header.chunkSizes[chunk]),
+			          sizeof(uint64_t));
+			if (header.chunkOffsets[chunk] + header.chunkSizes[chunk] >
+			    fileSize)
+			{
+				throw std::runtime_error("The file given \"" + fname +
+				                         "\" is truncated");
+			}
+		}
+
+		const size_t expectedNumChunks =
+		    (header.getNumSlabs() + slabsPerChunk - 1) / slabsPerChunk;
+		if (numChunks != expectedNumChunks)
+		{
+			throw std::runtime_error("The file given \"" + fname +
+			                         "\" has an inconsistent chunk table");
+		}
+		return header;
+	}
+
+	void writeChunkedFile(const std::string& fname,
+	                      const std::vector<size_t>& shape, size_t elementSize,
+	                      const ChunkedFileSlabFiller& fillSlabs,
+	                      ChunkCompression compression, size_t slabsPerChunk)
+	{
+		ASSERT_MSG(!shape.empty(), "Cannot write an array without dimensions");
+		ASSERT_MSG(slabsPerChunk > 0, "The chunks must contain slabs");
+
+		ChunkedFileHeader header;
+		header.shape = shape;
+		header.elementSize = elementSize;
+		header.compression = compression;
+		header.slabsPerChunk = slabsPerChunk;
+
+		const size_t numSlabs = header.getNumSlabs();
+		const size_t slabSize = header.getSlabSizeBytes();
+		const size_t numChunks =
+		    (numSlabs + slabsPerChunk - 1) / slabsPerChunk;
+		header.chunkOffsets.resize(numChunks);
+		header.chunkSizes.resize(numChunks);
+
+		std::ofstream file{fname, std::ios::binary | std::ios::out};
+		if (!file.is_open())
+		{
+			throw std::filesystem::filesystem_error(
+			    "The file given \"" + fname + "\" could not be opened",
+			    std::make_error_code(std::errc::io_error));
+		}
+
+		// Leave room for the header, which is written once the chunk table is
+		// known
+		const size_t headerSize = getHeaderSize(shape.size(), numChunks);
+		const size_t dataStart =
+		    (headerSize + DataAlignment - 1) / DataAlignment * DataAlignment;
+		const std::vector<char> zeros(dataStart, 0);
+		file.write(zeros.data(), dataStart);
+
+		// Chunks are prepared (filled and compressed) in parallel by batches
+		// of one chunk per thread, then written in order
+		const int numThreads = Globals::get_num_threads();
+		const size_t uncompressedChunkSize = slabsPerChunk * slabSize;
+		std::vector<std::vector<unsigned char>> rawBuffers(numThreads);
+		std::vector<std::vector<unsigned char>> storedBuffers(numThreads);
+		std::vector<size_t> storedSizes(numThreads);
+
+		size_t currentOffset = dataStart;
+		for (size_t batchStart = 0; batchStart < numChunks;
+		     batchStart += numThreads)
+		{
+			const size_t batchSize =
+			    std::min<size_t>(numThreads, numChunks - batchStart);
+			int numErrors = 0;
+
+#pragma omp parallel for num_threads(numThreads) reduction(+ : numErrors)
+			for (size_t i = 0; i < batchSize; i++)
+			{
+				const size_t chunk = batchStart + i;
+				const size_t firstSlab = chunk * slabsPerChunk;
+				const size_t chunkNumSlabs =
+				    std::min(slabsPerChunk, numSlabs - firstSlab);
+				const size_t chunkSize = chunkNumSlabs * slabSize;
+
+				std::vector<unsigned char>& raw = rawBuffers[i];
+				raw.resize(uncompressedChunkSize);
+				fillSlabs(firstSlab, chunkNumSlabs, raw.data());
+
+				if (compression == ChunkCompression::ZLIB)
+				{
+					std::vector<unsigned char>& stored = storedBuffers[i];
+					uLongf compressedSize = compressBound(chunkSize);
+					stored.resize(compressedSize);
+					if (compress2(stored.data(), &compressedSize, raw.data(),
+					              chunkSize, Z_BEST_SPEED) != Z_OK)
+					{
+						numErrors++;
+					}
+					storedSizes[i] = compressedSize;
+				}
+				else
+				{
+					storedSizes[i] = chunkSize;
+				}
+			}
+			if (numErrors > 0)
+			{
+				throw std::runtime_error("Error while compressing the chunks "
+				                         "of file \"" + fname + "\"");
+			}
+
+			for (size_t i = 0; i < batchSize; i++)
+			{
+				const size_t chunk = batchStart + i;
+				const unsigned char* stored =
+				    compression == ChunkCompression::ZLIB ?
+				        storedBuffers[i].data() :
+				        rawBuffers[i].data();
+				file.write(reinterpret_cast<const char*>(stored),
+				           storedSizes[i]);
+				header.chunkOffsets[chunk] = currentOffset;
+				header.chunkSizes[chunk] = storedSizes[i];
+				currentOffset += storedSizes[i];
+			}
+		}
+
+		// Header
+		file.seekp(0, std::ios::beg);
+		const int32_t magic = CHUNKED_MAGIC_NUMBER;
+		const int32_t ndim = shape.size();
+		const uint64_t elementSize_u64 = elementSize;
+		const int32_t compression_i32 = static_cast<int32_t>(compression);
+		const int32_t reserved = 0;
+		const uint64_t slabsPerChunk_u64 = slabsPerChunk;
+		const uint64_t numChunks_u64 = numChunks;
+		file.write(reinterpret_cast<const char*>(&magic), sizeof(int32_t));
+		file.write(reinterpret_cast<const char*>(&ndim), sizeof(int32_t));
+		for (size_t dim : shape)
+		{
+			const uint64_t dim_u64 = dim;
+			file.write(reinterpret_cast<const char*>(&dim_u64),
+			           sizeof(uint64_t));
+		}
+		file.write(reinterpret_cast<const char*>(&elementSize_u64),
+		           sizeof(uint64_t));
+		file.write(reinterpret_cast<const char*>(&compression_i32),
+		           sizeof(int32_t));
+		file.write(reinterpret_cast<const char*>(&reserved), sizeof(int32_t));
+		file.write(reinterpret_cast<const char*>(&slabsPerChunk_u64),
+		           sizeof(uint64_t));
+		file.write(reinterpret_cast<const char*>(&numChunks_u64),
+		           sizeof(uint64_t));
+		for (size_t chunk = 0; chunk < numChunks; chunk++)
+		{
+			file.write(reinterpret_cast<const char*>(
+			               &header.chunkOffsets[chunk]),
+			           sizeof(uint64_t));
+			file.write(reinterpret_cast<const char*>(&header.chunkSizes[chunk]),
+			           sizeof(uint64_t));
+		}
+		if (!file.good())
+		{
+			throw std::runtime_error("Error while writing file \"" + fname +
+			                         "\"");
+		}
+	}
+
+	void writeChunkedFile(const std::string& fname, const void* data,
+	                      const std::vector<size_t>& shape, size_t elementSize,
+	                      ChunkCompression compression, size_t slabsPerChunk)
+	{
+		const auto* data_char = static_cast<const char*>(data);
+		size_t slabSize = elementSize;
+		for (size_t dim = 1; dim < shape.size(); dim++)
+		{
+			slabSize *= shape[dim];
+		}
+		writeChunkedFile(
+		    fname, shape, elementSize,
+		    [data_char, slabSize](size_t firstSlab, size_t numSlabs, void* dst)
+		    {
+			    std::memcpy(dst, data_char + firstSlab * slabSize,
+			                numSlabs * slabSize);
+		    },
+		    compression, slabsPerChunk);
+	}
+
+	void readChunkedFile(const std::string& fname,
+	                     const ChunkedFileHeader& header, void* dst,
+	                     size_t firstSlab, size_t numSlabs)
+	{
+		if (numSlabs == 0)
+		{
+			return;
+		}
+		const size_t totalNumSlabs = header.getNumSlabs();
+		if (firstSlab + numSlabs > totalNumSlabs)
+		{
+			throw std::range_error("The slabs requested are outside the array "
+			                       "stored in \"" + fname + "\"");
+		}
+
+		const int fd = open(fname.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			throw std::filesystem::filesystem_error(
+			    "The file given \"" + fname + "\" could not be opened",
+			    std::make_error_code(std::errc::no_such_file_or_directory));
+		}
+
+		auto* dst_char = static_cast<unsigned char*>(dst);
+		const size_t slabSize = header.getSlabSizeBytes();
+		const size_t slabsPerChunk = header.slabsPerChunk;
+		const size_t firstChunk = firstSlab / slabsPerChunk;
+		const size_t lastChunk = (firstSlab + numSlabs - 1) / slabsPerChunk;
+		const size_t endSlab = firstSlab + numSlabs;
+		int numErrors = 0;
+
+#pragma omp parallel for schedule(dynamic) reduction(+ : numErrors)
+		for (size_t chunk = firstChunk; chunk <= lastChunk; chunk++)
+		{
+			const size_t chunkFirstSlab = chunk * slabsPerChunk;
+			const size_t chunkNumSlabs =
+			    std::min(slabsPerChunk, totalNumSlabs - chunkFirstSlab);
+			const size_t chunkSize = chunkNumSlabs * slabSize;
+
+			// Range of slabs to copy from this chunk
+			const size_t copyStart = std::max(firstSlab, chunkFirstSlab);
+			const size_t copyEnd =
+			    std::min(endSlab, chunkFirstSlab + chunkNumSlabs);
+			unsigned char* copyDst =
+			    dst_char + (copyStart - firstSlab) * slabSize;
+			const size_t copySize = (copyEnd - copyStart) * slabSize;
+			const size_t copyOffsetInChunk =
+			    (copyStart - chunkFirstSlab) * slabSize;
+
+			if (header.compression == ChunkCompression::NONE)
+			{
+				if (!preadAll(fd, copyDst, copySize,
+				              header.chunkOffsets[chunk] + copyOffsetInChunk))
+				{
+					numErrors++;
+				}
+				continue;
+			}
+
+			std::vector<unsigned char> stored(header.chunkSizes[chunk]);
+			if (!preadAll(fd, stored.data(), stored.size(),
+			              header.chunkOffsets[chunk]))
+			{
+				numErrors++;
+				continue;
+			}
+
+			// Decompress directly in the destination when the whole chunk is
+			// needed
+			const bool isFullChunk = copySize == chunkSize;
+			std::vector<unsigned char> tmp;
+			unsigned char* uncompressedDst = copyDst;
+			if (!isFullChunk)
+			{
+				tmp.resize(chunkSize);
+				uncompressedDst = tmp.data();
+			}
+			uLongf uncompressedSize = chunkSize;
+			if (uncompress(uncompressedDst, &uncompressedSize, stored.data(),
+			               stored.size()) != Z_OK ||
+			    uncompressedSize != chunkSize)
+			{
+				numErrors++;
+				continue;
+			}
+			if (!isFullChunk)
+			{
+				std::memcpy(copyDst, tmp.data() + copyOffsetInChunk, copySize);
+			}
+		}
+		close(fd);
+
+		if (numErrors > 0)
+		{
+			throw std::runtime_error("Error while reading the chunks of file "
+			                         "\"" + fname + "\"");
+		}
+	}
+
+	ChunkedFileMapping::ChunkedFileMapping(const std::string& fname)
+	    : m_header(readChunkedFileHeader(fname)),
+	      mp_mapping(nullptr),
+	      m_mappingSize(0)
+	{
+		if (m_header.compression != ChunkCompression::NONE)
+		{
+			throw std::invalid_argument("The file \"" + fname +
+			                            "\" is compressed and cannot be "
+			                            "memory-mapped");
+		}
+		const int fd = open(fname.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			throw std::filesystem::filesystem_error(
+			    "The file given \"" + fname + "\" could not be opened",
+			    std::make_error_code(std::errc::no_such_file_or_directory));
+		}
+		const size_t dataStart =
+		    m_header.getNumChunks() > 0 ? m_header.chunkOffsets[0] : 0;
+		m_mappingSize = dataStart + m_header.getTotalSizeBytes();
+		void* mapping = mmap(nullptr, m_mappingSize, PROT_READ | PROT_WRITE,
+		                     MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (mapping == MAP_FAILED)
+		{
+			throw std::runtime_error("Could not memory-map file \"" + fname +
+			                         "\"");
+		}
+		mp_mapping = mapping;
+	}
+
+	ChunkedFileMapping::~ChunkedFileMapping()
+	{
+		if (mp_mapping != nullptr)
+		{
+			munmap(mp_mapping, m_mappingSize);
+		}
+	}
+
+	const ChunkedFileHeader& ChunkedFileMapping::getHeader() const
+	{
+		return m_header;
+	}
+
+	void* ChunkedFileMapping::getData() const
+	{
+		if (m_header.getNumChunks() == 0)
+		{
+			return nullptr;
+		}
+		return static_cast<char*>(mp_mapping) + m_header.chunkOffsets[0];
+	}
+
+}  // namespace Util
@@ -0,0 +1,184 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "utils/FFT.hpp"
+
+#include "geometry/Constants.hpp"
+#include "utils/Assert.hpp"
+
+#include <cmath>
+
+namespace Util
+{
+	FFT1D::FFT1D(size_t n) : m_size(n)
+	{
+		ASSERT_MSG(n > 0, "The FFT length has to be positive");
+
+		m_sizeRadix2 = isPowerOfTwo(n) ? n : nextPowerOfTwo(2 * n - 1);
+
+		// Bit-reversal permutation
+		size_t numBits = 0;
+		while ((size_t{1} << numBits) < m_sizeRadix2)
+		{
+			numBits++;
+		}
+		m_bitReversal.resize(m_sizeRadix2);
+		for (size_t i = 0; i < m_sizeRadix2; i++)
+		{
+			size_t reversed = 0;
+			for (size_t b = 0; b < numBits; b++)
+			{
+				reversed |= ((i >> b) & 1) << (numBits - 1 - b);
+			}
+			m_bitReversal[i] = reversed;
+		}
+
+		// Twiddle factors, computed in double precision
+		m_twiddles.resize(m_sizeRadix2 / 2);
+		for (size_t k = 0; k < m_twiddles.size(); k++)
+		{
+			const double angle = -TWOPI * static_cast<double>(k) /
+			                     static_cast<double>(m_sizeRadix2);
+			m_twiddles[k] = std::complex<float>(std::cos(angle), std::sin(angle));
+		}
+
+		if (m_sizeRadix2 != m_size)
+		{
+			// Chirp e^(-i*pi*k^2/n), with k^2 taken modulo 2n to keep the
+			// angle accurate for large k
+			m_chirp.resize(m_size);
+			for (size_t k = 0; k < m_size; k++)
+			{
+				const size_t k2 = (k * k) % (2 * m_size);
+				const double angle =
+				    -PI * static_cast<double>(k2) / static_cast<double>(m_size);
+				m_chirp[k] =
+				    std::complex<float>(std::cos(angle), std::sin(angle));
+			}
+			m_chirpFilterFT.assign(m_sizeRadix2, std::complex<float>(0.0f));
+			m_chirpFilterFT[0] = std::conj(m_chirp[0]);
+			for (size_t k = 1; k < m_size; k++)
+			{
+				m_chirpFilterFT[k] = std::conj(m_chirp[k]);
+				m_chirpFilterFT[m_sizeRadix2 - k] = std::conj(m_chirp[k]);
+			}
+			transformRadix2(m_chirpFilterFT.data(), false);
+		}
+	}
+
+	size_t FFT1D::getSize() const
+	{
+		return m_size;
+	}
+
+	void FFT1D::forward(std::complex<float>* data) const
+	{
+		transform(data, false);
+	}
+
+	void FFT1D::inverse(std::complex<float>* data) const
+	{
+		transform(data, true);
+	}
+
+	bool FFT1D::isPowerOfTwo(size_t n)
+	{
+		return n > 0 && (n & (n - 1)) == 0;
+	}
+
+	size_t FFT1D::nextPowerOfTwo(size_t n)
+	{
+		size_t p = 1;
+		while (p < n)
+		{
+			p <<= 1;
+		}
+		return p;
+	}
+
+	void FFT1D::transform(std::complex<float>* data, bool inverse) const
+	{
+		if (m_sizeRadix2 == m_size)
+		{
+			transformRadix2(data, inverse);
+		}
+		else
+		{
+			transformBluestein(data, inverse);
+		}
+		if (inverse)
+		{
+			const float scale = 1.0f / static_cast<float>(m_size);
+			for (size_t i = 0; i < m_size; i++)
+			{
+				data[i] *= scale;
+			}
+		}
+	}
+
+	void FFT1D::transformRadix2(std::complex<float>* data, bool inverse) const
+	{
+		const size_t n = m_sizeRadix2;
+		for (size_t i = 0; i < n; i++)
+		{
+			const size_t j = m_bitReversal[i];
+			if (i < j)
+			{
+				std::swap(data[i], data[j]);
+			}
+		}
+
+		for (size_t len = 2; len <= n; len <<= 1)
+		{
+			const size_t halfLen = len / 2;
+			const size_t twiddleStep = n / len;
+			for (size_t i = 0; i < n; i += len)
+			{
+				for (size_t j = 0; j < halfLen; j++)
+				{
+					std::complex<float> w = m_twiddles[j * twiddleStep];
+					if (inverse)
+					{
+						w = std::conj(w);
+					}
+					const std::complex<float> u = data[i + j];
+					const std::complex<float> v = data[i + j + halfLen] * w;
+					data[i + j] = u + v;
+					data[i + j + halfLen] = u - v;
+				}
+			}
+		}
+	}
+
+	void FFT1D::transformBluestein(std::complex<float>* data,
+	                               bool inverse) const
+	{
+		// The inverse transform is the conjugate of the forward transform of
+		// the conjugate
+		std::vector<std::complex<float>> work(m_sizeRadix2,
+		                                      std::complex<float>(0.0f));
+		for (size_t k = 0; k < m_size; k++)
+		{
+			const std::complex<float> x =
+			    inverse ? std::conj(data[k]) : data[k];
+			work[k] = x * m_chirp[k];
+		}
+
+		// Circular convolution with the chirp filter
+		transformRadix2(work.data(), false);
+		for (size_t k = 0; k < m_sizeRadix2; k++)
+		{
+			work[k] *= m_chirpFilterFT[k];
+		}
+		transformRadix2(work.data(), true);
+
+		const float scale = 1.0f / static_cast<float>(m_sizeRadix2);
+		for (size_t k = 0; k < m_size; k++)
+		{
+			const std::complex<float> x = work[k] * scale * m_chirp[k];
+			data[k] = inverse ? std::conj(x) : x;
+		}
+	}
+}  // namespace Util
@@ -6,17 +6,23 @@
 #include "utils/ReconstructionUtils.hpp"
 
 #include "datastruct/IO.hpp"
+#include "datastruct/image/ImageResampler.hpp"
 #include "datastruct/projection/Histogram3D.hpp"
 #include "datastruct/projection/ListModeLUT.hpp"
+#include "datastruct/projection/TOFHistogram3D.hpp"
 #include "geometry/Matrix.hpp"
 #include "operators/OperatorProjectorDD.hpp"
 #include "operators/OperatorProjectorSiddon.hpp"
 #include "recon/OSEM_CPU.hpp"
+#include "scatter/ScatterEstimator.hpp"
 #include "utils/Assert.hpp"
 #include "utils/Globals.hpp"
 #include "utils/ProgressDisplayMultiThread.hpp"
 #include "utils/Tools.hpp"
 
+#include <array>
+#include <map>
+
 #if BUILD_CUDA
 #include "operators/OperatorProjectorDD_GPU.cuh"
 #include "recon/OSEM_GPU.cuh"
@@ -39,6 +45,8 @@ void py_setup_reconstructionutils(pybind11::module& m)
 	    "convertToHistogram3D", [](const ListMode& dat, Histogram3D& histoOut)
 	    { Util::convertToHistogram3D<true>(dat, histoOut); },
 	    py::arg("listmodeDataInput"), py::arg("histoOut"));
+	m.def("convertToTOFHistogram3D", &Util::convertToTOFHistogram3D,
+	      py::arg("dataInput"), py::arg("histoOut"));
 	m.def(
 	    "createOSEM",
 	    [](const Scanner& scanner, bool useGPU)
@@ -48,6 +56,18 @@ void py_setup_reconstructionutils(pybind11::module& m)
 		    return osem;
 	    },
 	    py::arg("scanner"), py::arg("useGPU") = false);
+	m.def("reconstructWithScatterEstimation",
+	      &Util::reconstructWithScatterEstimation, py::arg("osem"),
+	      py::arg("scatterEstimator"), py::arg("scatterHis"),
+	      py::arg("numScatterRounds"), py::arg("numberZ"),
+	      py::arg("numberPhi"), py::arg("numberR"), py::arg("out_fname") = "");
+	m.def("timeAverageMoveSensitivityImage",
+	      &Util::timeAverageMoveSensitivityImage, py::arg("dataInput"),
+	      py::arg("unmovedSensImage"), py::arg("movedSensImage"));
+	m.def("timeAverageMoveSensitivityImageExact",
+	      &Util::timeAverageMoveSensitivityImageExact, py::arg("dataInput"),
+	      py::arg("sensData"), py::arg("movedSensImage"),
+	      py::arg("projectorType") = OperatorProjector::SIDDON);
 	m.def("generateTORRandomDOI", &Util::generateTORRandomDOI,
 	      py::arg("scanner"), py::arg("d1"), py::arg("d2"), py::arg("vmax"));
 
@@ -102,20 +122,217 @@ void py_setup_reconstructionutils(pybind11::module& m)
 
 #endif
 
+namespace
+{
+	// Projection data whose LORs are all moved by the same transform. Used
+	// to backproject the sensitivity data as seen from one frame of motion
+	class MovedProjectionData : public ProjectionData
+	{
+	public:
+		MovedProjectionData(const ProjectionData& reference,
+		                    const transform_t& transform)
+		    : ProjectionData{reference.getScanner()},
+		      mr_reference{reference},
+		      m_transform{transform}
+		{
+		}
+
+		size_t count() const override { return mr_reference.count(); }
+		float getProjectionValue(bin_t id) const override
+		{
+			return mr_reference.getProjectionValue(id);
+		}
+		void setProjectionValue(bin_t id, float val) override
+		{
+			(void)id;
+			(void)val;
+			throw std::logic_error("The moved projection data is read-only");
+		}
+		det_id_t getDetector1(bin_t id) const override
+		{
+			return mr_reference.getDetector1(id);
+		}
+		det_id_t getDetector2(bin_t id) const override
+		{
+			return mr_reference.getDetector2(id);
+		}
+		det_pair_t getDetectorPair(bin_t id) const override
+		{
+			return mr_reference.getDetectorPair(id);
+		}
+		histo_bin_t getHistogramBin(bin_t bin) const override
+		{
+			return mr_reference.getHistogramBin(bin);
+		}
+		std::unique_ptr<BinIterator> getBinIter(int numSubsets,
+		                                        int idxSubset) const override
+		{
+			return mr_reference.getBinIter(numSubsets, idxSubset);
+		}
+		bool hasTOF() const override { return mr_reference.hasTOF(); }
+		float getTOFValue(bin_t id) const override
+		{
+			return mr_reference.getTOFValue(id);
+		}
+		bool hasTOFBins() const override { return mr_reference.hasTOFBins(); }
+		size_t getNumTOFBins() const override
+		{
+			return mr_reference.getNumTOFBins();
+		}
+		float getTOFBinWidth() const override
+		{
+			return mr_reference.getTOFBinWidth();
+		}
+		bool hasMotion() const override { return true; }
+		frame_t getFrame(bin_t id) const override
+		{
+			(void)id;
+			return 0;
+		}
+		transform_t getTransformOfFrame(frame_t frame) const override
+		{
+			(void)frame;
+			return m_transform;
+		}
+		bool hasArbitraryLORs() const override
+		{
+			return mr_reference.hasArbitraryLORs();
+		}
+		Line3D getArbitraryLOR(bin_t id) const override
+		{
+			return mr_reference.getArbitraryLOR(id);
+		}
+		bool hasLORBundles() const override
+		{
+			return mr_reference.hasLORBundles();
+		}
+		size_t getNumLORsInBin(bin_t bin) const override
+		{
+			return mr_reference.getNumLORsInBin(bin);
+		}
+		det_pair_t getDetectorPairInBin(bin_t bin,
+		                                size_t lorIdx) const override
+		{
+			return mr_reference.getDetectorPairInBin(bin, lorIdx);
+		}
+		float getWeightOfLORInBin(bin_t bin, size_t lorIdx) const override
+		{
+			return mr_reference.getWeightOfLORInBin(bin, lorIdx);
+		}
+		// The moved LORs leave their transaxial planes
+		bool hasTransaxialLORs() const override { return false; }
+		bool hasDuplicateLORs() const override
+		{
+			return mr_reference.hasDuplicateLORs();
+		}
+		uint64_t getLORKey(bin_t bin) const override
+		{
+			return mr_reference.getLORKey(bin);
+		}
+
+	private:
+		const ProjectionData& mr_reference;
+		transform_t m_transform;
+	};
+
+	using TransformKey = std::array<float, 12>;
+
+	// Sum of the durations of the frames of every distinct transform,
+	// normalized by the total duration of the frames
+	std::map<TransformKey, float>
+	    getWeightPerTransform(const ProjectionData& dataInput)
+	{
+		ASSERT_MSG(dataInput.hasMotion(), "The data input has no motion");
+		const frame_t numFrames =
+		    static_cast<frame_t>(dataInput.getNumFrames());
+
+		std::map<TransformKey, double> durations;
+		double totalDuration = 0.0;
+		for (frame_t frame = 0; frame < numFrames; frame++)
+		{
+			const float duration = dataInput.getDurationOfFrame(frame);
+			if (duration <= 0.0f)
+			{
+				continue;
+			}
+			const transform_t t = dataInput.getTransformOfFrame(frame);
+			durations[{t.r00, t.r01, t.r02, t.r10, t.r11, t.r12, t.r20, t.r21,
+			           t.r22, t.tx, t.ty, t.tz}] += duration;
+			totalDuration += duration;
+		}
+		ASSERT_MSG(totalDuration > 0.0, "The frames have no duration");
+
+		std::map<TransformKey, float> weights;
+		for (const auto& [key, duration] : durations)
+		{
+			weights[key] = static_cast<float>(duration / totalDuration);
+		}
+		return weights;
+	}
+
+	transform_t toTransform(const TransformKey& key)
+	{
+		return {key[0], key[1], key[2], key[3],  key[4],  key[5],
+		        key[6], key[7], key[8], key[9], key[10], key[11]};
+	}
+
+	// Gives back to the OSEM and the scatter estimator the state they had
+	// before the scatter rounds, including when an exception is thrown
+	class ScatterEstimationStateGuard
+	{
+	public:
+		ScatterEstimationStateGuard(OSEM& osem,
+		                            Scatter::ScatterEstimator& scatterEstimator)
+		    : mr_osem{osem},
+		      mr_scatterEstimator{scatterEstimator},
+		      mp_initialEstimate{osem.initialEstimate},
+		      mp_scatterHis{osem.getScatterHistogram()},
+		      m_needToMakeCopyOfSensImage{osem.isNeedToMakeCopyOfSensImage()},
+		      mr_sourceImage{scatterEstimator.getSourceImage()},
+		      m_cacheDetectorTables{scatterEstimator.isCacheDetectorTables()}
+		{
+		}
+		ScatterEstimationStateGuard(const ScatterEstimationStateGuard&) =
+		    delete;
+		ScatterEstimationStateGuard&
+		    operator=(const ScatterEstimationStateGuard&) = delete;
+
+		~ScatterEstimationStateGuard()
+		{
+			mr_osem.initialEstimate = mp_initialEstimate;
+			mr_osem.setScatterHistogram(mp_scatterHis);
+			mr_osem.setNeedToMakeCopyOfSensImage(m_needToMakeCopyOfSensImage);
+			// The images of the rounds do not outlive the scatter estimation
+			mr_scatterEstimator.setSourceImage(mr_sourceImage);
+			mr_scatterEstimator.setCacheDetectorTables(m_cacheDetectorTables);
+		}
+
+	private:
+		OSEM& mr_osem;
+		Scatter::ScatterEstimator& mr_scatterEstimator;
+		const Image* mp_initialEstimate;
+		const Histogram* mp_scatterHis;
+		bool m_needToMakeCopyOfSensImage;
+		const Image& mr_sourceImage;
+		bool m_cacheDetectorTables;
+	};
+}  // namespace
+
 namespace Util
 {
 	void histogram3DToListModeLUT(const Histogram3D* histo,
 	                              ListModeLUTOwned* lmOut, size_t numEvents)
 	{
 		ASSERT(lmOut != nullptr);
-		const float* dataPtr = histo->getData().getRawPointer();
+		// Read through getProjectionValue so that every storage variant of
+		// Histogram3D can be converted
 
 		// Phase 1: calculate sum of histogram values
 		double sum = 0.0;
 #pragma omp parallel for reduction(+ : sum)
 		for (bin_t binId = 0; binId < histo->count(); binId++)
 		{
-			sum += dataPtr[binId];
+			sum += histo->getProjectionValue(binId);
 		}
 
 		// Default target number of events (histogram sum)
@@ -128,7 +345,8 @@ namespace Util
 #pragma omp parallel for reduction(+ : sumInt)
 		for (bin_t binId = 0; binId < histo->count(); binId++)
 		{
-			sumInt += std::lround(dataPtr[binId] / sum * (double)numEvents);
+			sumInt += std::lround(histo->getProjectionValue(binId) / sum *
+			                      (double)numEvents);
 		}
 
 		// Allocate list-mode data
@@ -152,7 +370,8 @@ namespace Util
 				for (bin_t binId = binStart; binId <= binEnd; binId++)
 				{
 					partialSums[ti] +=
-					    std::lround(dataPtr[binId] / sum * (double)numEvents);
+					    std::lround(histo->getProjectionValue(binId) / sum *
+					                (double)numEvents);
 				}
 			}
 
@@ -175,11 +394,12 @@ namespace Util
 				bin_t eventId = lmStartIdx[ti];
 				for (bin_t binId = binStart; binId <= binEnd; binId++)
 				{
-					if (dataPtr[binId] != 0.f)
+					const float binValue = histo->getProjectionValue(binId);
+					if (binValue != 0.f)
 					{
 						auto [d1, d2] = histo->getDetectorPair(binId);
-						int numEventsBin = std::lround(dataPtr[binId] / sum *
-						                               (double)numEvents);
+						int numEventsBin =
+						    std::lround(binValue / sum * (double)numEvents);
 						for (int ei = 0; ei < numEventsBin; ei++)
 						{
 							lmOut->setDetectorIdsOfEvent(eventId++, d1, d2);
@@ -193,11 +413,12 @@ namespace Util
 			bin_t eventId = 0;
 			for (bin_t binId = 0; binId < histo->count(); binId++)
 			{
-				if (dataPtr[binId] != 0.f)
+				const float binValue = histo->getProjectionValue(binId);
+				if (binValue != 0.f)
 				{
 					auto [d1, d2] = histo->getDetectorPair(binId);
 					int numEventsBin =
-					    std::lround(dataPtr[binId] / sum * (double)numEvents);
+					    std::lround(binValue / sum * (double)numEvents);
 					for (int ei = 0; ei < numEventsBin; ei++)
 					{
 						lmOut->setDetectorIdsOfEvent(eventId++, d1, d2);
@@ -254,6 +475,48 @@ namespace Util
 	template void convertToHistogram3D<false>(const ProjectionData&,
 	                                          Histogram3D&);
 
+	void convertToTOFHistogram3D(const ProjectionData& dat,
+	                             TOFHistogram3D& histoOut)
+	{
+		ASSERT_MSG(dat.hasTOF(), "The data given has no TOF information");
+		ASSERT(histoOut.isMemoryValid());
+
+		float* histoDataPointer = histoOut.getData().getRawPointer();
+		const size_t numDatBins = dat.count();
+
+		ProgressDisplayMultiThread progressBar(Globals::get_num_threads(),
+		                                       numDatBins, 5);
+
+		const TOFHistogram3D* histoOut_constptr = &histoOut;
+		const ProjectionData* dat_constptr = &dat;
+#pragma omp parallel for default(none)                            \
+    firstprivate(histoDataPointer, numDatBins, histoOut_constptr, \
+                     dat_constptr) shared(progressBar)
+		for (bin_t datBin = 0; datBin < numDatBins; ++datBin)
+		{
+			progressBar.progress(omp_get_thread_num(), 1);
+
+			const float projValue = dat_constptr->getProjectionValue(datBin);
+			if (projValue > 0)
+			{
+				const auto [d1, d2] = dat_constptr->getDetectorPair(datBin);
+				if (d1 == d2)
+				{
+					// Do not crash
+					continue;
+				}
+				bin_t histoBin;
+				if (!histoOut_constptr->getBinIdFromEvent(
+				        d1, d2, dat_constptr->getTOFValue(datBin), histoBin))
+				{
+					continue;
+				}
+#pragma omp atomic
+				histoDataPointer[histoBin] += projValue;
+			}
+		}
+	}
+
 	Line3D getNativeLOR(const Scanner& scanner, const ProjectionData& dat,
 	                    bin_t binId)
 	{
@@ -314,6 +577,83 @@ namespace Util
 		return osem;
 	}
 
+	std::unique_ptr<ImageOwned> reconstructWithScatterEstimation(
+	    OSEM& osem, Scatter::ScatterEstimator& scatterEstimator,
+	    Histogram3D& scatterHis, int numScatterRounds, size_t numberZ,
+	    size_t numberPhi, size_t numberR, const std::string& out_fname)
+	{
+		ASSERT_MSG(numScatterRounds > 0, "Not enough scatter rounds");
+		ASSERT_MSG(scatterHis.isMemoryValid(),
+		           "Scatter histogram is unallocated or unbound");
+
+		const ScatterEstimationStateGuard stateGuard{osem, scatterEstimator};
+		osem.setScatterHistogram(&scatterHis);
+		// The list-mode reconstruction rescales the sensitivity image, which
+		// must then be done in a copy to be repeated
+		osem.enableNeedToMakeCopyOfSensImage();
+		// Only the emission integrals change between rounds
+		scatterEstimator.setCacheDetectorTables(true);
+
+		std::unique_ptr<ImageOwned> image;
+		for (int round = 0; round < numScatterRounds; round++)
+		{
+			std::cout << "\nScatter round " << round + 1 << "/"
+			          << numScatterRounds << "..." << std::endl;
+			image = osem.reconstruct("");
+			osem.initialEstimate = image.get();
+
+			scatterEstimator.setSourceImage(*image);
+			scatterEstimator.updateTailFittedScatterEstimate(
+			    scatterHis, numberZ, numberPhi, numberR);
+		}
+
+		std::cout << "\nFinal reconstruction..." << std::endl;
+		return osem.reconstruct(out_fname);
+	}
+
+	void timeAverageMoveSensitivityImage(const ProjectionData& dataInput,
+	                                     const Image& unmovedSensImage,
+	                                     Image& movedSensImage)
+	{
+		const std::map<TransformKey, float> weights =
+		    getWeightPerTransform(dataInput);
+
+		std::cout << "Moving sensitivity image (" << weights.size()
+		          << " distinct transforms)..." << std::endl;
+		movedSensImage.setValue(0.0f);
+		for (const auto& [key, weight] : weights)
+		{
+			// The resampler processes the slices in parallel
+			ImageResampler::resample(unmovedSensImage, movedSensImage,
+			                         toTransform(key), weight);
+		}
+	}
+
+	void timeAverageMoveSensitivityImageExact(
+	    const ProjectionData& dataInput, const ProjectionData& sensData,
+	    Image& movedSensImage, OperatorProjector::ProjectorType projectorType)
+	{
+		const std::map<TransformKey, float> weights =
+		    getWeightPerTransform(dataInput);
+
+		const auto binIter = sensData.getBinIter(1, 0);
+		const OperatorProjectorParams projParams{binIter.get(),
+		                                         sensData.getScanner()};
+
+		auto frameImage =
+		    std::make_unique<ImageOwned>(movedSensImage.getParams());
+		frameImage->allocate();
+		movedSensImage.setValue(0.0f);
+		for (const auto& [key, weight] : weights)
+		{
+			const MovedProjectionData movedSensData{sensData,
+			                                        toTransform(key)};
+			frameImage->setValue(0.0f);
+			backProject(*frameImage, movedSensData, projParams, projectorType);
+			frameImage->multWithScalar(weight);
+			frameImage->addFirstImageToSecond(&movedSensImage);
+		}
+	}
 
 	// Forward and backward projections
 	template <bool IS_FWD>
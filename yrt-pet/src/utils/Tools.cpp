@@ -5,6 +5,8 @@
 
 #include "utils/Tools.hpp"
 
+#include "utils/Assert.hpp"
+
 #include <iostream>
 #include <sstream>
 
@@ -401,6 +403,132 @@ namespace Util
 	template void fillBox(Array3DBase<double>& arr, size_t z1, size_t z2,
 	                      size_t y1, size_t y2, size_t x1, size_t x2);
 
+	namespace
+	{
+		// Monotone cubic Hermite interpolation at every integer between the
+		// first and the last knots, get(x) and set(x, v) accessing the values
+		template <typename T, typename GetFunc, typename SetFunc>
+		void interpolateMonotoneCubic(const std::vector<size_t>& knots,
+		                              GetFunc get, SetFunc set)
+		{
+			const size_t numKnots = knots.size();
+			if (numKnots < 2)
+			{
+				return;
+			}
+
+			// Secant slopes, then Fritsch-Carlson tangents
+			std::vector<T> slopes(numKnots - 1);
+			for (size_t k = 0; k < numKnots - 1; k++)
+			{
+				slopes[k] = (get(knots[k + 1]) - get(knots[k])) /
+				            static_cast<T>(knots[k + 1] - knots[k]);
+			}
+			std::vector<T> tangents(numKnots);
+			tangents[0] = slopes[0];
+			tangents[numKnots - 1] = slopes[numKnots - 2];
+			for (size_t k = 1; k < numKnots - 1; k++)
+			{
+				if (slopes[k - 1] * slopes[k] <= 0)
+				{
+					tangents[k] = 0;
+					continue;
+				}
+				const T h0 = static_cast<T>(knots[k] - knots[k - 1]);
+				const T h1 = static_cast<T>(knots[k + 1] - knots[k]);
+				const T w0 = 2 * h1 + h0;
+				const T w1 = h1 + 2 * h0;
+				tangents[k] =
+				    (w0 + w1) / (w0 / slopes[k - 1] + w1 / slopes[k]);
+			}
+
+			for (size_t k = 0; k < numKnots - 1; k++)
+			{
+				const T v0 = get(knots[k]);
+				const T v1 = get(knots[k + 1]);
+				const T h = static_cast<T>(knots[k + 1] - knots[k]);
+				for (size_t x = knots[k] + 1; x < knots[k + 1]; x++)
+				{
+					const T t = static_cast<T>(x - knots[k]) / h;
+					const T t2 = t * t;
+					const T t3 = t2 * t;
+					set(x, (2 * t3 - 3 * t2 + 1) * v0 +
+					           (t3 - 2 * t2 + t) * h * tangents[k] +
+					           (-2 * t3 + 3 * t2) * v1 +
+					           (t3 - t2) * h * tangents[k + 1]);
+				}
+			}
+		}
+	}  // namespace
+
+	template <typename T>
+	void fillGridMonotoneCubic(Array3DBase<T>& arr,
+	                           const std::vector<size_t>& zKnots,
+	                           const std::vector<size_t>& yKnots,
+	                           const std::vector<size_t>& xKnots)
+	{
+		ASSERT(!zKnots.empty() && !yKnots.empty() && !xKnots.empty());
+		T* data = arr.getRawPointer();
+		const size_t ny = arr.getSize(1);
+		const size_t nx = arr.getSize(2);
+		const size_t numZ = zKnots.size();
+		const size_t numY = yKnots.size();
+		const size_t yFirst = yKnots.front();
+		const size_t yLast = yKnots.back();
+		const size_t xFirst = xKnots.front();
+		const size_t xLast = xKnots.back();
+
+		// Along x, on the (z, y) knots
+#pragma omp parallel for collapse(2)
+		for (size_t zi = 0; zi < numZ; zi++)
+		{
+			for (size_t yi = 0; yi < numY; yi++)
+			{
+				T* row = data + (zKnots[zi] * ny + yKnots[yi]) * nx;
+				interpolateMonotoneCubic<T>(
+				    xKnots, [row](size_t x) { return row[x]; },
+				    [row](size_t x, T v) { row[x] = v; });
+			}
+		}
+
+		// Along y, on the z knots
+#pragma omp parallel for collapse(2)
+		for (size_t zi = 0; zi < numZ; zi++)
+		{
+			for (size_t x = xFirst; x <= xLast; x++)
+			{
+				T* col = data + zKnots[zi] * ny * nx + x;
+				interpolateMonotoneCubic<T>(
+				    yKnots, [col, nx](size_t y) { return col[y * nx]; },
+				    [col, nx](size_t y, T v) { col[y * nx] = v; });
+			}
+		}
+
+		// Along z
+#pragma omp parallel for collapse(2)
+		for (size_t y = yFirst; y <= yLast; y++)
+		{
+			for (size_t x = xFirst; x <= xLast; x++)
+			{
+				T* col = data + y * nx + x;
+				const size_t stride = ny * nx;
+				interpolateMonotoneCubic<T>(
+				    zKnots,
+				    [col, stride](size_t z) { return col[z * stride]; },
+				    [col, stride](size_t z, T v) { col[z * stride] = v; });
+			}
+		}
+	}
+
+	template void fillGridMonotoneCubic(Array3DBase<float>& arr,
+	                                    const std::vector<size_t>& zKnots,
+	                                    const std::vector<size_t>& yKnots,
+	                                    const std::vector<size_t>& xKnots);
+	template void fillGridMonotoneCubic(Array3DBase<double>& arr,
+	                                    const std::vector<size_t>& zKnots,
+	                                    const std::vector<size_t>& yKnots,
+	                                    const std::vector<size_t>& xKnots);
+
 	int numberOfDigits(int n)
 	{
 		if (n == 0)
@@ -0,0 +1,140 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "catch.hpp"
+
+#include "kinetic/Graphical.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+	double getRandom(double low, double high)
+	{
+		return low + (high - low) * static_cast<double>(rand()) / RAND_MAX;
+	}
+
+	// Bolus-shaped input function sampled every dt, positive after time zero
+	InputFunction<double> getInputFunction(int numFrames, double dt)
+	{
+		std::vector<double> times(numFrames);
+		std::vector<double> values(numFrames);
+		for (int ti = 0; ti < numFrames; ti++)
+		{
+			times[ti] = (ti + 1) * dt;
+			values[ti] = 50.0 * times[ti] * std::exp(-2.0 * times[ti]) +
+			             2.0 * std::exp(-0.05 * times[ti]) + 1.0;
+		}
+		return InputFunction<double>(times.data(), values.data(), numFrames);
+	}
+}  // namespace
+
+TEST_CASE("graphical", "[kinetic]")
+{
+	srand(13);
+	// Not a multiple of the number of pixels processed together
+	constexpr size_t NumPix = 300;
+
+	SECTION("graphical-patlak")
+	{
+		constexpr int NumFrames = 30;
+		const InputFunction<double> input = getInputFunction(NumFrames, 2.0);
+		const double* cp = input.getValues();
+		const double* cp_int = input.getCumulativeIntegrals();
+
+		// Irreversible uptake, with the TAC matching the Patlak plot exactly
+		std::vector<double> tac_all(NumFrames * NumPix);
+		std::vector<double> Ki(NumPix);
+		std::vector<double> V(NumPix);
+		for (size_t pi = 0; pi < NumPix; pi++)
+		{
+			Ki[pi] = getRandom(0.0, 0.1);
+			V[pi] = getRandom(0.0, 1.0);
+			for (int ti = 0; ti < NumFrames; ti++)
+			{
+				tac_all[ti * NumPix + pi] =
+				    Ki[pi] * cp_int[ti] + V[pi] * cp[ti];
+			}
+		}
+		std::vector<double> W(NumFrames);
+		for (int ti = 0; ti < NumFrames; ti++)
+		{
+			W[ti] = getRandom(0.5, 2.0);
+		}
+
+		for (const double* weights : {static_cast<const double*>(nullptr),
+		                              static_cast<const double*>(W.data())})
+		{
+			std::vector<double> kin_out(2 * NumPix);
+			solvePatlak(tac_all.data(), kin_out.data(), input, weights, 10,
+			            NumPix, 4);
+			for (size_t pi = 0; pi < NumPix; pi++)
+			{
+				CHECK(kin_out[pi] == Approx(Ki[pi]).margin(1e-9));
+				CHECK(kin_out[NumPix + pi] == Approx(V[pi]).margin(1e-9));
+			}
+		}
+	}
+
+	SECTION("graphical-logan")
+	{
+		// One-tissue compartment TACs, finely sampled so that the trapezoidal
+		// integral of the TACs is accurate
+		constexpr int NumFrames = 1200;
+		constexpr double Dt = 0.05;
+		const InputFunction<double> input = getInputFunction(NumFrames, Dt);
+
+		std::vector<double> tac_all(NumFrames * NumPix);
+		std::vector<double> VT(NumPix);
+		std::vector<double> conv(NumFrames);
+		for (size_t pi = 0; pi < NumPix; pi++)
+		{
+			const double K1 = getRandom(0.1, 0.5);
+			const double k2 = getRandom(0.1, 0.3);
+			VT[pi] = K1 / k2;
+			input.convolveExponential(k2, conv.data());
+			for (int ti = 0; ti < NumFrames; ti++)
+			{
+				tac_all[ti * NumPix + pi] = K1 * conv[ti];
+			}
+		}
+		// Empty pixel, left out of the fit
+		for (int ti = 0; ti < NumFrames; ti++)
+		{
+			tac_all[ti * NumPix] = 0.0;
+		}
+
+		std::vector<double> kin_out(2 * NumPix);
+		solveLogan(tac_all.data(), kin_out.data(), input,
+		           static_cast<const double*>(nullptr), NumFrames / 2, NumPix,
+		           4);
+		CHECK(kin_out[0] == 0.0);
+		CHECK(kin_out[NumPix] == 0.0);
+		for (size_t pi = 1; pi < NumPix; pi++)
+		{
+			CHECK(kin_out[pi] == Approx(VT[pi]).epsilon(1e-3));
+		}
+
+		// Same plot in single precision. The sums over the many frames are
+		// accumulated in double, so it matches the double-precision fit
+		const std::vector<float> times_f(input.getTimes(),
+		                                 input.getTimes() + NumFrames);
+		const std::vector<float> values_f(input.getValues(),
+		                                  input.getValues() + NumFrames);
+		const InputFunction<float> input_f(times_f.data(), values_f.data(),
+		                                   NumFrames);
+		const std::vector<float> tac_all_f(tac_all.begin(), tac_all.end());
+		std::vector<float> kin_out_f(2 * NumPix);
+		solveLogan(tac_all_f.data(), kin_out_f.data(), input_f,
+		           static_cast<const float*>(nullptr), NumFrames / 2, NumPix,
+		           4);
+		for (size_t pi = 1; pi < NumPix; pi++)
+		{
+			CHECK(kin_out_f[pi] == Approx(kin_out[pi]).epsilon(1e-5));
+		}
+	}
+}
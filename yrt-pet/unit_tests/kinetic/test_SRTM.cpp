@@ -0,0 +1,266 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "catch.hpp"
+
+#include "kinetic/SRTM.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+	double getRandom(double low, double high)
+	{
+		return low + (high - low) * static_cast<double>(rand()) / RAND_MAX;
+	}
+
+	// In-place inverse of a small symmetric positive-definite matrix
+	void invert(std::vector<double>& m, int n)
+	{
+		std::vector<double> inv(n * n, 0.0);
+		for (int i = 0; i < n; i++)
+		{
+			inv[i * n + i] = 1.0;
+		}
+		for (int col = 0; col < n; col++)
+		{
+			const double pivot = m[col * n + col];
+			for (int j = 0; j < n; j++)
+			{
+				m[col * n + j] /= pivot;
+				inv[col * n + j] /= pivot;
+			}
+			for (int row = 0; row < n; row++)
+			{
+				if (row == col)
+				{
+					continue;
+				}
+				const double factor = m[row * n + col];
+				for (int j = 0; j < n; j++)
+				{
+					m[row * n + j] -= factor * m[col * n + j];
+					inv[row * n + j] -= factor * inv[col * n + j];
+				}
+			}
+		}
+		m = inv;
+	}
+
+	// Rinv_Qt = (A^T W A + alpha B^T Lambda B)^-1 for every basis
+	std::vector<double> getRinvQt(const std::vector<double>& A_all,
+	                              const std::vector<double>& B_all,
+	                              const std::vector<double>& W,
+	                              const std::vector<double>& Lambda,
+	                              double alpha, int numKappa, int numRows,
+	                              int numParams, int numKin)
+	{
+		std::vector<double> Rinv_Qt_all;
+		for (int ki = 0; ki < numKappa; ki++)
+		{
+			const double* A = &A_all[ki * numRows * numParams];
+			const double* B = &B_all[ki * numKin * numParams];
+			std::vector<double> m(numParams * numParams, 0.0);
+			for (int i = 0; i < numParams; i++)
+			{
+				for (int j = 0; j < numParams; j++)
+				{
+					for (int t = 0; t < numRows; t++)
+					{
+						m[i * numParams + j] +=
+						    A[t * numParams + i] * W[t] * A[t * numParams + j];
+					}
+					for (int k = 0; k < numKin; k++)
+					{
+						m[i * numParams + j] += alpha * B[k * numParams + i] *
+						                        Lambda[k] *
+						                        B[k * numParams + j];
+					}
+				}
+			}
+			invert(m, numParams);
+			Rinv_Qt_all.insert(Rinv_Qt_all.end(), m.begin(), m.end());
+		}
+		return Rinv_Qt_all;
+	}
+}  // namespace
+
+TEST_CASE("srtm-basis", "[kinetic]")
+{
+	srand(7);
+	// Not a multiple of the number of pixels processed together
+	constexpr size_t NumPix = 1000;
+	constexpr int NumFrames = 20;
+	constexpr int NumKappa = 8;
+
+	std::vector<double> W(2 * NumFrames);
+	std::vector<double> refTAC(2 * NumFrames);
+	for (int ti = 0; ti < 2 * NumFrames; ti++)
+	{
+		W[ti] = getRandom(0.5, 2.0);
+		refTAC[ti] = getRandom(1.0, 10.0);
+	}
+	std::vector<double> kappa_list(2 * NumKappa);
+	std::vector<double> basis(2 * NumKappa * NumFrames);
+	for (int ki = 0; ki < 2 * NumKappa; ki++)
+	{
+		kappa_list[ki] = 0.01 * (ki % NumKappa + 1);
+		for (int ti = 0; ti < NumFrames; ti++)
+		{
+			basis[ki * NumFrames + ti] = getRandom(0.0, 5.0);
+		}
+	}
+	// True basis and parameters of every pixel
+	std::vector<int> trueKappa(NumPix);
+	for (size_t pi = 0; pi < NumPix; pi++)
+	{
+		trueKappa[pi] = rand() % NumKappa;
+	}
+
+	SECTION("srtm-basis-single")
+	{
+		constexpr int NumKin = 3;
+		// A = [reference TAC, basis], B maps theta to (BP + 1, k2, R1)
+		std::vector<double> A_all(NumKappa * NumFrames * 2);
+		std::vector<double> B_all(NumKappa * NumKin * 2);
+		for (int ki = 0; ki < NumKappa; ki++)
+		{
+			for (int ti = 0; ti < NumFrames; ti++)
+			{
+				A_all[(ki * NumFrames + ti) * 2] = refTAC[ti];
+				A_all[(ki * NumFrames + ti) * 2 + 1] =
+				    basis[ki * NumFrames + ti];
+			}
+			const double kappa = kappa_list[ki];
+			const double B[NumKin * 2] = {1.0, 1.0 / kappa, kappa, 1.0, 1.0,
+			                              0.0};
+			std::copy(B, B + NumKin * 2, &B_all[ki * NumKin * 2]);
+		}
+
+		std::vector<double> tac_all(NumFrames * NumPix);
+		std::vector<double> kin_true(NumKin * NumPix);
+		for (size_t pi = 0; pi < NumPix; pi++)
+		{
+			const int ki = trueKappa[pi];
+			const double theta_0 = getRandom(0.5, 1.5);
+			const double theta_1 = getRandom(0.01, 0.1);
+			for (int ti = 0; ti < NumFrames; ti++)
+			{
+				tac_all[ti * NumPix + pi] =
+				    A_all[(ki * NumFrames + ti) * 2] * theta_0 +
+				    A_all[(ki * NumFrames + ti) * 2 + 1] * theta_1;
+			}
+			const double kappa = kappa_list[ki];
+			kin_true[0 * NumPix + pi] = (theta_0 * kappa + theta_1) / kappa - 1;
+			kin_true[1 * NumPix + pi] = theta_0 * kappa + theta_1;
+			kin_true[2 * NumPix + pi] = theta_0;
+		}
+
+		const std::vector<double> Lambda{1.0, 2.0, 0.5};
+		for (const double alpha : {0.0, 0.3})
+		{
+			// Noise-free curves and a prior equal to the true parameters: the
+			// true basis fits exactly
+			const std::vector<double> Rinv_Qt_all =
+			    getRinvQt(A_all, B_all, W, Lambda, alpha, NumKappa, NumFrames,
+			              2, NumKin);
+			std::vector<double> kin_out(NumKin * NumPix);
+			solveSRTMBasis(tac_all.data(), kin_out.data(), kin_true.data(),
+			               A_all.data(), B_all.data(), Rinv_Qt_all.data(),
+			               W.data(), Lambda.data(), alpha, kappa_list.data(),
+			               NumKappa, NumPix, NumFrames, 4);
+			for (size_t i = 0; i < NumKin * NumPix; i++)
+			{
+				CHECK(kin_out[i] == Approx(kin_true[i]).margin(1e-6));
+			}
+		}
+	}
+
+	SECTION("srtm-basis-joint")
+	{
+		constexpr int NumKin = 6;
+		// Two independent fits, of theta 0-1 on the first curve and of theta
+		// 2-3 on the second one
+		std::vector<double> A_all(NumKappa * 2 * NumFrames * 4, 0.0);
+		std::vector<double> B_all(NumKappa * NumKin * 4, 0.0);
+		for (int ki = 0; ki < NumKappa; ki++)
+		{
+			double* A0 = &A_all[ki * 2 * NumFrames * 4];
+			double* A1 = A0 + NumFrames * 4;
+			for (int ti = 0; ti < NumFrames; ti++)
+			{
+				A0[ti * 4] = refTAC[ti];
+				A0[ti * 4 + 1] = basis[ki * NumFrames + ti];
+				A1[ti * 4 + 2] = refTAC[NumFrames + ti];
+				A1[ti * 4 + 3] = basis[(NumKappa + ki) * NumFrames + ti];
+			}
+			double* B = &B_all[ki * NumKin * 4];
+			B[0 * 4 + 0] = 1.0 / kappa_list[ki];
+			B[1 * 4 + 0] = 1.0;
+			B[2 * 4 + 1] = 1.0;
+			B[3 * 4 + 2] = 1.0 / kappa_list[NumKappa + ki];
+			B[4 * 4 + 2] = 1.0;
+			B[5 * 4 + 3] = 1.0;
+		}
+
+		std::vector<double> tac_all(2 * NumFrames * NumPix);
+		std::vector<double> kin_true(NumKin * NumPix);
+		for (size_t pi = 0; pi < NumPix; pi++)
+		{
+			const int ki = trueKappa[pi];
+			const double* A0 = &A_all[ki * 2 * NumFrames * 4];
+			const double* A1 = A0 + NumFrames * 4;
+			const double theta[4] = {getRandom(0.01, 0.1), getRandom(0.5, 1.5),
+			                         getRandom(0.01, 0.1), getRandom(0.5, 1.5)};
+			for (int ti = 0; ti < NumFrames; ti++)
+			{
+				tac_all[ti * NumPix + pi] =
+				    A0[ti * 4] * theta[0] + A0[ti * 4 + 1] * theta[1];
+				tac_all[(NumFrames + ti) * NumPix + pi] =
+				    A1[ti * 4 + 2] * theta[2] + A1[ti * 4 + 3] * theta[3];
+			}
+			const double bp_b = theta[0] / kappa_list[ki] - 1;
+			const double bp_d = theta[2] / kappa_list[NumKappa + ki] - 1;
+			kin_true[0 * NumPix + pi] = bp_b;
+			kin_true[1 * NumPix + pi] = theta[0];
+			kin_true[2 * NumPix + pi] = theta[1];
+			kin_true[3 * NumPix + pi] = bp_d;
+			kin_true[4 * NumPix + pi] = theta[2];
+			kin_true[5 * NumPix + pi] = theta[3];
+		}
+
+		const std::vector<double> Lambda{1.0, 2.0, 0.5, 1.0, 2.0, 0.5};
+		for (const double alpha : {0.0, 0.3})
+		{
+			const std::vector<double> Rinv_Qt_all =
+			    getRinvQt(A_all, B_all, W, Lambda, alpha, NumKappa,
+			              2 * NumFrames, 4, NumKin);
+			std::vector<double> kin_out(NumKin * NumPix);
+			solveSRTMBasisJoint(tac_all.data(), kin_out.data(),
+			                    kin_true.data(), A_all.data(), B_all.data(),
+			                    Rinv_Qt_all.data(), W.data(), Lambda.data(),
+			                    alpha, kappa_list.data(), NumKappa, NumPix,
+			                    NumFrames, 4);
+			for (size_t pi = 0; pi < NumPix; pi++)
+			{
+				const double bp_b = kin_true[0 * NumPix + pi];
+				const double bp_d = kin_true[3 * NumPix + pi];
+				CHECK(kin_out[0 * NumPix + pi] == Approx(bp_b).margin(1e-6));
+				CHECK(kin_out[1 * NumPix + pi] ==
+				      Approx(kin_true[1 * NumPix + pi]).margin(1e-6));
+				CHECK(kin_out[2 * NumPix + pi] ==
+				      Approx(kin_true[2 * NumPix + pi]).margin(1e-6));
+				CHECK(kin_out[3 * NumPix + pi] ==
+				      Approx(1 - bp_d / bp_b).epsilon(1e-6));
+				CHECK(kin_out[4 * NumPix + pi] ==
+				      Approx(kin_true[4 * NumPix + pi]).margin(1e-6));
+				CHECK(kin_out[5 * NumPix + pi] ==
+				      Approx(kin_true[5 * NumPix + pi]).margin(1e-6));
+			}
+		}
+	}
+}
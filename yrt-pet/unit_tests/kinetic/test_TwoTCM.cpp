@@ -0,0 +1,308 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "catch.hpp"
+
+#include "kinetic/TwoTCM.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+	double getRandom(double low, double high)
+	{
+		return low + (high - low) * static_cast<double>(rand()) / RAND_MAX;
+	}
+
+	struct MicroParameters
+	{
+		double K1;
+		double k2;
+		double k3;
+		double k4;
+	};
+}  // namespace
+
+TEST_CASE("input-function", "[kinetic]")
+{
+	const std::vector<double> times{0.5, 1.0, 2.0, 2.0, 4.0, 8.0, 15.0};
+	const std::vector<double> values{3.0, 10.0, 6.0, 6.0, 4.0, 2.5, 1.0};
+	const int numFrames = static_cast<int>(times.size());
+	const InputFunction<double> input(times.data(), values.data(), numFrames);
+
+	// Piecewise-linear input function, from zero at time zero
+	auto inputAt = [&](double t)
+	{
+		double t0 = 0.0;
+		double v0 = 0.0;
+		for (int ti = 0; ti < numFrames; ti++)
+		{
+			if (t <= times[ti] && times[ti] > t0)
+			{
+				return v0 + (values[ti] - v0) * (t - t0) / (times[ti] - t0);
+			}
+			t0 = times[ti];
+			v0 = values[ti];
+		}
+		return v0;
+	};
+
+	std::vector<double> conv(numFrames);
+	for (const double theta : {0.0, 1e-5, 0.1, 2.0})
+	{
+		input.convolveExponential(theta, conv.data());
+		for (int ti = 0; ti < numFrames; ti++)
+		{
+			// Midpoint rule on a fine grid
+			constexpr int NumSteps = 100000;
+			const double dt = times[ti] / NumSteps;
+			double expected = 0.0;
+			for (int si = 0; si < NumSteps; si++)
+			{
+				const double u = (si + 0.5) * dt;
+				expected +=
+				    inputAt(u) * std::exp(-theta * (times[ti] - u)) * dt;
+			}
+			CHECK(conv[ti] == Approx(expected).epsilon(1e-6));
+			if (theta == 0.0)
+			{
+				const double integral = input.getCumulativeIntegrals()[ti];
+				CHECK(conv[ti] == Approx(integral).epsilon(1e-12));
+			}
+		}
+	}
+}
+
+TEST_CASE("2tcm-basis", "[kinetic]")
+{
+	srand(17);
+	// Not a multiple of the number of pixels processed together
+	constexpr size_t NumPix = 200;
+	constexpr int NumFrames = 40;
+
+	std::vector<double> times(NumFrames);
+	std::vector<double> values(NumFrames);
+	for (int ti = 0; ti < NumFrames; ti++)
+	{
+		times[ti] = 0.25 * (ti + 1) * (ti + 1);
+		values[ti] = 40.0 * times[ti] * std::exp(-1.5 * times[ti]) +
+		             3.0 * std::exp(-0.02 * times[ti]);
+	}
+	const InputFunction<double> input(times.data(), values.data(), NumFrames);
+
+	// A few sets of micro-parameters, including an irreversible one, whose
+	// decay rates are added to a logarithmic grid
+	const std::vector<MicroParameters> trueParams{{0.3, 0.2, 0.05, 0.02},
+	                                              {0.6, 0.4, 0.1, 0.0},
+	                                              {0.1, 0.05, 0.02, 0.01},
+	                                              {0.5, 0.8, 0.3, 0.1}};
+	std::vector<double> theta_list;
+	for (int i = 0; i < 12; i++)
+	{
+		theta_list.push_back(0.005 * std::pow(1.6, i));
+	}
+	std::vector<double> alpha_0;
+	std::vector<double> alpha_1;
+	for (const MicroParameters& mp : trueParams)
+	{
+		const double sum = mp.k2 + mp.k3 + mp.k4;
+		const double delta = std::sqrt(sum * sum - 4.0 * mp.k2 * mp.k4);
+		alpha_0.push_back((sum - delta) / 2.0);
+		alpha_1.push_back((sum + delta) / 2.0);
+		theta_list.push_back(alpha_0.back());
+		theta_list.push_back(alpha_1.back());
+	}
+
+	std::vector<int> trueSet(NumPix);
+	std::vector<double> trueVB(NumPix);
+	std::vector<double> conv_0(NumFrames);
+	std::vector<double> conv_1(NumFrames);
+	std::vector<double> tac_tissue(NumFrames * NumPix);
+	for (size_t pi = 0; pi < NumPix; pi++)
+	{
+		const int si = rand() % trueParams.size();
+		const MicroParameters& mp = trueParams[si];
+		trueSet[pi] = si;
+		trueVB[pi] = getRandom(0.01, 0.1);
+		const double a0 = alpha_0[si];
+		const double a1 = alpha_1[si];
+		input.convolveExponential(a0, conv_0.data());
+		input.convolveExponential(a1, conv_1.data());
+		const double c0 = mp.K1 * (mp.k3 + mp.k4 - a0) / (a1 - a0);
+		const double c1 = mp.K1 * (a1 - mp.k3 - mp.k4) / (a1 - a0);
+		for (int ti = 0; ti < NumFrames; ti++)
+		{
+			tac_tissue[ti * NumPix + pi] = c0 * conv_0[ti] + c1 * conv_1[ti];
+		}
+	}
+
+	auto checkFit = [&](const std::vector<double>& kin_out, bool withVB)
+	{
+		for (size_t pi = 0; pi < NumPix; pi++)
+		{
+			const MicroParameters& mp = trueParams[trueSet[pi]];
+			CHECK(kin_out[0 * NumPix + pi] == Approx(mp.K1).margin(1e-6));
+			CHECK(kin_out[1 * NumPix + pi] == Approx(mp.k2).margin(1e-6));
+			CHECK(kin_out[2 * NumPix + pi] == Approx(mp.k3).margin(1e-6));
+			CHECK(kin_out[3 * NumPix + pi] == Approx(mp.k4).margin(1e-6));
+			CHECK(kin_out[4 * NumPix + pi] ==
+			      Approx(withVB ? trueVB[pi] : 0.0).margin(1e-6));
+		}
+	};
+
+	SECTION("2tcm-basis-tissue")
+	{
+		std::vector<double> kin_out(5 * NumPix);
+		solve2TCMBasis(tac_tissue.data(), kin_out.data(), input,
+		               theta_list.data(), static_cast<int>(theta_list.size()),
+		               static_cast<const double*>(nullptr), false, NumPix, 4);
+		checkFit(kin_out, false);
+	}
+
+	SECTION("2tcm-basis-blood-volume")
+	{
+		std::vector<double> tac_all(NumFrames * NumPix);
+		std::vector<double> W(NumFrames);
+		for (int ti = 0; ti < NumFrames; ti++)
+		{
+			W[ti] = getRandom(0.5, 2.0);
+			for (size_t pi = 0; pi < NumPix; pi++)
+			{
+				tac_all[ti * NumPix + pi] =
+				    (1.0 - trueVB[pi]) * tac_tissue[ti * NumPix + pi] +
+				    trueVB[pi] * values[ti];
+			}
+		}
+		std::vector<double> kin_out(5 * NumPix);
+		solve2TCMBasis(tac_all.data(), kin_out.data(), input,
+		               theta_list.data(), static_cast<int>(theta_list.size()),
+		               W.data(), true, NumPix, 4);
+		checkFit(kin_out, true);
+	}
+
+	SECTION("2tcm-basis-k3-zero")
+	{
+		// One-tissue TACs: one of the coefficients of the basis is zero
+		std::vector<double> tac_1tcm(NumFrames * NumPix);
+		std::vector<double> K1(NumPix);
+		std::vector<double> k2(NumPix);
+		for (size_t pi = 0; pi < NumPix; pi++)
+		{
+			K1[pi] = getRandom(0.1, 0.6);
+			k2[pi] = theta_list[3 + rand() % 6];
+			input.convolveExponential(k2[pi], conv_0.data());
+			for (int ti = 0; ti < NumFrames; ti++)
+			{
+				tac_1tcm[ti * NumPix + pi] = K1[pi] * conv_0[ti];
+			}
+		}
+		std::vector<double> kin_out(5 * NumPix);
+		solve2TCMBasis(tac_1tcm.data(), kin_out.data(), input,
+		               theta_list.data(), static_cast<int>(theta_list.size()),
+		               static_cast<const double*>(nullptr), true, NumPix, 4);
+		for (size_t pi = 0; pi < NumPix; pi++)
+		{
+			CHECK(kin_out[0 * NumPix + pi] == Approx(K1[pi]).margin(1e-6));
+			CHECK(kin_out[1 * NumPix + pi] == Approx(k2[pi]).margin(1e-6));
+			CHECK(kin_out[2 * NumPix + pi] == Approx(0.0).margin(1e-6));
+			CHECK(kin_out[4 * NumPix + pi] == Approx(0.0).margin(1e-6));
+		}
+	}
+
+	SECTION("2tcm-basis-noisy")
+	{
+		// Noisy two-tissue and one-tissue TACs, for which the least squares
+		// coefficients of the true basis are often negative. The true
+		// parameters are a feasible fit, so the non-negative fit must be at
+		// least as good
+		std::vector<double> tac_all(NumFrames * NumPix);
+		std::vector<double> tac_true(NumFrames * NumPix);
+		std::vector<double> W(NumFrames);
+		for (int ti = 0; ti < NumFrames; ti++)
+		{
+			W[ti] = getRandom(0.5, 2.0);
+		}
+		for (size_t pi = 0; pi < NumPix; pi++)
+		{
+			const bool oneTissue = pi % 2 == 1;
+			if (oneTissue)
+			{
+				const double k2 = theta_list[3 + rand() % 6];
+				input.convolveExponential(k2, conv_0.data());
+			}
+			double peak = 0.0;
+			for (int ti = 0; ti < NumFrames; ti++)
+			{
+				const double tissue = oneTissue ?
+				                          0.3 * conv_0[ti] :
+				                          tac_tissue[ti * NumPix + pi];
+				tac_true[ti * NumPix + pi] = (1.0 - trueVB[pi]) * tissue +
+				                             trueVB[pi] * values[ti];
+				peak = std::max(peak, tac_true[ti * NumPix + pi]);
+			}
+			for (int ti = 0; ti < NumFrames; ti++)
+			{
+				tac_all[ti * NumPix + pi] = tac_true[ti * NumPix + pi] +
+				                            0.05 * peak * getRandom(-1.0, 1.0);
+			}
+		}
+		// Pixel without any uptake, fitted by zeros
+		for (int ti = 0; ti < NumFrames; ti++)
+		{
+			tac_true[ti * NumPix] = 0.0;
+			tac_all[ti * NumPix] = -getRandom(0.0, 1.0);
+		}
+
+		std::vector<double> kin_out(5 * NumPix);
+		solve2TCMBasis(tac_all.data(), kin_out.data(), input,
+		               theta_list.data(), static_cast<int>(theta_list.size()),
+		               W.data(), true, NumPix, 4);
+
+		for (int k = 0; k < 5; k++)
+		{
+			CHECK(kin_out[k * NumPix] == 0.0);
+		}
+		for (size_t pi = 1; pi < NumPix; pi++)
+		{
+			const double K1 = kin_out[0 * NumPix + pi];
+			const double k2 = kin_out[1 * NumPix + pi];
+			const double k3 = kin_out[2 * NumPix + pi];
+			const double k4 = kin_out[3 * NumPix + pi];
+			const double vB = kin_out[4 * NumPix + pi];
+			REQUIRE(K1 > 0.0);
+			REQUIRE(k2 >= 0.0);
+			REQUIRE(k3 >= -1e-12);
+			REQUIRE(k4 >= 0.0);
+			REQUIRE((vB >= 0.0 && vB < 1.0));
+
+			// TAC of the fitted parameters
+			const double sum = k2 + k3 + k4;
+			const double delta =
+			    std::sqrt(std::max(sum * sum - 4.0 * k2 * k4, 0.0));
+			const double a0 = (sum - delta) / 2.0;
+			const double a1 = (sum + delta) / 2.0;
+			const double c0 = K1 * (k3 + k4 - a0) / (a1 - a0);
+			const double c1 = K1 * (a1 - k3 - k4) / (a1 - a0);
+			input.convolveExponential(a0, conv_0.data());
+			input.convolveExponential(a1, conv_1.data());
+			double cost = 0.0;
+			double costTrue = 0.0;
+			for (int ti = 0; ti < NumFrames; ti++)
+			{
+				const double tac = tac_all[ti * NumPix + pi];
+				const double fit =
+				    (1.0 - vB) * (c0 * conv_0[ti] + c1 * conv_1[ti]) +
+				    vB * values[ti];
+				cost += W[ti] * (tac - fit) * (tac - fit);
+				const double res = tac - tac_true[ti * NumPix + pi];
+				costTrue += W[ti] * res * res;
+			}
+			CHECK(cost <= costTrue * (1.0 + 1e-6));
+		}
+	}
+}
@@ -4,9 +4,13 @@
  */
 
 #include "datastruct/image/Image.hpp"
+#include "motion/ImageWarperFunction.hpp"
 #include "motion/ImageWarperMatrix.hpp"
+#include "utils/Tools.hpp"
+#include "utils/Types.hpp"
 
 #include "catch.hpp"
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
@@ -241,3 +245,197 @@ TEST_CASE("Warper-basic_iso_unWeighted", "[warper]")
 	// 	}
 	// }
 }
+
+TEST_CASE("Warper-transpose", "[warper]")
+{
+	// Anisotropic image with an arbitrary rotation and translation.
+	std::vector<int> imDim{16, 14, 12};
+	std::vector<float> imSize{32.0f, 21.0f, 30.0f};
+	ImageParams img_params(imDim[0], imDim[1], imDim[2], imSize[0], imSize[1],
+	                       imSize[2], 0.0, 0.0, 0.0);
+
+	ImageWarperMatrix warper;
+	warper.setImageHyperParam(imDim, imSize);
+	warper.setMotionHyperParam(2);
+	warper.initParamContainer();
+	warper.setReferenceFrameParam(0, 0.0f, 0.5f);
+	std::vector<double> warpParam{0.9, 0.2, -0.3, 0.25, 1.3, -0.7, 2.1};
+	warper.setFrameParam(1, warpParam, 0.5f, 0.5f);
+
+	auto image = std::make_unique<ImageOwned>(img_params);
+	image->allocate();
+	float* imagePtr = image->getRawPointer();
+	const int numVoxels = imDim[0] * imDim[1] * imDim[2];
+	for (int n = 0; n < numVoxels; n++)
+	{
+		imagePtr[n] = static_cast<float>((n * 7919) % 101) / 101.0f;
+	}
+
+	// Reference: scatter every voxel onto its eight interpolation neighbours
+	// at its warped position
+	const transform_t t = warper.getTransformation(1);
+	std::vector<double> expected(numVoxels, 0.0);
+	for (int k = 0; k < imDim[2]; k++)
+	{
+		for (int j = 0; j < imDim[1]; j++)
+		{
+			for (int i = 0; i < imDim[0]; i++)
+			{
+				const int id[3] = {i, j, k};
+				double pos[3];
+				for (int a = 0; a < 3; a++)
+				{
+					pos[a] = (id[a] + 0.5) * imSize[a] / imDim[a] -
+					         0.5 * imSize[a];
+				}
+				const double pt[3] = {
+				    t.r00 * pos[0] + t.r01 * pos[1] + t.r02 * pos[2] + t.tx,
+				    t.r10 * pos[0] + t.r11 * pos[1] + t.r12 * pos[2] + t.ty,
+				    t.r20 * pos[0] + t.r21 * pos[1] + t.r22 * pos[2] + t.tz};
+				int low[3], high[3];
+				double frac[3];
+				bool inside = true;
+				for (int a = 0; a < 3; a++)
+				{
+					inside &= std::abs(pt[a]) < imSize[a] / 2;
+					const double u =
+					    (pt[a] + imSize[a] / 2) / imSize[a] * imDim[a] - 0.5;
+					const int u0 = static_cast<int>(std::floor(u));
+					frac[a] = u - u0;
+					low[a] = std::max(u0, 0);
+					high[a] = std::min(u0 + 1, imDim[a] - 1);
+				}
+				if (!inside)
+				{
+					continue;
+				}
+				const float value = imagePtr[IDX3(i, j, k, imDim[0], imDim[1])];
+				for (int c = 0; c < 8; c++)
+				{
+					double weight = 1.0;
+					int corner[3];
+					for (int a = 0; a < 3; a++)
+					{
+						const bool isHigh = (c >> a) & 1;
+						corner[a] = isHigh ? high[a] : low[a];
+						weight *= isHigh ? frac[a] : 1.0 - frac[a];
+					}
+					expected[IDX3(corner[0], corner[1], corner[2], imDim[0],
+					              imDim[1])] += weight * value;
+				}
+			}
+		}
+	}
+
+	warper.warpImageToRefFrame(image.get(), 1);
+
+	double maxDiff = 0.0;
+	double sumExpected = 0.0;
+	for (int n = 0; n < numVoxels; n++)
+	{
+		maxDiff = std::max(maxDiff, std::abs(imagePtr[n] - expected[n]));
+		sumExpected += expected[n];
+	}
+	CHECK(sumExpected > 0.0);
+	CHECK(maxDiff < 1e-4);
+}
+
+TEST_CASE("Warper-function", "[warper]")
+{
+	// Half-turn around z with a translation, whose rotation matrix does not
+	// depend on the quaternion conventions: diag(-1, -1, 1)
+	std::vector<int> imDim{16, 14, 12};
+	std::vector<float> imSize{32.0f, 21.0f, 30.0f};
+	ImageParams img_params(imDim[0], imDim[1], imDim[2], imSize[0], imSize[1],
+	                       imSize[2], 0.0, 0.0, 0.0);
+	const float trans[3] = {1.3f, -0.7f, 2.1f};
+
+	ImageWarperFunction warper;
+	warper.setImageHyperParam(imDim, imSize);
+	warper.setMotionHyperParam(2);
+	warper.initParamContainer();
+	warper.setReferenceFrameParam(0, 0.0f, 0.5f);
+	std::vector<double> warpParam{0.0, 0.0, 0.0, 1.0,
+	                              trans[0], trans[1], trans[2]};
+	warper.setFrameParam(1, warpParam, 0.5f, 0.5f);
+
+	auto refImage = std::make_unique<ImageOwned>(img_params);
+	refImage->allocate();
+	float* refPtr = refImage->getRawPointer();
+	const int numVoxels = imDim[0] * imDim[1] * imDim[2];
+	for (int n = 0; n < numVoxels; n++)
+	{
+		refPtr[n] = static_cast<float>((n * 7919) % 101) / 101.0f;
+	}
+	warper.setRefImage(refImage.get());
+
+	auto warpedImage = std::make_unique<ImageOwned>(img_params);
+	warpedImage->allocate();
+	warper.warpRefImage(warpedImage.get(), 1);
+	auto invWarpedImage = std::make_unique<ImageOwned>(img_params);
+	invWarpedImage->allocate();
+	invWarpedImage->copyFromImage(refImage.get());
+	warper.warpImageToRefFrame(invWarpedImage.get(), 1);
+
+	// Reference: interpolate every voxel at its moved position, with
+	// warp(p) = ref(R p - t) and inverse warp(p) = ref(R (p + t)). The
+	// positions less than a voxel away from the border are left out, since
+	// interpolateImage also samples up to a voxel outside the image
+	const auto isInside = [&imDim, &imSize](const Vector3D& pt)
+	{
+		const double pos[3] = {pt.x, pt.y, pt.z};
+		for (int a = 0; a < 3; a++)
+		{
+			if (std::abs(pos[a]) > 0.5 * imSize[a] - imSize[a] / imDim[a])
+			{
+				return false;
+			}
+		}
+		return true;
+	};
+	double maxDiffWarp = 0.0;
+	double maxDiffInvWarp = 0.0;
+	double sumWarp = 0.0;
+	for (int k = 0; k < imDim[2]; k++)
+	{
+		for (int j = 0; j < imDim[1]; j++)
+		{
+			for (int i = 0; i < imDim[0]; i++)
+			{
+				const int id[3] = {i, j, k};
+				float pos[3];
+				for (int a = 0; a < 3; a++)
+				{
+					pos[a] = (id[a] + 0.5f) * imSize[a] / imDim[a] -
+					         0.5f * imSize[a];
+				}
+				const Vector3D ptWarp{-pos[0] - trans[0], -pos[1] - trans[1],
+				                      pos[2] - trans[2]};
+				const Vector3D ptInvWarp{-(pos[0] + trans[0]),
+				                         -(pos[1] + trans[1]),
+				                         pos[2] + trans[2]};
+				const int n = IDX3(i, j, k, imDim[0], imDim[1]);
+				if (isInside(ptWarp))
+				{
+					const double expected = refImage->interpolateImage(ptWarp);
+					maxDiffWarp = std::max(
+					    maxDiffWarp,
+					    std::abs(warpedImage->getRawPointer()[n] - expected));
+					sumWarp += expected;
+				}
+				if (isInside(ptInvWarp))
+				{
+					const double expected =
+					    refImage->interpolateImage(ptInvWarp);
+					maxDiffInvWarp = std::max(
+					    maxDiffInvWarp,
+					    std::abs(invWarpedImage->getRawPointer()[n] -
+					             expected));
+				}
+			}
+		}
+	}
+	CHECK(sumWarp > 0.0);
+	CHECK(maxDiffWarp < 1e-4);
+	CHECK(maxDiffInvWarp < 1e-4);
+}
@@ -231,3 +231,83 @@ TEST_CASE("array1d-stl-type", "[array]")
 		REQUIRE(arr[1].second != arr2[1].second);
 	}
 }
+
+TEST_CASE("array3d-chunked", "[array]")
+{
+	Array3D<float> arr;
+	arr.allocate(7, 5, 11);
+	for (size_t i = 0; i < arr.getSizeTotal(); i++)
+	{
+		// Mostly constant data so that the compression has an effect
+		arr.setFlat(i, i % 13 == 0 ? static_cast<float>(i) : 1.0f);
+	}
+
+	const auto checkSlabs =
+	    [&arr](const Array3D<float>& arr2, size_t firstSlab, size_t numSlabs)
+	{
+		REQUIRE(arr2.getSize(0) == numSlabs);
+		REQUIRE(arr2.getSize(1) == 5);
+		REQUIRE(arr2.getSize(2) == 11);
+		const size_t offset = firstSlab * 5 * 11;
+		for (size_t i = 0; i < arr2.getSizeTotal(); i++)
+		{
+			REQUIRE(arr2.getFlat(i) == arr.getFlat(offset + i));
+		}
+	};
+
+	SECTION("array3d-chunked-zlib")
+	{
+		arr.writeToFileChunked("array3d_chunked", Util::ChunkCompression::ZLIB,
+		                       2);
+		REQUIRE(Util::isChunkedFile("array3d_chunked"));
+		const Util::ChunkedFileHeader header =
+		    Util::readChunkedFileHeader("array3d_chunked");
+		REQUIRE(header.getNumChunks() == 4);
+		REQUIRE(header.elementSize == sizeof(float));
+
+		Array3D<float> arr2;
+		arr2.readFromFile("array3d_chunked", {7, 5, 11});
+		checkSlabs(arr2, 0, 7);
+
+		// Partial reads, within a chunk and across chunks
+		Array3D<float> arr3;
+		arr3.readSlabsFromFile("array3d_chunked", 3, 1);
+		checkSlabs(arr3, 3, 1);
+		arr3.readSlabsFromFile("array3d_chunked", 1, 5);
+		checkSlabs(arr3, 1, 5);
+		REQUIRE_THROWS(arr3.readSlabsFromFile("array3d_chunked", 5, 3));
+
+		// Wrong element type
+		Array3D<double> arr4;
+		REQUIRE_THROWS(arr4.readFromFile("array3d_chunked"));
+		std::remove("array3d_chunked");
+	}
+
+	SECTION("array3d-chunked-uncompressed")
+	{
+		arr.writeToFileChunked("array3d_chunked",
+		                       Util::ChunkCompression::NONE);
+		Array3D<float> arr2;
+		arr2.readFromFile("array3d_chunked");
+		checkSlabs(arr2, 0, 7);
+
+		{
+			const Util::ChunkedFileMapping mapping("array3d_chunked");
+			const auto* data = static_cast<const float*>(mapping.getData());
+			for (size_t i = 0; i < arr.getSizeTotal(); i++)
+			{
+				REQUIRE(data[i] == arr.getFlat(i));
+			}
+		}
+		std::remove("array3d_chunked");
+	}
+
+	SECTION("array3d-slabs-flat")
+	{
+		arr.writeToFile("array3d_flat");
+		Array3D<float> arr2;
+		arr2.readSlabsFromFile("array3d_flat", 2, 4);
+		checkSlabs(arr2, 2, 4);
+		std::remove("array3d_flat");
+	}
+}
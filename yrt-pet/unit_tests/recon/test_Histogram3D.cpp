@@ -6,10 +6,15 @@
 #include "catch.hpp"
 
 #include "datastruct/projection/Histogram3D.hpp"
+#include "datastruct/projection/Histogram3DHalf.hpp"
+#include "datastruct/projection/Histogram3DSparseDefault.hpp"
 #include "datastruct/projection/ListModeLUT.hpp"
 #include "test_utils.hpp"
+#include "utils/HalfPrecision.hpp"
 #include "utils/ReconstructionUtils.hpp"
 
+#include <cstdio>
+
 
 bool check_coords(std::array<coord_t, 3> c1, std::array<coord_t, 3> c2)
 {
@@ -291,3 +296,214 @@ TEST_CASE("histo3d", "[histo]")
 		CHECK(d2_ref == detPair.d2);
 	}
 }
+
+TEST_CASE("histo3d-half", "[histo]")
+{
+	auto scanner = TestUtils::makeScanner();
+
+	auto histo3d = std::make_unique<Histogram3DOwned>(*scanner);
+	histo3d->allocate();
+	for (bin_t binId = 0; binId < histo3d->count(); binId++)
+	{
+		histo3d->setProjectionValue(binId, 0.5f + (binId % 1000) * 0.37f);
+	}
+
+	SECTION("half-conversions")
+	{
+		CHECK(Util::halfToFloat(Util::floatToHalf(1.0f)) == 1.0f);
+		CHECK(Util::halfToFloat(Util::floatToHalf(-2.5f)) == -2.5f);
+		CHECK(Util::halfToFloat(Util::floatToHalf(0.0f)) == 0.0f);
+		CHECK(Util::halfToFloat(Util::floatToHalf(65504.0f)) == 65504.0f);
+		CHECK(std::isinf(Util::halfToFloat(Util::floatToHalf(1e6f))));
+		// Smallest subnormal
+		CHECK(Util::halfToFloat(Util::floatToHalf(5.9604645e-8f)) ==
+		      5.9604645e-8f);
+		CHECK(Util::bfloat16ToFloat(Util::floatToBFloat16(1.0f)) == 1.0f);
+		CHECK(Util::bfloat16ToFloat(Util::floatToBFloat16(1e30f)) ==
+		      Approx(1e30f).epsilon(1e-2));
+	}
+
+	SECTION("half-values")
+	{
+		for (auto encoding :
+		     {Histogram3DHalf::Encoding::FP16, Histogram3DHalf::Encoding::BF16})
+		{
+			const float tolerance =
+			    encoding == Histogram3DHalf::Encoding::FP16 ? 1e-3f : 1e-2f;
+			auto histoHalf =
+			    std::make_unique<Histogram3DHalf>(*histo3d, encoding);
+			REQUIRE(histoHalf->count() == histo3d->count());
+			for (bin_t binId = 0; binId < histo3d->count(); binId++)
+			{
+				REQUIRE(histoHalf->getProjectionValue(binId) ==
+				        Approx(histo3d->getProjectionValue(binId))
+				            .epsilon(tolerance));
+			}
+			histoHalf->clearProjections(2.0f);
+			histoHalf->incrementProjection(10, 1.0f);
+			CHECK(histoHalf->getProjectionValue(10) == 3.0f);
+			CHECK(histoHalf->getProjectionValue(11) == 2.0f);
+		}
+	}
+
+	SECTION("half-no-float-array")
+	{
+		auto histoHalf = std::make_unique<Histogram3DHalf>(*histo3d);
+		CHECK_FALSE(histoHalf->isMemoryValid());
+		CHECK_THROWS(histoHalf->getData());
+		const Histogram3D* histoBase = histoHalf.get();
+		CHECK_THROWS(histoBase->getData());
+
+		// Consumers of Histogram3D read the bins through getProjectionValue
+		histoHalf->clearProjections(0.0f);
+		histoHalf->setProjectionValue(7, 3.0f);
+		histoHalf->setProjectionValue(1234, 2.0f);
+		auto lm = std::make_unique<ListModeLUTOwned>(*scanner);
+		Util::histogram3DToListModeLUT(histoBase, lm.get());
+		REQUIRE(lm->count() == 5);
+		const det_pair_t detPair = histoHalf->getDetectorPair(7);
+		CHECK(lm->getDetector1(0) == detPair.d1);
+		CHECK(lm->getDetector2(0) == detPair.d2);
+	}
+
+	SECTION("half-file")
+	{
+		const std::string fname = "histo3d_half.his";
+		histo3d->writeToFile(fname);
+		auto histoHalf = std::make_unique<Histogram3DHalf>(*scanner, fname);
+		histoHalf->writeToFile(fname);
+		auto histoRead = std::make_unique<Histogram3DOwned>(*scanner, fname);
+		std::remove(fname.c_str());
+		for (bin_t binId = 0; binId < histo3d->count(); binId++)
+		{
+			REQUIRE(histoRead->getProjectionValue(binId) ==
+			        histoHalf->getProjectionValue(binId));
+		}
+	}
+}
+
+TEST_CASE("histo3d-sparse-default", "[histo]")
+{
+	auto scanner = TestUtils::makeScanner();
+
+	auto histo3d = std::make_unique<Histogram3DOwned>(*scanner);
+	histo3d->allocate();
+	histo3d->clearProjections(1.0f);
+	// Only a few bins differ from the default value
+	for (bin_t binId = 0; binId < histo3d->count(); binId += 997)
+	{
+		histo3d->setProjectionValue(binId, 2.0f + binId);
+	}
+
+	SECTION("sparse-values")
+	{
+		auto histoSparse =
+		    std::make_unique<Histogram3DSparseDefault>(*histo3d, 1.0f);
+		CHECK(histoSparse->getNumAllocatedBlocks() <
+		      histoSparse->getNumBlocks());
+		for (bin_t binId = 0; binId < histo3d->count(); binId++)
+		{
+			REQUIRE(histoSparse->getProjectionValue(binId) ==
+			        histo3d->getProjectionValue(binId));
+		}
+
+		// Setting the bins back to the default releases the blocks
+		for (bin_t binId = 0; binId < histo3d->count(); binId += 997)
+		{
+			histoSparse->setProjectionValue(binId, 1.0f);
+		}
+		histoSparse->compact();
+		CHECK(histoSparse->getNumAllocatedBlocks() == 0);
+
+		histoSparse->incrementProjection(5, 3.0f);
+		CHECK(histoSparse->getProjectionValue(5) == 4.0f);
+		CHECK(histoSparse->getNumAllocatedBlocks() == 1);
+
+		histoSparse->clearProjections(0.0f);
+		CHECK(histoSparse->getProjectionValue(5) == 0.0f);
+		CHECK(histoSparse->getNumAllocatedBlocks() == 0);
+
+		CHECK_FALSE(histoSparse->isMemoryValid());
+		CHECK_THROWS(histoSparse->getData());
+	}
+
+	SECTION("sparse-file")
+	{
+		const std::string fname = "histo3d_sparse.his";
+		histo3d->writeToFile(fname);
+		auto histoSparse =
+		    std::make_unique<Histogram3DSparseDefault>(*scanner, fname, 1.0f);
+		std::remove(fname.c_str());
+		for (bin_t binId = 0; binId < histo3d->count(); binId++)
+		{
+			REQUIRE(histoSparse->getProjectionValue(binId) ==
+			        histo3d->getProjectionValue(binId));
+		}
+	}
+}
+
+TEST_CASE("histo3d-chunked", "[histo]")
+{
+	auto scanner = TestUtils::makeScanner();
+
+	auto histo3d = std::make_unique<Histogram3DOwned>(*scanner);
+	histo3d->allocate();
+	histo3d->clearProjections(1.0f);
+	for (bin_t binId = 0; binId < histo3d->count(); binId += 97)
+	{
+		histo3d->setProjectionValue(binId, 2.0f + binId);
+	}
+
+	const std::string fname = "histo3d_chunked.his";
+	histo3d->writeToFileChunked(fname);
+
+	SECTION("chunked-owned")
+	{
+		auto histo3d2 = std::make_unique<Histogram3DOwned>(*scanner, fname);
+		for (bin_t binId = 0; binId < histo3d->count(); binId++)
+		{
+			REQUIRE(histo3d2->getProjectionValue(binId) ==
+			        histo3d->getProjectionValue(binId));
+		}
+	}
+
+	SECTION("chunked-sparse")
+	{
+		auto histoSparse =
+		    std::make_unique<Histogram3DSparseDefault>(*scanner, fname, 1.0f);
+		for (bin_t binId = 0; binId < histo3d->count(); binId++)
+		{
+			REQUIRE(histoSparse->getProjectionValue(binId) ==
+			        histo3d->getProjectionValue(binId));
+		}
+	}
+
+	SECTION("chunked-mapped")
+	{
+		// Compressed files cannot be mapped
+		CHECK_THROWS(std::make_unique<Histogram3DMapped>(*scanner, fname));
+
+		const std::string fname_raw = "histo3d_chunked_raw.his";
+		histo3d->writeToFileChunked(fname_raw, Util::ChunkCompression::NONE);
+		std::unique_ptr<ProjectionData> projData = Histogram3DOwned::create(
+		    *scanner, fname_raw, {{"mmap", ""}});
+		auto* histoMapped = dynamic_cast<Histogram3DMapped*>(projData.get());
+		REQUIRE(histoMapped != nullptr);
+		REQUIRE(histoMapped->isMemoryValid());
+		for (bin_t binId = 0; binId < histo3d->count(); binId++)
+		{
+			REQUIRE(histoMapped->getProjectionValue(binId) ==
+			        histo3d->getProjectionValue(binId));
+		}
+
+		// Copy-on-write: the file is left unchanged
+		histoMapped->setProjectionValue(0, -1.0f);
+		CHECK(histoMapped->getProjectionValue(0) == -1.0f);
+		auto histoRead = std::make_unique<Histogram3DOwned>(*scanner, fname_raw);
+		CHECK(histoRead->getProjectionValue(0) ==
+		      histo3d->getProjectionValue(0));
+		projData.reset();
+		std::remove(fname_raw.c_str());
+	}
+	std::remove(fname.c_str());
+}
@@ -7,9 +7,13 @@
 #include "catch.hpp"
 
 #include "datastruct/image/Image.hpp"
+#include "datastruct/image/ImageResampler.hpp"
+#include "geometry/Constants.hpp"
+#include "utils/Tools.hpp"
 
 #include <ctime>
 #include <random>
+#include <vector>
 
 void checkTwoImages(const Image& img1, const Image& img2)
 {
@@ -92,3 +96,297 @@ TEST_CASE("image-readwrite", "[image]")
 	std::remove(tmpParams_fname.c_str());
 	std::remove(tmpCompressedImage_fname.c_str());
 }
+
+TEST_CASE("image-arithmetic", "[image]")
+{
+	std::default_random_engine engine(13);
+	std::uniform_real_distribution<float> imageDataDistribution(0.0f, 1.0f);
+
+	// Large enough to go through the parallel paths
+	const ImageParams params{64, 48, 40, 64.0f, 48.0f, 40.0f};
+	const size_t numVoxels =
+	    static_cast<size_t>(params.nx) * params.ny * params.nz;
+	ImageOwned img{params};
+	img.allocate();
+	ImageOwned update{params};
+	update.allocate();
+	ImageOwned norm{params};
+	norm.allocate();
+	ImageOwned mask{params};
+	mask.allocate();
+	for (size_t i = 0; i < numVoxels; i++)
+	{
+		img.getRawPointer()[i] = imageDataDistribution(engine);
+		update.getRawPointer()[i] = imageDataDistribution(engine);
+		norm.getRawPointer()[i] = imageDataDistribution(engine) - 0.2f;
+		mask.getRawPointer()[i] = imageDataDistribution(engine) - 0.5f;
+	}
+	const std::vector<float> original(img.getRawPointer(),
+	                                  img.getRawPointer() + numVoxels);
+
+	SECTION("image-reductions")
+	{
+		double sum = 0.0;
+		double dot = 0.0;
+		for (size_t i = 0; i < numVoxels; i++)
+		{
+			sum += original[i];
+			dot += static_cast<double>(original[i]) * update.getRawPointer()[i];
+		}
+		CHECK(img.voxelSum() == Approx(sum).epsilon(1e-6));
+		CHECK(img.dotProduct(update) == Approx(dot).epsilon(1e-6));
+
+		// Many small values added to a large one are not lost
+		ImageOwned ones{params};
+		ones.allocate();
+		ones.setValue(1e-4f);
+		ones.getRawPointer()[0] = 1e4f;
+		CHECK(ones.voxelSum() ==
+		      Approx(1e4 + 1e-4 * (numVoxels - 1)).epsilon(1e-7));
+	}
+
+	SECTION("image-threshold")
+	{
+		img.applyThreshold(&mask, 0.1f, 2.0f, 1.0f, 0.5f, -1.0f);
+		for (size_t i = 0; i < numVoxels; i++)
+		{
+			const float expected = mask.getRawPointer()[i] <= 0.1f ?
+			                           original[i] * 2.0f + 1.0f :
+			                           original[i] * 0.5f - 1.0f;
+			CHECK(img.getRawPointer()[i] == Approx(expected));
+		}
+	}
+
+	SECTION("image-em-update")
+	{
+		img.updateEMThreshold(&update, &norm, 0.0f);
+		for (size_t i = 0; i < numVoxels; i++)
+		{
+			const float normValue = norm.getRawPointer()[i];
+			const float expected =
+			    normValue > 0.0f ?
+			        original[i] * update.getRawPointer()[i] / normValue :
+			        original[i];
+			CHECK(img.getRawPointer()[i] == Approx(expected));
+		}
+	}
+
+	SECTION("image-elementwise")
+	{
+		img.multWithScalar(3.0f);
+		update.addFirstImageToSecond(&img);
+		img.getData() -= 1.0f;
+		img.getData() /= 2.0f;
+		for (size_t i = 0; i < numVoxels; i++)
+		{
+			CHECK(img.getRawPointer()[i] ==
+			      Approx((original[i] * 3.0f + update.getRawPointer()[i] -
+			              1.0f) /
+			             2.0f));
+		}
+	}
+
+	SECTION("image-downsample")
+	{
+		const auto downsampled = img.downsample(2);
+		const ImageParams& newParams = downsampled->getParams();
+		REQUIRE(newParams.nx == params.nx / 2);
+		REQUIRE(newParams.ny == params.ny / 2);
+		REQUIRE(newParams.nz == params.nz / 2);
+		CHECK(newParams.vx == Approx(2.0f * params.vx));
+		CHECK(newParams.length_z == Approx(params.length_z));
+		CHECK(downsampled->voxelSum() * 8.0f ==
+		      Approx(img.voxelSum()).epsilon(1e-4));
+		for (int k = 0; k < newParams.nz; k += 3)
+		{
+			for (int j = 0; j < newParams.ny; j += 5)
+			{
+				for (int i = 0; i < newParams.nx; i += 7)
+				{
+					float mean = 0.0f;
+					for (int dk = 0; dk < 2; dk++)
+					{
+						for (int dj = 0; dj < 2; dj++)
+						{
+							for (int di = 0; di < 2; di++)
+							{
+								mean += img.getData()[2 * k + dk][2 * j + dj]
+								                     [2 * i + di] /
+								        8.0f;
+							}
+						}
+					}
+					CHECK(downsampled->getData()[k][j][i] == Approx(mean));
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE("image-resample", "[image]")
+{
+	std::default_random_engine engine(13);
+	std::uniform_real_distribution<float> imageDataDistribution(1.0f, 10.0f);
+
+	const ImageParams params{14, 13, 12, 28.0f, 26.0f, 24.0f, 1.0f, 2.0f, 3.0f};
+	ImageOwned img{params};
+	img.allocate();
+	for (int i = 0; i < params.nx * params.ny * params.nz; i++)
+	{
+		img.getRawPointer()[i] = imageDataDistribution(engine);
+	}
+	const float* src = img.getRawPointer();
+
+	SECTION("resample-translation")
+	{
+		// One voxel along x
+		const auto moved = img.transformImage(Vector3D{0.0f, 0.0f, 0.0f},
+		                                      Vector3D{2.0f, 0.0f, 0.0f});
+		const float* dst = moved->getRawPointer();
+		for (int k = 0; k < params.nz; k++)
+		{
+			for (int j = 0; j < params.ny; j++)
+			{
+				CHECK(dst[IDX3(0, j, k, params.nx, params.ny)] == 0.0f);
+				for (int i = 1; i < params.nx; i++)
+				{
+					CHECK(dst[IDX3(i, j, k, params.nx, params.ny)] ==
+					      Approx(src[IDX3(i - 1, j, k, params.nx, params.ny)]));
+				}
+			}
+		}
+	}
+
+	SECTION("resample-rotation")
+	{
+		// Quarter turn around z on a square grid centered on the axis
+		const ImageParams squareParams{12, 12, 5, 24.0f, 24.0f, 10.0f};
+		ImageOwned square{squareParams};
+		square.allocate();
+		for (int i = 0; i < 12 * 12 * 5; i++)
+		{
+			square.getRawPointer()[i] = imageDataDistribution(engine);
+		}
+		for (const auto method :
+		     {ImageResampler::TRILINEAR, ImageResampler::CUBIC})
+		{
+			ImageOwned moved{squareParams};
+			moved.allocate();
+			moved.setValue(0.0f);
+			ImageResampler::resample(
+			    square, moved,
+			    ImageResampler::fromRotationAndTranslation(
+			        Vector3D{0.0f, 0.0f, static_cast<float>(PI / 2)},
+			        Vector3D{0.0f, 0.0f, 0.0f}),
+			    1.0f, method);
+			for (int k = 0; k < 5; k++)
+			{
+				for (int j = 0; j < 12; j++)
+				{
+					for (int i = 0; i < 12; i++)
+					{
+						// (x, y) comes from (y, -x)
+						CHECK(moved.getRawPointer()[IDX3(i, j, k, 12, 12)] ==
+						      Approx(square.getRawPointer()[IDX3(
+						                 j, 11 - i, k, 12, 12)])
+						          .epsilon(1e-4));
+					}
+				}
+			}
+		}
+	}
+
+	const transform_t t = ImageResampler::fromRotationAndTranslation(
+	    Vector3D{0.1f, -0.2f, 0.3f}, Vector3D{1.5f, -2.0f, 0.7f});
+
+	SECTION("resample-interpolation")
+	{
+		// Same values as the point-wise trilinear interpolation
+		ImageOwned moved{params};
+		moved.allocate();
+		moved.setValue(0.0f);
+		img.transformImage(t, moved, 2.0f);
+		const transform_t inv = ImageResampler::inverse(t);
+		int numInside = 0;
+		for (int k = 0; k < params.nz; k++)
+		{
+			const float z = img.indexToPositionInDimension<0>(k);
+			for (int j = 0; j < params.ny; j++)
+			{
+				const float y = img.indexToPositionInDimension<1>(j);
+				for (int i = 0; i < params.nx; i++)
+				{
+					const float x = img.indexToPositionInDimension<2>(i);
+					const float value =
+					    moved.getRawPointer()[IDX3(i, j, k, params.nx,
+					                               params.ny)];
+					if (value == 0.0f)
+					{
+						continue;
+					}
+					numInside++;
+					const Vector3D pt{
+					    inv.r00 * x + inv.r01 * y + inv.r02 * z + inv.tx,
+					    inv.r10 * x + inv.r11 * y + inv.r12 * z + inv.ty,
+					    inv.r20 * x + inv.r21 * y + inv.r22 * z + inv.tz};
+					CHECK(value ==
+					      Approx(2.0f * img.interpolateImage(pt)).epsilon(1e-4));
+				}
+			}
+		}
+		CHECK(numInside > params.nx * params.ny * params.nz / 2);
+	}
+
+	SECTION("resample-linear-function")
+	{
+		// Both methods reproduce a linear function, here on a finer grid
+		const auto linear = [](float x, float y, float z)
+		{ return 0.5f * x - 0.25f * y + 0.75f * z + 40.0f; };
+		for (int k = 0; k < params.nz; k++)
+		{
+			for (int j = 0; j < params.ny; j++)
+			{
+				for (int i = 0; i < params.nx; i++)
+				{
+					img.getRawPointer()[IDX3(i, j, k, params.nx, params.ny)] =
+					    linear(img.indexToPositionInDimension<2>(i),
+					           img.indexToPositionInDimension<1>(j),
+					           img.indexToPositionInDimension<0>(k));
+				}
+			}
+		}
+		// Far enough from the borders for the cubic interpolation
+		const ImageParams fineParams{10, 10, 8, 8.0f, 8.0f, 6.4f,
+		                             1.0f, 2.0f, 3.0f};
+		const transform_t inv = ImageResampler::inverse(t);
+		for (const auto method :
+		     {ImageResampler::TRILINEAR, ImageResampler::CUBIC})
+		{
+			ImageOwned moved{fineParams};
+			moved.allocate();
+			moved.setValue(0.0f);
+			ImageResampler::resample(img, moved, t, 1.0f, method);
+			for (int k = 0; k < fineParams.nz; k++)
+			{
+				const float z = moved.indexToPositionInDimension<0>(k);
+				for (int j = 0; j < fineParams.ny; j++)
+				{
+					const float y = moved.indexToPositionInDimension<1>(j);
+					for (int i = 0; i < fineParams.nx; i++)
+					{
+						const float x = moved.indexToPositionInDimension<2>(i);
+						const float srcX =
+						    inv.r00 * x + inv.r01 * y + inv.r02 * z + inv.tx;
+						const float srcY =
+						    inv.r10 * x + inv.r11 * y + inv.r12 * z + inv.ty;
+						const float srcZ =
+						    inv.r20 * x + inv.r21 * y + inv.r22 * z + inv.tz;
+						CHECK(moved.getRawPointer()[IDX3(i, j, k, fineParams.nx,
+						                                 fineParams.ny)] ==
+						      Approx(linear(srcX, srcY, srcZ)).epsilon(1e-4));
+					}
+				}
+			}
+		}
+	}
+}
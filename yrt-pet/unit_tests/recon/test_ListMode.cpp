@@ -5,12 +5,23 @@
 
 #include "catch.hpp"
 
+#include "datastruct/image/Image.hpp"
+#include "datastruct/projection/Histogram3D.hpp"
 #include "datastruct/projection/ListModeLUT.hpp"
+#include "datastruct/projection/ListModeLUTDOI.hpp"
+#include "datastruct/projection/ProjectionList.hpp"
+#include "operators/OperatorProjectorSiddon.hpp"
+#include "recon/OSEM.hpp"
 #include "test_utils.hpp"
 #include "utils/Array.hpp"
+#include "utils/ReconstructionUtils.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
 
 std::unique_ptr<ListModeLUTOwned> getListMode(const Scanner& scanner)
 {
@@ -63,6 +74,222 @@ TEST_CASE("listmode", "[list-mode]")
 		std::remove("listmode1");
 	}
 
+	SECTION("listmode-batch-properties")
+	{
+		// Two frames, the second one rotated around z and translated
+		LORMotion lorMotion{2};
+		lorMotion.setStartingTimestamp(0, 0);
+		lorMotion.setStartingTimestamp(1, 100);
+		lorMotion.setTransform(0, {1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0});
+		lorMotion.setTransform(1, {0.6f, -0.8f, 0, 0.8f, 0.6f, 0, 0, 0, 1,
+		                           5.0f, -3.0f, 2.0f});
+		lorMotion.writeToFile("lorMotion1");
+
+		auto listModeMotion = std::make_unique<ListModeLUTOwned>(*scanner);
+		listModeMotion->allocate(40);
+		for (bin_t i = 0; i < 40; i++)
+		{
+			listModeMotion->setDetectorIdsOfEvent(i, (7 * i) % 200,
+			                                      (13 * i + 100) % 216);
+			listModeMotion->setTimestampOfEvent(i, 5 * i);
+		}
+		listModeMotion->addLORMotion("lorMotion1");
+		REQUIRE(listModeMotion->hasMotion());
+
+		for (const ProjectionData* projData :
+		     {static_cast<const ProjectionData*>(listMode.get()),
+		      static_cast<const ProjectionData*>(listModeMotion.get())})
+		{
+			std::vector<bin_t> bins;
+			for (bin_t i = 0; i < projData->count(); i += 2)
+			{
+				bins.push_back(i);
+			}
+			ProjectionPropertiesBatch properties;
+			projData->getProjectionProperties(bins.data(), bins.size(),
+			                                  properties);
+			REQUIRE(properties.size() == bins.size());
+			for (size_t i = 0; i < bins.size(); i++)
+			{
+				const ProjectionProperties expected =
+				    projData->getProjectionProperties(bins[i]);
+				const ProjectionProperties batched = properties.get(i);
+				CHECK(batched.lor.point1.x == Approx(expected.lor.point1.x));
+				CHECK(batched.lor.point1.y == Approx(expected.lor.point1.y));
+				CHECK(batched.lor.point1.z == Approx(expected.lor.point1.z));
+				CHECK(batched.lor.point2.x == Approx(expected.lor.point2.x));
+				CHECK(batched.lor.point2.y == Approx(expected.lor.point2.y));
+				CHECK(batched.lor.point2.z == Approx(expected.lor.point2.z));
+				CHECK(batched.det1Orient.x == expected.det1Orient.x);
+				CHECK(batched.det2Orient.y == expected.det2Orient.y);
+				CHECK(batched.tofValue == expected.tofValue);
+			}
+		}
+
+		// The precomputed motion-corrected LORs give the same properties,
+		// also through a projection list
+		std::vector<ProjectionProperties> expected;
+		for (bin_t i = 0; i < listModeMotion->count(); i++)
+		{
+			expected.push_back(listModeMotion->getProjectionProperties(i));
+		}
+		REQUIRE_FALSE(listModeMotion->hasMotionCorrectedLORs());
+		listModeMotion->precomputeMotionCorrectedLORs();
+		REQUIRE(listModeMotion->hasMotionCorrectedLORs());
+		ProjectionListOwned projList{listModeMotion.get()};
+
+		std::vector<bin_t> bins(listModeMotion->count());
+		std::iota(bins.begin(), bins.end(), 0);
+		ProjectionPropertiesBatch properties;
+		projList.getProjectionProperties(bins.data(), bins.size(),
+		                                 properties);
+		for (bin_t i = 0; i < listModeMotion->count(); i++)
+		{
+			const ProjectionProperties cached =
+			    listModeMotion->getProjectionProperties(i);
+			for (const ProjectionProperties& props :
+			     {cached, properties.get(i)})
+			{
+				CHECK(props.lor.point1.x == Approx(expected[i].lor.point1.x));
+				CHECK(props.lor.point1.y == Approx(expected[i].lor.point1.y));
+				CHECK(props.lor.point1.z == Approx(expected[i].lor.point1.z));
+				CHECK(props.lor.point2.x == Approx(expected[i].lor.point2.x));
+				CHECK(props.lor.point2.y == Approx(expected[i].lor.point2.y));
+				CHECK(props.lor.point2.z == Approx(expected[i].lor.point2.z));
+				CHECK(props.det1Orient.z == expected[i].det1Orient.z);
+				CHECK(props.det2Orient.x == expected[i].det2Orient.x);
+				CHECK(props.tofValue == expected[i].tofValue);
+			}
+		}
+
+		// Changing the motion discards them
+		listModeMotion->addLORMotion("lorMotion1");
+		CHECK_FALSE(listModeMotion->hasMotionCorrectedLORs());
+
+		std::remove("lorMotion1");
+	}
+
+	SECTION("listmode-motion-frames")
+	{
+		// Events before the first frame, an empty frame and a last frame that
+		// extends to the end
+		const std::vector<timestamp_t> startingTimestamps{10, 20, 20, 35, 60};
+		LORMotion lorMotion{startingTimestamps.size()};
+		for (size_t frame = 0; frame < startingTimestamps.size(); frame++)
+		{
+			lorMotion.setStartingTimestamp(frame, startingTimestamps[frame]);
+			lorMotion.setTransform(frame,
+			                       {1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0});
+		}
+		lorMotion.writeToFile("lorMotion3");
+
+		auto listModeMotion = std::make_unique<ListModeLUTOwned>(*scanner);
+		listModeMotion->allocate(100);
+		for (bin_t i = 0; i < 100; i++)
+		{
+			listModeMotion->setDetectorIdsOfEvent(i, i % 200, (i + 50) % 200);
+			listModeMotion->setTimestampOfEvent(i, i / 2 + i / 3);
+		}
+		listModeMotion->addLORMotion("lorMotion3");
+		REQUIRE(listModeMotion->getNumFrames() == startingTimestamps.size());
+
+		for (bin_t i = 0; i < 100; i++)
+		{
+			// Last frame starting at or before the event
+			const timestamp_t ts = listModeMotion->getTimestamp(i);
+			frame_t expectedFrame = -1;
+			for (size_t frame = 0; frame < startingTimestamps.size(); frame++)
+			{
+				if (startingTimestamps[frame] <= ts)
+				{
+					expectedFrame = static_cast<frame_t>(frame);
+				}
+			}
+			CHECK(listModeMotion->getFrame(i) == expectedFrame);
+			if (expectedFrame >= 0)
+			{
+				const auto [first, last] =
+				    listModeMotion->getEventRangeOfFrame(expectedFrame);
+				CHECK(first <= i);
+				CHECK(i < last);
+			}
+		}
+		const auto [emptyFirst, emptyLast] =
+		    listModeMotion->getEventRangeOfFrame(1);
+		CHECK(emptyFirst == emptyLast);
+		CHECK(listModeMotion->getEventRangeOfFrame(4).second == 100);
+
+		std::remove("lorMotion3");
+	}
+
+	SECTION("listmode-motion-sensitivity")
+	{
+		// Transaxial translations by whole voxels, the second one in two
+		// frames
+		const ImageParams imgParams{20, 20, 10, 200.0f, 200.0f, 100.0f};
+		LORMotion lorMotion{4};
+		lorMotion.setStartingTimestamp(0, 0);
+		lorMotion.setStartingTimestamp(1, 100);
+		lorMotion.setStartingTimestamp(2, 150);
+		lorMotion.setStartingTimestamp(3, 200);
+		lorMotion.setTransform(0, {1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0});
+		lorMotion.setTransform(1, {1, 0, 0, 0, 1, 0, 0, 0, 1, 20.0f, 0, 0});
+		lorMotion.setTransform(2, {1, 0, 0, 0, 1, 0, 0, 0, 1, 20.0f, 0, 0});
+		lorMotion.setTransform(3, {1, 0, 0, 0, 1, 0, 0, 0, 1, 0, -10.0f, 0});
+		lorMotion.writeToFile("lorMotion2");
+		listMode->addLORMotion("lorMotion2");
+
+		auto sensData = std::make_unique<Histogram3DOwned>(*scanner);
+		sensData->allocate();
+		sensData->clearProjections(1.0f);
+		auto unmovedSensImage = std::make_unique<ImageOwned>(imgParams);
+		unmovedSensImage->allocate();
+		unmovedSensImage->setValue(0.0f);
+		Util::backProject(*scanner, *unmovedSensImage, *sensData);
+
+		auto movedSensImage = std::make_unique<ImageOwned>(imgParams);
+		movedSensImage->allocate();
+		Util::timeAverageMoveSensitivityImage(*listMode, *unmovedSensImage,
+		                                      *movedSensImage);
+		auto movedSensImageExact = std::make_unique<ImageOwned>(imgParams);
+		movedSensImageExact->allocate();
+		Util::timeAverageMoveSensitivityImageExact(*listMode, *sensData,
+		                                           *movedSensImageExact);
+
+		// Same result wherever the moved voxels come from inside the image
+		// and its FOV cylinder. The end slices are left out since some LORs
+		// lie on the faces of the image
+		const float* moved = movedSensImage->getRawPointer();
+		const float* movedExact = movedSensImageExact->getRawPointer();
+		for (int k = 1; k < imgParams.nz - 1; k++)
+		{
+			for (int j = 0; j < imgParams.ny - 1; j++)
+			{
+				for (int i = 2; i < imgParams.nx; i++)
+				{
+					const float x = (i + 0.5f) * 10.0f - 100.0f;
+					const float y = (j + 0.5f) * 10.0f - 100.0f;
+					if (std::hypot(x, y) > 70.0f)
+					{
+						continue;
+					}
+					const int idx = (k * imgParams.ny + j) * imgParams.nx + i;
+					CHECK(moved[idx] ==
+					      Approx(movedExact[idx]).epsilon(1e-4).margin(1e-3));
+				}
+			}
+		}
+
+		// The weights are the durations of the frames: 0.4, 0.4 and 0.2
+		const int idx = (5 * imgParams.ny + 10) * imgParams.nx + 10;
+		const float* unmoved = unmovedSensImage->getRawPointer();
+		CHECK(moved[idx] ==
+		      Approx(0.4f * unmoved[idx] + 0.4f * unmoved[idx - 2] +
+		             0.2f * unmoved[idx + imgParams.nx]));
+
+		std::remove("lorMotion2");
+	}
+
 	SECTION("listmode-get-lor-id")
 	{
 		histo_bin_t histoBin = listMode->getHistogramBin(0);
@@ -93,3 +320,221 @@ void makeArraysDOI(Array1D<float>& ts, Array1D<float>& tof,
 		z2[li] = li;
 	}
 }
+
+TEST_CASE("listmode-doi", "[list-mode]")
+{
+	const auto scanner = TestUtils::makeScanner();
+	srand(13);
+
+	// Few detector pairs, so that many events share their LOR
+	constexpr int NumLayers = 4;
+	constexpr size_t NumEvents = 2000;
+	auto listMode =
+	    std::make_unique<ListModeLUTDOIOwned>(*scanner, false, NumLayers);
+	listMode->allocate(NumEvents);
+	Array1D<timestamp_t> timestamps;
+	timestamps.allocate(NumEvents);
+	Array1D<det_id_t> d1, d2;
+	d1.allocate(NumEvents);
+	d2.allocate(NumEvents);
+	Array1D<unsigned char> doi1, doi2;
+	doi1.allocate(NumEvents);
+	doi2.allocate(NumEvents);
+	for (size_t i = 0; i < NumEvents; i++)
+	{
+		const int pair = rand() % 20;
+		timestamps[i] = i;
+		d1[i] = (7 * pair) % 200;
+		d2[i] = (13 * pair + 100) % 216;
+		doi1[i] = rand() % 256;
+		doi2[i] = rand() % 256;
+	}
+	auto listModeAlias =
+	    std::make_unique<ListModeLUTDOIAlias>(*scanner, false, NumLayers);
+	listModeAlias->bind(&timestamps, &d1, &d2, &doi1, &doi2);
+
+	SECTION("listmode-doi-lor")
+	{
+		REQUIRE(listModeAlias->hasArbitraryLORs());
+		REQUIRE(listModeAlias->hasDuplicateLORs());
+		for (bin_t i = 0; i < NumEvents; i += 7)
+		{
+			// Center of the crystal layer along the detector orientation
+			const float layerSize = 256.0f / NumLayers;
+			const float depth = scanner->crystalDepth;
+			const float doi1_t =
+			    std::floor(doi1[i] / layerSize) * depth / NumLayers;
+			const float doi2_t =
+			    std::floor(doi2[i] / layerSize) * depth / NumLayers;
+			const Vector3D p1 =
+			    scanner->getDetectorPos(d1[i]) +
+			    scanner->getDetectorOrient(d1[i]) * (doi1_t - 0.5f * depth);
+			const Vector3D p2 =
+			    scanner->getDetectorPos(d2[i]) +
+			    scanner->getDetectorOrient(d2[i]) * (doi2_t - 0.5f * depth);
+
+			const Line3D lor = listModeAlias->getArbitraryLOR(i);
+			CHECK(lor.point1.x == Approx(p1.x).margin(1e-4));
+			CHECK(lor.point1.y == Approx(p1.y).margin(1e-4));
+			CHECK(lor.point1.z == Approx(p1.z).margin(1e-4));
+			CHECK(lor.point2.x == Approx(p2.x).margin(1e-4));
+			CHECK(lor.point2.y == Approx(p2.y).margin(1e-4));
+			CHECK(lor.point2.z == Approx(p2.z).margin(1e-4));
+			CHECK(listModeAlias->getLayer(doi1[i]) ==
+			      static_cast<int>(doi1[i] / layerSize));
+		}
+
+		// Same key if and only if same detectors and layers
+		for (bin_t i = 0; i < 200; i++)
+		{
+			for (bin_t j = i + 1; j < 200; j++)
+			{
+				const bool sameLOR =
+				    d1[i] == d1[j] && d2[i] == d2[j] &&
+				    listModeAlias->getLayer(doi1[i]) ==
+				        listModeAlias->getLayer(doi1[j]) &&
+				    listModeAlias->getLayer(doi2[i]) ==
+				        listModeAlias->getLayer(doi2[j]);
+				CHECK((listModeAlias->getLORKey(i) ==
+				       listModeAlias->getLORKey(j)) == sameLOR);
+			}
+		}
+	}
+
+	SECTION("listmode-doi-projection")
+	{
+		// Each distinct LOR is projected once, which must give the same
+		// result as projecting every event
+		const ImageParams imgParams{24, 24, 10, 240.0f, 240.0f, 200.0f};
+		auto img = std::make_unique<ImageOwned>(imgParams);
+		img->allocate();
+		for (int i = 0; i < 24 * 24 * 10; i++)
+		{
+			img->getRawPointer()[i] = static_cast<float>(rand() % 100);
+		}
+		auto binIter = listModeAlias->getBinIter(1, 0);
+		OperatorProjectorSiddon projector{
+		    OperatorProjectorParams{binIter.get(), *scanner}};
+
+		auto projList =
+		    std::make_unique<ProjectionListOwned>(listModeAlias.get());
+		projList->allocate();
+		projector.applyA(img.get(), projList.get());
+		for (bin_t i = 0; i < NumEvents; i++)
+		{
+			const float expected = projector.forwardProjection(
+			    img.get(), listModeAlias->getProjectionProperties(i));
+			CHECK(projList->getProjectionValue(i) == Approx(expected));
+		}
+
+		for (bin_t i = 0; i < NumEvents; i++)
+		{
+			projList->setProjectionValue(i, static_cast<float>(rand() % 10));
+		}
+		auto imgBp = std::make_unique<ImageOwned>(imgParams);
+		imgBp->allocate();
+		imgBp->setValue(0.0f);
+		projector.applyAH(projList.get(), imgBp.get());
+		auto imgBpRef = std::make_unique<ImageOwned>(imgParams);
+		imgBpRef->allocate();
+		imgBpRef->setValue(0.0f);
+		for (bin_t i = 0; i < NumEvents; i++)
+		{
+			projector.backProjection(imgBpRef.get(),
+			                         listModeAlias->getProjectionProperties(i),
+			                         projList->getProjectionValue(i));
+		}
+		for (int i = 0; i < 24 * 24 * 10; i++)
+		{
+			CHECK(imgBp->getRawPointer()[i] ==
+			      Approx(imgBpRef->getRawPointer()[i]).margin(1e-3));
+		}
+
+		// The groups are computed once for the bin iterator, and shared with
+		// the ProjectionLists of the data
+		CHECK(&projector.getLORGroups(listModeAlias.get()) ==
+		      &projector.getLORGroups(projList.get()));
+		// Other data has its own groups
+		auto listModeOther =
+		    std::make_unique<ListModeLUTDOIAlias>(*scanner, false, NumLayers);
+		listModeOther->bind(&timestamps, &d1, &d2, &doi1, &doi2);
+		CHECK(&projector.getLORGroups(listModeOther.get()) !=
+		      &projector.getLORGroups(listModeAlias.get()));
+
+		// Replacing the bin iterator gives the groups of the new one
+		auto binIterSubset = listModeAlias->getBinIter(2, 1);
+		projector.setBinIter(binIterSubset.get());
+		const OperatorProjector::LORGroups& groupsSubset =
+		    projector.getLORGroups(listModeAlias.get());
+		REQUIRE(groupsSubset.bins.size() == binIterSubset->size());
+		for (bin_t group = 0; group < groupsSubset.numGroups(); group++)
+		{
+			const uint64_t key =
+			    listModeAlias->getLORKey(groupsSubset.getFirstBin(group));
+			for (size_t i = groupsSubset.groupStarts[group];
+			     i < groupsSubset.groupStarts[group + 1]; i++)
+			{
+				CHECK(listModeAlias->getLORKey(groupsSubset.bins[i]) == key);
+			}
+		}
+
+		// With TOF, the events do not share their LOR
+		Array1D<float> tof;
+		tof.allocate(NumEvents);
+		tof.fill(0.0f);
+		auto listModeTOF =
+		    std::make_unique<ListModeLUTDOIAlias>(*scanner, true, NumLayers);
+		listModeTOF->bind(&timestamps, &d1, &d2, &doi1, &doi2, &tof);
+		CHECK_FALSE(listModeTOF->hasDuplicateLORs());
+	}
+
+	SECTION("listmode-doi-osem")
+	{
+		// The EM update projects each distinct LOR once, which must give the
+		// same image as projecting every event
+		const ImageParams imgParams{24, 24, 10, 240.0f, 240.0f, 200.0f};
+		auto sensImage = std::make_unique<ImageOwned>(imgParams);
+		sensImage->allocate();
+		sensImage->setValue(2.0f);
+
+		auto osem = Util::createOSEM(*scanner);
+		osem->setImageParams(imgParams);
+		osem->setDataInput(listModeAlias.get());
+		osem->num_MLEM_iterations = 1;
+		osem->num_OSEM_subsets = 1;
+		osem->setSensitivityImage(sensImage.get());
+		const std::unique_ptr<ImageOwned> reconImage = osem->reconstruct("");
+
+		// x1 = x0 * A^T(1 / A x0) / sens, event by event
+		auto initImage = std::make_unique<ImageOwned>(imgParams);
+		initImage->allocate();
+		initImage->setValue(OSEM::INITIAL_VALUE_MLEM);
+		auto bpImage = std::make_unique<ImageOwned>(imgParams);
+		bpImage->allocate();
+		bpImage->setValue(0.0f);
+		OperatorProjectorSiddon projector{
+		    OperatorProjectorParams{nullptr, *scanner}};
+		for (bin_t i = 0; i < NumEvents; i++)
+		{
+			const ProjectionProperties props =
+			    listModeAlias->getProjectionProperties(i);
+			const float proj =
+			    projector.forwardProjection(initImage.get(), props);
+			if (proj > 1e-8)
+			{
+				projector.backProjection(bpImage.get(), props, 1.0f / proj);
+			}
+		}
+
+		double maxValue = 0.0;
+		for (int i = 0; i < 24 * 24 * 10; i++)
+		{
+			const float expected =
+			    OSEM::INITIAL_VALUE_MLEM * bpImage->getRawPointer()[i] / 2.0f;
+			maxValue = std::max<double>(maxValue, expected);
+			CHECK(reconImage->getRawPointer()[i] ==
+			      Approx(expected).epsilon(1e-4).margin(1e-6));
+		}
+		REQUIRE(maxValue > 0.0);
+	}
+}
@@ -0,0 +1,271 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "catch.hpp"
+
+#include "datastruct/image/Image.hpp"
+#include "datastruct/projection/Histogram3D.hpp"
+#include "geometry/ProjectorUtils.hpp"
+#include "operators/OperatorProjectorDD.hpp"
+#include "operators/OperatorProjectorSiddon.hpp"
+#include "operators/ProjectionPsfManager.hpp"
+#include "recon/OSEM.hpp"
+#include "test_utils.hpp"
+#include "utils/ReconstructionUtils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// Kernels file: s step, kernel spacing, kernel size, then the kernels
+	void writePsfFile(const std::string& filename, float sStep,
+	                  float kSpacing,
+	                  const std::vector<std::vector<float>>& kernels)
+	{
+		std::ofstream file(filename);
+		file << sStep << "," << kSpacing << "," << kernels[0].size();
+		for (const auto& kernel : kernels)
+		{
+			for (const float v : kernel)
+			{
+				file << "," << v;
+			}
+		}
+		file << "\n";
+	}
+
+	std::unique_ptr<ImageOwned> makeRandomImage()
+	{
+		const ImageParams imgParams{24, 24, 20, 240.0f, 240.0f, 200.0f};
+		auto img = std::make_unique<ImageOwned>(imgParams);
+		img->allocate();
+		img->setValue(0.0f);
+		for (int k = 3; k < 17; k++)
+		{
+			for (int j = 4; j < 20; j++)
+			{
+				for (int i = 4; i < 20; i++)
+				{
+					img->getData()[k][j][i] =
+					    static_cast<float>(rand() % 100) / 10.0f;
+				}
+			}
+		}
+		return img;
+	}
+
+	// <A x, y> and <x, A^T y> for random y
+	template <typename Projector>
+	void checkAdjoint(Projector& projector, const Scanner& scanner,
+	                  const Image& img)
+	{
+		auto histoAx = std::make_unique<Histogram3DOwned>(scanner);
+		histoAx->allocate();
+		projector.applyA(&img, histoAx.get());
+		auto histoY = std::make_unique<Histogram3DOwned>(scanner);
+		histoY->allocate();
+		double dotProj = 0.0;
+		for (bin_t binId = 0; binId < histoY->count(); binId++)
+		{
+			const float y = static_cast<float>(rand() % 10);
+			histoY->setProjectionValue(binId, y);
+			dotProj += y * histoAx->getProjectionValue(binId);
+		}
+		auto imgATy = std::make_unique<ImageOwned>(img.getParams());
+		imgATy->allocate();
+		imgATy->setValue(0.0f);
+		projector.applyAH(histoY.get(), imgATy.get());
+		REQUIRE(dotProj > 0.0);
+		CHECK(img.dotProduct(*imgATy) == Approx(dotProj).epsilon(1e-3));
+	}
+}  // namespace
+
+TEST_CASE("projection-psf", "[psf]")
+{
+	srand(13);
+	const std::string psfFilename = "projection_psf_kernels.csv";
+	constexpr float SStep = 50.0f;
+	constexpr float KSpacing = 1.5f;
+	// Asymmetric kernels so that flipping matters
+	const std::vector<std::vector<float>> kernels{
+	    {0.05f, 0.1f, 0.2f, 0.3f, 0.2f, 0.1f, 0.05f},
+	    {0.0f, 0.15f, 0.25f, 0.3f, 0.15f, 0.1f, 0.05f},
+	    {0.1f, 0.1f, 0.1f, 0.2f, 0.3f, 0.1f, 0.1f}};
+	const int kernelSize = kernels[0].size();
+	writePsfFile(psfFilename, SStep, KSpacing, kernels);
+
+	SECTION("projection-psf-weights")
+	{
+		const ProjectionPsfManager psfManager{psfFilename};
+		REQUIRE(psfManager.getKernelSize() == kernelSize);
+		REQUIRE(psfManager.getKernelSpacing() == KSpacing);
+		const float halfWidth = psfManager.getHalfWidth_mm();
+
+		for (size_t s_idx = 0; s_idx < kernels.size(); s_idx++)
+		{
+			// LOR along x at the middle of the kernel's radial interval
+			const float s = (s_idx + 0.5f) * SStep;
+			const Line3D lor{{-300.0f, s, 0.0f}, {300.0f, s, 0.0f}};
+			const std::vector<float> flipped(kernels[s_idx].rbegin(),
+			                                 kernels[s_idx].rend());
+			for (const bool flagFlipped : {false, true})
+			{
+				const float* kernelRef =
+				    flagFlipped ? flipped.data() : kernels[s_idx].data();
+				const float* kernel = psfManager.getKernel(lor, flagFlipped);
+				for (int i = 0; i < 200; i++)
+				{
+					// Beyond the support of the kernel on both sides
+					const float x0 = (static_cast<float>(rand() % 1000) /
+					                      1000.0f * 2.5f -
+					                  1.25f) *
+					                 halfWidth;
+					const float x1 =
+					    x0 + static_cast<float>(rand() % 1000) / 1000.0f *
+					             1.5f * halfWidth;
+					const float weight = psfManager.getWeight(kernel, x0, x1);
+					const float weightRef =
+					    (x0 > halfWidth || x1 < -halfWidth || x0 >= x1) ?
+					        0.0f :
+					        Util::calculateIntegral(kernelRef, kernelSize,
+					                                KSpacing, x0, x1);
+					CHECK(weight == Approx(weightRef).margin(1e-5));
+				}
+			}
+		}
+	}
+
+	SECTION("projection-psf-projectors")
+	{
+		auto scanner = TestUtils::makeScanner();
+		auto img = makeRandomImage();
+		auto histo3d = std::make_unique<Histogram3DOwned>(*scanner);
+		histo3d->allocate();
+		auto binIter = histo3d->getBinIter(1, 0);
+		const OperatorProjectorParams projParams{
+		    binIter.get(), *scanner, 0.0f, 0, psfFilename};
+
+		// DD: the kernels looked up by block give the same projections as
+		// looking them up per LOR
+		OperatorProjectorDD projectorDD{projParams};
+		projectorDD.applyA(img.get(), histo3d.get());
+		for (bin_t binId = 0; binId < histo3d->count(); binId += 7)
+		{
+			const ProjectionProperties props =
+			    histo3d->getProjectionProperties(binId);
+			REQUIRE(props.psfKernel == nullptr);
+			CHECK(histo3d->getProjectionValue(binId) ==
+			      Approx(projectorDD.forwardProjection(img.get(), props))
+			          .margin(1e-4));
+		}
+		checkAdjoint(projectorDD, *scanner, *img);
+
+		// Siddon, single and multiple rays
+		OperatorProjectorSiddon projectorSiddon{projParams};
+		checkAdjoint(projectorSiddon, *scanner, *img);
+		OperatorProjectorSiddon projectorSiddonMultiRay{OperatorProjectorParams{
+		    binIter.get(), *scanner, 0.0f, 0, psfFilename, 4}};
+		checkAdjoint(projectorSiddonMultiRay, *scanner, *img);
+
+		// The PSF blurs the projections without changing their sum
+		OperatorProjectorSiddon projectorNoPsf{
+		    OperatorProjectorParams{binIter.get(), *scanner}};
+		auto histoNoPsf = std::make_unique<Histogram3DOwned>(*scanner);
+		histoNoPsf->allocate();
+		projectorNoPsf.applyA(img.get(), histoNoPsf.get());
+		projectorSiddon.applyA(img.get(), histo3d.get());
+		double sumPsf = 0.0;
+		double sumNoPsf = 0.0;
+		float maxDiff = 0.0f;
+		for (bin_t binId = 0; binId < histo3d->count(); binId++)
+		{
+			sumPsf += histo3d->getProjectionValue(binId);
+			sumNoPsf += histoNoPsf->getProjectionValue(binId);
+			maxDiff = std::max(maxDiff,
+			                   std::abs(histo3d->getProjectionValue(binId) -
+			                            histoNoPsf->getProjectionValue(binId)));
+		}
+		CHECK(sumPsf == Approx(sumNoPsf).epsilon(1e-2));
+		CHECK(maxDiff > 0.0f);
+
+		// A single-sample kernel does not change the Siddon projection
+		writePsfFile(psfFilename, SStep, KSpacing, {{1.0f}});
+		OperatorProjectorSiddon projectorDelta{OperatorProjectorParams{
+		    binIter.get(), *scanner, 0.0f, 0, psfFilename}};
+		projectorDelta.applyA(img.get(), histo3d.get());
+		for (bin_t binId = 0; binId < histo3d->count(); binId++)
+		{
+			CHECK(histo3d->getProjectionValue(binId) ==
+			      Approx(histoNoPsf->getProjectionValue(binId)));
+		}
+	}
+
+	SECTION("projection-psf-osem")
+	{
+		// The EM update looks up the kernels by block, which must give the
+		// same image as the projector: x1 = x0 * A^T(y / A x0) / sens
+		auto scanner = TestUtils::makeScanner();
+		auto img = makeRandomImage();
+		const ImageParams& imgParams = img->getParams();
+		auto measurements = std::make_unique<Histogram3DOwned>(*scanner);
+		measurements->allocate();
+		auto binIter = measurements->getBinIter(1, 0);
+		OperatorProjectorDD projector{OperatorProjectorParams{
+		    binIter.get(), *scanner, 0.0f, 0, psfFilename}};
+		projector.applyA(img.get(), measurements.get());
+
+		auto sensImage = std::make_unique<ImageOwned>(imgParams);
+		sensImage->allocate();
+		sensImage->setValue(2.0f);
+		auto osem = Util::createOSEM(*scanner);
+		osem->setImageParams(imgParams);
+		osem->setDataInput(measurements.get());
+		osem->projectorType = OperatorProjector::DD;
+		osem->addProjPSF(psfFilename);
+		osem->num_MLEM_iterations = 1;
+		osem->num_OSEM_subsets = 1;
+		osem->setSensitivityImage(sensImage.get());
+		const std::unique_ptr<ImageOwned> reconImage = osem->reconstruct("");
+
+		auto initImage = std::make_unique<ImageOwned>(imgParams);
+		initImage->allocate();
+		initImage->setValue(OSEM::INITIAL_VALUE_MLEM);
+		auto ratio = std::make_unique<Histogram3DOwned>(*scanner);
+		ratio->allocate();
+		projector.applyA(initImage.get(), ratio.get());
+		for (bin_t binId = 0; binId < ratio->count(); binId++)
+		{
+			const float proj = ratio->getProjectionValue(binId);
+			ratio->setProjectionValue(
+			    binId, proj > 1e-8f ?
+			               measurements->getProjectionValue(binId) / proj :
+			               0.0f);
+		}
+		auto bpImage = std::make_unique<ImageOwned>(imgParams);
+		bpImage->allocate();
+		bpImage->setValue(0.0f);
+		projector.applyAH(ratio.get(), bpImage.get());
+
+		double maxValue = 0.0;
+		const size_t numVoxels = imgParams.nx * imgParams.ny * imgParams.nz;
+		for (size_t i = 0; i < numVoxels; i++)
+		{
+			const float expected =
+			    OSEM::INITIAL_VALUE_MLEM * bpImage->getRawPointer()[i] / 2.0f;
+			maxValue = std::max<double>(maxValue, expected);
+			CHECK(reconImage->getRawPointer()[i] ==
+			      Approx(expected).epsilon(1e-4).margin(1e-5));
+		}
+		REQUIRE(maxValue > 0.0);
+	}
+
+	std::remove(psfFilename.c_str());
+}
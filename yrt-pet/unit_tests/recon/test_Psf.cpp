@@ -0,0 +1,328 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "catch.hpp"
+
+#include "datastruct/image/Image.hpp"
+#include "operators/OperatorPsf.hpp"
+#include "operators/OperatorVarPsf.hpp"
+#include "utils/Tools.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+	// Straightforward separable convolution with periodic boundaries
+	void convolveReference(const Image& in, Image& out,
+	                       const std::vector<float>& kernelX,
+	                       const std::vector<float>& kernelY,
+	                       const std::vector<float>& kernelZ)
+	{
+		const ImageParams& params = in.getParams();
+		const int nx = params.nx;
+		const int ny = params.ny;
+		const int nz = params.nz;
+		const auto wrap = [](int x, int n) { return ((x % n) + n) % n; };
+		const int cx = kernelX.size() / 2;
+		const int cy = kernelY.size() / 2;
+		const int cz = kernelZ.size() / 2;
+		const float* inPtr = in.getRawPointer();
+		float* outPtr = out.getRawPointer();
+
+		std::vector<double> tmp1(nx * ny * nz), tmp2(nx * ny * nz);
+		for (int k = 0; k < nz; k++)
+			for (int j = 0; j < ny; j++)
+				for (int i = 0; i < nx; i++)
+				{
+					double sum = 0.0;
+					for (int kk = -cx; kk <= cx; kk++)
+						sum += kernelX[kk + cx] *
+						       inPtr[IDX3(wrap(i - kk, nx), j, k, nx, ny)];
+					tmp1[IDX3(i, j, k, nx, ny)] = sum;
+				}
+		for (int k = 0; k < nz; k++)
+			for (int j = 0; j < ny; j++)
+				for (int i = 0; i < nx; i++)
+				{
+					double sum = 0.0;
+					for (int kk = -cy; kk <= cy; kk++)
+						sum += kernelY[kk + cy] *
+						       tmp1[IDX3(i, wrap(j - kk, ny), k, nx, ny)];
+					tmp2[IDX3(i, j, k, nx, ny)] = sum;
+				}
+		for (int k = 0; k < nz; k++)
+			for (int j = 0; j < ny; j++)
+				for (int i = 0; i < nx; i++)
+				{
+					double sum = 0.0;
+					for (int kk = -cz; kk <= cz; kk++)
+						sum += kernelZ[kk + cz] *
+						       tmp2[IDX3(i, j, wrap(k - kk, nz), nx, ny)];
+					outPtr[IDX3(i, j, k, nx, ny)] = static_cast<float>(sum);
+				}
+	}
+
+	std::vector<float> makeKernel(int size)
+	{
+		std::vector<float> kernel(size);
+		for (int i = 0; i < size; i++)
+		{
+			kernel[i] = static_cast<float>(rand() % 100) / 100.0f;
+		}
+		return kernel;
+	}
+
+	float maxAbsValue(const Image& a)
+	{
+		const ImageParams& params = a.getParams();
+		const size_t numVoxels =
+		    static_cast<size_t>(params.nx) * params.ny * params.nz;
+		float maxValue = 0.0f;
+		for (size_t i = 0; i < numVoxels; i++)
+		{
+			maxValue = std::max(maxValue, std::abs(a.getRawPointer()[i]));
+		}
+		return maxValue;
+	}
+
+	float maxAbsDifference(const Image& a, const Image& b)
+	{
+		const ImageParams& params = a.getParams();
+		const size_t numVoxels =
+		    static_cast<size_t>(params.nx) * params.ny * params.nz;
+		float maxDiff = 0.0f;
+		for (size_t i = 0; i < numVoxels; i++)
+		{
+			maxDiff = std::max(maxDiff, std::abs(a.getRawPointer()[i] -
+			                                     b.getRawPointer()[i]));
+		}
+		return maxDiff;
+	}
+
+	void writeKernel(std::ofstream& file, const std::vector<float>& kernel)
+	{
+		for (size_t i = 0; i < kernel.size(); i++)
+		{
+			file << (i > 0 ? "," : "") << kernel[i];
+		}
+		file << "\n";
+	}
+
+	// Writes a spatially-variant PSF file with the given kernels, in
+	// axial-major order, and returns the kernels as {x, y, z}
+	std::vector<std::array<std::vector<float>, 3>>
+	    writeVarPsf(const std::string& filename,
+	                const std::vector<float>& radialPositions,
+	                const std::vector<float>& axialPositions, bool sameKernels)
+	{
+		std::vector<std::array<std::vector<float>, 3>> kernels;
+		std::ofstream file(filename);
+		writeKernel(file, radialPositions);
+		writeKernel(file, axialPositions);
+		file << radialPositions.size() << "," << axialPositions.size() << "\n";
+		const size_t numKernels = radialPositions.size() * axialPositions.size();
+		for (size_t n = 0; n < numKernels; n++)
+		{
+			if (n == 0 || !sameKernels)
+			{
+				kernels.push_back({makeKernel(3 + 2 * (rand() % 2)),
+				                   makeKernel(3 + 2 * (rand() % 3)),
+				                   makeKernel(3 + 2 * (rand() % 2))});
+			}
+			else
+			{
+				kernels.push_back(kernels.front());
+			}
+			for (const auto& kernel : kernels.back())
+			{
+				writeKernel(file, kernel);
+			}
+			file << kernels.back()[0].size() << ","
+			     << kernels.back()[1].size() << ","
+			     << kernels.back()[2].size() << "\n";
+		}
+		return kernels;
+	}
+}  // namespace
+
+TEST_CASE("psf", "[psf]")
+{
+	srand(13);
+	// Odd dimensions, to exercise the non-power-of-two FFT lengths
+	const ImageParams params{20, 17, 13, 40.0f, 34.0f, 26.0f};
+	auto img = std::make_unique<ImageOwned>(params);
+	img->allocate();
+	for (int i = 0; i < params.nx * params.ny * params.nz; i++)
+	{
+		img->getRawPointer()[i] = static_cast<float>(rand() % 1000) / 100.0f;
+	}
+	auto imgRef = std::make_unique<ImageOwned>(params);
+	imgRef->allocate();
+	auto imgOut = std::make_unique<ImageOwned>(params);
+	imgOut->allocate();
+
+	OperatorPsf psf;
+
+	SECTION("psf-methods")
+	{
+		// The last case has a kernel wider than the image along z
+		for (const auto& [sizeX, sizeY, sizeZ] :
+		     std::vector<std::tuple<int, int, int>>{
+		         {5, 7, 3}, {1, 9, 11}, {15, 3, 31}})
+		{
+			const auto kernelX = makeKernel(sizeX);
+			const auto kernelY = makeKernel(sizeY);
+			const auto kernelZ = makeKernel(sizeZ);
+			convolveReference(*img, *imgRef, kernelX, kernelY, kernelZ);
+
+			for (const auto method :
+			     {OperatorPsf::DIRECT, OperatorPsf::FFT, OperatorPsf::AUTO})
+			{
+				psf.setConvolutionMethod(method);
+				psf.convolve(img.get(), imgOut.get(), kernelX, kernelY,
+				             kernelZ);
+				CHECK(maxAbsDifference(*imgOut, *imgRef) <
+				      1e-4f * maxAbsValue(*imgRef));
+			}
+		}
+	}
+
+	SECTION("psf-in-place")
+	{
+		const auto kernelX = makeKernel(5);
+		const auto kernelY = makeKernel(5);
+		const auto kernelZ = makeKernel(5);
+		convolveReference(*img, *imgRef, kernelX, kernelY, kernelZ);
+		psf.convolve(img.get(), img.get(), kernelX, kernelY, kernelZ);
+		CHECK(maxAbsDifference(*img, *imgRef) < 1e-4f * maxAbsValue(*imgRef));
+	}
+
+	SECTION("psf-adjoint")
+	{
+		const std::string psfFilename = "psf_kernels.csv";
+		{
+			std::ofstream file(psfFilename);
+			file << "0.1,0.2,0.4,0.2,0.1\n"
+			     << "0.05,0.1,0.2,0.3,0.2,0.1,0.05\n"
+			     << "0.2,0.6,0.3\n"
+			     << "5,7,3\n";
+		}
+		psf.readFromFile(psfFilename);
+		std::remove(psfFilename.c_str());
+
+		auto imgY = std::make_unique<ImageOwned>(params);
+		imgY->allocate();
+		for (int i = 0; i < params.nx * params.ny * params.nz; i++)
+		{
+			imgY->getRawPointer()[i] = static_cast<float>(rand() % 100);
+		}
+		auto imgAx = std::make_unique<ImageOwned>(params);
+		imgAx->allocate();
+		auto imgATy = std::make_unique<ImageOwned>(params);
+		imgATy->allocate();
+		psf.applyA(img.get(), imgAx.get());
+		psf.applyAH(imgY.get(), imgATy.get());
+		CHECK(imgAx->dotProduct(*imgY) ==
+		      Approx(img->dotProduct(*imgATy)).epsilon(1e-4));
+	}
+
+	SECTION("psf-variant-weights")
+	{
+		const auto weights = OperatorVarPsf::computeInterpolationWeights(
+		    {0.0f, 10.0f, 30.0f}, {-5.0f, 0.0f, 5.0f, 20.0f, 30.0f, 50.0f});
+		const std::vector<std::vector<float>> expected{
+		    {1.0f, 1.0f, 0.5f, 0.0f, 0.0f, 0.0f},
+		    {0.0f, 0.0f, 0.5f, 0.5f, 0.0f, 0.0f},
+		    {0.0f, 0.0f, 0.0f, 0.5f, 1.0f, 1.0f}};
+		for (size_t n = 0; n < expected.size(); n++)
+		{
+			for (size_t p = 0; p < expected[n].size(); p++)
+			{
+				CHECK(weights[n][p] == Approx(expected[n][p]));
+			}
+		}
+	}
+
+	// Voxel positions: x = (i - 9.5) * 2, y = (j - 8) * 2, z = (k - 6) * 2
+	const std::vector<float> radialPositions{0.0f, 9.0f, 30.0f};
+	const std::vector<float> axialPositions{-12.0f, -4.0f, 4.0f, 12.0f};
+	const std::string varPsfFilename = "var_psf_kernels.csv";
+
+	SECTION("psf-variant-invariant")
+	{
+		// Identical kernels everywhere give the shift-invariant PSF
+		const auto kernels = writeVarPsf(varPsfFilename, radialPositions,
+		                                 axialPositions, true);
+		OperatorVarPsf varPsf{varPsfFilename};
+		std::remove(varPsfFilename.c_str());
+		REQUIRE(varPsf.getNumKernels() == 12);
+
+		const auto& [kernelX, kernelY, kernelZ] = kernels.front();
+		convolveReference(*img, *imgRef, kernelX, kernelY, kernelZ);
+		varPsf.applyA(img.get(), imgOut.get());
+		CHECK(maxAbsDifference(*imgOut, *imgRef) <
+		      1e-4f * maxAbsValue(*imgRef));
+
+		std::vector<float> kernelX_flipped(kernelX.rbegin(), kernelX.rend());
+		std::vector<float> kernelY_flipped(kernelY.rbegin(), kernelY.rend());
+		std::vector<float> kernelZ_flipped(kernelZ.rbegin(), kernelZ.rend());
+		convolveReference(*img, *imgRef, kernelX_flipped, kernelY_flipped,
+		                  kernelZ_flipped);
+		varPsf.applyAH(img.get(), imgOut.get());
+		CHECK(maxAbsDifference(*imgOut, *imgRef) <
+		      1e-4f * maxAbsValue(*imgRef));
+	}
+
+	SECTION("psf-variant-nodes")
+	{
+		const auto kernels = writeVarPsf(varPsfFilename, radialPositions,
+		                                 axialPositions, false);
+		OperatorVarPsf varPsf{varPsfFilename};
+		std::remove(varPsfFilename.c_str());
+		varPsf.applyA(img.get(), imgOut.get());
+
+		// A voxel located on a node only sees the kernel of that node
+		for (const auto& [i, j, k, rNode, zNode] :
+		     std::vector<std::tuple<int, int, int, int, int>>{
+		         {14, 8, 8, 1, 2}, {5, 8, 0, 1, 0}, {14, 8, 12, 1, 3}})
+		{
+			const auto& [kernelX, kernelY, kernelZ] =
+			    kernels[zNode * radialPositions.size() + rNode];
+			convolveReference(*img, *imgRef, kernelX, kernelY, kernelZ);
+			const size_t idx = IDX3(i, j, k, params.nx, params.ny);
+			CHECK(imgOut->getRawPointer()[idx] ==
+			      Approx(imgRef->getRawPointer()[idx]).epsilon(1e-4));
+		}
+	}
+
+	SECTION("psf-variant-adjoint")
+	{
+		writeVarPsf(varPsfFilename, radialPositions, axialPositions, false);
+		OperatorVarPsf varPsf{varPsfFilename};
+		std::remove(varPsfFilename.c_str());
+
+		auto imgY = std::make_unique<ImageOwned>(params);
+		imgY->allocate();
+		for (int i = 0; i < params.nx * params.ny * params.nz; i++)
+		{
+			imgY->getRawPointer()[i] = static_cast<float>(rand() % 100);
+		}
+		auto imgAx = std::make_unique<ImageOwned>(params);
+		imgAx->allocate();
+		varPsf.applyA(img.get(), imgAx.get());
+		const double yAx = imgAx->dotProduct(*imgY);
+
+		// In place, as done for the sensitivity image
+		varPsf.applyAH(imgY.get(), imgY.get());
+		CHECK(yAx == Approx(img->dotProduct(*imgY)).epsilon(1e-4));
+	}
+}
@@ -11,6 +11,8 @@
 #include "test_utils.hpp"
 #include "utils/Array.hpp"
 
+#include <cstdint>
+
 
 TEST_CASE("scanner", "[createLUT]")
 {
@@ -35,4 +37,30 @@ TEST_CASE("scanner", "[createLUT]")
 		REQUIRE(lut[bin_id][1] == pos.y);
 		REQUIRE(lut[bin_id][2] == pos.z);
 	}
+
+	SECTION("detector-table")
+	{
+		const DetectorTable& detTable = scanner->getDetectorTable();
+		REQUIRE(detTable.getNumDets() == scanner->getNumDets());
+		for (const float* array :
+		     {detTable.getXpos(), detTable.getYpos(), detTable.getZpos(),
+		      detTable.getXorient(), detTable.getYorient(),
+		      detTable.getZorient()})
+		{
+			CHECK(reinterpret_cast<std::uintptr_t>(array) %
+			          DetectorTable::Alignment ==
+			      0);
+		}
+		for (det_id_t d = 0; d < scanner->getNumDets(); d++)
+		{
+			const Vector3D pos = scanner->getDetectorPos(d);
+			const Vector3D orient = scanner->getDetectorOrient(d);
+			REQUIRE(detTable.getXpos()[d] == pos.x);
+			REQUIRE(detTable.getYpos()[d] == pos.y);
+			REQUIRE(detTable.getZpos()[d] == pos.z);
+			REQUIRE(detTable.getOrient(d).x == orient.x);
+			REQUIRE(detTable.getOrient(d).y == orient.y);
+			REQUIRE(detTable.getOrient(d).z == orient.z);
+		}
+	}
 }
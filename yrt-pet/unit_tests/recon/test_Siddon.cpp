@@ -4,6 +4,11 @@
  */
 
 #include "datastruct/image/Image.hpp"
+#include "datastruct/projection/Histogram3D.hpp"
+#include "datastruct/projection/ListModeLUT.hpp"
+#include "datastruct/scanner/DetRegular.hpp"
+#include "geometry/MultiRayGenerator.hpp"
+#include "operators/OperatorProjectorDD.hpp"
 #include "operators/OperatorProjectorSiddon.hpp"
 
 #include "catch.hpp"
@@ -11,6 +16,7 @@
 #include <cstdlib>
 #include <ctime>
 #include <memory>
+#include <vector>
 
 /** Helper function for adjoint test
  *
@@ -624,3 +630,318 @@ TEST_CASE("Siddon-bugs", "[siddon]")
 		}
 	}
 }
+
+namespace
+{
+	// Scanner with crystals large enough for the multi-ray sampling to matter
+	std::unique_ptr<Scanner> makeMultiRayScanner()
+	{
+		auto scanner = std::make_unique<Scanner>("MultiRayScanner", 64.0f, 4.0f,
+		                                         8.0f, 12.0f, 150.0f, 96, 16, 1,
+		                                         15, 10, 8);
+		const auto detRegular = std::make_shared<DetRegular>(scanner.get());
+		detRegular->generateLUT();
+		scanner->setDetectorSetup(detRegular);
+		return scanner;
+	}
+
+	// Hot spots of one voxel over a warm cylinder
+	std::unique_ptr<ImageOwned> makeMultiRayImage()
+	{
+		const ImageParams params{64, 64, 16, 192.0f, 192.0f, 48.0f};
+		auto img = std::make_unique<ImageOwned>(params);
+		img->allocate();
+		img->setValue(0.0f);
+		Array3DAlias<float> arr = img->getArray();
+		for (int k = 2; k < 14; k++)
+		{
+			for (int j = 0; j < 64; j++)
+			{
+				for (int i = 0; i < 64; i++)
+				{
+					const float x = (i - 31.5f) * 3.0f;
+					const float y = (j - 31.5f) * 3.0f;
+					if (x * x + y * y < 70.0f * 70.0f)
+					{
+						arr[k][j][i] = 1.0f;
+					}
+				}
+			}
+		}
+		for (int spot = 0; spot < 40; spot++)
+		{
+			arr[2 + spot % 12][12 + (spot * 7) % 40][12 + (spot * 13) % 40] =
+			    20.0f;
+		}
+		return img;
+	}
+
+	// Relative RMS error of the multi-ray projections of the given LORs
+	// against the reference, with stratified or random sub-rays
+	struct MultiRayAccuracy
+	{
+		double errorStratified;
+		double errorRandom;
+	};
+
+	// Average projection over uniformly random rays between the crystals
+	float getRandomMultiRayProjection(const Image& img,
+	                                  const MultiRayGenerator& randomGen,
+	                                  int numRays, unsigned int& seed)
+	{
+		double proj = 0.0;
+		for (int i = 0; i < numRays; i++)
+		{
+			proj += OperatorProjectorSiddon::singleForwardProjection(
+			    &img, randomGen.getRandomLine(seed));
+		}
+		return static_cast<float>(proj / numRays);
+	}
+
+	MultiRayAccuracy
+	    getMultiRayAccuracy(const Scanner& scanner, const Image& img,
+	                        const std::vector<ProjectionProperties>& props,
+	                        const std::vector<float>& reference, int numRays)
+	{
+		OperatorProjectorSiddon projector{
+		    OperatorProjectorParams{nullptr, scanner, 0.0f, 0, "", numRays}};
+		MultiRayGenerator randomGen{scanner.crystalSize_z,
+		                            scanner.crystalSize_trans, false,
+		                            scanner.crystalDepth};
+
+		double sqErrStratified = 0.0;
+		double sqErrRandom = 0.0;
+		double sqRef = 0.0;
+		unsigned int seed = 13;
+		for (size_t lorIdx = 0; lorIdx < props.size(); lorIdx++)
+		{
+			const ProjectionProperties& prop = props[lorIdx];
+			const float projStratified =
+			    projector.forwardProjection(&img, prop);
+
+			float projRandom = 0.0f;
+			if (numRays == 1)
+			{
+				projRandom =
+				    OperatorProjectorSiddon::singleForwardProjection(&img,
+				                                                     prop.lor);
+			}
+			else
+			{
+				randomGen.setupGenerator(prop.lor, prop.det1Orient,
+				                         prop.det2Orient);
+				projRandom =
+				    getRandomMultiRayProjection(img, randomGen, numRays, seed);
+			}
+
+			const double ref = reference[lorIdx];
+			sqErrStratified += (projStratified - ref) * (projStratified - ref);
+			sqErrRandom += (projRandom - ref) * (projRandom - ref);
+			sqRef += ref * ref;
+		}
+		return {std::sqrt(sqErrStratified / sqRef),
+		        std::sqrt(sqErrRandom / sqRef)};
+	}
+
+	// The reference is independent of the stratification: a uniformly random
+	// multi-ray projection with many rays, from another seed than the random
+	// projections compared with it
+	void getMultiRayReference(const Scanner& scanner, const Image& img,
+	                          std::vector<ProjectionProperties>& props,
+	                          std::vector<float>& reference)
+	{
+		auto histo3d = std::make_unique<Histogram3DAlias>(scanner);
+		for (bin_t binId = 0; binId < histo3d->count(); binId += 331)
+		{
+			props.push_back(histo3d->getProjectionProperties(binId));
+		}
+		MultiRayGenerator randomGen{scanner.crystalSize_z,
+		                            scanner.crystalSize_trans, false,
+		                            scanner.crystalDepth};
+		unsigned int seed = 20240517;
+		for (const ProjectionProperties& prop : props)
+		{
+			randomGen.setupGenerator(prop.lor, prop.det1Orient,
+			                         prop.det2Orient);
+			reference.push_back(
+			    getRandomMultiRayProjection(img, randomGen, 4096, seed));
+		}
+	}
+}  // namespace
+
+TEST_CASE("Siddon-multiray", "[siddon]")
+{
+	SECTION("sobol_stratification")
+	{
+		// Every dimension has exactly one point per stratum
+		constexpr int NumPoints = 64;
+		constexpr int NumDims = MultiRayGenerator::MaxSobolDims;
+		std::vector<std::vector<int>> counts(NumDims,
+		                                     std::vector<int>(NumPoints, 0));
+		float point[NumDims];
+		for (int i = 0; i < NumPoints; i++)
+		{
+			MultiRayGenerator::getSobolPoint(i, NumDims, point);
+			for (int dim = 0; dim < NumDims; dim++)
+			{
+				REQUIRE(point[dim] >= 0.0f);
+				REQUIRE(point[dim] < 1.0f);
+				counts[dim][static_cast<int>(point[dim] * NumPoints)]++;
+			}
+		}
+		for (int dim = 0; dim < NumDims; dim++)
+		{
+			for (int stratum = 0; stratum < NumPoints; stratum++)
+			{
+				CHECK(counts[dim][stratum] == 1);
+			}
+		}
+		// Pairs of dimensions: one point per square of side 1/8
+		for (int dim1 = 0; dim1 < NumDims; dim1++)
+		{
+			for (int dim2 = dim1 + 1; dim2 < 3; dim2++)
+			{
+				std::vector<int> squares(NumPoints, 0);
+				for (int i = 0; i < NumPoints; i++)
+				{
+					MultiRayGenerator::getSobolPoint(i, NumDims, point);
+					squares[static_cast<int>(point[dim1] * 8) * 8 +
+					        static_cast<int>(point[dim2] * 8)]++;
+				}
+				for (int square = 0; square < NumPoints; square++)
+				{
+					CHECK(squares[square] == 1);
+				}
+			}
+		}
+	}
+
+	auto scanner = makeMultiRayScanner();
+	auto img = makeMultiRayImage();
+	std::vector<ProjectionProperties> props;
+	std::vector<float> reference;
+	getMultiRayReference(*scanner, *img, props, reference);
+	REQUIRE(props.size() > 100);
+
+	SECTION("deterministic_rays")
+	{
+		// The sub-rays do not depend on the LOR's order nor on its
+		// neighbours, and differ from one another
+		OperatorProjectorSiddon projector{
+		    OperatorProjectorParams{nullptr, *scanner, 0.0f, 0, "", 8}};
+		std::vector<float> forward;
+		for (const ProjectionProperties& prop : props)
+		{
+			forward.push_back(projector.forwardProjection(img.get(), prop));
+		}
+		for (size_t i = props.size(); i-- > 0;)
+		{
+			CHECK(projector.forwardProjection(img.get(), props[i]) ==
+			      forward[i]);
+		}
+
+		MultiRayGenerator lineGen{scanner->crystalSize_z,
+		                          scanner->crystalSize_trans, false,
+		                          scanner->crystalDepth};
+		lineGen.setupStratifiedOffsets(8);
+		REQUIRE(lineGen.getNumStratifiedRays() == 8);
+		lineGen.setupGenerator(props[0].lor, props[0].det1Orient,
+		                       props[0].det2Orient);
+		for (int i = 0; i < 8; i++)
+		{
+			const Line3D ray_i = lineGen.getStratifiedLine(i);
+			for (int j = i + 1; j < 8; j++)
+			{
+				const Line3D ray_j = lineGen.getStratifiedLine(j);
+				CHECK((ray_i.point1 - ray_j.point1).getNorm() +
+				          (ray_i.point2 - ray_j.point2).getNorm() >
+				      0.1f);
+			}
+		}
+
+		// A single stratified ray is the LOR itself
+		lineGen.setupStratifiedOffsets(1);
+		const Line3D ray = lineGen.getStratifiedLine(0);
+		CHECK((ray.point1 - props[0].lor.point1).getNorm() < 1e-4f);
+		CHECK((ray.point2 - props[0].lor.point2).getNorm() < 1e-4f);
+	}
+
+	SECTION("accuracy_vs_rays")
+	{
+		// The stratified sub-rays converge faster than random ones
+		const MultiRayAccuracy accuracy4 =
+		    getMultiRayAccuracy(*scanner, *img, props, reference, 4);
+		const MultiRayAccuracy accuracy16 =
+		    getMultiRayAccuracy(*scanner, *img, props, reference, 16);
+		CHECK(accuracy4.errorStratified < accuracy4.errorRandom);
+		CHECK(accuracy16.errorStratified < accuracy16.errorRandom);
+		CHECK(accuracy16.errorStratified < accuracy4.errorStratified);
+		// Half as many stratified rays do better than random ones
+		const MultiRayAccuracy accuracy32 =
+		    getMultiRayAccuracy(*scanner, *img, props, reference, 32);
+		CHECK(accuracy16.errorStratified < accuracy32.errorRandom);
+	}
+}
+
+TEST_CASE("projector-batch", "[siddon][dd]")
+{
+	// The projections of a block of bins match the per-bin projections
+	srand(13);
+	auto scanner = makeMultiRayScanner();
+	auto img = makeMultiRayImage();
+	const size_t numDets = scanner->getNumDets();
+
+	auto data = std::make_unique<ListModeLUTOwned>(*scanner);
+	const size_t numEvents = 300;
+	data->allocate(numEvents);
+	std::vector<bin_t> bins(numEvents);
+	std::vector<float> values(numEvents);
+	for (bin_t binId = 0; binId < numEvents; binId++)
+	{
+		data->setDetectorIdsOfEvent(binId, rand() % numDets, rand() % numDets);
+		bins[binId] = binId;
+		// Some null values, skipped by the backprojection
+		values[binId] = (binId % 5 == 0) ? 0.0f : 0.5f + (rand() % 10);
+	}
+	ProjectionPropertiesBatch properties;
+	data->getProjectionProperties(bins.data(), numEvents, properties);
+
+	OperatorProjectorSiddon siddon{
+	    OperatorProjectorParams{nullptr, *scanner, 0.0f, 0, "", 1}};
+	OperatorProjectorSiddon siddonMultiRay{
+	    OperatorProjectorParams{nullptr, *scanner, 0.0f, 0, "", 4}};
+	OperatorProjectorDD dd{OperatorProjectorParams{nullptr, *scanner}};
+	for (const OperatorProjector* projector :
+	     std::initializer_list<const OperatorProjector*>{
+	         &siddon, &siddonMultiRay, &dd})
+	{
+		std::vector<float> projValues(numEvents);
+		projector->forwardProjectionBatch(img.get(), properties,
+		                                  projValues.data());
+		for (bin_t binId = 0; binId < numEvents; binId++)
+		{
+			CHECK(projValues[binId] ==
+			      projector->forwardProjection(
+			          img.get(), data->getProjectionProperties(binId)));
+		}
+
+		auto imgBatch = std::make_unique<ImageOwned>(img->getParams());
+		imgBatch->allocate();
+		imgBatch->setValue(0.0f);
+		projector->backProjectionBatch(imgBatch.get(), properties,
+		                               values.data());
+		auto imgRef = std::make_unique<ImageOwned>(img->getParams());
+		imgRef->allocate();
+		imgRef->setValue(0.0f);
+		for (bin_t binId = 0; binId < numEvents; binId++)
+		{
+			projector->backProjection(imgRef.get(),
+			                          data->getProjectionProperties(binId),
+			                          values[binId]);
+		}
+		CHECK(imgBatch->dotProduct(*img) ==
+		      Approx(imgRef->dotProduct(*img)).epsilon(1e-5));
+		CHECK(imgBatch->dotProduct(*imgBatch) ==
+		      Approx(imgRef->dotProduct(*imgRef)).epsilon(1e-5));
+	}
+}
@@ -0,0 +1,851 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "catch.hpp"
+
+#include "datastruct/image/Image.hpp"
+#include "datastruct/projection/Histogram3D.hpp"
+#include "datastruct/projection/Histogram3DHalf.hpp"
+#include "datastruct/projection/Histogram3DSparseDefault.hpp"
+#include "datastruct/projection/TOFHistogram3D.hpp"
+#include "geometry/Constants.hpp"
+#include "operators/OperatorProjectorSiddon.hpp"
+#include "operators/TimeOfFlight.hpp"
+#include "recon/Corrector_CPU.hpp"
+#include "recon/OSEM.hpp"
+#include "scatter/Crystal.hpp"
+#include "scatter/ScatterEstimator.hpp"
+#include "scatter/SingleScatterSimulator.hpp"
+#include "test_utils.hpp"
+#include "utils/ReconstructionUtils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+namespace
+{
+	// Uniform cylinder of radius 60 mm
+	std::unique_ptr<ImageOwned> makeCylinderImage(float value)
+	{
+		const ImageParams imgParams{24, 24, 20, 240.0f, 240.0f, 200.0f};
+		auto img = std::make_unique<ImageOwned>(imgParams);
+		img->allocate();
+		img->setValue(0.0f);
+		for (int k = 2; k < 18; k++)
+		{
+			for (int j = 0; j < 24; j++)
+			{
+				for (int i = 0; i < 24; i++)
+				{
+					const float x = (i - 11.5f) * 10.0f;
+					const float y = (j - 11.5f) * 10.0f;
+					if (x * x + y * y < 60.0f * 60.0f)
+					{
+						img->getData()[k][j][i] = value;
+					}
+				}
+			}
+		}
+		return img;
+	}
+
+	// Same sampling as in SingleScatterSimulator::runSSS
+	std::vector<size_t> getSamples(size_t numSamples, size_t numBins)
+	{
+		std::vector<size_t> samples;
+		const float d = numBins / static_cast<float>(numSamples - 1);
+		for (size_t i = 0; i < numSamples; i++)
+		{
+			samples.push_back(
+			    std::min(static_cast<size_t>(d * i), numBins - 1));
+		}
+		return samples;
+	}
+
+	// Reference scatter tails mask, processing every sinogram row from both
+	// ends
+	void fillScatterTailsMaskRef(const Histogram3D& acfHis, Histogram3D& mask,
+	                             long maskWidth, float maskThreshold)
+	{
+		const long numR = acfHis.numR;
+		for (bin_t binId = 0; binId < acfHis.count(); binId++)
+		{
+			const float acf = acfHis.getProjectionValue(binId);
+			mask.setProjectionValue(
+			    binId, (acf == 0.0f || acf > maskThreshold) ? 1.0f : 0.0f);
+		}
+		for (bin_t rowStart = 0; rowStart < acfHis.count(); rowStart += numR)
+		{
+			long rFirst = 0;
+			while (rFirst < numR &&
+			       mask.getProjectionValue(rowStart + rFirst) == 1.0f)
+			{
+				rFirst++;
+			}
+			if (rFirst == numR)
+			{
+				for (long r = 0; r < numR; r++)
+				{
+					mask.setProjectionValue(rowStart + r, 0.0f);
+				}
+				continue;
+			}
+			long rLast = numR - 1;
+			while (mask.getProjectionValue(rowStart + rLast) == 1.0f)
+			{
+				rLast--;
+			}
+			for (long r = 0; r < numR; r++)
+			{
+				if (r < rFirst - maskWidth || r >= rLast + maskWidth)
+				{
+					mask.setProjectionValue(rowStart + r, 0.0f);
+				}
+			}
+		}
+	}
+
+	// Length of the ray from the detector (first point) to the scatter point
+	// (second point) inside the crystal ring
+	double getCrystalLengthRef(const Scanner& scanner, const Line3D& lor)
+	{
+		const Vector3D c{0.0f, 0.0f, 0.0f};
+		const Cylinder cylIn{c, scanner.axialFOV, scanner.scannerRadius};
+		const Cylinder cylOut{c, scanner.axialFOV,
+		                      scanner.scannerRadius + scanner.crystalDepth};
+		const Vector3D dir = lor.point1 - lor.point2;
+		Vector3D a1, a2;
+		cylIn.doesLineIntersectCylinder(lor, a1, a2);
+		const Vector3D in = (a1 - lor.point2).scalProd(dir) > 0 ? a1 : a2;
+		cylOut.doesLineIntersectCylinder(lor, a1, a2);
+		const Vector3D out = (a1 - lor.point2).scalProd(dir) > 0 ? a1 : a2;
+		return (in - out).getNorm();
+	}
+
+	struct ScatterRefStats
+	{
+		size_t numRejectedCollimator = 0;
+		size_t numRejectedInvalidLength = 0;
+	};
+
+	// Scalar double-precision single scatter of a LOR, evaluating the
+	// Klein-Nishina and energy terms exactly for every scatter point and
+	// skipping the rejected points
+	double computeSingleScatterInLORRef(
+	    const Scatter::SingleScatterSimulator& sss, const Scanner& scanner,
+	    const Image& mu, const Image& lambda, const Line3D& lor,
+	    const Vector3D& n1, const Vector3D& n2, ScatterRefStats& stats)
+	{
+		const Vector3D& p1 = lor.point1;
+		const Vector3D& p2 = lor.point2;
+		const double sigmaEnergy =
+		    scanner.fwhm / (2.0 * std::sqrt(2.0 * std::log(2.0)));
+		const auto getEfficiency = [&](double energy, double delta)
+		{
+			const double muDet =
+			    Scatter::getMuDet(energy, Scatter::CrystalMaterial::LYSO);
+			return std::erfc((scanner.energyLLD - energy) /
+			                 (std::sqrt(2.0) * sigmaEnergy)) *
+			       (1.0 - std::exp(-delta * muDet));
+		};
+		const auto getNorm = [](double x, double y, double z)
+		{ return std::sqrt(x * x + y * y + z * z); };
+
+		double res = 0.0;
+		for (int i = 0; i < sss.getNumSamples(); i++)
+		{
+			const Vector3D ps = sss.getSamplePoint(i);
+			const Line3D lor_1_s{p1, ps};
+			const Line3D lor_2_s{p2, ps};
+			const double delta_1 = getCrystalLengthRef(scanner, lor_1_s);
+			const double delta_2 = getCrystalLengthRef(scanner, lor_2_s);
+			const bool invalidLength = delta_1 > 10 * scanner.crystalDepth ||
+			                           delta_2 > 10 * scanner.crystalDepth;
+
+			const bool passes = std::abs(ps.z) <= scanner.axialFOV / 2 ||
+			                    (sss.passCollimator(lor_1_s) &&
+			                     sss.passCollimator(lor_2_s));
+			const double dist1 = getNorm(ps.x - p1.x, ps.y - p1.y, ps.z - p1.z);
+			const double dist2 = getNorm(p2.x - ps.x, p2.y - ps.y, p2.z - ps.z);
+			const double ux = (ps.x - p1.x) / dist1;
+			const double uy = (ps.y - p1.y) / dist1;
+			const double uz = (ps.z - p1.z) / dist1;
+			const double vx = (p2.x - ps.x) / dist2;
+			const double vy = (p2.y - ps.y) / dist2;
+			const double vz = (p2.z - ps.z) / dist2;
+			const double cosa = ux * vx + uy * vy + uz * vz;
+			const double energy = 511.0 / (2.0 - cosa);
+			if (!passes || energy <= scanner.energyLLD)
+			{
+				stats.numRejectedCollimator += !passes;
+				stats.numRejectedInvalidLength += invalidLength;
+				continue;
+			}
+			REQUIRE_FALSE(invalidLength);
+
+			const double kleinNishina =
+			    (1 + cosa * cosa) / 2 / ((2 - cosa) * (2 - cosa)) *
+			    (1 + (1 - cosa) * (1 - cosa) / ((2 - cosa) * (1 + cosa * cosa)));
+			const double a = energy / 511.0;
+			const double logTerm = std::log(1 + 2 * a);
+			const double muScaling =
+			    ((1 + a) / (a * a) *
+			         (2 * (1 + a) / (1 + 2 * a) - logTerm / a) +
+			     logTerm / (2 * a) - (1 + 3 * a) / ((1 + 2 * a) * (1 + 2 * a))) /
+			    (20.0 / 9.0 - 1.5 * std::log(3.0));
+
+			const double att_1_511 =
+			    OperatorProjectorSiddon::singleForwardProjection(&mu, lor_1_s) /
+			    10.0;
+			const double att_2_511 =
+			    OperatorProjectorSiddon::singleForwardProjection(&mu, lor_2_s) /
+			    10.0;
+			const double lamb_1 =
+			    OperatorProjectorSiddon::singleForwardProjection(&lambda,
+			                                                     lor_1_s);
+			const double lamb_2 =
+			    OperatorProjectorSiddon::singleForwardProjection(&lambda,
+			                                                     lor_2_s);
+			const double fac1 = lamb_1 *
+			                    std::exp(-att_1_511 - att_2_511 * muScaling) *
+			                    getEfficiency(511.0, delta_1) *
+			                    getEfficiency(energy, delta_2);
+			const double fac2 = lamb_2 *
+			                    std::exp(-att_1_511 * muScaling - att_2_511) *
+			                    getEfficiency(511.0, delta_2) *
+			                    getEfficiency(energy, delta_1);
+			const double sig_s_1 = std::abs(n1.x * ux + n1.y * uy + n1.z * uz);
+			const double sig_s_2 = std::abs(n2.x * vx + n2.y * vy + n2.z * vz);
+			res += mu.nearestNeighbor(ps) * kleinNishina * (fac1 + fac2) *
+			       sig_s_1 * sig_s_2 / (dist1 * dist1 * dist2 * dist2 * 4 * PI);
+		}
+
+		// Relative to the trues of the LOR
+		const Vector3D mid{(p1.x + p2.x) / 2, (p1.y + p2.y) / 2,
+		                   (p1.z + p2.z) / 2};
+		const double dist = getNorm(p2.x - p1.x, p2.y - p1.y, p2.z - p1.z);
+		const double sig_s_1 = std::abs((n1.x * (p2.x - p1.x) +
+		                                 n1.y * (p2.y - p1.y) +
+		                                 n1.z * (p2.z - p1.z)) /
+		                                dist);
+		const double sig_s_2 = std::abs((n2.x * (p2.x - p1.x) +
+		                                 n2.y * (p2.y - p1.y) +
+		                                 n2.z * (p2.z - p1.z)) /
+		                                dist);
+		const double eps_s_1_511 =
+		    getEfficiency(511.0, getCrystalLengthRef(scanner, {p1, mid}));
+		const double eps_s_2_511 =
+		    getEfficiency(511.0, getCrystalLengthRef(scanner, {p2, mid}));
+		return res / (eps_s_1_511 * eps_s_2_511 * sig_s_1 * sig_s_2 /
+		              (dist * dist * 4 * PI));
+	}
+}  // namespace
+
+TEST_CASE("scatter-tails", "[scatter]")
+{
+	srand(13);
+	auto scanner = TestUtils::makeScanner();
+	auto mu = makeCylinderImage(0.096f);
+	auto lambda = makeCylinderImage(1.0f);
+
+	const auto makeHisto = [&scanner]()
+	{
+		auto histo = std::make_unique<Histogram3DOwned>(*scanner);
+		histo->allocate();
+		return histo;
+	};
+	auto acfHis = makeHisto();
+	auto promptsHis = makeHisto();
+	auto randomsHis = makeHisto();
+	auto sensitivityHis = makeHisto();
+	auto scatterHis = makeHisto();
+	const size_t numR = acfHis->numR;
+	for (bin_t binId = 0; binId < acfHis->count(); binId++)
+	{
+		coord_t r, phi, zBin;
+		acfHis->getCoordsFromBinId(binId, r, phi, zBin);
+		// Object of varying position and width, absent from some rows, with
+		// invalid ACFs here and there
+		const long center = (phi * 7) % numR;
+		const long halfWidth = 1 + zBin % (numR / 3);
+		float acf = (std::abs(static_cast<long>(r) - center) < halfWidth &&
+		             phi % 5 != 0) ?
+		                0.5f :
+		                1.0f;
+		if (rand() % 20 == 0)
+		{
+			acf = 0.0f;
+		}
+		acfHis->setProjectionValue(binId, acf);
+		promptsHis->setProjectionValue(binId, 1.0f + rand() % 100);
+		randomsHis->setProjectionValue(binId, (rand() % 10) / 10.0f);
+		sensitivityHis->setProjectionValue(binId, (rand() % 10) / 10.0f);
+		scatterHis->setProjectionValue(binId, 1.0f + rand() % 50);
+	}
+
+	constexpr int MaskWidth = 3;
+	constexpr float MaskThreshold = 0.9f;
+	const Scatter::ScatterEstimator estimator{
+	    *scanner,
+	    *lambda,
+	    *mu,
+	    promptsHis.get(),
+	    randomsHis.get(),
+	    acfHis.get(),
+	    sensitivityHis.get(),
+	    Scatter::ScatterEstimator::DefaultCrystal,
+	    Scatter::ScatterEstimator::DefaultSeed,
+	    MaskWidth,
+	    MaskThreshold};
+
+	const auto mask = estimator.generateScatterTailsMask();
+	auto maskRef = makeHisto();
+	fillScatterTailsMaskRef(*acfHis, *maskRef, MaskWidth, MaskThreshold);
+	size_t numInMask = 0;
+	for (bin_t binId = 0; binId < mask->count(); binId++)
+	{
+		REQUIRE(mask->getProjectionValue(binId) ==
+		        maskRef->getProjectionValue(binId));
+		numInMask += mask->getProjectionValue(binId) > 0.0f;
+	}
+	REQUIRE(numInMask > 0);
+	REQUIRE(numInMask < mask->count());
+
+	double promptsSum = 0.0;
+	double scatterSum = 0.0;
+	for (bin_t binId = 0; binId < mask->count(); binId++)
+	{
+		const float sensitivity = sensitivityHis->getProjectionValue(binId);
+		if (maskRef->getProjectionValue(binId) > 0.0f && sensitivity > 1e-8)
+		{
+			promptsSum += (promptsHis->getProjectionValue(binId) -
+			               randomsHis->getProjectionValue(binId)) /
+			              sensitivity;
+			scatterSum += scatterHis->getProjectionValue(binId);
+		}
+	}
+	const float facRef = promptsSum / scatterSum;
+
+	// The factor computed with the mask evaluated on the fly matches
+	const float fac = estimator.computeTailFittingFactor(scatterHis.get());
+	CHECK(fac == Approx(facRef));
+	CHECK(estimator.computeTailFittingFactor(scatterHis.get(), mask.get()) ==
+	      fac);
+
+	// Same results with inputs that hold no float array
+	const Histogram3DSparseDefault acfSparse{*acfHis, 1.0f};
+	const Histogram3DHalf promptsHalf{*promptsHis};
+	const Scatter::ScatterEstimator estimatorVariants{
+	    *scanner,
+	    *lambda,
+	    *mu,
+	    &promptsHalf,
+	    randomsHis.get(),
+	    &acfSparse,
+	    sensitivityHis.get(),
+	    Scatter::ScatterEstimator::DefaultCrystal,
+	    Scatter::ScatterEstimator::DefaultSeed,
+	    MaskWidth,
+	    MaskThreshold};
+	const auto maskVariants = estimatorVariants.generateScatterTailsMask();
+	for (bin_t binId = 0; binId < mask->count(); binId++)
+	{
+		REQUIRE(maskVariants->getProjectionValue(binId) ==
+		        mask->getProjectionValue(binId));
+	}
+	CHECK(estimatorVariants.computeTailFittingFactor(scatterHis.get()) ==
+	      Approx(fac));
+}
+
+TEST_CASE("scatter-tof-corrector", "[scatter]")
+{
+	srand(13);
+	auto scanner = TestUtils::makeScanner();
+	scanner->energyLLD = 400.0f;
+	scanner->fwhm = 0.2f * 511.0f;
+	scanner->collimatorRadius = 0.0f;
+	auto mu = makeCylinderImage(0.096f);
+	auto lambda = makeCylinderImage(1.0f);
+
+	// Object in the middle of every sinogram row, so that all the rows have
+	// tails
+	auto promptsHis = std::make_unique<Histogram3DOwned>(*scanner);
+	promptsHis->allocate();
+	auto acfHis = std::make_unique<Histogram3DOwned>(*scanner);
+	acfHis->allocate();
+	const long numR = acfHis->numR;
+	for (bin_t binId = 0; binId < acfHis->count(); binId++)
+	{
+		coord_t r, phi, zBin;
+		acfHis->getCoordsFromBinId(binId, r, phi, zBin);
+		const bool inObject = std::abs(static_cast<long>(r) - numR / 2) < 3;
+		acfHis->setProjectionValue(binId, inObject ? 0.5f : 1.0f);
+		promptsHis->setProjectionValue(binId, 1.0f + rand() % 100);
+	}
+	Scatter::ScatterEstimator estimator{
+	    *scanner,
+	    *lambda,
+	    *mu,
+	    promptsHis.get(),
+	    nullptr,
+	    acfHis.get(),
+	    nullptr,
+	    Scatter::ScatterEstimator::DefaultCrystal,
+	    Scatter::ScatterEstimator::DefaultSeed};
+
+	constexpr size_t NumTOFBins = 15;
+	constexpr float TOFBinWidth_ps = 200.0f;
+	constexpr float TOFWidth_ps = 300.0f;
+	auto scatterHis = estimator.computeTailFittedTOFScatterEstimate(
+	    3, 4, 5, NumTOFBins, TOFBinWidth_ps, TOFWidth_ps);
+	auto scatterSum = std::make_unique<Histogram3DOwned>(*scanner);
+	scatterSum->allocate();
+	scatterHis->collapseToHistogram3D(*scatterSum);
+
+	Corrector_CPU corrector{*scanner};
+	corrector.setScatterHistogram(scatterHis.get());
+	REQUIRE(corrector.hasAdditiveCorrection());
+
+	SECTION("scatter-tof-corrector-tof-bins")
+	{
+		// TOF-binned measurements get the scatter of their own TOF bin
+		TOFHistogram3DOwned measurements{*scanner, NumTOFBins,
+		                                 TOFBinWidth_ps};
+		corrector.precomputeAdditiveCorrectionFactors(measurements);
+		size_t numNonZero = 0;
+		for (bin_t binId = 0; binId < measurements.count(); binId++)
+		{
+			const float scatter = scatterHis->getProjectionValue(binId);
+			REQUIRE(corrector.getAdditiveCorrectionFactor(binId) == scatter);
+			numNonZero += scatter > 0.0f;
+		}
+		CHECK(numNonZero > 0);
+		CHECK(numNonZero < measurements.count());
+	}
+
+	SECTION("scatter-tof-corrector-non-tof")
+	{
+		// Measurements without TOF get the sum over the TOF bins of the LOR
+		Histogram3DOwned measurements{*scanner};
+		corrector.precomputeAdditiveCorrectionFactors(measurements);
+		for (bin_t binId = 0; binId < measurements.count(); binId++)
+		{
+			REQUIRE(corrector.getAdditiveCorrectionFactor(binId) ==
+			        Approx(scatterSum->getProjectionValue(binId)));
+		}
+	}
+}
+
+TEST_CASE("scatter-rounds", "[scatter]")
+{
+	auto scanner = TestUtils::makeScanner();
+	scanner->energyLLD = 400.0f;
+	scanner->fwhm = 0.2f * 511.0f;
+	scanner->collimatorRadius = 0.0f;
+	auto mu = makeCylinderImage(0.096f);
+	auto lambda = makeCylinderImage(1.0f);
+	const ImageParams& imgParams = lambda->getParams();
+
+	// Prompts of the cylinder over a uniform background, so that the tails
+	// are not empty
+	auto promptsHis = std::make_unique<Histogram3DOwned>(*scanner);
+	promptsHis->allocate();
+	Util::forwProject(*scanner, *lambda, *promptsHis,
+	                  OperatorProjector::SIDDON);
+	promptsHis->operationOnEachBinParallel(
+	    [&promptsHis](bin_t bin) -> float
+	    { return promptsHis->getProjectionValue(bin) + 0.5f; });
+	auto acfHis = std::make_unique<Histogram3DOwned>(*scanner);
+	acfHis->allocate();
+	Util::forwProject(*scanner, *mu, *acfHis, OperatorProjector::SIDDON);
+	Util::convertProjectionValuesToACF(*acfHis);
+
+	auto sensImage = std::make_unique<ImageOwned>(imgParams);
+	sensImage->allocate();
+	sensImage->setValue(2.0f);
+
+	auto makeOSEM = [&scanner, &imgParams, &promptsHis, &sensImage]()
+	{
+		auto osem = Util::createOSEM(*scanner);
+		osem->setImageParams(imgParams);
+		osem->setDataInput(promptsHis.get());
+		osem->projectorType = OperatorProjector::SIDDON;
+		osem->num_MLEM_iterations = 2;
+		osem->num_OSEM_subsets = 1;
+		osem->setSensitivityImage(sensImage.get());
+		return osem;
+	};
+	auto makeEstimator = [&scanner, &lambda, &mu, &promptsHis, &acfHis]()
+	{
+		return std::make_unique<Scatter::ScatterEstimator>(
+		    *scanner, *lambda, *mu, promptsHis.get(), nullptr, acfHis.get(),
+		    nullptr);
+	};
+	constexpr int NumScatterRounds = 2;
+	constexpr size_t NumZ = 3;
+	constexpr size_t NumPhi = 4;
+	constexpr size_t NumR = 5;
+
+	SECTION("scatter-rounds-in-place")
+	{
+		auto osem = makeOSEM();
+		auto estimator = makeEstimator();
+		const bool needToMakeCopyOfSensImage =
+		    osem->isNeedToMakeCopyOfSensImage();
+		auto scatterHis = std::make_unique<Histogram3DOwned>(*scanner);
+		scatterHis->allocate();
+		scatterHis->clearProjections(0.0f);
+		auto image = Util::reconstructWithScatterEstimation(
+		    *osem, *estimator, *scatterHis, NumScatterRounds, NumZ, NumPhi,
+		    NumR);
+
+		// Same rounds, with the scatter histogram given to the corrector
+		// once and updated in place after every reconstruction
+		auto osemRef = makeOSEM();
+		auto estimatorRef = makeEstimator();
+		auto scatterHisRef = std::make_unique<Histogram3DOwned>(*scanner);
+		scatterHisRef->allocate();
+		scatterHisRef->clearProjections(0.0f);
+		osemRef->setScatterHistogram(scatterHisRef.get());
+		std::unique_ptr<ImageOwned> imageRef;
+		for (int round = 0; round < NumScatterRounds; round++)
+		{
+			imageRef = osemRef->reconstruct("");
+			osemRef->initialEstimate = imageRef.get();
+			estimatorRef->setSourceImage(*imageRef);
+			estimatorRef->updateTailFittedScatterEstimate(*scatterHisRef, NumZ,
+			                                              NumPhi, NumR);
+			REQUIRE(osemRef->getScatterHistogram() == scatterHisRef.get());
+		}
+		auto imageRefFinal = osemRef->reconstruct("");
+
+		size_t numNonZero = 0;
+		for (bin_t binId = 0; binId < scatterHis->count(); binId++)
+		{
+			const float scatter = scatterHis->getProjectionValue(binId);
+			REQUIRE(scatter == Approx(scatterHisRef->getProjectionValue(binId))
+			                       .epsilon(1e-3)
+			                       .margin(1e-6));
+			numNonZero += scatter > 0.0f;
+		}
+		CHECK(numNonZero > 0);
+		const float* imagePtr = image->getRawPointer();
+		const float* imageRefPtr = imageRefFinal->getRawPointer();
+		const size_t numVoxels = imgParams.nx * imgParams.ny * imgParams.nz;
+		for (size_t i = 0; i < numVoxels; i++)
+		{
+			REQUIRE(imagePtr[i] ==
+			        Approx(imageRefPtr[i]).epsilon(1e-3).margin(1e-6));
+		}
+
+		// Previous state given back
+		CHECK(osem->initialEstimate == nullptr);
+		CHECK(osem->getScatterHistogram() == nullptr);
+		CHECK(osem->isNeedToMakeCopyOfSensImage() ==
+		      needToMakeCopyOfSensImage);
+		CHECK(&estimator->getSourceImage() == lambda.get());
+		CHECK_FALSE(estimator->isCacheDetectorTables());
+	}
+
+	SECTION("scatter-rounds-exception")
+	{
+		// The first reconstruction fails without data input
+		auto osem = makeOSEM();
+		osem->setDataInput(nullptr);
+		auto estimator = makeEstimator();
+		auto initialEstimate = makeCylinderImage(2.0f);
+		osem->initialEstimate = initialEstimate.get();
+		osem->setScatterHistogram(promptsHis.get());
+		osem->setNeedToMakeCopyOfSensImage(false);
+		auto scatterHis = std::make_unique<Histogram3DOwned>(*scanner);
+		scatterHis->allocate();
+
+		REQUIRE_THROWS(Util::reconstructWithScatterEstimation(
+		    *osem, *estimator, *scatterHis, NumScatterRounds, NumZ, NumPhi,
+		    NumR));
+		CHECK(osem->initialEstimate == initialEstimate.get());
+		CHECK(osem->getScatterHistogram() == promptsHis.get());
+		CHECK_FALSE(osem->isNeedToMakeCopyOfSensImage());
+		CHECK(&estimator->getSourceImage() == lambda.get());
+		CHECK_FALSE(estimator->isCacheDetectorTables());
+	}
+}
+
+TEST_CASE("single-scatter", "[scatter]")
+{
+	auto scanner = TestUtils::makeScanner();
+	scanner->energyLLD = 400.0f;
+	scanner->fwhm = 0.2f * 511.0f;
+	scanner->collimatorRadius = 0.0f;
+
+	// Attenuation in cm^-1
+	auto mu = makeCylinderImage(0.096f);
+	auto lambda = makeCylinderImage(1.0f);
+	Scatter::SingleScatterSimulator sss{*scanner, *mu, *lambda,
+	                                    Scatter::CrystalMaterial::LYSO, 13};
+	REQUIRE(sss.getNumSamples() > 10);
+
+	auto scatterHisto = std::make_unique<Histogram3DOwned>(*scanner);
+	scatterHisto->allocate();
+	scatterHisto->clearProjections(0.0f);
+	constexpr size_t NumZ = 3, NumPhi = 4, NumR = 5;
+	sss.runSSS(NumZ, NumPhi, NumR, *scatterHisto);
+
+	const std::vector<size_t> zSamples = getSamples(NumZ, scanner->numRings);
+	const std::vector<size_t> phiSamples =
+	    getSamples(NumPhi, scatterHisto->numPhi);
+	const std::vector<size_t> rSamples = getSamples(NumR, scatterHisto->numR);
+
+	SECTION("single-scatter-sampled-lors")
+	{
+		// The sampled LORs, computed from the per-detector tables, match the
+		// scatter computed for the LOR alone
+		size_t numNonZero = 0;
+		for (const size_t z : zSamples)
+		{
+			for (const size_t phi : phiSamples)
+			{
+				for (const size_t r : rSamples)
+				{
+					const bin_t binId =
+					    scatterHisto->getBinIdFromCoords(r, phi, z);
+					const auto [d1, d2] = scatterHisto->getDetectorPair(binId);
+					const Line3D lor{scanner->getDetectorPos(d1),
+					                 scanner->getDetectorPos(d2)};
+					const float scatterRef = sss.computeSingleScatterInLOR(
+					    lor, scanner->getDetectorOrient(d1),
+					    scanner->getDetectorOrient(d2));
+					// The gap filling interpolates through the sampled bins
+					CHECK(scatterHisto->getProjectionValue(binId) ==
+					      Approx(std::max(scatterRef, 0.0f))
+					          .epsilon(1e-4)
+					          .margin(1e-6));
+					if (scatterRef > 0.0f)
+					{
+						numNonZero++;
+					}
+				}
+			}
+		}
+		CHECK(numNonZero > 0);
+	}
+
+	SECTION("single-scatter-smooth")
+	{
+		// The monotone cubic interpolation goes through the sampled LORs and
+		// stays within their range
+		auto smoothHisto = std::make_unique<Histogram3DOwned>(*scanner);
+		smoothHisto->allocate();
+		smoothHisto->clearProjections(0.0f);
+		sss.runSSS(NumZ, NumPhi, NumR, *smoothHisto, true);
+
+		float minSampled = std::numeric_limits<float>::max();
+		float maxSampled = 0.0f;
+		for (const size_t z : zSamples)
+		{
+			for (const size_t phi : phiSamples)
+			{
+				for (const size_t r : rSamples)
+				{
+					const bin_t binId =
+					    smoothHisto->getBinIdFromCoords(r, phi, z);
+					const float value = smoothHisto->getProjectionValue(binId);
+					CHECK(value ==
+					      Approx(scatterHisto->getProjectionValue(binId))
+					          .margin(1e-6));
+					minSampled = std::min(minSampled, value);
+					maxSampled = std::max(maxSampled, value);
+				}
+			}
+		}
+		for (bin_t binId = 0; binId < smoothHisto->count(); binId++)
+		{
+			const float value = smoothHisto->getProjectionValue(binId);
+			REQUIRE(value >= minSampled - 1e-6f);
+			REQUIRE(value <= maxSampled + 1e-6f);
+		}
+	}
+
+	SECTION("single-scatter-tof")
+	{
+		constexpr size_t NumTOFBins = 15;
+		constexpr float TOFBinWidth_ps = 200.0f;
+		constexpr float TOFWidth_ps = 300.0f;
+		const TimeOfFlightHelper tofHelper{TOFWidth_ps};
+
+		// With TOF bins covering the whole FOV, the TOF bins of a LOR sum to
+		// its non-TOF scatter
+		for (const size_t phi : phiSamples)
+		{
+			for (const size_t r : rSamples)
+			{
+				const bin_t binId =
+				    scatterHisto->getBinIdFromCoords(r, phi, zSamples[1]);
+				const auto [d1, d2] = scatterHisto->getDetectorPair(binId);
+				const Line3D lor{scanner->getDetectorPos(d1),
+				                 scanner->getDetectorPos(d2)};
+				const Vector3D n1 = scanner->getDetectorOrient(d1);
+				const Vector3D n2 = scanner->getDetectorOrient(d2);
+				const std::vector<float> scatterTOF =
+				    sss.computeSingleScatterInLOR(lor, n1, n2, tofHelper,
+				                                  NumTOFBins, TOFBinWidth_ps);
+				REQUIRE(scatterTOF.size() == NumTOFBins);
+				float sum = 0.0f;
+				for (const float v : scatterTOF)
+				{
+					REQUIRE(v >= 0.0f);
+					sum += v;
+				}
+				CHECK(sum == Approx(sss.computeSingleScatterInLOR(lor, n1, n2))
+				                 .epsilon(1e-3)
+				                 .margin(1e-6));
+			}
+		}
+
+		// The linear gap filling commutes with the sum over the TOF bins
+		auto tofHisto = std::make_unique<TOFHistogram3DOwned>(
+		    *scanner, NumTOFBins, TOFBinWidth_ps);
+		tofHisto->allocate();
+		tofHisto->clearProjections(0.0f);
+		sss.runSSS(NumZ, NumPhi, NumR, *tofHisto, TOFWidth_ps);
+		auto sumHisto = std::make_unique<Histogram3DOwned>(*scanner);
+		sumHisto->allocate();
+		tofHisto->collapseToHistogram3D(*sumHisto);
+		for (bin_t binId = 0; binId < sumHisto->count(); binId++)
+		{
+			REQUIRE(sumHisto->getProjectionValue(binId) ==
+			        Approx(scatterHisto->getProjectionValue(binId))
+			            .epsilon(1e-3)
+			            .margin(1e-6));
+		}
+	}
+
+	SECTION("single-scatter-cached-tables")
+	{
+		// With the attenuation tables cached, changing the source image gives
+		// the same scatter as a new simulation with that source image
+		auto lambdaHot = makeCylinderImage(1.0f);
+		lambdaHot->getData()[10][14][14] = 20.0f;
+		Scatter::SingleScatterSimulator sssHot{
+		    *scanner, *mu, *lambdaHot, Scatter::CrystalMaterial::LYSO, 13};
+		auto hotHisto = std::make_unique<Histogram3DOwned>(*scanner);
+		hotHisto->allocate();
+		hotHisto->clearProjections(0.0f);
+		sssHot.runSSS(NumZ, NumPhi, NumR, *hotHisto);
+
+		sss.setCacheDetectorTables(true);
+		auto cachedHisto = std::make_unique<Histogram3DOwned>(*scanner);
+		cachedHisto->allocate();
+		for (const Image* source : {lambda.get(), lambdaHot.get()})
+		{
+			sss.setSourceImage(*source);
+			cachedHisto->clearProjections(0.0f);
+			sss.runSSS(NumZ, NumPhi, NumR, *cachedHisto);
+		}
+		for (bin_t binId = 0; binId < hotHisto->count(); binId++)
+		{
+			REQUIRE(cachedHisto->getProjectionValue(binId) ==
+			        Approx(hotHisto->getProjectionValue(binId)));
+		}
+	}
+
+	SECTION("single-scatter-downsampled")
+	{
+		// Simulating on downsampled images, with fewer scatter points, gives
+		// the same scatter distribution for a smooth object, up to a scale
+		// (which the tail fitting sets)
+		const auto muDownsampled = mu->downsample(2);
+		const auto lambdaDownsampled = lambda->downsample(2);
+		Scatter::SingleScatterSimulator sssDownsampled{
+		    *scanner, *muDownsampled, *lambdaDownsampled,
+		    Scatter::CrystalMaterial::LYSO, 13};
+		REQUIRE(sssDownsampled.getNumSamples() < sss.getNumSamples());
+		auto downsampledHisto = std::make_unique<Histogram3DOwned>(*scanner);
+		downsampledHisto->allocate();
+		downsampledHisto->clearProjections(0.0f);
+		sssDownsampled.runSSS(NumZ, NumPhi, NumR, *downsampledHisto);
+		double sum = 0.0, sumDownsampled = 0.0;
+		for (bin_t binId = 0; binId < scatterHisto->count(); binId++)
+		{
+			sum += scatterHisto->getProjectionValue(binId);
+			sumDownsampled += downsampledHisto->getProjectionValue(binId);
+		}
+		REQUIRE(sum > 0.0);
+		REQUIRE(sumDownsampled > 0.0);
+		double distance = 0.0;
+		for (bin_t binId = 0; binId < scatterHisto->count(); binId++)
+		{
+			distance += std::abs(
+			    scatterHisto->getProjectionValue(binId) / sum -
+			    downsampledHisto->getProjectionValue(binId) / sumDownsampled);
+		}
+		CHECK(distance < 0.1);
+	}
+}
+
+TEST_CASE("single-scatter-scalar", "[scatter]")
+{
+	auto scanner = TestUtils::makeScanner();
+	scanner->energyLLD = 400.0f;
+	scanner->fwhm = 0.2f * 511.0f;
+	scanner->collimatorRadius = 150.0f;
+
+	// Cylinder of radius 100 mm, much longer than the axial FOV, so that
+	// the end plates reject scatter points, some of them with rays too
+	// oblique for a valid crystal length
+	const ImageParams imgParams{24, 24, 24, 240.0f, 240.0f, 2400.0f};
+	ImageOwned mu{imgParams};
+	ImageOwned lambda{imgParams};
+	mu.allocate();
+	lambda.allocate();
+	for (int k = 0; k < imgParams.nz; k++)
+	{
+		for (int j = 0; j < imgParams.ny; j++)
+		{
+			for (int i = 0; i < imgParams.nx; i++)
+			{
+				const float x = (i - 11.5f) * 10.0f;
+				const float y = (j - 11.5f) * 10.0f;
+				const bool inside = x * x + y * y < 100.0f * 100.0f;
+				mu.getData()[k][j][i] = inside ? 0.096f : 0.0f;
+				lambda.getData()[k][j][i] = inside ? 1.0f + (k % 3) : 0.0f;
+			}
+		}
+	}
+	Scatter::SingleScatterSimulator sss{*scanner, mu, lambda,
+	                                    Scatter::CrystalMaterial::LYSO, 13};
+
+	// A few LORs, through the center or not, direct or oblique
+	Histogram3DOwned histo{*scanner};
+	ScatterRefStats stats;
+	size_t numNonZero = 0;
+	for (const size_t r : {size_t{0}, histo.numR / 3, histo.numR / 2})
+	{
+		for (const size_t phi : {size_t{0}, histo.numPhi / 3})
+		{
+			for (const size_t z : {size_t{0}, histo.numZBin / 2})
+			{
+				const bin_t binId = histo.getBinIdFromCoords(r, phi, z);
+				const auto [d1, d2] = histo.getDetectorPair(binId);
+				const Line3D lor{scanner->getDetectorPos(d1),
+				                 scanner->getDetectorPos(d2)};
+				const Vector3D n1 = scanner->getDetectorOrient(d1);
+				const Vector3D n2 = scanner->getDetectorOrient(d2);
+				const double scatterRef = computeSingleScatterInLORRef(
+				    sss, *scanner, mu, lambda, lor, n1, n2, stats);
+				const float scatter = sss.computeSingleScatterInLOR(lor, n1, n2);
+				REQUIRE(std::isfinite(scatter));
+				CHECK(scatter == Approx(scatterRef).epsilon(1e-6));
+				numNonZero += scatterRef > 0.0;
+			}
+		}
+	}
+	CHECK(numNonZero > 0);
+	// The masked lanes did include rejected points with invalid lengths
+	CHECK(stats.numRejectedCollimator > 0);
+	CHECK(stats.numRejectedInvalidLength > 0);
+}
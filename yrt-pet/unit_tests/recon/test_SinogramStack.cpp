@@ -0,0 +1,270 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "catch.hpp"
+
+#include "datastruct/image/Image.hpp"
+#include "datastruct/projection/Histogram3D.hpp"
+#include "datastruct/projection/SinogramStack.hpp"
+#include "operators/OperatorProjectorDD.hpp"
+#include "operators/OperatorProjectorSiddon.hpp"
+#include "test_utils.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+	// Image whose slices match the slices of the sinogram stack
+	ImageParams makeSliceMatchedImageParams(const SinogramStack& stack,
+	                                        float off_x = 0.0f,
+	                                        float off_y = 0.0f)
+	{
+		const size_t numSlices = stack.numSlices;
+		const float sliceThickness =
+		    stack.getSlicePosition(1) - stack.getSlicePosition(0);
+		const float off_z = 0.5f * (stack.getSlicePosition(0) +
+		                            stack.getSlicePosition(numSlices - 1));
+		return ImageParams{24,
+		                   24,
+		                   static_cast<int>(numSlices),
+		                   240.0f,
+		                   240.0f,
+		                   numSlices * sliceThickness,
+		                   off_x,
+		                   off_y,
+		                   off_z};
+	}
+
+	double relativeDifference(const ProjectionData& a, const ProjectionData& b,
+	                          size_t firstBin, size_t lastBin)
+	{
+		double diff2 = 0.0;
+		double ref2 = 0.0;
+		for (bin_t binId = firstBin; binId < lastBin; binId++)
+		{
+			const double va = a.getProjectionValue(binId);
+			const double vb = b.getProjectionValue(binId);
+			diff2 += (va - vb) * (va - vb);
+			ref2 += vb * vb;
+		}
+		return std::sqrt(diff2 / ref2);
+	}
+}  // namespace
+
+TEST_CASE("sinostack", "[sinostack]")
+{
+	auto scanner = TestUtils::makeScanner();
+
+	SECTION("sinostack-structure")
+	{
+		auto stack = std::make_unique<SinogramStackOwned>(*scanner);
+		REQUIRE(stack->numSlices == 2 * scanner->numRings - 1);
+		REQUIRE(stack->hasTransaxialLORs());
+
+		size_t numRingPairs = 0;
+		for (coord_t slice = 0; slice < stack->numSlices; slice++)
+		{
+			numRingPairs += stack->getNumRingPairsInSlice(slice);
+		}
+		auto histo3d = std::make_unique<Histogram3DOwned>(*scanner);
+		CHECK(numRingPairs == histo3d->numZBin);
+
+		for (bin_t binId = 0; binId < stack->count(); binId += 5)
+		{
+			const auto [d1, d2] = stack->getDetectorPair(binId);
+			REQUIRE(stack->getBinIdFromDetPair(d1, d2) == binId);
+
+			coord_t r, phi, slice;
+			stack->getCoordsFromBinId(binId, r, phi, slice);
+			const Line3D lor = stack->getLOR(binId);
+			REQUIRE(lor.point1.z == lor.point2.z);
+			REQUIRE(lor.point1.z == Approx(stack->getSlicePosition(slice)));
+		}
+	}
+
+	SECTION("sinostack-ssrb")
+	{
+		auto histo3d = std::make_unique<Histogram3DOwned>(*scanner);
+		histo3d->allocate();
+		srand(13);
+		for (bin_t binId = 0; binId < histo3d->count(); binId++)
+		{
+			histo3d->setProjectionValue(binId, static_cast<float>(rand() % 10));
+		}
+
+		auto stack = std::make_unique<SinogramStackOwned>(*scanner);
+		stack->allocate();
+		stack->rebinSSRB(*histo3d);
+
+		// Rebinning event by event (list-mode path) gives the same result
+		auto stackEvents = std::make_unique<SinogramStackOwned>(*scanner);
+		stackEvents->allocate();
+		auto binIter = histo3d->getBinIter(1, 0);
+		stackEvents->rebinSSRB(*histo3d, binIter.get());
+
+		double sum3d = 0.0;
+		for (bin_t binId = 0; binId < histo3d->count(); binId++)
+		{
+			sum3d += histo3d->getProjectionValue(binId);
+		}
+		double sumStack = 0.0;
+		for (bin_t binId = 0; binId < stack->count(); binId++)
+		{
+			REQUIRE(stackEvents->getProjectionValue(binId) ==
+			        Approx(stack->getProjectionValue(binId)));
+			coord_t r, phi, slice;
+			stack->getCoordsFromBinId(binId, r, phi, slice);
+			sumStack += stack->getProjectionValue(binId) *
+			            stack->getNumRingPairsInSlice(slice);
+		}
+		CHECK(sumStack == Approx(sum3d));
+
+		// Restricting the ring difference
+		auto stackDirect = std::make_unique<SinogramStackOwned>(*scanner, 0);
+		stackDirect->allocate();
+		stackDirect->rebinSSRB(*histo3d);
+		const bin_t sliceSize = stack->numPhi * stack->numR;
+		for (bin_t binId = 0; binId < stack->count(); binId += 3)
+		{
+			const coord_t slice = binId / sliceSize;
+			const float expected =
+			    (slice % 2 == 0) ?
+			        histo3d->getProjectionValue((slice / 2) * sliceSize +
+			                                    binId % sliceSize) :
+			        0.0f;
+			REQUIRE(stackDirect->getProjectionValue(binId) == expected);
+		}
+	}
+
+	SECTION("sinostack-projectors")
+	{
+		auto stack = std::make_unique<SinogramStackOwned>(*scanner);
+		stack->allocate();
+		// Shifted to avoid LORs along the pixel boundaries, where Siddon's
+		// incremental and non-incremental versions can differ
+		const ImageParams imgParams =
+		    makeSliceMatchedImageParams(*stack, 0.37f, -0.21f);
+		auto img = std::make_unique<ImageOwned>(imgParams);
+		img->allocate();
+		srand(13);
+		for (int k = 0; k < imgParams.nz; k++)
+		{
+			for (int j = 0; j < imgParams.ny; j++)
+			{
+				for (int i = 0; i < imgParams.nx; i++)
+				{
+					img->getData()[k][j][i] =
+					    static_cast<float>(rand() % 100) / 10.0f;
+				}
+			}
+		}
+
+		auto binIter = stack->getBinIter(1, 0);
+		const OperatorProjectorParams projParams{binIter.get(), *scanner};
+		OperatorProjectorSiddon siddon{projParams};
+		OperatorProjectorDD dd{projParams};
+
+		for (OperatorProjector* projector :
+		     std::initializer_list<OperatorProjector*>{&siddon, &dd})
+		{
+			// Slice-by-slice projection is equivalent to the 3D projection
+			projector->applyA(img.get(), stack.get());
+			for (bin_t binId = 0; binId < stack->count(); binId++)
+			{
+				const float expected = projector->forwardProjection(
+				    img.get(), stack->getProjectionProperties(binId));
+				REQUIRE(stack->getProjectionValue(binId) ==
+				        Approx(expected).epsilon(1e-3).margin(1e-3));
+			}
+
+			// Adjoint: <A x, y> == <x, A^T y>
+			auto imgBp = std::make_unique<ImageOwned>(imgParams);
+			imgBp->allocate();
+			imgBp->setValue(0.0f);
+			auto stackOnes = std::make_unique<SinogramStackOwned>(*scanner);
+			stackOnes->allocate();
+			stackOnes->clearProjections(1.0f);
+			projector->applyAH(stackOnes.get(), imgBp.get());
+			double dotProj = 0.0;
+			for (bin_t binId = 0; binId < stack->count(); binId++)
+			{
+				dotProj += stack->getProjectionValue(binId);
+			}
+			REQUIRE(dotProj > 0.0);
+			CHECK(img->dotProduct(*imgBp) == Approx(dotProj).epsilon(1e-3));
+		}
+	}
+
+	SECTION("sinostack-fore-uniform")
+	{
+		// A uniform sinogram only has a DC component, which FORE keeps
+		auto histo3d = std::make_unique<Histogram3DOwned>(*scanner);
+		histo3d->allocate();
+		histo3d->clearProjections(1.0f);
+		auto stack = std::make_unique<SinogramStackOwned>(*scanner);
+		stack->allocate();
+		stack->rebinFORE(*histo3d);
+		for (bin_t binId = 0; binId < stack->count(); binId++)
+		{
+			REQUIRE(stack->getProjectionValue(binId) ==
+			        Approx(1.0f).epsilon(1e-3));
+		}
+	}
+
+	SECTION("sinostack-rebinning")
+	{
+		// Rebinned 3D projections of an object are close to its 2D
+		// projections
+		auto stack2d = std::make_unique<SinogramStackOwned>(*scanner);
+		stack2d->allocate();
+		const ImageParams imgParams = makeSliceMatchedImageParams(*stack2d);
+		auto img = std::make_unique<ImageOwned>(imgParams);
+		img->allocate();
+		img->setValue(0.0f);
+		for (int k = 0; k < imgParams.nz; k++)
+		{
+			for (int j = 4; j < 20; j++)
+			{
+				for (int i = 6; i < 16; i++)
+				{
+					img->getData()[k][j][i] = 1.0f + 0.05f * (i + j + k);
+				}
+			}
+		}
+		// Off-center hot spot
+		img->getData()[8][5][17] += 20.0f;
+
+		auto binIter2d = stack2d->getBinIter(1, 0);
+		OperatorProjectorSiddon projector2d{
+		    OperatorProjectorParams{binIter2d.get(), *scanner}};
+		projector2d.applyA(img.get(), stack2d.get());
+
+		auto histo3d = std::make_unique<Histogram3DOwned>(*scanner);
+		histo3d->allocate();
+		auto binIter3d = histo3d->getBinIter(1, 0);
+		OperatorProjectorSiddon projector3d{
+		    OperatorProjectorParams{binIter3d.get(), *scanner}};
+		projector3d.applyA(img.get(), histo3d.get());
+
+		auto stackSSRB = std::make_unique<SinogramStackOwned>(*scanner);
+		stackSSRB->allocate();
+		stackSSRB->rebinSSRB(*histo3d);
+		auto stackFORE = std::make_unique<SinogramStackOwned>(*scanner);
+		stackFORE->allocate();
+		stackFORE->rebinFORE(*histo3d);
+
+		// Central slices, where the rebinning has the most ring pairs
+		const size_t sliceSize = stack2d->numPhi * stack2d->numR;
+		const size_t firstBin = 6 * sliceSize;
+		const size_t lastBin = 11 * sliceSize;
+		CHECK(relativeDifference(*stackSSRB, *stack2d, firstBin, lastBin) <
+		      0.15);
+		// The test scanner has few samples per row and flat blocks, so the
+		// resampling of FORE on a uniform (s, theta) grid dominates its error
+		CHECK(relativeDifference(*stackFORE, *stack2d, firstBin, lastBin) <
+		      0.3);
+	}
+}
@@ -0,0 +1,258 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "catch.hpp"
+
+#include "datastruct/image/Image.hpp"
+#include "datastruct/projection/Histogram3D.hpp"
+#include "datastruct/projection/SpanHistogram.hpp"
+#include "operators/OperatorProjectorSiddon.hpp"
+#include "recon/Corrector_CPU.hpp"
+#include "test_utils.hpp"
+
+#include <cstdlib>
+
+
+TEST_CASE("spanhisto", "[spanhisto]")
+{
+	auto scanner = TestUtils::makeScanner();
+
+	auto histo3d = std::make_unique<Histogram3DOwned>(*scanner);
+	histo3d->allocate();
+	srand(13);
+	for (bin_t binId = 0; binId < histo3d->count(); binId++)
+	{
+		histo3d->setProjectionValue(binId, static_cast<float>(rand() % 10));
+	}
+
+	SECTION("span-structure")
+	{
+		auto spanHisto = std::make_unique<SpanHistogramOwned>(*scanner, 3);
+		REQUIRE(spanHisto->numR == histo3d->numR);
+		REQUIRE(spanHisto->numPhi == histo3d->numPhi);
+		REQUIRE(spanHisto->numZBin < histo3d->numZBin);
+		// Max ring difference of 4 with span 3: segments 0, +1 and -1
+		REQUIRE(spanHisto->getNumSegments() == 3);
+
+		size_t numRingPairs = 0;
+		size_t numZBinsSegment0 = 0;
+		for (coord_t z_bin = 0; z_bin < spanHisto->numZBin; z_bin++)
+		{
+			const size_t numRingPairsInZBin =
+			    spanHisto->getNumRingPairsInZBin(z_bin);
+			REQUIRE(numRingPairsInZBin > 0);
+			numRingPairs += numRingPairsInZBin;
+
+			const int segment = spanHisto->getSegmentOfZBin(z_bin);
+			if (segment == 0)
+			{
+				numZBinsSegment0++;
+			}
+			coord_t z1_first, z2_first;
+			spanHisto->getZ1Z2(z_bin, 0, z1_first, z2_first);
+			for (size_t i = 0; i < numRingPairsInZBin; i++)
+			{
+				coord_t z1, z2;
+				spanHisto->getZ1Z2(z_bin, i, z1, z2);
+				const int delta = static_cast<int>(z2) - static_cast<int>(z1);
+				CHECK(std::abs(delta) <= 4);
+				CHECK(z1 + z2 == z1_first + z2_first);
+				CHECK((std::abs(delta) + 1) / 3 == std::abs(segment));
+			}
+		}
+		CHECK(numRingPairs == histo3d->numZBin);
+		CHECK(numZBinsSegment0 == 2 * scanner->numRings - 1);
+
+		// Span 1 keeps every ring pair separate
+		auto spanHisto1 = std::make_unique<SpanHistogramOwned>(*scanner, 1);
+		CHECK(spanHisto1->numZBin == histo3d->numZBin);
+	}
+
+	SECTION("span-lors")
+	{
+		auto spanHisto = std::make_unique<SpanHistogramOwned>(*scanner, 3);
+		REQUIRE(spanHisto->hasLORBundles());
+		for (bin_t binId = 0; binId < spanHisto->count(); binId += 7)
+		{
+			const size_t numLORs = spanHisto->getNumLORsInBin(binId);
+			for (size_t lorIdx = 0; lorIdx < numLORs; lorIdx++)
+			{
+				const auto [d1, d2] =
+				    spanHisto->getDetectorPairInBin(binId, lorIdx);
+				REQUIRE(spanHisto->getBinIdFromDetPair(d1, d2) == binId);
+			}
+		}
+	}
+
+	SECTION("span-mashing")
+	{
+		auto spanHisto = std::make_unique<SpanHistogramOwned>(*histo3d, 5);
+
+		double sum3d = 0.0;
+		for (bin_t binId = 0; binId < histo3d->count(); binId++)
+		{
+			sum3d += histo3d->getProjectionValue(binId);
+		}
+		double sumSpan = 0.0;
+		for (bin_t binId = 0; binId < spanHisto->count(); binId++)
+		{
+			sumSpan += spanHisto->getProjectionValue(binId);
+		}
+		CHECK(sumSpan == Approx(sum3d));
+
+		// Mashing through the detector pairs gives the same histogram
+		auto spanHisto2 = std::make_unique<SpanHistogramOwned>(*scanner, 5);
+		spanHisto2->allocate();
+		spanHisto2->clearProjections(0.0f);
+		spanHisto2->accumulate(*histo3d);
+		for (bin_t binId = 0; binId < spanHisto->count(); binId++)
+		{
+			REQUIRE(spanHisto2->getProjectionValue(binId) ==
+			        Approx(spanHisto->getProjectionValue(binId)));
+		}
+	}
+
+	SECTION("span-projection")
+	{
+		// Forward projecting in the compressed histogram is equivalent to
+		// mashing the forward projection of the uncompressed one
+		const ImageParams imgParams{24, 24, 20, 240.0f, 240.0f, 200.0f};
+		auto img = std::make_unique<ImageOwned>(imgParams);
+		img->allocate();
+		img->setValue(0.0f);
+		for (int k = 5; k < 15; k++)
+		{
+			for (int j = 8; j < 16; j++)
+			{
+				for (int i = 6; i < 14; i++)
+				{
+					img->getData()[k][j][i] = 1.0f + 0.1f * (i + j + k);
+				}
+			}
+		}
+
+		auto spanHisto = std::make_unique<SpanHistogramOwned>(*scanner, 3);
+		spanHisto->allocate();
+		auto binIterSpan = spanHisto->getBinIter(1, 0);
+		OperatorProjectorSiddon projectorSpan{
+		    OperatorProjectorParams{binIterSpan.get(), *scanner}};
+		projectorSpan.applyA(img.get(), spanHisto.get());
+
+		auto binIter3d = histo3d->getBinIter(1, 0);
+		OperatorProjectorSiddon projector3d{
+		    OperatorProjectorParams{binIter3d.get(), *scanner}};
+		projector3d.applyA(img.get(), histo3d.get());
+		auto spanHistoRef =
+		    std::make_unique<SpanHistogramOwned>(*histo3d, 3);
+
+		for (bin_t binId = 0; binId < spanHisto->count(); binId++)
+		{
+			REQUIRE(spanHisto->getProjectionValue(binId) ==
+			        Approx(spanHistoRef->getProjectionValue(binId))
+			            .epsilon(1e-4)
+			            .margin(1e-3));
+		}
+
+		// Adjoint: <A x, y> == <x, A^T y>
+		auto imgBp = std::make_unique<ImageOwned>(imgParams);
+		imgBp->allocate();
+		imgBp->setValue(0.0f);
+		auto spanHistoOnes = std::make_unique<SpanHistogramOwned>(*scanner, 3);
+		spanHistoOnes->allocate();
+		spanHistoOnes->clearProjections(1.0f);
+		projectorSpan.applyAH(spanHistoOnes.get(), imgBp.get());
+		double dotProj = 0.0;
+		for (bin_t binId = 0; binId < spanHisto->count(); binId++)
+		{
+			dotProj += spanHisto->getProjectionValue(binId);
+		}
+		REQUIRE(dotProj > 0.0);
+		CHECK(img->dotProduct(*imgBp) == Approx(dotProj).epsilon(1e-3));
+	}
+
+	SECTION("span-corrections")
+	{
+		// The factors of a bin are those of the Histogram3D bins of its LORs:
+		// multiplicative factors averaged, randoms and scatter summed
+		const ImageParams imgParams{24, 24, 20, 240.0f, 240.0f, 200.0f};
+		auto attImg = std::make_unique<ImageOwned>(imgParams);
+		attImg->allocate();
+		for (int k = 0; k < 20; k++)
+		{
+			for (int j = 0; j < 24; j++)
+			{
+				for (int i = 0; i < 24; i++)
+				{
+					attImg->getData()[k][j][i] = 0.001f * (1 + (i + j + k) % 5);
+				}
+			}
+		}
+
+		auto sens3d = std::make_unique<Histogram3DOwned>(*scanner);
+		sens3d->allocate();
+		auto scatter3d = std::make_unique<Histogram3DOwned>(*scanner);
+		scatter3d->allocate();
+		for (bin_t binId = 0; binId < histo3d->count(); binId++)
+		{
+			sens3d->setProjectionValue(binId,
+			                           1.0f + static_cast<float>(rand() % 10));
+			scatter3d->setProjectionValue(binId,
+			                              static_cast<float>(rand() % 5));
+		}
+		// Mashed randoms, shared evenly between the LORs of their bins
+		auto randomsSpan = std::make_unique<SpanHistogramOwned>(*histo3d, 3);
+
+		Corrector_CPU corrector{*scanner};
+		corrector.setSensitivityHistogram(sens3d.get());
+		corrector.setHardwareAttenuationImage(attImg.get());
+		corrector.setRandomsHistogram(randomsSpan.get());
+		corrector.setScatterHistogram(scatter3d.get());
+		corrector.setup();
+
+		auto spanHisto = std::make_unique<SpanHistogramOwned>(*scanner, 3);
+		spanHisto->allocate();
+		corrector.precomputeAdditiveCorrectionFactors(*spanHisto);
+		std::vector<float> additiveSpan(spanHisto->count());
+		for (bin_t binId = 0; binId < spanHisto->count(); binId++)
+		{
+			additiveSpan[binId] = corrector.getAdditiveCorrectionFactor(binId);
+		}
+		corrector.precomputeAdditiveCorrectionFactors(*histo3d);
+
+		for (bin_t binId = 0; binId < spanHisto->count(); binId += 3)
+		{
+			const size_t numLORs = spanHisto->getNumLORsInBin(binId);
+			double multiplicativeSum = 0.0;
+			double randomsScatterSum = 0.0;
+			double randomsRef = 0.0;
+			for (size_t lorIdx = 0; lorIdx < numLORs; lorIdx++)
+			{
+				const auto [d1, d2] =
+				    spanHisto->getDetectorPairInBin(binId, lorIdx);
+				const bin_t histo3dBinId = histo3d->getBinIdFromDetPair(d1, d2);
+				const float multiplicative =
+				    corrector.getMultiplicativeCorrectionFactor(*histo3d,
+				                                                histo3dBinId);
+				multiplicativeSum += multiplicative;
+				randomsScatterSum +=
+				    multiplicative *
+				    corrector.getAdditiveCorrectionFactor(histo3dBinId);
+				randomsRef +=
+				    randomsSpan->getProjectionValueFromHistogramBin(
+				        histo3dBinId);
+			}
+			const double multiplicativeMean = multiplicativeSum / numLORs;
+			CHECK(randomsRef ==
+			      Approx(randomsSpan->getProjectionValue(binId)));
+			REQUIRE(corrector.getMultiplicativeCorrectionFactor(
+			            *spanHisto, binId) ==
+			        Approx(multiplicativeMean).epsilon(1e-4));
+			REQUIRE(additiveSpan[binId] ==
+			        Approx(randomsScatterSum / multiplicativeMean)
+			            .epsilon(1e-4)
+			            .margin(1e-5));
+		}
+	}
+}
@@ -115,4 +115,45 @@ TEST_CASE("sparsehisto", "[sparsehisto]")
 
 		std::remove(filename.c_str());
 	}
+
+	SECTION("read-write-chunked")
+	{
+		srand(13);
+		const det_id_t numDets = static_cast<det_id_t>(scanner->getNumDets());
+
+		auto sparseHisto = std::make_unique<SparseHistogram>(*scanner);
+		// Several chunks of events
+		constexpr size_t NumBins = 150000;
+		sparseHisto->allocate(NumBins);
+		for (size_t i = 0; i < NumBins; i++)
+		{
+			sparseHisto->accumulate(
+			    det_pair_t{rand() % numDets, rand() % numDets},
+			    static_cast<float>(rand() % 10));
+		}
+		const std::string filename = "mysparsehisto_chunked.shis";
+
+		for (auto compression :
+		     {Util::ChunkCompression::NONE, Util::ChunkCompression::ZLIB})
+		{
+			sparseHisto->writeToFileChunked(filename, compression);
+			REQUIRE(Util::isChunkedFile(filename));
+			auto sparseHistoFromFile =
+			    std::make_unique<SparseHistogram>(*scanner, filename);
+
+			REQUIRE(sparseHistoFromFile->count() == sparseHisto->count());
+			for (bin_t i = 0; i < sparseHisto->count(); i++)
+			{
+				const det_pair_t detPair = sparseHisto->getDetectorPair(i);
+				const det_pair_t detPairFromFile =
+				    sparseHistoFromFile->getDetectorPair(i);
+				REQUIRE(detPair.d1 == detPairFromFile.d1);
+				REQUIRE(detPair.d2 == detPairFromFile.d2);
+				REQUIRE(sparseHisto->getProjectionValue(i) ==
+				        sparseHistoFromFile->getProjectionValue(i));
+			}
+		}
+
+		std::remove(filename.c_str());
+	}
 }
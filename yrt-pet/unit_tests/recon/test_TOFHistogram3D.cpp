@@ -0,0 +1,392 @@
+/*
+ * This file is subject to the terms and conditions defined in
+ * file 'LICENSE.txt', which is part of this source code package.
+ */
+
+#include "catch.hpp"
+
+#include "datastruct/image/Image.hpp"
+#include "datastruct/projection/Histogram3D.hpp"
+#include "datastruct/projection/ListModeLUT.hpp"
+#include "datastruct/projection/TOFHistogram3D.hpp"
+#include "geometry/Constants.hpp"
+#include "operators/OperatorProjectorDD.hpp"
+#include "operators/OperatorProjectorSiddon.hpp"
+#include "recon/OSEM.hpp"
+#include "test_utils.hpp"
+#include "utils/ReconstructionUtils.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace
+{
+	// Uniform cylinder of radius 40 mm
+	std::unique_ptr<ImageOwned> makeCylinderImage()
+	{
+		const ImageParams imgParams{24, 24, 20, 240.0f, 240.0f, 200.0f};
+		auto img = std::make_unique<ImageOwned>(imgParams);
+		img->allocate();
+		img->setValue(0.0f);
+		for (int k = 3; k < 17; k++)
+		{
+			for (int j = 0; j < 24; j++)
+			{
+				for (int i = 0; i < 24; i++)
+				{
+					const float x = (i - 11.5f) * 10.0f;
+					const float y = (j - 11.5f) * 10.0f;
+					if (x * x + y * y < 40.0f * 40.0f)
+					{
+						img->getData()[k][j][i] = 1.0f + 0.05f * (i + j + k);
+					}
+				}
+			}
+		}
+		return img;
+	}
+
+	// Checks the TOF-binned projections against the non-TOF ones: with TOF
+	// bins covering the whole object, the bins of a LOR sum to the non-TOF
+	// projection. Also checks the adjoint
+	template <typename Projector>
+	void checkTOFBinProjection(const Scanner& scanner, const Image& img,
+	                           const Histogram3D& histo3dRef,
+	                           TOFHistogram3D& tofHisto)
+	{
+		auto binIter = tofHisto.getBinIter(1, 0);
+		Projector projector{
+		    OperatorProjectorParams{binIter.get(), scanner, 200.0f, -1}};
+		projector.applyA(&img, &tofHisto);
+
+		auto sumHisto3d = std::make_unique<Histogram3DOwned>(scanner);
+		sumHisto3d->allocate();
+		tofHisto.collapseToHistogram3D(*sumHisto3d);
+		for (bin_t binId = 0; binId < histo3dRef.count(); binId++)
+		{
+			REQUIRE(sumHisto3d->getProjectionValue(binId) ==
+			        Approx(histo3dRef.getProjectionValue(binId))
+			            .epsilon(1e-3)
+			            .margin(1e-3));
+		}
+
+		// Adjoint: <A x, y> == <x, A^T y>
+		auto tofHistoY = std::make_unique<TOFHistogram3DOwned>(
+		    scanner, tofHisto.numTOFBins, tofHisto.getTOFBinWidth());
+		tofHistoY->allocate();
+		srand(13);
+		double dotProj = 0.0;
+		for (bin_t binId = 0; binId < tofHisto.count(); binId++)
+		{
+			const float y = static_cast<float>(rand() % 10);
+			tofHistoY->setProjectionValue(binId, y);
+			dotProj += y * tofHisto.getProjectionValue(binId);
+		}
+		auto imgBp = std::make_unique<ImageOwned>(img.getParams());
+		imgBp->allocate();
+		imgBp->setValue(0.0f);
+		projector.applyAH(tofHistoY.get(), imgBp.get());
+		REQUIRE(dotProj > 0.0);
+		CHECK(img.dotProduct(*imgBp) == Approx(dotProj).epsilon(1e-3));
+	}
+}  // namespace
+
+TEST_CASE("tofhisto", "[tofhisto]")
+{
+	auto scanner = TestUtils::makeScanner();
+	constexpr size_t NumTOFBins = 15;
+	constexpr float TOFBinWidth_ps = 100.0f;
+
+	SECTION("tofhisto-structure")
+	{
+		auto tofHisto = std::make_unique<TOFHistogram3DOwned>(
+		    *scanner, NumTOFBins, TOFBinWidth_ps);
+		const Histogram3D& histo3d = tofHisto->getHistogram3D();
+		REQUIRE(tofHisto->count() == histo3d.count() * NumTOFBins);
+		REQUIRE(tofHisto->hasTOF());
+		REQUIRE(tofHisto->hasTOFBins());
+		REQUIRE(tofHisto->getNumTOFBins() == NumTOFBins);
+
+		CHECK(tofHisto->getTOFBinCenter(7) == Approx(0.0f).margin(1e-6));
+		CHECK(tofHisto->getTOFBinCenter(0) == Approx(-700.0f));
+		CHECK(tofHisto->getTOFBinCenter(14) == Approx(700.0f));
+		CHECK(tofHisto->getTOFBinFromValue(0.0f) == 7);
+		CHECK(tofHisto->getTOFBinFromValue(-49.0f) == 7);
+		CHECK(tofHisto->getTOFBinFromValue(51.0f) == 8);
+		CHECK(tofHisto->getTOFBinFromValue(-749.0f) == 0);
+		CHECK(tofHisto->getTOFBinFromValue(751.0f) == -1);
+		CHECK(tofHisto->getTOFBinFromValue(-751.0f) == -1);
+
+		for (bin_t binId = 0; binId < tofHisto->count(); binId += 37)
+		{
+			coord_t r, phi, z_bin, tofBin;
+			tofHisto->getCoordsFromBinId(binId, r, phi, z_bin, tofBin);
+			REQUIRE(tofHisto->getBinIdFromCoords(r, phi, z_bin, tofBin) ==
+			        binId);
+			REQUIRE(tofHisto->getTOFValue(binId) ==
+			        Approx(tofHisto->getTOFBinCenter(tofBin)));
+
+			// Swapping the detectors flips the TOF
+			const auto [d1, d2] = tofHisto->getDetectorPair(binId);
+			const float tofValue = tofHisto->getTOFValue(binId);
+			bin_t binFromEvent, binFromSwapped;
+			REQUIRE(tofHisto->getBinIdFromEvent(d1, d2, tofValue,
+			                                    binFromEvent));
+			REQUIRE(tofHisto->getBinIdFromEvent(d2, d1, -tofValue,
+			                                    binFromSwapped));
+			CHECK(binFromEvent == binId);
+			CHECK(binFromSwapped == binId);
+		}
+
+		// The TOF bins of a LOR are consecutive in the bin iterators
+		auto binIter = tofHisto->getBinIter(4, 1);
+		REQUIRE(binIter->size() % NumTOFBins == 0);
+		for (bin_t idx = 0; idx < binIter->size(); idx += NumTOFBins)
+		{
+			const bin_t first = binIter->get(idx);
+			REQUIRE(first % NumTOFBins == 0);
+			for (size_t t = 1; t < NumTOFBins; t++)
+			{
+				REQUIRE(binIter->get(idx + t) == first + t);
+			}
+		}
+	}
+
+	SECTION("tofhisto-listmode")
+	{
+		auto tofHisto = std::make_unique<TOFHistogram3DOwned>(
+		    *scanner, NumTOFBins, TOFBinWidth_ps);
+		tofHisto->allocate();
+		tofHisto->clearProjections(0.0f);
+		const Histogram3D& histo3d = tofHisto->getHistogram3D();
+
+		constexpr size_t NumEvents = 5000;
+		auto lm = std::make_unique<ListModeLUTOwned>(*scanner, true);
+		lm->allocate(NumEvents);
+		srand(13);
+		size_t numEventsInRange = 0;
+		for (bin_t eventId = 0; eventId < NumEvents; eventId++)
+		{
+			const bin_t histo3dBin = rand() % histo3d.count();
+			auto [d1, d2] = histo3d.getDetPairFromBinId(histo3dBin);
+			const float tofValue = static_cast<float>(rand() % 1700) - 850.0f;
+			// The TOF range of the histogram is [-750, 750) ps
+			if (tofValue >= -750.0f && tofValue < 750.0f)
+			{
+				numEventsInRange++;
+			}
+			if (eventId % 2 == 0)
+			{
+				std::swap(d1, d2);
+			}
+			lm->setTimestampOfEvent(eventId, eventId);
+			lm->setDetectorIdsOfEvent(eventId, d1, d2);
+			lm->setTOFValueOfEvent(eventId, tofValue);
+		}
+		Util::convertToTOFHistogram3D(*lm, *tofHisto);
+
+		double sum = 0.0;
+		for (bin_t binId = 0; binId < tofHisto->count(); binId++)
+		{
+			sum += tofHisto->getProjectionValue(binId);
+		}
+		CHECK(sum == Approx(numEventsInRange));
+
+		for (bin_t eventId = 0; eventId < NumEvents; eventId += 17)
+		{
+			const auto [d1, d2] = lm->getDetectorPair(eventId);
+			bin_t binId;
+			if (tofHisto->getBinIdFromEvent(d1, d2, lm->getTOFValue(eventId),
+			                                binId))
+			{
+				CHECK(tofHisto->getProjectionValue(binId) >= 1.0f);
+			}
+		}
+	}
+
+	SECTION("tofhisto-projection")
+	{
+		auto img = makeCylinderImage();
+
+		auto histo3d = std::make_unique<Histogram3DOwned>(*scanner);
+		histo3d->allocate();
+		auto binIter3d = histo3d->getBinIter(1, 0);
+
+		auto tofHisto = std::make_unique<TOFHistogram3DOwned>(
+		    *scanner, NumTOFBins, TOFBinWidth_ps);
+		tofHisto->allocate();
+
+		OperatorProjectorSiddon projectorSiddon{
+		    OperatorProjectorParams{binIter3d.get(), *scanner}};
+		projectorSiddon.applyA(img.get(), histo3d.get());
+		checkTOFBinProjection<OperatorProjectorSiddon>(*scanner, *img,
+		                                                *histo3d, *tofHisto);
+
+		OperatorProjectorDD projectorDD{
+		    OperatorProjectorParams{binIter3d.get(), *scanner}};
+		projectorDD.applyA(img.get(), histo3d.get());
+		checkTOFBinProjection<OperatorProjectorDD>(*scanner, *img, *histo3d,
+		                                           *tofHisto);
+	}
+
+	SECTION("tofhisto-osem")
+	{
+		// One OSEM iteration on TOF-binned data matches the EM update
+		// computed with the projector's own applyA/applyAH, without and with
+		// additive corrections
+		constexpr float TOFWidth_ps = 200.0f;
+		auto img = makeCylinderImage();
+		const ImageParams& imgParams = img->getParams();
+
+		auto tofHisto = std::make_unique<TOFHistogram3DOwned>(
+		    *scanner, NumTOFBins, TOFBinWidth_ps);
+		tofHisto->allocate();
+		auto binIter = tofHisto->getBinIter(1, 0);
+		OperatorProjectorSiddon projector{OperatorProjectorParams{
+		    binIter.get(), *scanner, TOFWidth_ps, -1}};
+		projector.applyA(img.get(), tofHisto.get());
+
+		auto sensImage = std::make_unique<ImageOwned>(imgParams);
+		sensImage->allocate();
+		sensImage->setValue(2.0f);
+
+		// Randoms without TOF bins, given for the whole LOR, and TOF-binned
+		// scatter
+		srand(13);
+		auto randomsHisto = std::make_unique<Histogram3DOwned>(*scanner);
+		randomsHisto->allocate();
+		for (bin_t binId = 0; binId < randomsHisto->count(); binId++)
+		{
+			randomsHisto->setProjectionValue(
+			    binId, NumTOFBins * 0.1f * (rand() % 4));
+		}
+		auto scatterHisto = std::make_unique<TOFHistogram3DOwned>(
+		    *scanner, NumTOFBins, TOFBinWidth_ps);
+		scatterHisto->allocate();
+		for (bin_t binId = 0; binId < scatterHisto->count(); binId++)
+		{
+			scatterHisto->setProjectionValue(binId, 0.1f * (rand() % 4));
+		}
+
+		// The TOF bins follow the order of the detectors
+		const Histogram* scatterBase = scatterHisto.get();
+		for (bin_t binId = 0; binId < scatterHisto->count(); binId += 31)
+		{
+			const auto [d1, d2] = scatterHisto->getDetectorPair(binId);
+			constexpr auto NumTOFBins32 = static_cast<uint32_t>(NumTOFBins);
+			const auto tofBin = static_cast<uint32_t>(binId % NumTOFBins);
+			REQUIRE(scatterBase->getProjectionValueFromHistogramBin(
+			            det_pair_tof_t{d2, d1, NumTOFBins32 - 1 - tofBin,
+			                           NumTOFBins32}) ==
+			        scatterHisto->getProjectionValue(binId));
+		}
+
+		auto initImage = std::make_unique<ImageOwned>(imgParams);
+		initImage->allocate();
+		initImage->setValue(OSEM::INITIAL_VALUE_MLEM);
+		auto ratioHisto = std::make_unique<TOFHistogram3DOwned>(
+		    *scanner, NumTOFBins, TOFBinWidth_ps);
+		ratioHisto->allocate();
+		auto bpImage = std::make_unique<ImageOwned>(imgParams);
+		bpImage->allocate();
+
+		for (const bool withCorrections : {false, true})
+		{
+			auto osem = Util::createOSEM(*scanner);
+			osem->setImageParams(imgParams);
+			osem->setDataInput(tofHisto.get());
+			osem->addTOF(TOFWidth_ps, -1);
+			osem->projectorType = OperatorProjector::SIDDON;
+			osem->num_MLEM_iterations = 1;
+			osem->num_OSEM_subsets = 1;
+			osem->setSensitivityImage(sensImage.get());
+			if (withCorrections)
+			{
+				osem->setRandomsHistogram(randomsHisto.get());
+				osem->setScatterHistogram(scatterHisto.get());
+			}
+			const std::unique_ptr<ImageOwned> reconImage =
+			    osem->reconstruct("");
+
+			// x1 = x0 * A^T(y / (A x0 + r + s)) / sens, with the randoms of
+			// a LOR split evenly between its TOF bins
+			projector.applyA(initImage.get(), ratioHisto.get());
+			for (bin_t binId = 0; binId < ratioHisto->count(); binId++)
+			{
+				float proj = ratioHisto->getProjectionValue(binId);
+				if (withCorrections)
+				{
+					const bin_t histo3dBinId =
+					    tofHisto->getHistogram3DBinId(binId);
+					proj += randomsHisto->getProjectionValue(histo3dBinId) /
+					            NumTOFBins +
+					        scatterHisto->getProjectionValue(binId);
+				}
+				ratioHisto->setProjectionValue(
+				    binId, proj > 1e-8 ?
+				               tofHisto->getProjectionValue(binId) / proj :
+				               0.0f);
+			}
+			bpImage->setValue(0.0f);
+			projector.applyAH(ratioHisto.get(), bpImage.get());
+
+			const float* recon = reconImage->getRawPointer();
+			const float* bp = bpImage->getRawPointer();
+			double maxValue = 0.0;
+			for (int i = 0; i < imgParams.nx * imgParams.ny * imgParams.nz;
+			     i++)
+			{
+				const float expected = OSEM::INITIAL_VALUE_MLEM * bp[i] / 2.0f;
+				maxValue = std::max<double>(maxValue, expected);
+				REQUIRE(recon[i] ==
+				        Approx(expected).epsilon(1e-4).margin(1e-6));
+			}
+			REQUIRE(maxValue > 0.0);
+		}
+	}
+
+	SECTION("tofhisto-localization")
+	{
+		// Point source off-center: the most probable TOF bin of the LORs
+		// crossing it is the one of its position along the LOR
+		const ImageParams imgParams{24, 24, 20, 240.0f, 240.0f, 200.0f};
+		auto img = std::make_unique<ImageOwned>(imgParams);
+		img->allocate();
+		img->setValue(0.0f);
+		img->getData()[10][13][16] = 1.0f;
+		const Vector3D source{(16 - 11.5f) * 10.0f, (13 - 11.5f) * 10.0f,
+		                      (10 - 9.5f) * 10.0f};
+
+		auto tofHisto = std::make_unique<TOFHistogram3DOwned>(
+		    *scanner, NumTOFBins, TOFBinWidth_ps);
+		tofHisto->allocate();
+		auto binIter = tofHisto->getBinIter(1, 0);
+		OperatorProjectorSiddon projector{
+		    OperatorProjectorParams{binIter.get(), *scanner, 200.0f, -1}};
+		projector.applyA(img.get(), tofHisto.get());
+
+		size_t numLORsChecked = 0;
+		for (bin_t first = 0; first < tofHisto->count(); first += NumTOFBins)
+		{
+			const float* values =
+			    tofHisto->getData().getRawPointer() + first;
+			const float* maxPtr = std::max_element(values, values + NumTOFBins);
+			if (*maxPtr < 5.0f)
+			{
+				continue;
+			}
+			const Line3D lor = tofHisto->getProjectionProperties(first).lor;
+			const Vector3D dir = lor.point2 - lor.point1;
+			const float lorNorm = dir.getNorm();
+			const float pos_mm =
+			    (source - lor.point1).scalProd(dir) / lorNorm;
+			const float tofValue =
+			    (pos_mm - 0.5f * lorNorm) / (SPEED_OF_LIGHT_MM_PS * 0.5f);
+			const int expectedBin = tofHisto->getTOFBinFromValue(tofValue);
+			const int maxBin = static_cast<int>(maxPtr - values);
+			CHECK(std::abs(maxBin - expectedBin) <= 1);
+			numLORsChecked++;
+		}
+		CHECK(numLORsChecked > 0);
+	}
+}
@@ -46,4 +46,46 @@ TEST_CASE("TOF", "[tof]")
 		    tofHelper.getWeight(d_norm, tof_value_ps, pix_pos_lo, pix_pos_hi);
 		REQUIRE(std::abs(tof_weight - 0.000543244) < 1e-4);
 	}
+
+	SECTION("lut")
+	{
+		const float tof_width_ps = 500.f;
+		const auto tofHelper = TimeOfFlightHelper(tof_width_ps, 3);
+		const auto tofHelperLUT = TimeOfFlightHelper(tof_width_ps, 3, 32);
+		const float sigma = tofHelper.getSigma();
+		const float d_norm = 600.f;
+		const float tof_value_ps = 100.f;
+		const float center =
+		    0.5f * d_norm + tof_value_ps * SPEED_OF_LIGHT_MM_PS * 0.5f;
+
+		REQUIRE(tofHelperLUT.getLUTSamplesPerStd() == 32);
+		CHECK(tofHelperLUT.getCDF(0.f) == Approx(0.5f).margin(1e-6));
+		CHECK(tofHelperLUT.getCDF(-10.f * sigma) == Approx(0.f).margin(1e-6));
+		CHECK(tofHelperLUT.getCDF(10.f * sigma) == Approx(1.f).margin(1e-6));
+		CHECK(tofHelperLUT.getCDF(sigma) == Approx(0.841345f).margin(1e-5));
+
+		for (int i = 0; i < 100; i++)
+		{
+			// Segments of random length, shorter and longer than a table step
+			const float lo = (rand() / (float)RAND_MAX) * d_norm;
+			const float hi =
+			    lo + (0.01f + (rand() / (float)RAND_MAX) * 0.3f) * sigma;
+			const double len = static_cast<double>(hi) - lo;
+
+			// Mean of the Gaussian over the segment
+			const double expected =
+			    (std::erf((hi - center) / (std::sqrt(2.0) * sigma)) -
+			     std::erf((lo - center) / (std::sqrt(2.0) * sigma))) /
+			    (2.0 * len);
+			const float weightLUT =
+			    tofHelperLUT.getWeight(d_norm, tof_value_ps, lo, hi);
+			CHECK(weightLUT ==
+			      Approx(expected).margin(5e-3 * tofHelper.getNorm()));
+
+			const float weight =
+			    tofHelper.getWeight(d_norm, tof_value_ps, lo, hi);
+			CHECK(weightLUT ==
+			      Approx(weight).margin(2e-2 * tofHelper.getNorm()));
+		}
+	}
 }
@@ -4,8 +4,11 @@
  */
 
 #include "catch.hpp"
+#include <cmath>
+#include <complex>
 #include <vector>
 
+#include "utils/FFT.hpp"
 #include "utils/RangeList.hpp"
 #include "utils/Utilities.hpp"
 
@@ -73,3 +76,47 @@ TEST_CASE("String", "[string]")
 		REQUIRE(ranges.getSizeTotal() == 19);
 	}
 }
+
+TEST_CASE("FFT", "[fft]")
+{
+	// Radix-2 and Bluestein lengths, compared against a direct DFT
+	for (const size_t n : {size_t{1}, size_t{8}, size_t{12}, size_t{17}})
+	{
+		std::vector<std::complex<float>> data(n);
+		for (size_t i = 0; i < n; i++)
+		{
+			data[i] = std::complex<float>(std::sin(0.7f * i) + 0.1f * i,
+			                              std::cos(1.3f * i));
+		}
+		std::vector<std::complex<float>> expected(n);
+		for (size_t k = 0; k < n; k++)
+		{
+			std::complex<double> sum{0.0};
+			for (size_t i = 0; i < n; i++)
+			{
+				const double angle = -2.0 * M_PI * k * i / n;
+				sum += std::complex<double>(data[i]) *
+				       std::complex<double>(std::cos(angle), std::sin(angle));
+			}
+			expected[k] = std::complex<float>(sum);
+		}
+
+		const Util::FFT1D fft{n};
+		std::vector<std::complex<float>> transformed = data;
+		fft.forward(transformed.data());
+		for (size_t k = 0; k < n; k++)
+		{
+			CHECK(transformed[k].real() ==
+			      Approx(expected[k].real()).margin(1e-4));
+			CHECK(transformed[k].imag() ==
+			      Approx(expected[k].imag()).margin(1e-4));
+		}
+
+		fft.inverse(transformed.data());
+		for (size_t i = 0; i < n; i++)
+		{
+			CHECK(transformed[i].real() == Approx(data[i].real()).margin(1e-5));
+			CHECK(transformed[i].imag() == Approx(data[i].imag()).margin(1e-5));
+		}
+	}
+}